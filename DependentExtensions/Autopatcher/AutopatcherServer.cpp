@@ -29,8 +29,11 @@
 #include "slikenet/AutopatcherRepositoryInterface.h"
 #include "..\..\Source\include\slikenet\slikeAssert.h"
 #include "slikenet/AutopatcherPatchContext.h"
+#include "slikenet/SuperFastHash.h"
 #include <stdio.h>
 #include <time.h>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
 
 using namespace SLNet;
 
@@ -99,6 +102,346 @@ void AutopatcherServerLoadNotifier_Printf::OnGetPatchCompleted(SystemAddress rem
 	printf("%s GetPatch complete. %s. %i queued. %i working.\n", systemAddressString, patchResultString, autopatcherState->requestsQueued, autopatcherState->requestsWorking);
 }
 
+// Written at the start of each file in the patch cache directory, followed by the key and the data
+struct PatchCacheFileHeader
+{
+	char magic[4];
+	uint32_t keyLength;
+	uint32_t dataLength;
+	uint32_t fileLength;
+	uint32_t patchAlgorithm;
+};
+static const char PATCH_CACHE_FILE_MAGIC[4]={'A','P','C','2'};
+
+AutopatcherPatchCache::AutopatcherPatchCache()
+{
+	head=0;
+	tail=0;
+	maxMemory=0;
+	memoryUsed=0;
+	hitCount=0;
+	missCount=0;
+}
+AutopatcherPatchCache::~AutopatcherPatchCache()
+{
+	// Referenced entries are also freed. Sends using them must have completed.
+	while (head)
+		RemoveEntry(head);
+}
+void AutopatcherPatchCache::SetMaxMemory(unsigned int maxBytes)
+{
+	entriesMutex.Lock();
+	maxMemory=maxBytes;
+	RemoveOldEntries();
+	entriesMutex.Unlock();
+}
+void AutopatcherPatchCache::SetPersistenceDirectory(const char *directory)
+{
+	entriesMutex.Lock();
+	if (directory && directory[0])
+	{
+		persistenceDirectory=directory;
+		char lastCharacter=directory[strlen(directory)-1];
+		if (lastCharacter!='/' && lastCharacter!='\\')
+			persistenceDirectory+="/";
+	}
+	else
+		persistenceDirectory.Clear();
+	entriesMutex.Unlock();
+}
+bool AutopatcherPatchCache::IsEnabled(void) const
+{
+	return maxMemory>0;
+}
+bool AutopatcherPatchCache::CanCache(unsigned int dataLength) const
+{
+	return dataLength>HASH_LENGTH && dataLength<=maxMemory/4;
+}
+AutopatcherPatchCache::Entry* AutopatcherPatchCache::Get(const char *applicationName, const char *filename, const char *priorHash, const char *currentHash)
+{
+	SLNet::RakString key = GetKey(applicationName, filename, priorHash, currentHash);
+	entriesMutex.Lock();
+	Entry **entryPtr = entries.Peek(key);
+	if (entryPtr)
+	{
+		Entry *entry = *entryPtr;
+		entry->referenceCount++;
+		Touch(entry);
+		hitCount++;
+		entriesMutex.Unlock();
+		return entry;
+	}
+	bool usePersistenceDirectory = persistenceDirectory.IsEmpty()==false;
+	entriesMutex.Unlock();
+
+	// Not read with entriesMutex locked, so other threads are not blocked by the disk
+	char *data;
+	unsigned int dataLength, fileLength;
+	uint32_t patchAlgorithm;
+	if (usePersistenceDirectory && LoadFromDisk(key, currentHash, &data, &dataLength, &fileLength, &patchAlgorithm))
+	{
+		Entry *entry = Add(applicationName, filename, priorHash, currentHash, data, dataLength, fileLength, patchAlgorithm);
+		rakFree_Ex(data, _FILE_AND_LINE_ );
+		if (entry)
+		{
+			entriesMutex.Lock();
+			hitCount++;
+			entriesMutex.Unlock();
+			return entry;
+		}
+	}
+
+	entriesMutex.Lock();
+	missCount++;
+	entriesMutex.Unlock();
+	return 0;
+}
+AutopatcherPatchCache::Entry* AutopatcherPatchCache::Add(const char *applicationName, const char *filename, const char *priorHash, const char *currentHash, const char *data, unsigned int dataLength, unsigned int fileLength, uint32_t patchAlgorithm)
+{
+	if (CanCache(dataLength)==false || memcmp(data, currentHash, HASH_LENGTH)!=0)
+		return 0;
+
+	SLNet::RakString key = GetKey(applicationName, filename, priorHash, currentHash);
+	entriesMutex.Lock();
+	Entry **entryPtr = entries.Peek(key);
+	if (entryPtr)
+	{
+		// Added by another thread in the meantime
+		Entry *entry = *entryPtr;
+		entry->referenceCount++;
+		Touch(entry);
+		entriesMutex.Unlock();
+		return entry;
+	}
+	entriesMutex.Unlock();
+
+	Entry *entry = SLNet::OP_NEW<Entry>(_FILE_AND_LINE_);
+	entry->key=key;
+	memcpy(entry->priorHash, priorHash, HASH_LENGTH);
+	memcpy(entry->currentHash, currentHash, HASH_LENGTH);
+	entry->data = (char*) rakMalloc_Ex(dataLength, _FILE_AND_LINE_);
+	if (entry->data==0)
+	{
+		notifyOutOfMemory(_FILE_AND_LINE_);
+		SLNet::OP_DELETE(entry, _FILE_AND_LINE_);
+		return 0;
+	}
+	memcpy(entry->data, data, dataLength);
+	entry->dataLength=dataLength;
+	entry->fileLength=fileLength;
+	entry->patchAlgorithm=patchAlgorithm;
+	entry->referenceCount=1;
+	entry->previous=0;
+	entry->next=0;
+
+	entriesMutex.Lock();
+	entryPtr = entries.Peek(key);
+	if (entryPtr)
+	{
+		Entry *existingEntry = *entryPtr;
+		existingEntry->referenceCount++;
+		Touch(existingEntry);
+		entriesMutex.Unlock();
+		rakFree_Ex(entry->data, _FILE_AND_LINE_);
+		SLNet::OP_DELETE(entry, _FILE_AND_LINE_);
+		return existingEntry;
+	}
+	entries.Push(key, entry, _FILE_AND_LINE_);
+	Touch(entry);
+	memoryUsed+=dataLength;
+	RemoveOldEntries();
+	bool usePersistenceDirectory = persistenceDirectory.IsEmpty()==false;
+	entriesMutex.Unlock();
+
+	// The data of a referenced entry does not change, so it can be written without the lock
+	if (usePersistenceDirectory)
+		SaveToDisk(entry);
+	return entry;
+}
+void AutopatcherPatchCache::Release(Entry *entry)
+{
+	entriesMutex.Lock();
+	RakAssert(entry->referenceCount>0);
+	entry->referenceCount--;
+	if (entry->referenceCount==0)
+		RemoveOldEntries();
+	entriesMutex.Unlock();
+}
+void AutopatcherPatchCache::Clear(void)
+{
+	entriesMutex.Lock();
+	Entry *entry = head;
+	while (entry)
+	{
+		Entry *next = entry->next;
+		if (entry->referenceCount==0)
+			RemoveEntry(entry);
+		entry=next;
+	}
+	entriesMutex.Unlock();
+}
+unsigned int AutopatcherPatchCache::GetMemoryUsed(void)
+{
+	entriesMutex.Lock();
+	unsigned int result = memoryUsed;
+	entriesMutex.Unlock();
+	return result;
+}
+unsigned int AutopatcherPatchCache::GetHitCount(void)
+{
+	entriesMutex.Lock();
+	unsigned int result = hitCount;
+	entriesMutex.Unlock();
+	return result;
+}
+unsigned int AutopatcherPatchCache::GetMissCount(void)
+{
+	entriesMutex.Lock();
+	unsigned int result = missCount;
+	entriesMutex.Unlock();
+	return result;
+}
+SLNet::RakString AutopatcherPatchCache::GetKey(const char *applicationName, const char *filename, const char *priorHash, const char *currentHash)
+{
+	// The bytes of the hashes as text, so the key does not depend on the byte order of the system
+	// The length of the application name comes first, so that no two pairs of names give the same key
+	const unsigned char *prior = (const unsigned char *) priorHash;
+	const unsigned char *current = (const unsigned char *) currentHash;
+	return SLNet::RakString("%02x%02x%02x%02x%02x%02x%02x%02x%u:%s%s",
+		prior[0], prior[1], prior[2], prior[3], current[0], current[1], current[2], current[3],
+		(unsigned int) strlen(applicationName), applicationName, filename);
+}
+void AutopatcherPatchCache::GetFilePath(const SLNet::RakString &key, char *path, size_t pathLength)
+{
+	// Names can be longer than a filename or contain path separators, so they are hashed. LoadFromDisk() checks the whole key.
+	unsigned int namesHash = SuperFastHash(key.C_String()+16, (int) key.GetLength()-16);
+	entriesMutex.Lock();
+	sprintf_s(path, pathLength, "%s%.16s%08x.patch", persistenceDirectory.C_String(), key.C_String(), namesHash);
+	entriesMutex.Unlock();
+}
+bool AutopatcherPatchCache::LoadFromDisk(const SLNet::RakString &key, const char *currentHash, char **data, unsigned int *dataLength, unsigned int *fileLength, uint32_t *patchAlgorithm)
+{
+	char path[512];
+	GetFilePath(key, path, sizeof(path));
+	FILE *fp;
+	if (fopen_s(&fp, path, "rb")!=0)
+		return false;
+
+	PatchCacheFileHeader header;
+	if (fread(&header, sizeof(header), 1, fp)!=1 ||
+		memcmp(header.magic, PATCH_CACHE_FILE_MAGIC, sizeof(header.magic))!=0 ||
+		header.keyLength!=key.GetLength() ||
+		CanCache(header.dataLength)==false)
+	{
+		fclose(fp);
+		return false;
+	}
+	// Another file whose names have the same hash
+	char *fileKey = (char*) rakMalloc_Ex(header.keyLength, _FILE_AND_LINE_);
+	bool sameKey = fileKey && fread(fileKey, header.keyLength, 1, fp)==1 && memcmp(fileKey, key.C_String(), header.keyLength)==0;
+	rakFree_Ex(fileKey, _FILE_AND_LINE_);
+	if (sameKey==false)
+	{
+		fclose(fp);
+		return false;
+	}
+	*data = (char*) rakMalloc_Ex(header.dataLength, _FILE_AND_LINE_);
+	if (*data==0)
+	{
+		fclose(fp);
+		return false;
+	}
+	if (fread(*data, header.dataLength, 1, fp)!=1 || memcmp(*data, currentHash, HASH_LENGTH)!=0)
+	{
+		// Truncated or not the patch it is named after
+		rakFree_Ex(*data, _FILE_AND_LINE_);
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+	*dataLength=header.dataLength;
+	*fileLength=header.fileLength;
+	*patchAlgorithm=header.patchAlgorithm;
+	return true;
+}
+void AutopatcherPatchCache::SaveToDisk(const Entry *entry)
+{
+	char path[512], temporaryPath[532];
+	GetFilePath(entry->key, path, sizeof(path));
+	FILE *fp;
+	if (fopen_s(&fp, path, "rb")==0)
+	{
+		// Already written, possibly by another server sharing the directory
+		fclose(fp);
+		return;
+	}
+
+	// Written under another name first, so a partly written file is never read
+	sprintf_s(temporaryPath, "%s.%p.tmp", path, (const void*) entry);
+	if (fopen_s(&fp, temporaryPath, "wb")!=0)
+		return;
+	PatchCacheFileHeader header;
+	memcpy(header.magic, PATCH_CACHE_FILE_MAGIC, sizeof(header.magic));
+	header.keyLength=(uint32_t) entry->key.GetLength();
+	header.dataLength=entry->dataLength;
+	header.fileLength=entry->fileLength;
+	header.patchAlgorithm=entry->patchAlgorithm;
+	bool written = fwrite(&header, sizeof(header), 1, fp)==1 &&
+		fwrite(entry->key.C_String(), header.keyLength, 1, fp)==1 &&
+		fwrite(entry->data, entry->dataLength, 1, fp)==1;
+	written = fclose(fp)==0 && written;
+	if (written==false || rename(temporaryPath, path)!=0)
+		remove(temporaryPath);
+}
+void AutopatcherPatchCache::Touch(Entry *entry)
+{
+	if (head==entry)
+		return;
+
+	// Unlink, if already in the list
+	if (entry->previous)
+		entry->previous->next=entry->next;
+	if (entry->next)
+		entry->next->previous=entry->previous;
+	if (tail==entry)
+		tail=entry->previous;
+
+	entry->previous=0;
+	entry->next=head;
+	if (head)
+		head->previous=entry;
+	head=entry;
+	if (tail==0)
+		tail=entry;
+}
+void AutopatcherPatchCache::RemoveOldEntries(void)
+{
+	Entry *entry = tail;
+	while (entry && memoryUsed>maxMemory)
+	{
+		Entry *previous = entry->previous;
+		if (entry->referenceCount==0)
+			RemoveEntry(entry);
+		entry=previous;
+	}
+}
+void AutopatcherPatchCache::RemoveEntry(Entry *entry)
+{
+	if (entry->previous)
+		entry->previous->next=entry->next;
+	else
+		head=entry->next;
+	if (entry->next)
+		entry->next->previous=entry->previous;
+	else
+		tail=entry->previous;
+
+	entries.Remove(entry->key, _FILE_AND_LINE_);
+	memoryUsed-=entry->dataLength;
+	rakFree_Ex(entry->data, _FILE_AND_LINE_);
+	SLNet::OP_DELETE(entry, _FILE_AND_LINE_);
+}
+
 AutopatcherServer::AutopatcherServer()
 {
 	fileListTransfer=0;
@@ -166,6 +509,15 @@ void AutopatcherServer::CacheMostRecentPatch(const char *applicationName)
 		}
 	}
 }
+void AutopatcherServer::SetPatchCache(unsigned int maxBytes, const char *persistenceDirectory)
+{
+	patchCache.SetPersistenceDirectory(persistenceDirectory);
+	patchCache.SetMaxMemory(maxBytes);
+}
+AutopatcherPatchCache* AutopatcherServer::GetPatchCache(void)
+{
+	return &patchCache;
+}
 void AutopatcherServer::OnAttach(void)
 {
 }
@@ -475,6 +827,158 @@ void AutopatcherServer::OnGetChangelistSinceDateInt(Packet *packet)
 		threadPool.AddInput(GetChangelistSinceDateCB, threadData);
 	}
 }
+namespace SLNet {
+/// Reads the files of one GetPatch request. Patches in the cache are read from there, all other files from the repository.
+/// Deletes itself once the request and every file reference FileListTransfer took were released.
+class AutopatcherPatchCacheReader : public IncrementalReadInterface
+{
+public:
+	AutopatcherPatchCacheReader(AutopatcherPatchCache *_patchCache, AutopatcherRepositoryInterface *_repository)
+	{
+		patchCache=_patchCache;
+		repository=_repository;
+		// Held by GetPatchCB() until FileListTransfer::Send() returned
+		referenceCount=1;
+	}
+	virtual unsigned int GetFilePart( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, void *preallocatedDestination, FileListNodeContext context)
+	{
+		AutopatcherPatchCache::Entry *entry = (AutopatcherPatchCache::Entry *) context.dataPtr;
+		if (entry==0)
+			return repository->GetFilePart(filename, startReadBytes, numBytesToRead, preallocatedDestination, context);
+		unsigned int bytesRead;
+		const char *data = GetFilePartPointer(filename, startReadBytes, numBytesToRead, &bytesRead, context);
+		memcpy(preallocatedDestination, data, bytesRead);
+		return bytesRead;
+	}
+	virtual bool AddFileReference( const char *filename, FileListNodeContext context)
+	{
+		(void) filename;
+		(void) context;
+		referenceMutex.Lock();
+		referenceCount++;
+		referenceMutex.Unlock();
+		return true;
+	}
+	virtual void ReleaseFileReference( const char *filename, FileListNodeContext context)
+	{
+		(void) filename;
+		// The cache reference was taken when the file was added to the patch list
+		if (context.dataPtr)
+			patchCache->Release((AutopatcherPatchCache::Entry *) context.dataPtr);
+		Release();
+	}
+	virtual const char* GetFilePartPointer( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, unsigned int *numBytesRead, FileListNodeContext context)
+	{
+		(void) filename;
+		AutopatcherPatchCache::Entry *entry = (AutopatcherPatchCache::Entry *) context.dataPtr;
+		if (entry==0)
+			return 0;
+		if (startReadBytes >= entry->dataLength)
+			*numBytesRead=0;
+		else if (numBytesToRead > entry->dataLength-startReadBytes)
+			*numBytesRead=entry->dataLength-startReadBytes;
+		else
+			*numBytesRead=numBytesToRead;
+		return entry->data+startReadBytes;
+	}
+	void Release(void)
+	{
+		referenceMutex.Lock();
+		bool deleteThis = --referenceCount==0;
+		referenceMutex.Unlock();
+		if (deleteThis)
+			SLNet::OP_DELETE(this, _FILE_AND_LINE_);
+	}
+
+protected:
+	AutopatcherPatchCache *patchCache;
+	AutopatcherRepositoryInterface *repository;
+	SimpleMutex referenceMutex;
+	unsigned int referenceCount;
+};
+}
+
+// Adds the patches in patchList to the patch cache, and replaces patches the repository would read incrementally with references to the cache
+// Returns the number of patches that are read from the cache
+static unsigned int UsePatchCache(AutopatcherPatchCache *patchCache, const char *applicationName, FileList *clientList, FileList *patchList, AutopatcherRepositoryInterface *repository)
+{
+	unsigned int numCachedPatches=0;
+	unsigned int clientIndex=0;
+	char currentHash[HASH_LENGTH];
+	for (unsigned int i=0; i < patchList->fileList.Size(); i++)
+	{
+		FileListNode &node = patchList->fileList[i];
+		if (node.context.op!=PC_HASH_1_WITH_PATCH || patchCache->CanCache(node.dataLengthBytes)==false)
+			continue;
+
+		// The repository returns a subset of clientList in the same order, so usually this finds the file at clientIndex
+		const char *priorHash=0;
+		for (unsigned int j=0; j < clientList->fileList.Size(); j++)
+		{
+			const FileListNode &clientNode = clientList->fileList[(clientIndex+j) % clientList->fileList.Size()];
+			if (clientNode.filename==node.filename)
+			{
+				if (clientNode.data && clientNode.dataLengthBytes==HASH_LENGTH)
+					priorHash=clientNode.data;
+				clientIndex=(clientIndex+j+1) % clientList->fileList.Size();
+				break;
+			}
+		}
+		if (priorHash==0)
+			continue;
+
+		if (node.isAReference==false)
+		{
+			// Already in memory, so only kept for later requests
+			if (node.data)
+			{
+				AutopatcherPatchCache::Entry *entry = patchCache->Add(applicationName, node.filename.C_String(), priorHash, node.data, node.data, node.dataLengthBytes, node.fileLengthBytes, node.context.flnc_extraData2);
+				if (entry)
+					patchCache->Release(entry);
+			}
+			continue;
+		}
+
+		// The first bytes of the patch are the hash of the patched file
+		if (repository->GetFilePart(node.fullPathToFile, 0, HASH_LENGTH, currentHash, node.context)!=HASH_LENGTH)
+			continue;
+		AutopatcherPatchCache::Entry *entry = patchCache->Get(applicationName, node.filename.C_String(), priorHash, currentHash);
+		if (entry==0)
+		{
+			// Read the whole patch once, rather than once per client
+			char *data = (char*) rakMalloc_Ex(node.dataLengthBytes, _FILE_AND_LINE_);
+			if (data==0)
+				continue;
+			unsigned int chunkSize = (unsigned int) repository->GetIncrementalReadChunkSize();
+			unsigned int bytesRead=0;
+			while (bytesRead < node.dataLengthBytes)
+			{
+				unsigned int bytesToRead = node.dataLengthBytes-bytesRead;
+				if (bytesToRead > chunkSize)
+					bytesToRead=chunkSize;
+				unsigned int result = repository->GetFilePart(node.fullPathToFile, bytesRead, bytesToRead, data+bytesRead, node.context);
+				if (result==0 || result > bytesToRead)
+					break;
+				bytesRead+=result;
+			}
+			if (bytesRead==node.dataLengthBytes)
+				entry = patchCache->Add(applicationName, node.filename.C_String(), priorHash, currentHash, data, node.dataLengthBytes, node.fileLengthBytes, node.context.flnc_extraData2);
+			rakFree_Ex(data, _FILE_AND_LINE_);
+			if (entry==0)
+				continue;
+		}
+
+		// Sent by AutopatcherPatchCacheReader, which releases the entry when done
+		node.dataLengthBytes=entry->dataLength;
+		node.fileLengthBytes=entry->fileLength;
+		node.context=FileListNodeContext(PC_HASH_1_WITH_PATCH, 0, entry->patchAlgorithm, 0);
+		node.context.dataPtr=entry;
+		node.context.dataLength=entry->dataLength;
+		numCachedPatches++;
+	}
+	return numCachedPatches;
+}
+
 namespace SLNet {
 AutopatcherServer::ResultTypeAndBitstream* GetPatchCB(AutopatcherServer::ThreadData threadData, bool *returnOutput, void* perThreadData)
 {
@@ -495,11 +999,22 @@ AutopatcherServer::ResultTypeAndBitstream* GetPatchCB(AutopatcherServer::ThreadD
 	rtab.setId=threadData.setId;
 	rtab.currentDate=(double) time(nullptr);
 
+	unsigned int numCachedPatches=0;
+	if (rtab.resultCode==1 && server->patchCache.IsEnabled())
+		numCachedPatches=UsePatchCache(&server->patchCache, threadData.applicationName.C_String(), threadData.clientList, rtab.patchList, repository);
+
 	SLNet::OP_DELETE(threadData.clientList, _FILE_AND_LINE_);
 
 	if (rtab.resultCode==1)
 	{
-		if (rtab.patchList->fileList.Size())
+		if (numCachedPatches>0)
+		{
+			// Every file that is a reference is read through the reader, which releases the cache entries when sent
+			AutopatcherPatchCacheReader *reader = SLNet::OP_NEW_2<AutopatcherPatchCacheReader>(_FILE_AND_LINE_, &server->patchCache, repository);
+			server->fileListTransfer->Send(rtab.patchList, 0, rtab.systemAddress, rtab.setId, server->priority, server->orderingChannel, reader, repository->GetIncrementalReadChunkSize());
+			reader->Release();
+		}
+		else if (rtab.patchList->fileList.Size())
 		{
 			//server->fileListTransfer->Send(rtab.patchList, 0, rtab.systemAddress, rtab.setId, server->priority, server->orderingChannel, false, server->repository);
 			server->fileListTransfer->Send(rtab.patchList, 0, rtab.systemAddress, rtab.setId, server->priority, server->orderingChannel, repository, repository->GetIncrementalReadChunkSize());
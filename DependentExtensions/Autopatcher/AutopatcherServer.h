@@ -39,6 +39,8 @@
 #include "..\..\Source\include\slikenet\slikeString.h"
 #include "slikenet/FileList.h"
 #include "slikenet/IncrementalReadInterface.h"
+#include "slikenet/SimpleMutex.h"
+#include "slikenet/DS_Hash.h"
 
 namespace SLNet
 {
@@ -156,6 +158,89 @@ public:
 		AutopatcherServerLoadNotifier::AutopatcherState *autopatcherState);
 };
 
+/// \brief Patches shared by all requests of an AutopatcherServer, keyed by the application, the filename, the hash of the file the client has and the hash of the file it is patched to
+/// \details Patches the repository returns are added here, so a patch read for one client is sent from memory to every later client on the same version.
+/// When the memory limit is reached, the least recently used patches that are not being sent are removed.
+/// If a directory is set, patches are also written there and read back when they are not in memory, for example after a restart.
+class RAK_DLL_EXPORT AutopatcherPatchCache
+{
+public:
+	struct Entry
+	{
+		// See GetKey()
+		SLNet::RakString key;
+		// Hash of the file the client has, then the hash the file has after patching
+		char priorHash[4];
+		char currentHash[4];
+		// The hash of the patched file followed by the patch, as sent with PC_HASH_1_WITH_PATCH
+		char *data;
+		unsigned int dataLength;
+		unsigned int fileLength;
+		uint32_t patchAlgorithm;
+		// Entries are not removed while referenced
+		unsigned int referenceCount;
+		Entry *previous, *next;
+	};
+
+	AutopatcherPatchCache();
+	~AutopatcherPatchCache();
+
+	/// \param[in] maxBytes Memory used for patches. Patches larger than a quarter of this are not cached. 0 to disable the cache.
+	void SetMaxMemory(unsigned int maxBytes);
+
+	/// \param[in] directory Where to store patches, which must exist. 0 to only keep patches in memory.
+	void SetPersistenceDirectory(const char *directory);
+
+	/// \return true if SetMaxMemory() was called with a value greater than 0
+	bool IsEnabled(void) const;
+
+	/// \return true if a patch of \a dataLength bytes is small enough to be cached
+	bool CanCache(unsigned int dataLength) const;
+
+	/// Finds a patch in memory, or in the persistence directory
+	/// \return The entry with a reference taken, to be released with Release(), or 0 if not cached
+	Entry* Get(const char *applicationName, const char *filename, const char *priorHash, const char *currentHash);
+
+	/// Copies a patch into the cache. If the patch is already cached, the existing entry is returned.
+	/// \param[in] data The hash of the patched file followed by the patch
+	/// \return The entry with a reference taken, to be released with Release(), or 0 if the patch is too large
+	Entry* Add(const char *applicationName, const char *filename, const char *priorHash, const char *currentHash, const char *data, unsigned int dataLength, unsigned int fileLength, uint32_t patchAlgorithm);
+
+	/// Releases a reference returned by Get() or Add()
+	void Release(Entry *entry);
+
+	/// Removes all patches from memory that are not referenced. Files in the persistence directory are kept.
+	void Clear(void);
+
+	/// \return Bytes of patch data in memory
+	unsigned int GetMemoryUsed(void);
+
+	/// \return How often Get() found a patch, and how often it did not
+	unsigned int GetHitCount(void);
+	unsigned int GetMissCount(void);
+
+protected:
+	// Files with the same content in different applications or under different names may have different patches, so all four are part of the key
+	static SLNet::RakString GetKey(const char *applicationName, const char *filename, const char *priorHash, const char *currentHash);
+	void GetFilePath(const SLNet::RakString &key, char *path, size_t pathLength);
+	bool LoadFromDisk(const SLNet::RakString &key, const char *currentHash, char **data, unsigned int *dataLength, unsigned int *fileLength, uint32_t *patchAlgorithm);
+	void SaveToDisk(const Entry *entry);
+	// Moves to the front of the least recently used list. Requires entriesMutex.
+	void Touch(Entry *entry);
+	// Removes unreferenced entries from the back of the list until within maxMemory. Requires entriesMutex.
+	void RemoveOldEntries(void);
+	void RemoveEntry(Entry *entry);
+
+	SimpleMutex entriesMutex;
+	DataStructures::Hash<SLNet::RakString, Entry*, 4096, SLNet::RakString::ToInteger> entries;
+	// Most recently used first
+	Entry *head, *tail;
+	unsigned int maxMemory;
+	unsigned int memoryUsed;
+	unsigned int hitCount, missCount;
+	SLNet::RakString persistenceDirectory;
+};
+
 /// \brief The server plugin for the autopatcher.  Must be running for the client to get patches.
 class RAK_DLL_EXPORT AutopatcherServer : public PluginInterface2 , public ThreadDataInterface, FileListProgress, IncrementalReadInterface
 {
@@ -185,6 +270,16 @@ public:
 	/// \param[in] applicationName 0 means all, otherwise the name of the application to cache
 	void CacheMostRecentPatch(const char *applicationName);
 
+	/// Keep patches read from the repository in memory, shared by all worker threads, so a patch is only read from the repository once per version
+	/// Unlike CacheMostRecentPatch(), this caches patches from any version to the current one, and the repository is still asked which files to patch on every request
+	/// Sends from the cache must have completed before this instance is destroyed
+	/// \param[in] maxBytes Memory used for patches. 0 to disable, which is the default.
+	/// \param[in] persistenceDirectory If not 0, patches are also written to this directory and read back from it, so they survive a restart
+	void SetPatchCache(unsigned int maxBytes, const char *persistenceDirectory=0);
+
+	/// \return The cache used by SetPatchCache(), for statistics
+	AutopatcherPatchCache* GetPatchCache(void);
+
 	/// What parameters to use for the RakPeerInterface::Send() call when uploading files.
 	/// \param[in] _priority See RakPeerInterface::Send()
 	/// \param[in] _orderingChannel See RakPeerInterface::Send()
@@ -318,6 +413,8 @@ protected:
 	double cache_minTime, cache_maxTime;
 	bool cacheLoaded;
 	bool allowDownloadOfOriginalUnmodifiedFiles;
+
+	AutopatcherPatchCache patchCache;
 };
 
 } // namespace SLNet
@@ -74,11 +74,25 @@ static void errx(int i, ...)
 #include <string.h>
 #include <limits>		// used for std::numeric_limits
 #include <algorithm>	// used for std::max
+#include "CreatePatch.h"
+#include "slikenet/ThreadPool.h"
+#include "slikenet/LocklessTypes.h"
+#include "slikenet/SimpleMutex.h"
+#include "slikenet/SignaledEvent.h"
 
 #ifndef MIN
 #define MIN(x,y) (((x)<(y)) ? (x) : (y))
 #endif
 
+// 64 bit file offsets, since off_t has 32 bits on Windows
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
 #ifndef _O_BINARY
 #define _O_BINARY 0
 #endif
@@ -222,9 +236,10 @@ static off_t search(off_t *I,u_char *old,off_t oldsize,
 	};
 }
 
-static void offtout(off_t x,u_char *buf)
+// Takes 64 bits, since off_t has 32 bits on Windows and the windows of CreatePatchSettings::windowSize may seek further
+static void offtout(int64_t x,u_char *buf)
 {
-	off_t y;
+	int64_t y;
 
 	if(x<0) y=-x; else y=x;
 
@@ -240,124 +255,456 @@ static void offtout(off_t x,u_char *buf)
 	*/
 
 	// Thanks to Oliver Smith for pointing out this optimization
-	buf[0] = (u_char)(y&(off_t)0x000000ff); y >>= 8 ;
-	buf[1] = (u_char)(y&(off_t)0x000000ff); y >>= 8 ;
-	buf[2] = (u_char)(y&(off_t)0x000000ff); y >>= 8 ;
-	buf[3] = (u_char)(y&(off_t)0x000000ff); y >>= 8 ;
-	buf[4] = (u_char)(y&(off_t)0x000000ff); y >>= 8 ;
-	buf[5] = (u_char)(y&(off_t)0x000000ff); y >>= 8 ;
-	buf[6] = (u_char)(y&(off_t)0x000000ff); y >>= 8 ;
-	buf[7] = (u_char)(y&(off_t)0x000000ff);// y >>= 8 ;
+	buf[0] = (u_char)(y&(int64_t)0x000000ff); y >>= 8 ;
+	buf[1] = (u_char)(y&(int64_t)0x000000ff); y >>= 8 ;
+	buf[2] = (u_char)(y&(int64_t)0x000000ff); y >>= 8 ;
+	buf[3] = (u_char)(y&(int64_t)0x000000ff); y >>= 8 ;
+	buf[4] = (u_char)(y&(int64_t)0x000000ff); y >>= 8 ;
+	buf[5] = (u_char)(y&(int64_t)0x000000ff); y >>= 8 ;
+	buf[6] = (u_char)(y&(int64_t)0x000000ff); y >>= 8 ;
+	buf[7] = (u_char)(y&(int64_t)0x000000ff);// y >>= 8 ;
 
 	if(x<0) buf[7]|=0x80;
 }
 
-// This function modifies the main() function included in bsdiff.c of bsdiff-4.3 found at http://www.daemonology.net/bsdiff/
-// It is changed to be a standalone function, to work entirely in memory, and to use my class MemoryCompressor as an interface to BZip
-// Up to the caller to delete out
-static bool CreatePatchInternal(const char *old, off_t oldsize, char *_new, off_t newsize, char **out, unsigned *outSize)
+// Threads used by CreatePatch() with CreatePatchSettings::numThreads > 1
+typedef void (*PatchTask)(void *context, unsigned int threadIndex);
+
+// Counted under the mutex, so that the event is no longer used once RunPatchTask() sees all threads finished
+struct PatchTaskThreadsFinished
 {
-//	int fd;
-//	u_char *old,*new;
-//	off_t oldsize,newsize;
-	off_t *I,*V;
-	off_t scan,len;
-	off_t pos = 0; // #low review whether this really is unnecessary - (presumably) unnecessary assignment - added to workaround false-positive of C4701
-	off_t lastscan,lastpos,lastoffset;
-	off_t oldscore,scsc;
-	off_t s,Sf,lenf,Sb,lenb;
-	off_t overlap,Ss,lens;
-	off_t i;
-	off_t dblen,eblen;
-	u_char *db,*eb;
-	u_char buf[8];
-	u_char header[32];
-	MemoryCompressor patch;
-//	unsigned outWriteOffset;
-//	FILE * pf;
-//	BZFILE * pfbz2;
-//	int bz2err;
+	SLNet::SimpleMutex mutex;
+	unsigned int count;
+	SLNet::SignaledEvent event;
+};
 
+struct PatchTaskInput
+{
+	PatchTask task;
+	void *context;
+	unsigned int threadIndex;
+	PatchTaskThreadsFinished *threadsFinished;
+};
 
-//	if(argc!=4) errx(1,"usage: %s oldfile newfile patchfile\n",argv[0]);
+typedef ThreadPool<PatchTaskInput,int> PatchThreadPool;
 
-	/* Allocate oldsize+1 bytes instead of oldsize bytes to ensure
-		that we never try to malloc(0) and get a nullptr */
-	/*
-	if(((fd=_open(argv[1],O_RDONLY | _O_BINARY ,0))<0) ||
-		((oldsize=_lseek(fd,0,SEEK_END))==-1) ||
-		((old=malloc(oldsize+1))==nullptr) ||
-		(_lseek(fd,0,SEEK_SET)!=0) ||
-		(_read(fd,old,oldsize)!=oldsize) ||
-		(_close(fd)==-1)) err(1,"%s",argv[1]);
-		*/
+static int PatchWorkerThread(PatchTaskInput input, bool *returnOutput, void* perThreadData)
+{
+	(void) perThreadData;
+	input.task(input.context, input.threadIndex);
+	input.threadsFinished->mutex.Lock();
+	input.threadsFinished->count++;
+	input.threadsFinished->event.SetEvent();
+	input.threadsFinished->mutex.Unlock();
+	*returnOutput=false;
+	return 0;
+}
 
-	if(((I=(off_t*)malloc((oldsize+1)*sizeof(off_t)))== nullptr) ||
-		((V=(off_t*)malloc((oldsize+1)*sizeof(off_t)))== nullptr))
-		// err(1,nullptr);
-			return false;
+// Calls task on the calling thread and each thread of threadPool, and returns once all calls returned
+static void RunPatchTask(PatchThreadPool *threadPool, unsigned int numThreads, PatchTask task, void *context)
+{
+	PatchTaskThreadsFinished threadsFinished;
+	PatchTaskInput input;
+	unsigned int i;
+	bool allFinished;
 
-	qsufsort(I,V,(u_char*)old,oldsize);
+	if (numThreads <= 1)
+	{
+		task(context, 0);
+		return;
+	}
 
-	free(V);
+	threadsFinished.count=1;
+	threadsFinished.event.InitEvent();
+	input.task=task;
+	input.context=context;
+	input.threadsFinished=&threadsFinished;
+	for (i=1; i < numThreads; i++)
+	{
+		input.threadIndex=i;
+		threadPool->AddInput(PatchWorkerThread, input);
+	}
+	task(context, 0);
 
-	/* Allocate newsize+1 bytes instead of newsize bytes to ensure
-		that we never try to malloc(0) and get a nullptr */
-	/*
-	if(((fd=_open(argv[2],O_RDONLY | _O_BINARY ,0))<0) ||
-		((newsize=_lseek(fd,0,SEEK_END))==-1) ||
-		((new=malloc(newsize+1))==nullptr) ||
-		(_lseek(fd,0,SEEK_SET)!=0) ||
-		(_read(fd,new,newsize)!=newsize) ||
-		(_close(fd)==-1)) err(1,"%s",argv[2]);
+	for (;;)
+	{
+		threadsFinished.mutex.Lock();
+		allFinished=threadsFinished.count==numThreads;
+		threadsFinished.mutex.Unlock();
+		if (allFinished)
+			break;
+		threadsFinished.event.WaitOnEvent(1000);
+	}
+	threadsFinished.event.CloseEvent();
+}
 
-		*/
+// Hands out the indices 0 to numItems-1 to the threads running a task
+struct PatchWorkQueue
+{
+	void Reset(uint32_t count)
+	{
+		nextItem=0;
+		numItems=count;
+	}
+	bool Get(uint32_t *index)
+	{
+		mutex.Lock();
+		*index=nextItem;
+		if (nextItem < numItems)
+			nextItem++;
+		mutex.Unlock();
+		return *index < numItems;
+	}
 
-	if(((db=(u_char*)malloc(newsize+1))== nullptr) ||
-		((eb=(u_char*)malloc(newsize+1))== nullptr))
-		// err(1,nullptr);
+	SLNet::SimpleMutex mutex;
+	uint32_t nextItem;
+	uint32_t numItems;
+};
+
+// Parallel version of qsufsort(), using prefix doubling like Larsson and Sadakane.
+// Groups of suffixes with the same first h bytes are sorted by the rank of the suffix h bytes further.
+// The groups are sorted in parallel. Ranks are only updated after all groups of a pass were sorted, so the threads never read data another thread writes.
+struct SuffixGroup
+{
+	off_t start;
+	off_t length;
+};
+
+struct SuffixKey
+{
+	off_t rank;
+	off_t suffix;
+};
+
+// Quicksort with three way partitioning, like split(). Most keys of a group are often equal, for example in long runs of the same byte.
+static void SortSuffixKeys(SuffixKey *keys,off_t length)
+{
+	SuffixKey tmp;
+	off_t i,j,lt,gt,x;
+
+	while(length>16) {
+		x=keys[length/2].rank;
+		lt=0;i=0;gt=length;
+		while(i<gt) {
+			if(keys[i].rank<x) {
+				tmp=keys[lt];keys[lt]=keys[i];keys[i]=tmp;
+				lt++;i++;
+			} else if(keys[i].rank>x) {
+				gt--;
+				tmp=keys[gt];keys[gt]=keys[i];keys[i]=tmp;
+			} else {
+				i++;
+			};
+		};
+
+		// Recurse into the smaller part, so the stack depth is logarithmic
+		if(lt<length-gt) {
+			SortSuffixKeys(keys,lt);
+			keys+=gt;length-=gt;
+		} else {
+			SortSuffixKeys(keys+gt,length-gt);
+			length=lt;
+		};
+	};
+
+	for(i=1;i<length;i++) {
+		tmp=keys[i];
+		for(j=i;j>0&&keys[j-1].rank>tmp.rank;j--) keys[j]=keys[j-1];
+		keys[j]=tmp;
+	};
+}
+
+struct SuffixSortThreadData
+{
+	SuffixKey *keys;
+	off_t keysAllocated;
+	// Unsorted groups found in the current pass
+	SuffixGroup *groups;
+	off_t numGroups;
+	off_t groupsAllocated;
+	bool outOfMemory;
+};
+
+struct SuffixSortContext
+{
+	// I[i] is the i-th smallest suffix. V[i] is the position of the first suffix in I with the same first h bytes as suffix i
+	off_t *I, *V;
+	// Non-zero where a group starts, for the positions in I sorted in the current pass
+	u_char *groupHeads;
+	off_t h;
+	SuffixGroup *groups;
+	off_t numGroups;
+	// Groups batches[i] to batches[i+1]-1 are sorted by the same thread
+	off_t *batches;
+	off_t numBatches;
+	PatchWorkQueue workQueue;
+	SuffixSortThreadData *threadData;
+};
+
+static void SortSuffixGroups(void *context, unsigned int threadIndex)
+{
+	SuffixSortContext *sortContext=(SuffixSortContext*)context;
+	SuffixSortThreadData *threadData=sortContext->threadData+threadIndex;
+	off_t *I=sortContext->I, *V=sortContext->V;
+	off_t h=sortContext->h;
+	uint32_t batch;
+	off_t groupIndex, i, start, length;
+
+	while (sortContext->workQueue.Get(&batch))
+	{
+		for (groupIndex=sortContext->batches[batch]; groupIndex < sortContext->batches[batch+1]; groupIndex++)
 		{
-			free(I);
+			start=sortContext->groups[groupIndex].start;
+			length=sortContext->groups[groupIndex].length;
+			if (length > threadData->keysAllocated)
+			{
+				SuffixKey *keys=(SuffixKey*)realloc(threadData->keys, length*sizeof(SuffixKey));
+				if (keys== nullptr)
+				{
+					threadData->outOfMemory=true;
+					return;
+				}
+				threadData->keys=keys;
+				threadData->keysAllocated=length;
+			}
+
+			// Suffixes in a group with more than one suffix are at least h bytes long, so I[start+i]+h <= oldsize
+			for (i=0; i < length; i++)
+			{
+				threadData->keys[i].suffix=I[start+i];
+				threadData->keys[i].rank=V[I[start+i]+h];
+			}
+			SortSuffixKeys(threadData->keys, length);
+			for (i=0; i < length; i++)
+			{
+				I[start+i]=threadData->keys[i].suffix;
+				sortContext->groupHeads[start+i]=(u_char)(i==0 || threadData->keys[i].rank!=threadData->keys[i-1].rank);
+			}
+		}
+	}
+}
+
+static bool AddSuffixGroup(SuffixSortThreadData *threadData, off_t start, off_t length)
+{
+	if (threadData->numGroups==threadData->groupsAllocated)
+	{
+		off_t groupsAllocated=threadData->groupsAllocated ? threadData->groupsAllocated*2 : 1024;
+		SuffixGroup *groups=(SuffixGroup*)realloc(threadData->groups, groupsAllocated*sizeof(SuffixGroup));
+		if (groups== nullptr)
+		{
+			threadData->outOfMemory=true;
 			return false;
 		}
+		threadData->groups=groups;
+		threadData->groupsAllocated=groupsAllocated;
+	}
+	threadData->groups[threadData->numGroups].start=start;
+	threadData->groups[threadData->numGroups].length=length;
+	threadData->numGroups++;
+	return true;
+}
 
-	dblen=0;
-	eblen=0;
+static void RankSuffixGroups(void *context, unsigned int threadIndex)
+{
+	SuffixSortContext *sortContext=(SuffixSortContext*)context;
+	SuffixSortThreadData *threadData=sortContext->threadData+threadIndex;
+	uint32_t batch;
+	off_t groupIndex, i, end, head;
 
-	/* Create the patch file */
-//	if (fopen_s(&pf, argv[3], "wb") !=0)
-//		err(1, "%s", argv[3]);
+	while (sortContext->workQueue.Get(&batch))
+	{
+		for (groupIndex=sortContext->batches[batch]; groupIndex < sortContext->batches[batch+1]; groupIndex++)
+		{
+			head=sortContext->groups[groupIndex].start;
+			end=head+sortContext->groups[groupIndex].length;
+			for (i=head; i < end; i++)
+			{
+				if (sortContext->groupHeads[i])
+				{
+					if (i-head>1 && AddSuffixGroup(threadData, head, i-head)==false)
+						return;
+					head=i;
+				}
+				sortContext->V[sortContext->I[i]]=head;
+			}
+			if (end-head>1 && AddSuffixGroup(threadData, head, end-head)==false)
+				return;
+		}
+	}
+}
 
-	/* Header is
-		0	8	 "BSDIFF40"
-		8	8	length of bzip2ed ctrl block
-		16	8	length of bzip2ed diff block
-		24	8	length of new file */
-	/* File is
-		0	32	Header
-		32	??	Bzip2ed ctrl block
-		??	??	Bzip2ed diff block
-		??	??	Bzip2ed extra block */
+static bool ParallelSuffixSort(off_t *I,off_t *V,const u_char *old,off_t oldsize,PatchThreadPool *threadPool,unsigned int numThreads)
+{
+	// Two byte keys, 0 for the end of the data
+	const off_t numKeys=257*257;
+	SuffixSortContext sortContext;
+	off_t *bucketStarts, *bucketPositions;
+	off_t i, key, numSuffixes, batchSize, batchLength;
+	unsigned int threadIndex;
+	bool success=true;
+
+	bucketStarts=(off_t*)calloc(numKeys, sizeof(off_t));
+	bucketPositions=(off_t*)malloc(numKeys*sizeof(off_t));
+	sortContext.groupHeads=(u_char*)malloc(oldsize+1);
+	sortContext.threadData=(SuffixSortThreadData*)calloc(numThreads, sizeof(SuffixSortThreadData));
+	sortContext.groups=nullptr;
+	sortContext.batches=nullptr;
+	if (bucketStarts== nullptr || bucketPositions== nullptr || sortContext.groupHeads== nullptr || sortContext.threadData== nullptr)
+	{
+		free(bucketStarts);
+		free(bucketPositions);
+		free(sortContext.groupHeads);
+		free(sortContext.threadData);
+		return false;
+	}
+	sortContext.I=I;
+	sortContext.V=V;
+
+	// Bucket sort by the first two bytes. The empty suffix comes first.
+	for(i=0;i<oldsize;i++) bucketStarts[(old[i]+1)*257+(i+1<oldsize ? old[i+1]+1 : 0)]++;
+	numSuffixes=1;
+	for(key=0;key<numKeys;key++) {
+		bucketPositions[key]=numSuffixes;
+		numSuffixes+=bucketStarts[key];
+		bucketStarts[key]=bucketPositions[key];
+	};
+	for(i=0;i<oldsize;i++) {
+		key=(old[i]+1)*257+(i+1<oldsize ? old[i+1]+1 : 0);
+		I[bucketPositions[key]++]=i;
+		V[i]=bucketStarts[key];
+	};
+	I[0]=oldsize;
+	V[oldsize]=0;
+	for(key=0;key<numKeys;key++) {
+		if (bucketPositions[key]-bucketStarts[key]>1 && AddSuffixGroup(sortContext.threadData, bucketStarts[key], bucketPositions[key]-bucketStarts[key])==false)
+			success=false;
+	};
+	free(bucketStarts);
+	free(bucketPositions);
+
+	for(sortContext.h=2;success;sortContext.h+=sortContext.h) {
+		// Take the groups found by all threads in the last pass
+		sortContext.numGroups=0;
+		for (threadIndex=0; threadIndex < numThreads; threadIndex++)
+			sortContext.numGroups+=sortContext.threadData[threadIndex].numGroups;
+		if (sortContext.numGroups==0)
+			break;
+		free(sortContext.groups);
+		free(sortContext.batches);
+		sortContext.groups=(SuffixGroup*)malloc(sortContext.numGroups*sizeof(SuffixGroup));
+		sortContext.batches=(off_t*)malloc((sortContext.numGroups+1)*sizeof(off_t));
+		if (sortContext.groups== nullptr || sortContext.batches== nullptr)
+		{
+			success=false;
+			break;
+		}
+		numSuffixes=0;
+		sortContext.numGroups=0;
+		for (threadIndex=0; threadIndex < numThreads; threadIndex++)
+		{
+			for (i=0; i < sortContext.threadData[threadIndex].numGroups; i++)
+			{
+				sortContext.groups[sortContext.numGroups++]=sortContext.threadData[threadIndex].groups[i];
+				numSuffixes+=sortContext.threadData[threadIndex].groups[i].length;
+			}
+			sortContext.threadData[threadIndex].numGroups=0;
+		}
 
-	memcpy(header,"BSDIFF40",8);
-	offtout(0, header + 8);
-	offtout(0, header + 16);
-	offtout(newsize, header + 24);
-//	if (fwrite(header, 32, 1, pf) != 1)
-//		err(1, "fwrite(%s)", argv[3]);
+		// Give each thread several batches, so threads that got large groups do not hold up the others
+		batchSize=numSuffixes/(numThreads*16);
+		if (batchSize < 4096)
+			batchSize=4096;
+		sortContext.numBatches=0;
+		batchLength=0;
+		for (i=0; i < sortContext.numGroups; i++)
+		{
+			if (batchLength==0)
+				sortContext.batches[sortContext.numBatches++]=i;
+			batchLength+=sortContext.groups[i].length;
+			if (batchLength>=batchSize)
+				batchLength=0;
+		}
+		sortContext.batches[sortContext.numBatches]=sortContext.numGroups;
 
-	// Allocate enough to hold any output
-//	*out = (char*) malloc(oldsize+newsize);
-	// Copy out the header
-//	memcpy(*out, header, 32);
-	//outWriteOffset=32;
+		sortContext.workQueue.Reset((uint32_t)sortContext.numBatches);
+		RunPatchTask(threadPool, numThreads, SortSuffixGroups, &sortContext);
+		sortContext.workQueue.Reset((uint32_t)sortContext.numBatches);
+		RunPatchTask(threadPool, numThreads, RankSuffixGroups, &sortContext);
 
-	/* Compute the differences, writing ctrl as we go */
-//	if ((pfbz2 = BZ2_bzWriteOpen(&bz2err, pf, 9, 0, 0)) == nullptr)
-//		errx(1, "BZ2_bzWriteOpen, bz2err = %d", bz2err);
+		for (threadIndex=0; threadIndex < numThreads; threadIndex++)
+		{
+			if (sortContext.threadData[threadIndex].outOfMemory)
+				success=false;
+		}
+	};
+
+	for (threadIndex=0; threadIndex < numThreads; threadIndex++)
+	{
+		free(sortContext.threadData[threadIndex].keys);
+		free(sortContext.threadData[threadIndex].groups);
+	}
+	free(sortContext.threadData);
+	free(sortContext.groups);
+	free(sortContext.batches);
+	free(sortContext.groupHeads);
+	return success;
+}
+
+// Appends ctrl data to a buffer that grows as needed
+struct PatchCtrlBuffer
+{
+	u_char *data;
+	off_t length;
+	off_t allocated;
+};
+
+// Makes room for length more bytes
+static bool ReserveCtrl(PatchCtrlBuffer *ctrl,off_t length)
+{
+	if (ctrl->length+length > ctrl->allocated)
+	{
+		off_t allocated=ctrl->allocated ? ctrl->allocated*2 : 24*256;
+		while (allocated < ctrl->length+length)
+			allocated*=2;
+		u_char *data=(u_char*)realloc(ctrl->data, allocated);
+		if (data== nullptr)
+			return false;
+		ctrl->data=data;
+		ctrl->allocated=allocated;
+	}
+	return true;
+}
+
+static bool WriteCtrl(PatchCtrlBuffer *ctrl,int64_t x)
+{
+	if (ReserveCtrl(ctrl, 8)==false)
+		return false;
+	offtout(x, ctrl->data+ctrl->length);
+	ctrl->length+=8;
+	return true;
+}
+
+// The difference loop of bsdiff, for the newsize bytes at _new.
+// old holds the oldsize bytes of the old file starting at oldWindowStart, which are all of it unless CreatePatchSettings::windowSize is used, and I is their suffix array.
+// The first ctrl triple continues from startOldPos. If endOldPos is not -1, the last triple seeks to it, so the patch of the next window can start from there. Both are positions in the old file.
+static bool DiffWindow(off_t *I,const u_char *old,off_t oldsize,int64_t oldWindowStart,
+		const u_char *_new,off_t newsize,int64_t startOldPos,int64_t endOldPos,
+		PatchCtrlBuffer *ctrl,u_char *db,off_t *dblen,u_char *eb,off_t *eblen)
+{
+	off_t scan,len;
+	off_t pos = 0;
+	off_t lastscan,lastpos,lastoffset;
+	off_t oldscore,scsc;
+	off_t s,Sf,lenf,Sb,lenb;
+	off_t overlap,Ss,lens;
+	off_t i;
+	int64_t seek;
+
+	*dblen=0;
+	*eblen=0;
 
 	scan=0;len=0;
-	lastscan=0;lastpos=0;lastoffset=0;
+	lastscan=0;lastpos=(off_t)(startOldPos-oldWindowStart);lastoffset=lastpos;
 	while(scan<newsize) {
 		oldscore=0;
 
@@ -411,48 +758,22 @@ static bool CreatePatchInternal(const char *old, off_t oldsize, char *_new, off_
 			};
 
 			for(i=0;i<lenf;i++)
-				db[dblen+i]=_new[lastscan+i]-old[lastpos+i];
+				db[*dblen+i]=_new[lastscan+i]-old[lastpos+i];
 			for(i=0;i<(scan-lenb)-(lastscan+lenf);i++)
-				eb[eblen+i]=_new[lastscan+lenf+i];
-
-			dblen+=lenf;
-			eblen+=(scan-lenb)-(lastscan+lenf);
-
-			offtout(lenf,buf);
-			if (patch.Compress((char*)buf, 8, false)==false)
-			{
-				free(db);
-				free(eb);
-				free(I);
+				eb[*eblen+i]=_new[lastscan+lenf+i];
+
+			*dblen+=lenf;
+			*eblen+=(scan-lenb)-(lastscan+lenf);
+
+			// The seek to endOldPos may leave the part of the old file in memory
+			if (scan==newsize && endOldPos!=-1)
+				seek=endOldPos-(oldWindowStart+lastpos+lenf);
+			else
+				seek=(pos-lenb)-(lastpos+lenf);
+			if (WriteCtrl(ctrl, lenf)==false ||
+				WriteCtrl(ctrl, (scan-lenb)-(lastscan+lenf))==false ||
+				WriteCtrl(ctrl, seek)==false)
 				return false;
-			}
-			//BZ2_bzWrite(&bz2err, pfbz2, buf, 8);
-			//if (bz2err != BZ_OK)
-			//	errx(1, "BZ2_bzWrite, bz2err = %d", bz2err);
-
-			offtout((scan-lenb)-(lastscan+lenf),buf);
-			if (patch.Compress((char*)buf, 8, false)==false)
-			{
-				free(db);
-				free(eb);
-				free(I);
-				return false;
-			}
-			//BZ2_bzWrite(&bz2err, pfbz2, buf, 8);
-			//if (bz2err != BZ_OK)
-			//	errx(1, "BZ2_bzWrite, bz2err = %d", bz2err);
-
-			offtout((pos-lenb)-(lastpos+lenf),buf);
-			if (patch.Compress((char*)buf, 8, false)==false)
-			{
-				free(db);
-				free(eb);
-				free(I);
-				return false;
-			}
-			//BZ2_bzWrite(&bz2err, pfbz2, buf, 8);
-			//if (bz2err != BZ_OK)
-			//	errx(1, "BZ2_bzWrite, bz2err = %d", bz2err);
 
 			lastscan=scan-lenb;
 			lastpos=pos-lenb;
@@ -460,102 +781,732 @@ static bool CreatePatchInternal(const char *old, off_t oldsize, char *_new, off_
 		};
 	};
 
-//	BZ2_bzWriteClose(&bz2err, pfbz2, 0, nullptr, nullptr);
-//	if (bz2err != BZ_OK)
-//		errx(1, "BZ2_bzWriteClose, bz2err = %d", bz2err);
+	return true;
+}
+
+// The ctrl, diff and extra blocks are compressed in chunks of at most this many bytes, so the chunks can be compressed in parallel.
+// bzip2's run length encoding grows data by at most 25%, so each chunk still fits into one 900K block, which makes it possible to join the chunks into a single stream.
+#define PATCH_COMPRESSION_CHUNK_SIZE 700000
 
-	/* Compute size of compressed ctrl data */
-//	if ((len = ftello(pf)) == -1)
-//		err(1, "ftello");
-	if (patch.Compress(0,0,true)==false)
+// bzip2 stream with one block
+struct CompressedChunk
+{
+	char *data;
+	unsigned size;
+};
+
+struct CompressedChunkList
+{
+	CompressedChunk *chunks;
+	unsigned numChunks;
+};
+
+static void FreeChunks(CompressedChunkList *chunkList)
+{
+	unsigned i;
+	for (i=0; i < chunkList->numChunks; i++)
+		free(chunkList->chunks[i].data);
+	free(chunkList->chunks);
+	chunkList->chunks=nullptr;
+	chunkList->numChunks=0;
+}
+
+static bool CompressChunk(const u_char *data, off_t length, CompressedChunk *chunk)
+{
+	MemoryCompressor compressor;
+
+	chunk->data=nullptr;
+	chunk->size=0;
+	if (compressor.Compress((char*)data, (unsigned)length, true)==false)
+		return false;
+	chunk->data=(char*)malloc(compressor.GetTotalOutputSize());
+	if (chunk->data== nullptr)
+		return false;
+	memcpy(chunk->data, compressor.GetOutput(), compressor.GetTotalOutputSize());
+	chunk->size=compressor.GetTotalOutputSize();
+	return true;
+}
+
+static bool AllocateChunks(off_t length, CompressedChunkList *chunkList)
+{
+	chunkList->numChunks=(unsigned)((length+PATCH_COMPRESSION_CHUNK_SIZE-1)/PATCH_COMPRESSION_CHUNK_SIZE);
+	chunkList->chunks=(CompressedChunk*)calloc(chunkList->numChunks+1, sizeof(CompressedChunk));
+	return chunkList->chunks!=nullptr;
+}
+
+// Compresses the chunks of data on the calling thread
+static bool CompressChunks(const u_char *data, off_t length, CompressedChunkList *chunkList)
+{
+	unsigned i;
+
+	if (AllocateChunks(length, chunkList)==false)
+		return false;
+	for (i=0; i < chunkList->numChunks; i++)
 	{
-		free(db);
-		free(eb);
-		free(I);
+		if (CompressChunk(data+(off_t)i*PATCH_COMPRESSION_CHUNK_SIZE, MIN(length-(off_t)i*PATCH_COMPRESSION_CHUNK_SIZE, PATCH_COMPRESSION_CHUNK_SIZE), chunkList->chunks+i)==false)
+			return false;
+	}
+	return true;
+}
+
+struct ParallelCompressContext
+{
+	const u_char *data;
+	off_t length;
+	CompressedChunkList *chunkList;
+	PatchWorkQueue workQueue;
+	SLNet::LocklessUint32_t numFailed;
+};
+
+static void CompressChunksTask(void *context, unsigned int threadIndex)
+{
+	ParallelCompressContext *compressContext=(ParallelCompressContext*)context;
+	off_t offset;
+	uint32_t i;
+
+	(void) threadIndex;
+	while (compressContext->workQueue.Get(&i))
+	{
+		offset=(off_t)i*PATCH_COMPRESSION_CHUNK_SIZE;
+		if (CompressChunk(compressContext->data+offset, MIN(compressContext->length-offset, PATCH_COMPRESSION_CHUNK_SIZE), compressContext->chunkList->chunks+i)==false)
+			compressContext->numFailed.Increment();
+	}
+}
+
+// Same as CompressChunks(), using all threads
+static bool ParallelCompressChunks(const u_char *data, off_t length, CompressedChunkList *chunkList, PatchThreadPool *threadPool, unsigned int numThreads)
+{
+	ParallelCompressContext compressContext;
+
+	if (AllocateChunks(length, chunkList)==false)
 		return false;
+	compressContext.data=data;
+	compressContext.length=length;
+	compressContext.chunkList=chunkList;
+	compressContext.workQueue.Reset(chunkList->numChunks);
+	RunPatchTask(threadPool, numThreads, CompressChunksTask, &compressContext);
+	return compressContext.numFailed.GetValue()==0;
+}
+
+static uint64_t ReadBzip2Bits(const u_char *data, uint64_t bitOffset, int numBits)
+{
+	uint64_t value=0;
+	int i;
+	for (i=0; i < numBits; i++, bitOffset++)
+		value=(value<<1) | ((data[bitOffset>>3]>>(7-(bitOffset&7)))&1);
+	return value;
+}
+
+// Writes numBits from data to output at outputBits, which must be zero. data must start on a byte boundary.
+static void WriteBzip2Bits(u_char *output, uint64_t *outputBits, const u_char *data, uint64_t numBits)
+{
+	const unsigned int shift=(unsigned int)(*outputBits&7);
+	u_char *out=output+(*outputBits>>3);
+	u_char byte;
+
+	*outputBits+=numBits;
+	for (; numBits > 0; data++, out++)
+	{
+		byte=*data;
+		if (numBits < 8)
+		{
+			byte&=(u_char)(0xFF<<(8-numBits));
+			numBits=0;
+		}
+		else
+			numBits-=8;
+		out[0]|=(u_char)(byte>>shift);
+		if (shift)
+			out[1]|=(u_char)(byte<<(8-shift));
 	}
-	len=patch.GetTotalOutputSize()+32; // test: len should be 188
-	offtout(len-32, header + 8);
-	//memcpy(*out+outWriteOffset, patch.GetOutput(), patch.GetTotalOutputSize());
-	//outWriteOffset+=patch.GetTotalOutputSize();
-	//patch.Clear(_FILE_AND_LINE_);
-	
+}
 
-	/* Write compressed diff data */
-//	if ((pfbz2 = BZ2_bzWriteOpen(&bz2err, pf, 9, 0, 0)) == nullptr)
-//		errx(1, "BZ2_bzWriteOpen, bz2err = %d", bz2err);
-//	BZ2_bzWrite(&bz2err, pfbz2, db, dblen);
-	if (patch.Compress((char*)db,dblen,true)==false)
+// Finds the bits of the block of a chunk, between the stream header and the end of stream marker
+static bool GetChunkBlock(const CompressedChunk *chunk, uint64_t *blockBits, uint32_t *blockCRC)
+{
+	static const u_char blockMagic[6]={0x31,0x41,0x59,0x26,0x53,0x59};
+	const uint64_t endOfStreamMagic=0x177245385090ULL;
+	const u_char *data=(const u_char*)chunk->data;
+	uint64_t endOfStream;
+	unsigned padding;
+
+	if (chunk->size < 4+6+4+10 || memcmp(data, "BZh9", 4)!=0 || memcmp(data+4, blockMagic, 6)!=0)
+		return false;
+	*blockCRC=((uint32_t)data[10]<<24) | ((uint32_t)data[11]<<16) | ((uint32_t)data[12]<<8) | data[13];
+
+	// The end of stream marker is followed by the stream CRC, which is the block CRC for one block, and up to 7 bits of padding
+	for (padding=0; padding < 8; padding++)
+	{
+		endOfStream=(uint64_t)chunk->size*8-padding-80;
+		if (ReadBzip2Bits(data, endOfStream, 48)==endOfStreamMagic && ReadBzip2Bits(data, endOfStream+48, 32)==*blockCRC)
+		{
+			*blockBits=endOfStream-32;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void GetStreamTrailer(uint32_t streamCRC, u_char *trailer)
+{
+	trailer[0]=0x17; trailer[1]=0x72; trailer[2]=0x45; trailer[3]=0x38; trailer[4]=0x50; trailer[5]=0x90;
+	trailer[6]=(u_char)(streamCRC>>24); trailer[7]=(u_char)(streamCRC>>16); trailer[8]=(u_char)(streamCRC>>8); trailer[9]=(u_char)streamCRC;
+}
+
+// Joins the streams of chunkList into one bzip2 stream, as if the data of all chunks had been compressed at once.
+// The blocks are copied bit by bit, and the stream CRC is combined from the block CRCs. This way patches are read by ApplyPatch() of any version.
+static bool JoinChunks(const CompressedChunkList *chunkList, u_char **output, off_t *outputSize)
+{
+	u_char trailer[10];
+	uint64_t outputBits, blockBits;
+	uint32_t blockCRC, streamCRC;
+	unsigned i;
+	off_t allocated;
+
+	if (chunkList->numChunks==0)
+	{
+		CompressedChunk emptyStream;
+		if (CompressChunk(nullptr, 0, &emptyStream)==false)
+			return false;
+		*output=(u_char*)emptyStream.data;
+		*outputSize=emptyStream.size;
+		return true;
+	}
+
+	allocated=4+sizeof(trailer)+1;
+	for (i=0; i < chunkList->numChunks; i++)
+		allocated+=chunkList->chunks[i].size;
+	*output=(u_char*)calloc(allocated, 1);
+	if (*output== nullptr)
+		return false;
+
+	memcpy(*output, "BZh9", 4);
+	outputBits=32;
+	streamCRC=0;
+	for (i=0; i < chunkList->numChunks; i++)
+	{
+		if (GetChunkBlock(chunkList->chunks+i, &blockBits, &blockCRC)==false)
+		{
+			free(*output);
+			return false;
+		}
+		WriteBzip2Bits(*output, &outputBits, (const u_char*)chunkList->chunks[i].data+4, blockBits);
+		streamCRC=((streamCRC<<1) | (streamCRC>>31)) ^ blockCRC;
+	}
+
+	GetStreamTrailer(streamCRC, trailer);
+	WriteBzip2Bits(*output, &outputBits, trailer, 80);
+	*outputSize=(off_t)((outputBits+7)/8);
+	return true;
+}
+
+// Writes the patch file, from the already compressed blocks
+static bool WritePatch(const u_char *ctrl, off_t ctrlSize, const u_char *diff, off_t diffSize, const u_char *extra, off_t extraSize, off_t newsize, char **out, unsigned *outSize)
+{
+	u_char header[32];
+
+	if ((uint64_t)ctrlSize+(uint64_t)diffSize+(uint64_t)extraSize+32 > std::numeric_limits<unsigned>::max())
+		return false;
+
+	/* Header is
+		0	8	 "BSDIFF40"
+		8	8	length of bzip2ed ctrl block
+		16	8	length of bzip2ed diff block
+		24	8	length of new file */
+	/* File is
+		0	32	Header
+		32	??	Bzip2ed ctrl block
+		??	??	Bzip2ed diff block
+		??	??	Bzip2ed extra block */
+	memcpy(header,"BSDIFF40",8);
+	offtout(ctrlSize, header + 8);
+	offtout(diffSize, header + 16);
+	offtout(newsize, header + 24);
+
+	*outSize=(unsigned)(32+ctrlSize+diffSize+extraSize);
+	*out = new char [*outSize];
+	memcpy(*out, header, 32);
+	memcpy(*out+32, ctrl, ctrlSize);
+	memcpy(*out+32+ctrlSize, diff, diffSize);
+	memcpy(*out+32+ctrlSize+diffSize, extra, extraSize);
+	return true;
+}
+
+// Compresses and writes the patch when all of old and _new were diffed at once
+static bool WriteParallelPatch(const PatchCtrlBuffer *ctrl, const u_char *db, off_t dblen, const u_char *eb, off_t eblen, off_t newsize, char **out, unsigned *outSize,
+							   PatchThreadPool *threadPool, unsigned int numThreads)
+{
+	CompressedChunkList chunkLists[3];
+	u_char *blocks[3];
+	off_t blockSizes[3];
+	bool success;
+	int i;
+
+	memset(chunkLists, 0, sizeof(chunkLists));
+	memset(blocks, 0, sizeof(blocks));
+	success=ParallelCompressChunks(ctrl->data, ctrl->length, chunkLists+0, threadPool, numThreads) &&
+		ParallelCompressChunks(db, dblen, chunkLists+1, threadPool, numThreads) &&
+		ParallelCompressChunks(eb, eblen, chunkLists+2, threadPool, numThreads);
+	for (i=0; i < 3 && success; i++)
+		success=JoinChunks(chunkLists+i, blocks+i, blockSizes+i);
+	if (success)
+		success=WritePatch(blocks[0], blockSizes[0], blocks[1], blockSizes[1], blocks[2], blockSizes[2], newsize, out, outSize);
+	for (i=0; i < 3; i++)
+	{
+		FreeChunks(chunkLists+i);
+		free(blocks[i]);
+	}
+	return success;
+}
+
+// Reads the windows of CreatePatchSettings::windowSize from memory, or from a file
+struct PatchInputFile
+{
+	// Read from fp if nullptr
+	const u_char *data;
+	FILE *fp;
+	int64_t size;
+	// The threads share fp
+	SLNet::SimpleMutex mutex;
+};
+
+static bool ReadPatchInput(PatchInputFile *input, int64_t offset, u_char *buffer, off_t length)
+{
+	bool success;
+
+	if (input->data)
+	{
+		memcpy(buffer, input->data+offset, length);
+		return true;
+	}
+	input->mutex.Lock();
+	success=fseek64(input->fp, offset, SEEK_SET)==0 && fread(buffer, 1, length, input->fp)==(size_t)length;
+	input->mutex.Unlock();
+	return success;
+}
+
+static FILE* OpenTemporaryFile(void)
+{
+#ifdef _WIN32
+	FILE *fp;
+	return tmpfile_s(&fp)==0 ? fp : nullptr;
+#else
+	return tmpfile();
+#endif
+}
+
+static bool AppendFile(FILE *source, FILE *destination)
+{
+	const size_t bufferSize=1024*1024;
+	char *buffer;
+	size_t length;
+	bool success;
+
+	buffer=(char*)malloc(bufferSize);
+	if (buffer== nullptr || fseek64(source, 0, SEEK_SET)!=0)
+	{
+		free(buffer);
+		return false;
+	}
+	success=true;
+	while (success && (length=fread(buffer, 1, bufferSize, source)) > 0)
+		success=fwrite(buffer, 1, length, destination)==length;
+	success=success && ferror(source)==0;
+	free(buffer);
+	return success;
+}
+
+// Writes chunks to a file as one bzip2 stream, the same way JoinChunks() joins them in memory
+struct Bzip2StreamWriter
+{
+	FILE *fp;
+	int64_t size;
+	// Bits that do not fill a byte yet
+	u_char pendingByte;
+	unsigned int pendingBits;
+	uint32_t streamCRC;
+};
+
+static bool WriteStreamBits(Bzip2StreamWriter *writer, const u_char *data, uint64_t numBits)
+{
+	uint64_t bufferBits;
+	size_t completeBytes;
+	u_char *buffer;
+	bool success;
+
+	buffer=(u_char*)calloc((size_t)((writer->pendingBits+numBits+7)/8)+1, 1);
+	if (buffer== nullptr)
+		return false;
+	buffer[0]=writer->pendingByte;
+	bufferBits=writer->pendingBits;
+	WriteBzip2Bits(buffer, &bufferBits, data, numBits);
+	completeBytes=(size_t)(bufferBits/8);
+	success=fwrite(buffer, 1, completeBytes, writer->fp)==completeBytes;
+	writer->size+=completeBytes;
+	writer->pendingByte=buffer[completeBytes];
+	writer->pendingBits=(unsigned int)(bufferBits&7);
+	free(buffer);
+	return success;
+}
+
+static bool BeginStream(Bzip2StreamWriter *writer, FILE *fp)
+{
+	writer->fp=fp;
+	writer->size=4;
+	writer->pendingByte=0;
+	writer->pendingBits=0;
+	writer->streamCRC=0;
+	return fwrite("BZh9", 4, 1, fp)==1;
+}
+
+static bool WriteStreamChunks(Bzip2StreamWriter *writer, const CompressedChunkList *chunkList)
+{
+	uint64_t blockBits;
+	uint32_t blockCRC;
+	unsigned i;
+
+	for (i=0; i < chunkList->numChunks; i++)
+	{
+		if (GetChunkBlock(chunkList->chunks+i, &blockBits, &blockCRC)==false ||
+			WriteStreamBits(writer, (const u_char*)chunkList->chunks[i].data+4, blockBits)==false)
+			return false;
+		writer->streamCRC=((writer->streamCRC<<1) | (writer->streamCRC>>31)) ^ blockCRC;
+	}
+	return true;
+}
+
+// Without any chunks written, this is the same empty stream bzip2 writes
+static bool EndStream(Bzip2StreamWriter *writer)
+{
+	u_char trailer[10];
+
+	GetStreamTrailer(writer->streamCRC, trailer);
+	if (WriteStreamBits(writer, trailer, 80)==false)
+		return false;
+	if (writer->pendingBits==0)
+		return true;
+	writer->size++;
+	return fwrite(&writer->pendingByte, 1, 1, writer->fp)==1;
+}
+
+// Compresses the complete chunks of ctrl, or all of it if final is true, and removes them from ctrl
+static bool WriteCtrlChunks(Bzip2StreamWriter *writer, PatchCtrlBuffer *ctrl, bool final)
+{
+	CompressedChunkList chunkList;
+	off_t length;
+	bool success;
+
+	length=final ? ctrl->length : ctrl->length-ctrl->length%PATCH_COMPRESSION_CHUNK_SIZE;
+	if (length==0)
+		return true;
+	memset(&chunkList, 0, sizeof(chunkList));
+	success=CompressChunks(ctrl->data, length, &chunkList) && WriteStreamChunks(writer, &chunkList);
+	FreeChunks(&chunkList);
+	memmove(ctrl->data, ctrl->data+length, ctrl->length-length);
+	ctrl->length-=length;
+	return success;
+}
+
+// Result of diffing one window of the new file, for CreatePatchSettings::windowSize
+struct PatchWindow
+{
+	PatchCtrlBuffer ctrl;
+	CompressedChunkList diffChunks;
+	CompressedChunkList extraChunks;
+};
+
+struct WindowedPatchContext
+{
+	PatchInputFile *oldFile;
+	PatchInputFile *newFile;
+	off_t windowSize;
+	// windows holds the results of the windows starting with firstWindow, one per thread
+	uint32_t firstWindow;
+	PatchWindow *windows;
+	PatchWorkQueue workQueue;
+	SLNet::LocklessUint32_t numFailed;
+};
+
+// Where ApplyPatch() is in the old file when it gets to newPos in the new file, between windows
+static int64_t GetWindowOldPos(const WindowedPatchContext *context, int64_t newPos)
+{
+	return (int64_t)((double)newPos*context->oldFile->size/context->newFile->size);
+}
+
+// Reads a window of the new file and the part of the old file around it, and diffs them
+static bool DiffPatchWindow(WindowedPatchContext *context, uint32_t windowIndex, PatchWindow *window)
+{
+	int64_t newStart, oldWindowStart;
+	off_t newLength, oldWindowSize;
+	off_t *I, *V;
+	u_char *old, *_new, *db, *eb;
+	off_t dblen, eblen;
+	bool success;
+
+	newStart=(int64_t)windowIndex*context->windowSize;
+	newLength=(off_t)MIN((int64_t)context->windowSize, context->newFile->size-newStart);
+
+	// Search a part of the old file twice the window size, centered on the same relative position
+	oldWindowSize=(off_t)MIN((int64_t)context->windowSize*2, context->oldFile->size);
+	oldWindowStart=GetWindowOldPos(context, newStart)-context->windowSize/2;
+	if (oldWindowStart > context->oldFile->size-oldWindowSize)
+		oldWindowStart=context->oldFile->size-oldWindowSize;
+	if (oldWindowStart < 0)
+		oldWindowStart=0;
+
+	I=V=nullptr;
+	old=_new=db=eb=nullptr;
+	success=(old=(u_char*)malloc(oldWindowSize+1))!=nullptr &&
+		(I=(off_t*)malloc((oldWindowSize+1)*sizeof(off_t)))!=nullptr &&
+		(V=(off_t*)malloc((oldWindowSize+1)*sizeof(off_t)))!=nullptr &&
+		ReadPatchInput(context->oldFile, oldWindowStart, old, oldWindowSize);
+	// The sort used with several threads is faster than qsufsort() on one thread as well. The threads diff different windows, so each sort runs on one.
+	success=success && ParallelSuffixSort(I,V,old,oldWindowSize,nullptr,1);
+	free(V);
+
+	success=success &&
+		(_new=(u_char*)malloc(newLength+1))!=nullptr &&
+		(db=(u_char*)malloc(newLength+1))!=nullptr &&
+		(eb=(u_char*)malloc(newLength+1))!=nullptr &&
+		ReadPatchInput(context->newFile, newStart, _new, newLength) &&
+		DiffWindow(I,old,oldWindowSize,oldWindowStart,_new,newLength,GetWindowOldPos(context, newStart),
+			newStart+newLength==context->newFile->size ? -1 : GetWindowOldPos(context, newStart+newLength),
+			&window->ctrl,db,&dblen,eb,&eblen);
+	free(I);
+	free(old);
+	free(_new);
+
+	success=success && CompressChunks(db, dblen, &window->diffChunks) && CompressChunks(eb, eblen, &window->extraChunks);
+	free(db);
+	free(eb);
+	return success;
+}
+
+static void DiffPatchWindowsTask(void *context, unsigned int threadIndex)
+{
+	WindowedPatchContext *windowContext=(WindowedPatchContext*)context;
+	uint32_t i;
+
+	(void) threadIndex;
+	while (windowContext->workQueue.Get(&i))
+	{
+		if (DiffPatchWindow(windowContext, windowContext->firstWindow+i, windowContext->windows+i)==false)
+			windowContext->numFailed.Increment();
+	}
+}
+
+// CreatePatch() with CreatePatchSettings::windowSize. Each thread diffs and compresses one window of the new file at a time.
+// Only these windows are in memory. The patch is written to patchFile, which must be empty, as the windows are done. The diff and extra blocks go through temporary files until the ctrl block is complete.
+static bool CreateWindowedPatch(PatchInputFile *oldFile, PatchInputFile *newFile, FILE *patchFile, int64_t *patchSize, unsigned int windowSize,
+								PatchThreadPool *threadPool, unsigned int numThreads)
+{
+	WindowedPatchContext context;
+	Bzip2StreamWriter writers[3];
+	FILE *blockFiles[3];
+	PatchCtrlBuffer ctrl;
+	PatchWindow *window;
+	u_char header[32];
+	int64_t numWindows, windowIndex;
+	uint32_t i;
+	int blockIndex;
+	bool success;
+
+	// The part of the old file searched is twice the window size
+	if (windowSize==0 || (int64_t)windowSize*2 >= (int64_t)std::numeric_limits<off_t>::max())
+		return false;
+	numWindows=(newFile->size+windowSize-1)/windowSize;
+	if (numWindows > (int64_t)std::numeric_limits<uint32_t>::max())
+		return false;
+
+	context.oldFile=oldFile;
+	context.newFile=newFile;
+	context.windowSize=(off_t)windowSize;
+	context.windows=(PatchWindow*)calloc(numThreads, sizeof(PatchWindow));
+	if (context.windows== nullptr)
+		return false;
+	memset(&ctrl, 0, sizeof(ctrl));
+
+	// The header is written last, once the sizes of the blocks are known
+	memset(header, 0, sizeof(header));
+	blockFiles[0]=patchFile;
+	blockFiles[1]=OpenTemporaryFile();
+	blockFiles[2]=OpenTemporaryFile();
+	success=blockFiles[1]!=nullptr && blockFiles[2]!=nullptr && fwrite(header, sizeof(header), 1, patchFile)==1;
+	for (blockIndex=0; blockIndex < 3 && success; blockIndex++)
+		success=BeginStream(writers+blockIndex, blockFiles[blockIndex]);
+
+	// The blocks are written in the order of the windows, so the threads only start on the next windows once all of them are done
+	for (windowIndex=0; windowIndex < numWindows && success; windowIndex+=numThreads)
+	{
+		context.firstWindow=(uint32_t)windowIndex;
+		context.workQueue.Reset((uint32_t)MIN((int64_t)numThreads, numWindows-windowIndex));
+		RunPatchTask(threadPool, numThreads, DiffPatchWindowsTask, &context);
+		success=context.numFailed.GetValue()==0;
+
+		for (i=0; i < context.workQueue.numItems; i++)
+		{
+			window=context.windows+i;
+			if (success)
+				success=ReserveCtrl(&ctrl, window->ctrl.length);
+			if (success)
+			{
+				memcpy(ctrl.data+ctrl.length, window->ctrl.data, window->ctrl.length);
+				ctrl.length+=window->ctrl.length;
+				success=WriteCtrlChunks(writers+0, &ctrl, false) &&
+					WriteStreamChunks(writers+1, &window->diffChunks) &&
+					WriteStreamChunks(writers+2, &window->extraChunks);
+			}
+			free(window->ctrl.data);
+			FreeChunks(&window->diffChunks);
+			FreeChunks(&window->extraChunks);
+			memset(window, 0, sizeof(PatchWindow));
+		}
+	}
+	success=success && WriteCtrlChunks(writers+0, &ctrl, true);
+	for (blockIndex=0; blockIndex < 3 && success; blockIndex++)
+		success=EndStream(writers+blockIndex);
+	for (blockIndex=1; blockIndex < 3 && success; blockIndex++)
+		success=AppendFile(blockFiles[blockIndex], patchFile);
+
+	if (success)
+	{
+		memcpy(header,"BSDIFF40",8);
+		offtout(writers[0].size, header + 8);
+		offtout(writers[1].size, header + 16);
+		offtout(newFile->size, header + 24);
+		success=fseek64(patchFile, 0, SEEK_SET)==0 && fwrite(header, sizeof(header), 1, patchFile)==1 && fseek64(patchFile, 0, SEEK_END)==0;
+		*patchSize=32+writers[0].size+writers[1].size+writers[2].size;
+	}
+
+	for (blockIndex=1; blockIndex < 3; blockIndex++)
+	{
+		if (blockFiles[blockIndex])
+			fclose(blockFiles[blockIndex]);
+	}
+	free(context.windows);
+	free(ctrl.data);
+	return success;
+}
+
+// CreateWindowedPatch() for the overload working in memory. The patch goes through a temporary file, so only the complete patch is in memory.
+static bool CreateWindowedPatch(const char *old, off_t oldsize, char *_new, off_t newsize, char **out, unsigned *outSize, unsigned int windowSize,
+								PatchThreadPool *threadPool, unsigned int numThreads)
+{
+	PatchInputFile oldFile, newFile;
+	FILE *patchFile;
+	int64_t patchSize;
+	bool success;
+
+	oldFile.data=(const u_char*)old;
+	oldFile.fp=nullptr;
+	oldFile.size=oldsize;
+	newFile.data=(const u_char*)_new;
+	newFile.fp=nullptr;
+	newFile.size=newsize;
+	patchFile=OpenTemporaryFile();
+	if (patchFile== nullptr)
+		return false;
+	success=CreateWindowedPatch(&oldFile, &newFile, patchFile, &patchSize, windowSize, threadPool, numThreads) &&
+		patchSize <= (int64_t)std::numeric_limits<unsigned>::max() &&
+		fseek64(patchFile, 0, SEEK_SET)==0;
+	if (success)
+	{
+		*outSize=(unsigned)patchSize;
+		*out=new char[*outSize];
+		success=fread(*out, 1, *outSize, patchFile)==*outSize;
+		if (success==false)
+			delete [] *out;
+	}
+	fclose(patchFile);
+	return success;
+}
+
+// This function modifies the main() function included in bsdiff.c of bsdiff-4.3 found at http://www.daemonology.net/bsdiff/
+// It is changed to be a standalone function, to work entirely in memory, and to use my class MemoryCompressor as an interface to BZip
+// Up to the caller to delete out
+static bool CreatePatchInternal(const char *old, off_t oldsize, char *_new, off_t newsize, char **out, unsigned *outSize, const CreatePatchSettings &settings)
+{
+	off_t *I,*V;
+	off_t dblen,eblen;
+	u_char *db,*eb;
+	PatchCtrlBuffer ctrl;
+	MemoryCompressor patch;
+	PatchThreadPool threadPool;
+	unsigned int numThreads;
+	bool success;
+
+	numThreads=settings.numThreads > 1 ? settings.numThreads : 1;
+	if (numThreads > 1 && threadPool.StartThreads((int)numThreads-1, 0)==false)
+		return false;
+
+	if (settings.windowSize > 0 && (int64_t)newsize > (int64_t)settings.windowSize)
+	{
+		success=CreateWindowedPatch(old, oldsize, _new, newsize, out, outSize, settings.windowSize, &threadPool, numThreads);
+		threadPool.StopThreads();
+		return success;
+	}
+
+	/* Allocate oldsize+1 bytes instead of oldsize bytes to ensure
+		that we never try to malloc(0) and get a nullptr */
+	if(((I=(off_t*)malloc((oldsize+1)*sizeof(off_t)))== nullptr) ||
+		((V=(off_t*)malloc((oldsize+1)*sizeof(off_t)))== nullptr))
 	{
-		free(db);
-		free(eb);
 		free(I);
+		threadPool.StopThreads();
 		return false;
 	}
-//	memcpy(*out+outWriteOffset, patch.GetOutput(), patch.GetTotalOutputSize());
-//	outWriteOffset+=patch.GetTotalOutputSize();
-//	patch.Clear(_FILE_AND_LINE_);
-//	if (bz2err != BZ_OK)
-//		errx(1, "BZ2_bzWrite, bz2err = %d", bz2err);
-//	BZ2_bzWriteClose(&bz2err, pfbz2, 0, nullptr, nullptr);
-//	if (bz2err != BZ_OK)
-//		errx(1, "BZ2_bzWriteClose, bz2err = %d", bz2err);
 
-	/* Compute size of compressed diff data */
-//	if ((newsize = ftello(pf)) == -1)
-//		err(1, "ftello");
-	newsize=32+patch.GetTotalOutputSize();
-	offtout(newsize - len, header + 16);
-//	memcpy(*out+outWriteOffset, patch.GetOutput(), patch.GetTotalOutputSize());
-//	outWriteOffset+=patch.GetTotalOutputSize();
-//	patch.Clear(_FILE_AND_LINE_);
+	if (numThreads > 1)
+		success=ParallelSuffixSort(I,V,(const u_char*)old,oldsize,&threadPool,numThreads);
+	else
+	{
+		qsufsort(I,V,(u_char*)old,oldsize);
+		success=true;
+	}
 
-	/* Write compressed extra data */
-//	if ((pfbz2 = BZ2_bzWriteOpen(&bz2err, pf, 9, 0, 0)) == nullptr)
-//		errx(1, "BZ2_bzWriteOpen, bz2err = %d", bz2err);
-//	BZ2_bzWrite(&bz2err, pfbz2, eb, eblen);
-	if (patch.Compress((char*)eb,eblen,true)==false)
+	free(V);
+
+	/* Allocate newsize+1 bytes instead of newsize bytes to ensure
+		that we never try to malloc(0) and get a nullptr */
+	db=eb=nullptr;
+	if(success==false ||
+		((db=(u_char*)malloc(newsize+1))== nullptr) ||
+		((eb=(u_char*)malloc(newsize+1))== nullptr))
 	{
 		free(db);
-		free(eb);
 		free(I);
+		threadPool.StopThreads();
 		return false;
 	}
-//	memcpy(*out+outWriteOffset, patch.GetOutput(), patch.GetTotalOutputSize());
-//	outWriteOffset+=patch.GetTotalOutputSize();
-//	patch.Clear(_FILE_AND_LINE_);
-//	if (bz2err != BZ_OK)
-//		errx(1, "BZ2_bzWrite, bz2err = %d", bz2err);
-//	BZ2_bzWriteClose(&bz2err, pfbz2, 0, nullptr, nullptr);
-//	if (bz2err != BZ_OK)
-//		errx(1, "BZ2_bzWriteClose, bz2err = %d", bz2err);
 
-	/* Seek to the beginning, write the header, and close the file */
-//	if (fseeko(pf, 0, SEEK_SET))
-//		err(1, "fseeko");
-//	if (fwrite(header, 32, 1, pf) != 1)
-//		err(1, "fwrite(%s)", argv[3]);
-//	if (fclose(pf))
-//		err(1, "fclose");
-
-//	memcpy(*out,header,32);
-//	*out=(char*) realloc(*out, outWriteOffset);
-//	*outSize=outWriteOffset;
-
-	*outSize=patch.GetTotalOutputSize()+32;
-	*out = new char [*outSize];
-	memcpy(*out, header, 32);
-	memcpy(*out+32, patch.GetOutput(), patch.GetTotalOutputSize());
-	
+	/* Compute the differences */
+	memset(&ctrl, 0, sizeof(ctrl));
+	success=DiffWindow(I,(const u_char*)old,oldsize,0,(const u_char*)_new,newsize,0,-1,&ctrl,db,&dblen,eb,&eblen);
+	free(I);
+
+	if (success && numThreads > 1)
+		success=WriteParallelPatch(&ctrl, db, dblen, eb, eblen, newsize, out, outSize, &threadPool, numThreads);
+	else if (success)
+	{
+		// Same as above on one thread, with the blocks compressed by one MemoryCompressor
+		off_t ctrlSize, diffSize;
+		success=patch.Compress((char*)ctrl.data,(unsigned)ctrl.length,true);
+		ctrlSize=patch.GetTotalOutputSize();
+		success=success && patch.Compress((char*)db,(unsigned)dblen,true);
+		diffSize=patch.GetTotalOutputSize()-ctrlSize;
+		success=success && patch.Compress((char*)eb,(unsigned)eblen,true);
+		if (success)
+			success=WritePatch((const u_char*)patch.GetOutput(), ctrlSize, (const u_char*)patch.GetOutput()+ctrlSize, diffSize,
+				(const u_char*)patch.GetOutput()+ctrlSize+diffSize, patch.GetTotalOutputSize()-ctrlSize-diffSize, newsize, out, outSize);
+	}
 
 	/* Free the memory we used */
+	free(ctrl.data);
 	free(db);
 	free(eb);
-	free(I);
-	//free(old);
-	//free(new);
+	threadPool.StopThreads();
 
-	return true;
+	return success;
 }
 
 // #med - deprecate/remove this overload (alongside the other overloads except for the off_t version)
@@ -573,12 +1524,12 @@ bool CreatePatch(const char *old, unsigned oldsize, char *_new, unsigned int new
 		return false;
 	}
 
-	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize);
+	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize, CreatePatchSettings());
 }
 
 bool CreatePatch(const char *old, int oldsize, char *_new, int newsize, char **out, unsigned *outSize)
 {
-	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize);
+	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize, CreatePatchSettings());
 }
 
 bool CreatePatch(const char *old, int oldsize, char *_new, unsigned int newsize, char **out, unsigned *outSize)
@@ -587,7 +1538,7 @@ bool CreatePatch(const char *old, int oldsize, char *_new, unsigned int newsize,
 		return false;
 	}
 
-	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize);
+	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize, CreatePatchSettings());
 }
 
 bool CreatePatch(const char *old, unsigned oldsize, char *_new, int newsize, char **out, unsigned *outSize)
@@ -596,12 +1547,101 @@ bool CreatePatch(const char *old, unsigned oldsize, char *_new, int newsize, cha
 		return false;
 	}
 
-	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize);
+	return CreatePatchInternal(old, static_cast<off_t>(oldsize), _new, static_cast<off_t>(newsize), out, outSize, CreatePatchSettings());
 }
 
 bool CreatePatch(const char *old, off_t oldsize, char *_new, off_t newsize, char **out, unsigned *outSize)
 {
-	return CreatePatchInternal(old, oldsize, _new, newsize, out, outSize);
+	return CreatePatchInternal(old, oldsize, _new, newsize, out, outSize, CreatePatchSettings());
+}
+
+bool CreatePatch(const char *old, off_t oldsize, char *_new, off_t newsize, char **out, unsigned *outSize, const CreatePatchSettings &settings)
+{
+	return CreatePatchInternal(old, oldsize, _new, newsize, out, outSize, settings);
+}
+
+// Opens a file to read for CreatePatchFile()
+static bool OpenPatchInput(const char *filename, PatchInputFile *input)
+{
+	input->data=nullptr;
+	input->size=0;
+	if (fopen_s(&input->fp, filename, "rb")!=0)
+	{
+		input->fp=nullptr;
+		return false;
+	}
+	if (fseek64(input->fp, 0, SEEK_END)!=0 || (input->size=ftell64(input->fp)) < 0)
+		return false;
+	return true;
+}
+
+// Reads all of a file, for CreatePatchFile() without windows
+static char* ReadPatchInputFile(PatchInputFile *input)
+{
+	char *data;
+
+	if (input->size >= (int64_t)std::numeric_limits<off_t>::max())
+		return nullptr;
+	data=(char*)malloc((size_t)input->size+1);
+	if (data!=nullptr && ReadPatchInput(input, 0, (u_char*)data, (off_t)input->size)==false)
+	{
+		free(data);
+		return nullptr;
+	}
+	return data;
+}
+
+bool CreatePatchFile(const char *oldFilename, const char *newFilename, const char *patchFilename, const CreatePatchSettings &settings)
+{
+	PatchInputFile oldFile, newFile;
+	PatchThreadPool threadPool;
+	FILE *patchFile;
+	char *old, *_new, *out;
+	unsigned outSize;
+	int64_t patchSize;
+	unsigned int numThreads;
+	bool success;
+
+	success=OpenPatchInput(oldFilename, &oldFile);
+	success=OpenPatchInput(newFilename, &newFile) && success;
+	if (success==false || fopen_s(&patchFile, patchFilename, "wb")!=0)
+	{
+		if (oldFile.fp)
+			fclose(oldFile.fp);
+		if (newFile.fp)
+			fclose(newFile.fp);
+		return false;
+	}
+
+	if (settings.windowSize > 0 && newFile.size > (int64_t)settings.windowSize)
+	{
+		// Read and written a window at a time
+		numThreads=settings.numThreads > 1 ? settings.numThreads : 1;
+		success=numThreads==1 || threadPool.StartThreads((int)numThreads-1, 0);
+		success=success && CreateWindowedPatch(&oldFile, &newFile, patchFile, &patchSize, settings.windowSize, &threadPool, numThreads);
+		threadPool.StopThreads();
+	}
+	else
+	{
+		old=ReadPatchInputFile(&oldFile);
+		_new=ReadPatchInputFile(&newFile);
+		success=old!=nullptr && _new!=nullptr &&
+			CreatePatchInternal(old, (off_t)oldFile.size, _new, (off_t)newFile.size, &out, &outSize, settings);
+		free(old);
+		free(_new);
+		if (success)
+		{
+			success=fwrite(out, 1, outSize, patchFile)==outSize;
+			delete [] out;
+		}
+	}
+
+	fclose(oldFile.fp);
+	fclose(newFile.fp);
+	success=fclose(patchFile)==0 && success;
+	if (success==false)
+		remove(patchFilename);
+	return success;
 }
 
 int TestDiffInMemory(int argc,char *argv[])
@@ -18,3 +18,27 @@ bool CreatePatch(const char *old, int oldsize, char *_new, int newsize, char **o
 bool CreatePatch(const char *old, unsigned oldsize, char *_new, unsigned int newsize, char **out, unsigned *outSize);
 bool CreatePatch(const char *old, int oldsize, char *_new, unsigned int newsize, char **out, unsigned *outSize);
 bool CreatePatch(const char *old, unsigned oldsize, char *_new, int newsize, char **out, unsigned *outSize);
+
+/// Settings for the CreatePatch() overload below
+struct CreatePatchSettings
+{
+	CreatePatchSettings() : numThreads(1), windowSize(0) {}
+
+	/// Number of threads sorting \a old and compressing the patch, including the calling thread.
+	/// With more than one thread a different sort is used, which is faster on most data even without the extra threads, but needs more memory, especially for long runs of the same bytes.
+	unsigned int numThreads;
+
+	/// If not 0, \a new is diffed in windows of this many bytes, each against the part of \a old twice that size around the same relative position.
+	/// The threads diff different windows. Memory used besides \a old, \a new and the patch is then about 36 times windowSize per thread, more for long runs of the same bytes, rather than 16 times the size of \a old plus twice the size of \a new.
+	/// Data that moved further than the window size is stored in the patch as is, and each window is compressed separately, so patches get larger. Use windows of several megabytes.
+	/// With CreatePatchFile(), only the windows are read into memory, so the files do not have to fit into memory.
+	unsigned int windowSize;
+};
+
+/// Same as CreatePatch() above, using \a settings. The patch is read by ApplyPatch() as usual.
+bool CreatePatch(const char *old, off_t oldsize, char *_new, off_t newsize, char **out, unsigned *outSize, const CreatePatchSettings &settings);
+
+/// Same as CreatePatch() above, reading the files \a oldFilename and \a newFilename and writing the patch to the file \a patchFilename.
+/// With CreatePatchSettings::windowSize, the windows are read from the files as they are diffed, and the patch is written as they are done. Otherwise both files are read completely.
+/// \return false if a file could not be read or written, in which case \a patchFilename is removed.
+bool CreatePatchFile(const char *oldFilename, const char *newFilename, const char *patchFilename, const CreatePatchSettings &settings);
@@ -45,6 +45,9 @@ QuickJoinUser::QuickJoinUser()
 {
 	networkedQuickJoinUser.query.queries=0;
 	totalTimeWaiting=0;
+	quickJoinListIndex=(unsigned int) -1;
+	quickJoinBucket=0;
+	quickJoinBucketIndex=(unsigned int) -1;
 }
 QuickJoinUser::~QuickJoinUser()
 {
@@ -86,6 +89,105 @@ int QuickJoinUser::SortByMinimumSlots( QuickJoinUser* const &key, QuickJoinUser*
 		return -1;
 	return -1;
 }
+// ----------------------------  QuickJoinBucket  ----------------------------
+
+QuickJoinBucket::QuickJoinBucket(const SLNet::RakString &_signature, RoomQuery *roomQuery)
+{
+	signature=_signature;
+	firstUserIndex=0;
+	numUsers=0;
+	bucketListIndex=(unsigned int) -1;
+	numQueries=roomQuery->numQueries;
+	if (numQueries>0)
+	{
+		queries = new DataStructures::Table::FilterQuery[numQueries];
+		queryCells = new DataStructures::Table::Cell[numQueries];
+		unsigned int i;
+		for (i=0; i < numQueries; i++)
+		{
+			queries[i]=roomQuery->queries[i];
+			if (roomQuery->queries[i].cellValue)
+				queryCells[i]=*roomQuery->queries[i].cellValue;
+			queries[i].cellValue=&queryCells[i];
+		}
+	}
+	else
+	{
+		queries=0;
+		queryCells=0;
+	}
+}
+QuickJoinBucket::~QuickJoinBucket()
+{
+	delete [] queries;
+	delete [] queryCells;
+	ClearNewRoomMatches();
+}
+void QuickJoinBucket::AddUser(QuickJoinUser *qju)
+{
+	qju->quickJoinBucket=this;
+	qju->quickJoinBucketIndex=users.Size();
+	users.Insert(qju, _FILE_AND_LINE_ );
+	numUsers++;
+}
+void QuickJoinBucket::RemoveUser(QuickJoinUser *qju)
+{
+	RakAssert(users[qju->quickJoinBucketIndex]==qju);
+	users[qju->quickJoinBucketIndex]=0;
+	qju->quickJoinBucket=0;
+	numUsers--;
+
+	if (numUsers==0)
+	{
+		users.Clear(true, _FILE_AND_LINE_ );
+		firstUserIndex=0;
+		return;
+	}
+
+	// Users mostly leave from the front, as the longest waiting are joined first
+	while (users[firstUserIndex]==0)
+		firstUserIndex++;
+
+	// Compact once most of the list is removed users
+	if (users.Size() > 16 && numUsers < users.Size()/2)
+	{
+		unsigned int readIndex, writeIndex=0;
+		for (readIndex=firstUserIndex; readIndex < users.Size(); readIndex++)
+		{
+			if (users[readIndex])
+			{
+				users[writeIndex]=users[readIndex];
+				users[writeIndex]->quickJoinBucketIndex=writeIndex;
+				writeIndex++;
+			}
+		}
+		users.RemoveFromEnd(users.Size()-writeIndex);
+		firstUserIndex=0;
+	}
+}
+int QuickJoinBucket::RoomComp( const RoomID &key, Room* const &data )
+{
+	if (key < data->GetID())
+		return -1;
+	if (key > data->GetID())
+		return 1;
+	return 0;
+}
+QuickJoinBucket::NewRoomMatch* QuickJoinBucket::GetNewRoomMatch(int minimumPlayers)
+{
+	unsigned int i;
+	for (i=0; i < newRoomMatches.Size(); i++)
+		if (newRoomMatches[i]->minimumPlayers==minimumPlayers)
+			return newRoomMatches[i];
+	return 0;
+}
+void QuickJoinBucket::ClearNewRoomMatches(void)
+{
+	unsigned int i;
+	for (i=0; i < newRoomMatches.Size(); i++)
+		delete newRoomMatches[i];
+	newRoomMatches.Clear(true, _FILE_AND_LINE_ );
+}
 void NetworkedQuickJoinUser::Serialize(bool writeToBitstream, SLNet::BitStream *bitStream)
 {
 	query.Serialize(writeToBitstream, bitStream);
@@ -516,7 +618,7 @@ RoomsErrorCode AllGamesRoomsContainer::JoinByFilter(GameIdentifier gameIdentifie
 }
 RoomsErrorCode AllGamesRoomsContainer::LeaveRoom(RoomsParticipant* roomsParticipant, RemoveUserResult *removeUserResult)
 {
-	if (roomsParticipant->GetRoom()==false)
+	if (roomsParticipant->GetRoom()==0)
 		return REC_LEAVE_ROOM_NOT_IN_ROOM;
 	else if (roomsParticipant->GetInQuickJoin())
 		return REC_LEAVE_ROOM_CURRENTLY_IN_QUICK_JOIN;
@@ -702,6 +804,7 @@ RoomsErrorCode AllGamesRoomsContainer::SetCustomRoomProperties(RoomsParticipant*
 			if (oldTable->GetColumnCount() < (unsigned int) MAX_CUSTOM_QUERY_FIELDS)
 			{
 				oldTable->AddColumn(table->ColumnName(newTableIndex), table->GetColumnType(newTableIndex));
+				perGameRoomsContainer->filteredColumnsDirty=true;
 			}
 			else
 				continue;
@@ -711,6 +814,7 @@ RoomsErrorCode AllGamesRoomsContainer::SetCustomRoomProperties(RoomsParticipant*
 		row = roomsParticipant->GetRoom()->tableRow;
 		*(row->cells[oldTableIndex])=*(table->GetRowByIndex(0,0)->cells[newTableIndex]);		
 	}
+	roomsParticipant->GetRoom()->OnPropertiesChanged(0, (unsigned int) -1);
 	return REC_SUCCESS;
 }
 void AllGamesRoomsContainer::GetRoomProperties(RoomID roomId, Room **room, DataStructures::Table *table)
@@ -868,7 +972,8 @@ RoomsErrorCode AllGamesRoomsContainer::ProcessQuickJoins(
 	joinedRoomMembers.Clear(false, _FILE_AND_LINE_);
 	for (i=0; i < perGamesRoomsContainers.Size(); i++)
 	{
-		numRoomsCreated=perGamesRoomsContainers[i]->ProcessQuickJoins(timeoutExpired, joinedRoomMembers, dereferencedPointers, elapsedTime, nextRoomId);
+		// nextRoomId is the last ID used, as in CreateRoom()
+		numRoomsCreated=perGamesRoomsContainers[i]->ProcessQuickJoins(timeoutExpired, joinedRoomMembers, dereferencedPointers, elapsedTime, nextRoomId+1);
 		nextRoomId += numRoomsCreated;
 	}
 	unsigned int j;
@@ -890,9 +995,13 @@ PerGameRoomsContainer::PerGameRoomsContainer()
 {
 	DefaultRoomColumns::AddDefaultColumnsToTable(&roomsTable);
 	nextQuickJoinProcess.SetPeriod(PROCESS_QUICK_JOINS_INTERVAL);
+	filteredColumnsDirty=true;
 }
 PerGameRoomsContainer::~PerGameRoomsContainer()
 {
+	unsigned int i;
+	for (i=0; i < quickJoinBucketList.Size(); i++)
+		delete quickJoinBucketList[i];
 }
 RoomsErrorCode PerGameRoomsContainer::CreateRoom(RoomCreationParameters *roomCreationParameters,
 												 ProfanityFilter *profanityFilter,
@@ -911,6 +1020,8 @@ RoomsErrorCode PerGameRoomsContainer::CreateRoom(RoomCreationParameters *roomCre
 	DataStructures::List<DataStructures::Table::Cell> initialCellValues;
 	DataStructures::Table::Row *row = roomsTable.AddRow(lobbyRoomId,initialCellValues);
 	roomCreationParameters->roomOutput = new Room(lobbyRoomId, roomCreationParameters, row, roomCreationParameters->firstUser);
+	roomCreationParameters->roomOutput->perGameRoomsContainer=this;
+	roomCreationParameters->roomOutput->OnPropertiesChanged(0, (unsigned int) -1);
 	roomCreationParameters->firstUser->SetPerGameRoomsContainer(this);
 	RakAssert(roomCreationParameters->firstUser->GetRoom()==roomCreationParameters->roomOutput);
 	return REC_SUCCESS;
@@ -945,7 +1056,10 @@ RoomsErrorCode PerGameRoomsContainer::AddUserToQuickJoin(QuickJoinUser *quickJoi
 		return REC_ADD_TO_QUICK_JOIN_ALREADY_THERE;
 	quickJoinMember->roomsParticipant->SetPerGameRoomsContainer(this);
 	quickJoinMember->roomsParticipant->SetInQuickJoin(true);
+	quickJoinMember->roomsParticipant->SetQuickJoinUser(quickJoinMember);
+	quickJoinMember->quickJoinListIndex=quickJoinList.Size();
 	quickJoinList.Insert(quickJoinMember, _FILE_AND_LINE_ );
+	AddToQuickJoinBucket(quickJoinMember);
 	return REC_SUCCESS;
 }
 RoomsErrorCode PerGameRoomsContainer::RemoveUserFromQuickJoin(RoomsParticipant* roomsParticipant, QuickJoinUser **qju)
@@ -956,7 +1070,7 @@ RoomsErrorCode PerGameRoomsContainer::RemoveUserFromQuickJoin(RoomsParticipant*
 		return REC_REMOVE_FROM_QUICK_JOIN_NOT_THERE;
 	quickJoinList[quickJoinIndex]->roomsParticipant->SetInQuickJoin(false);
 	*qju=quickJoinList[quickJoinIndex];
-	quickJoinList.RemoveAtIndex(quickJoinIndex);
+	RemoveQuickJoinUser(quickJoinIndex);
 	roomsParticipant->SetPerGameRoomsContainer(0);
 	return REC_SUCCESS;
 }
@@ -994,7 +1108,7 @@ unsigned PerGameRoomsContainer::ProcessQuickJoins( DataStructures::List<QuickJoi
 					   SLNet::TimeMS elapsedTime,
 					   RoomID startingRoomId)
 {
-	unsigned roomIndex, quickJoinIndex;
+	unsigned roomIndex, quickJoinIndex, bucketIndex, userIndex;
 	for (quickJoinIndex=0; quickJoinIndex < quickJoinList.Size(); quickJoinIndex++)
 		quickJoinList[quickJoinIndex]->totalTimeWaiting+=elapsedTime;
 
@@ -1005,171 +1119,149 @@ unsigned PerGameRoomsContainer::ProcessQuickJoins( DataStructures::List<QuickJoi
 	unsigned numRoomsCreated=0;
 	RoomsErrorCode roomsErrorCode;
 	Room *room;
+	QuickJoinBucket *bucket;
+	QuickJoinUser *qju;
 	double totalRoomSlots, remainingRoomSlots;
-	DataStructures::OrderedList<Room*, Room*, RoomsSortByTimeThenTotalSlots> potentialRooms;
 	DataStructures::OrderedList<QuickJoinUser *, QuickJoinUser *, QuickJoinUser::SortByTotalTimeWaiting> quickJoinMemberTimeSort;
 	DataStructures::List<Room*> allRooms;
-	GetAllRooms(allRooms);
 
-	for(;;)
-	{
-		// 1. Clear all quickJoinWorkingList from all rooms
-		for (roomIndex=0; roomIndex < allRooms.Size(); roomIndex++)
-			allRooms[roomIndex]->quickJoinWorkingList.Clear(true, _FILE_AND_LINE_ );
+	// 1. For all rooms whose properties changed since the last call, match the room against the query of every bucket
+	UpdateQuickJoinBuckets();
 
-		// 2. Use RoomPrioritySort to get all rooms they can potentially join
-		// 3. For each of these rooms, record that this member can potentially join by storing a copy of the pointer into quickJoinWorkingList, if minimumPlayers => total room slots
-		for (quickJoinIndex=0; quickJoinIndex < quickJoinList.Size(); quickJoinIndex++)
+	GetAllRooms(allRooms);
+	for (roomIndex=0; roomIndex < allRooms.Size(); roomIndex++)
+	{
+		room = allRooms[roomIndex];
+		if (room->quickJoinBuckets.Size()==0)
+			continue;
+		remainingRoomSlots = room->GetNumericProperty(DefaultRoomColumns::TC_REMAINING_PUBLIC_PLUS_RESERVED_SLOTS);
+		if (remainingRoomSlots<=0)
+			continue;
+		totalRoomSlots = room->GetNumericProperty(DefaultRoomColumns::TC_TOTAL_PUBLIC_PLUS_RESERVED_SLOTS);
+
+		// 2. Collect the longest waiting members of the buckets that match the room, that can join the room, if minimumPlayers => total room slots
+		// Each member is in one bucket, so a member is never collected twice
+		quickJoinMemberTimeSort.Clear(false, _FILE_AND_LINE_);
+		for (bucketIndex=0; bucketIndex < room->quickJoinBuckets.Size(); bucketIndex++)
 		{
-			RoomPrioritySort( quickJoinList[quickJoinIndex]->roomsParticipant, &quickJoinList[quickJoinIndex]->networkedQuickJoinUser.query, potentialRooms );
-
-			for (roomIndex=0; roomIndex < potentialRooms.Size(); roomIndex++)
+			bucket = room->quickJoinBuckets[bucketIndex];
+			unsigned int numCollected=0;
+			for (userIndex=bucket->firstUserIndex; userIndex < bucket->users.Size() && numCollected < (unsigned) remainingRoomSlots; userIndex++)
 			{
-				totalRoomSlots = potentialRooms[roomIndex]->GetNumericProperty(DefaultRoomColumns::TC_TOTAL_PUBLIC_PLUS_RESERVED_SLOTS);
-				if (totalRoomSlots >= quickJoinList[quickJoinIndex]->networkedQuickJoinUser.minimumPlayers-1 &&
-					potentialRooms[roomIndex]->ParticipantCanJoinRoom(quickJoinList[quickJoinIndex]->roomsParticipant, false, true)==PCJRR_SUCCESS )
-					potentialRooms[roomIndex]->quickJoinWorkingList.Insert( quickJoinList[quickJoinIndex], _FILE_AND_LINE_  );
+				qju = bucket->users[userIndex];
+				if (qju &&
+					totalRoomSlots >= qju->networkedQuickJoinUser.minimumPlayers-1 &&
+					room->ParticipantCanJoinRoom(qju->roomsParticipant, false, true)==PCJRR_SUCCESS &&
+					room->IsHiddenToParticipant(qju->roomsParticipant)==false)
+				{
+					quickJoinMemberTimeSort.Insert(qju, qju, true, _FILE_AND_LINE_);
+					numCollected++;
+				}
 			}
 		}
 
-
-		// For all rooms:
-		// 4. For each room where there are enough potential quick join members to fill the room, join all those members at once. Remove these members from the quick join list. Go to 1.
-		for (roomIndex=0; roomIndex < allRooms.Size(); roomIndex++)
+		// 3. If there are enough of these members to fill the room, join all those members at once. Remove these members from the quick join list.
+		// Those longest waiting are processed first
+		if (quickJoinMemberTimeSort.Size() < (unsigned int) remainingRoomSlots)
+			continue;
+		for (quickJoinIndex=0; quickJoinIndex < (unsigned) remainingRoomSlots; quickJoinIndex++)
 		{
-			room = allRooms[roomIndex];
-			remainingRoomSlots = room->GetNumericProperty(DefaultRoomColumns::TC_REMAINING_PUBLIC_PLUS_RESERVED_SLOTS);
-			if (remainingRoomSlots>0 && room->quickJoinWorkingList.Size() >= (unsigned int) remainingRoomSlots)
-			{
-				quickJoinMemberTimeSort.Clear(false, _FILE_AND_LINE_ );
+			JoinedRoomResult jrr;
+			jrr.roomOutput=room;
+			roomsErrorCode=room->JoinByQuickJoin(quickJoinMemberTimeSort[quickJoinIndex]->roomsParticipant, RMM_ANY_PLAYABLE, &jrr);
+			RakAssert(roomsErrorCode==REC_SUCCESS);
 
-				// Sort those waiting in quick join from longest waiting to least waiting. Those longest waiting are processed first
-				for (quickJoinIndex=0; quickJoinIndex < (int) room->quickJoinWorkingList.Size(); quickJoinIndex++)
-					quickJoinMemberTimeSort.Insert( room->quickJoinWorkingList[quickJoinIndex], room->quickJoinWorkingList[quickJoinIndex], true, _FILE_AND_LINE_  );
+			dereferencedPointers.Insert(quickJoinMemberTimeSort[quickJoinIndex], _FILE_AND_LINE_ );
+			joinedRoomMembers.Insert(jrr, _FILE_AND_LINE_ );
 
-				for (quickJoinIndex=0; quickJoinIndex < (unsigned) remainingRoomSlots; quickJoinIndex++)
-				{
-					JoinedRoomResult jrr;
-					jrr.roomOutput=room;
-					roomsErrorCode=room->JoinByQuickJoin(quickJoinMemberTimeSort[quickJoinIndex]->roomsParticipant, RMM_ANY_PLAYABLE, &jrr);
-					RakAssert(roomsErrorCode==REC_SUCCESS);
-
-					dereferencedPointers.Insert(quickJoinMemberTimeSort[quickJoinIndex], _FILE_AND_LINE_ );
-					joinedRoomMembers.Insert(jrr, _FILE_AND_LINE_ );
-
-					QuickJoinUser *qju;
-					roomsErrorCode=RemoveUserFromQuickJoin(quickJoinMemberTimeSort[quickJoinIndex]->roomsParticipant, &qju);
-					RakAssert(roomsErrorCode==REC_SUCCESS);
-				}
-
-				continue;
-			}
+			roomsErrorCode=RemoveUserFromQuickJoin(quickJoinMemberTimeSort[quickJoinIndex]->roomsParticipant, &qju);
+			RakAssert(roomsErrorCode==REC_SUCCESS);
 		}
-
-		break;
 	}
 
-	DataStructures::OrderedList<QuickJoinUser *, QuickJoinUser *, QuickJoinUser::SortByMinimumSlots> quickJoinMemberSlotSort;
-	// 5. Sort quick join members by minimumPlayers, excluding members where minimumPlayers > total number of quick join members
-	for (quickJoinIndex=0; quickJoinIndex < quickJoinList.Size(); quickJoinIndex++)
-	{
-		if (quickJoinList[quickJoinIndex]->networkedQuickJoinUser.minimumPlayers <= (int) quickJoinList.Size())
-			quickJoinMemberSlotSort.Insert(quickJoinList[quickJoinIndex],quickJoinList[quickJoinIndex],true, _FILE_AND_LINE_ );
-	}
-
-	DataStructures::Table potentialNewRoom;
-	unsigned queryIndex, quickJoinIndex2;
-	DataStructures::Table resultTable;
 	QuickJoinUser *quickJoinMember;
 	RoomCreationParameters roomCreationParameters;
 	DataStructures::List<QuickJoinUser*> potentialNewRoommates;
-
-	// 6. If the current member created a roomOutput, find out how many subsequent members would join based on the custom filter
+	// 4. If the current member created a room, find out which buckets would join based on the custom filter
+	MatchNewRooms();
 	quickJoinIndex=0;
 	while (quickJoinIndex < quickJoinList.Size())
 	{
 		quickJoinMember = quickJoinList[quickJoinIndex];
-		potentialNewRoom.Clear();
-		DefaultRoomColumns::AddDefaultColumnsToTable(&potentialNewRoom);
-		DataStructures::Table::Row *row = potentialNewRoom.AddRow(0);
-		roomCreationParameters.networkedRoomCreationParameters.slots.publicSlots=quickJoinMember->networkedQuickJoinUser.minimumPlayers-1;
-		Room::UpdateRowSlots( row, &roomCreationParameters.networkedRoomCreationParameters.slots, &roomCreationParameters.networkedRoomCreationParameters.slots);
-
-		for (queryIndex=0; queryIndex < quickJoinMember->networkedQuickJoinUser.query.numQueries; queryIndex++)
+		unsigned int roommatesNeeded = (unsigned int) quickJoinMember->networkedQuickJoinUser.minimumPlayers-1;
+		if (roommatesNeeded >= quickJoinList.Size())
 		{
-			// For all filters that are equal and custom, create a table with rows with these values
-			if ( ( quickJoinMember->networkedQuickJoinUser.query.queries[queryIndex].operation==DataStructures::Table::QF_EQUAL ) &&
-				DefaultRoomColumns::HasColumnName(quickJoinMember->networkedQuickJoinUser.query.queries[queryIndex].columnName)==false &&
-				potentialNewRoom.ColumnIndex(quickJoinMember->networkedQuickJoinUser.query.queries[queryIndex].columnName)==-1 &&
-				quickJoinMember->networkedQuickJoinUser.query.queries[queryIndex].cellValue->isEmpty==false
-				)
-			{
-				potentialNewRoom.AddColumn(quickJoinMember->networkedQuickJoinUser.query.queries[queryIndex].columnName, quickJoinMember->networkedQuickJoinUser.query.queries[queryIndex].cellValue->EstimateColumnType());
-				*(row->cells[potentialNewRoom.GetColumnCount()-1]) = *(quickJoinMember->networkedQuickJoinUser.query.queries[queryIndex].cellValue);
-			}
+			quickJoinIndex++;
+			continue;
 		}
 
-		potentialNewRoommates.Clear(true, _FILE_AND_LINE_ );
-		for (quickJoinIndex2=quickJoinIndex+1; quickJoinIndex2 < quickJoinList.Size(); quickJoinIndex2++)
+		QuickJoinBucket::NewRoomMatch *newRoomMatch = quickJoinMember->quickJoinBucket->GetNewRoomMatch(quickJoinMember->networkedQuickJoinUser.minimumPlayers);
+		if (newRoomMatch->failed)
 		{
-			resultTable.Clear();
-			unsigned columnIndices[1];
-			columnIndices[0]=DefaultRoomColumns::TC_LOBBY_ROOM_PTR;
-			JoinedRoomResult joinedRoomResult;
+			quickJoinIndex++;
+			continue;
+		}
 
-			DataStructures::Table::FilterQuery subQueries[MAX_CUSTOM_QUERY_FIELDS];
-			unsigned int subQueryCount;
-			unsigned int subQueryIndex;
-			for (subQueryIndex=0, subQueryCount=0; subQueryIndex < quickJoinList[quickJoinIndex2]->networkedQuickJoinUser.query.numQueries; subQueryIndex++)
+		quickJoinMemberTimeSort.Clear(false, _FILE_AND_LINE_);
+		for (bucketIndex=0; bucketIndex < newRoomMatch->roommateBuckets.Size(); bucketIndex++)
+		{
+			bucket = newRoomMatch->roommateBuckets[bucketIndex];
+			unsigned int numCollected=0;
+			for (userIndex=bucket->firstUserIndex; userIndex < bucket->users.Size() && numCollected < roommatesNeeded; userIndex++)
 			{
-				if (potentialNewRoom.ColumnIndex(quickJoinList[quickJoinIndex2]->networkedQuickJoinUser.query.queries[subQueryIndex].columnName)!=-1)
+				qju = bucket->users[userIndex];
+				if (qju && qju!=quickJoinMember)
 				{
-					subQueries[subQueryCount++]=quickJoinList[quickJoinIndex2]->networkedQuickJoinUser.query.queries[subQueryIndex];
+					quickJoinMemberTimeSort.Insert(qju, qju, true, _FILE_AND_LINE_);
+					numCollected++;
 				}
 			}
+		}
 
-			potentialNewRoom.QueryTable(columnIndices,1,subQueries,subQueryCount,0,0,&resultTable);
-			if (resultTable.GetRowCount()>0)
-			{
-				potentialNewRoommates.Insert(quickJoinList[quickJoinIndex2], _FILE_AND_LINE_ );
-				if (potentialNewRoommates.Size()>=(unsigned int) quickJoinMember->networkedQuickJoinUser.minimumPlayers-1)
-				{
-					// 7. If this satisfies minimumPlayers, have that user create a roomOutput and those subsequent members join.
-					roomCreationParameters.networkedRoomCreationParameters.hiddenFromSearches=false;
-					roomCreationParameters.networkedRoomCreationParameters.destroyOnModeratorLeave=false;
-					roomCreationParameters.networkedRoomCreationParameters.roomName.Set(QUICK_JOIN_ROOM_NAME "%i", startingRoomId+numRoomsCreated);
-					roomCreationParameters.firstUser=quickJoinMember->roomsParticipant;
-
-					roomsErrorCode = CreateRoom(&roomCreationParameters, 0,startingRoomId+numRoomsCreated, false);
-					joinedRoomResult.roomOutput=roomCreationParameters.roomOutput;
-					numRoomsCreated++;
-					RakAssert(roomsErrorCode==REC_SUCCESS);
-
-					QuickJoinUser *qju;
-					for (quickJoinIndex2=0; quickJoinIndex2 < potentialNewRoommates.Size(); quickJoinIndex2++)
-					{
-						roomsErrorCode = roomCreationParameters.roomOutput->JoinByQuickJoin(potentialNewRoommates[quickJoinIndex2]->roomsParticipant, RMM_PUBLIC, &joinedRoomResult);
-						RakAssert(roomsErrorCode==REC_SUCCESS);
-						RemoveUserFromQuickJoin(potentialNewRoommates[quickJoinIndex2]->roomsParticipant, &qju);
-						dereferencedPointers.Insert(qju, _FILE_AND_LINE_ );
-						joinedRoomResult.joiningMember=potentialNewRoommates[quickJoinIndex2]->roomsParticipant;
-						joinedRoomMembers.Insert(joinedRoomResult, _FILE_AND_LINE_ );
-					}
-
-					joinedRoomResult.joiningMember=quickJoinMember->roomsParticipant;
-					joinedRoomMembers.Insert(joinedRoomResult, _FILE_AND_LINE_ );
-					RemoveUserFromQuickJoin(quickJoinMember->roomsParticipant, &qju);
-					dereferencedPointers.Insert(qju, _FILE_AND_LINE_ );
-					continue;
-				}
-			}
+		if (quickJoinMemberTimeSort.Size() < roommatesNeeded)
+		{
+			// Fewer members wait on every pass, so this will not succeed for another member of the bucket either
+			newRoomMatch->failed=true;
+			quickJoinIndex++;
+			continue;
 		}
 
-		quickJoinIndex++;
-	}
+		// 5. If the longest waiting members of these buckets satisfy minimumPlayers, have that user create a room and those members join.
+		potentialNewRoommates.Clear(true, _FILE_AND_LINE_ );
+		for (userIndex=0; userIndex < roommatesNeeded; userIndex++)
+			potentialNewRoommates.Insert(quickJoinMemberTimeSort[userIndex], _FILE_AND_LINE_ );
+
+		JoinedRoomResult joinedRoomResult;
+		roomCreationParameters.networkedRoomCreationParameters.slots.publicSlots=roommatesNeeded;
+		roomCreationParameters.networkedRoomCreationParameters.hiddenFromSearches=false;
+		roomCreationParameters.networkedRoomCreationParameters.destroyOnModeratorLeave=false;
+		roomCreationParameters.networkedRoomCreationParameters.roomName.Set(QUICK_JOIN_ROOM_NAME "%i", startingRoomId+numRoomsCreated);
+		roomCreationParameters.firstUser=quickJoinMember->roomsParticipant;
+
+		roomsErrorCode = CreateRoom(&roomCreationParameters, 0,startingRoomId+numRoomsCreated, false);
+		joinedRoomResult.roomOutput=roomCreationParameters.roomOutput;
+		numRoomsCreated++;
+		RakAssert(roomsErrorCode==REC_SUCCESS);
+
+		for (userIndex=0; userIndex < potentialNewRoommates.Size(); userIndex++)
+		{
+			roomsErrorCode = roomCreationParameters.roomOutput->JoinByQuickJoin(potentialNewRoommates[userIndex]->roomsParticipant, RMM_PUBLIC, &joinedRoomResult);
+			RakAssert(roomsErrorCode==REC_SUCCESS);
+			RemoveUserFromQuickJoin(potentialNewRoommates[userIndex]->roomsParticipant, &qju);
+			dereferencedPointers.Insert(qju, _FILE_AND_LINE_ );
+			joinedRoomResult.joiningMember=potentialNewRoommates[userIndex]->roomsParticipant;
+			joinedRoomMembers.Insert(joinedRoomResult, _FILE_AND_LINE_ );
+		}
 
+		joinedRoomResult.joiningMember=quickJoinMember->roomsParticipant;
+		joinedRoomMembers.Insert(joinedRoomResult, _FILE_AND_LINE_ );
+		RemoveUserFromQuickJoin(quickJoinMember->roomsParticipant, &qju);
+		dereferencedPointers.Insert(qju, _FILE_AND_LINE_ );
+
+		// The last member was moved to quickJoinIndex, so do not advance
+	}
 
-	// 5. Remove from list if timeout has expired.
+	// 6. Remove from list if timeout has expired.
 	quickJoinIndex=0;
 	while (quickJoinIndex < quickJoinList.Size())
 	{
@@ -1178,14 +1270,345 @@ unsigned PerGameRoomsContainer::ProcessQuickJoins( DataStructures::List<QuickJoi
 			quickJoinList[quickJoinIndex]->roomsParticipant->SetInQuickJoin(false);
 			timeoutExpired.Insert(quickJoinList[quickJoinIndex], _FILE_AND_LINE_ );
 			dereferencedPointers.Insert(quickJoinList[quickJoinIndex], _FILE_AND_LINE_ );
-			quickJoinList.RemoveAtIndexFast(quickJoinIndex);
+			RemoveQuickJoinUser(quickJoinIndex);
 		}
 		else
 			quickJoinIndex++;
 	}
 
+	DeleteEmptyQuickJoinBuckets();
+
 	return numRoomsCreated;
 }
+void PerGameRoomsContainer::OnRoomPropertiesChanged(Room *room, unsigned int firstColumn, unsigned int lastColumn)
+{
+	if (filteredColumnsDirty)
+		UpdateFilteredColumns();
+
+	bool anyColumn = lastColumn==(unsigned int) -1;
+	if (lastColumn >= roomsTable.GetColumnCount())
+		lastColumn = roomsTable.GetColumnCount()-1;
+	bool isIndexed=false, isFiltered=anyColumn;
+	unsigned int columnIndex;
+	for (columnIndex=firstColumn; columnIndex <= lastColumn; columnIndex++)
+	{
+		if (roomsTable.GetIndexType(columnIndex)!=DataStructures::Table::INDEX_NONE)
+			isIndexed=true;
+		if (filteredColumns[columnIndex])
+			isFiltered=true;
+	}
+
+	// Other searches use the indexes right away, so they are updated here rather than in ProcessQuickJoins
+	if (isIndexed)
+		roomsTable.UpdateIndexes(room->GetID());
+	if (isFiltered && room->propertiesChanged==false)
+	{
+		room->propertiesChanged=true;
+		changedRooms.Insert(room, _FILE_AND_LINE_ );
+	}
+}
+void PerGameRoomsContainer::UpdateFilteredColumns(void)
+{
+	filteredColumns.Clear(true, _FILE_AND_LINE_ );
+	unsigned int columnIndex, bucketIndex, queryIndex;
+	for (columnIndex=0; columnIndex < roomsTable.GetColumnCount(); columnIndex++)
+		filteredColumns.Insert(false, _FILE_AND_LINE_ );
+	for (bucketIndex=0; bucketIndex < quickJoinBucketList.Size(); bucketIndex++)
+	{
+		QuickJoinBucket *bucket = quickJoinBucketList[bucketIndex];
+		for (queryIndex=0; queryIndex < bucket->numQueries; queryIndex++)
+		{
+			columnIndex = bucket->queries[queryIndex].columnName[0] ? roomsTable.ColumnIndex(bucket->queries[queryIndex].columnName) : bucket->queries[queryIndex].columnIndex;
+			if (columnIndex < filteredColumns.Size())
+				filteredColumns[columnIndex]=true;
+		}
+	}
+	filteredColumnsDirty=false;
+}
+void PerGameRoomsContainer::GetQuerySignature(RoomQuery *roomQuery, SLNet::RakString *signature)
+{
+	// Lengths are written before names and values, so different queries never get the same signature
+	signature->Clear();
+	SLNet::RakString field;
+	unsigned int queryIndex;
+	for (queryIndex=0; queryIndex < roomQuery->numQueries; queryIndex++)
+	{
+		DataStructures::Table::FilterQuery *filterQuery = &roomQuery->queries[queryIndex];
+		DataStructures::Table::Cell *cell = filterQuery->cellValue;
+		if (filterQuery->columnName[0])
+			field.Set("%u:%s,%i,", (unsigned int) strlen(filterQuery->columnName), filterQuery->columnName, (int) filterQuery->operation);
+		else
+			field.Set("#%u,%i,", filterQuery->columnIndex, (int) filterQuery->operation);
+		*signature+=field;
+
+		if (cell==0 || cell->isEmpty)
+			*signature+="e;";
+		else if (cell->EstimateColumnType()==DataStructures::Table::NUMERIC)
+		{
+			field.Set("n%.17g;", cell->i);
+			*signature+=field;
+		}
+		else if (cell->EstimateColumnType()==DataStructures::Table::POINTER)
+		{
+			field.Set("p%p;", cell->ptr);
+			*signature+=field;
+		}
+		else
+		{
+			// Strings and binary data, as hex
+			field.Set("b%i:", (int) cell->i);
+			*signature+=field;
+			int i;
+			for (i=0; i < (int) cell->i; i++)
+			{
+				field.Set("%02x", (unsigned char) cell->c[i]);
+				*signature+=field;
+			}
+			*signature+=';';
+		}
+	}
+}
+void PerGameRoomsContainer::AddToQuickJoinBucket(QuickJoinUser *quickJoinMember)
+{
+	SLNet::RakString signature;
+	GetQuerySignature(&quickJoinMember->networkedQuickJoinUser.query, &signature);
+
+	QuickJoinBucket *bucket;
+	DataStructures::HashIndex hashIndex = quickJoinBuckets.GetIndexOf(signature);
+	if (hashIndex.IsInvalid()==false)
+	{
+		bucket = quickJoinBuckets.ItemAtIndex(hashIndex);
+		bucket->AddUser(quickJoinMember);
+		return;
+	}
+
+	bucket = new QuickJoinBucket(signature, &quickJoinMember->networkedQuickJoinUser.query);
+	bucket->bucketListIndex=quickJoinBucketList.Size();
+	quickJoinBucketList.Insert(bucket, _FILE_AND_LINE_ );
+	quickJoinBuckets.Push(signature, bucket, _FILE_AND_LINE_ );
+	bucket->AddUser(quickJoinMember);
+	filteredColumnsDirty=true;
+
+	// Index the columns users filter on, so matching a new bucket does not check every room
+	unsigned int queryIndex;
+	for (queryIndex=0; queryIndex < bucket->numQueries; queryIndex++)
+	{
+		unsigned int columnIndex = bucket->queries[queryIndex].columnName[0] ? roomsTable.ColumnIndex(bucket->queries[queryIndex].columnName) : bucket->queries[queryIndex].columnIndex;
+		if (columnIndex < roomsTable.GetColumnCount() &&
+			bucket->queries[queryIndex].operation!=DataStructures::Table::QF_NOT_EQUAL &&
+			bucket->queries[queryIndex].operation!=DataStructures::Table::QF_IS_EMPTY &&
+			bucket->queries[queryIndex].operation!=DataStructures::Table::QF_NOT_EMPTY &&
+			roomsTable.GetIndexType(columnIndex)==DataStructures::Table::INDEX_NONE)
+			roomsTable.AddIndex(columnIndex, DataStructures::Table::INDEX_SORTED);
+	}
+
+	DataStructures::Table resultTable;
+	unsigned columnIndices[1];
+	columnIndices[0]=DefaultRoomColumns::TC_LOBBY_ROOM_PTR;
+	roomsTable.QueryTable(columnIndices,1,bucket->queries,bucket->numQueries,0,0,&resultTable);
+	DataStructures::Page<unsigned, DataStructures::Table::Row*, _TABLE_BPLUS_TREE_ORDER> *cur = resultTable.GetRows().GetListHead();
+	int i;
+	while (cur)
+	{
+		for (i=0; i < cur->size; i++)
+			SetBucketMatchesRoom(bucket, (Room*) cur->data[i]->cells[0]->ptr, true);
+		cur=cur->next;
+	}
+}
+void PerGameRoomsContainer::RemoveQuickJoinUser(unsigned int quickJoinIndex)
+{
+	QuickJoinUser *qju = quickJoinList[quickJoinIndex];
+	if (qju->quickJoinBucket)
+		qju->quickJoinBucket->RemoveUser(qju);
+	qju->roomsParticipant->SetQuickJoinUser(0);
+	qju->quickJoinListIndex=(unsigned int) -1;
+
+	// Move the last member into the gap
+	quickJoinList.RemoveAtIndexFast(quickJoinIndex);
+	if (quickJoinIndex < quickJoinList.Size())
+		quickJoinList[quickJoinIndex]->quickJoinListIndex=quickJoinIndex;
+}
+void PerGameRoomsContainer::UpdateQuickJoinBuckets(void)
+{
+	if (changedRooms.Size()==0)
+		return;
+
+	unsigned int roomIndex, bucketIndex;
+	DataStructures::List<unsigned> changedRoomIds;
+	for (roomIndex=0; roomIndex < changedRooms.Size(); roomIndex++)
+	{
+		changedRooms[roomIndex]->propertiesChanged=false;
+		changedRoomIds.Insert(changedRooms[roomIndex]->GetID(), _FILE_AND_LINE_ );
+	}
+
+	// Only the changed rooms are matched against the buckets
+	DataStructures::Table resultTable;
+	unsigned columnIndices[1];
+	columnIndices[0]=DefaultRoomColumns::TC_LOBBY_ROOM_PTR;
+	for (bucketIndex=0; bucketIndex < quickJoinBucketList.Size(); bucketIndex++)
+	{
+		QuickJoinBucket *bucket = quickJoinBucketList[bucketIndex];
+		roomsTable.QueryTable(columnIndices,1,bucket->queries,bucket->numQueries,&changedRoomIds[0],changedRoomIds.Size(),&resultTable);
+		for (roomIndex=0; roomIndex < changedRooms.Size(); roomIndex++)
+			SetBucketMatchesRoom(bucket, changedRooms[roomIndex], resultTable.GetRowByID(changedRoomIds[roomIndex])!=0);
+	}
+	changedRooms.Clear(true, _FILE_AND_LINE_ );
+}
+void PerGameRoomsContainer::SetBucketMatchesRoom(QuickJoinBucket *bucket, Room *room, bool matches)
+{
+	bool objectExists;
+	unsigned int index = bucket->matchingRooms.GetIndexFromKey(room->GetID(), &objectExists);
+	if (matches==objectExists)
+		return;
+	if (matches)
+	{
+		bucket->matchingRooms.InsertAtIndex(room, index, _FILE_AND_LINE_ );
+		room->quickJoinBuckets.Insert(bucket, _FILE_AND_LINE_ );
+	}
+	else
+	{
+		bucket->matchingRooms.RemoveAtIndex(index);
+		room->quickJoinBuckets.RemoveAtIndexFast(room->quickJoinBuckets.GetIndexOf(bucket));
+	}
+}
+void PerGameRoomsContainer::DeleteEmptyQuickJoinBuckets(void)
+{
+	unsigned int bucketIndex=0;
+	while (bucketIndex < quickJoinBucketList.Size())
+	{
+		QuickJoinBucket *bucket = quickJoinBucketList[bucketIndex];
+		if (bucket->numUsers>0)
+		{
+			bucketIndex++;
+			continue;
+		}
+
+		while (bucket->matchingRooms.Size())
+			SetBucketMatchesRoom(bucket, bucket->matchingRooms[bucket->matchingRooms.Size()-1], false);
+		quickJoinBuckets.Remove(bucket->signature, _FILE_AND_LINE_ );
+		quickJoinBucketList.RemoveAtIndexFast(bucketIndex);
+		filteredColumnsDirty=true;
+		if (bucketIndex < quickJoinBucketList.Size())
+			quickJoinBucketList[bucketIndex]->bucketListIndex=bucketIndex;
+		delete bucket;
+	}
+}
+// Rooms that members would create if they have the same custom columns
+struct PotentialNewRooms
+{
+	SLNet::RakString columnSignature;
+	DataStructures::Table table;
+	// By row ID
+	DataStructures::List<QuickJoinBucket::NewRoomMatch*> newRoomMatches;
+};
+void PerGameRoomsContainer::MatchNewRooms(void)
+{
+	unsigned int bucketIndex, quickJoinIndex, queryIndex, groupIndex;
+	for (bucketIndex=0; bucketIndex < quickJoinBucketList.Size(); bucketIndex++)
+		quickJoinBucketList[bucketIndex]->ClearNewRoomMatches();
+
+	// Every member of a bucket has the same query, so the room it would create only depends on minimumPlayers.
+	// Rooms with the same columns go in one table, so each bucket is matched against all of them with one query.
+	DataStructures::List<PotentialNewRooms*> groups;
+	SLNet::RakString columnSignature;
+	for (quickJoinIndex=0; quickJoinIndex < quickJoinList.Size(); quickJoinIndex++)
+	{
+		QuickJoinUser *quickJoinMember = quickJoinList[quickJoinIndex];
+		QuickJoinBucket *creatorBucket = quickJoinMember->quickJoinBucket;
+		if (creatorBucket->GetNewRoomMatch(quickJoinMember->networkedQuickJoinUser.minimumPlayers))
+			continue;
+
+		QuickJoinBucket::NewRoomMatch *newRoomMatch = new QuickJoinBucket::NewRoomMatch;
+		newRoomMatch->minimumPlayers=quickJoinMember->networkedQuickJoinUser.minimumPlayers;
+		newRoomMatch->failed=false;
+		creatorBucket->newRoomMatches.Insert(newRoomMatch, _FILE_AND_LINE_ );
+
+		// For all filters that are equal and custom, create a table with rows with these values
+		DataStructures::List<unsigned int> customQueries;
+		columnSignature.Clear();
+		for (queryIndex=0; queryIndex < creatorBucket->numQueries; queryIndex++)
+		{
+			DataStructures::Table::FilterQuery *filterQuery = &creatorBucket->queries[queryIndex];
+			if ( ( filterQuery->operation==DataStructures::Table::QF_EQUAL ) &&
+				DefaultRoomColumns::HasColumnName(filterQuery->columnName)==false &&
+				filterQuery->cellValue->isEmpty==false
+				)
+			{
+				unsigned int customIndex;
+				for (customIndex=0; customIndex < customQueries.Size(); customIndex++)
+					if (strcmp(creatorBucket->queries[customQueries[customIndex]].columnName, filterQuery->columnName)==0)
+						break;
+				if (customIndex < customQueries.Size())
+					continue;
+				customQueries.Insert(queryIndex, _FILE_AND_LINE_ );
+				SLNet::RakString column;
+				column.Set("%u:%s,%i;", (unsigned int) strlen(filterQuery->columnName), filterQuery->columnName, (int) filterQuery->cellValue->EstimateColumnType());
+				columnSignature+=column;
+			}
+		}
+
+		PotentialNewRooms *group=0;
+		for (groupIndex=0; groupIndex < groups.Size(); groupIndex++)
+		{
+			if (groups[groupIndex]->columnSignature==columnSignature)
+			{
+				group=groups[groupIndex];
+				break;
+			}
+		}
+		if (group==0)
+		{
+			group = new PotentialNewRooms;
+			group->columnSignature=columnSignature;
+			DefaultRoomColumns::AddDefaultColumnsToTable(&group->table);
+			for (queryIndex=0; queryIndex < customQueries.Size(); queryIndex++)
+				group->table.AddColumn(creatorBucket->queries[customQueries[queryIndex]].columnName, creatorBucket->queries[customQueries[queryIndex]].cellValue->EstimateColumnType());
+			groups.Insert(group, _FILE_AND_LINE_ );
+		}
+
+		DataStructures::Table::Row *row = group->table.AddRow(group->newRoomMatches.Size());
+		group->newRoomMatches.Insert(newRoomMatch, _FILE_AND_LINE_ );
+		Slots slots;
+		slots.publicSlots=newRoomMatch->minimumPlayers-1;
+		Room::UpdateRowSlots( row, &slots, &slots);
+		for (queryIndex=0; queryIndex < customQueries.Size(); queryIndex++)
+			*(row->cells[DefaultRoomColumns::TC_TABLE_COLUMNS_COUNT+queryIndex]) = *(creatorBucket->queries[customQueries[queryIndex]].cellValue);
+	}
+
+	DataStructures::Table resultTable;
+	unsigned columnIndices[1];
+	columnIndices[0]=DefaultRoomColumns::TC_TOTAL_SLOTS;
+	DataStructures::Table::FilterQuery subQueries[DefaultRoomColumns::TC_TABLE_COLUMNS_COUNT+MAX_CUSTOM_QUERY_FIELDS];
+	for (groupIndex=0; groupIndex < groups.Size(); groupIndex++)
+	{
+		PotentialNewRooms *group = groups[groupIndex];
+		for (bucketIndex=0; bucketIndex < quickJoinBucketList.Size(); bucketIndex++)
+		{
+			QuickJoinBucket *bucket = quickJoinBucketList[bucketIndex];
+			if (bucket->numUsers==0)
+				continue;
+
+			// Filters on columns the new room does not have are ignored
+			unsigned int subQueryCount;
+			for (queryIndex=0, subQueryCount=0; queryIndex < bucket->numQueries && subQueryCount < sizeof(subQueries)/sizeof(subQueries[0]); queryIndex++)
+			{
+				if (group->table.ColumnIndex(bucket->queries[queryIndex].columnName)!=-1)
+					subQueries[subQueryCount++]=bucket->queries[queryIndex];
+			}
+
+			group->table.QueryTable(columnIndices,1,subQueries,subQueryCount,0,0,&resultTable);
+			DataStructures::Page<unsigned, DataStructures::Table::Row*, _TABLE_BPLUS_TREE_ORDER> *cur = resultTable.GetRows().GetListHead();
+			int i;
+			while (cur)
+			{
+				for (i=0; i < cur->size; i++)
+					group->newRoomMatches[cur->keys[i]]->roommateBuckets.Insert(bucket, _FILE_AND_LINE_ );
+				cur=cur->next;
+			}
+		}
+		delete group;
+	}
+}
 RoomsErrorCode PerGameRoomsContainer::GetInvitesToParticipant(RoomsParticipant* roomsParticipant, DataStructures::List<InvitedUser*> &invites)
 {
 	DataStructures::List<Room*> rooms;
@@ -1199,6 +1622,14 @@ bool PerGameRoomsContainer::DestroyRoomIfDead(Room *room)
 {
 	if (roomsTable.GetRowByID(room->GetID())==room->tableRow)
 	{
+		while (room->quickJoinBuckets.Size())
+			SetBucketMatchesRoom(room->quickJoinBuckets[room->quickJoinBuckets.Size()-1], room, false);
+		if (room->propertiesChanged)
+		{
+			unsigned int changedIndex = changedRooms.GetIndexOf(room);
+			if (changedIndex!=(unsigned int) -1)
+				changedRooms.RemoveAtIndexFast(changedIndex);
+		}
 		roomsTable.RemoveRow(room->GetID());
 		delete room;
 		return true;
@@ -1335,10 +1766,9 @@ void PerGameRoomsContainer::GetRoomNames(DataStructures::List<SLNet::RakString>
 
 unsigned int PerGameRoomsContainer::GetQuickJoinIndex(RoomsParticipant* roomsParticipant)
 {
-	unsigned int i;
-	for (i=0; i < quickJoinList.Size(); i++)
-		if (quickJoinList[i]->roomsParticipant==roomsParticipant)
-			return i;
+	QuickJoinUser *qju = roomsParticipant->GetQuickJoinUser();
+	if (qju && qju->quickJoinListIndex < quickJoinList.Size() && quickJoinList[qju->quickJoinListIndex]==qju)
+		return qju->quickJoinListIndex;
 	return (unsigned int) -1;
 }
 
@@ -1350,6 +1780,9 @@ Room::Room( RoomID _roomId, RoomCreationParameters *roomCreationParameters, Data
 
 	lobbyRoomId=_roomId;
 	tableRow=_row;
+	// Set by PerGameRoomsContainer::CreateRoom
+	perGameRoomsContainer=0;
+	propertiesChanged=false;
 	
 	autoLockReadyStatus=roomCreationParameters->networkedRoomCreationParameters.autoLockReadyStatus;
 	hiddenFromSearches=roomCreationParameters->networkedRoomCreationParameters.hiddenFromSearches;
@@ -1408,6 +1841,7 @@ void Room::UpdateUsedSlots( DataStructures::Table::Row* tableRow, Slots *totalSl
 void Room::UpdateUsedSlots( Slots *totalSlots, Slots *usedSlots )
 {
 	UpdateUsedSlots(tableRow, totalSlots, usedSlots);
+	OnPropertiesChanged(DefaultRoomColumns::TC_USED_SLOTS, DefaultRoomColumns::TC_REMAINING_SPECTATOR_SLOTS);
 }
 Slots Room::GetTotalSlots(void) const
 {
@@ -1743,6 +2177,7 @@ RoomsErrorCode Room::SetDestroyOnModeratorLeave(RoomsParticipant* roomsParticipa
 		return REC_SET_DESTROY_ON_MODERATOR_LEAVE_MUST_BE_MODERATOR;
 
 	tableRow->cells[DefaultRoomColumns::TC_DESTROY_ON_MODERATOR_LEAVE]->Set((int) destroyOnModeratorLeave);
+	OnPropertiesChanged(DefaultRoomColumns::TC_DESTROY_ON_MODERATOR_LEAVE, DefaultRoomColumns::TC_DESTROY_ON_MODERATOR_LEAVE);
 	return REC_SUCCESS;
 }
 RoomsErrorCode Room::SetReadyStatus(RoomsParticipant* roomsParticipant, bool isReady)
@@ -2074,10 +2509,17 @@ const char *Room::GetStringProperty(int index) const
 void Room::SetNumericProperty(int index, double value)
 {
 	tableRow->cells[index]->Set(value);
+	OnPropertiesChanged(index, index);
 }
 void Room::SetStringProperty(int index, const char *value)
 {
 	tableRow->cells[index]->Set(value);
+	OnPropertiesChanged(index, index);
+}
+void Room::OnPropertiesChanged(unsigned int firstColumn, unsigned int lastColumn)
+{
+	if (perGameRoomsContainer)
+		perGameRoomsContainer->OnRoomPropertiesChanged(this, firstColumn, lastColumn);
 }
 RoomsErrorCode Room::RemoveUser(RoomsParticipant* roomsParticipant,RemoveUserResult *removeUserResult)
 {
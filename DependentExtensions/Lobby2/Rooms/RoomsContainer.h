@@ -18,6 +18,8 @@
 
 #include "slikenet/DS_Map.h"
 #include "slikenet/DS_Table.h"
+#include "slikenet/DS_Hash.h"
+#include "slikenet/DS_OrderedList.h"
 #include "RoomsErrorCodes.h"
 #include "slikenet/DS_List.h"
 #include "slikenet/types.h"
@@ -33,13 +35,14 @@ class PerGameRoomsContainer;
 class BitStream;
 typedef unsigned int RoomID;
 struct QuickJoinUser;
+struct QuickJoinBucket;
 struct RoomMember;
 class AllGamesRoomsContainer;
 
 class RoomsParticipant
 {
 public:
-	RoomsParticipant() {room=0; inQuickJoin=false;}
+	RoomsParticipant() {room=0; inQuickJoin=false; quickJoinUser=0;}
 	~RoomsParticipant() {}
 	Room * GetRoom(void) const {return room;}
 	void SetPerGameRoomsContainer(PerGameRoomsContainer *p) {perGameRoomsContainer=p;}
@@ -56,6 +59,10 @@ public:
 
 	PerGameRoomsContainer *GetPerGameRoomsContainer(void) const {return perGameRoomsContainer;}
 	bool GetInQuickJoin(void) const {return inQuickJoin;}
+
+	// Internal - the entry in the quick join list of the PerGameRoomsContainer, if any
+	void SetQuickJoinUser(QuickJoinUser *qju) {quickJoinUser=qju;}
+	QuickJoinUser *GetQuickJoinUser(void) const {return quickJoinUser;}
 protected:
 	SLNet::RakString name;
 	SystemAddress systemAddress;
@@ -63,6 +70,7 @@ protected:
 	Room *room;
 	bool inQuickJoin;
 	PerGameRoomsContainer *perGameRoomsContainer;
+	QuickJoinUser *quickJoinUser;
 };
 
 typedef SLNet::RakString GameIdentifier;
@@ -334,6 +342,51 @@ struct QuickJoinUser
 	RoomsParticipant* roomsParticipant;
 	static int SortByTotalTimeWaiting( QuickJoinUser* const &key, QuickJoinUser* const &data );
 	static int SortByMinimumSlots( QuickJoinUser* const &key, QuickJoinUser* const &data );
+
+	// Internal - index into PerGameRoomsContainer::quickJoinList, and the bucket of users with the same query
+	unsigned int quickJoinListIndex;
+	QuickJoinBucket *quickJoinBucket;
+	unsigned int quickJoinBucketIndex;
+};
+
+// Internal - quick join users with the same room query
+// Rooms are matched against the query once for all users in the bucket, and only rooms whose properties changed are matched again.
+struct QuickJoinBucket
+{
+	QuickJoinBucket(const SLNet::RakString &_signature, RoomQuery *roomQuery);
+	~QuickJoinBucket();
+
+	void AddUser(QuickJoinUser *qju);
+	void RemoveUser(QuickJoinUser *qju);
+	static int RoomComp( const RoomID &key, Room* const &data );
+
+	SLNet::RakString signature;
+
+	// Copy of the query, as users come and go
+	DataStructures::Table::FilterQuery *queries;
+	DataStructures::Table::Cell *queryCells;
+	unsigned int numQueries;
+
+	// In the order they were added, which is longest waiting first. Removed users leave a 0 behind until the list is compacted.
+	DataStructures::List<QuickJoinUser*> users;
+	unsigned int firstUserIndex;
+	unsigned int numUsers;
+	// Index into PerGameRoomsContainer::quickJoinBucketList
+	unsigned int bucketListIndex;
+
+	// Rooms whose properties pass the query
+	DataStructures::OrderedList<RoomID, Room*, RoomComp> matchingRooms;
+
+	// Used when creating rooms. For a room created by a member of this bucket with a given minimumPlayers, which buckets would join it.
+	struct NewRoomMatch
+	{
+		int minimumPlayers;
+		bool failed;
+		DataStructures::List<QuickJoinBucket*> roommateBuckets;
+	};
+	DataStructures::List<NewRoomMatch*> newRoomMatches;
+	NewRoomMatch* GetNewRoomMatch(int minimumPlayers);
+	void ClearNewRoomMatches(void);
 };
 
 int RoomPriorityComp( Room * const &key, Room * const &data );
@@ -397,20 +450,18 @@ class AllGamesRoomsContainer
 	//
 	// -- ROOM JOIN --
 	//
+	// Quick join members are kept in buckets of members with the same query. Each bucket knows which rooms pass its query.
+	// Columns used by the queries are indexed in the rooms table.
+	// 1. For all rooms whose properties changed since the last call, match the room against the query of every bucket
 	// For all rooms:
-	// 1. Clear all quickJoinWorkingList from all rooms
-	// For all quick join members
-	// 2. Use RoomPrioritySort to get all rooms they can potentially join
-	// 3. For each of these rooms, record that this member can potentially join by storing a copy of the pointer into quickJoinWorkingList, if minimumPlayers => total room slots
-	// For all rooms:
-	// 4. For each room where there are enough potential quick join members to fill the room, join all those members at once. Remove these members from the quick join list. Go to 1.
+	// 2. Collect the longest waiting members of the buckets that match the room, that can join the room, if minimumPlayers => total room slots
+	// 3. If there are enough of these members to fill the room, join all those members at once. Remove these members from the quick join list.
 	//
 	// -- ROOM CREATE --
 	//
-	// 5. Sort quick join members by minimumPlayers, excluding members where minimumPlayers > total number of quick join members
-	// From greatest minimumPlayers to least
-	// 6. If the current member created a room, find out how many subsequent members would join based on the custom filter
-	// 7. If this satisfies minimumPlayers, have that user create a room and those subsequent members join.
+	// For all quick join members, excluding members where minimumPlayers > total number of quick join members
+	// 4. If the current member created a room, find out which buckets would join based on the custom filter. This is done once per bucket and minimumPlayers.
+	// 5. If the longest waiting members of these buckets satisfy minimumPlayers, have that user create a room and those members join.
 	// 
 	// -- EXPIRE
 	//
@@ -475,6 +526,10 @@ public:
 	DataStructures::List<QuickJoinUser*> quickJoinList;
 
 	static int RoomsSortByTimeThenTotalSlots( Room* const &key, Room* const &data );
+
+	// Internal - call when cells from firstColumn to lastColumn of the table row of a room were changed
+	// Pass lastColumn=(unsigned int) -1 for new rooms, or when any cell may have changed
+	void OnRoomPropertiesChanged(Room *room, unsigned int firstColumn, unsigned int lastColumn);
 				
 	protected:
 
@@ -510,8 +565,26 @@ public:
 	
 	RoomsErrorCode SearchByFilter( RoomsParticipant* roomsParticipant, RoomQuery *roomQuery, DataStructures::OrderedList<Room*, Room*, AllGamesRoomsContainer::RoomsSortByName> &roomsOutput, bool onlyJoinable );
 
+	// Quick join buckets
+	void AddToQuickJoinBucket(QuickJoinUser *quickJoinMember);
+	void RemoveQuickJoinUser(unsigned int quickJoinIndex);
+	void UpdateQuickJoinBuckets(void);
+	void SetBucketMatchesRoom(QuickJoinBucket *bucket, Room *room, bool matches);
+	void DeleteEmptyQuickJoinBuckets(void);
+	void UpdateFilteredColumns(void);
+	void MatchNewRooms(void);
+	static void GetQuerySignature(RoomQuery *roomQuery, SLNet::RakString *signature);
+
 	friend class AllGamesRoomsContainer;
 	IntervalTimer nextQuickJoinProcess;
+
+	DataStructures::Hash<SLNet::RakString, QuickJoinBucket*, 256, SLNet::RakString::ToInteger> quickJoinBuckets;
+	DataStructures::List<QuickJoinBucket*> quickJoinBucketList;
+	// Rooms whose properties changed since the buckets were last updated
+	DataStructures::List<Room*> changedRooms;
+	// Columns the buckets filter on. Changes to other columns do not affect which rooms a bucket matches.
+	DataStructures::List<bool> filteredColumns;
+	bool filteredColumnsDirty;
 };
 
 // Holds all the members of a particular roomOutput
@@ -577,8 +650,8 @@ class Room
 		// Don't store - slow because when removing users I have to iterate through every room
 		// DataStructures::List<KickedUser> kickedList;
 		
-		// Internal
-		DataStructures::List<QuickJoinUser*> quickJoinWorkingList;
+		// Internal - quick join buckets whose query this room passes
+		DataStructures::List<QuickJoinBucket*> quickJoinBuckets;
 		
 		static void UpdateRowSlots( DataStructures::Table::Row* row, Slots *totalSlots, Slots *usedSlots);
 
@@ -618,6 +691,10 @@ protected:
 
 		RoomID lobbyRoomId;
 		DataStructures::Table::Row *tableRow;
+		// Told when tableRow changes
+		PerGameRoomsContainer *perGameRoomsContainer;
+		bool propertiesChanged;
+		void OnPropertiesChanged(unsigned int firstColumn, unsigned int lastColumn);
 
 		bool autoLockReadyStatus;
 		bool hiddenFromSearches;
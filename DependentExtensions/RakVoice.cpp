@@ -22,6 +22,7 @@
 #include "slikenet/BitStream.h"
 #include "slikenet/peerinterface.h"
 #include <stdlib.h>
+#include <math.h>
 #include "slikenet/GetTime.h"
 
 #ifdef _DEBUG
@@ -55,6 +56,7 @@ RakVoice::RakVoice()
 	defaultDENOISEState=false;
 	defaultVBRState=false;
 	loopbackMode=false;
+	forwardingServer=UNASSIGNED_RAKNET_GUID;
 }
 RakVoice::~RakVoice()
 {
@@ -109,6 +111,50 @@ bool RakVoice::IsLoopbackMode(void) const
 {
 	return loopbackMode;
 }
+void RakVoice::SetForwardingServer(RakNetGUID server)
+{
+	if (server==forwardingServer)
+		return;
+
+	if (forwardingServer!=UNASSIGNED_RAKNET_GUID)
+	{
+		CloseVoiceChannel(forwardingServer);
+		FreeForwardedChannels();
+	}
+
+	forwardingServer=server;
+	if (forwardingServer!=UNASSIGNED_RAKNET_GUID)
+		RequestVoiceChannel(forwardingServer);
+}
+RakNetGUID RakVoice::GetForwardingServer(void) const
+{
+	return forwardingServer;
+}
+void RakVoice::ListenToForwardedChannel(unsigned int channel)
+{
+	SendForwardingChannelRequest(RVF_LISTEN, channel);
+}
+void RakVoice::StopListeningToForwardedChannel(unsigned int channel)
+{
+	SendForwardingChannelRequest(RVF_STOP_LISTENING, channel);
+}
+void RakVoice::SetForwardedTalkChannel(unsigned int channel)
+{
+	SendForwardingChannelRequest(RVF_TALK, channel);
+}
+void RakVoice::SendForwardingChannelRequest(RakVoiceForwardingMessage request, unsigned int channel)
+{
+	RakAssert(forwardingServer!=UNASSIGNED_RAKNET_GUID);
+	if (forwardingServer==UNASSIGNED_RAKNET_GUID)
+		return;
+
+	// Same ordering channel as the channel requests, so the server knows the sample rate first
+	SLNet::BitStream out;
+	out.Write((unsigned char)ID_RAKVOICE_FORWARDING);
+	out.Write((unsigned char)request);
+	out.Write(channel);
+	SendUnified(&out, HIGH_PRIORITY, RELIABLE_ORDERED,0,forwardingServer,false);
+}
 void RakVoice::RequestVoiceChannel(RakNetGUID recipient)
 {
 	// Send a reliable ordered message to the other system to open a voice channel
@@ -135,7 +181,8 @@ void RakVoice::CloseAllChannels(void)
 	unsigned index;
 	for (index=0; index < voiceChannels.Size(); index++)
 	{
-		SendUnified(&out, HIGH_PRIORITY, RELIABLE_ORDERED,0,voiceChannels[index]->guid,false);	
+		if (voiceChannels[index]->isForwarded==false)
+			SendUnified(&out, HIGH_PRIORITY, RELIABLE_ORDERED,0,voiceChannels[index]->guid,false);	
 		FreeChannelMemory(index,false);
 	}
 
@@ -148,7 +195,7 @@ bool RakVoice::SendFrame(RakNetGUID recipient, void *inputBuffer)
 	VoiceChannel *channel;
 
 	index = voiceChannels.GetIndexFromKey(recipient, &objectExists);
-	if (objectExists)
+	if (objectExists && voiceChannels[index]->isForwarded==false)
 	{
 		unsigned totalBufferSize;
 		unsigned remainingBufferSize;
@@ -332,8 +379,8 @@ void RakVoice::Update(void)
 	char tempOutput[2048];
 	// 1 byte for ID, and 2 bytes(short) for Message number
 	static const int headerSize=sizeof(unsigned char) + sizeof(unsigned short);
-	// First byte is ID for RakNet
-	tempOutput[0]=ID_RAKVOICE_DATA;
+	// RVF_UPLOAD and the audio level come between the ID and the message number
+	static const int forwardingHeaderSize=headerSize + 2*sizeof(unsigned char);
 	
 	SLNet::TimeMS currentTime = SLNet::GetTimeMS();
 
@@ -355,7 +402,7 @@ void RakVoice::Update(void)
 	{
 		channel=voiceChannels[i];
 
-		if (currentTime - channel->lastSend > 50) // Throttle to 20 sends a second
+		if (channel->isForwarded==false && currentTime - channel->lastSend > 50) // Throttle to 20 sends a second
 		{
 			channel->isSendingVoiceData=false;
 
@@ -402,6 +449,10 @@ void RakVoice::Update(void)
 			// Encode all available frames and send them unreliable sequenced
 			if (speexFramesAvailable > 0)
 			{
+				// Voice sent to a forwarding server is encoded once, and carries the audio level so the server can pick the loudest speakers
+				bool toForwardingServer = forwardingServer!=UNASSIGNED_RAKNET_GUID && channel->guid==forwardingServer;
+				int channelHeaderSize = toForwardingServer ? forwardingHeaderSize : headerSize;
+
 				SpeexBits speexBits;
 				speex_bits_init(&speexBits);
 				while (speexFramesAvailable-- > 0)
@@ -447,6 +498,11 @@ void RakVoice::Update(void)
 #endif
 					int is_speech=1;
 
+					// Measure before the preprocessor changes the input
+					unsigned char audioLevel=0;
+					if (toForwardingServer)
+						audioLevel=GetAudioLevel((short*) inputBuffer, speexBlockSize / SAMPLESIZE);
+
 					// Run preprocessor if required
 					if (defaultDENOISEState||defaultVADState){
 						is_speech=speex_preprocess((SpeexPreprocessState*)channel->pre_state,(spx_int16_t*) inputBuffer, nullptr);
@@ -469,11 +525,11 @@ void RakVoice::Update(void)
 //					printf("Update: bytesAvailable=%i writeIndex=%i readIndex=%i\n",bytesAvailable, channel->outgoingWriteIndex, channel->outgoingReadIndex);
 #endif
 
-					bytesWritten = speex_bits_write(&speexBits, tempOutput+headerSize, 2048-headerSize);
+					bytesWritten = speex_bits_write(&speexBits, tempOutput+channelHeaderSize, 2048-channelHeaderSize);
 #ifdef _DEBUG
 					// If this assert hits then you need to increase the size of the temp buffer, but this is really a bug because
 					// voice packets should never be bigger than a few hundred bytes.
-					RakAssert(bytesWritten!=2048-headerSize);
+					RakAssert(bytesWritten!=2048-channelHeaderSize);
 #endif
 
 //					static int bytesSent=0;
@@ -485,13 +541,25 @@ static int voicePacketsSent=0;
 printf("%i ", voicePacketsSent++);
 #endif
 
-					// at +1, because the first byte in the buffer has the ID for RakNet.
-					memcpy(tempOutput+1, &channel->outgoingMessageNumber, sizeof(unsigned short));
+					// First byte is ID for RakNet
+					if (toForwardingServer)
+					{
+						tempOutput[0]=ID_RAKVOICE_FORWARDING;
+						tempOutput[1]=RVF_UPLOAD;
+						if (is_speech)
+							audioLevel|=RAKVOICE_AUDIO_LEVEL_VOICE_ACTIVITY;
+						tempOutput[2]=(char) audioLevel;
+					}
+					else
+						tempOutput[0]=ID_RAKVOICE_DATA;
+
+					// The message number comes right before the encoded frame
+					memcpy(tempOutput+channelHeaderSize-sizeof(unsigned short), &channel->outgoingMessageNumber, sizeof(unsigned short));
 					channel->outgoingMessageNumber++;
-					SLNet::BitStream tempOutputBs((unsigned char*) tempOutput,bytesWritten+headerSize,false);
+					SLNet::BitStream tempOutputBs((unsigned char*) tempOutput,bytesWritten+channelHeaderSize,false);
 					SendUnified(&tempOutputBs, HIGH_PRIORITY, UNRELIABLE,0,channel->guid,false);
 
-					if (loopbackMode)
+					if (loopbackMode && toForwardingServer==false)
 					{
 						Packet p;
 						p.length=bytesWritten+1;
@@ -576,10 +644,22 @@ PluginReceiveResult RakVoice::OnReceive(Packet *packet)
 		break;
 	case ID_RAKVOICE_CLOSE_CHANNEL:
 		FreeChannelMemory(packet->guid);
+		if (packet->guid==forwardingServer)
+		{
+			FreeForwardedChannels();
+			forwardingServer=UNASSIGNED_RAKNET_GUID;
+		}
 	break;
 	case ID_RAKVOICE_DATA:
 		OnVoiceData(packet);
 		return RR_STOP_PROCESSING_AND_DEALLOCATE;
+	case ID_RAKVOICE_FORWARDING:
+		if (packet->length > 1 && packet->data[1]==RVF_FORWARD)
+		{
+			OnForwardedVoiceData(packet);
+			return RR_STOP_PROCESSING_AND_DEALLOCATE;
+		}
+		break;
 	}
 
 	return RR_CONTINUE_PROCESSING;
@@ -592,6 +672,12 @@ void RakVoice::OnClosedConnection(const SystemAddress &systemAddress, RakNetGUID
 		CloseVoiceChannel(rakNetGUID);
 	else
 		FreeChannelMemory(rakNetGUID);
+
+	if (rakNetGUID==forwardingServer)
+	{
+		FreeForwardedChannels();
+		forwardingServer=UNASSIGNED_RAKNET_GUID;
+	}
 }
 
 void RakVoice::OnOpenChannelRequest(Packet *packet)
@@ -626,6 +712,7 @@ void RakVoice::OpenChannel(Packet *packet)
 	VoiceChannel *channel= SLNet::OP_NEW<VoiceChannel>( _FILE_AND_LINE_ );
 	channel->guid=packet->guid;
 	channel->isSendingVoiceData=false;
+	channel->isForwarded=false;
 	int newSampleRate;
 	in.Read(newSampleRate);
 	channel->remoteSampleRate=newSampleRate;
@@ -687,6 +774,73 @@ void RakVoice::OpenChannel(Packet *packet)
 
 	voiceChannels.Insert(packet->guid, channel, true, _FILE_AND_LINE_);
 }
+void RakVoice::OpenForwardedChannel(RakNetGUID speaker, int speakerSampleRate)
+{
+	VoiceChannel *channel= SLNet::OP_NEW<VoiceChannel>( _FILE_AND_LINE_ );
+	channel->guid=speaker;
+	channel->isSendingVoiceData=false;
+	channel->isForwarded=true;
+	channel->remoteSampleRate=speakerSampleRate;
+
+	// Nothing is sent on this channel, so only create the decoder
+	channel->enc_state=0;
+	channel->pre_state=0;
+	channel->speexOutgoingFrameSampleCount=0;
+	channel->outgoingBuffer=0;
+	channel->outgoingReadIndex=0;
+	channel->outgoingWriteIndex=0;
+	channel->outgoingMessageNumber=0;
+	channel->lastSend=0;
+
+	if (speakerSampleRate==8000)
+		channel->dec_state=speex_decoder_init(&speex_nb_mode);
+	else if (speakerSampleRate==16000)
+		channel->dec_state=speex_decoder_init(&speex_wb_mode);
+	else // 32000
+		channel->dec_state=speex_decoder_init(&speex_uwb_mode);
+	RakAssert(channel->dec_state);
+
+	SLNET_VERIFY(speex_decoder_ctl(channel->dec_state, SPEEX_GET_FRAME_SIZE, &channel->speexIncomingFrameSampleCount) == 0);
+	channel->incomingBuffer = (char*) rakMalloc_Ex(bufferSizeBytes * FRAME_INCOMING_BUFFER_COUNT, _FILE_AND_LINE_);
+	channel->incomingReadIndex=0;
+	channel->incomingWriteIndex=0;
+	channel->incomingMessageNumber=0;
+	channel->bufferOutput=true;
+	channel->copiedOutgoingBufferToBufferedOutput=false;
+
+	voiceChannels.Insert(speaker, channel, true, _FILE_AND_LINE_);
+}
+void RakVoice::FreeForwardedChannels(void)
+{
+	unsigned index=0;
+	while (index < voiceChannels.Size())
+	{
+		if (voiceChannels[index]->isForwarded)
+			FreeChannelMemory(index, true);
+		else
+			index++;
+	}
+}
+unsigned char RakVoice::GetAudioLevel(const short *samples, unsigned sampleCount)
+{
+	if (sampleCount==0)
+		return 127;
+
+	double energy=0.0;
+	for (unsigned i=0; i < sampleCount; i++)
+		energy+=(double) samples[i] * samples[i];
+	double rms=sqrt(energy / sampleCount);
+
+	// -dBov, where 0 is a full scale square wave
+	if (rms < 1.0)
+		return 127;
+	double level=-20.0 * log10(rms / 32768.0);
+	if (level <= 0.0)
+		return 0;
+	if (level >= 127.0)
+		return 127;
+	return (unsigned char) level;
+}
 
 
 void RakVoice::SetEncoderParameter(void* enc_state, int vartype, int val)
@@ -698,7 +852,8 @@ void RakVoice::SetEncoderParameter(void* enc_state, int vartype, int val)
 		// Set parameter for all encoders
 		for (unsigned int index=0; index < voiceChannels.Size(); index++)
 		{
-			SLNET_VERIFY(speex_encoder_ctl(voiceChannels[index]->enc_state, vartype, &val) == 0);
+			if (voiceChannels[index]->enc_state)
+				SLNET_VERIFY(speex_encoder_ctl(voiceChannels[index]->enc_state, vartype, &val) == 0);
 		}
 	}
 }
@@ -712,7 +867,8 @@ void RakVoice::SetPreprocessorParameter(void* pre_state, int vartype, int val)
 		// Set parameter for all decoders
 		for (unsigned int index=0; index < voiceChannels.Size(); index++)
 		{
-			SLNET_VERIFY(speex_preprocess_ctl((SpeexPreprocessState*)voiceChannels[index]->pre_state, vartype, &val) == 0);
+			if (voiceChannels[index]->pre_state)
+				SLNET_VERIFY(speex_preprocess_ctl((SpeexPreprocessState*)voiceChannels[index]->pre_state, vartype, &val) == 0);
 		}
 	}
 }
@@ -773,11 +929,15 @@ void RakVoice::FreeChannelMemory(unsigned index, bool removeIndex)
 {
 	VoiceChannel *channel;
 	channel=voiceChannels[index];
-	speex_encoder_destroy(channel->enc_state);
+	// Forwarded channels only have a decoder
+	if (channel->enc_state)
+		speex_encoder_destroy(channel->enc_state);
 	speex_decoder_destroy(channel->dec_state);
-	speex_preprocess_state_destroy((SpeexPreprocessState*)channel->pre_state);
+	if (channel->pre_state)
+		speex_preprocess_state_destroy((SpeexPreprocessState*)channel->pre_state);
 	rakFree_Ex(channel->incomingBuffer, _FILE_AND_LINE_ );
-	rakFree_Ex(channel->outgoingBuffer, _FILE_AND_LINE_ );
+	if (channel->outgoingBuffer)
+		rakFree_Ex(channel->outgoingBuffer, _FILE_AND_LINE_ );
 	SLNet::OP_DELETE(channel, _FILE_AND_LINE_);
 	if (removeIndex)
 		voiceChannels.RemoveAtIndex(index);
@@ -863,6 +1023,43 @@ void RakVoice::OnVoiceData(Packet *packet)
 		speex_bits_destroy(&speexBits);
 	}
 }
+void RakVoice::OnForwardedVoiceData(Packet *packet)
+{
+	// ID, RVF_FORWARD, audio level, sample rate / 8000, then the GUID of the speaker
+	static const unsigned speakerOffset=4*sizeof(unsigned char);
+	// Followed by the message number and the encoded frame, as in ID_RAKVOICE_DATA
+	static const unsigned dataOffset=speakerOffset+sizeof(uint64_t);
+
+	if (packet->guid!=forwardingServer || bufferedOutput==0 || packet->length < dataOffset+sizeof(unsigned short))
+		return;
+
+	int speakerSampleRate=packet->data[3]*8000;
+	if (speakerSampleRate!=8000 && speakerSampleRate!=16000 && speakerSampleRate!=32000)
+		return;
+
+	SLNet::BitStream in(packet->data+speakerOffset, packet->length-speakerOffset, false);
+	RakNetGUID speaker;
+	in.Read(speaker);
+
+	bool objectExists;
+	unsigned index = voiceChannels.GetIndexFromKey(speaker, &objectExists);
+	if (objectExists==false)
+		OpenForwardedChannel(speaker, speakerSampleRate);
+	else if (voiceChannels[index]->isForwarded==false)
+	{
+		// Already receiving this speaker on a channel of its own
+		return;
+	}
+
+	// Reuse the last byte of the GUID for the ID, so the frame reads like ID_RAKVOICE_DATA from the speaker
+	Packet voicePacket;
+	voicePacket.data=packet->data+dataOffset-sizeof(unsigned char);
+	voicePacket.data[0]=ID_RAKVOICE_DATA;
+	voicePacket.length=packet->length-dataOffset+sizeof(unsigned char);
+	voicePacket.guid=speaker;
+	voicePacket.systemAddress=packet->systemAddress;
+	OnVoiceData(&voicePacket);
+}
 void RakVoice::WriteOutputToChannel(VoiceChannel *channel, char *dataToWrite)
 {
 	unsigned totalBufferSize;
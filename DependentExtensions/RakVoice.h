@@ -33,6 +33,24 @@ class RakPeerInterface;
 #define FRAME_OUTGOING_BUFFER_COUNT 100
 #define FRAME_INCOMING_BUFFER_COUNT 100
 
+/// Second byte of ID_RAKVOICE_FORWARDING
+enum RakVoiceForwardingMessage
+{
+	/// Client to RakVoiceServer: audio level, message number, then the encoded frame
+	RVF_UPLOAD,
+	/// RakVoiceServer to client: audio level, sample rate / 8000, the GUID of the speaker, message number, then the encoded frame
+	RVF_FORWARD,
+	/// Client to RakVoiceServer: start receiving the speakers of a channel
+	RVF_LISTEN,
+	/// Client to RakVoiceServer: stop receiving the speakers of a channel
+	RVF_STOP_LISTENING,
+	/// Client to RakVoiceServer: send the own voice to the listeners of a channel
+	RVF_TALK
+};
+
+/// Set in the audio level byte of forwarded frames if voice activity was detected. The low 7 bits are the level in -dBov, from 0 (loudest) to 127 (silence), as in RFC 6464.
+#define RAKVOICE_AUDIO_LEVEL_VOICE_ACTIVITY 0x80
+
 /// \internal
 struct VoiceChannel
 {
@@ -61,6 +79,9 @@ struct VoiceChannel
 	unsigned short incomingMessageNumber;  // The ID_VOICE message number we expect to get.  Used to drop out of order and detect how many missing packets in a sequence
 
 	SLNet::TimeMS lastSend;
+
+	// Only decodes a speaker forwarded by RakVoiceServer, see RakVoice::SetForwardingServer(). There is no encoder and no outgoing buffer.
+	bool isForwarded;
 };
 int VoiceChannelComp( const RakNetGUID &key, VoiceChannel * const &data );
 
@@ -191,6 +212,30 @@ public:
 	/// \return true if enabled, false otherwise.
 	bool IsLoopbackMode(void) const;
 
+	/// \brief Sends voice to a RakVoiceServer, which forwards it to the other clients, instead of sending it to each of them
+	/// \details Opens a voice channel to \a server. Pass the server to SendFrame(). Voice forwarded by the server is decoded per speaker and returned by ReceiveFrame(), as if it came from a channel to the speaker.
+	/// RakVoiceServer starts by forwarding between the clients of channel 0, see ListenToForwardedChannel() and SetForwardedTalkChannel() to change that.
+	/// \param[in] server The system running RakVoiceServer, or UNASSIGNED_RAKNET_GUID to close the channel to the current server
+	void SetForwardingServer(RakNetGUID server);
+
+	/// Returns the server passed to SetForwardingServer(), or UNASSIGNED_RAKNET_GUID
+	RakNetGUID GetForwardingServer(void) const;
+
+	/// \brief Asks the forwarding server to forward the speakers of \a channel to this system
+	/// \details Ignored unless the server enabled RakVoiceServer::SetAllowClientChannelRequests(), or if this system already listens to RakVoiceServer::SetMaxClientListenChannels() channels.
+	/// \pre SetForwardingServer() was called
+	void ListenToForwardedChannel(unsigned int channel);
+
+	/// \brief Asks the forwarding server to stop forwarding the speakers of \a channel to this system
+	/// \details Ignored unless the server enabled RakVoiceServer::SetAllowClientChannelRequests().
+	/// \pre SetForwardingServer() was called
+	void StopListeningToForwardedChannel(unsigned int channel);
+
+	/// \brief Asks the forwarding server to forward the voice of this system to the listeners of \a channel
+	/// \details Ignored unless the server enabled RakVoiceServer::SetAllowClientChannelRequests().
+	/// \pre SetForwardingServer() was called
+	void SetForwardedTalkChannel(unsigned int channel);
+
 	// --------------------------------------------------------------------------------------------
 	// Message handling functions
 	// --------------------------------------------------------------------------------------------
@@ -202,7 +247,12 @@ protected:
 	void OnOpenChannelRequest(Packet *packet);
 	void OnOpenChannelReply(Packet *packet);
 	virtual void OnVoiceData(Packet *packet);
+	void OnForwardedVoiceData(Packet *packet);
 	void OpenChannel(Packet *packet);
+	void OpenForwardedChannel(RakNetGUID speaker, int speakerSampleRate);
+	void FreeForwardedChannels(void);
+	void SendForwardingChannelRequest(RakVoiceForwardingMessage request, unsigned int channel);
+	static unsigned char GetAudioLevel(const short *samples, unsigned sampleCount);
 	void FreeChannelMemory(RakNetGUID recipient);
 	void FreeChannelMemory(unsigned index, bool removeIndex);
 	void WriteOutputToChannel(VoiceChannel *channel, char *dataToWrite);
@@ -220,6 +270,7 @@ protected:
 	bool defaultDENOISEState;
 	bool defaultVBRState;
 	bool loopbackMode;
+	RakNetGUID forwardingServer;
 
 };
 
@@ -0,0 +1,438 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "RakVoiceServer.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/PacketPriority.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/slikeAssert.h"
+#include <string.h>
+
+using namespace SLNet;
+
+// How often the loudest speakers of each channel are chosen again
+static const SLNet::TimeMS SELECTION_INTERVAL=20;
+// A speaker which is not forwarded must be louder than a forwarded one by this much, in dB, to replace it
+static const unsigned char SELECTION_SWITCH_MARGIN=6;
+// ID, RVF_UPLOAD and the audio level, followed by the message number and the encoded frame
+static const unsigned int UPLOAD_HEADER_SIZE=3*sizeof(unsigned char);
+
+// Forwarded speakers count as louder by the switch margin
+static inline unsigned int GetSelectionScore(const RakVoiceServerParticipant *speaker)
+{
+	return speaker->isSelected ? speaker->loudness+SELECTION_SWITCH_MARGIN : speaker->loudness;
+}
+
+int SLNet::RakVoiceServerParticipantComp( const RakNetGUID &key, RakVoiceServerParticipant * const &data )
+{
+	if (key < data->guid)
+		return -1;
+	if (key == data->guid)
+		return 0;
+	return 1;
+}
+
+int SLNet::RakVoiceServerChannelComp( const unsigned int &key, RakVoiceServerChannel * const &data )
+{
+	if (key < data->channelId)
+		return -1;
+	if (key == data->channelId)
+		return 0;
+	return 1;
+}
+
+RakVoiceServer::RakVoiceServer()
+{
+	maxForwardedSpeakers=4;
+	voiceActivityHangover=300;
+	allowClientChannelRequests=false;
+	maxClientListenChannels=8;
+	lastSelectionTime=0;
+	memset(&statistics, 0, sizeof(statistics));
+}
+RakVoiceServer::~RakVoiceServer()
+{
+	Clear();
+}
+void RakVoiceServer::SetMaxForwardedSpeakers(unsigned int count)
+{
+	RakAssert(count > 0);
+	if (count==0)
+		count=1;
+	maxForwardedSpeakers=count;
+
+	// Apply right away, so no channel forwards more speakers than allowed
+	SLNet::TimeMS currentTime=SLNet::GetTimeMS();
+	for (unsigned int i=0; i < channels.Size(); i++)
+		SelectSpeakers(channels[i], currentTime);
+}
+unsigned int RakVoiceServer::GetMaxForwardedSpeakers(void) const
+{
+	return maxForwardedSpeakers;
+}
+void RakVoiceServer::SetVoiceActivityHangover(SLNet::TimeMS time)
+{
+	voiceActivityHangover=time;
+}
+void RakVoiceServer::SetAllowClientChannelRequests(bool allow)
+{
+	allowClientChannelRequests=allow;
+}
+void RakVoiceServer::SetMaxClientListenChannels(unsigned int count)
+{
+	maxClientListenChannels=count;
+}
+bool RakVoiceServer::Listen(RakNetGUID participant, unsigned int channel)
+{
+	RakVoiceServerParticipant *p = GetParticipant(participant);
+	if (p==0)
+		return false;
+	AddListener(p, GetChannel(channel, true));
+	return true;
+}
+bool RakVoiceServer::StopListening(RakNetGUID participant, unsigned int channel)
+{
+	RakVoiceServerParticipant *p = GetParticipant(participant);
+	if (p==0)
+		return false;
+	RakVoiceServerChannel *c = GetChannel(channel, false);
+	if (c)
+		RemoveListener(p, c);
+	return true;
+}
+bool RakVoiceServer::SetTalkChannel(RakNetGUID participant, unsigned int channel)
+{
+	RakVoiceServerParticipant *p = GetParticipant(participant);
+	if (p==0)
+		return false;
+	if (p->talkChannel && p->talkChannel->channelId==channel)
+		return true;
+	RemoveSpeaker(p);
+	p->talkChannel=GetChannel(channel, true);
+	p->talkChannel->speakers.Insert(p, _FILE_AND_LINE_);
+	return true;
+}
+bool RakVoiceServer::IsForwarding(RakNetGUID speaker) const
+{
+	RakVoiceServerParticipant *p = GetParticipant(speaker);
+	return p && p->isSelected;
+}
+unsigned int RakVoiceServer::GetParticipantCount(void) const
+{
+	return participants.Size();
+}
+const RakVoiceServer::Statistics& RakVoiceServer::GetStatistics(void) const
+{
+	return statistics;
+}
+void RakVoiceServer::Clear(void)
+{
+	unsigned int i;
+	for (i=0; i < participants.Size(); i++)
+		SLNet::OP_DELETE(participants[i], _FILE_AND_LINE_);
+	participants.Clear(false, _FILE_AND_LINE_);
+	for (i=0; i < channels.Size(); i++)
+		SLNet::OP_DELETE(channels[i], _FILE_AND_LINE_);
+	channels.Clear(false, _FILE_AND_LINE_);
+	selection.Clear(false, _FILE_AND_LINE_);
+}
+void RakVoiceServer::OnAttach(void)
+{
+	memset(&statistics, 0, sizeof(statistics));
+	lastSelectionTime=0;
+}
+void RakVoiceServer::Update(void)
+{
+	SLNet::TimeMS currentTime=SLNet::GetTimeMS();
+	if (currentTime-lastSelectionTime < SELECTION_INTERVAL)
+		return;
+	lastSelectionTime=currentTime;
+
+	for (unsigned int i=0; i < channels.Size(); i++)
+		SelectSpeakers(channels[i], currentTime);
+}
+PluginReceiveResult RakVoiceServer::OnReceive(Packet *packet)
+{
+	RakAssert(packet);
+
+	switch (packet->data[0])
+	{
+	case ID_RAKVOICE_OPEN_CHANNEL_REQUEST:
+		OnOpenChannelRequest(packet);
+		return RR_STOP_PROCESSING_AND_DEALLOCATE;
+	case ID_RAKVOICE_CLOSE_CHANNEL:
+		RemoveParticipant(packet->guid);
+		return RR_STOP_PROCESSING_AND_DEALLOCATE;
+	case ID_RAKVOICE_DATA:
+		// Clients of this server do not send to each other
+		return RR_STOP_PROCESSING_AND_DEALLOCATE;
+	case ID_RAKVOICE_FORWARDING:
+		if (packet->length > 1)
+		{
+			switch (packet->data[1])
+			{
+			case RVF_UPLOAD:
+				OnVoiceData(packet);
+				break;
+			case RVF_LISTEN:
+			case RVF_STOP_LISTENING:
+			case RVF_TALK:
+				if (allowClientChannelRequests)
+					OnChannelRequest(packet);
+				break;
+			}
+		}
+		return RR_STOP_PROCESSING_AND_DEALLOCATE;
+	}
+
+	return RR_CONTINUE_PROCESSING;
+}
+void RakVoiceServer::OnClosedConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, PI2_LostConnectionReason lostConnectionReason )
+{
+	(void)systemAddress;
+	(void)lostConnectionReason;
+
+	RemoveParticipant(rakNetGUID);
+}
+void RakVoiceServer::OnRakPeerShutdown(void)
+{
+	Clear();
+}
+void RakVoiceServer::OnOpenChannelRequest(Packet *packet)
+{
+	SLNet::BitStream in(packet->data, packet->length, false);
+	in.IgnoreBytes(sizeof(unsigned char));
+	int32_t sampleRate;
+	if (in.Read(sampleRate)==false)
+		return;
+	// The rate is sent to listeners divided by 8000
+	if (sampleRate!=8000 && sampleRate!=16000 && sampleRate!=32000)
+		return;
+
+	RakVoiceServerParticipant *participant = GetParticipant(packet->guid);
+	if (participant==0)
+	{
+		participant = SLNet::OP_NEW<RakVoiceServerParticipant>(_FILE_AND_LINE_);
+		participant->guid=packet->guid;
+		participant->talkChannel=0;
+		participant->loudness=0;
+		participant->lastVoiceTime=0;
+		participant->isSelected=false;
+		participants.Insert(packet->guid, participant, true, _FILE_AND_LINE_);
+
+		RakVoiceServerChannel *channel = GetChannel(0, true);
+		participant->talkChannel=channel;
+		channel->speakers.Insert(participant, _FILE_AND_LINE_);
+		AddListener(participant, channel);
+	}
+	participant->sampleRate=sampleRate;
+
+	// The client encodes with its own rate, so reply with the same one
+	SLNet::BitStream out;
+	out.Write((unsigned char)ID_RAKVOICE_OPEN_CHANNEL_REPLY);
+	out.Write(sampleRate);
+	SendUnified(&out, HIGH_PRIORITY, RELIABLE_ORDERED,0,packet->guid,false);
+}
+void RakVoiceServer::OnChannelRequest(Packet *packet)
+{
+	SLNet::BitStream in(packet->data, packet->length, false);
+	in.IgnoreBytes(2*sizeof(unsigned char));
+	unsigned int channel;
+	if (in.Read(channel)==false)
+		return;
+
+	switch (packet->data[1])
+	{
+	case RVF_LISTEN:
+		{
+			// Each channel costs memory and a message per forwarded frame, so clients may only listen to a few
+			RakVoiceServerParticipant *participant = GetParticipant(packet->guid);
+			if (participant && participant->listenChannels.Size() < maxClientListenChannels)
+				Listen(packet->guid, channel);
+		}
+		break;
+	case RVF_STOP_LISTENING:
+		StopListening(packet->guid, channel);
+		break;
+	case RVF_TALK:
+		SetTalkChannel(packet->guid, channel);
+		break;
+	}
+}
+void RakVoiceServer::OnVoiceData(Packet *packet)
+{
+	// At least the message number has to follow the header
+	if (packet->length < UPLOAD_HEADER_SIZE+sizeof(unsigned short))
+		return;
+
+	RakVoiceServerParticipant *speaker = GetParticipant(packet->guid);
+	if (speaker==0 || speaker->talkChannel==0)
+		return;
+
+	statistics.framesReceived++;
+
+	const unsigned char audioLevel=packet->data[2];
+	if (audioLevel & RAKVOICE_AUDIO_LEVEL_VOICE_ACTIVITY)
+	{
+		SLNet::TimeMS currentTime=SLNet::GetTimeMS();
+		unsigned char loudness=(unsigned char) (127-(audioLevel & 0x7F));
+		// Smooth the level over a few frames, unless the speaker starts talking again after a pause
+		if (currentTime-speaker->lastVoiceTime > voiceActivityHangover)
+			speaker->loudness=loudness;
+		else
+			speaker->loudness=(unsigned char) ((3*speaker->loudness+loudness)/4);
+		speaker->lastVoiceTime=currentTime;
+
+		// Start forwarding right away while the channel has room, instead of waiting for the next selection
+		if (speaker->isSelected==false && speaker->talkChannel->selectedCount < maxForwardedSpeakers)
+		{
+			speaker->isSelected=true;
+			speaker->talkChannel->selectedCount++;
+		}
+	}
+
+	if (speaker->isSelected==false)
+	{
+		statistics.framesNotSelected++;
+		return;
+	}
+
+	// Build the message once for all listeners
+	SLNet::BitStream out;
+	out.Write((unsigned char)ID_RAKVOICE_FORWARDING);
+	out.Write((unsigned char)RVF_FORWARD);
+	out.Write(audioLevel);
+	out.Write((unsigned char) (speaker->sampleRate/8000));
+	out.Write(speaker->guid);
+	out.WriteAlignedBytes(packet->data+UPLOAD_HEADER_SIZE, packet->length-UPLOAD_HEADER_SIZE);
+
+	DataStructures::List<RakVoiceServerParticipant*> &listeners = speaker->talkChannel->listeners;
+	for (unsigned int i=0; i < listeners.Size(); i++)
+	{
+		if (listeners[i]==speaker)
+			continue;
+		SendUnified(&out, HIGH_PRIORITY, UNRELIABLE,0,listeners[i]->guid,false);
+		statistics.messagesForwarded++;
+		statistics.bytesForwarded+=out.GetNumberOfBytesUsed();
+	}
+}
+void RakVoiceServer::RemoveParticipant(RakNetGUID guid)
+{
+	bool objectExists;
+	unsigned int index = participants.GetIndexFromKey(guid, &objectExists);
+	if (objectExists==false)
+		return;
+
+	RakVoiceServerParticipant *participant = participants[index];
+	RemoveSpeaker(participant);
+	while (participant->listenChannels.Size())
+		RemoveListener(participant, participant->listenChannels[participant->listenChannels.Size()-1]);
+	participants.RemoveAtIndex(index);
+	SLNet::OP_DELETE(participant, _FILE_AND_LINE_);
+}
+RakVoiceServerParticipant* RakVoiceServer::GetParticipant(RakNetGUID guid) const
+{
+	bool objectExists;
+	unsigned int index = participants.GetIndexFromKey(guid, &objectExists);
+	if (objectExists)
+		return participants[index];
+	return 0;
+}
+RakVoiceServerChannel* RakVoiceServer::GetChannel(unsigned int channelId, bool create)
+{
+	bool objectExists;
+	unsigned int index = channels.GetIndexFromKey(channelId, &objectExists);
+	if (objectExists)
+		return channels[index];
+	if (create==false)
+		return 0;
+
+	RakVoiceServerChannel *channel = SLNet::OP_NEW<RakVoiceServerChannel>(_FILE_AND_LINE_);
+	channel->channelId=channelId;
+	channel->selectedCount=0;
+	channels.InsertAtIndex(channel, index, _FILE_AND_LINE_);
+	return channel;
+}
+void RakVoiceServer::RemoveChannelIfEmpty(RakVoiceServerChannel *channel)
+{
+	if (channel->speakers.Size() || channel->listeners.Size())
+		return;
+
+	bool objectExists;
+	unsigned int index = channels.GetIndexFromKey(channel->channelId, &objectExists);
+	RakAssert(objectExists);
+	if (objectExists)
+		channels.RemoveAtIndex(index);
+	SLNet::OP_DELETE(channel, _FILE_AND_LINE_);
+}
+void RakVoiceServer::AddListener(RakVoiceServerParticipant *participant, RakVoiceServerChannel *channel)
+{
+	bool objectExists;
+	unsigned int index = participant->listenChannels.GetIndexFromKey(channel->channelId, &objectExists);
+	if (objectExists)
+		return;
+	participant->listenChannels.InsertAtIndex(channel, index, _FILE_AND_LINE_);
+	channel->listeners.Insert(participant, _FILE_AND_LINE_);
+}
+void RakVoiceServer::RemoveListener(RakVoiceServerParticipant *participant, RakVoiceServerChannel *channel)
+{
+	bool objectExists;
+	unsigned int index = participant->listenChannels.GetIndexFromKey(channel->channelId, &objectExists);
+	if (objectExists==false)
+		return;
+	participant->listenChannels.RemoveAtIndex(index);
+	index = channel->listeners.GetIndexOf(participant);
+	RakAssert(index!=MAX_UNSIGNED_LONG);
+	channel->listeners.RemoveAtIndexFast(index);
+	RemoveChannelIfEmpty(channel);
+}
+void RakVoiceServer::RemoveSpeaker(RakVoiceServerParticipant *participant)
+{
+	RakVoiceServerChannel *channel = participant->talkChannel;
+	if (channel==0)
+		return;
+
+	if (participant->isSelected)
+	{
+		channel->selectedCount--;
+		participant->isSelected=false;
+	}
+	unsigned int index = channel->speakers.GetIndexOf(participant);
+	RakAssert(index!=MAX_UNSIGNED_LONG);
+	channel->speakers.RemoveAtIndexFast(index);
+	participant->talkChannel=0;
+	RemoveChannelIfEmpty(channel);
+}
+void RakVoiceServer::SelectSpeakers(RakVoiceServerChannel *channel, SLNet::TimeMS currentTime)
+{
+	// Keep the loudest speakers with recent voice activity in selection, from loud to quiet
+	selection.Clear(true, _FILE_AND_LINE_);
+	unsigned int i;
+	for (i=0; i < channel->speakers.Size(); i++)
+	{
+		RakVoiceServerParticipant *speaker = channel->speakers[i];
+		if (speaker->lastVoiceTime==0 || currentTime-speaker->lastVoiceTime > voiceActivityHangover)
+			continue;
+
+		unsigned int score = GetSelectionScore(speaker);
+		unsigned int index = selection.Size();
+		while (index > 0 && GetSelectionScore(selection[index-1]) < score)
+			index--;
+		if (index >= maxForwardedSpeakers)
+			continue;
+		selection.Insert(speaker, index, _FILE_AND_LINE_);
+		if (selection.Size() > maxForwardedSpeakers)
+			selection.RemoveFromEnd();
+	}
+
+	for (i=0; i < channel->speakers.Size(); i++)
+		channel->speakers[i]->isSelected=false;
+	for (i=0; i < selection.Size(); i++)
+		selection[i]->isSelected=true;
+	channel->selectedCount=selection.Size();
+}
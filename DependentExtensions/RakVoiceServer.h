@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+/// \file
+/// \brief Forwards the voice of RakVoice clients to the clients listening to them, without decoding it
+
+
+#ifndef __RAK_VOICE_SERVER_H
+#define __RAK_VOICE_SERVER_H
+
+#include "RakVoice.h"
+#include "slikenet/DS_List.h"
+
+namespace SLNet {
+
+/// \internal
+struct RakVoiceServerChannel;
+int RakVoiceServerChannelComp( const unsigned int &key, RakVoiceServerChannel * const &data );
+
+/// \internal
+struct RakVoiceServerParticipant
+{
+	RakNetGUID guid;
+	int32_t sampleRate;
+	RakVoiceServerChannel *talkChannel;
+	DataStructures::OrderedList<unsigned int, RakVoiceServerChannel*, RakVoiceServerChannelComp> listenChannels;
+	// 127 minus the smoothed audio level in -dBov, so louder is higher
+	unsigned char loudness;
+	// When the last frame with voice activity arrived
+	SLNet::TimeMS lastVoiceTime;
+	// Frames are forwarded only while selected as one of the loudest speakers of the talk channel
+	bool isSelected;
+};
+int RakVoiceServerParticipantComp( const RakNetGUID &key, RakVoiceServerParticipant * const &data );
+
+/// \internal
+struct RakVoiceServerChannel
+{
+	unsigned int channelId;
+	DataStructures::List<RakVoiceServerParticipant*> speakers;
+	DataStructures::List<RakVoiceServerParticipant*> listeners;
+	unsigned int selectedCount;
+};
+
+/// \brief Selective forwarding server for RakVoice
+/// \details Each client encodes its voice once and sends it to this plugin, see RakVoice::SetForwardingServer(), instead of encoding and sending it to every other client.<BR>
+/// Clients talk into one channel and listen to any number of channels. Each frame of a speaker is forwarded to the listeners of its talk channel as it was encoded.
+/// The audio level and voice activity flag the client sends along with each frame decide which speakers are forwarded: only the loudest speakers with voice activity of each channel, see SetMaxForwardedSpeakers().<BR>
+/// Clients start in channel 0, talking and listening. Do not attach RakVoice to the same instance of RakPeerInterface.
+class RAK_DLL_EXPORT RakVoiceServer : public PluginInterface2
+{
+public:
+	RakVoiceServer();
+	virtual ~RakVoiceServer();
+
+	/// \brief Sets how many speakers of a channel are forwarded at the same time
+	/// \details The loudest speakers with voice activity are chosen. A forwarded speaker is only replaced by a louder one by a margin, so that the speakers do not switch back and forth. Defaults to 4.
+	/// \param[in] count Number of speakers, at least 1
+	void SetMaxForwardedSpeakers(unsigned int count);
+
+	/// Returns what was passed to SetMaxForwardedSpeakers()
+	unsigned int GetMaxForwardedSpeakers(void) const;
+
+	/// \brief Sets how long a speaker stays forwarded after the last frame with voice activity. Defaults to 300 milliseconds.
+	/// \param[in] time Time in milliseconds
+	void SetVoiceActivityHangover(SLNet::TimeMS time);
+
+	/// \brief Sets if clients may change their channels with RakVoice::ListenToForwardedChannel(), RakVoice::StopListeningToForwardedChannel() and RakVoice::SetForwardedTalkChannel()
+	/// \details Otherwise channels only change with Listen(), StopListening() and SetTalkChannel() on the server. Defaults to false.
+	void SetAllowClientChannelRequests(bool allow);
+
+	/// \brief Sets how many channels a client may listen to at the same time through RakVoice::ListenToForwardedChannel()
+	/// \details Further requests are ignored until the client stops listening to a channel. Listen() on the server is not limited. Defaults to 8.
+	/// \param[in] count Number of channels, including channel 0 which clients start listening to
+	void SetMaxClientListenChannels(unsigned int count);
+
+	/// \brief Forwards the speakers of \a channel to \a participant
+	/// \return false if \a participant has not opened a voice channel to this server
+	bool Listen(RakNetGUID participant, unsigned int channel);
+
+	/// \brief Stops forwarding the speakers of \a channel to \a participant
+	/// \return false if \a participant has not opened a voice channel to this server
+	bool StopListening(RakNetGUID participant, unsigned int channel);
+
+	/// \brief Forwards the voice of \a participant to the listeners of \a channel, instead of its current talk channel
+	/// \return false if \a participant has not opened a voice channel to this server
+	bool SetTalkChannel(RakNetGUID participant, unsigned int channel);
+
+	/// Returns if the frames of \a speaker are currently forwarded
+	bool IsForwarding(RakNetGUID speaker) const;
+
+	/// Returns the number of clients with an open voice channel to this server
+	unsigned int GetParticipantCount(void) const;
+
+	/// Counters since the plugin was attached
+	struct Statistics
+	{
+		/// Frames received from speakers
+		uint64_t framesReceived;
+		/// Received frames which were not forwarded because the speaker is not one of the loudest of its channel
+		uint64_t framesNotSelected;
+		/// Messages sent to listeners, one for each listener of a forwarded frame
+		uint64_t messagesForwarded;
+		/// Bytes of the messages sent to listeners
+		uint64_t bytesForwarded;
+	};
+
+	/// Returns the counters since the plugin was attached
+	const Statistics& GetStatistics(void) const;
+
+	/// Closes the voice channels of all clients
+	void Clear(void);
+
+	// --------------------------------------------------------------------------------------------
+	// Packet handling functions
+	// --------------------------------------------------------------------------------------------
+	virtual void OnAttach(void);
+	virtual void Update(void);
+	virtual PluginReceiveResult OnReceive(Packet *packet);
+	virtual void OnClosedConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, PI2_LostConnectionReason lostConnectionReason );
+	virtual void OnRakPeerShutdown(void);
+
+protected:
+	void OnOpenChannelRequest(Packet *packet);
+	void OnChannelRequest(Packet *packet);
+	void OnVoiceData(Packet *packet);
+	void RemoveParticipant(RakNetGUID guid);
+	RakVoiceServerParticipant* GetParticipant(RakNetGUID guid) const;
+	RakVoiceServerChannel* GetChannel(unsigned int channelId, bool create);
+	void RemoveChannelIfEmpty(RakVoiceServerChannel *channel);
+	void AddListener(RakVoiceServerParticipant *participant, RakVoiceServerChannel *channel);
+	void RemoveListener(RakVoiceServerParticipant *participant, RakVoiceServerChannel *channel);
+	void RemoveSpeaker(RakVoiceServerParticipant *participant);
+	void SelectSpeakers(RakVoiceServerChannel *channel, SLNet::TimeMS currentTime);
+
+	DataStructures::OrderedList<RakNetGUID, RakVoiceServerParticipant*, RakVoiceServerParticipantComp> participants;
+	DataStructures::OrderedList<unsigned int, RakVoiceServerChannel*, RakVoiceServerChannelComp> channels;
+	unsigned int maxForwardedSpeakers;
+	SLNet::TimeMS voiceActivityHangover;
+	bool allowClientChannelRequests;
+	unsigned int maxClientListenChannels;
+	SLNet::TimeMS lastSelectionTime;
+	// Used by SelectSpeakers(), kept to not allocate on each selection
+	DataStructures::List<RakVoiceServerParticipant*> selection;
+	Statistics statistics;
+};
+
+} // namespace SLNet
+
+#endif
@@ -374,20 +374,18 @@ void DeleteBlobOrText(void* v)
 {
 	LogParameter::Free(v);
 }
-SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLoggerPlugin::SQLThreadInput sqlThreadInput, bool *returnOutput, void* perThreadData)
+// Writes one log entry, within the transaction of ExecSQLLoggingThread()
+SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLogging(SQLiteServerLoggerPlugin::SQLThreadInput sqlThreadInput, void* perThreadData)
 {
 	SQLiteServerLoggerPlugin::CPUThreadOutputNode *cpuOutputNode = sqlThreadInput.cpuOutputNode;
 	SQLPreparedStatements *preparedStatements = (SQLPreparedStatements*) perThreadData;
 
-	*returnOutput=true;
 	SQLiteServerLoggerPlugin::SQLThreadOutput sqlThreadOutput;
 	sqlThreadOutput.cpuOutputNode=cpuOutputNode;
 	sqlite3 *dbHandle = sqlThreadInput.dbHandle;
 //	sqlite3_stmt *statement;
 	char *errorMsg;
 	
-	sqlite3_exec(dbHandle,"BEGIN TRANSACTION", 0, 0, 0);
-	
 	int rc;
 	if (cpuOutputNode->isFunctionCall)
 	{
@@ -405,7 +403,6 @@ SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLogge
 				RakAssert("Failed PRAGMA table_info for function tables in SQLiteServerLoggerPlugin.cpp" && 0);
 				for (int i=0; i < cpuOutputNode->parameterCount; i++)
 					cpuOutputNode->parameterList[i].Free();
-				sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
 				return sqlThreadOutput;
 			}
 		}
@@ -588,7 +585,6 @@ SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLogge
 			RakAssert("Failed PRAGMA table_info for tableName in SQLiteServerLoggerPlugin.cpp" && 0);
 			for (int i=0; i < cpuOutputNode->parameterCount; i++)
 				cpuOutputNode->parameterList[i].Free();
-			sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
 			return sqlThreadOutput;
 		}
 
@@ -635,7 +631,6 @@ SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLogge
 			RakAssert("Failed sqlite3_step in SQLiteServerLoggerPlugin.cpp" && 0);
 			for (int i=0; i < cpuOutputNode->parameterCount; i++)
 				cpuOutputNode->parameterList[i].Free();
-			sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
 			return sqlThreadOutput;
 		}
 
@@ -681,7 +676,6 @@ SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLogge
 								);
 							for (int i=0; i < cpuOutputNode->parameterCount; i++)
 								cpuOutputNode->parameterList[i].Free();
-							sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
 							return sqlThreadOutput;
 						}
 
@@ -740,7 +734,6 @@ SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLogge
 			RakAssert("Failed second sqlite3_prepare_v2 in SQLiteServerLoggerPlugin.cpp" && 0);
 			for (int i=0; i < cpuOutputNode->parameterCount; i++)
 				cpuOutputNode->parameterList[i].Free();
-			sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
 			return sqlThreadOutput;
 		}
 
@@ -797,12 +790,10 @@ SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLogge
 			RakAssert("Failed sqlite3_step to bind blobs in SQLiteServerLoggerPlugin.cpp" && 0);
 			for (int i=0; i < cpuOutputNode->parameterCount; i++)
 				cpuOutputNode->parameterList[i].Free();
-			sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
 			return sqlThreadOutput;
 		}
 		sqlite3_finalize(customStatement);
 	}
-	sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
 
 	for (int i=0; i < cpuOutputNode->parameterCount; i++)
 		cpuOutputNode->parameterList[i].Free();
@@ -810,6 +801,33 @@ SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLogge
 	return sqlThreadOutput;
 }
 
+SQLiteServerLoggerPlugin::SQLThreadOutput ExecSQLLoggingThread(SQLiteServerLoggerPlugin::SQLThreadInput sqlThreadInput, bool *returnOutput, void* perThreadData)
+{
+	sqlite3 *dbHandle = sqlThreadInput.dbHandle;
+	ThreadPool<SQLiteServerLoggerPlugin::SQLThreadInput, SQLiteServerLoggerPlugin::SQLThreadOutput> *threadPool = sqlThreadInput.threadPool;
+
+	// Entries for the same database which arrived while the previous ones were written share one transaction, so they share the cost of a commit
+	sqlite3_exec(dbHandle,"BEGIN TRANSACTION", 0, 0, 0);
+	SQLiteServerLoggerPlugin::SQLThreadOutput sqlThreadOutput = ExecSQLLogging(sqlThreadInput, perThreadData);
+	for (int batchSize=1; batchSize < MAX_SQL_LOGGER_ENTRIES_PER_TRANSACTION; batchSize++)
+	{
+		threadPool->LockInput();
+		if (threadPool->InputSize()==0 || threadPool->GetInputAtIndex(0).dbHandle!=dbHandle)
+		{
+			threadPool->UnlockInput();
+			break;
+		}
+		SQLiteServerLoggerPlugin::SQLThreadInput nextInput = threadPool->GetInputAtIndex(0);
+		threadPool->RemoveInputAtIndex(0);
+		threadPool->UnlockInput();
+		threadPool->AddOutput(ExecSQLLogging(nextInput, perThreadData));
+	}
+	sqlite3_exec(dbHandle,"END TRANSACTION", 0, 0, 0);
+
+	*returnOutput=true;
+	return sqlThreadOutput;
+}
+
 SQLiteServerLoggerPlugin::SQLiteServerLoggerPlugin()
 {
 	sessionManagementMode=CREATE_EACH_NAMED_DB_HANDLE;
@@ -913,6 +931,7 @@ void SQLiteServerLoggerPlugin::Update(void)
 
 				DeallocPacketUnified(outputNode->packet);
 				sqlThreadInput.dbHandle=dbHandles[idx].dbHandle;
+				sqlThreadInput.threadPool=&sqlLoggerThreadPool;
 				outputNode->clientSendingTime+=loggedInSessions[sessionIndex].timestampDelta;
 				sqlLoggerThreadPool.AddInput(ExecSQLLoggingThread, sqlThreadInput);
 			}
@@ -1111,8 +1130,12 @@ void SQLiteServerLoggerPlugin::CloseUnreferencedSessions(void)
 
 	if (unreferencedHandles.Size())
 	{
+		// Input is only added from this thread, so it stays empty while waiting.
+		// Do not wait with the input locked, the working thread locks it to take further entries.
 		sqlLoggerThreadPool.LockInput();
-		if (sqlLoggerThreadPool.HasInputFast()==false)
+		bool hasInput=sqlLoggerThreadPool.HasInputFast();
+		sqlLoggerThreadPool.UnlockInput();
+		if (hasInput==false)
 		{
 			RakSleep(100);
 			while (sqlLoggerThreadPool.NumThreadsWorking()>0)
@@ -1122,7 +1145,6 @@ void SQLiteServerLoggerPlugin::CloseUnreferencedSessions(void)
 				RemoveDBHandle(unreferencedHandles[k], true);
 			}
 		}
-		sqlLoggerThreadPool.UnlockInput();
 
 		if (dbHandles.GetSize()==0)
 			StopCPUSQLThreads();
@@ -1188,6 +1210,8 @@ unsigned int SQLiteServerLoggerPlugin::CreateDBHandle(SLNet::RakString dbIdentif
 		rc = sqlite3_exec(database,"PRAGMA count_changes=OFF", 0, 0, &errorMsg);
 		RakAssert(rc==SQLITE_OK);
 		sqlite3_free(errorMsg);
+		// So the log can be read while it is written. SQLite before 3.7.0 keeps the current journal mode.
+		sqlite3_exec(database,"PRAGMA journal_mode=WAL", 0, 0, 0);
 
 		printf("Created %s\n", fileNameWithPath.C_String());
 		return dbHandles.GetIndexOf(dbIdentifier);
@@ -28,6 +28,8 @@
 class RakPeerInterface;
 
 #define MAX_PACKETS_PER_CPU_INPUT_THREAD 16
+// Log entries written in one transaction at most
+#define MAX_SQL_LOGGER_ENTRIES_PER_TRANSACTION 1024
 
 namespace SLNet
 {
@@ -169,10 +171,13 @@ namespace SLNet
 			CPUThreadOutputNode *cpuOutputNodeArray[MAX_PACKETS_PER_CPU_INPUT_THREAD];
 			int arraySize;
 		};
+		struct SQLThreadOutput;
 		struct SQLThreadInput
 		{
 			sqlite3 *dbHandle;
 			CPUThreadOutputNode *cpuOutputNode;
+			// Further entries for the same database are taken from here
+			ThreadPool<SQLThreadInput, SQLThreadOutput> *threadPool;
 		};
 		struct SQLThreadOutput
 		{
@@ -95,6 +95,23 @@ unsigned int SQLite3ClientPlugin::_sqlite3_exec(SLNet::RakString dbIdentifier, S
 	return nextQueryId-1;
 }
 
+unsigned int SQLite3ClientPlugin::_sqlite3_exec(SLNet::RakString dbIdentifier, SLNet::RakString inputStatement, const SQLite3Parameters &parameters,
+										  PacketPriority priority, PacketReliability reliability, char orderingChannel, const SystemAddress &systemAddress)
+{
+	SLNet::BitStream bsOut;
+	bsOut.Write((MessageID)ID_SQLite3_EXEC);
+	bsOut.Write(nextQueryId);
+	bsOut.Write(dbIdentifier);
+	bsOut.Write(inputStatement);
+	bsOut.Write(true);
+	// Servers before parameters were supported ignore them
+	if (parameters.GetCount() > 0)
+		parameters.Serialize(&bsOut);
+	SendUnified(&bsOut, priority,reliability,orderingChannel,systemAddress,false);
+	++nextQueryId;
+	return nextQueryId-1;
+}
+
 PluginReceiveResult SQLite3ClientPlugin::OnReceive(Packet *packet)
 {
 	switch (packet->data[0])
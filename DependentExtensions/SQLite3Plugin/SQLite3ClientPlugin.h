@@ -119,6 +119,20 @@ public:
 	unsigned int _sqlite3_exec(SLNet::RakString dbIdentifier, SLNet::RakString inputStatement,
 		PacketPriority priority, PacketReliability reliability, char orderingChannel, const SystemAddress &systemAddress);
 
+	/// Execute a statement with parameters on the remote system
+	/// \details The values of \a parameters are bound to the parameters of \a inputStatement in order, for example to ? in "INSERT INTO t VALUES (?, ?)".
+	/// They do not need to be escaped, and the server reuses the prepared statement when the same \a inputStatement is sent again, see SQLite3ServerPlugin::SetStatementCacheSize().
+	/// \param[in] dbIdentifier Which database to use, added with AddDBHandle()
+	/// \param[in] inputStatement SQL statement to execute
+	/// \param[in] parameters Values to bind
+	/// \param[in] priority See RakPeerInterface::Send()
+	/// \param[in] reliability See RakPeerInterface::Send()
+	/// \param[in] orderingChannel See RakPeerInterface::Send()
+	/// \param[in] systemAddress See RakPeerInterface::Send()
+	/// \return Query ID. Will be returned in _sqlite3_exec
+	unsigned int _sqlite3_exec(SLNet::RakString dbIdentifier, SLNet::RakString inputStatement, const SQLite3Parameters &parameters,
+		PacketPriority priority, PacketReliability reliability, char orderingChannel, const SystemAddress &systemAddress);
+
 	/// \internal For plugin handling
 	virtual PluginReceiveResult OnReceive(Packet *packet);
 
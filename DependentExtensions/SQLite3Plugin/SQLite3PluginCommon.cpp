@@ -69,3 +69,54 @@ void SQLite3Table::Deserialize(SLNet::BitStream *bitStream)
 		}
 	}
 }
+SQLite3Parameters::SQLite3Parameters()
+{
+	count=0;
+}
+void SQLite3Parameters::AddNull(void)
+{
+	values.Write((unsigned char) SQLITE3_PARAMETER_NULL);
+	count++;
+}
+void SQLite3Parameters::AddInteger(int64_t value)
+{
+	values.Write((unsigned char) SQLITE3_PARAMETER_INTEGER);
+	values.Write(value);
+	count++;
+}
+void SQLite3Parameters::AddReal(double value)
+{
+	values.Write((unsigned char) SQLITE3_PARAMETER_REAL);
+	values.Write(value);
+	count++;
+}
+void SQLite3Parameters::AddText(const char *value)
+{
+	unsigned int length=(unsigned int) strlen(value);
+	values.Write((unsigned char) SQLITE3_PARAMETER_TEXT);
+	values.Write(length);
+	values.WriteAlignedBytes((const unsigned char*) value, length);
+	count++;
+}
+void SQLite3Parameters::AddBlob(const char *data, unsigned int length)
+{
+	values.Write((unsigned char) SQLITE3_PARAMETER_BLOB);
+	values.Write(length);
+	values.WriteAlignedBytes((const unsigned char*) data, length);
+	count++;
+}
+unsigned int SQLite3Parameters::GetCount(void) const
+{
+	return count;
+}
+void SQLite3Parameters::Clear(void)
+{
+	values.Reset();
+	count=0;
+}
+void SQLite3Parameters::Serialize(SLNet::BitStream *bitStream) const
+{
+	bitStream->Write(count);
+	bitStream->AlignWriteToByteBoundary();
+	bitStream->WriteAlignedBytes(values.GetData(), values.GetNumberOfBytesUsed());
+}
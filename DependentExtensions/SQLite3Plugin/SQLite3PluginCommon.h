@@ -45,4 +45,35 @@ struct SQLite3Table
 	DataStructures::List<SQLite3Row*> rows;
 };
 
+/// Type of a value in SQLite3Parameters
+/// \ingroup SQL_LITE_3_PLUGIN
+enum SQLite3ParameterType
+{
+	SQLITE3_PARAMETER_NULL,
+	SQLITE3_PARAMETER_INTEGER,
+	SQLITE3_PARAMETER_REAL,
+	SQLITE3_PARAMETER_TEXT,
+	SQLITE3_PARAMETER_BLOB
+};
+
+/// Values bound to the parameters of a statement on the remote system, instead of formatting them into the statement
+/// The values are bound in the order they were added, to the parameters (?, ?NNN, :AAA, @AAA, $AAA) by their index
+/// \ingroup SQL_LITE_3_PLUGIN
+struct SQLite3Parameters
+{
+	SQLite3Parameters();
+	void AddNull(void);
+	void AddInteger(int64_t value);
+	void AddReal(double value);
+	void AddText(const char *value);
+	void AddBlob(const char *data, unsigned int length);
+	unsigned int GetCount(void) const;
+	void Clear(void);
+	void Serialize(SLNet::BitStream *bitStream) const;
+
+	// Each value as its type followed by the value, all on byte boundaries, so the remote system binds text and blobs in place
+	SLNet::BitStream values;
+	unsigned int count;
+};
+
 #endif
@@ -17,6 +17,7 @@
 #include "slikenet/MessageIdentifiers.h"
 #include "slikenet/BitStream.h"
 #include "slikenet/GetTime.h"
+#include <ctype.h>
 
 using namespace SLNet;
 
@@ -25,32 +26,332 @@ bool operator>( const DataStructures::MLKeyRef<SLNet::RakString> &inputKey, cons
 bool operator==( const DataStructures::MLKeyRef<SLNet::RakString> &inputKey, const SQLite3ServerPlugin::NamedDBHandle &cls ) {return inputKey.Get() == cls.dbIdentifier;}
 
 
-int PerRowCallback(void *userArgument, int argc, char **argv, char **azColName)
+#ifdef SQLite3_STATEMENT_EXECUTE_THREADED
+// Skips whitespace and compares the first word of a statement, ignoring case
+static bool StartsWithKeyword(const char *sql, const char *keyword)
 {
-	SQLite3Table *outputTable = (SQLite3Table*)userArgument;
-	unsigned int idx;
-	if (outputTable->columnNames.Size()==0)
+	while (isspace((unsigned char) *sql))
+		sql++;
+	size_t length=strlen(keyword);
+	for (size_t i=0; i < length; i++)
 	{
-		for (idx=0; idx < (unsigned int) argc; idx++)
-			outputTable->columnNames.Push(azColName[idx], _FILE_AND_LINE_ );
+		if (toupper((unsigned char) sql[i])!=keyword[i])
+			return false;
 	}
-	SQLite3Row *row = SLNet::OP_NEW<SQLite3Row>(_FILE_AND_LINE_);
-	outputTable->rows.Push(row,_FILE_AND_LINE_);
-	for (idx=0; idx < (unsigned int) argc; idx++)
+	return isalnum((unsigned char) sql[length])==0 && sql[length]!='_';
+}
+// Text with a single statement. A semicolon within a string literal counts as another statement, so such text just runs on its own.
+static bool IsSingleStatement(const char *sql)
+{
+	const char *semicolon=strchr(sql, ';');
+	if (semicolon==0)
+		return true;
+	for (semicolon++; *semicolon; semicolon++)
 	{
-		if (argv[idx])
-			row->entries.Push(argv[idx], _FILE_AND_LINE_ );
+		if (isspace((unsigned char) *semicolon)==0 && *semicolon!=';')
+			return false;
+	}
+	return true;
+}
+// Functions returning the state of the connection they run on. A word in a string literal matches as well, such text just runs on the writer.
+static bool UsesConnectionFunction(const char *sql)
+{
+	static const char *connectionFunctions[] = {"LAST_INSERT_ROWID", "CHANGES", "TOTAL_CHANGES"};
+	while (*sql)
+	{
+		if (isalpha((unsigned char) *sql) || *sql=='_')
+		{
+			for (unsigned int i=0; i < sizeof(connectionFunctions)/sizeof(connectionFunctions[0]); i++)
+			{
+				if (StartsWithKeyword(sql, connectionFunctions[i]))
+					return true;
+			}
+			while (isalnum((unsigned char) *sql) || *sql=='_')
+				sql++;
+		}
 		else
-			row->entries.Push("", _FILE_AND_LINE_ );
+			sql++;
 	}
-	return 0;
+	return false;
+}
+// Statements that can run on a read-only connection
+static bool IsReadStatement(const char *sql)
+{
+	return StartsWithKeyword(sql, "SELECT") && IsSingleStatement(sql) && UsesConnectionFunction(sql)==false;
+}
+// Statements that can run within a transaction of the writer together with other statements
+static bool IsBatchableStatement(const char *sql)
+{
+	static const char *ownTransactionKeywords[] = {"BEGIN", "COMMIT", "END", "ROLLBACK", "SAVEPOINT", "RELEASE", "PRAGMA", "VACUUM", "ATTACH", "DETACH"};
+	for (unsigned int i=0; i < sizeof(ownTransactionKeywords)/sizeof(ownTransactionKeywords[0]); i++)
+	{
+		if (StartsWithKeyword(sql, ownTransactionKeywords[i]))
+			return false;
+	}
+	return IsSingleStatement(sql);
+}
+#endif // SQLite3_STATEMENT_EXECUTE_THREADED
+static int BindParameters(sqlite3_stmt *statement, SLNet::BitStream *parameters, unsigned int *parameterCount)
+{
+	int numParameters=sqlite3_bind_parameter_count(statement);
+	int rc=SQLITE_OK;
+	for (int parameterIndex=1; parameterIndex <= numParameters && *parameterCount > 0 && rc==SQLITE_OK; parameterIndex++)
+	{
+		(*parameterCount)--;
+		unsigned char type;
+		if (parameters->Read(type)==false)
+			return SQLITE_MISUSE;
+		switch (type)
+		{
+		case SQLITE3_PARAMETER_NULL:
+			rc=sqlite3_bind_null(statement, parameterIndex);
+			break;
+		case SQLITE3_PARAMETER_INTEGER:
+			{
+				int64_t value;
+				if (parameters->Read(value)==false)
+					return SQLITE_MISUSE;
+				rc=sqlite3_bind_int64(statement, parameterIndex, value);
+			}
+			break;
+		case SQLITE3_PARAMETER_REAL:
+			{
+				double value;
+				if (parameters->Read(value)==false)
+					return SQLITE_MISUSE;
+				rc=sqlite3_bind_double(statement, parameterIndex, value);
+			}
+			break;
+		case SQLITE3_PARAMETER_TEXT:
+		case SQLITE3_PARAMETER_BLOB:
+			{
+				unsigned int length;
+				if (parameters->Read(length)==false || BITS_TO_BYTES(parameters->GetNumberOfUnreadBits()) < length)
+					return SQLITE_MISUSE;
+				// Bound in place, the statement is reset before the input data is freed
+				const char *value=(const char*) parameters->GetData()+BITS_TO_BYTES(parameters->GetReadOffset());
+				if (type==SQLITE3_PARAMETER_TEXT)
+					rc=sqlite3_bind_text(statement, parameterIndex, value, (int) length, SQLITE_STATIC);
+				else
+					rc=sqlite3_bind_blob(statement, parameterIndex, value, (int) length, SQLITE_STATIC);
+				parameters->IgnoreBytes(length);
+			}
+			break;
+		default:
+			return SQLITE_MISUSE;
+		}
+	}
+	return rc;
+}
+int SLNet::SQLite3CachedStatementComp( const SLNet::RakString &key, SQLite3CachedStatement * const &data )
+{
+	return strcmp(key.C_String(), data->sql.C_String());
+}
+SQLite3StatementCache::SQLite3StatementCache(sqlite3 *_dbHandle, unsigned int _maxStatements)
+{
+	dbHandle=_dbHandle;
+	maxStatements=_maxStatements;
+	useCount=0;
+}
+SQLite3StatementCache::~SQLite3StatementCache()
+{
+	Clear();
+}
+sqlite3_stmt *SQLite3StatementCache::Prepare(const char *sql, const char **tail, bool *isCached, int *rc)
+{
+	*isCached=false;
+	*rc=SQLITE_OK;
+	bool objectExists;
+	unsigned int index=statements.GetIndexFromKey(sql, &objectExists);
+	if (objectExists)
+	{
+		SQLite3CachedStatement *cachedStatement=statements[index];
+		cachedStatement->lastUse=++useCount;
+		*tail=sql+cachedStatement->tailOffset;
+		*isCached=true;
+		return cachedStatement->statement;
+	}
+
+	sqlite3_stmt *statement;
+	*rc=sqlite3_prepare_v2(dbHandle, sql, -1, &statement, tail);
+	if (*rc!=SQLITE_OK || statement==0 || maxStatements==0)
+		return statement;
+
+	if (statements.Size() >= maxStatements)
+	{
+		// Replace the statement used longest ago
+		unsigned int oldestIndex=0;
+		for (unsigned int i=1; i < statements.Size(); i++)
+		{
+			if (statements[i]->lastUse < statements[oldestIndex]->lastUse)
+				oldestIndex=i;
+		}
+		sqlite3_finalize(statements[oldestIndex]->statement);
+		SLNet::OP_DELETE(statements[oldestIndex], _FILE_AND_LINE_);
+		statements.RemoveAtIndex(oldestIndex);
+	}
+
+	SQLite3CachedStatement *cachedStatement=SLNet::OP_NEW<SQLite3CachedStatement>(_FILE_AND_LINE_);
+	cachedStatement->sql=sql;
+	cachedStatement->statement=statement;
+	cachedStatement->tailOffset=(int) (*tail-sql);
+	cachedStatement->lastUse=++useCount;
+	statements.Insert(cachedStatement->sql, cachedStatement, true, _FILE_AND_LINE_);
+	*isCached=true;
+	return statement;
+}
+int SQLite3StatementCache::Exec(const char *sql, SLNet::BitStream *parameters, unsigned int parameterCount, SQLite3Table *outputTable, SLNet::RakString *errorMsg)
+{
+	// Only the first statement of a text is kept, keyed by the whole text
+	bool isFirstStatement=true;
+	const char *statementText=sql;
+	while (*statementText)
+	{
+		const char *tail;
+		bool isCached=false;
+		int rc;
+		sqlite3_stmt *statement;
+		if (isFirstStatement)
+			statement=Prepare(statementText, &tail, &isCached, &rc);
+		else
+			rc=sqlite3_prepare_v2(dbHandle, statementText, -1, &statement, &tail);
+		isFirstStatement=false;
+		if (rc!=SQLITE_OK)
+		{
+			*errorMsg=sqlite3_errmsg(dbHandle);
+			return rc;
+		}
+		statementText=tail;
+		if (statement==0)
+		{
+			// Whitespace or a comment
+			continue;
+		}
+
+		rc=BindParameters(statement, parameters, &parameterCount);
+		if (rc==SQLITE_OK)
+		{
+			int numColumns=sqlite3_column_count(statement);
+			int columnIndex;
+			while ((rc=sqlite3_step(statement))==SQLITE_ROW)
+			{
+				if (outputTable->columnNames.Size()==0)
+				{
+					for (columnIndex=0; columnIndex < numColumns; columnIndex++)
+						outputTable->columnNames.Push(sqlite3_column_name(statement, columnIndex), _FILE_AND_LINE_ );
+				}
+				SQLite3Row *row = SLNet::OP_NEW<SQLite3Row>(_FILE_AND_LINE_);
+				outputTable->rows.Push(row,_FILE_AND_LINE_);
+				for (columnIndex=0; columnIndex < numColumns; columnIndex++)
+				{
+					const unsigned char *text=sqlite3_column_text(statement, columnIndex);
+					if (text)
+						row->entries.Push((const char*) text, _FILE_AND_LINE_ );
+					else
+						row->entries.Push("", _FILE_AND_LINE_ );
+				}
+			}
+			if (rc==SQLITE_DONE)
+				rc=SQLITE_OK;
+		}
+		if (rc!=SQLITE_OK)
+		{
+			if (rc==SQLITE_MISUSE)
+				*errorMsg="Malformed statement parameters";
+			else
+				*errorMsg=sqlite3_errmsg(dbHandle);
+		}
+
+		if (isCached)
+		{
+			sqlite3_reset(statement);
+			sqlite3_clear_bindings(statement);
+		}
+		else
+			sqlite3_finalize(statement);
+
+		if (rc!=SQLITE_OK)
+			return rc;
+	}
+	return SQLITE_OK;
+}
+void SQLite3StatementCache::Clear(void)
+{
+	for (unsigned int i=0; i < statements.Size(); i++)
+	{
+		sqlite3_finalize(statements[i]->statement);
+		SLNet::OP_DELETE(statements[i], _FILE_AND_LINE_);
+	}
+	statements.Clear(false, _FILE_AND_LINE_);
+}
+sqlite3 *SQLite3StatementCache::GetDBHandle(void) const
+{
+	return dbHandle;
+}
+SQLite3ReaderConnections::SQLite3ReaderConnections(const SLNet::RakString &_fileName, unsigned int _statementCacheSize)
+{
+	fileName=_fileName;
+	statementCacheSize=_statementCacheSize;
+}
+SQLite3ReaderConnections::~SQLite3ReaderConnections()
+{
+	for (unsigned int i=0; i < idleConnections.Size(); i++)
+	{
+		sqlite3 *dbHandle=idleConnections[i]->GetDBHandle();
+		SLNet::OP_DELETE(idleConnections[i], _FILE_AND_LINE_);
+		sqlite3_close(dbHandle);
+	}
+}
+SQLite3StatementCache *SQLite3ReaderConnections::Acquire(void)
+{
+	mutex.Lock();
+	if (idleConnections.Size())
+	{
+		SQLite3StatementCache *connection=idleConnections.Pop();
+		mutex.Unlock();
+		return connection;
+	}
+	mutex.Unlock();
+
+	sqlite3 *dbHandle;
+	if (sqlite3_open_v2(fileName.C_String(), &dbHandle, SQLITE_OPEN_READONLY, 0)!=SQLITE_OK)
+	{
+		sqlite3_close(dbHandle);
+		return 0;
+	}
+	// Readers only wait while the writer checkpoints or recovers the log
+	sqlite3_busy_timeout(dbHandle, 1000);
+	return SLNet::OP_NEW_2<SQLite3StatementCache>(_FILE_AND_LINE_, dbHandle, statementCacheSize);
+}
+void SQLite3ReaderConnections::Release(SQLite3StatementCache *connection)
+{
+	mutex.Lock();
+	idleConnections.Push(connection, _FILE_AND_LINE_);
+	mutex.Unlock();
 }
 SQLite3ServerPlugin::SQLite3ServerPlugin()
 {
+	statementCacheSize=64;
+	numReaderThreads=0;
+	maxBatchSize=1;
 }
 SQLite3ServerPlugin::~SQLite3ServerPlugin()
 {
 	StopThreads();
+	for (unsigned int idx=0; idx < dbHandles.GetSize(); idx++)
+		FreeDBHandle(dbHandles[idx], false);
+}
+void SQLite3ServerPlugin::SetStatementCacheSize(unsigned int size)
+{
+	statementCacheSize=size;
+}
+void SQLite3ServerPlugin::SetReaderThreads(unsigned int numThreads)
+{
+	numReaderThreads=numThreads;
+}
+void SQLite3ServerPlugin::SetMaxBatchSize(unsigned int size)
+{
+	maxBatchSize=size > 0 ? size : 1;
 }
 bool SQLite3ServerPlugin::AddDBHandle(SLNet::RakString dbIdentifier, sqlite3 *dbHandle, bool dbAutoCreated)
 {
@@ -64,11 +365,48 @@ bool SQLite3ServerPlugin::AddDBHandle(SLNet::RakString dbIdentifier, sqlite3 *db
 	ndbh.dbIdentifier=dbIdentifier;
 	ndbh.dbAutoCreated=dbAutoCreated;
 	ndbh.whenCreated= SLNet::GetTimeMS();
+	ndbh.statementCache=SLNet::OP_NEW_2<SQLite3StatementCache>(_FILE_AND_LINE_, dbHandle, statementCacheSize);
+	ndbh.readerConnections=0;
+	ndbh.pendingWriterStatements=0;
+	ndbh.writerInTransaction=false;
+
+#ifdef SQLite3_STATEMENT_EXECUTE_THREADED
+	if (numReaderThreads > 0)
+	{
+		// The file of the main database, empty for in-memory databases
+		SLNet::RakString fileName;
+		SQLite3Table databaseList;
+		SLNet::RakString errorMsg;
+		SQLite3StatementCache pragmaConnection(dbHandle, 0);
+		if (pragmaConnection.Exec("PRAGMA database_list", 0, 0, &databaseList, &errorMsg)==SQLITE_OK)
+		{
+			for (unsigned int row=0; row < databaseList.rows.Size(); row++)
+			{
+				if (databaseList.rows[row]->entries.Size() >= 3 && databaseList.rows[row]->entries[1]=="main")
+					fileName=databaseList.rows[row]->entries[2];
+			}
+		}
+
+		if (fileName.IsEmpty()==false)
+		{
+			// Returns the journal mode in effect, SQLite before 3.7.0 keeps the current mode
+			SQLite3Table journalMode;
+			if (pragmaConnection.Exec("PRAGMA journal_mode=WAL", 0, 0, &journalMode, &errorMsg)==SQLITE_OK &&
+				journalMode.rows.Size()==1 && journalMode.rows[0]->entries.Size()==1 && journalMode.rows[0]->entries[0].StrICmp("wal")==0)
+			{
+				ndbh.readerConnections=SLNet::OP_NEW_2<SQLite3ReaderConnections>(_FILE_AND_LINE_, fileName, statementCacheSize);
+			}
+		}
+	}
+#endif
+
 	dbHandles.InsertAtIndex(ndbh,idx,_FILE_AND_LINE_);
 	
 #ifdef SQLite3_STATEMENT_EXECUTE_THREADED
 	if (sqlThreadPool.WasStarted()==false)
 		sqlThreadPool.StartThreads(1,0);
+	if (ndbh.readerConnections && sqlReaderThreadPool.WasStarted()==false)
+		sqlReaderThreadPool.StartThreads((int) numReaderThreads,0);
 #endif
 
 	return true;
@@ -78,11 +416,7 @@ void SQLite3ServerPlugin::RemoveDBHandle(SLNet::RakString dbIdentifier, bool als
 	unsigned int idx = dbHandles.GetIndexOf(dbIdentifier);
 	if (idx!=(unsigned int)-1)
 	{
-		if (alsoCloseConnection)
-		{
-			printf("Closed %s\n", dbIdentifier.C_String());
-			sqlite3_close(dbHandles[idx].dbHandle);
-		}
+		FreeDBHandle(dbHandles[idx], alsoCloseConnection);
 		dbHandles.RemoveAtIndex(idx,_FILE_AND_LINE_);
 #ifdef SQLite3_STATEMENT_EXECUTE_THREADED
 	if (dbHandles.GetSize()==0)
@@ -97,11 +431,7 @@ void SQLite3ServerPlugin::RemoveDBHandle(sqlite3 *dbHandle, bool alsoCloseConnec
 	{
 		if (dbHandles[idx].dbHandle==dbHandle)
 		{
-			if (alsoCloseConnection)
-			{
-				printf("Closed %s\n", dbHandles[idx].dbIdentifier.C_String());
-				sqlite3_close(dbHandles[idx].dbHandle);
-			}
+			FreeDBHandle(dbHandles[idx], alsoCloseConnection);
 			dbHandles.RemoveAtIndex(idx,_FILE_AND_LINE_);
 #ifdef SQLite3_STATEMENT_EXECUTE_THREADED
 			if (dbHandles.GetSize()==0)
@@ -111,6 +441,19 @@ void SQLite3ServerPlugin::RemoveDBHandle(sqlite3 *dbHandle, bool alsoCloseConnec
 		}
 	}
 }
+void SQLite3ServerPlugin::FreeDBHandle(NamedDBHandle &ndbh, bool alsoCloseConnection)
+{
+	// Statements must be finalized before the connection can be closed
+	SLNet::OP_DELETE(ndbh.statementCache, _FILE_AND_LINE_);
+	ndbh.statementCache=0;
+	SLNet::OP_DELETE(ndbh.readerConnections, _FILE_AND_LINE_);
+	ndbh.readerConnections=0;
+	if (alsoCloseConnection)
+	{
+		printf("Closed %s\n", ndbh.dbIdentifier.C_String());
+		sqlite3_close(ndbh.dbHandle);
+	}
+}
 #ifdef SQLite3_STATEMENT_EXECUTE_THREADED
 void SQLite3ServerPlugin::Update(void)
 {
@@ -118,61 +461,184 @@ void SQLite3ServerPlugin::Update(void)
 	while (sqlThreadPool.HasOutputFast() && sqlThreadPool.HasOutput())
 	{
 		output = sqlThreadPool.GetOutput();
+		for (unsigned int idx=0; idx < dbHandles.GetSize(); idx++)
+		{
+			if (dbHandles[idx].dbHandle==output.dbHandle)
+			{
+				dbHandles[idx].pendingWriterStatements--;
+				dbHandles[idx].writerInTransaction=output.inTransaction;
+				break;
+			}
+		}
+		SLNet::BitStream bsOut((unsigned char*) output.data, output.length,false);
+		SendUnified(&bsOut, MEDIUM_PRIORITY,RELIABLE_ORDERED,0,output.sender,false);
+		rakFree_Ex(output.data,_FILE_AND_LINE_);
+	}
+	while (sqlReaderThreadPool.HasOutputFast() && sqlReaderThreadPool.HasOutput())
+	{
+		output = sqlReaderThreadPool.GetOutput();
 		SLNet::BitStream bsOut((unsigned char*) output.data, output.length,false);
 		SendUnified(&bsOut, MEDIUM_PRIORITY,RELIABLE_ORDERED,0,output.sender,false);
 		rakFree_Ex(output.data,_FILE_AND_LINE_);
 	}
 }
-SQLite3ServerPlugin::SQLExecThreadOutput ExecStatementThread(SQLite3ServerPlugin::SQLExecThreadInput threadInput, bool *returnOutput, void* perThreadData)
+// A request of ID_SQLite3_EXEC, read from the input of a thread
+struct SQLite3ExecRequest
 {
-	// unused parameters
-	(void)perThreadData;
+	SQLite3ExecRequest(const SQLite3ServerPlugin::SQLExecThreadInput &_threadInput) : threadInput(_threadInput), bsIn((unsigned char*) _threadInput.data, _threadInput.length, false)
+	{
+		bsIn.IgnoreBytes(sizeof(MessageID));
+		bsIn.Read(queryId);
+		bsIn.Read(dbIdentifier);
+		bsIn.Read(inputStatement);
+		// bool isRequest;
+		// bsIn.Read(isRequest);
+		bsIn.IgnoreBits(1);
+		// Requests without parameters end here
+		if (bsIn.Read(parameterCount))
+			bsIn.AlignReadToByteBoundary();
+		else
+			parameterCount=0;
+	}
+	void Exec(SQLite3StatementCache *connection)
+	{
+		connection->Exec(inputStatement.C_String(), &bsIn, parameterCount, &outputTable, &errorMsgStr);
+	}
+	SQLite3ServerPlugin::SQLExecThreadOutput GetOutput(void)
+	{
+		SLNet::BitStream bsOut;
+		bsOut.Write((MessageID)ID_SQLite3_EXEC);
+		bsOut.Write(queryId);
+		bsOut.Write(dbIdentifier);
+		bsOut.Write(inputStatement);
+		bsOut.Write(false);
+		bsOut.Write(errorMsgStr);
+		outputTable.Serialize(&bsOut);
+
+		// Free input data
+		rakFree_Ex(threadInput.data,_FILE_AND_LINE_);
+
+		// Copy to output data
+		SQLite3ServerPlugin::SQLExecThreadOutput threadOutput;
+		threadOutput.data=(char*) rakMalloc_Ex(bsOut.GetNumberOfBytesUsed(),_FILE_AND_LINE_);
+		memcpy(threadOutput.data,bsOut.GetData(),bsOut.GetNumberOfBytesUsed());
+		threadOutput.length=bsOut.GetNumberOfBytesUsed();
+		threadOutput.sender=threadInput.sender;
+		return threadOutput;
+	}
 
+	SQLite3ServerPlugin::SQLExecThreadInput threadInput;
+	SLNet::BitStream bsIn;
 	unsigned int queryId;
 	SLNet::RakString dbIdentifier;
 	SLNet::RakString inputStatement;
-	SLNet::BitStream bsIn((unsigned char*) threadInput.data, threadInput.length, false);
-	bsIn.IgnoreBytes(sizeof(MessageID));
-	bsIn.Read(queryId);
-	bsIn.Read(dbIdentifier);
-	bsIn.Read(inputStatement);
-	// bool isRequest;
-	// bsIn.Read(isRequest);
-	bsIn.IgnoreBits(1);
-
-	char *errorMsg;
+	unsigned int parameterCount;
 	SLNet::RakString errorMsgStr;
-	SQLite3Table outputTable;					
-	sqlite3_exec(threadInput.dbHandle, inputStatement.C_String(), PerRowCallback, &outputTable, &errorMsg);
-	if (errorMsg)
+	SQLite3Table outputTable;
+};
+SQLite3ServerPlugin::SQLExecThreadOutput ExecStatementThread(SQLite3ServerPlugin::SQLExecThreadInput threadInput, bool *returnOutput, void* perThreadData)
+{
+	// unused parameters
+	(void)perThreadData;
+
+	SQLite3StatementCache *connection=threadInput.statementCache;
+	sqlite3 *dbHandle=connection->GetDBHandle();
+	DataStructures::List<SQLite3ExecRequest*> requests;
+	requests.Push(SLNet::OP_NEW_1<SQLite3ExecRequest>(_FILE_AND_LINE_, threadInput), _FILE_AND_LINE_);
+
+	// Statements for the same database which arrived while the previous ones ran share one transaction
+	if (threadInput.maxBatchSize > 1 && sqlite3_get_autocommit(dbHandle) && IsBatchableStatement(requests[0]->inputStatement.C_String()))
 	{
-		errorMsgStr=errorMsg;
-		sqlite3_free(errorMsg);
+		threadInput.threadPool->LockInput();
+		while (requests.Size() < threadInput.maxBatchSize && threadInput.threadPool->InputSize() > 0)
+		{
+			SQLite3ServerPlugin::SQLExecThreadInput nextInput=threadInput.threadPool->GetInputAtIndex(0);
+			if (nextInput.statementCache!=connection)
+				break;
+			SQLite3ExecRequest *nextRequest=SLNet::OP_NEW_1<SQLite3ExecRequest>(_FILE_AND_LINE_, nextInput);
+			if (IsBatchableStatement(nextRequest->inputStatement.C_String())==false)
+			{
+				SLNet::OP_DELETE(nextRequest, _FILE_AND_LINE_);
+				break;
+			}
+			threadInput.threadPool->RemoveInputAtIndex(0);
+			requests.Push(nextRequest, _FILE_AND_LINE_);
+		}
+		threadInput.threadPool->UnlockInput();
 	}
 
-	SLNet::BitStream bsOut;
-	bsOut.Write((MessageID)ID_SQLite3_EXEC);
-	bsOut.Write(queryId);
-	bsOut.Write(dbIdentifier);
-	bsOut.Write(inputStatement);
-	bsOut.Write(false);
-	bsOut.Write(errorMsgStr);
-	outputTable.Serialize(&bsOut);
-
-	// Free input data
-	rakFree_Ex(threadInput.data,_FILE_AND_LINE_);
+	unsigned int idx;
+	bool inTransaction = requests.Size() > 1 && sqlite3_exec(dbHandle, "BEGIN", 0, 0, 0)==SQLITE_OK;
+	SLNet::RakString transactionError;
+	for (idx=0; idx < requests.Size(); idx++)
+	{
+		requests[idx]->Exec(connection);
+		if (inTransaction && sqlite3_get_autocommit(dbHandle))
+		{
+			// The error rolled back the transaction, including the statements before
+			transactionError=requests[idx]->errorMsgStr;
+			inTransaction=false;
+			break;
+		}
+	}
+	if (inTransaction && sqlite3_exec(dbHandle, "COMMIT", 0, 0, 0)!=SQLITE_OK)
+	{
+		transactionError=sqlite3_errmsg(dbHandle);
+		sqlite3_exec(dbHandle, "ROLLBACK", 0, 0, 0);
+	}
+	if (transactionError.IsEmpty()==false)
+	{
+		// Statements after the rollback did not run
+		unsigned int numRun = idx < requests.Size() ? idx+1 : requests.Size();
+		for (unsigned int i=0; i < requests.Size(); i++)
+		{
+			if (i >= numRun || requests[i]->errorMsgStr.IsEmpty())
+			{
+				for (unsigned int j=0; j < requests[i]->outputTable.rows.Size(); j++)
+					SLNet::OP_DELETE(requests[i]->outputTable.rows[j], _FILE_AND_LINE_);
+				requests[i]->outputTable.rows.Clear(false, _FILE_AND_LINE_);
+				requests[i]->outputTable.columnNames.Clear(false, _FILE_AND_LINE_);
+				requests[i]->errorMsgStr=SLNet::RakString("Transaction rolled back: %s", transactionError.C_String());
+			}
+		}
+	}
 
-	// Copy to output data
+	// One output per statement, the first is returned
 	SQLite3ServerPlugin::SQLExecThreadOutput threadOutput;
-	threadOutput.data=(char*) rakMalloc_Ex(bsOut.GetNumberOfBytesUsed(),_FILE_AND_LINE_);
-	memcpy(threadOutput.data,bsOut.GetData(),bsOut.GetNumberOfBytesUsed());
-	threadOutput.length=bsOut.GetNumberOfBytesUsed();
-	threadOutput.sender=threadInput.sender;	
-	// SendUnified(&bsOut, MEDIUM_PRIORITY,RELIABLE_ORDERED,0,packet->systemAddress,false);
+	bool inClientTransaction = sqlite3_get_autocommit(dbHandle)==0;
+	for (idx=0; idx < requests.Size(); idx++)
+	{
+		SQLite3ServerPlugin::SQLExecThreadOutput output=requests[idx]->GetOutput();
+		output.dbHandle=dbHandle;
+		output.inTransaction=inClientTransaction;
+		if (idx==0)
+			threadOutput=output;
+		else
+			threadInput.threadPool->AddOutput(output);
+		SLNet::OP_DELETE(requests[idx], _FILE_AND_LINE_);
+	}
 
 	*returnOutput=true;
 	return threadOutput;
 }
+SQLite3ServerPlugin::SQLExecThreadOutput ExecReadStatementThread(SQLite3ServerPlugin::SQLExecThreadInput threadInput, bool *returnOutput, void* perThreadData)
+{
+	// unused parameters
+	(void)perThreadData;
+
+	SQLite3ExecRequest request(threadInput);
+	SQLite3StatementCache *connection=threadInput.readerConnections->Acquire();
+	if (connection)
+	{
+		request.Exec(connection);
+		threadInput.readerConnections->Release(connection);
+	}
+	else
+		request.errorMsgStr="Unable to open a read-only connection";
+
+	*returnOutput=true;
+	return request.GetOutput();
+}
 #endif // SQLite3_STATEMENT_EXECUTE_THREADED
 
 PluginReceiveResult SQLite3ServerPlugin::OnReceive(Packet *packet)
@@ -215,17 +681,29 @@ PluginReceiveResult SQLite3ServerPlugin::OnReceive(Packet *packet)
 					input.dbHandle=dbHandles[idx].dbHandle;
 					input.length=packet->length;
 					input.sender=packet->systemAddress;
-					sqlThreadPool.AddInput(ExecStatementThread, input);
-#else
-					char *errorMsg;
-					SLNet::RakString errorMsgStr;
-					SQLite3Table outputTable;					
-					sqlite3_exec(dbHandles[idx].dbHandle, inputStatement.C_String(), PerRowCallback, &outputTable, &errorMsg);
-					if (errorMsg)
+					input.statementCache=dbHandles[idx].statementCache;
+					input.threadPool=&sqlThreadPool;
+					input.maxBatchSize=maxBatchSize;
+					// Reads go to a reader connection unless they may depend on statements still pending on the writer, or on a transaction a client began on it
+					if (dbHandles[idx].readerConnections && dbHandles[idx].pendingWriterStatements==0 && dbHandles[idx].writerInTransaction==false && IsReadStatement(inputStatement.C_String()))
+					{
+						input.readerConnections=dbHandles[idx].readerConnections;
+						sqlReaderThreadPool.AddInput(ExecReadStatementThread, input);
+					}
+					else
 					{
-						errorMsgStr=errorMsg;
-						sqlite3_free(errorMsg);
+						dbHandles[idx].pendingWriterStatements++;
+						sqlThreadPool.AddInput(ExecStatementThread, input);
 					}
+#else
+					SLNet::RakString errorMsgStr;
+					SQLite3Table outputTable;
+					unsigned int parameterCount;
+					if (bsIn.Read(parameterCount))
+						bsIn.AlignReadToByteBoundary();
+					else
+						parameterCount=0;
+					dbHandles[idx].statementCache->Exec(inputStatement.C_String(), &bsIn, parameterCount, &outputTable, &errorMsgStr);
 					SLNet::BitStream bsOut;
 					bsOut.Write((MessageID)ID_SQLite3_EXEC);
 					bsOut.Write(queryId);
@@ -256,17 +734,27 @@ void SQLite3ServerPlugin::OnDetach(void)
 void SQLite3ServerPlugin::StopThreads(void)
 {
 #ifdef SQLite3_STATEMENT_EXECUTE_THREADED
-	sqlThreadPool.StopThreads();
-	unsigned int i;
-	for (i=0; i < sqlThreadPool.InputSize(); i++)
+	ThreadPool<SQLExecThreadInput, SQLExecThreadOutput> *threadPools[2] = {&sqlThreadPool, &sqlReaderThreadPool};
+	for (int threadPoolIndex=0; threadPoolIndex < 2; threadPoolIndex++)
 	{
-		SLNet::OP_DELETE(sqlThreadPool.GetInputAtIndex(i).data, _FILE_AND_LINE_);
+		ThreadPool<SQLExecThreadInput, SQLExecThreadOutput> *threadPool=threadPools[threadPoolIndex];
+		threadPool->StopThreads();
+		unsigned int i;
+		for (i=0; i < threadPool->InputSize(); i++)
+		{
+			rakFree_Ex(threadPool->GetInputAtIndex(i).data, _FILE_AND_LINE_);
+		}
+		threadPool->ClearInput();
+		for (i=0; i < threadPool->OutputSize(); i++)
+		{
+			rakFree_Ex(threadPool->GetOutputAtIndex(i).data, _FILE_AND_LINE_);
+		}
+		threadPool->ClearOutput();
 	}
-	sqlThreadPool.ClearInput();
-	for (i=0; i < sqlThreadPool.OutputSize(); i++)
+	for (unsigned int idx=0; idx < dbHandles.GetSize(); idx++)
 	{
-		SLNet::OP_DELETE(sqlThreadPool.GetOutputAtIndex(i).data, _FILE_AND_LINE_);
+		dbHandles[idx].pendingWriterStatements=0;
+		dbHandles[idx].writerInTransaction=sqlite3_get_autocommit(dbHandles[idx].dbHandle)==0;
 	}
-	sqlThreadPool.ClearOutput();
 #endif
 }
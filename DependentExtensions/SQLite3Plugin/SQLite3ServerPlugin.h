@@ -33,6 +33,8 @@
 #include "slikenet/PacketPriority.h"
 #include "slikenet/SocketIncludes.h"
 #include "slikenet/DS_Multilist.h"
+#include "slikenet/DS_OrderedList.h"
+#include "slikenet/SimpleMutex.h"
 #include "..\..\Source\include\slikenet\slikeString.h"
 #include "sqlite3.h"
 #include "SQLite3PluginCommon.h"
@@ -46,6 +48,60 @@ class RakPeerInterface;
 namespace SLNet
 {
 
+/// \internal
+struct SQLite3CachedStatement
+{
+	SLNet::RakString sql;
+	sqlite3_stmt *statement;
+	// Where the text of the next statement starts in sql
+	int tailOffset;
+	uint64_t lastUse;
+};
+int SQLite3CachedStatementComp( const SLNet::RakString &key, SQLite3CachedStatement * const &data );
+
+/// \internal
+/// \brief Executes statements on one connection like sqlite3_exec(), keeping the prepared statements for reuse
+class SQLite3StatementCache
+{
+public:
+	SQLite3StatementCache(sqlite3 *_dbHandle, unsigned int _maxStatements);
+	~SQLite3StatementCache();
+
+	/// Executes the statements in \a sql, binding the first \a parameterCount values of \a parameters to their parameters, and adds the resulting rows to \a outputTable
+	/// \return SQLITE_OK, or the error of the first statement that failed, with its message in \a errorMsg
+	int Exec(const char *sql, SLNet::BitStream *parameters, unsigned int parameterCount, SQLite3Table *outputTable, SLNet::RakString *errorMsg);
+
+	/// Finalizes all kept statements. The connection can not be closed before.
+	void Clear(void);
+
+	sqlite3 *GetDBHandle(void) const;
+
+protected:
+	sqlite3_stmt *Prepare(const char *sql, const char **tail, bool *isCached, int *rc);
+
+	sqlite3 *dbHandle;
+	unsigned int maxStatements;
+	uint64_t useCount;
+	DataStructures::OrderedList<SLNet::RakString, SQLite3CachedStatement*, SQLite3CachedStatementComp> statements;
+};
+
+/// \internal
+/// \brief Read-only connections to a database file, shared by the reader threads of SQLite3ServerPlugin
+struct SQLite3ReaderConnections
+{
+	SQLite3ReaderConnections(const SLNet::RakString &_fileName, unsigned int _statementCacheSize);
+	~SQLite3ReaderConnections();
+
+	/// Returns an idle connection, or opens another one. Returns 0 if the file can not be opened.
+	SQLite3StatementCache *Acquire(void);
+	void Release(SQLite3StatementCache *connection);
+
+	SLNet::RakString fileName;
+	unsigned int statementCacheSize;
+	SLNet::SimpleMutex mutex;
+	DataStructures::List<SQLite3StatementCache*> idleConnections;
+};
+
 /// \brief Exec SQLLite commands over the network
 /// \details SQLite version 3 supports remote calls via networked file handles, but not over the regular internet<BR>
 /// This plugin will serialize calls to and results from sqlite3_exec<BR>
@@ -64,6 +120,27 @@ public:
 	/// \return true on success, false on dbIdentifier empty, or already in use
 	virtual bool AddDBHandle(SLNet::RakString dbIdentifier, sqlite3 *dbHandle, bool dbAutoCreated=false);
 
+	/// \brief Sets how many prepared statements are kept per connection, keyed by their text
+	/// \details A statement received again with the same text, typically with different SQLite3Parameters, is not parsed and planned again.<BR>
+	/// Defaults to 64. 0 prepares every statement again. Call before AddDBHandle().
+	void SetStatementCacheSize(unsigned int size);
+
+	/// \brief Runs SELECT statements on \a numThreads threads with read-only connections of their own, next to the thread running all other statements
+	/// \details Databases added with AddDBHandle() afterwards are switched to WAL mode, so the readers and the writer do not block each other. This needs SQLite 3.7.0 or later.
+	/// Databases that stay in another journal mode, such as in-memory databases, run all statements on the writer.<BR>
+	/// A SELECT statement only goes to a reader while no statements for its database are pending on the writer and no transaction begun with BEGIN is open on it, so it sees the results of all statements received before.
+	/// Statements using last_insert_rowid(), changes() or total_changes() always run on the writer, since these return the state of the connection.
+	/// Results of statements running on different threads may arrive in another order than the statements were sent.<BR>
+	/// Defaults to 0. Call before AddDBHandle(). Requires SQLite3_STATEMENT_EXECUTE_THREADED.
+	void SetReaderThreads(unsigned int numThreads);
+
+	/// \brief Sets how many statements the writer runs in one transaction at most
+	/// \details When statements for the same database are waiting while the writer is busy, the writer runs them in one transaction, so they share the cost of a commit.
+	/// Statements controlling transactions, PRAGMA, VACUUM, ATTACH, DETACH and texts with several statements always run on their own.
+	/// If the transaction is rolled back, the results of all statements in it carry the error.<BR>
+	/// Defaults to 1, which runs every statement in a transaction of its own as earlier versions did. Requires SQLite3_STATEMENT_EXECUTE_THREADED.
+	void SetMaxBatchSize(unsigned int size);
+
 	/// Stop using a dbHandle, lookup either by identifier or by pointer.
 	/// If SQLite3_STATEMENT_EXECUTE_THREADED is defined, do not call this while processing commands, since the commands run in a thread and might be using the dbHandle
 	/// Call before closing the handle or else SQLite3Plugin won't know that it was closed, and will continue using it
@@ -82,35 +159,59 @@ public:
 		sqlite3 *dbHandle;
 		bool dbAutoCreated;
 		SLNet::TimeMS whenCreated;
+		SQLite3StatementCache *statementCache;
+		// 0 unless SetReaderThreads() was called and the database is in WAL mode
+		SQLite3ReaderConnections *readerConnections;
+		// Statements added to sqlThreadPool and not returned yet
+		unsigned int pendingWriterStatements;
+		// A client began a transaction on the writer which is still open, as of the last statement returned
+		bool writerInTransaction;
 	};
 
 #ifdef SQLite3_STATEMENT_EXECUTE_THREADED
 	virtual void Update(void);
+	struct SQLExecThreadOutput;
 	/// \internal
 	struct SQLExecThreadInput
 	{
-		SQLExecThreadInput() {data=0; packet=0;}
+		SQLExecThreadInput() {data=0; packet=0; statementCache=0; readerConnections=0; threadPool=0; maxBatchSize=1;}
 		char *data;
 		unsigned int length;
 		SystemAddress sender;
 		SLNet::TimeMS whenMessageArrived;
 		sqlite3 *dbHandle;
 		SLNet::Packet *packet;
+		// Connection of the writer
+		SQLite3StatementCache *statementCache;
+		// Set to run on a reader connection instead
+		SQLite3ReaderConnections *readerConnections;
+		// The writer takes further statements for the same database from here
+		ThreadPool<SQLExecThreadInput, SQLExecThreadOutput> *threadPool;
+		unsigned int maxBatchSize;
 	};
 
 	/// \internal
 	struct SQLExecThreadOutput
 	{
-		SQLExecThreadOutput() {data=0; packet=0;}
+		SQLExecThreadOutput() {data=0; packet=0; dbHandle=0; inTransaction=false;}
 		char *data;
 		unsigned int length;
 		SystemAddress sender;
 		SLNet::Packet *packet;
+		// Set for output of the writer, to count the statements pending on it
+		sqlite3 *dbHandle;
+		// sqlite3_get_autocommit() of the writer returned 0 after the statement
+		bool inTransaction;
 	};
 #endif // SQLite3_STATEMENT_EXECUTE_THREADED
 
 protected:
 	virtual void StopThreads(void);
+	void FreeDBHandle(NamedDBHandle &ndbh, bool alsoCloseConnection);
+
+	unsigned int statementCacheSize;
+	unsigned int numReaderThreads;
+	unsigned int maxBatchSize;
 
 	// List of databases added with AddDBHandle()
 	DataStructures::Multilist<ML_ORDERED_LIST, NamedDBHandle, SLNet::RakString> dbHandles;
@@ -119,6 +220,8 @@ protected:
 	// The point of the sqlThreadPool is so that SQL queries, which are blocking, happen in the thread and don't slow down the rest of the application
 	// The sqlThreadPool has a queue for incoming processing requests.  As systems disconnect their pending requests are removed from the list.
 	ThreadPool<SQLExecThreadInput, SQLExecThreadOutput> sqlThreadPool;
+	// Runs SELECT statements on reader connections, see SetReaderThreads()
+	ThreadPool<SQLExecThreadInput, SQLExecThreadOutput> sqlReaderThreadPool;
 #endif
 };
 
@@ -63,24 +63,20 @@ public enum DefaultMessageIDTypes {
   ID_AUTOPATCHER_GET_PATCH,
   ID_AUTOPATCHER_PATCH_LIST,
   ID_AUTOPATCHER_REPOSITORY_FATAL_ERROR,
+  ID_AUTOPATCHER_CANNOT_DOWNLOAD_ORIGINAL_UNMODIFIED_FILES,
   ID_AUTOPATCHER_FINISHED_INTERNAL,
   ID_AUTOPATCHER_FINISHED,
   ID_AUTOPATCHER_RESTART_APPLICATION,
   ID_NAT_PUNCHTHROUGH_REQUEST,
-  ID_NAT_GROUP_PUNCHTHROUGH_REQUEST,
-  ID_NAT_GROUP_PUNCHTHROUGH_REPLY,
   ID_NAT_CONNECT_AT_TIME,
   ID_NAT_GET_MOST_RECENT_PORT,
   ID_NAT_CLIENT_READY,
-  ID_NAT_GROUP_PUNCHTHROUGH_FAILURE_NOTIFICATION,
   ID_NAT_TARGET_NOT_CONNECTED,
   ID_NAT_TARGET_UNRESPONSIVE,
   ID_NAT_CONNECTION_TO_TARGET_LOST,
   ID_NAT_ALREADY_IN_PROGRESS,
   ID_NAT_PUNCHTHROUGH_FAILED,
   ID_NAT_PUNCHTHROUGH_SUCCEEDED,
-  ID_NAT_GROUP_PUNCH_FAILED,
-  ID_NAT_GROUP_PUNCH_SUCCEEDED,
   ID_READY_EVENT_SET,
   ID_READY_EVENT_UNSET,
   ID_READY_EVENT_ALL_SET,
@@ -100,6 +96,11 @@ public enum DefaultMessageIDTypes {
   ID_FCM2_RESPOND_CONNECTION_COUNT,
   ID_FCM2_INFORM_FCMGUID,
   ID_FCM2_UPDATE_MIN_TOTAL_CONNECTION_COUNT,
+  ID_FCM2_VERIFIED_JOIN_START,
+  ID_FCM2_VERIFIED_JOIN_CAPABLE,
+  ID_FCM2_VERIFIED_JOIN_FAILED,
+  ID_FCM2_VERIFIED_JOIN_ACCEPTED,
+  ID_FCM2_VERIFIED_JOIN_REJECTED,
   ID_UDP_PROXY_GENERAL,
   ID_SQLite3_EXEC,
   ID_SQLite3_UNKNOWN_DB,
@@ -130,10 +131,13 @@ public enum DefaultMessageIDTypes {
   ID_CLOUD_UNSUBSCRIBE_REQUEST,
   ID_CLOUD_SERVER_TO_SERVER_COMMAND,
   ID_CLOUD_SUBSCRIPTION_NOTIFICATION,
-  ID_RESERVED_1,
-  ID_RESERVED_2,
-  ID_RESERVED_3,
-  ID_RESERVED_4,
+  ID_LIB_VOICE,
+  ID_RELAY_PLUGIN,
+  ID_NAT_REQUEST_BOUND_ADDRESSES,
+  ID_NAT_RESPOND_BOUND_ADDRESSES,
+  ID_FCM2_UPDATE_USER_CONTEXT,
+  ID_FILE_LIST_CHUNKED_TRANSFER,
+  ID_RAKVOICE_FORWARDING,
   ID_RESERVED_5,
   ID_RESERVED_6,
   ID_RESERVED_7,
@@ -124,6 +124,10 @@ public:
     // Validate a proof that the remote host has the key
     bool ValidateProof(const u8 *remote_proof, int proof_bytes);
 
+    // Derive a key from the session key, for a cipher that is run outside of this class
+    // The local key of the initiator is the remote key of the responder, and the other way around
+    bool GenerateKey(bool local, const char *key_name, u8 *key, int key_bytes);
+
 public:
 	void AllowOutOfOrder(bool allowed = true) { _accept_out_of_order = allowed; }
 
@@ -168,6 +168,24 @@ bool AuthenticatedEncryption::ValidateProof(const u8 *remote_proof, int proof_by
 
 
 
+bool AuthenticatedEncryption::GenerateKey(bool local, const char *key_name, u8 *key, int key_bytes)
+{
+    Skein kdf;
+
+    if (!kdf.SetKey(&key_hash) || !kdf.BeginKDF()) return false;
+    kdf.CrunchString(key_name);
+    kdf.CrunchString(local == _is_initiator ? "upstream" : "downstream");
+    kdf.End();
+
+    kdf.Generate(key, key_bytes);
+
+    return true;
+}
+
+
+
+
+
 bool AuthenticatedEncryption::IsValidIV(u64 iv)
 {
     // Check how far in the past this IV is
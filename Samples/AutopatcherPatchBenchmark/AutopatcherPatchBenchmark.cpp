@@ -0,0 +1,251 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Measures CreatePatch() on synthetic binaries, on one thread, on several threads, and with windows of limited size.
+// The windowed modes are also run with CreatePatchFile(), which reads the windows from the files and writes the patch to a file.
+// The old file consists of code, tables of records holding pointers, zero padding and incompressible resources.
+// The new file has code inserted and removed, which moves everything behind it, relocated pointers, scattered changes and an appended resource.
+// Each patch is checked with ApplyPatch().
+
+#include <sys/types.h>
+#include "CreatePatch.h"
+#include "ApplyPatch.h"
+#include "slikenet/GetTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+static unsigned int randomState=12345;
+
+static unsigned int Random(void)
+{
+	// xorshift, so the files are the same on all platforms
+	randomState^=randomState<<13;
+	randomState^=randomState>>17;
+	randomState^=randomState<<5;
+	return randomState;
+}
+
+static void GenerateCode(std::vector<unsigned char> &data, size_t length)
+{
+	// Instructions from a small set, with operands that are often repeated
+	static const unsigned char opcodes[]={0x55,0x89,0x8B,0xE8,0xC3,0x48,0x83,0x0F,0x74,0x75,0xFF,0x31};
+	size_t end=data.size()+length;
+	while (data.size() < end)
+	{
+		data.push_back(opcodes[Random()%sizeof(opcodes)]);
+		if (Random()%3==0)
+			data.push_back((unsigned char)(Random()%16));
+	}
+	data.resize(end);
+}
+
+static void GenerateTable(std::vector<unsigned char> &data, size_t length)
+{
+	// 16 byte records: an id, a pointer, flags and a small value
+	size_t end=data.size()+length;
+	unsigned int id=Random()%1000;
+	while (data.size() < end)
+	{
+		unsigned int record[4]={id++, 0x400000+(Random()%0x100000)*16, Random()%4, Random()%100};
+		data.insert(data.end(), (unsigned char*)record, (unsigned char*)record+sizeof(record));
+	}
+	data.resize(end);
+}
+
+static void GenerateBinary(std::vector<unsigned char> &data, size_t size)
+{
+	while (data.size() < size)
+	{
+		size_t length=4096+Random()%262144;
+		switch (Random()%8)
+		{
+		case 0:
+		case 1:
+		case 2:
+			GenerateCode(data, length);
+			break;
+		case 3:
+		case 4:
+			GenerateTable(data, length);
+			break;
+		case 5:
+			data.resize(data.size()+length/4, 0);
+			break;
+		default:
+			for (size_t i=0; i < length; i++)
+				data.push_back((unsigned char)Random());
+		}
+	}
+	data.resize(size);
+}
+
+static void ModifyBinary(const std::vector<unsigned char> &oldData, std::vector<unsigned char> &newData)
+{
+	newData=oldData;
+
+	// Relocate pointers of some records, as if code before the tables changed in size
+	for (size_t i=0; i+16 <= newData.size(); i+=16)
+	{
+		unsigned int pointer;
+		memcpy(&pointer, &newData[i+4], sizeof(pointer));
+		if (pointer >= 0x400000 && pointer < 0x1400000 && Random()%4==0)
+		{
+			pointer+=0x40;
+			memcpy(&newData[i+4], &pointer, sizeof(pointer));
+		}
+	}
+
+	// Scattered changes
+	for (size_t i=0; i < newData.size()/10000; i++)
+		newData[Random()%newData.size()]=(unsigned char)Random();
+
+	// Removed and inserted code, which moves the data behind it
+	for (int i=0; i < 4; i++)
+	{
+		size_t position=Random()%newData.size();
+		size_t length=16384+Random()%16384;
+		if (position+length > newData.size())
+			length=newData.size()-position;
+		newData.erase(newData.begin()+position, newData.begin()+position+length);
+	}
+	for (int i=0; i < 4; i++)
+	{
+		std::vector<unsigned char> code;
+		GenerateCode(code, 65536);
+		newData.insert(newData.begin()+Random()%newData.size(), code.begin(), code.end());
+	}
+
+	// Appended resource
+	for (int i=0; i < 1024*1024; i++)
+		newData.push_back((unsigned char)Random());
+}
+
+static void RunBenchmark(const char *mode, const std::vector<unsigned char> &oldData, std::vector<unsigned char> &newData, const CreatePatchSettings &settings)
+{
+	char *patch, *result;
+	unsigned int patchSize, resultSize;
+
+	SLNet::TimeUS startTime=SLNet::GetTimeUS();
+	if (CreatePatch((const char*)&oldData[0], (off_t)oldData.size(), (char*)&newData[0], (off_t)newData.size(), &patch, &patchSize, settings)==false)
+	{
+		printf("%-10s %8u %12u   CreatePatch failed\n", mode, settings.numThreads, settings.windowSize/(1024*1024));
+		return;
+	}
+	SLNet::TimeUS elapsed=SLNet::GetTimeUS()-startTime;
+
+	bool verified=ApplyPatch((char*)&oldData[0], (unsigned int)oldData.size(), &result, &resultSize, patch, patchSize) &&
+		resultSize==newData.size() && memcmp(result, &newData[0], resultSize)==0;
+	if (verified)
+		delete [] result;
+
+	printf("%-10s %8u %12u %10.2f %11u   %s\n", mode, settings.numThreads, settings.windowSize/(1024*1024), (double) elapsed / 1000000.0, patchSize/1024, verified ? "yes" : "NO");
+	delete [] patch;
+}
+
+static bool WriteFile(const char *filename, const char *data, size_t length)
+{
+	FILE *fp;
+	if (fopen_s(&fp, filename, "wb")!=0)
+		return false;
+	bool written=fwrite(data, 1, length, fp)==length;
+	return fclose(fp)==0 && written;
+}
+
+static char* ReadFile(const char *filename, unsigned int *length)
+{
+	FILE *fp;
+	if (fopen_s(&fp, filename, "rb")!=0)
+		return 0;
+	fseek(fp, 0, SEEK_END);
+	*length=(unsigned int) ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	char *data=new char[*length+1];
+	if (fread(data, 1, *length, fp)!=*length)
+	{
+		delete [] data;
+		data=0;
+	}
+	fclose(fp);
+	return data;
+}
+
+static void RunFileBenchmark(const char *mode, std::vector<unsigned char> &oldData, std::vector<unsigned char> &newData, const CreatePatchSettings &settings)
+{
+	const char *oldFilename="AutopatcherPatchBenchmark.old";
+	const char *newFilename="AutopatcherPatchBenchmark.new";
+	const char *patchFilename="AutopatcherPatchBenchmark.patch";
+	char *patch, *result;
+	unsigned int patchSize, resultSize;
+
+	if (WriteFile(oldFilename, (const char*)&oldData[0], oldData.size())==false || WriteFile(newFilename, (const char*)&newData[0], newData.size())==false)
+	{
+		printf("%-10s %8u %12u   Unable to write the files\n", mode, settings.numThreads, settings.windowSize/(1024*1024));
+		return;
+	}
+
+	SLNet::TimeUS startTime=SLNet::GetTimeUS();
+	bool created=CreatePatchFile(oldFilename, newFilename, patchFilename, settings);
+	SLNet::TimeUS elapsed=SLNet::GetTimeUS()-startTime;
+	remove(oldFilename);
+	remove(newFilename);
+	if (created==false || (patch=ReadFile(patchFilename, &patchSize))==0)
+	{
+		printf("%-10s %8u %12u   CreatePatchFile failed\n", mode, settings.numThreads, settings.windowSize/(1024*1024));
+		return;
+	}
+	remove(patchFilename);
+
+	bool verified=ApplyPatch((char*)&oldData[0], (unsigned int)oldData.size(), &result, &resultSize, patch, patchSize) &&
+		resultSize==newData.size() && memcmp(result, &newData[0], resultSize)==0;
+	if (verified)
+		delete [] result;
+
+	printf("%-10s %8u %12u %10.2f %11u   %s\n", mode, settings.numThreads, settings.windowSize/(1024*1024), (double) elapsed / 1000000.0, patchSize/1024, verified ? "yes" : "NO");
+	delete [] patch;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int sizeMB=32;
+	unsigned int numThreads=4;
+	unsigned int windowMB=8;
+	if (argc>=2)
+		sizeMB=atoi(argv[1]);
+	if (argc>=3)
+		numThreads=atoi(argv[2]);
+	if (argc>=4)
+		windowMB=atoi(argv[3]);
+
+	printf("Autopatcher CreatePatch benchmark\n");
+	printf("Usage: AutopatcherPatchBenchmark [sizeMB] [numThreads] [windowMB]\n\n");
+
+	std::vector<unsigned char> oldData, newData;
+	GenerateBinary(oldData, (size_t)sizeMB*1024*1024);
+	ModifyBinary(oldData, newData);
+	printf("Old file %u KB, new file %u KB\n\n", (unsigned int) (oldData.size()/1024), (unsigned int) (newData.size()/1024));
+
+	printf("mode        threads  window (MB)   time (s)  patch (KB)   verified\n");
+	CreatePatchSettings settings;
+	RunBenchmark("serial", oldData, newData, settings);
+	settings.numThreads=numThreads;
+	RunBenchmark("parallel", oldData, newData, settings);
+	settings.numThreads=1;
+	settings.windowSize=windowMB*1024*1024;
+	RunBenchmark("windowed", oldData, newData, settings);
+	settings.numThreads=numThreads;
+	RunBenchmark("windowed", oldData, newData, settings);
+	settings.numThreads=1;
+	RunFileBenchmark("file", oldData, newData, settings);
+	settings.numThreads=numThreads;
+	RunFileBenchmark("file", oldData, newData, settings);
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Measures the time to encrypt and to decrypt one datagram with each cipher suite of secure connections.
+// The keys come from a handshake between cat::ServerEasyHandshake and cat::ClientEasyHandshake, as in RakPeer.
+// Every decrypted datagram is compared with the original.
+
+#include "slikenet/NativeFeatureIncludes.h"
+#include "slikenet/SecureHandshake.h"
+#include "slikenet/AeadEncryption.h"
+#include "slikenet/GetTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+#if LIBCAT_SECURITY!=1
+#error "Define LIBCAT_SECURITY 1 in NativeFeatureIncludesOverrides.h to enable the cipher suite benchmark"
+#endif
+
+using namespace SLNet;
+
+static const char *cipherSuiteNames[CIPHER_SUITE_COUNT]={"Calico", "AES-128-GCM", "ChaCha20-Poly1305"};
+
+// Encrypts and decrypts datagrams with auth_enc for CIPHER_SUITE_CALICO, otherwise with aead_enc, the same way as ReliabilityLayer
+struct Endpoint
+{
+	cat::AuthenticatedEncryption auth_enc;
+	AeadEncryption aead_enc;
+
+	bool Encrypt(unsigned char *buffer, unsigned int bufferBytes, unsigned int &length)
+	{
+		if (aead_enc.GetCipherSuite()!=CIPHER_SUITE_CALICO)
+			return aead_enc.Encrypt(buffer, bufferBytes, length);
+		return auth_enc.Encrypt(buffer, bufferBytes, length);
+	}
+	bool Decrypt(unsigned char *buffer, unsigned int &length)
+	{
+		if (aead_enc.GetCipherSuite()!=CIPHER_SUITE_CALICO)
+			return aead_enc.Decrypt(buffer, length);
+		return auth_enc.Decrypt(buffer, length);
+	}
+};
+
+static bool Handshake(cat::ServerEasyHandshake &serverHandshake, const char *publicKey, Endpoint &server, Endpoint &client)
+{
+	cat::ClientEasyHandshake clientHandshake;
+	char challenge[cat::EasyHandshake::CHALLENGE_BYTES];
+	char answer[cat::EasyHandshake::ANSWER_BYTES];
+	return clientHandshake.Initialize(publicKey) &&
+		clientHandshake.GenerateChallenge(challenge) &&
+		serverHandshake.ProcessChallenge(challenge, answer, &server.auth_enc) &&
+		clientHandshake.ProcessAnswer(answer, &client.auth_enc);
+}
+
+static void RunBenchmark(CipherSuite cipherSuite, cat::ServerEasyHandshake &serverHandshake, const char *publicKey, unsigned int datagramSize, unsigned int numDatagrams)
+{
+	Endpoint server, client;
+	if (Handshake(serverHandshake, publicKey, server, client)==false)
+	{
+		printf("%-18s handshake failed\n", cipherSuiteNames[cipherSuite]);
+		return;
+	}
+	if (cipherSuite!=CIPHER_SUITE_CALICO &&
+		(client.aead_enc.SetKey(cipherSuite, &client.auth_enc)==false || server.aead_enc.SetKey(cipherSuite, &server.auth_enc)==false))
+	{
+		printf("%-18s not supported by this OpenSSL library\n", cipherSuiteNames[cipherSuite]);
+		return;
+	}
+
+	// Datagrams are encrypted in place, with room for the overhead at the end
+	const unsigned int messageBytes=datagramSize-cat::AuthenticatedEncryption::OVERHEAD_BYTES;
+	std::vector<unsigned char> plaintext(messageBytes);
+	for (unsigned int i=0; i < messageBytes; i++)
+		plaintext[i]=(unsigned char) rand();
+	std::vector<unsigned char> datagrams((size_t) numDatagrams*datagramSize);
+	std::vector<unsigned int> lengths(numDatagrams);
+	for (unsigned int i=0; i < numDatagrams; i++)
+		memcpy(&datagrams[(size_t) i*datagramSize], &plaintext[0], messageBytes);
+
+	bool verified=true;
+	SLNet::TimeUS startTime=SLNet::GetTimeUS();
+	for (unsigned int i=0; i < numDatagrams; i++)
+	{
+		lengths[i]=messageBytes;
+		verified&=client.Encrypt(&datagrams[(size_t) i*datagramSize], datagramSize, lengths[i]);
+	}
+	SLNet::TimeUS encryptTime=SLNet::GetTimeUS()-startTime;
+
+	startTime=SLNet::GetTimeUS();
+	for (unsigned int i=0; i < numDatagrams; i++)
+		verified&=server.Decrypt(&datagrams[(size_t) i*datagramSize], lengths[i]);
+	SLNet::TimeUS decryptTime=SLNet::GetTimeUS()-startTime;
+
+	for (unsigned int i=0; i < numDatagrams && verified; i++)
+		verified=lengths[i]==messageBytes && memcmp(&datagrams[(size_t) i*datagramSize], &plaintext[0], messageBytes)==0;
+
+	// A datagram with a changed byte must be rejected
+	unsigned int length=messageBytes;
+	verified&=client.Encrypt(&datagrams[0], datagramSize, length);
+	datagrams[messageBytes/2]^=1;
+	verified&=server.Decrypt(&datagrams[0], length)==false;
+
+	printf("%-18s %8u %12.0f %12.0f %12.1f %12.1f   %s\n", cipherSuiteNames[cipherSuite], datagramSize,
+		(double) encryptTime*1000.0/numDatagrams, (double) decryptTime*1000.0/numDatagrams,
+		(double) messageBytes*numDatagrams/encryptTime, (double) messageBytes*numDatagrams/decryptTime,
+		verified ? "yes" : "NO");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int numDatagrams=200000;
+	if (argc>=2)
+		numDatagrams=atoi(argv[1]);
+
+	printf("Per datagram encryption benchmark of the cipher suites of secure connections\n");
+	printf("Usage: CipherSuiteBenchmark [numDatagrams]\n\n");
+
+	if (!cat::EasyHandshake::Initialize())
+	{
+		printf("Unable to initialize the crypto subsystem\n");
+		return 1;
+	}
+
+	char publicKey[cat::EasyHandshake::PUBLIC_KEY_BYTES];
+	char privateKey[cat::EasyHandshake::PRIVATE_KEY_BYTES];
+	cat::EasyHandshake keyGenerator;
+	cat::ServerEasyHandshake serverHandshake;
+	if (!keyGenerator.GenerateServerKey(publicKey, privateKey) || !serverHandshake.Initialize(publicKey, privateKey))
+	{
+		printf("Unable to generate the server key\n");
+		return 1;
+	}
+
+	static const unsigned int datagramSizes[]={64, 576, 1492};
+	printf("cipher suite       datagram  encrypt (ns) decrypt (ns) encrypt MB/s decrypt MB/s   verified\n");
+	for (unsigned int i=0; i < sizeof(datagramSizes)/sizeof(datagramSizes[0]); i++)
+	{
+		for (int cipherSuite=0; cipherSuite < CIPHER_SUITE_COUNT; cipherSuite++)
+			RunBenchmark((CipherSuite) cipherSuite, serverHandshake, publicKey, datagramSizes[i], numDatagrams);
+	}
+
+	return 0;
+}
@@ -0,0 +1,302 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Measures Get() latency and throughput of sharded CloudServer instances as servers are added.
+// Every server runs in its own process on loopback. The benchmark starts them one by one by running itself with the "server" argument.
+
+#include "slikenet/peerinterface.h"
+#include "slikenet/CloudServer.h"
+#include "slikenet/CloudClient.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/sleep.h"
+#include "slikenet/DS_Queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+#ifdef _WIN32
+#include "slikenet/WindowsIncludes.h"
+#else
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+using namespace SLNet;
+
+static const unsigned short SERVER_BASE_PORT=61000;
+static const int MAX_SERVERS=8;
+static const int NUM_KEYS=20000;
+static const int GETS_PER_ROUND=20000;
+static const int GETS_IN_FLIGHT=256;
+static const MessageID ID_BENCHMARK_QUIT=ID_USER_PACKET_ENUM;
+
+static bool IsServerPort(unsigned short port)
+{
+	return port>=SERVER_BASE_PORT && port<SERVER_BASE_PORT+MAX_SERVERS;
+}
+
+static void KeyName(int keyIndex, char *out, size_t outLength)
+{
+	sprintf_s(out, outLength, "presence%i", keyIndex);
+}
+
+static int RunServer(int serverIndex)
+{
+	RakPeerInterface *rakPeer=RakPeerInterface::GetInstance();
+	CloudServer cloudServer;
+	rakPeer->AttachPlugin(&cloudServer);
+	cloudServer.SetSharding(true);
+	SocketDescriptor sd(SERVER_BASE_PORT+(unsigned short) serverIndex, "127.0.0.1");
+	if (rakPeer->Startup(64, &sd, 1)!=RAKNET_STARTED)
+	{
+		printf("Server %i failed to start\n", serverIndex);
+		return 1;
+	}
+	rakPeer->SetMaximumIncomingConnections(64);
+
+	// Fully connected mesh. Servers started earlier accept the connection and call AddServer() on their side.
+	for (int i=0; i < serverIndex; i++)
+		rakPeer->Connect("127.0.0.1", SERVER_BASE_PORT+(unsigned short) i, 0, 0);
+
+	bool quit=false;
+	while (quit==false)
+	{
+		bool gotPacket=false;
+		for (Packet *packet=rakPeer->Receive(); packet; rakPeer->DeallocatePacket(packet), packet=rakPeer->Receive())
+		{
+			gotPacket=true;
+			switch (packet->data[0])
+			{
+			case ID_NEW_INCOMING_CONNECTION:
+			case ID_CONNECTION_REQUEST_ACCEPTED:
+				if (IsServerPort(packet->systemAddress.GetPort()))
+					cloudServer.AddServer(packet->guid);
+				break;
+			case ID_BENCHMARK_QUIT:
+				quit=true;
+				break;
+			}
+		}
+		if (gotPacket==false)
+			RakSleep(1);
+	}
+
+	rakPeer->Shutdown(100);
+	RakPeerInterface::DestroyInstance(rakPeer);
+	return 0;
+}
+
+static bool StartServerProcess(const char *executable, int serverIndex)
+{
+	char indexStr[16];
+	sprintf_s(indexStr, "%i", serverIndex);
+#ifdef _WIN32
+	char commandLine[1024];
+	sprintf_s(commandLine, "\"%s\" server %s", executable, indexStr);
+	STARTUPINFOA startupInfo;
+	PROCESS_INFORMATION processInfo;
+	memset(&startupInfo, 0, sizeof(startupInfo));
+	startupInfo.cb=sizeof(startupInfo);
+	if (CreateProcessA(0, commandLine, 0, 0, FALSE, 0, 0, 0, &startupInfo, &processInfo)==FALSE)
+		return false;
+	CloseHandle(processInfo.hThread);
+	CloseHandle(processInfo.hProcess);
+	return true;
+#else
+	pid_t pid=fork();
+	if (pid==0)
+	{
+		execl(executable, executable, "server", indexStr, (char*) 0);
+		_exit(1);
+	}
+	return pid>0;
+#endif
+}
+
+struct Client
+{
+	RakPeerInterface *rakPeer;
+	CloudClient cloudClient;
+	RakNetGUID serverGUIDs[MAX_SERVERS];
+};
+
+// Returns the server index the packet came from, or -1
+static int ProcessClientPackets(Client &client, DataStructures::Queue<SLNet::TimeUS> *sendTimes, std::vector<SLNet::TimeUS> *latencies, int *rowsReturned)
+{
+	int newServer=-1;
+	for (Packet *packet=client.rakPeer->Receive(); packet; client.rakPeer->DeallocatePacket(packet), packet=client.rakPeer->Receive())
+	{
+		if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+		{
+			newServer=packet->systemAddress.GetPort()-SERVER_BASE_PORT;
+			client.serverGUIDs[newServer]=packet->guid;
+		}
+		else if (packet->data[0]==ID_CLOUD_GET_RESPONSE && sendTimes)
+		{
+			CloudQueryResult cloudQueryResult;
+			client.cloudClient.OnGetReponse(&cloudQueryResult, packet);
+			*rowsReturned+=cloudQueryResult.rowsReturned.Size();
+			client.cloudClient.DeallocateWithDefaultAllocator(&cloudQueryResult);
+
+			// Responses from one server arrive in the order the requests were sent
+			int serverIndex=packet->systemAddress.GetPort()-SERVER_BASE_PORT;
+			latencies->push_back(SLNet::GetTimeUS()-sendTimes[serverIndex].Pop());
+		}
+	}
+	return newServer;
+}
+
+static bool ConnectClient(Client &client, int serverIndex)
+{
+	client.rakPeer->Connect("127.0.0.1", SERVER_BASE_PORT+(unsigned short) serverIndex, 0, 0);
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+5000;
+	while (SLNet::GetTimeMS() < timeout)
+	{
+		if (ProcessClientPackets(client, 0, 0, 0)==serverIndex)
+			return true;
+		RakSleep(1);
+	}
+	return false;
+}
+
+static void WaitAndDiscardPackets(Client &client, SLNet::TimeMS ms)
+{
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+ms;
+	while (SLNet::GetTimeMS() < timeout)
+	{
+		ProcessClientPackets(client, 0, 0, 0);
+		RakSleep(1);
+	}
+}
+
+static void RunRound(Client &reader, int numServers)
+{
+	DataStructures::Queue<SLNet::TimeUS> sendTimes[MAX_SERVERS];
+	std::vector<SLNet::TimeUS> latencies;
+	latencies.reserve(GETS_PER_ROUND);
+	int rowsReturned=0;
+	int getsSent=0;
+	char keyName[32];
+
+	SLNet::TimeUS startTime=SLNet::GetTimeUS();
+	while ((int) latencies.size() < GETS_PER_ROUND)
+	{
+		// Each Get() asks for one random key, from servers in turn
+		while (getsSent < GETS_PER_ROUND && getsSent-(int) latencies.size() < GETS_IN_FLIGHT)
+		{
+			KeyName(rand() % NUM_KEYS, keyName, sizeof(keyName));
+			CloudQuery cloudQuery;
+			cloudQuery.keys.Push(CloudKey(keyName, 0), _FILE_AND_LINE_);
+			int serverIndex=getsSent % numServers;
+			sendTimes[serverIndex].Push(SLNet::GetTimeUS(), _FILE_AND_LINE_);
+			reader.cloudClient.Get(&cloudQuery, reader.serverGUIDs[serverIndex]);
+			getsSent++;
+		}
+		int receivedBefore=(int) latencies.size();
+		ProcessClientPackets(reader, sendTimes, &latencies, &rowsReturned);
+		if ((int) latencies.size()==receivedBefore)
+			RakSleep(0);
+	}
+	SLNet::TimeUS elapsed=SLNet::GetTimeUS()-startTime;
+
+	std::sort(latencies.begin(), latencies.end());
+	SLNet::TimeUS total=0;
+	for (size_t i=0; i < latencies.size(); i++)
+		total+=latencies[i];
+	printf("%7i %12.0f %10.2f %10.2f %10.2f %10i\n",
+		numServers,
+		(double) GETS_PER_ROUND * 1000000.0 / (double) elapsed,
+		(double) total / (double) latencies.size() / 1000.0,
+		(double) latencies[latencies.size()/2] / 1000.0,
+		(double) latencies[latencies.size()*99/100] / 1000.0,
+		GETS_PER_ROUND-rowsReturned);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc>=3 && strcmp(argv[1], "server")==0)
+		return RunServer(atoi(argv[2]));
+
+	int maxServers=MAX_SERVERS;
+	if (argc>=2)
+		maxServers=std::max(1, std::min(MAX_SERVERS, atoi(argv[1])));
+
+	printf("Sharded CloudServer benchmark\n");
+	printf("%i keys, %i Get() requests of one key per round, %i requests in flight\n", NUM_KEYS, GETS_PER_ROUND, GETS_IN_FLIGHT);
+	printf("Usage: CloudServerShardingBenchmark [maxServers]\n\n");
+
+	// The uploader stays connected to the first server, which keeps the data and replicates it to the owners of the keys
+	Client uploader, reader;
+	uploader.rakPeer=RakPeerInterface::GetInstance();
+	uploader.rakPeer->AttachPlugin(&uploader.cloudClient);
+	reader.rakPeer=RakPeerInterface::GetInstance();
+	reader.rakPeer->AttachPlugin(&reader.cloudClient);
+	SocketDescriptor sd;
+	uploader.rakPeer->Startup(MAX_SERVERS, &sd, 1);
+	reader.rakPeer->Startup(MAX_SERVERS, &sd, 1);
+
+	printf("servers       gets/s   avg (ms)   p50 (ms)   p99 (ms)    missing\n");
+	for (int numServers=1; numServers <= maxServers; numServers++)
+	{
+		int serverIndex=numServers-1;
+		if (StartServerProcess(argv[0], serverIndex)==false)
+		{
+			printf("Failed to start server process %i\n", serverIndex);
+			break;
+		}
+		RakSleep(500);
+		if (ConnectClient(reader, serverIndex)==false)
+		{
+			printf("Failed to connect to server %i\n", serverIndex);
+			break;
+		}
+
+		if (numServers==1)
+		{
+			ConnectClient(uploader, 0);
+			char keyName[32];
+			for (int keyIndex=0; keyIndex < NUM_KEYS; keyIndex++)
+			{
+				KeyName(keyIndex, keyName, sizeof(keyName));
+				CloudKey cloudKey(keyName, 0);
+				uploader.cloudClient.Post(&cloudKey, (const unsigned char*) &keyIndex, sizeof(keyIndex), uploader.serverGUIDs[0]);
+			}
+		}
+
+		// Let the mesh form and the keys move to their new owners
+		WaitAndDiscardPackets(uploader, 500);
+		WaitAndDiscardPackets(reader, 1000);
+
+		RunRound(reader, numServers);
+	}
+
+	// Stop the server processes
+	for (int i=0; i < MAX_SERVERS; i++)
+	{
+		if (reader.serverGUIDs[i]!=UNASSIGNED_RAKNET_GUID)
+		{
+			SLNet::BitStream bsOut;
+			bsOut.Write(ID_BENCHMARK_QUIT);
+			reader.rakPeer->Send(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, reader.serverGUIDs[i], false);
+		}
+	}
+	RakSleep(500);
+#ifndef _WIN32
+	while (waitpid(-1, 0, WNOHANG)>0)
+		;
+#endif
+
+	uploader.rakPeer->Shutdown(100);
+	reader.rakPeer->Shutdown(100);
+	RakPeerInterface::DestroyInstance(uploader.rakPeer);
+	RakPeerInterface::DestroyInstance(reader.rakPeer);
+	return 0;
+}
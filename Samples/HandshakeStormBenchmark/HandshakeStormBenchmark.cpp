@@ -0,0 +1,237 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Connects many clients at once to a server with secure connections, first with the key agreement on the network thread
+// and then with the key agreement on a pool of threads, see RakPeerInterface::SetHandshakeThreads().
+// Measures the handshakes per second, and the latency of a client connected before the storm, which sends a timestamp
+// the server echoes back. The echo is delayed for as long as the network thread of the server is busy.
+
+#include "slikenet/NativeFeatureIncludes.h"
+#include "slikenet/peerinterface.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/sleep.h"
+#include "slikenet/SecureHandshake.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+#if LIBCAT_SECURITY!=1
+#error "Define LIBCAT_SECURITY 1 in NativeFeatureIncludesOverrides.h to enable the handshake storm benchmark"
+#endif
+
+using namespace SLNet;
+
+static const unsigned short SERVER_PORT=61200;
+// How often the probe sends a timestamp
+static const SLNet::TimeUS PROBE_INTERVAL_US=5000;
+static const SLNet::TimeMS STORM_TIMEOUT_MS=60000;
+
+struct LatencyStatistics
+{
+	LatencyStatistics() : count(0), sumUS(0), maxUS(0) {}
+	void Add(SLNet::TimeUS latencyUS)
+	{
+		count++;
+		sumUS+=latencyUS;
+		if (latencyUS > maxUS)
+			maxUS=latencyUS;
+	}
+	double AverageMS(void) const {return count ? (double) sumUS/count/1000.0 : 0.0;}
+	double MaxMS(void) const {return (double) maxUS/1000.0;}
+
+	unsigned int count;
+	SLNet::TimeUS sumUS, maxUS;
+};
+
+// Server, probe and clients, all updated from the main thread
+struct Storm
+{
+	RakPeerInterface *server, *probe;
+	std::vector<RakPeerInterface*> clients;
+	SLNet::TimeUS nextProbeTime;
+	LatencyStatistics *latency;
+	unsigned int accepted, failed;
+	SLNet::TimeUS lastAcceptedTime;
+
+	void Update(void)
+	{
+		Packet *packet;
+		for (packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			// Echo the timestamp of the probe
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+				server->Send((const char*) packet->data, packet->length, HIGH_PRIORITY, UNRELIABLE, 0, packet->systemAddress, false);
+		}
+
+		for (packet=probe->Receive(); packet; probe->DeallocatePacket(packet), packet=probe->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM && latency)
+			{
+				SLNet::BitStream bs(packet->data, packet->length, false);
+				bs.IgnoreBytes(sizeof(MessageID));
+				SLNet::TimeUS sendTime;
+				bs.Read(sendTime);
+				latency->Add(SLNet::GetTimeUS()-sendTime);
+			}
+		}
+
+		SLNet::TimeUS time=SLNet::GetTimeUS();
+		if (time >= nextProbeTime)
+		{
+			SLNet::BitStream bs;
+			bs.Write((MessageID) ID_USER_PACKET_ENUM);
+			bs.Write(time);
+			probe->Send(&bs, HIGH_PRIORITY, UNRELIABLE, 0, SLNet::UNASSIGNED_SYSTEM_ADDRESS, true);
+			nextProbeTime=time+PROBE_INTERVAL_US;
+		}
+
+		for (size_t i=0; i < clients.size(); i++)
+		{
+			for (packet=clients[i]->Receive(); packet; clients[i]->DeallocatePacket(packet), packet=clients[i]->Receive())
+			{
+				switch (packet->data[0])
+				{
+				case ID_CONNECTION_REQUEST_ACCEPTED:
+					accepted++;
+					lastAcceptedTime=SLNet::GetTimeUS();
+					break;
+				case ID_CONNECTION_ATTEMPT_FAILED:
+				case ID_NO_FREE_INCOMING_CONNECTIONS:
+				case ID_ALREADY_CONNECTED:
+				case ID_IP_RECENTLY_CONNECTED:
+				case ID_CONNECTION_BANNED:
+				case ID_INCOMPATIBLE_PROTOCOL_VERSION:
+				case ID_REMOTE_SYSTEM_REQUIRES_PUBLIC_KEY:
+				case ID_OUR_SYSTEM_REQUIRES_SECURITY:
+				case ID_PUBLIC_KEY_MISMATCH:
+					failed++;
+					break;
+				}
+			}
+		}
+	}
+};
+
+static bool RunStorm(unsigned int handshakeThreads, unsigned int numClients, char *publicKey, char *privateKey, unsigned short port)
+{
+	Storm storm;
+	storm.server=RakPeerInterface::GetInstance();
+	storm.probe=RakPeerInterface::GetInstance();
+	storm.nextProbeTime=0;
+	storm.latency=0;
+	storm.accepted=0;
+	storm.failed=0;
+	storm.lastAcceptedTime=0;
+
+	PublicKey pk;
+	pk.publicKeyMode=PKM_USE_KNOWN_PUBLIC_KEY;
+	pk.remoteServerPublicKey=publicKey;
+	pk.myPublicKey=0;
+	pk.myPrivateKey=0;
+
+	storm.server->InitializeSecurity(publicKey, privateKey);
+	storm.server->SetHandshakeThreads(handshakeThreads);
+	SocketDescriptor socketDescriptor(port, 0);
+	if (storm.server->Startup(numClients+1, &socketDescriptor, 1)!=RAKNET_STARTED)
+	{
+		printf("Unable to start the server on port %i\n", port);
+		RakPeerInterface::DestroyInstance(storm.server);
+		RakPeerInterface::DestroyInstance(storm.probe);
+		return false;
+	}
+	storm.server->SetMaximumIncomingConnections((unsigned short) (numClients+1));
+
+	socketDescriptor.port=0;
+	storm.probe->Startup(1, &socketDescriptor, 1);
+	storm.probe->Connect("127.0.0.1", port, 0, 0, &pk);
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+5000;
+	while (storm.probe->NumberOfConnections()==0 && SLNet::GetTimeMS() < timeout)
+	{
+		storm.Update();
+		RakSleep(1);
+	}
+
+	// Latency while the server is idle
+	LatencyStatistics idleLatency, stormLatency;
+	storm.latency=&idleLatency;
+	timeout=SLNet::GetTimeMS()+1000;
+	while (SLNet::GetTimeMS() < timeout)
+	{
+		storm.Update();
+		RakSleep(1);
+	}
+
+	storm.clients.resize(numClients);
+	for (unsigned int i=0; i < numClients; i++)
+	{
+		storm.clients[i]=RakPeerInterface::GetInstance();
+		storm.clients[i]->Startup(1, &socketDescriptor, 1);
+	}
+
+	// All clients connect at once
+	storm.latency=&stormLatency;
+	SLNet::TimeUS stormStartTime=SLNet::GetTimeUS();
+	for (unsigned int i=0; i < numClients; i++)
+		storm.clients[i]->Connect("127.0.0.1", port, 0, 0, &pk, 0, 12, 500);
+	timeout=SLNet::GetTimeMS()+STORM_TIMEOUT_MS;
+	while (storm.accepted+storm.failed < numClients && SLNet::GetTimeMS() < timeout)
+	{
+		storm.Update();
+		RakSleep(1);
+	}
+
+	double stormSeconds=(double) (storm.lastAcceptedTime-stormStartTime)/1000000.0;
+	printf("%17u %8u %8u %6u %13.1f %9.2f %9.2f %9.2f %9.2f\n", handshakeThreads, numClients, storm.accepted, numClients-storm.accepted,
+		storm.accepted && stormSeconds > 0.0 ? storm.accepted/stormSeconds : 0.0,
+		idleLatency.AverageMS(), idleLatency.MaxMS(), stormLatency.AverageMS(), stormLatency.MaxMS());
+
+	for (unsigned int i=0; i < numClients; i++)
+		RakPeerInterface::DestroyInstance(storm.clients[i]);
+	RakPeerInterface::DestroyInstance(storm.probe);
+	RakPeerInterface::DestroyInstance(storm.server);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int numClients=64;
+	unsigned int handshakeThreads=4;
+	if (argc>=2)
+		numClients=atoi(argv[1]);
+	if (argc>=3)
+		handshakeThreads=atoi(argv[2]);
+
+	printf("Secure connection handshakes per second, and the latency of a connected client during a storm of connection requests\n");
+	printf("Usage: HandshakeStormBenchmark [numClients] [handshakeThreads]\n\n");
+
+	if (!cat::EasyHandshake::Initialize())
+	{
+		printf("Unable to initialize the crypto subsystem\n");
+		return 1;
+	}
+
+	char publicKey[cat::EasyHandshake::PUBLIC_KEY_BYTES];
+	char privateKey[cat::EasyHandshake::PRIVATE_KEY_BYTES];
+	cat::EasyHandshake keyGenerator;
+	if (!keyGenerator.GenerateServerKey(publicKey, privateKey))
+	{
+		printf("Unable to generate the server key\n");
+		return 1;
+	}
+
+	printf("                                                           idle latency (ms)   storm latency (ms)\n");
+	printf("handshake threads  clients accepted failed  handshakes/s       avg       max       avg       max\n");
+	// The key agreement runs on the network thread with 0 threads
+	RunStorm(0, numClients, publicKey, privateKey, SERVER_PORT);
+	RunStorm(handshakeThreads, numClients, publicKey, privateKey, SERVER_PORT+1);
+
+	return 0;
+}
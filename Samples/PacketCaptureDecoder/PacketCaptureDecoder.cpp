@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Converts a capture file written by PacketCaptureLogger to the CSV format written by PacketLogger
+
+#include "slikenet/PacketCaptureLogger.h"
+#include <stdio.h>
+#include <string.h>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+int main(int argc, char **argv)
+{
+	const char *captureFilename=0;
+	const char *csvFilename=0;
+	bool includePayload=false;
+	bool printId=true;
+	for (int i=1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-payload")==0)
+			includePayload=true;
+		else if (strcmp(argv[i], "-numericids")==0)
+			printId=false;
+		else if (captureFilename==0)
+			captureFilename=argv[i];
+		else
+			csvFilename=argv[i];
+	}
+
+	if (captureFilename==0)
+	{
+		printf("Converts a capture file written by PacketCaptureLogger to the CSV format written by PacketLogger.\n");
+		printf("Usage: PacketCaptureDecoder [-payload] [-numericids] capture.slncap [output.csv]\n");
+		printf("-payload     Add the captured message bytes in hex to the Miscellaneous column\n");
+		printf("-numericids  Print message IDs as numbers instead of ID_* names\n");
+		printf("Without an output file the CSV is written to the console.\n");
+		return 1;
+	}
+
+	FILE *csvFile=stdout;
+	if (csvFilename && fopen_s(&csvFile, csvFilename, "wt")!=0)
+	{
+		printf("Failed to open %s\n", csvFilename);
+		return 1;
+	}
+
+	SLNet::PacketCaptureLogger packetCaptureLogger;
+	packetCaptureLogger.SetPrintID(printId);
+	bool success=packetCaptureLogger.DecodeFile(captureFilename, csvFile, includePayload);
+	if (csvFile!=stdout)
+		fclose(csvFile);
+	if (success==false)
+	{
+		printf("%s is not a capture file or could not be read\n", captureFilename);
+		return 1;
+	}
+	return 0;
+}
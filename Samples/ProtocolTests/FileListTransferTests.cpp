@@ -0,0 +1,328 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "ProtocolTests.h"
+#include "slikenet/FileListTransfer.h"
+#include "slikenet/FileListTransferCBInterface.h"
+#include "slikenet/ContentDefinedChunker.h"
+#include "slikenet/IncrementalWriteInterface.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/StringCompressor.h"
+#include "slikenet/Rand.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+using namespace SLNet;
+
+// Chunked transfer sub-messages, see FileListTransfer::OnChunkedTransfer()
+static const unsigned char CHUNKED_MANIFEST=0;
+static const unsigned char CHUNKED_CHUNK=2;
+
+static const char *SCAN_TEST_FILENAME="ProtocolTestsChunked.bin";
+static const char *RENAME_TEST_FILENAME="ProtocolTestsRename.bin";
+
+class ChunkedReceiveCallback : public FileListTransferCBInterface
+{
+public:
+	ChunkedReceiveCallback() {filesReceived=0; progressCalls=0; dereferenceCalls=0; byteLengthOfLastFile=0; lastFileData=0;}
+	~ChunkedReceiveCallback() {rakFree_Ex(lastFileData, _FILE_AND_LINE_);}
+	bool OnFile(OnFileStruct *onFileStruct)
+	{
+		filesReceived++;
+		byteLengthOfLastFile=onFileStruct->byteLengthOfThisFile;
+		rakFree_Ex(lastFileData, _FILE_AND_LINE_);
+		lastFileData=0;
+		if (onFileStruct->fileData)
+		{
+			lastFileData=(char*) rakMalloc_Ex(byteLengthOfLastFile, _FILE_AND_LINE_);
+			memcpy(lastFileData, onFileStruct->fileData, byteLengthOfLastFile);
+		}
+		return true;
+	}
+	void OnFileProgress(FileProgressStruct *fps) {(void) fps; progressCalls++;}
+	bool Update(void) {return true;}
+	void OnDereference(void) {dereferenceCalls++;}
+
+	int filesReceived, progressCalls, dereferenceCalls;
+	unsigned int byteLengthOfLastFile;
+	char *lastFileData;
+};
+
+static void FeedMessage(FileListTransfer &fileListTransfer, SLNet::BitStream &bitStream)
+{
+	Packet packet;
+	packet.data=bitStream.GetData();
+	packet.length=bitStream.GetNumberOfBytesUsed();
+	packet.bitSize=bitStream.GetNumberOfBitsUsed();
+	packet.systemAddress=UNASSIGNED_SYSTEM_ADDRESS;
+	packet.guid=UNASSIGNED_RAKNET_GUID;
+	packet.deleteData=false;
+	packet.wasGeneratedLocally=false;
+	fileListTransfer.OnReceive(&packet);
+}
+
+// hashes may be 0, in which case every chunk gets the same made up hash
+static void FeedManifest(FileListTransfer &fileListTransfer, unsigned short setID, const char *filename, unsigned int fileLength, unsigned int numChunks, const unsigned int *chunkLengths, const unsigned char (*hashes)[20])
+{
+	static const unsigned char madeUpHash[20]={0};
+	SLNet::BitStream bitStream;
+	bitStream.Write((MessageID)ID_FILE_LIST_CHUNKED_TRANSFER);
+	bitStream.Write(CHUNKED_MANIFEST);
+	bitStream.Write(setID);
+	FileListNodeContext context;
+	bitStream << context;
+	StringCompressor::Instance()->EncodeString(filename, 512, &bitStream);
+	bitStream.WriteCompressed((unsigned int) 0);
+	bitStream.WriteCompressed(fileLength);
+	bitStream.WriteCompressed(numChunks);
+	for (unsigned int i=0; i < numChunks; i++)
+	{
+		bitStream.WriteCompressed(chunkLengths[i]);
+		bitStream.WriteAlignedBytes(hashes ? hashes[i] : madeUpHash, 20);
+	}
+	FeedMessage(fileListTransfer, bitStream);
+}
+
+static void FeedChunk(FileListTransfer &fileListTransfer, unsigned short setID, unsigned int chunkIndex, const char *data, unsigned int dataLength)
+{
+	SLNet::BitStream bitStream;
+	bitStream.Write((MessageID)ID_FILE_LIST_CHUNKED_TRANSFER);
+	bitStream.Write(CHUNKED_CHUNK);
+	bitStream.Write(setID);
+	bitStream.WriteCompressed((unsigned int) 0);
+	bitStream.WriteCompressed(chunkIndex);
+	bitStream.AlignWriteToByteBoundary();
+	bitStream.Write(data, dataLength);
+	FeedMessage(fileListTransfer, bitStream);
+}
+
+// More chunks than fit in the file, which used to be allocated before anything was checked
+static void TestManifestWithTooManyChunks(void)
+{
+	FileListTransfer fileListTransfer;
+	ChunkedReceiveCallback callback;
+	unsigned short setID = fileListTransfer.SetupReceive(&callback, false, UNASSIGNED_SYSTEM_ADDRESS);
+	const unsigned int numChunks=1000;
+	unsigned int chunkLengths[numChunks];
+	for (unsigned int i=0; i < numChunks; i++)
+		chunkLengths[i]=1;
+	FeedManifest(fileListTransfer, setID, "a.bin", 100, numChunks, chunkLengths, 0);
+
+	char data[1]={0};
+	FeedChunk(fileListTransfer, setID, 0, data, 1);
+	PROTOCOL_CHECK(callback.progressCalls==0);
+	PROTOCOL_CHECK(callback.filesReceived==0);
+}
+
+// Chunk lengths that add up to more than the file length, so the second chunk would be written past the end of the file
+static void TestManifestPastEndOfFile(void)
+{
+	FileListTransfer fileListTransfer;
+	ChunkedReceiveCallback callback;
+	unsigned short setID = fileListTransfer.SetupReceive(&callback, false, UNASSIGNED_SYSTEM_ADDRESS);
+	const unsigned int chunkLengths[2]={ContentDefinedChunker::MAX_CHUNK_SIZE, ContentDefinedChunker::MAX_CHUNK_SIZE};
+	FeedManifest(fileListTransfer, setID, "a.bin", ContentDefinedChunker::MAX_CHUNK_SIZE+100, 2, chunkLengths, 0);
+
+	char *data = (char*) rakMalloc_Ex(ContentDefinedChunker::MAX_CHUNK_SIZE, _FILE_AND_LINE_);
+	memset(data, 0, ContentDefinedChunker::MAX_CHUNK_SIZE);
+	FeedChunk(fileListTransfer, setID, 1, data, ContentDefinedChunker::MAX_CHUNK_SIZE);
+	rakFree_Ex(data, _FILE_AND_LINE_);
+	PROTOCOL_CHECK(callback.progressCalls==0);
+	PROTOCOL_CHECK(callback.filesReceived==0);
+}
+
+// Chunks whose length does not match the manifest are dropped, the matching one completes the file
+static void TestChunkLengthMustMatch(void)
+{
+	FileListTransfer fileListTransfer;
+	ChunkedReceiveCallback callback;
+	unsigned short setID = fileListTransfer.SetupReceive(&callback, false, UNASSIGNED_SYSTEM_ADDRESS);
+	char data[1000];
+	for (int i=0; i < 1000; i++)
+		data[i]=(char) i;
+	unsigned char hash[1][20];
+	ContentDefinedChunker::HashChunk(data, 1000, hash[0]);
+	const unsigned int chunkLength=1000;
+	FeedManifest(fileListTransfer, setID, "a.bin", 1000, 1, &chunkLength, hash);
+
+	FeedChunk(fileListTransfer, setID, 0, data, 999);
+	PROTOCOL_CHECK(callback.filesReceived==0);
+	FeedChunk(fileListTransfer, setID, 0, data, 1000);
+	PROTOCOL_CHECK(callback.filesReceived==1);
+	PROTOCOL_CHECK(callback.byteLengthOfLastFile==1000);
+	PROTOCOL_CHECK(callback.lastFileData!=0 && memcmp(callback.lastFileData, data, 1000)==0);
+}
+
+// A sender that keeps sending chunks that do not match their hash gets the set aborted
+static void TestRepeatedHashFailuresAbort(void)
+{
+	FileListTransfer fileListTransfer;
+	ChunkedReceiveCallback callback;
+	unsigned short setID = fileListTransfer.SetupReceive(&callback, false, UNASSIGNED_SYSTEM_ADDRESS);
+	unsigned char hash[1][20];
+	memset(hash, 1, sizeof(hash));
+	const unsigned int chunkLength=1000;
+	FeedManifest(fileListTransfer, setID, "a.bin", 1000, 1, &chunkLength, hash);
+
+	char data[1000]={0};
+	for (int i=0; i < 20 && fileListTransfer.IsHandlerActive(setID); i++)
+		FeedChunk(fileListTransfer, setID, 0, data, 1000);
+	PROTOCOL_CHECK(callback.dereferenceCalls==1);
+	PROTOCOL_CHECK(callback.filesReceived==0);
+	PROTOCOL_CHECK(fileListTransfer.IsHandlerActive(setID)==false);
+}
+
+// Writes always fail, as with a full disk
+class FailingWriteInterface : public IncrementalWriteInterface
+{
+public:
+	void* OpenFile(const char *filename, unsigned int byteLengthOfFile, FileListNodeContext context) {(void) filename; (void) byteLengthOfFile; (void) context; return this;}
+	bool WriteFilePart(void *fileHandle, unsigned int startWriteBytes, const char *source, unsigned int numBytesToWrite) {(void) fileHandle; (void) startWriteBytes; (void) source; (void) numBytesToWrite; return false;}
+	unsigned int ReadFilePart(void *fileHandle, unsigned int startReadBytes, unsigned int numBytesToRead, char *preallocatedDestination) {(void) fileHandle; (void) startReadBytes; (void) numBytesToRead; (void) preallocatedDestination; return 0;}
+	unsigned int ReadExistingFilePart(const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, char *preallocatedDestination, FileListNodeContext context) {(void) filename; (void) startReadBytes; (void) numBytesToRead; (void) preallocatedDestination; (void) context; return 0;}
+	bool CloseFile(void *fileHandle, bool completed) {(void) fileHandle; (void) completed; return true;}
+};
+
+// A verified chunk that cannot be written aborts the set at once instead of being requested again
+static void TestWriteFailureAborts(void)
+{
+	FailingWriteInterface incrementalWriteInterface;
+	FileListTransfer fileListTransfer;
+	ChunkedReceiveCallback callback;
+	unsigned short setID = fileListTransfer.SetupReceive(&callback, false, UNASSIGNED_SYSTEM_ADDRESS, &incrementalWriteInterface);
+	char data[1000];
+	for (int i=0; i < 1000; i++)
+		data[i]=(char) i;
+	unsigned char hash[1][20];
+	ContentDefinedChunker::HashChunk(data, 1000, hash[0]);
+	const unsigned int chunkLength=1000;
+	FeedManifest(fileListTransfer, setID, "a.bin", 1000, 1, &chunkLength, hash);
+	// Chunks are only accepted once the scan for existing data is done
+	for (int updates=0; updates < 100; updates++)
+		fileListTransfer.Update();
+
+	FeedChunk(fileListTransfer, setID, 0, data, 1000);
+	PROTOCOL_CHECK(callback.dereferenceCalls==1);
+	PROTOCOL_CHECK(callback.filesReceived==0);
+	PROTOCOL_CHECK(fileListTransfer.IsHandlerActive(setID)==false);
+}
+
+// An identical file already on disk is found a little at a time in Update(), without any chunk being sent
+static void TestOldFileIsScannedInUpdate(void)
+{
+	const unsigned int fileLength=3000000;
+	char *data = (char*) rakMalloc_Ex(fileLength, _FILE_AND_LINE_);
+	seedMT(1);
+	for (unsigned int i=0; i < fileLength; i++)
+		data[i]=(char) randomMT();
+	FILE *fp;
+	if (fopen_s(&fp, SCAN_TEST_FILENAME, "wb")!=0)
+	{
+		printf("Unable to write %s\n", SCAN_TEST_FILENAME);
+		protocolTestFailures++;
+		rakFree_Ex(data, _FILE_AND_LINE_);
+		return;
+	}
+	fwrite(data, 1, fileLength, fp);
+	fclose(fp);
+
+	ContentDefinedChunker chunker;
+	DataStructures::List<ChunkSignature> chunkSignatures;
+	chunker.Update(data, fileLength, chunkSignatures);
+	chunker.Final(chunkSignatures);
+	rakFree_Ex(data, _FILE_AND_LINE_);
+	unsigned int *chunkLengths = SLNet::OP_NEW_ARRAY<unsigned int>(chunkSignatures.Size(), _FILE_AND_LINE_);
+	unsigned char (*hashes)[20] = (unsigned char (*)[20]) rakMalloc_Ex(chunkSignatures.Size()*20, _FILE_AND_LINE_);
+	for (unsigned int i=0; i < chunkSignatures.Size(); i++)
+	{
+		chunkLengths[i]=chunkSignatures[i].length;
+		memcpy(hashes[i], chunkSignatures[i].hash, 20);
+	}
+
+	{
+		IncrementalWriteInterface incrementalWriteInterface;
+		FileListTransfer fileListTransfer;
+		ChunkedReceiveCallback callback;
+		unsigned short setID = fileListTransfer.SetupReceive(&callback, false, UNASSIGNED_SYSTEM_ADDRESS, &incrementalWriteInterface);
+		FeedManifest(fileListTransfer, setID, SCAN_TEST_FILENAME, fileLength, chunkSignatures.Size(), chunkLengths, hashes);
+		// Reading the old file is left to Update()
+		PROTOCOL_CHECK(callback.filesReceived==0);
+		int updates;
+		for (updates=0; updates < 1000 && callback.filesReceived==0; updates++)
+			fileListTransfer.Update();
+		PROTOCOL_CHECK(updates > 1);
+		PROTOCOL_CHECK(callback.filesReceived==1);
+		PROTOCOL_CHECK(callback.byteLengthOfLastFile==fileLength);
+	}
+
+	SLNet::OP_DELETE_ARRAY(chunkLengths, _FILE_AND_LINE_);
+	rakFree_Ex(hashes, _FILE_AND_LINE_);
+	remove(SCAN_TEST_FILENAME);
+}
+
+static void TestIncrementalWriteCloseFile(void)
+{
+	IncrementalWriteInterface incrementalWriteInterface;
+	// Without an application directory, absolute paths would be written as is
+	PROTOCOL_CHECK(incrementalWriteInterface.OpenFile("../ProtocolTests.bin", 1, FileListNodeContext())==0);
+	PROTOCOL_CHECK(incrementalWriteInterface.OpenFile("/ProtocolTests.bin", 1, FileListNodeContext())==0);
+	PROTOCOL_CHECK(incrementalWriteInterface.OpenFile("\\ProtocolTests.bin", 1, FileListNodeContext())==0);
+	PROTOCOL_CHECK(incrementalWriteInterface.OpenFile("C:ProtocolTests.bin", 1, FileListNodeContext())==0);
+
+	char partialPath[256];
+	strcpy_s(partialPath, RENAME_TEST_FILENAME);
+	strcat_s(partialPath, ".partial");
+
+	void *handle = incrementalWriteInterface.OpenFile(RENAME_TEST_FILENAME, 4, FileListNodeContext());
+	PROTOCOL_CHECK(handle!=0);
+	if (handle==0)
+		return;
+	PROTOCOL_CHECK(incrementalWriteInterface.WriteFilePart(handle, 0, "abcd", 4));
+	PROTOCOL_CHECK(incrementalWriteInterface.CloseFile(handle, true));
+	FILE *fp;
+	PROTOCOL_CHECK(fopen_s(&fp, RENAME_TEST_FILENAME, "rb")==0);
+	if (fp)
+		fclose(fp);
+	remove(RENAME_TEST_FILENAME);
+
+	// A directory in the way makes the rename fail, which must be reported
+#ifdef _WIN32
+	_mkdir(RENAME_TEST_FILENAME);
+#else
+	mkdir(RENAME_TEST_FILENAME, 0744);
+#endif
+	handle = incrementalWriteInterface.OpenFile(RENAME_TEST_FILENAME, 4, FileListNodeContext());
+	PROTOCOL_CHECK(handle!=0);
+	if (handle)
+		PROTOCOL_CHECK(incrementalWriteInterface.CloseFile(handle, true)==false);
+#ifdef _WIN32
+	_rmdir(RENAME_TEST_FILENAME);
+#else
+	rmdir(RENAME_TEST_FILENAME);
+#endif
+	remove(partialPath);
+}
+
+void RunFileListTransferTests()
+{
+	TestManifestWithTooManyChunks();
+	TestManifestPastEndOfFile();
+	TestChunkLengthMustMatch();
+	TestRepeatedHashFailuresAbort();
+	TestWriteFailureAborts();
+	TestOldFileIsScannedInUpdate();
+	TestIncrementalWriteCloseFile();
+}
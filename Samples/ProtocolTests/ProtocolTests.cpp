@@ -0,0 +1,31 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Checks how the plugins decode malformed or hostile input from a remote system.
+// Returns 0 if every check passed, so it can be run by ctest.
+
+#include "ProtocolTests.h"
+#include "slikenet/StringCompressor.h"
+
+int protocolTestFailures=0;
+
+int main(void)
+{
+	SLNet::StringCompressor::AddReference();
+
+	RunFileListTransferTests();
+	RunRPC4Tests();
+	RunTableSerializerTests();
+
+	SLNet::StringCompressor::RemoveReference();
+
+	if (protocolTestFailures==0)
+		printf("All protocol tests passed\n");
+	else
+		printf("%i protocol checks failed\n", protocolTestFailures);
+	return protocolTestFailures==0 ? 0 : 1;
+}
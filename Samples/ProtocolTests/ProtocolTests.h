@@ -0,0 +1,25 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#ifndef __PROTOCOL_TESTS_H
+#define __PROTOCOL_TESTS_H
+
+#include <stdio.h>
+
+extern int protocolTestFailures;
+
+// Reports a failed expectation and carries on, so that a single run lists every failure
+#define PROTOCOL_CHECK(expression) do { if (!(expression)) { printf("FAILED %s:%i: %s\n", __FILE__, __LINE__, #expression); protocolTestFailures++; } } while (0)
+
+// Feeds crafted chunked transfer messages straight to FileListTransfer::OnReceive()
+void RunFileListTransferTests();
+// Runs RPC4 between two systems on the loopback interface
+void RunRPC4Tests();
+// Reads truncated and corrupted columnar tables
+void RunTableSerializerTests();
+
+#endif
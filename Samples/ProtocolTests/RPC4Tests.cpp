@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "ProtocolTests.h"
+#include "slikenet/RPC4Plugin.h"
+#include "slikenet/PluginInterface2.h"
+#include "slikenet/peerinterface.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/sleep.h"
+#include <string.h>
+
+using namespace SLNet;
+
+static const unsigned short SERVER_PORT=61235;
+static const char *SLOT_NAME="ProtocolTests::Slot";
+
+// Sub-messages of ID_RPC_PLUGIN, see RPC4Identifiers in RPC4Plugin.cpp
+static const unsigned char RPC4_SIGNAL=2;
+static const unsigned char RPC4_SIGNAL_BY_ID=4;
+static const unsigned char RPC4_IDENTIFIER_ID=5;
+
+static int slotInvocations;
+
+static void OnSlot(SLNet::BitStream *bitStream, Packet *packet)
+{
+	(void) bitStream;
+	(void) packet;
+	slotInvocations++;
+}
+
+// Attached ahead of RPC4, to count what arrives on the wire before RPC4 handles it
+class RPC4MessageCounter : public PluginInterface2
+{
+public:
+	RPC4MessageCounter() {memset(counts, 0, sizeof(counts));}
+	virtual PluginReceiveResult OnReceive(Packet *packet)
+	{
+		if (packet->length >= 2 && packet->data[0]==ID_RPC_PLUGIN)
+			counts[packet->data[1]]++;
+		return RR_CONTINUE_PROCESSING;
+	}
+	int counts[256];
+};
+
+struct RPC4TestPeer
+{
+	RPC4TestPeer() {peer=RakPeerInterface::GetInstance(); peer->AttachPlugin(&counter); peer->AttachPlugin(&rpc);}
+	~RPC4TestPeer() {RakPeerInterface::DestroyInstance(peer);}
+	RakPeerInterface *peer;
+	RPC4MessageCounter counter;
+	RPC4 rpc;
+};
+
+static void ProcessPackets(RPC4TestPeer &client, RPC4TestPeer &server)
+{
+	Packet *packet;
+	for (packet=client.peer->Receive(); packet; client.peer->DeallocatePacket(packet), packet=client.peer->Receive())
+		;
+	for (packet=server.peer->Receive(); packet; server.peer->DeallocatePacket(packet), packet=server.peer->Receive())
+		;
+}
+
+// Runs both peers for a while, so that replies to what was sent have arrived too
+static void ProcessPacketsFor(RPC4TestPeer &client, RPC4TestPeer &server, SLNet::TimeMS duration)
+{
+	SLNet::TimeMS stopTime=SLNet::GetTimeMS()+duration;
+	while (SLNet::GetTimeMS() < stopTime)
+	{
+		ProcessPackets(client, server);
+		RakSleep(10);
+	}
+}
+
+static bool ConnectPeers(RPC4TestPeer &client, RPC4TestPeer &server)
+{
+	SocketDescriptor serverSocket(SERVER_PORT, 0), clientSocket;
+	server.peer->SetMaximumIncomingConnections(1);
+	if (server.peer->Startup(1, &serverSocket, 1)!=RAKNET_STARTED || client.peer->Startup(1, &clientSocket, 1)!=RAKNET_STARTED)
+		return false;
+	client.peer->Connect("127.0.0.1", SERVER_PORT, 0, 0);
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+5000;
+	while (client.peer->GetConnectionState(server.peer->GetMyGUID())!=IS_CONNECTED && SLNet::GetTimeMS() < timeout)
+	{
+		ProcessPackets(client, server);
+		RakSleep(10);
+	}
+	if (client.peer->GetConnectionState(server.peer->GetMyGUID())!=IS_CONNECTED)
+	{
+		printf("Unable to connect on port %i\n", SERVER_PORT);
+		protocolTestFailures++;
+		return false;
+	}
+	// Let the announcements of both systems arrive
+	ProcessPacketsFor(client, server, 200);
+	return true;
+}
+
+static void SignalServer(RPC4TestPeer &client, RPC4TestPeer &server)
+{
+	SLNet::BitStream bitStream;
+	client.rpc.Signal(SLOT_NAME, &bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, 0, server.peer->GetMyGUID(), false, false);
+	ProcessPacketsFor(client, server, 200);
+}
+
+static void SendIdentifierId(RPC4TestPeer &sender, RPC4TestPeer &recipient, const SLNet::RakString &name, unsigned int id)
+{
+	SLNet::BitStream bitStream;
+	bitStream.Write((MessageID) ID_RPC_PLUGIN);
+	bitStream.Write((MessageID) RPC4_IDENTIFIER_ID);
+	bitStream.WriteCompressed(name);
+	bitStream.WriteCompressed(id);
+	sender.peer->Send(&bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, 0, recipient.peer->GetMyGUID(), false);
+}
+
+// Two systems with ids enabled switch from the name to the id once the receiver replied with it
+static void TestIdsBetweenSystemsThatAnnounced(void)
+{
+	RPC4TestPeer client, server;
+	server.rpc.RegisterSlot(SLOT_NAME, OnSlot, 0);
+	if (ConnectPeers(client, server)==false)
+		return;
+
+	slotInvocations=0;
+	SignalServer(client, server);
+	SignalServer(client, server);
+	PROTOCOL_CHECK(slotInvocations==2);
+	PROTOCOL_CHECK(client.counter.counts[RPC4_IDENTIFIER_ID]==1);
+	PROTOCOL_CHECK(server.counter.counts[RPC4_SIGNAL_BY_ID]==1);
+}
+
+// A system that never announced, as earlier versions do, gets no ids and keeps sending names
+static void TestNoIdsForSystemsThatDidNotAnnounce(void)
+{
+	RPC4TestPeer client, server;
+	client.rpc.SetUseIdentifierIds(false);
+	server.rpc.RegisterSlot(SLOT_NAME, OnSlot, 0);
+	if (ConnectPeers(client, server)==false)
+		return;
+
+	slotInvocations=0;
+	SignalServer(client, server);
+	SignalServer(client, server);
+	PROTOCOL_CHECK(slotInvocations==2);
+	PROTOCOL_CHECK(client.counter.counts[RPC4_IDENTIFIER_ID]==0);
+	PROTOCOL_CHECK(server.counter.counts[RPC4_SIGNAL]==2);
+	PROTOCOL_CHECK(server.counter.counts[RPC4_SIGNAL_BY_ID]==0);
+}
+
+// Ids for names that were not sent to the remote system are ignored, so a remote system cannot redirect calls or grow the tables
+static void TestUnrequestedIdsAreIgnored(void)
+{
+	RPC4TestPeer client, server;
+	server.rpc.RegisterSlot(SLOT_NAME, OnSlot, 0);
+	if (ConnectPeers(client, server)==false)
+		return;
+
+	SendIdentifierId(server, client, SLNet::RakString(SLOT_NAME), 7);
+	for (unsigned int i=0; i < 100; i++)
+		SendIdentifierId(server, client, SLNet::RakString("ProtocolTests::Unknown%i", i), i);
+	ProcessPacketsFor(client, server, 200);
+
+	// The server already got the announcement of the client, which is a signal too
+	int signalsBefore=server.counter.counts[RPC4_SIGNAL];
+	slotInvocations=0;
+	SignalServer(client, server);
+	PROTOCOL_CHECK(slotInvocations==1);
+	PROTOCOL_CHECK(server.counter.counts[RPC4_SIGNAL]==signalsBefore+1);
+	PROTOCOL_CHECK(server.counter.counts[RPC4_SIGNAL_BY_ID]==0);
+}
+
+void RunRPC4Tests()
+{
+	TestIdsBetweenSystemsThatAnnounced();
+	TestNoIdsForSystemsThatDidNotAnnounce();
+	TestUnrequestedIdsAreIgnored();
+}
@@ -0,0 +1,165 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "ProtocolTests.h"
+#include "slikenet/TableSerializer.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/Rand.h"
+#include <string.h>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+using namespace SLNet;
+
+static const unsigned int TABLE_ROWS=700;
+static const int CORRUPTION_ROUNDS=5000;
+
+// Has empty cells in every column, and more than 256 distinct strings so dictionary indices take two bytes
+static void FillTable(DataStructures::Table &table)
+{
+	table.AddColumn("name", DataStructures::Table::STRING);
+	table.AddColumn("score", DataStructures::Table::NUMERIC);
+	table.AddColumn("blob", DataStructures::Table::BINARY);
+	table.AddColumn("pointer", DataStructures::Table::POINTER);
+	for (unsigned int i=0; i < TABLE_ROWS; i++)
+	{
+		DataStructures::Table::Row *row = table.AddRow(i*3);
+		char value[32];
+		sprintf_s(value, "value%u", i < TABLE_ROWS/2 ? i%3 : i);
+		if (i%7)
+			row->cells[0]->Set(value);
+		if (i%5)
+			row->cells[1]->Set((double) i*1.5);
+		if (i%3)
+			row->cells[2]->Set(value, (int) strlen(value));
+		row->cells[3]->SetPtr((void*) (size_t) (i+1));
+	}
+}
+
+static bool IsInside(const void *p, unsigned int length, const unsigned char *buffer, unsigned int bufferLength)
+{
+	const unsigned char *c = (const unsigned char*) p;
+	return c >= buffer && c <= buffer+bufferLength && length <= (unsigned int) (buffer+bufferLength-c);
+}
+
+// Reads every cell, and checks that nothing points outside of the serialized table
+static bool CellsAreInside(const ColumnarTableView &view, const unsigned char *buffer, unsigned int bufferLength)
+{
+	for (unsigned int columnIndex=0; columnIndex < view.GetColumnCount(); columnIndex++)
+	{
+		if (IsInside(view.GetColumnName(columnIndex), (unsigned int) strlen(view.GetColumnName(columnIndex))+1, buffer, bufferLength)==false)
+			return false;
+		for (unsigned int rowIndex=0; rowIndex < view.GetRowCount(); rowIndex++)
+		{
+			if (view.IsEmpty(rowIndex, columnIndex))
+				continue;
+			switch (view.GetColumnType(columnIndex))
+			{
+			case DataStructures::Table::STRING:
+				{
+					const char *s = view.GetString(rowIndex, columnIndex);
+					// Check the start first, strlen() must not run off the buffer
+					if (IsInside(s, 1, buffer, bufferLength)==false || memchr(s, 0, bufferLength-((const unsigned char*) s-buffer))==0)
+						return false;
+				}
+				break;
+			case DataStructures::Table::BINARY:
+				{
+					unsigned int length;
+					const char *binary = view.GetBinary(rowIndex, columnIndex, &length);
+					if (length > 0 && IsInside(binary, length, buffer, bufferLength)==false)
+						return false;
+				}
+				break;
+			case DataStructures::Table::NUMERIC:
+				view.GetNumeric(rowIndex, columnIndex);
+				break;
+			default:
+				view.GetPointer(rowIndex, columnIndex);
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+static void TestColumnarRoundTrip(const unsigned char *serialized, unsigned int serializedLength)
+{
+	ColumnarTableView view;
+	PROTOCOL_CHECK(view.Set(serialized, serializedLength));
+	PROTOCOL_CHECK(view.GetSerializedLength()==serializedLength);
+	PROTOCOL_CHECK(view.GetRowCount()==TABLE_ROWS);
+	PROTOCOL_CHECK(view.GetColumnCount()==4);
+	PROTOCOL_CHECK(view.GetRowKey(10)==30);
+	PROTOCOL_CHECK(view.IsEmpty(7, 0));
+	PROTOCOL_CHECK(strcmp(view.GetString(8, 0), "value2")==0);
+	PROTOCOL_CHECK(strcmp(view.GetString(TABLE_ROWS-1, 0), "value699")==0);
+	PROTOCOL_CHECK(view.GetStringIndex(1, 0)==view.GetStringIndex(4, 0));
+	PROTOCOL_CHECK(view.GetNumeric(4, 1)==6.0);
+	PROTOCOL_CHECK(view.IsEmpty(5, 1));
+	unsigned int length;
+	PROTOCOL_CHECK(view.GetBinary(3, 2, &length)==0 && length==0);
+	const char *binary = view.GetBinary(4, 2, &length);
+	PROTOCOL_CHECK(length==6 && memcmp(binary, "value1", 6)==0);
+	PROTOCOL_CHECK(view.GetPointer(9, 3)==(void*) 10);
+	PROTOCOL_CHECK(CellsAreInside(view, serialized, serializedLength));
+}
+
+// Every table cut short must be rejected, by the view and by DeserializeColumnarTable()
+static void TestTruncatedTablesAreRejected(const unsigned char *serialized, unsigned int serializedLength)
+{
+	ColumnarTableView view;
+	int accepted=0;
+	for (unsigned int length=0; length < serializedLength; length++)
+	{
+		unsigned char *copy = (unsigned char*) rakMalloc_Ex(length+1, _FILE_AND_LINE_);
+		memcpy(copy, serialized, length);
+		if (view.Set(copy, length))
+			accepted++;
+		DataStructures::Table table;
+		if (TableSerializer::DeserializeColumnarTable(copy, length, &table))
+			accepted++;
+		rakFree_Ex(copy, _FILE_AND_LINE_);
+	}
+	PROTOCOL_CHECK(accepted==0);
+}
+
+// Tables with a few random bytes changed may still be accepted, but cells must never point outside of the data
+static void TestCorruptedTablesStayInBounds(const unsigned char *serialized, unsigned int serializedLength)
+{
+	ColumnarTableView view;
+	unsigned char *copy = (unsigned char*) rakMalloc_Ex(serializedLength, _FILE_AND_LINE_);
+	seedMT(1);
+	int outOfBounds=0;
+	for (int round=0; round < CORRUPTION_ROUNDS; round++)
+	{
+		memcpy(copy, serialized, serializedLength);
+		unsigned int changes = 1+randomMT()%4;
+		for (unsigned int i=0; i < changes; i++)
+			copy[randomMT()%serializedLength]=(unsigned char) randomMT();
+		if (view.Set(copy, serializedLength) && CellsAreInside(view, copy, serializedLength)==false)
+			outOfBounds++;
+		DataStructures::Table table;
+		TableSerializer::DeserializeColumnarTable(copy, serializedLength, &table);
+	}
+	rakFree_Ex(copy, _FILE_AND_LINE_);
+	PROTOCOL_CHECK(outOfBounds==0);
+}
+
+void RunTableSerializerTests()
+{
+	DataStructures::Table table;
+	FillTable(table);
+	SLNet::BitStream bitStream;
+	TableSerializer::SerializeColumnarTable(&table, &bitStream);
+	const unsigned char *serialized = bitStream.GetData();
+	unsigned int serializedLength = bitStream.GetNumberOfBytesUsed();
+
+	TestColumnarRoundTrip(serialized, serializedLength);
+	TestTruncatedTablesAreRejected(serialized, serializedLength);
+	TestCorruptedTablesStayInBounds(serialized, serializedLength);
+}
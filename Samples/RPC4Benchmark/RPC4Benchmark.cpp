@@ -0,0 +1,184 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Measures RPC4 signals and calls per second between two peers on the loopback interface, with and without integer identifier ids.
+// Each message carries a small payload, as gameplay RPCs usually do, so the cost of sending the identifier dominates.
+// The sender pushes a batch, then both peers run Receive() until the batch arrived.
+
+#include "slikenet/RPC4Plugin.h"
+#include "slikenet/peerinterface.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/statistics.h"
+#include "slikenet/sleep.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+using namespace SLNet;
+
+static const unsigned short SERVER_PORT=61234;
+static const unsigned int BATCH_SIZE=500;
+
+static unsigned int messagesReceived;
+
+static void OnPlayerMoved(SLNet::BitStream *bitStream, Packet *packet)
+{
+	(void) packet;
+	float position[3];
+	bitStream->Read(position[0]);
+	bitStream->Read(position[1]);
+	bitStream->Read(position[2]);
+	messagesReceived++;
+}
+
+static void ApplyPlayerDamage(SLNet::BitStream *bitStream, Packet *packet)
+{
+	(void) packet;
+	unsigned short damage;
+	bitStream->Read(damage);
+	messagesReceived++;
+}
+
+static void ProcessPackets(RakPeerInterface *peer)
+{
+	for (Packet *packet=peer->Receive(); packet; peer->DeallocatePacket(packet), packet=peer->Receive())
+		;
+}
+
+static bool WaitForMessages(RakPeerInterface *sender, RakPeerInterface *receiver, unsigned int count)
+{
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+10000;
+	while (messagesReceived < count)
+	{
+		ProcessPackets(receiver);
+		ProcessPackets(sender);
+		if (SLNet::GetTimeMS() > timeout)
+			return false;
+		RakSleep(0);
+	}
+	return true;
+}
+
+static void RunBenchmark(bool useIdentifierIds, bool signal, unsigned int numMessages)
+{
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	RPC4 serverRpc, clientRpc;
+	server->AttachPlugin(&serverRpc);
+	client->AttachPlugin(&clientRpc);
+	serverRpc.SetUseIdentifierIds(useIdentifierIds);
+	clientRpc.SetUseIdentifierIds(useIdentifierIds);
+	serverRpc.RegisterSlot("Gameplay::OnPlayerMoved", OnPlayerMoved, 0);
+	serverRpc.RegisterFunction("Gameplay::ApplyPlayerDamage", ApplyPlayerDamage);
+
+	SocketDescriptor serverSocket(SERVER_PORT, 0), clientSocket;
+	server->SetMaximumIncomingConnections(1);
+	server->Startup(1, &serverSocket, 1);
+	client->Startup(1, &clientSocket, 1);
+	client->Connect("127.0.0.1", SERVER_PORT, 0, 0);
+
+	RakNetGUID serverGuid=server->GetMyGUID();
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+5000;
+	while (client->GetConnectionState(serverGuid)!=IS_CONNECTED && SLNet::GetTimeMS() < timeout)
+	{
+		ProcessPackets(server);
+		ProcessPackets(client);
+		RakSleep(10);
+	}
+	if (client->GetConnectionState(serverGuid)!=IS_CONNECTED)
+	{
+		printf("Failed to connect\n");
+		RakPeerInterface::DestroyInstance(client);
+		RakPeerInterface::DestroyInstance(server);
+		return;
+	}
+
+	SLNet::BitStream payload;
+	float position[3]={10.5f, 2.0f, -7.25f};
+	unsigned short damage=25;
+
+	// The first message sends the name, and lets the server reply with its id
+	messagesReceived=0;
+	payload.Reset();
+	if (signal)
+	{
+		payload.Write(position[0]); payload.Write(position[1]); payload.Write(position[2]);
+		clientRpc.Signal("Gameplay::OnPlayerMoved", &payload, HIGH_PRIORITY, RELIABLE_ORDERED, 0, serverGuid, false, false);
+	}
+	else
+	{
+		payload.Write(damage);
+		clientRpc.Call("Gameplay::ApplyPlayerDamage", &payload, HIGH_PRIORITY, RELIABLE_ORDERED, 0, serverGuid, false);
+	}
+	WaitForMessages(client, server, 1);
+	RakSleep(100);
+	ProcessPackets(client);
+
+	RakNetStatistics before, after;
+	client->GetStatistics(client->GetSystemAddressFromGuid(serverGuid), &before);
+
+	messagesReceived=0;
+	SLNet::TimeUS sendTime=0;
+	SLNet::TimeUS startTime=SLNet::GetTimeUS();
+	bool completed=true;
+	for (unsigned int sent=0; sent < numMessages && completed; )
+	{
+		SLNet::TimeUS batchStart=SLNet::GetTimeUS();
+		for (unsigned int i=0; i < BATCH_SIZE && sent < numMessages; i++, sent++)
+		{
+			payload.Reset();
+			if (signal)
+			{
+				payload.Write(position[0]); payload.Write(position[1]); payload.Write(position[2]);
+				clientRpc.Signal("Gameplay::OnPlayerMoved", &payload, HIGH_PRIORITY, RELIABLE_ORDERED, 0, serverGuid, false, false);
+			}
+			else
+			{
+				payload.Write(damage);
+				clientRpc.Call("Gameplay::ApplyPlayerDamage", &payload, HIGH_PRIORITY, RELIABLE_ORDERED, 0, serverGuid, false);
+			}
+		}
+		sendTime+=SLNet::GetTimeUS()-batchStart;
+		completed=WaitForMessages(client, server, sent);
+	}
+	SLNet::TimeUS elapsed=SLNet::GetTimeUS()-startTime;
+	client->GetStatistics(client->GetSystemAddressFromGuid(serverGuid), &after);
+
+	double bytesPerMessage=(double) (after.runningTotal[USER_MESSAGE_BYTES_PUSHED]-before.runningTotal[USER_MESSAGE_BYTES_PUSHED])/numMessages;
+	if (completed)
+		printf("%-8s %-4s %14.0f %16.0f %17.1f\n", signal ? "Signal" : "Call", useIdentifierIds ? "yes" : "no",
+			(double) numMessages*1000000.0/(double) elapsed, (double) numMessages*1000000.0/(double) sendTime, bytesPerMessage);
+	else
+		printf("%-8s %-4s   timed out after %u messages\n", signal ? "Signal" : "Call", useIdentifierIds ? "yes" : "no", messagesReceived);
+
+	client->Shutdown(100);
+	server->Shutdown(100);
+	RakPeerInterface::DestroyInstance(client);
+	RakPeerInterface::DestroyInstance(server);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int numMessages=200000;
+	if (argc>=2)
+		numMessages=atoi(argv[1]);
+
+	printf("RPC4 benchmark\n");
+	printf("Usage: RPC4Benchmark [numMessages]\n\n");
+	printf("%u messages per run, sent in batches of %u\n\n", numMessages, BATCH_SIZE);
+
+	printf("type     ids  messages/s  sends/s (sender)  bytes per message\n");
+	RunBenchmark(false, true, numMessages);
+	RunBenchmark(true, true, numMessages);
+	RunBenchmark(false, false, numMessages);
+	RunBenchmark(true, false, numMessages);
+
+	return 0;
+}
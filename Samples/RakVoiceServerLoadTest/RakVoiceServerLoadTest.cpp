@@ -0,0 +1,324 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Connects many simulated speakers over loopback to a RakVoiceServer, in channels of a fixed size.
+// Each speaker uploads one frame every 20 milliseconds, the way RakVoice does with a forwarding server, without running speex:
+// the payload is random, and the speakers alternate between talking and silence with a random audio level.
+// Measures the frames the server forwards compared to a full mesh, where every speaker sends to every other member of
+// its channel, the time the server spends per received frame, and how many speakers each listener receives at the same time.
+
+#include "slikenet/peerinterface.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/sleep.h"
+#include "RakVoiceServer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+using namespace SLNet;
+
+static const unsigned short SERVER_PORT=61300;
+static const int32_t SAMPLE_RATE=16000;
+// Speex wideband produces 20 milliseconds frames
+static const SLNet::TimeMS FRAME_INTERVAL_MS=20;
+// Roughly the size of a speex wideband frame at quality 8
+static const unsigned int ENCODED_FRAME_BYTES=42;
+static const SLNet::TimeMS CONNECT_TIMEOUT_MS=120000;
+static const unsigned int CONNECT_BATCH_SIZE=50;
+
+struct Speaker
+{
+	RakPeerInterface *peer;
+	RakNetGUID serverGuid;
+	bool channelOpen;
+	bool isTalking;
+	// -dBov while talking
+	unsigned char level;
+	unsigned short messageNumber;
+	// Frames to send until isTalking changes
+	unsigned int framesUntilChange;
+	// Forwarded frames received during the measurement
+	unsigned int framesReceived;
+};
+
+static void SendChannelRequest(Speaker &speaker, RakVoiceForwardingMessage request, unsigned int channel)
+{
+	SLNet::BitStream out;
+	out.Write((unsigned char)ID_RAKVOICE_FORWARDING);
+	out.Write((unsigned char)request);
+	out.Write(channel);
+	speaker.peer->Send(&out, HIGH_PRIORITY, RELIABLE_ORDERED, 0, speaker.serverGuid, false);
+}
+
+static void SendFrame(Speaker &speaker)
+{
+	// Talk spurts and pauses of 0.2 to 3 seconds
+	if (speaker.framesUntilChange==0)
+	{
+		speaker.isTalking=!speaker.isTalking;
+		speaker.level=(unsigned char) (10+rand()%40);
+		speaker.framesUntilChange=10+rand()%140;
+	}
+	speaker.framesUntilChange--;
+
+	unsigned char frame[3+sizeof(unsigned short)+ENCODED_FRAME_BYTES];
+	frame[0]=ID_RAKVOICE_FORWARDING;
+	frame[1]=RVF_UPLOAD;
+	if (speaker.isTalking)
+		frame[2]=(unsigned char) (speaker.level+rand()%6) | RAKVOICE_AUDIO_LEVEL_VOICE_ACTIVITY;
+	else
+		frame[2]=(unsigned char) (70+rand()%20);
+	memcpy(frame+3, &speaker.messageNumber, sizeof(unsigned short));
+	speaker.messageNumber++;
+	for (unsigned int i=3+sizeof(unsigned short); i < sizeof(frame); i++)
+		frame[i]=(unsigned char) rand();
+	speaker.peer->Send((const char*) frame, sizeof(frame), HIGH_PRIORITY, UNRELIABLE, 0, speaker.serverGuid, false);
+}
+
+static void ReceiveOnSpeaker(Speaker &speaker)
+{
+	Packet *packet;
+	for (packet=speaker.peer->Receive(); packet; speaker.peer->DeallocatePacket(packet), packet=speaker.peer->Receive())
+	{
+		switch (packet->data[0])
+		{
+		case ID_CONNECTION_REQUEST_ACCEPTED:
+			{
+				speaker.serverGuid=packet->guid;
+				SLNet::BitStream out;
+				out.Write((unsigned char)ID_RAKVOICE_OPEN_CHANNEL_REQUEST);
+				out.Write(SAMPLE_RATE);
+				speaker.peer->Send(&out, HIGH_PRIORITY, RELIABLE_ORDERED, 0, speaker.serverGuid, false);
+			}
+			break;
+		case ID_RAKVOICE_OPEN_CHANNEL_REPLY:
+			speaker.channelOpen=true;
+			break;
+		case ID_RAKVOICE_FORWARDING:
+			if (packet->length > 1 && packet->data[1]==RVF_FORWARD)
+				speaker.framesReceived++;
+			break;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int numSpeakers=1000;
+	unsigned int channelSize=32;
+	unsigned int maxForwardedSpeakers=4;
+	unsigned int seconds=10;
+	if (argc>=2)
+		numSpeakers=atoi(argv[1]);
+	if (argc>=3)
+		channelSize=atoi(argv[2]);
+	if (argc>=4)
+		maxForwardedSpeakers=atoi(argv[3]);
+	if (argc>=5)
+		seconds=atoi(argv[4]);
+	if (numSpeakers==0 || channelSize==0 || maxForwardedSpeakers==0 || seconds==0)
+	{
+		printf("All parameters must be at least 1\n");
+		return 1;
+	}
+
+	printf("Loopback load test of RakVoiceServer with simulated speakers\n");
+	printf("Usage: RakVoiceServerLoadTest [numSpeakers] [channelSize] [maxForwardedSpeakers] [seconds]\n\n");
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	RakVoiceServer voiceServer;
+	voiceServer.SetMaxForwardedSpeakers(maxForwardedSpeakers);
+	// The speakers pick their channels themselves
+	voiceServer.SetAllowClientChannelRequests(true);
+	server->AttachPlugin(&voiceServer);
+	SocketDescriptor socketDescriptor(SERVER_PORT, 0);
+	if (server->Startup(numSpeakers, &socketDescriptor, 1)!=RAKNET_STARTED)
+	{
+		printf("Unable to start the server on port %i\n", SERVER_PORT);
+		RakPeerInterface::DestroyInstance(server);
+		return 1;
+	}
+	server->SetMaximumIncomingConnections((unsigned short) numSpeakers);
+
+	std::vector<Speaker> speakers(numSpeakers);
+	socketDescriptor.port=0;
+	for (unsigned int i=0; i < numSpeakers; i++)
+	{
+		Speaker &speaker=speakers[i];
+		speaker.peer=RakPeerInterface::GetInstance();
+		speaker.serverGuid=UNASSIGNED_RAKNET_GUID;
+		speaker.channelOpen=false;
+		speaker.isTalking=false;
+		speaker.level=0;
+		speaker.messageNumber=0;
+		speaker.framesUntilChange=(unsigned int) (rand()%150);
+		speaker.framesReceived=0;
+		speaker.peer->Startup(1, &socketDescriptor, 1);
+	}
+
+	// Connect a few speakers at a time, so the connection attempts do not time out on slow machines
+	printf("Connecting %u speakers\n", numSpeakers);
+	unsigned int numOpen=0, numConnecting=0;
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+CONNECT_TIMEOUT_MS;
+	while (numOpen < numSpeakers && SLNet::GetTimeMS() < timeout)
+	{
+		while (numConnecting < numSpeakers && numConnecting < numOpen+CONNECT_BATCH_SIZE)
+			speakers[numConnecting++].peer->Connect("127.0.0.1", SERVER_PORT, 0, 0);
+
+		Packet *packet;
+		for (packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+			;
+		numOpen=0;
+		for (unsigned int i=0; i < numConnecting; i++)
+		{
+			ReceiveOnSpeaker(speakers[i]);
+			if (speakers[i].channelOpen)
+				numOpen++;
+		}
+		RakSleep(1);
+	}
+	if (numOpen < numSpeakers)
+	{
+		printf("Only %u of %u speakers opened a voice channel\n", numOpen, numSpeakers);
+		numSpeakers=numOpen;
+	}
+
+	// Everyone starts in channel 0, move each speaker to its own channel
+	unsigned int numSpeakersInChannels=0;
+	for (unsigned int i=0; i < speakers.size(); i++)
+	{
+		if (speakers[i].channelOpen==false)
+			continue;
+		unsigned int channel=1+numSpeakersInChannels/channelSize;
+		SendChannelRequest(speakers[i], RVF_TALK, channel);
+		SendChannelRequest(speakers[i], RVF_LISTEN, channel);
+		SendChannelRequest(speakers[i], RVF_STOP_LISTENING, 0);
+		numSpeakersInChannels++;
+	}
+	timeout=SLNet::GetTimeMS()+1000;
+	while (SLNet::GetTimeMS() < timeout)
+	{
+		Packet *packet;
+		for (packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+			;
+		for (unsigned int i=0; i < speakers.size(); i++)
+			ReceiveOnSpeaker(speakers[i]);
+		RakSleep(1);
+	}
+	for (unsigned int i=0; i < speakers.size(); i++)
+		speakers[i].framesReceived=0;
+
+	printf("Sending for %u seconds, %u speakers per channel, at most %u forwarded speakers per channel\n", seconds, channelSize, maxForwardedSpeakers);
+	RakVoiceServer::Statistics startStatistics=voiceServer.GetStatistics();
+	SLNet::TimeUS serverTimeUS=0;
+	unsigned int framesSent=0, framesSkipped=0;
+	SLNet::TimeMS startTime=SLNet::GetTimeMS();
+	SLNet::TimeMS nextFrameTime=startTime;
+	SLNet::TimeMS endTime=startTime+seconds*1000;
+	while (SLNet::GetTimeMS() < endTime)
+	{
+		// Like a sound card, skip frames instead of sending them in a burst if the machine cannot keep up
+		SLNet::TimeMS currentTime=SLNet::GetTimeMS();
+		if (currentTime >= nextFrameTime)
+		{
+			for (unsigned int i=0; i < speakers.size(); i++)
+			{
+				if (speakers[i].channelOpen)
+				{
+					SendFrame(speakers[i]);
+					framesSent++;
+				}
+			}
+			nextFrameTime+=FRAME_INTERVAL_MS;
+			if (currentTime >= nextFrameTime)
+			{
+				framesSkipped+=(currentTime-nextFrameTime)/FRAME_INTERVAL_MS+1;
+				nextFrameTime=currentTime+FRAME_INTERVAL_MS;
+			}
+		}
+
+		// RakVoiceServer forwards from within Receive()
+		SLNet::TimeUS time=SLNet::GetTimeUS();
+		Packet *packet;
+		for (packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+			;
+		serverTimeUS+=SLNet::GetTimeUS()-time;
+
+		for (unsigned int i=0; i < speakers.size(); i++)
+			ReceiveOnSpeaker(speakers[i]);
+		RakSleep(1);
+	}
+	// Receive what is still underway
+	timeout=SLNet::GetTimeMS()+500;
+	while (SLNet::GetTimeMS() < timeout)
+	{
+		SLNet::TimeUS time=SLNet::GetTimeUS();
+		Packet *packet;
+		for (packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+			;
+		serverTimeUS+=SLNet::GetTimeUS()-time;
+		for (unsigned int i=0; i < speakers.size(); i++)
+			ReceiveOnSpeaker(speakers[i]);
+		RakSleep(1);
+	}
+
+	const RakVoiceServer::Statistics &statistics=voiceServer.GetStatistics();
+	uint64_t framesReceived=statistics.framesReceived-startStatistics.framesReceived;
+	uint64_t framesNotSelected=statistics.framesNotSelected-startStatistics.framesNotSelected;
+	uint64_t messagesForwarded=statistics.messagesForwarded-startStatistics.messagesForwarded;
+	uint64_t bytesForwarded=statistics.bytesForwarded-startStatistics.bytesForwarded;
+
+	// In a full mesh, each frame goes to every other member of the channel
+	uint64_t fullMeshMessages=0;
+	for (unsigned int i=0; i < numSpeakersInChannels; i+=channelSize)
+	{
+		uint64_t members=numSpeakersInChannels-i < channelSize ? numSpeakersInChannels-i : channelSize;
+		fullMeshMessages+=members*(members-1);
+	}
+	fullMeshMessages=fullMeshMessages*framesReceived/(numSpeakersInChannels ? numSpeakersInChannels : 1);
+
+	// A listener receiving every frame of one speaker gets one frame per interval
+	double framesPerStream=(double) seconds*1000.0/FRAME_INTERVAL_MS;
+	double streamsSum=0.0, streamsMax=0.0;
+	unsigned int numListeners=0;
+	for (unsigned int i=0; i < speakers.size(); i++)
+	{
+		if (speakers[i].channelOpen==false)
+			continue;
+		double streams=speakers[i].framesReceived/framesPerStream;
+		streamsSum+=streams;
+		if (streams > streamsMax)
+			streamsMax=streams;
+		numListeners++;
+	}
+	uint64_t framesDelivered=0;
+	for (unsigned int i=0; i < speakers.size(); i++)
+		framesDelivered+=speakers[i].framesReceived;
+
+	printf("\n");
+	printf("frames sent by speakers        %u, %u intervals skipped because the machine was too slow\n", framesSent, framesSkipped);
+	printf("frames received by the server  %llu (%.1f%%)\n", (unsigned long long) framesReceived, framesSent ? 100.0*framesReceived/framesSent : 0.0);
+	printf("frames not forwarded           %llu (%.1f%%)\n", (unsigned long long) framesNotSelected, framesReceived ? 100.0*framesNotSelected/framesReceived : 0.0);
+	printf("messages forwarded             %llu, %.1f KB/s\n", (unsigned long long) messagesForwarded, bytesForwarded/1024.0/seconds);
+	printf("messages of a full mesh        %llu (%.1fx the forwarded messages)\n", (unsigned long long) fullMeshMessages, messagesForwarded ? (double) fullMeshMessages/messagesForwarded : 0.0);
+	printf("messages received by listeners %llu (%.1f%%)\n", (unsigned long long) framesDelivered, messagesForwarded ? 100.0*framesDelivered/messagesForwarded : 0.0);
+	printf("server time per received frame %.2f us (%.1f%% of the run)\n", framesReceived ? (double) serverTimeUS/framesReceived : 0.0, serverTimeUS/10.0/seconds/1000.0);
+	printf("speakers received per listener %.2f average, %.2f maximum, limit %u\n", numListeners ? streamsSum/numListeners : 0.0, streamsMax, maxForwardedSpeakers);
+	if (framesSkipped)
+		printf("\nThe simulated speakers need more CPU than available, so the results are not representative. Try fewer speakers.\n");
+
+	for (unsigned int i=0; i < speakers.size(); i++)
+		RakPeerInterface::DestroyInstance(speakers[i].peer);
+	server->DetachPlugin(&voiceServer);
+	RakPeerInterface::DestroyInstance(server);
+	return 0;
+}
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Measures quick join matchmaking of the Rooms plugin with many queued users and rooms.
+// Rooms have a map, a game mode and a skill level. Users ask for a map and mode, and a skill range around their own.
+// Between passes some members leave their rooms and queue again, so rooms keep changing.
+
+#include "RoomsContainer.h"
+#include "RoomTypes.h"
+#include "slikenet/GetTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+using namespace SLNet;
+
+static const int NUM_MAPS=10;
+static const int NUM_MODES=4;
+static const int NUM_SKILL_RANGES=10;
+static const int NUM_PASSES=10;
+static const int MEMBERS_LEAVING_PER_PASS=500;
+static const SLNet::TimeMS PASS_INTERVAL_MS=1000;
+
+static const char *GAME_NAME="Benchmark";
+
+// Users with the same map, mode and skill range share a query
+struct QuerySet
+{
+	DataStructures::Table::FilterQuery queries[4];
+	DataStructures::Table::Cell cells[4];
+};
+
+static void SetQuery(DataStructures::Table::FilterQuery *query, DataStructures::Table::Cell *cell, const char *columnName, DataStructures::Table::FilterQueryType op)
+{
+	strcpy_s(query->columnName, columnName);
+	query->operation=op;
+	query->cellValue=cell;
+}
+
+static QuerySet* CreateQuerySets(void)
+{
+	char mapName[32];
+	QuerySet *querySets = new QuerySet[NUM_MAPS*NUM_MODES*NUM_SKILL_RANGES];
+	for (int map=0; map < NUM_MAPS; map++)
+	{
+		for (int mode=0; mode < NUM_MODES; mode++)
+		{
+			for (int skillRange=0; skillRange < NUM_SKILL_RANGES; skillRange++)
+			{
+				QuerySet *querySet = &querySets[(map*NUM_MODES+mode)*NUM_SKILL_RANGES+skillRange];
+				sprintf_s(mapName, "Map%i", map);
+				SetQuery(&querySet->queries[0], &querySet->cells[0], "map", DataStructures::Table::QF_EQUAL);
+				querySet->cells[0].Set(mapName);
+				SetQuery(&querySet->queries[1], &querySet->cells[1], "mode", DataStructures::Table::QF_EQUAL);
+				querySet->cells[1].Set(mode);
+				SetQuery(&querySet->queries[2], &querySet->cells[2], "skill", DataStructures::Table::QF_GREATER_THAN_EQ);
+				querySet->cells[2].Set(skillRange*10);
+				SetQuery(&querySet->queries[3], &querySet->cells[3], "skill", DataStructures::Table::QF_LESS_THAN_EQ);
+				querySet->cells[3].Set(skillRange*10+19);
+			}
+		}
+	}
+	return querySets;
+}
+
+// Returns the index of the query set used
+static int QueueUser(AllGamesRoomsContainer *agrc, RoomsParticipant *roomsParticipant, QuerySet *querySets)
+{
+	int querySetIndex=rand()%(NUM_MAPS*NUM_MODES*NUM_SKILL_RANGES);
+	QuickJoinUser *qju = new QuickJoinUser;
+	qju->roomsParticipant=roomsParticipant;
+	qju->networkedQuickJoinUser.minimumPlayers=2+rand()%3;
+	qju->networkedQuickJoinUser.timeout=60000;
+	qju->networkedQuickJoinUser.query.queries=querySets[querySetIndex].queries;
+	qju->networkedQuickJoinUser.query.numQueries=4;
+	if (agrc->AddUserToQuickJoin(GAME_NAME, qju)!=REC_SUCCESS)
+		delete qju;
+	return querySetIndex;
+}
+
+// Every member that joined an existing room must pass the query of that room, and nobody may join twice
+static unsigned int CountBadJoins(PerGameRoomsContainer *perGameRoomsContainer, DataStructures::List<JoinedRoomResult> &joinedRoomMembers, QuerySet *querySets, int numRooms, std::vector<int> &querySetOf)
+{
+	unsigned int badJoins=0;
+	DataStructures::Table resultTable;
+	unsigned columnIndices[1];
+	columnIndices[0]=DefaultRoomColumns::TC_LOBBY_ROOM_PTR;
+	std::vector<bool> joined(querySetOf.size(), false);
+	for (unsigned int i=0; i < joinedRoomMembers.Size(); i++)
+	{
+		// Users are named by their index
+		size_t participantIndex = (size_t) atoi(joinedRoomMembers[i].joiningMember->GetName().C_String()+4);
+		if (joined[participantIndex])
+			badJoins++;
+		joined[participantIndex]=true;
+
+		RoomID roomId = joinedRoomMembers[i].roomOutput->GetID();
+		if (roomId > (RoomID) numRooms)
+			continue;
+		unsigned rowIds[1];
+		rowIds[0]=roomId;
+		perGameRoomsContainer->roomsTable.QueryTable(columnIndices, 1, querySets[querySetOf[participantIndex]].queries, 4, rowIds, 1, &resultTable);
+		if (resultTable.GetRowCount()==0)
+			badJoins++;
+	}
+	return badJoins;
+}
+
+int main(int argc, char **argv)
+{
+	int numUsers=50000;
+	int numRooms=5000;
+	if (argc>=2)
+		numUsers=atoi(argv[1]);
+	if (argc>=3)
+		numRooms=atoi(argv[2]);
+
+	printf("Rooms quick join benchmark\n");
+	printf("%i queued users, %i rooms, %i distinct queries\n", numUsers, numRooms, NUM_MAPS*NUM_MODES*NUM_SKILL_RANGES);
+	printf("Usage: RoomsQuickJoinBenchmark [numUsers] [numRooms]\n\n");
+
+	srand(0);
+	AllGamesRoomsContainer agrc;
+	agrc.AddTitle(GAME_NAME);
+	PerGameRoomsContainer *perGameRoomsContainer = agrc.perGamesRoomsContainers.Get(GAME_NAME);
+
+	// Rooms, each with a moderator
+	std::vector<RoomsParticipant*> moderators;
+	char name[64];
+	SLNet::TimeUS startTime=SLNet::GetTimeUS();
+	for (int roomIndex=0; roomIndex < numRooms; roomIndex++)
+	{
+		RoomsParticipant *moderator = new RoomsParticipant;
+		sprintf_s(name, "Moderator%i", roomIndex);
+		moderator->SetName(name);
+		moderators.push_back(moderator);
+
+		RoomCreationParameters roomCreationParameters;
+		roomCreationParameters.firstUser=moderator;
+		roomCreationParameters.gameIdentifier=GAME_NAME;
+		roomCreationParameters.networkedRoomCreationParameters.slots.publicSlots=4+rand()%13;
+		roomCreationParameters.networkedRoomCreationParameters.roomName=name;
+		agrc.CreateRoom(&roomCreationParameters, 0);
+
+		DataStructures::Table properties;
+		properties.AddColumn("map", DataStructures::Table::STRING);
+		properties.AddColumn("mode", DataStructures::Table::NUMERIC);
+		properties.AddColumn("skill", DataStructures::Table::NUMERIC);
+		DataStructures::Table::Row *row = properties.AddRow(0);
+		sprintf_s(name, "Map%i", rand()%NUM_MAPS);
+		row->cells[0]->Set(name);
+		row->cells[1]->Set(rand()%NUM_MODES);
+		row->cells[2]->Set(rand()%(NUM_SKILL_RANGES*10+10));
+		agrc.SetCustomRoomProperties(moderator, &properties);
+	}
+	printf("Created rooms in %.1f ms\n", (double) (SLNet::GetTimeUS()-startTime) / 1000.0);
+
+	QuerySet *querySets = CreateQuerySets();
+	std::vector<RoomsParticipant*> users;
+	std::vector<int> querySetOf;
+	startTime=SLNet::GetTimeUS();
+	for (int userIndex=0; userIndex < numUsers; userIndex++)
+	{
+		RoomsParticipant *roomsParticipant = new RoomsParticipant;
+		sprintf_s(name, "User%i", userIndex);
+		roomsParticipant->SetName(name);
+		users.push_back(roomsParticipant);
+		querySetOf.push_back(QueueUser(&agrc, roomsParticipant, querySets));
+	}
+	printf("Queued users in %.1f ms\n\n", (double) (SLNet::GetTimeUS()-startTime) / 1000.0);
+
+	printf("pass   queued  pass (ms)   joined  rooms created  timed out  bad joins\n");
+	DataStructures::List<QuickJoinUser*> timeoutExpired;
+	DataStructures::List<JoinedRoomResult> joinedRoomMembers;
+	DataStructures::List<QuickJoinUser*> dereferencedPointers;
+	for (int pass=0; pass < NUM_PASSES; pass++)
+	{
+		unsigned int queued = perGameRoomsContainer->quickJoinList.Size();
+		unsigned int roomsBefore = perGameRoomsContainer->roomsTable.GetRowCount();
+		timeoutExpired.Clear(false, _FILE_AND_LINE_);
+		startTime=SLNet::GetTimeUS();
+		agrc.ProcessQuickJoins(timeoutExpired, joinedRoomMembers, dereferencedPointers, PASS_INTERVAL_MS);
+		SLNet::TimeUS elapsed=SLNet::GetTimeUS()-startTime;
+
+		unsigned int badJoins = CountBadJoins(perGameRoomsContainer, joinedRoomMembers, querySets, numRooms, querySetOf);
+		printf("%4i %8u %10.2f %8u %14u %10u %10u\n", pass, queued, (double) elapsed / 1000.0, joinedRoomMembers.Size(),
+			perGameRoomsContainer->roomsTable.GetRowCount()-roomsBefore, timeoutExpired.Size(), badJoins);
+
+		for (unsigned int i=0; i < dereferencedPointers.Size(); i++)
+			delete dereferencedPointers[i];
+
+		// Some members leave their rooms and queue again
+		for (int i=0; i < MEMBERS_LEAVING_PER_PASS; i++)
+		{
+			int userIndex=rand()%numUsers;
+			RoomsParticipant *roomsParticipant = users[userIndex];
+			Room *room = roomsParticipant->GetRoom();
+			if (room==0 || room->GetModerator()==roomsParticipant)
+				continue;
+			RemoveUserResult removeUserResult;
+			agrc.LeaveRoom(roomsParticipant, &removeUserResult);
+			agrc.DestroyRoomIfDead(removeUserResult.room);
+			querySetOf[userIndex]=QueueUser(&agrc, roomsParticipant, querySets);
+		}
+	}
+
+	delete [] querySets;
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Compares the row by row format of TableSerializer::SerializeTable() with the columnar format of TableSerializer::SerializeColumnarTable().
+// The table resembles a room list: names and map names repeat, numbers, an address as binary and a string column that is mostly empty.
+// Read in place: ColumnarTableView sums a numeric column and counts the rows with one map name, without deserializing the table.
+
+#include "slikenet/TableSerializer.h"
+#include "slikenet/BitStream.h"
+#include "slikenet/StringCompressor.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int NUM_ROUNDS=5;
+
+static void FillTable(DataStructures::Table *table, unsigned numRows)
+{
+	static const char *mapNames[] = {"Harbor", "Canyon", "Citadel", "Dunes", "Glacier", "Jungle", "Refinery", "Ruins"};
+	table->AddColumn("Name", DataStructures::Table::STRING);
+	table->AddColumn("Map", DataStructures::Table::STRING);
+	table->AddColumn("Players", DataStructures::Table::NUMERIC);
+	table->AddColumn("Score", DataStructures::Table::NUMERIC);
+	table->AddColumn("Address", DataStructures::Table::BINARY);
+	table->AddColumn("Password", DataStructures::Table::STRING);
+
+	srand(12345);
+	char name[64];
+	unsigned char address[6];
+	for (unsigned rowIndex=0; rowIndex < numRows; rowIndex++)
+	{
+		DataStructures::Table::Row *row=table->AddRow(rowIndex);
+		sprintf_s(name, "Room of player %i", rand()%5000);
+		row->cells[0]->Set(name);
+		row->cells[1]->Set(mapNames[rand()%(sizeof(mapNames)/sizeof(mapNames[0]))]);
+		row->cells[2]->Set(rand()%16);
+		row->cells[3]->Set((double) (rand()%100000)/10.0);
+		for (int i=0; i < 6; i++)
+			address[i]=(unsigned char) rand();
+		row->cells[4]->Set((const char*) address, 6);
+		if (rowIndex%10==0)
+			row->cells[5]->Set("secret");
+	}
+}
+
+// Both tables have the same keys in the same pages, as they were filled in the same order
+static bool TablesMatch(DataStructures::Table *a, DataStructures::Table *b)
+{
+	if (a->GetColumnCount()!=b->GetColumnCount() || a->GetRowCount()!=b->GetRowCount())
+		return false;
+	DataStructures::Page<unsigned, DataStructures::Table::Row*, _TABLE_BPLUS_TREE_ORDER> *pageA=a->GetRows().GetListHead();
+	DataStructures::Page<unsigned, DataStructures::Table::Row*, _TABLE_BPLUS_TREE_ORDER> *pageB=b->GetRows().GetListHead();
+	int pageIndexA=0, pageIndexB=0;
+	for (unsigned rowIndex=0; rowIndex < a->GetRowCount(); rowIndex++)
+	{
+		while (pageIndexA==pageA->size)
+		{
+			pageA=pageA->next;
+			pageIndexA=0;
+		}
+		while (pageIndexB==pageB->size)
+		{
+			pageB=pageB->next;
+			pageIndexB=0;
+		}
+		if (pageA->keys[pageIndexA]!=pageB->keys[pageIndexB])
+			return false;
+		DataStructures::Table::Row *rowA=pageA->data[pageIndexA++];
+		DataStructures::Table::Row *rowB=pageB->data[pageIndexB++];
+		for (unsigned columnIndex=0; columnIndex < a->GetColumnCount(); columnIndex++)
+		{
+			DataStructures::Table::Cell *cellA=rowA->cells[columnIndex];
+			DataStructures::Table::Cell *cellB=rowB->cells[columnIndex];
+			if (cellA->isEmpty!=cellB->isEmpty)
+				return false;
+			if (cellA->isEmpty)
+				continue;
+			if (cellA->i!=cellB->i)
+				return false;
+			if (a->GetColumnType(columnIndex)!=DataStructures::Table::NUMERIC && memcmp(cellA->c, cellB->c, (size_t) cellA->i)!=0)
+				return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned numRows=100000;
+	if (argc>=2)
+		numRows=(unsigned) atoi(argv[1]);
+
+	printf("TableSerializer row by row and columnar formats\n");
+	printf("Usage: TableSerializerBenchmark [numRows]\n");
+	printf("%u rows, best of %i rounds\n\n", numRows, NUM_ROUNDS);
+
+	SLNet::StringCompressor::AddReference();
+	DataStructures::Table table;
+	FillTable(&table, numRows);
+
+	double rowSerializeMS=0, rowDeserializeMS=0, columnarSerializeMS=0, columnarDeserializeMS=0, viewMS=0;
+	unsigned rowBytes=0, columnarBytes=0;
+	bool rowMatches=false, columnarMatches=false, viewMatches=false;
+	for (int round=0; round < NUM_ROUNDS; round++)
+	{
+		// Row by row
+		SLNet::BitStream rowStream;
+		SLNet::TimeUS startTime=SLNet::GetTimeUS();
+		SLNet::TableSerializer::SerializeTable(&table, &rowStream);
+		double serializeMS=(double) (SLNet::GetTimeUS()-startTime)/1000.0;
+		DataStructures::Table rowTable;
+		startTime=SLNet::GetTimeUS();
+		bool success=SLNet::TableSerializer::DeserializeTable(&rowStream, &rowTable);
+		double deserializeMS=(double) (SLNet::GetTimeUS()-startTime)/1000.0;
+		if (round==0)
+		{
+			rowBytes=rowStream.GetNumberOfBytesUsed();
+			rowMatches=success && TablesMatch(&table, &rowTable);
+			rowSerializeMS=serializeMS;
+			rowDeserializeMS=deserializeMS;
+		}
+		if (serializeMS < rowSerializeMS)
+			rowSerializeMS=serializeMS;
+		if (deserializeMS < rowDeserializeMS)
+			rowDeserializeMS=deserializeMS;
+
+		// Columnar
+		SLNet::BitStream columnarStream;
+		startTime=SLNet::GetTimeUS();
+		SLNet::TableSerializer::SerializeColumnarTable(&table, &columnarStream);
+		serializeMS=(double) (SLNet::GetTimeUS()-startTime)/1000.0;
+		DataStructures::Table columnarTable;
+		startTime=SLNet::GetTimeUS();
+		success=SLNet::TableSerializer::DeserializeColumnarTable(&columnarStream, &columnarTable);
+		deserializeMS=(double) (SLNet::GetTimeUS()-startTime)/1000.0;
+
+		// In place
+		startTime=SLNet::GetTimeUS();
+		SLNet::ColumnarTableView view;
+		bool viewSuccess=view.Set(columnarStream.GetData(), columnarStream.GetNumberOfBytesUsed());
+		double scoreSum=0;
+		unsigned harborRows=0;
+		if (viewSuccess)
+		{
+			unsigned scoreColumn=view.GetColumnIndex("Score");
+			unsigned mapColumn=view.GetColumnIndex("Map");
+			unsigned harborIndex=(unsigned) -1;
+			for (unsigned stringIndex=0; stringIndex < view.GetDictionarySize(mapColumn); stringIndex++)
+			{
+				if (strcmp(view.GetDictionaryString(mapColumn, stringIndex), "Harbor")==0)
+					harborIndex=stringIndex;
+			}
+			for (unsigned rowIndex=0; rowIndex < view.GetRowCount(); rowIndex++)
+			{
+				scoreSum+=view.GetNumeric(rowIndex, scoreColumn);
+				if (view.GetStringIndex(rowIndex, mapColumn)==harborIndex)
+					harborRows++;
+			}
+		}
+		double readMS=(double) (SLNet::GetTimeUS()-startTime)/1000.0;
+
+		if (round==0)
+		{
+			columnarBytes=columnarStream.GetNumberOfBytesUsed();
+			columnarMatches=success && TablesMatch(&table, &columnarTable);
+			double expectedScoreSum=0;
+			unsigned expectedHarborRows=0;
+			for (DataStructures::Page<unsigned, DataStructures::Table::Row*, _TABLE_BPLUS_TREE_ORDER> *page=table.GetRows().GetListHead(); page; page=page->next)
+			{
+				for (int pageIndex=0; pageIndex < page->size; pageIndex++)
+				{
+					DataStructures::Table::Row *row=page->data[pageIndex];
+					expectedScoreSum+=row->cells[3]->i;
+					if (strcmp(row->cells[1]->c, "Harbor")==0)
+						expectedHarborRows++;
+				}
+			}
+			viewMatches=viewSuccess && scoreSum==expectedScoreSum && harborRows==expectedHarborRows;
+			columnarSerializeMS=serializeMS;
+			columnarDeserializeMS=deserializeMS;
+			viewMS=readMS;
+		}
+		if (serializeMS < columnarSerializeMS)
+			columnarSerializeMS=serializeMS;
+		if (deserializeMS < columnarDeserializeMS)
+			columnarDeserializeMS=deserializeMS;
+		if (readMS < viewMS)
+			viewMS=readMS;
+	}
+
+	printf("format           bytes  serialize (ms)  deserialize (ms)  read in place (ms)  matches\n");
+	printf("row by row  %10u  %14.2f  %16.2f  %18s  %s\n", rowBytes, rowSerializeMS, rowDeserializeMS, "-", rowMatches ? "yes" : "NO");
+	printf("columnar    %10u  %14.2f  %16.2f  %18.2f  %s\n", columnarBytes, columnarSerializeMS, columnarDeserializeMS, viewMS, columnarMatches && viewMatches ? "yes" : "NO");
+
+	SLNet::StringCompressor::RemoveReference();
+	return rowMatches && columnarMatches && viewMatches ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+// Measures how fast ThreadPool hands input to its threads, with a shared queue and with work stealing, see ThreadPool::SetScheduling().
+// Latency: one input at a time, from AddInput() until the output is read from the output queue or from a ThreadPoolFuture.
+// Throughput: many tiny inputs, added one at a time with AddInput() and all at once with AddInputs().
+
+#include "slikenet/ThreadPool.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/sleep.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int LATENCY_ROUNDS=2000;
+
+static int Increment(int input, bool *returnOutput, void* perThreadData)
+{
+	(void) perThreadData;
+	*returnOutput=true;
+	return input+1;
+}
+
+// Output is not returned, so only the dispatch is measured
+static int Count(int input, bool *returnOutput, void* perThreadData)
+{
+	(void) input;
+	(void) perThreadData;
+	*returnOutput=false;
+	return 0;
+}
+
+static bool WaitUntilIdle(ThreadPool<int,int> &threadPool)
+{
+	SLNet::TimeMS timeout=SLNet::GetTimeMS()+60000;
+	while (threadPool.IsWorking())
+	{
+		if (SLNet::GetTimeMS() > timeout)
+			return false;
+		RakSleep(0);
+	}
+	return true;
+}
+
+static void RunBenchmark(ThreadPoolScheduling scheduling, int numThreads, unsigned numTasks, int firstProcessor)
+{
+	ThreadPool<int,int> threadPool;
+	threadPool.SetScheduling(scheduling);
+	threadPool.SetThreadAffinity(firstProcessor);
+	if (threadPool.StartThreads(numThreads, 0)==false)
+	{
+		printf("Unable to start %i threads\n", numThreads);
+		return;
+	}
+	const char *name = scheduling==TPS_WORK_STEALING ? "work stealing" : "shared queue";
+
+	// Round trip of a single input through the output queue
+	SLNet::TimeUS startTime=SLNet::GetTimeUS();
+	int i;
+	for (i=0; i < LATENCY_ROUNDS; i++)
+	{
+		threadPool.AddInput(Increment, i);
+		while (threadPool.HasOutput()==false)
+			RakSleep(0);
+		threadPool.GetOutput();
+	}
+	double outputQueueUS=(double) (SLNet::GetTimeUS()-startTime)/LATENCY_ROUNDS;
+
+	// Round trip of a single input through a future
+	ThreadPoolFuture<int> future;
+	startTime=SLNet::GetTimeUS();
+	for (i=0; i < LATENCY_ROUNDS; i++)
+	{
+		future.Reset();
+		threadPool.AddInput(Increment, i, &future);
+		future.Wait(10000);
+	}
+	double futureUS=(double) (SLNet::GetTimeUS()-startTime)/LATENCY_ROUNDS;
+
+	// Throughput of inputs added one at a time
+	startTime=SLNet::GetTimeUS();
+	unsigned u;
+	for (u=0; u < numTasks; u++)
+		threadPool.AddInput(Count, (int) u);
+	bool idle=WaitUntilIdle(threadPool);
+	double addInputSeconds=(double) (SLNet::GetTimeUS()-startTime)/1000000.0;
+
+	// Throughput of inputs added in one call
+	int *inputs = new int[numTasks];
+	for (u=0; u < numTasks; u++)
+		inputs[u]=(int) u;
+	startTime=SLNet::GetTimeUS();
+	threadPool.AddInputs(Count, inputs, numTasks);
+	idle=WaitUntilIdle(threadPool) && idle;
+	double addInputsSeconds=(double) (SLNet::GetTimeUS()-startTime)/1000000.0;
+	delete[] inputs;
+
+	threadPool.StopThreads();
+
+	if (idle==false)
+		printf("%-14s timed out waiting for the threads\n", name);
+	printf("%-14s %7i %15.2f %11.2f %16.0f %16.0f\n", name, numThreads, outputQueueUS, futureUS,
+		numTasks/addInputSeconds, numTasks/addInputsSeconds);
+}
+
+int main(int argc, char **argv)
+{
+	int numThreads=4;
+	unsigned numTasks=1000000;
+	int firstProcessor=-1;
+	if (argc>=2)
+		numThreads=atoi(argv[1]);
+	if (argc>=3)
+		numTasks=(unsigned) atoi(argv[2]);
+	if (argc>=4)
+		firstProcessor=atoi(argv[3]);
+
+	printf("ThreadPool dispatch latency and throughput\n");
+	printf("Usage: ThreadPoolBenchmark [numThreads] [numTasks] [firstProcessor]\n");
+	printf("%i processors, %u tasks per throughput test\n\n", SLNet::RakThread::GetNumberOfProcessors(), numTasks);
+
+	printf("                       latency (us per round trip)     throughput (tasks/s)\n");
+	printf("scheduling     threads    output queue      future       AddInput()      AddInputs()\n");
+	RunBenchmark(TPS_SHARED_QUEUE, numThreads, numTasks, firstProcessor);
+	RunBenchmark(TPS_WORK_STEALING, numThreads, numTasks, firstProcessor);
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+/// \file
+/// \brief Encrypts the datagrams of secure connections with an AEAD cipher from OpenSSL
+///
+
+
+#include "NativeFeatureIncludes.h"
+#if LIBCAT_SECURITY==1
+
+#ifndef __AEAD_ENCRYPTION_H
+#define __AEAD_ENCRYPTION_H
+
+#include "Export.h"
+#include "types.h"
+#include "SecureHandshake.h"
+
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
+namespace SLNet
+{
+
+/// \brief Drop-in replacement for cat::AuthenticatedEncryption, using AES-128-GCM or ChaCha20-Poly1305 from OpenSSL EVP
+/// \details The keys are derived from the session key of a cat::AuthenticatedEncryption instance, once the handshake completed.<BR>
+/// The overhead is the same as with cat::AuthenticatedEncryption, so the MTU calculations do not depend on the cipher suite:
+/// an 8 byte truncated authentication tag followed by the low 3 bytes of the 64-bit IV. The 96-bit nonce is a salt derived with the keys, followed by the IV.<BR>
+/// Uses the same 1024-bit anti-replay sliding window as cat::AuthenticatedEncryption, and accepts datagrams out of order.
+/// This class is NOT THREAD-SAFE.
+class RAK_DLL_EXPORT AeadEncryption
+{
+public:
+	AeadEncryption();
+	~AeadEncryption();
+
+	static const unsigned int TAG_BYTES = 8;
+	static const unsigned int IV_BYTES = 3;
+	static const unsigned int OVERHEAD_BYTES = TAG_BYTES + IV_BYTES;
+
+	/// Returns if the OpenSSL library in use implements \a cipherSuite. CIPHER_SUITE_CALICO is never implemented by this class.
+	static bool IsSupported(CipherSuite cipherSuite);
+
+	/// Derives the keys for \a cipherSuite from the session key of \a authenticatedEncryption
+	/// \return false if \a cipherSuite is not supported, in which case GetCipherSuite() returns CIPHER_SUITE_CALICO
+	bool SetKey(CipherSuite cipherSuite, cat::AuthenticatedEncryption *authenticatedEncryption);
+
+	/// Frees the cipher contexts. GetCipherSuite() returns CIPHER_SUITE_CALICO afterwards.
+	void Clear(void);
+
+	/// Returns the cipher suite passed to SetKey(), or CIPHER_SUITE_CALICO if no key is set
+	CipherSuite GetCipherSuite(void) const {return cipherSuite;}
+
+	/// Same as cat::AuthenticatedEncryption::Decrypt()
+	/// \param[in,out] bufferBytes Number of bytes in the buffer, including the overhead. Set to the size of the decrypted message on success.
+	/// \return false if the message is invalid, in which case it should be ignored as if it was never received
+	bool Decrypt(unsigned char *buffer, unsigned int &bufferBytes);
+
+	/// Same as cat::AuthenticatedEncryption::Encrypt()
+	/// \param[in] bufferBytes Size of the buffer, which must hold the message and OVERHEAD_BYTES
+	/// \param[in,out] messageBytes Number of bytes in the message. Set to the size of the encrypted message on success.
+	bool Encrypt(unsigned char *buffer, unsigned int bufferBytes, unsigned int &messageBytes);
+
+protected:
+	static const int BITMAP_BITS = 1024;
+	static const int BITMAP_WORDS = BITMAP_BITS / 64;
+	static const unsigned int SALT_BYTES = 4;
+
+	bool IsValidIV(uint64_t iv) const;
+	void AcceptIV(uint64_t iv);
+	static void GetNonce(const unsigned char salt[SALT_BYTES], uint64_t iv, unsigned char nonce[12]);
+
+	CipherSuite cipherSuite;
+	// Initialized with the key once, after that only the nonce is set for each datagram
+	EVP_CIPHER_CTX *localContext, *remoteContext;
+	unsigned char localSalt[SALT_BYTES], remoteSalt[SALT_BYTES];
+	uint64_t localIV, remoteIV;
+	uint64_t ivBitmap[BITMAP_WORDS];
+};
+
+} // namespace SLNet
+
+#endif
+
+#endif // LIBCAT_SECURITY
@@ -63,6 +63,11 @@ struct RAK_DLL_EXPORT CloudKey
 
 	/// \internal
 	void Serialize(bool writeToBitstream, BitStream *bitStream);
+
+	bool operator==(const CloudKey &right) const {return secondaryKey==right.secondaryKey && primaryKey==right.primaryKey;}
+
+	/// \internal Hash function for DataStructures::Hash
+	static unsigned long ToUint32(const CloudKey &key);
 };
 
 /// \internal
@@ -107,6 +107,18 @@ public:
 	/// \param[out] remoteServers List of servers added
 	void GetRemoteServers(DataStructures::List<RakNetGUID> &remoteServersOut);
 
+	/// \brief Partition keys across the servers added with AddServer() by consistent hashing
+	/// \details By default, every server tells every other server which keys it has, and Get() requests are sent to every server that has one of the keys.
+	/// With sharding, each key is owned by exactly one server, found by hashing the key onto a ring of all servers. Data is kept on the server the uploading client is connected to and replicated to the owner of the key.
+	/// Get() requests and subscriptions are only sent to the owners of the queried keys. When a server is added or removed, only the keys whose owner changed are moved.
+	/// All servers must use the same settings. Call before AddServer().
+	/// \param[in] enabled True to partition keys across servers
+	/// \param[in] virtualNodesPerServer Number of points per server on the ring. More points spread keys more evenly between servers.
+	void SetSharding(bool enabled, unsigned int virtualNodesPerServer=64);
+
+	/// \return The server owning \a key. This system's GUID if sharding is disabled or no servers were added.
+	RakNetGUID GetKeyOwner(const CloudKey &key) const;
+
 	/// \brief Frees all memory. Does not remove query filters
 	void Clear(void);
 
@@ -151,7 +163,7 @@ protected:
 	// ----------------------------------------------------------------------------
 	struct CloudData
 	{
-		CloudData() {}
+		CloudData() {uploadedKeysIndex=(unsigned int) -1;}
 		~CloudData() {if (allocatedData) rakFree_Ex(allocatedData, _FILE_AND_LINE_);}
 		bool IsUnused(void) const {return isUploaded==false && specificSubscribers.Size()==0;}
 		void Clear(void) {if (dataPtr==allocatedData) rakFree_Ex(allocatedData, _FILE_AND_LINE_); allocatedData=0; dataPtr=0; dataLengthBytes=0; isUploaded=false;}
@@ -174,6 +186,9 @@ protected:
 		/// RakNetGUID of client that uploaded this data
 		RakNetGUID clientGUID;
 
+		/// Position of the key in RemoteCloudClient::uploadedKeys of the uploading client, or (unsigned int) -1 if not uploaded
+		unsigned int uploadedKeysIndex;
+
 		/// When the key data changes from this particular system, notify these subscribers
 		/// This list mutually exclusive with CloudDataList::nonSpecificSubscribers
 		DataStructures::OrderedList<RakNetGUID, RakNetGUID> specificSubscribers;
@@ -202,6 +217,9 @@ protected:
 		unsigned int uploaderCount, subscriberCount;
 		CloudKey key;
 
+		/// Position in dataRepository, so the list can be removed without a search
+		unsigned int dataRepositoryIndex;
+
 		// Data uploaded from or subscribed to for various systems
 		DataStructures::OrderedList<RakNetGUID, CloudData*, CloudServer::KeyDataPtrComp> keyData;
 
@@ -210,8 +228,9 @@ protected:
 		DataStructures::OrderedList<RakNetGUID, RakNetGUID> nonSpecificSubscribers;
 	};
 
-	static int KeyDataListComp( const CloudKey &key, CloudDataList * const &data );
-	DataStructures::OrderedList<CloudKey, CloudDataList*, CloudServer::KeyDataListComp> dataRepository;
+	// Unordered. Lookups by key go through dataRepositoryIndex, removals swap in the last element.
+	DataStructures::List<CloudDataList*> dataRepository;
+	DataStructures::Hash<CloudKey, CloudDataList*, 65536, CloudKey::ToUint32> dataRepositoryIndex;
 
 	struct KeySubscriberID
 	{
@@ -225,7 +244,8 @@ protected:
 	{
 		bool IsUnused(void) const {return uploadedKeys.Size()==0 && subscribedKeys.Size()==0;}
 
-		DataStructures::OrderedList<CloudKey,CloudKey,CloudKeyComp> uploadedKeys;
+		// Unordered, see CloudData::uploadedKeysIndex
+		DataStructures::List<CloudKey> uploadedKeys;
 		DataStructures::OrderedList<CloudKey,KeySubscriberID*,CloudServer::KeySubscriberIDComp> subscribedKeys;
 		uint64_t uploadedBytes;
 	};
@@ -241,6 +261,34 @@ protected:
 	void NotifyClientSubscribersOfDataChange( CloudQueryRow *row, DataStructures::OrderedList<RakNetGUID, RakNetGUID> &subscribers, bool wasUpdated );
 	void NotifyServerSubscribersOfDataChange( CloudData *cloudData, CloudKey &key, bool wasUpdated );
 
+	// ----------------------------------------------------------------------------
+	// Changes to uploaded data are queued and sent to subscribers once per Update()
+	// Several changes to the same key by the same uploader within one tick are sent as one notification, with the final state
+	// ----------------------------------------------------------------------------
+	struct PendingNotificationKey
+	{
+		PendingNotificationKey() {}
+		PendingNotificationKey(const CloudKey &_key, RakNetGUID _clientGUID) : key(_key), clientGUID(_clientGUID) {}
+		bool operator==(const PendingNotificationKey &right) const {return clientGUID==right.clientGUID && key==right.key;}
+		static unsigned long ToUint32(const PendingNotificationKey &pendingNotificationKey);
+
+		CloudKey key;
+		RakNetGUID clientGUID;
+	};
+	struct PendingNotification
+	{
+		PendingNotificationKey pendingNotificationKey;
+		bool wasUpdated;
+		// If wasUpdated is false, a copy of the released data. The CloudData itself is cleared or deleted before the notification is sent.
+		CloudData *releasedData;
+	};
+	DataStructures::List<PendingNotification*> pendingNotifications;
+	DataStructures::Hash<PendingNotificationKey, PendingNotification*, 8192, PendingNotificationKey::ToUint32> pendingNotificationIndex;
+	/// Queue notifying client and server subscribers that \a cloudData was updated or released. Call before cloudData is cleared.
+	void QueueDataChangeNotification( CloudData *cloudData, CloudKey &key, bool wasUpdated );
+	void SendPendingNotifications(void);
+	void ClearPendingNotifications(void);
+
 	struct RemoteServer
 	{
 		RakNetGUID serverAddress;
@@ -326,10 +374,45 @@ protected:
 		DataStructures::List<RemoteServer*> &remoteServersWithData
 		);
 
-	CloudServer::CloudDataList *GetOrAllocateCloudDataList(CloudKey key, bool *dataRepositoryExists, unsigned int &dataRepositoryIndex);
+	// ----------------------------------------------------------------------------
+	// Sharding. See SetSharding()
+	// ----------------------------------------------------------------------------
+	struct ShardRingNode
+	{
+		uint32_t position;
+		RakNetGUID serverGUID;
+	};
+	static int ShardRingNodeComp(const uint32_t &key, const ShardRingNode &data );
+	typedef DataStructures::OrderedList<uint32_t, ShardRingNode, CloudServer::ShardRingNodeComp> ShardRing;
+	// Sorted by position. Empty if sharding is disabled or there are no remote servers.
+	ShardRing shardRing;
+	bool shardingEnabled;
+	unsigned int shardVirtualNodes;
+	static RakNetGUID GetKeyOwner(const CloudKey &key, const ShardRing &ring, RakNetGUID myGUID);
+	bool IsKeyOwner(const CloudKey &key) const;
+	/// Rebuilds shardRing from remoteServers, and moves keys whose owner changed
+	/// \param[in] removedServer Server that left, whose replicated data is deleted. UNASSIGNED_RAKNET_GUID if a server was added.
+	void UpdateShardRing(RakNetGUID removedServer);
+	/// Replicate data uploaded by a local client to the owner of the key
+	/// \param[in] ownerChanged True if the data did not change, but was moved to a new owner
+	void SendShardPost(RakNetGUID owner, CloudData *cloudData, CloudKey &key, bool ownerChanged);
+	/// Remove the replica of data released by a local client from the owner of the key
+	void SendShardRelease(CloudKey &key, RakNetGUID clientGUID);
+	void OnShardPost( Packet *packet );
+	void OnShardRelease( Packet *packet );
+	/// Deletes the replica at \a keyDataIndex, which was uploaded through another server
+	void DeleteReplica(CloudDataList *cloudDataList, unsigned int keyDataIndex, bool notifySubscribers);
+
+	CloudServer::CloudDataList *GetOrAllocateCloudDataList(CloudKey key, bool *dataRepositoryExists);
+	/// \return The CloudDataList for \a key, or 0 if none
+	CloudServer::CloudDataList *GetCloudDataList(const CloudKey &key);
+	/// Removes \a cloudDataList from dataRepository and deletes it
+	void DeleteCloudDataList(CloudDataList *cloudDataList);
 
 	void UnsubscribeFromKey(RemoteCloudClient *remoteCloudClient, RakNetGUID remoteCloudClientGuid, unsigned int keySubscriberIndex, CloudKey &cloudKey, DataStructures::List<RakNetGUID> &specificSystems);
 	void RemoveSpecificSubscriber(RakNetGUID specificSubscriber, CloudDataList *cloudDataList, RakNetGUID remoteCloudClientGuid);
+	/// Removes the key of \a cloudData from \a remoteCloudClient's uploadedKeys without a search
+	void RemoveUploadedKey(RemoteCloudClient *remoteCloudClient, CloudData *cloudData);
 
 	DataStructures::List<CloudServerQueryFilter*> queryFilters;
 
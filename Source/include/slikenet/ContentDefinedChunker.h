@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+/// \file ContentDefinedChunker.h
+/// \brief Splits data into chunks at positions that depend on the content, so that an insertion only changes the chunks around it
+///
+
+
+#ifndef __CONTENT_DEFINED_CHUNKER_H
+#define __CONTENT_DEFINED_CHUNKER_H
+
+#include "Export.h"
+#include "DS_List.h"
+#include "DR_SHA1.h"
+
+namespace SLNet
+{
+
+/// One chunk found by ContentDefinedChunker
+struct RAK_DLL_EXPORT ChunkSignature
+{
+	/// Offset of the chunk from the start of the data
+	unsigned int offset;
+	/// Length of the chunk in bytes
+	unsigned int length;
+	/// SHA1 of the chunk
+	unsigned char hash[SHA1_LENGTH];
+};
+
+/// \brief Splits a stream of data into chunks using a gear rolling hash, and hashes each chunk with SHA1
+/// \details The chunk boundaries only depend on the bytes just before them. Two versions of a file that differ in one place therefore share all but the chunks covering that place, even when the difference changes the file length.
+/// Chunks are between MIN_CHUNK_SIZE and MAX_CHUNK_SIZE bytes long, and about 64 kilobytes on average.
+/// Used by FileListTransfer::SendChunked()
+class RAK_DLL_EXPORT ContentDefinedChunker
+{
+public:
+	static const unsigned int MIN_CHUNK_SIZE=16384;
+	static const unsigned int MAX_CHUNK_SIZE=262144;
+
+	ContentDefinedChunker();
+
+	/// Start over with a new stream of data
+	void Reset(void);
+
+	/// Add the next \a length bytes of the stream
+	/// \param[in] data The data
+	/// \param[in] length How many bytes are in \a data
+	/// \param[out] chunks Chunks completed by this data are appended to this list
+	void Update(const char *data, unsigned int length, DataStructures::List<ChunkSignature> &chunks);
+
+	/// Call after the last call to Update(), to end the last chunk
+	/// \param[out] chunks The last chunk, if any, is appended to this list
+	void Final(DataStructures::List<ChunkSignature> &chunks);
+
+	/// Hash a single chunk the same way Update() does
+	static void HashChunk(const char *data, unsigned int length, unsigned char hash[SHA1_LENGTH]);
+
+protected:
+	void EndChunk(DataStructures::List<ChunkSignature> &chunks);
+
+	unsigned int gearTable[256];
+	unsigned int rollingHash;
+	unsigned int chunkOffset;
+	unsigned int chunkLength;
+	CSHA1 sha1;
+};
+
+} // namespace SLNet
+
+#endif
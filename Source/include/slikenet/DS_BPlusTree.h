@@ -743,6 +743,14 @@ namespace DataStructures
 					return 0; // Already exists
 				}
 
+				// The rotations below insert without checking the leaf
+				int leafIndex;
+				if (GetIndexOf(key, cur->children[branchIndex], &leafIndex))
+				{
+					*success=false;
+					return 0; // Already exists
+				}
+
 				if (CanRotateLeft(cur, branchIndex))
 				{
 					returnAction->action=ReturnAction::REPLACE_KEY1_WITH_KEY2;
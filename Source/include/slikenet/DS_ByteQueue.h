@@ -38,6 +38,8 @@ namespace DataStructures
 		bool ReadBytes(char *out, unsigned maxLengthToRead, bool peek);
 		unsigned GetBytesWritten(void) const;
 		char* PeekContiguousBytes(unsigned int *outLength) const;
+		// The bytes that wrapped around to the start of the buffer, following those returned by PeekContiguousBytes()
+		char* PeekWrappedBytes(unsigned int *outLength) const;
 		void IncrementReadOffset(unsigned length);
 		void DecrementReadOffset(unsigned length);
 		void Clear(const char *file, unsigned int line);
@@ -27,6 +27,11 @@
 #include "Export.h"
 #include "DS_LinkedList.h" 
 
+/// Number of bits DecodeArray() looks up at once. Codes up to this length are decoded with a single table lookup.
+#ifndef HUFFMAN_DECODING_TABLE_BITS
+#define HUFFMAN_DECODING_TABLE_BITS 10
+#endif
+
 namespace SLNet
 {
 
@@ -67,10 +72,29 @@ private:
 	{
 		unsigned char* encoding;
 		unsigned short bitLength;
+		/// Same bits as \a encoding, right aligned, so EncodeArray() can add them to a 64 bit word
+		uint64_t code;
 	};
 
 	CharacterEncoding encodingTable[ 256 ];
 
+	/// Length of the longest code. EncodeArray() writes each code separately if it does not fit into a 64 bit word with a partial byte.
+	unsigned short maxBitLength;
+
+	/// Result of looking up the next HUFFMAN_DECODING_TABLE_BITS bits of the input
+	struct DecodingTableEntry
+	{
+		/// Node reached after HUFFMAN_DECODING_TABLE_BITS bits, if the code is longer than that
+		HuffmanEncodingTreeNode *node;
+		unsigned char value;
+		/// Length of the code of \a value, or 0 if \a node is set
+		unsigned char bitLength;
+	};
+
+	DecodingTableEntry *decodingTable;
+
+	unsigned DecodeBits( const unsigned char *input, BitSize_t *bitOffset, BitSize_t endBit, unsigned char *output, size_t maxCharsToWrite ) const;
+
 	void InsertNodeIntoSortedList( HuffmanEncodingTreeNode * node, DataStructures::LinkedList<HuffmanEncodingTreeNode *> *huffmanEncodingTreeNodeList ) const;
 };
 
@@ -22,6 +22,8 @@
 
 #include "DS_List.h"
 #include "DS_BPlusTree.h"
+#include "DS_OrderedList.h"
+#include "DS_Hash.h"
 #include "memoryoverride.h"
 #include "Export.h"
 #include "slikeString.h"
@@ -184,6 +186,19 @@ namespace DataStructures
 			SortQueryType operation;
 		};
 
+		/// Secondary index kept for a column, see AddIndex()
+		enum IndexType
+		{
+			/// No index. Filters on the column are checked on every row.
+			INDEX_NONE,
+
+			/// Values kept in order in one contiguous array. Used by QF_EQUAL and range filters.
+			INDEX_SORTED,
+
+			/// Rows grouped by value. Used by QF_EQUAL filters.
+			INDEX_HASH,
+		};
+
 		// Constructor
 		Table();
 
@@ -299,6 +314,29 @@ namespace DataStructures
 		/// \param[out] out The address of an array of Rows, which will receive the sorted output.  The array must be long enough to contain all returned rows, up to GetRowCount()
 		void SortTable(Table::SortQuery *sortQueries, unsigned numSortQueries, Table::Row** out);
 
+		/// \brief Adds a secondary index to a NUMERIC or STRING column.
+		/// \details QueryTable() looks up the rows passing QF_EQUAL, QF_GREATER_THAN, QF_GREATER_THAN_EQ, QF_LESS_THAN and QF_LESS_THAN_EQ filters on indexed columns instead of checking every row.
+		/// If several filters can use an index, the one matching the fewest rows is used and the other filters are only checked on those rows.
+		/// Indexes are updated by AddRow(), RemoveRow() and UpdateCell(). If you change the cells of a row directly, call UpdateIndexes() afterwards.
+		/// Strings in indexed columns are interned, so each distinct string is stored once.
+		/// \param[in] columnIndex The index of the column
+		/// \param[in] indexType INDEX_SORTED or INDEX_HASH. An existing index on the column is replaced. INDEX_NONE removes the index.
+		/// \return false if there is no such column, or it is not NUMERIC or STRING
+		bool AddIndex(unsigned columnIndex, IndexType indexType);
+
+		/// \brief Removes the secondary index of a column, if it has one.
+		/// \param[in] columnIndex The index of the column
+		void RemoveIndex(unsigned columnIndex);
+
+		/// \brief Returns the secondary index type of a column.
+		/// \param[in] columnIndex The index of the column
+		/// \return The type of the index, INDEX_NONE if the column is not indexed
+		IndexType GetIndexType(unsigned columnIndex) const;
+
+		/// \brief Updates the secondary indexes for a row whose cells were changed directly.
+		/// \param[in] rowId The ID of the row
+		void UpdateIndexes(unsigned rowId);
+
 		/// \brief Frees all memory in the table.
 		void Clear(void);
 
@@ -332,7 +370,73 @@ namespace DataStructures
 		Table& operator = ( const Table& input );
 
 	protected:
-		Table::Row* AddRowColumns(unsigned rowId, Row *row, DataStructures::List<unsigned> columnIndices);
+		/// Value a row is indexed with. Strings are kept as the ID of the interned string.
+		struct IndexKey
+		{
+			double numericValue;
+			unsigned stringId;
+			// NaN, or a string cell without a string. These rows have no place in the order and are checked by every query.
+			bool isUnordered;
+		};
+
+		struct SortedIndexEntry
+		{
+			IndexKey key;
+			unsigned rowId;
+		};
+
+		typedef DataStructures::OrderedList<unsigned, unsigned> RowIdList;
+
+		static unsigned long HashIndexKey(const uint64_t &key);
+		static unsigned long HashRowId(const unsigned &rowId);
+		static unsigned long HashInternedString(const SLNet::RakString &str);
+
+		struct SecondaryIndex
+		{
+			SecondaryIndex();
+			~SecondaryIndex();
+
+			IndexType indexType;
+
+			// INDEX_SORTED: Ordered by value, then by row ID
+			DataStructures::List<SortedIndexEntry> sortedEntries;
+
+			// INDEX_HASH: The IDs of the rows with a value, keyed by the bits of the number or the interned string ID
+			DataStructures::Hash<uint64_t, RowIdList*, 4096, HashIndexKey> rowsByValue;
+
+			RowIdList unorderedRows;
+
+			// The key each row was indexed with, so rows changed directly can still be found
+			DataStructures::Hash<unsigned, IndexKey, 4096, HashRowId> keyByRowId;
+		};
+
+		struct InternedString
+		{
+			SLNet::RakString str;
+			unsigned refCount;
+		};
+
+		bool GetIndexKey(unsigned columnIndex, Row *row, IndexKey *key);
+		static uint64_t GetHashIndexKey(ColumnType columnType, const IndexKey &key);
+		int CompareIndexKey(ColumnType columnType, const IndexKey &key, unsigned rowId, const SortedIndexEntry &entry) const;
+		int CompareIndexKey(ColumnType columnType, const Cell *value, const SortedIndexEntry &entry) const;
+		unsigned SortedIndexLowerBound(unsigned columnIndex, const Cell *value, bool afterEqual) const;
+		void AddRowToIndex(unsigned columnIndex, unsigned rowId, Row *row);
+		void RemoveRowFromIndex(unsigned columnIndex, unsigned rowId);
+		void AddRowToIndexes(unsigned rowId, Row *row);
+		void RemoveRowFromIndexes(unsigned rowId);
+		void UpdateIndex(unsigned columnIndex, unsigned rowId, Row *row);
+		void ClearIndexes(void);
+
+		// Writes the IDs of the rows which may pass all filters to candidateRowIds, in increasing order.
+		// Returns false if no filter can use an index.
+		bool QueryIndexes(DataStructures::List<unsigned> &inclusionFilterColumnIndices, FilterQuery *inclusionFilters, DataStructures::List<unsigned> &candidateRowIds);
+
+		unsigned InternString(const char *str);
+		unsigned FindInternedString(const char *str);
+		void ReleaseInternedString(unsigned stringId);
+
+		Table::Row* AddRowColumns(unsigned rowId, Row *row, const DataStructures::List<unsigned> &columnIndices);
 
 		void DeleteRow(Row *row);
 
@@ -344,6 +448,14 @@ namespace DataStructures
 
 		// Columns in the table.
 		DataStructures::List<ColumnDescriptor> columns;
+
+		// Secondary index for each column, 0 if the column is not indexed
+		DataStructures::List<SecondaryIndex*> secondaryIndexes;
+
+		// Strings of indexed columns, by ID. IDs of released strings are reused.
+		DataStructures::List<InternedString> internedStrings;
+		DataStructures::List<unsigned> freeInternedStringIds;
+		DataStructures::Hash<SLNet::RakString, unsigned, 4096, HashInternedString> internedStringIds;
 	};
 }
 
@@ -170,6 +170,11 @@ public:
 	/// \param[in] context User defined byte to store with each file. Use for whatever you want.
 	void AddFilesFromDirectory(const char *applicationDirectory, const char *subDirectory, bool writeHash, bool writeData, bool recursive, FileListNodeContext context);
 
+	/// \brief Sets how many threads AddFilesFromDirectory() reads and hashes files on, including the calling thread
+	/// \details Only used when \a writeHash is true. The files are listed first and added in the same order as with one thread. Defaults to 1.
+	/// \param[in] numThreads Number of threads. 0 is treated as 1.
+	void SetNumHashThreads(unsigned int numThreads);
+
 	/// Deallocate all memory
 	void Clear(void);
 
@@ -255,6 +260,7 @@ public:
 	static bool FixEndingSlash(char *str, size_t strLength);
 protected:
 	DataStructures::List<FileListProgress*> fileListProgressCallbacks;
+	unsigned int numHashThreads;
 };
 
 } // namespace SLNet
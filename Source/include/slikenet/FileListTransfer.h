@@ -35,11 +35,13 @@
 #include "DS_Queue.h"
 #include "SimpleMutex.h"
 #include "ThreadPool.h"
+#include "ContentDefinedChunker.h"
 
 namespace SLNet
 {
 /// Forward declarations
 class IncrementalReadInterface;
+class IncrementalWriteInterface;
 class FileListTransferCBInterface;
 class FileListProgress;
 struct FileListReceiver;
@@ -78,8 +80,9 @@ public:
 	/// \param[in] handler The class to call on each file
 	/// \param[in] deleteHandler True to delete the handler when it is no longer needed.  False to not do so.
 	/// \param[in] allowedSender Which system to allow files from.
+	/// \param[in] _incrementalWriteInterface If set, every file of this set is written through this interface as it arrives. Files the sender pushes with an IncrementalReadInterface are written chunk by chunk instead of being held in memory. OnFile() is called after the file was written. \a fileData is 0 for files that arrived in more than one part, such as pushed and chunked files. If a file cannot be written, the set is aborted and OnDereference() is called instead. Must remain valid while the set is being received.
 	/// \return A set ID value, which should be passed as the \a setID value to the Send() call on the other system.  This value will be returned in the callback and is unique per file set.  Returns 65535 on failure (not connected to sender)
-    unsigned short SetupReceive(FileListTransferCBInterface *handler, bool deleteHandler, SystemAddress allowedSender);
+    unsigned short SetupReceive(FileListTransferCBInterface *handler, bool deleteHandler, SystemAddress allowedSender, IncrementalWriteInterface *_incrementalWriteInterface=0);
 
 	/// \brief Send the FileList structure to another system, which must have previously called SetupReceive().
 	/// \param[in] fileList A list of files.  The data contained in FileList::data will be sent incrementally and compressed among all files in the set
@@ -92,6 +95,24 @@ public:
 	/// \param[in] _chunkSize How large of a block of a file to read/send at once. Large values use more memory but transfer slightly faster.
 	void Send(FileList *fileList, SLNet::RakPeerInterface *rakPeer, SystemAddress recipient, unsigned short setID, PacketPriority priority, char orderingChannel, IncrementalReadInterface *_incrementalReadInterface=0, unsigned int _chunkSize=262144*4*16);
 
+	/// \brief Send the FileList structure to another system in content-defined chunks, sending only the chunks the other system does not have yet
+	/// \details The other system must have previously called SetupReceive(), and should pass an IncrementalWriteInterface to it.
+	/// Each file is split into chunks with ContentDefinedChunker, and a manifest with the SHA1 of every chunk is sent first. The recipient checks which chunks it already has,
+	/// either in the partial file left by an interrupted earlier transfer, or in the older version of the file on disk, and requests only the others.
+	/// If the connection drops, calling SendChunked() again after reconnecting resumes the set where it stopped.
+	/// Chunks are verified against the manifest when they arrive, and spread over \a numOrderingChannels ordering channels so one lost datagram does not hold up the others.
+	/// If chunks keep failing verification, the recipient gives up on the set and calls FileListTransferCBInterface::OnDereference() without OnDownloadComplete().
+	/// Without an IncrementalWriteInterface on the recipient, every chunk is sent and the file is assembled in memory.
+	/// \param[in] fileList A list of files. Files with data are copied, so \a fileList may be deallocated after this call.
+	/// \param[in] recipient The address of the system to send to
+	/// \param[in] setID The return value of SetupReceive() which was previously called on \a recipient
+	/// \param[in] priority Passed to RakPeerInterface::Send()
+	/// \param[in] orderingChannel The manifest is sent on this channel, chunks on \a orderingChannel to \a orderingChannel + \a numOrderingChannels - 1
+	/// \param[in] numOrderingChannels How many ordering channels to spread chunks over
+	/// \param[in] _incrementalReadInterface Used to read files that are references. Must remain valid until the send completes or is aborted.
+	/// \param[in] maxChunksInFlight How many chunks may be sent but not yet acknowledged by the recipient
+	void SendChunked(FileList *fileList, SystemAddress recipient, unsigned short setID, PacketPriority priority, char orderingChannel, int numOrderingChannels=4, IncrementalReadInterface *_incrementalReadInterface=0, unsigned int maxChunksInFlight=16);
+
 	/// Return number of files waiting to go out to a particular address
 	unsigned int GetPendingFilesToAddress(SystemAddress recipient);
 
@@ -138,6 +159,15 @@ protected:
 	void OnReferencePushAck(Packet *packet);
 	void SendIRIToAddress(SystemAddress systemAddress, unsigned short inSetId);
 
+	void OnChunkedManifest(Packet *packet, SLNet::BitStream *inBitStream);
+	void OnChunkedRequest(Packet *packet, SLNet::BitStream *inBitStream);
+	void OnChunkedChunk(Packet *packet, SLNet::BitStream *inBitStream);
+	void OnChunkedChunkAck(Packet *packet, SLNet::BitStream *inBitStream);
+	// Both return true if they deleted fileListReceiver
+	bool OnChunkedScanComplete(FileListReceiver *fileListReceiver, unsigned int setIndex);
+	bool OnChunkedFileComplete(FileListReceiver *fileListReceiver, unsigned int setIndex);
+	void SendChunkedRequest(SystemAddress systemAddress, unsigned short inSetId, unsigned int setIndex, const DataStructures::List<unsigned int> &chunkIndices);
+
 	DataStructures::Map<unsigned short, FileListReceiver*> fileListReceivers;
 	unsigned short setId;
 	DataStructures::List<FileListProgress*> fileListProgressCallbacks;
@@ -152,6 +182,10 @@ protected:
 		unsigned int setIndex;
 		IncrementalReadInterface *incrementalReadInterface;
 		unsigned int chunkSize;
+		// incrementalReadInterface->AddFileReference() returned true
+		bool holdsFileReference;
+		void DeleteThis(void);
+		const char *ReadChunk(unsigned int *bytesRead, void **buff);
 	};
 	struct FileToPushRecipient
 	{
@@ -180,6 +214,42 @@ protected:
 
 	ThreadPool<ThreadData, int> threadPool;
 
+	struct ChunkedSendFile
+	{
+		SLNet::RakString filename;
+		SLNet::RakString fullPathToFile;
+		FileListNodeContext context;
+		unsigned int setIndex;
+		unsigned int fileLengthBytes;
+		// Copy of FileListNode::data, or 0 to read through incrementalReadInterface
+		char *data;
+		// incrementalReadInterface->AddFileReference() returned true
+		bool holdsFileReference;
+		DataStructures::List<ChunkSignature> chunks;
+		// Chunk indices requested by the recipient and not yet sent
+		DataStructures::Queue<unsigned int> chunksToSend;
+		bool gotRequest;
+	};
+	struct ChunkedSend
+	{
+		SystemAddress systemAddress;
+		unsigned short setId;
+		PacketPriority packetPriority;
+		char orderingChannel;
+		int numOrderingChannels;
+		IncrementalReadInterface *incrementalReadInterface;
+		unsigned int maxChunksInFlight;
+		unsigned int chunksInFlight;
+		// Files are served round robin starting here
+		unsigned int nextFileIndex;
+		DataStructures::List<ChunkedSendFile*> files;
+	};
+	DataStructures::List<ChunkedSend*> chunkedSends;
+	bool ComputeChunks(ChunkedSend *chunkedSend, ChunkedSendFile *chunkedSendFile);
+	void SendChunks(unsigned int chunkedSendIndex);
+	void DeleteChunkedSend(ChunkedSend *chunkedSend);
+	unsigned int GetChunkedSendIndex(SystemAddress systemAddress, unsigned short inSetId) const;
+
 	friend int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutput, void* perThreadData);
 };
 
@@ -42,6 +42,7 @@ public:
 		char fileName[512];
 
 		/// \brief The data pointed to by the file
+		/// \details 0 if the file was written through an IncrementalWriteInterface in more than one part. Read it from disk instead.
 		char *fileData;
 
 		/// \brief The amount of data to be downloaded for this file
@@ -36,6 +36,26 @@ public:
 	/// \param[out] preallocatedDestination Write your data here
 	/// \return The number of bytes read, or 0 if none
 	virtual unsigned int GetFilePart( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, void *preallocatedDestination, FileListNodeContext context);
+
+	/// Called by FileListTransfer when \a filename is queued to be sent to a system
+	/// Return true to take a reference on the file. FileListTransfer will then try GetFilePartPointer() before GetFilePart(), and call ReleaseFileReference() once the file was sent or the send was cancelled.
+	/// If you return true, this instance must outlive the sends that use it.
+	/// \param[in] filename Filename that will be read
+	/// \return false by default
+	virtual bool AddFileReference( const char *filename, FileListNodeContext context);
+
+	/// Releases a reference taken by a successful call to AddFileReference()
+	/// \param[in] filename Filename passed to AddFileReference()
+	virtual void ReleaseFileReference( const char *filename, FileListNodeContext context);
+
+	/// Return a pointer to part of a file, rather than copying it
+	/// The pointer must remain valid for as long as the reference taken by AddFileReference() is held
+	/// \param[in] filename Filename to read
+	/// \param[in] startReadBytes What offset from the start of the file to read from
+	/// \param[in] numBytesToRead How many bytes to read at most
+	/// \param[out] numBytesRead How many bytes the returned pointer points to
+	/// \return Pointer to the file data, or 0 to have GetFilePart() called instead
+	virtual const char* GetFilePartPointer( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, unsigned int *numBytesRead, FileListNodeContext context);
 };
 
 } // namespace SLNet
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#ifndef __INCREMENTAL_WRITE_INTERFACE_H
+#define __INCREMENTAL_WRITE_INTERFACE_H
+
+#include "FileListNodeContext.h"
+#include "Export.h"
+
+namespace SLNet
+{
+
+/// \brief Counterpart to IncrementalReadInterface on the receiving side of FileListTransfer
+/// \details Pass an instance to FileListTransfer::SetupReceive(). Files the remote system pushes through IncrementalReadInterface are then written chunk by chunk to their final offset, instead of being buffered in memory until the whole file arrived.
+/// The default implementation writes to disk below the directory passed to the constructor. Files are written to \<filename\>.partial, and renamed to \<filename\> once complete.
+class RAK_DLL_EXPORT IncrementalWriteInterface
+{
+public:
+	IncrementalWriteInterface();
+	/// \param[in] _applicationDirectory Prepended to each filename. Use \ or / as the path delineator.
+	IncrementalWriteInterface(const char *_applicationDirectory);
+	virtual ~IncrementalWriteInterface() {}
+
+	/// \param[in] _applicationDirectory Prepended to each filename. Use \ or / as the path delineator.
+	void SetApplicationDirectory(const char *_applicationDirectory);
+
+	/// Called when the first chunk of a file arrives
+	/// Data written by an earlier, interrupted transfer of the same file should be kept, so FileListTransfer::SendChunked() can resume it.
+	/// \param[in] filename Filename as sent by the remote system
+	/// \param[in] byteLengthOfFile Final size of the file
+	/// \param[in] context Context passed to FileList by the remote system
+	/// \return A handle passed to WriteFilePart(), ReadFilePart() and CloseFile(), or 0 on failure
+	virtual void* OpenFile(const char *filename, unsigned int byteLengthOfFile, FileListNodeContext context);
+
+	/// Write part of a file. Chunks may arrive in any order.
+	/// \param[in] fileHandle Return value of OpenFile()
+	/// \param[in] startWriteBytes What offset from the start of the file to write to
+	/// \param[in] source Data to write
+	/// \param[in] numBytesToWrite How many bytes are in \a source
+	/// \return true on success
+	virtual bool WriteFilePart(void *fileHandle, unsigned int startWriteBytes, const char *source, unsigned int numBytesToWrite);
+
+	/// Read back part of a file opened with OpenFile(). Used by FileListTransfer::SendChunked() to find chunks written by an earlier transfer.
+	/// \param[in] fileHandle Return value of OpenFile()
+	/// \param[in] startReadBytes What offset from the start of the file to read from
+	/// \param[in] numBytesToRead How many bytes to read
+	/// \param[out] preallocatedDestination Write the data here
+	/// \return The number of bytes read
+	virtual unsigned int ReadFilePart(void *fileHandle, unsigned int startReadBytes, unsigned int numBytesToRead, char *preallocatedDestination);
+
+	/// Read part of the version of a file that existed before the transfer. Used by FileListTransfer::SendChunked() to find chunks which did not change.
+	/// \param[in] filename Filename as sent by the remote system
+	/// \param[in] startReadBytes What offset from the start of the file to read from
+	/// \param[in] numBytesToRead How many bytes to read
+	/// \param[out] preallocatedDestination Write the data here
+	/// \param[in] context Context passed to FileList by the remote system
+	/// \return The number of bytes read, or 0 if there is no such file
+	virtual unsigned int ReadExistingFilePart(const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, char *preallocatedDestination, FileListNodeContext context);
+
+	/// Called when the last chunk was written, or when the transfer was aborted
+	/// \param[in] fileHandle Return value of OpenFile()
+	/// \param[in] completed true if every chunk was written successfully. Partial files are left on disk.
+	/// \return false if the file could not be closed or, if \a completed is true, not be moved to its final name. The previous version of the file is then kept.
+	virtual bool CloseFile(void *fileHandle, bool completed);
+
+protected:
+	bool GetFullPath(const char *filename, char *fullPath, size_t fullPathLength) const;
+
+	char applicationDirectory[512];
+};
+
+} // namespace SLNet
+
+#endif
@@ -107,6 +107,10 @@ struct InternalPacket : public InternalPacketFixedSizeTransmissionHeader
 		/// Data is allocated using rakMalloc. Just free it
 		NORMAL,
 
+		/// Same as NORMAL, but the allocation has room for a Packet behind the data, at GetPacketOffsetBehindData()
+		/// Used for received messages, so RakPeer can return them without allocating the Packet separately
+		NORMAL_WITH_PACKET,
+
 		/// data points to a larger block of data, where the larger block is reference counted. internalPacketRefCountedData is used in this case
 		REF_COUNTED,
 	
@@ -129,6 +133,12 @@ struct InternalPacket : public InternalPacketFixedSizeTransmissionHeader
 	unsigned char stackData[128];
 };
 
+/// Offset of the Packet in data allocated with InternalPacket::NORMAL_WITH_PACKET
+inline size_t GetPacketOffsetBehindData(size_t numBytes)
+{
+	return (numBytes + 15) & ~(size_t) 15;
+}
+
 } // namespace SLNet
 
 #endif
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#ifndef __MEMORY_MAPPED_READ_INTERFACE_H
+#define __MEMORY_MAPPED_READ_INTERFACE_H
+
+#include "IncrementalReadInterface.h"
+#include "DS_Hash.h"
+#include "slikeString.h"
+#include "SimpleMutex.h"
+
+namespace SLNet
+{
+
+/// \brief IncrementalReadInterface that maps each file into memory once and shares the mapping between all recipients
+/// \details When FileListTransfer sends the same file to many systems, the default IncrementalReadInterface opens and reads the file again for every chunk and every recipient.
+/// This class maps a file when the first send using it is queued, hands FileListTransfer pointers into the mapping instead of copying chunks into a buffer, and unmaps the file when the last send using it finished or was cancelled.
+/// The instance must outlive the FileListTransfer sends using it. Files must not be modified while they are mapped.
+class RAK_DLL_EXPORT MemoryMappedReadInterface : public IncrementalReadInterface
+{
+public:
+	MemoryMappedReadInterface();
+	virtual ~MemoryMappedReadInterface();
+
+	/// Copies from the mapping if \a filename is mapped, otherwise reads it from disk like IncrementalReadInterface
+	virtual unsigned int GetFilePart( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, void *preallocatedDestination, FileListNodeContext context);
+
+	/// Maps \a filename on the first reference. Returns false if the file could not be mapped, in which case it is read with GetFilePart().
+	virtual bool AddFileReference( const char *filename, FileListNodeContext context);
+
+	/// Unmaps \a filename when the last reference is released
+	virtual void ReleaseFileReference( const char *filename, FileListNodeContext context);
+
+	/// Returns a pointer into the mapping of \a filename
+	virtual const char* GetFilePartPointer( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, unsigned int *numBytesRead, FileListNodeContext context);
+
+	/// \return How many files are currently mapped
+	unsigned int GetMappedFileCount(void);
+
+protected:
+	struct MappedFile
+	{
+		char *data;
+		unsigned int length;
+		unsigned int refCount;
+#ifdef _WIN32
+		void *fileHandle;
+		void *mappingHandle;
+#endif
+	};
+
+	static MappedFile* MapFile(const char *filename);
+	static void UnmapFile(MappedFile *mappedFile);
+
+	DataStructures::Hash<SLNet::RakString, MappedFile*, 256, SLNet::RakString::ToInteger> mappedFiles;
+	SimpleMutex mappedFilesMutex;
+};
+
+} // namespace SLNet
+
+#endif
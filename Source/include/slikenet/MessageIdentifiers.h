@@ -423,8 +423,10 @@ enum DefaultMessageIDTypes
 	ID_NAT_REQUEST_BOUND_ADDRESSES,
 	ID_NAT_RESPOND_BOUND_ADDRESSES,
 	ID_FCM2_UPDATE_USER_CONTEXT,
-	ID_RESERVED_3,
-	ID_RESERVED_4,
+	/// FileListTransfer plugin - Manifest, chunk request, chunk or chunk ack of FileListTransfer::SendChunked()
+	ID_FILE_LIST_CHUNKED_TRANSFER,
+	/// RakVoice plugin - Voice data sent through or forwarded by RakVoiceServer, or a channel request to RakVoiceServer
+	ID_RAKVOICE_FORWARDING,
 	ID_RESERVED_5,
 	ID_RESERVED_6,
 	ID_RESERVED_7,
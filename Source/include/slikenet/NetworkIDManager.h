@@ -29,8 +29,8 @@
 namespace SLNet
 {
 
-/// Increase this value if you plan to have many persistent objects
-/// This value must match on all systems
+/// Initial number of slots in the index of objects by NetworkID. Must be a power of 2.
+/// The index doubles in size whenever it is more than 7/8 full, so this only needs to be increased to avoid growing it at runtime.
 #define NETWORK_ID_MANAGER_HASH_LENGTH 1024
 
 /// This class is simply used to generate a unique number for a group of instances of NetworkIDObject
@@ -62,6 +62,9 @@ public:
 	// Stop tracking all NetworkID objects
 	void Clear(void);
 
+	/// Returns how many objects are tracked
+	unsigned int GetObjectCount(void) const;
+
 	/// \internal
 	NetworkIDObject *GET_BASE_OBJECT_FROM_ID(NetworkID x);
 
@@ -72,8 +75,23 @@ protected:
 
 	friend class NetworkIDObject;
 
-	NetworkIDObject *networkIdHash[NETWORK_ID_MANAGER_HASH_LENGTH];
-	unsigned int NetworkIDToHashIndex(NetworkID networkId);
+	struct IndexEntry
+	{
+		NetworkID networkId;
+		/// 0 if the slot is empty
+		NetworkIDObject *object;
+	};
+
+	/// Open addressing with Robin Hood hashing: an entry is never further from the slot its ID hashes to than the entries it was inserted before.
+	/// Lookups stop at the first entry closer to its own slot than the searched ID would be, and removals shift the following entries back.
+	IndexEntry *networkIdIndex;
+	/// Size of networkIdIndex is 1<<networkIdIndexBits
+	unsigned int networkIdIndexBits;
+	unsigned int objectCount;
+
+	unsigned int NetworkIDToHashIndex(NetworkID networkId) const;
+	void AllocateIndex(unsigned int numBits);
+	void InsertIntoIndex(NetworkID networkId, NetworkIDObject *networkIdObject);
 	uint64_t startingOffset;
 	/// \internal
 	NetworkID GetNewNetworkID(void);
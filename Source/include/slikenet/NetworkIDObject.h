@@ -86,7 +86,6 @@ protected:
 
 	/// \internal, used by NetworkIDManager
 	friend class NetworkIDManager;
-	NetworkIDObject *nextInstanceForNetworkIDManager;
 };
 
 } // namespace SLNet
@@ -0,0 +1,186 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+/// \file
+/// \brief Writes incoming and outgoing network messages to a binary capture file, which is converted to the PacketLogger CSV format offline
+///
+
+
+#include "NativeFeatureIncludes.h"
+#if _RAKNET_SUPPORT_PacketLogger==1
+
+#ifndef __PACKET_CAPTURE_LOGGER_H
+#define __PACKET_CAPTURE_LOGGER_H
+
+#include "PacketLogger.h"
+#include "SingleProducerConsumer.h"
+#include "SimpleMutex.h"
+#include "LocklessTypes.h"
+#include "DS_List.h"
+#include "thread.h"
+#include <stdio.h>
+
+/// Number of bytes at the start of each message stored in a capture record
+#ifndef PACKET_CAPTURE_PAYLOAD_BYTES
+#define PACKET_CAPTURE_PAYLOAD_BYTES 32
+#endif
+
+namespace SLNet
+{
+
+/// \ingroup PACKETLOGGER_GROUP
+/// \brief Same as PacketLogger, but stores fixed size binary records instead of formatting lines
+/// \details Callbacks copy the message fields into a buffer owned by the calling thread, without locks or string formatting.
+/// A background thread writes the buffers to the capture file. If it falls behind, records are dropped rather than blocking the network threads.<BR>
+/// Convert a capture with DecodeFile() or the PacketCaptureDecoder sample. The output is the CSV format PacketLogger writes, with the clock column taken from the capture.<BR>
+/// To avoid searching the connection list for every message, the local address column holds the address RakPeer is bound to, rather than the external address seen by the remote system.
+class RAK_DLL_EXPORT PacketCaptureLogger : public PacketLogger
+{
+public:
+	// GetInstance() and DestroyInstance(instance*)
+	STATIC_FACTORY_DECLARATIONS(PacketCaptureLogger)
+
+	PacketCaptureLogger();
+	virtual ~PacketCaptureLogger();
+
+	/// Opens the capture file and starts the thread writing to it
+	/// \param[in] filenamePrefix The file is named <filenamePrefix>_<time>.slncap. 0 for PacketCapture.
+	/// \param[in] maxRecordsPerThread Records of a thread are dropped while it has this many records waiting to be written
+	/// \param[in] flushIntervalMS How often the writer thread writes waiting records
+	/// \return false if the file could not be opened or a capture is already running
+	bool StartCapture(const char *filenamePrefix, unsigned int maxRecordsPerThread=65536, SLNet::TimeMS flushIntervalMS=100);
+
+	/// Writes all waiting records and closes the capture file
+	void StopCapture(void);
+
+	/// Returns the number of records dropped because the writer thread fell behind
+	unsigned int GetDroppedRecordCount(void);
+
+	/// Writes the header and one CSV line per record of a capture file to \a csvOutput
+	/// Uses the prefix, suffix and SetPrintID() setting of this instance, and UserIDTOString() for user message IDs
+	/// \param[in] includePayload Adds the captured payload bytes in hex to the Miscellaneous column
+	/// \return false if the file could not be read or is not a capture file
+	bool DecodeFile(const char *captureFilename, FILE *csvOutput, bool includePayload);
+
+	virtual void OnDirectSocketSend(const char *data, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress);
+	virtual void OnDirectSocketReceive(const char *data, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress);
+	virtual void OnReliabilityLayerNotification(const char *errorMessage, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress, bool isError);
+	virtual void OnInternalPacket(InternalPacket *internalPacket, unsigned frameNumber, SystemAddress remoteSystemAddress, SLNet::TimeMS time, int isSend);
+	virtual void OnAck(unsigned int messageNumber, SystemAddress remoteSystemAddress, SLNet::TimeMS time);
+	virtual void OnPushBackPacket(const char *data, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress);
+	virtual void WriteMiscellaneous(const char *type, const char *msg);
+
+	/// Writes decoded lines to the output passed to DecodeFile(), otherwise same as PacketLogger
+	virtual void WriteLog(const char *str);
+
+	enum RecordType
+	{
+		PCR_SEND_RAW,
+		PCR_RECEIVE_RAW,
+		PCR_RELIABILITY_ERROR,
+		PCR_RELIABILITY_WARNING,
+		PCR_INTERNAL_PACKET,
+		PCR_TIMESTAMPED_INTERNAL_PACKET,
+		PCR_ACK,
+		PCR_PUSH_BACK_PACKET,
+		PCR_MISCELLANEOUS,
+	};
+
+	/// Layout of a record in the capture file, in the byte order of the capturing system
+	struct Record
+	{
+		/// Wall clock in microseconds since 1970
+		uint64_t clockUS;
+		/// Time passed to or read by the callback
+		uint64_t time;
+		uint32_t bitLength;
+		uint32_t reliableMessageNumber;
+		uint32_t frameNumber;
+		uint32_t splitPacketId;
+		uint32_t splitPacketIndex;
+		uint32_t splitPacketCount;
+		uint32_t orderingIndex;
+		uint16_t localPort;
+		uint16_t remotePort;
+		unsigned char localAddress[16];
+		unsigned char remoteAddress[16];
+		/// One of RecordType
+		unsigned char recordType;
+		/// isSend of OnInternalPacket()
+		unsigned char direction;
+		unsigned char messageId;
+		unsigned char payloadLength;
+		/// Bit 0 set if the local address is IPv6, bit 1 if the remote address is IPv6
+		unsigned char addressFlags;
+		unsigned char unused[3];
+		/// First bytes of the message, or the text of error, warning and miscellaneous records
+		unsigned char payload[PACKET_CAPTURE_PAYLOAD_BYTES];
+	};
+
+	/// Written once at the start of the capture file
+	struct FileHeader
+	{
+		char magic[8];
+		/// 0x01020304, to detect files from systems with a different byte order
+		uint32_t byteOrderMark;
+		uint32_t recordSize;
+		uint32_t payloadBytes;
+		uint32_t unused;
+	};
+
+protected:
+	virtual void OnAttach(void);
+	virtual void OnRakPeerStartup(void);
+
+	struct ThreadBuffer
+	{
+		ThreadBuffer();
+		DataStructures::SingleProducerConsumer<Record> records;
+		// Address of a thread local variable of the producing thread
+		const void *owner;
+		// Only changed by the producing thread
+		unsigned int droppedRecords;
+	};
+
+	ThreadBuffer* GetThreadBuffer(void);
+	// Returns 0 if not capturing or the buffer is full. Call CommitRecord() after filling it in.
+	Record* AllocateRecord(ThreadBuffer *&threadBuffer, unsigned char recordType, const SystemAddress &remoteSystemAddress);
+	void CommitRecord(ThreadBuffer *threadBuffer);
+	void WriteBufferedRecords(void);
+	static void WriteAddress(const SystemAddress &systemAddress, unsigned char *address, uint16_t *port, unsigned char *addressFlags, unsigned char ipv6Flag);
+	static SystemAddress ReadAddress(const unsigned char *address, uint16_t port, bool ipv6);
+	static void FormatClock(uint64_t clockUS, char buffer[128]);
+
+	friend RAK_THREAD_DECLARATION(PacketCaptureWriterLoop);
+
+	// Cache of GetThreadBuffer() in thread local storage, valid while it holds this id
+	unsigned int loggerId;
+
+	// Records are only added while this is non-zero
+	SLNet::LocklessUint32_t capturing;
+	SLNet::LocklessUint32_t writerThreadRunning;
+	FILE *captureFile;
+	unsigned int maxRecordsPerThread;
+	SLNet::TimeMS flushIntervalMS;
+	SystemAddress localSystemAddress;
+
+	// Buffers are only added, and deleted in the destructor, so producers can keep pointers to them
+	DataStructures::List<ThreadBuffer*> threadBuffers;
+	SimpleMutex threadBuffersMutex;
+	// Serializes WriteBufferedRecords() between the writer thread and StopCapture()
+	SimpleMutex writeMutex;
+	char *writeBuffer;
+	unsigned int writeBufferUsed;
+
+	FILE *decodeOutput;
+};
+
+} // namespace SLNet
+
+#endif
+
+#endif // _RAKNET_SUPPORT_*
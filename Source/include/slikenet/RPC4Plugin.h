@@ -177,6 +177,12 @@ class NetworkIDManager;
 		/// If called while processing a slot, no further slots for the currently executing signal will be executed
 		void InterruptSignal(void);
 
+		/// Sets whether Call(), CallBlocking() and Signal() to a single system send integer ids instead of function and slot names
+		/// \details Systems with this enabled announce it when they connect. The first time such a system receives a name it has registered from a system that announced it, it replies with the id it assigned to that name. Later calls to that system send the id.
+		/// Broadcasts, calls to systems that did not reply yet, and calls over TCPInterface send the name. Systems running earlier versions never announce, so they keep getting and sending names. Defaults to true.
+		/// \param[in] use True to send ids, false to always send names
+		void SetUseIdentifierIds(bool use);
+
 		/// \internal
 		struct LocalCallback
 		{
@@ -209,6 +215,32 @@ class NetworkIDManager;
 		};
 		DataStructures::Hash<SLNet::RakString, LocalSlot*,256, SLNet::RakString::ToInteger> localSlots;
 
+		/// \internal
+		// A function or slot name. Its index in identifiers is the id sent to remote systems, and is never reused.
+		struct Identifier
+		{
+			SLNet::RakString name;
+			unsigned int hash;
+			// What is currently registered under this name, 0 if nothing
+			LocalSlot *localSlot;
+			void ( *nonblockingFunction ) (SLNet::BitStream *userData, Packet *packet );
+			void ( *blockingFunction ) (SLNet::BitStream *userData, SLNet::BitStream *returnData, Packet *packet );
+		};
+
+		/// \internal
+		struct RemoteSystemIdentifiers
+		{
+			RemoteSystemIdentifiers() {usesIds=false;}
+			// The remote system announced it understands ids
+			bool usesIds;
+			// By index of the local identifier, the id the remote system assigned plus one, or 0 if not known
+			DataStructures::List<unsigned int> remoteIds;
+			// By index of the local identifier, whether the name was sent to the remote system, so its id is expected in reply
+			DataStructures::List<bool> sentNames;
+			// By index of the local identifier, whether the id was sent to the remote system
+			DataStructures::List<bool> sentIds;
+		};
+
 	protected:
 
 		// --------------------------------------------------------------------------------------------
@@ -216,6 +248,9 @@ class NetworkIDManager;
 		// --------------------------------------------------------------------------------------------
 		virtual void OnAttach(void);
 		virtual PluginReceiveResult OnReceive(Packet *packet);
+		virtual void OnClosedConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, PI2_LostConnectionReason lostConnectionReason );
+		virtual void OnNewConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, bool isIncoming);
+		virtual void OnRakPeerShutdown(void);
 
 		DataStructures::Hash<SLNet::RakString, void ( * ) (SLNet::BitStream *, Packet * ),64, SLNet::RakString::ToInteger> registeredNonblockingFunctions;
 		DataStructures::Hash<SLNet::RakString, void ( * ) (SLNet::BitStream *, SLNet::BitStream *, Packet * ),64, SLNet::RakString::ToInteger> registeredBlockingFunctions;
@@ -232,6 +267,27 @@ class NetworkIDManager;
 		bool interruptSignal;
 
 		void InvokeSignal(DataStructures::HashIndex functionIndex, SLNet::BitStream *serializedParameters, Packet *packet);
+		void InvokeSignal(LocalSlot *localSlot, SLNet::BitStream *serializedParameters, Packet *packet);
+
+		// Returns (unsigned int) -1 if the name was never added
+		unsigned int FindIdentifier(const char *name) const;
+		unsigned int AddIdentifier(const char *name);
+		// Returns true and the id the remote system assigned to \a name, if a single system is addressed and it sent one
+		// Otherwise \a name is sent as a string, and the id the remote system replies with is accepted
+		bool GetRemoteIdentifierId(const char *name, const AddressOrGUID &systemIdentifier, bool broadcast, unsigned int *remoteId);
+		// Tells the sender of \a packet the id of a name it sent as a string, unless that was already done
+		void SendIdentifierId(const char *name, Packet *packet);
+		// Tells \a systemIdentifier that this system understands ids
+		void SendUsesIdentifierIds(const AddressOrGUID &systemIdentifier, bool broadcast);
+		RemoteSystemIdentifiers* GetRemoteSystemIdentifiers(RakNetGUID guid, bool create);
+		void ClearRemoteSystemIdentifiers(void);
+
+		DataStructures::List<Identifier*> identifiers;
+		// Open addressing table of identifier index plus one by hash of the name, 0 for unused entries. The size is a power of two.
+		unsigned int *identifierTable;
+		unsigned int identifierTableSize;
+		DataStructures::Hash<RakNetGUID, RemoteSystemIdentifiers*, 256, RakNetGUID::ToUint32> remoteSystemIdentifiers;
+		bool useIdentifierIds;
 	};
 
 } // End namespace
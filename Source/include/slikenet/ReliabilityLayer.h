@@ -41,6 +41,7 @@
 #include "BitStream.h"
 #include "NativeFeatureIncludes.h"
 #include "SecureHandshake.h"
+#include "AeadEncryption.h"
 #include "PluginInterface2.h"
 #include "Rand.h"
 #include "socket2.h"
@@ -191,8 +192,9 @@ public:
 
 	/// This allocates bytes and writes a user-level message to those bytes.
 	/// \param[out] data The message
+	/// \param[out] packetMemory If not 0, set to memory for a Packet in the same allocation as \a data, or to 0 if there is none
 	/// \return Returns number of BITS put into the buffer
-	BitSize_t Receive( unsigned char**data );
+	BitSize_t Receive( unsigned char**data, void **packetMemory=0 );
 
 	/// Puts data on the send queue
 	/// \param[in] data The data to send
@@ -637,8 +639,15 @@ private:
 public:
 	cat::AuthenticatedEncryption* GetAuthenticatedEncryption(void) { return &auth_enc; }
 
+	/// Switches from the cipher of auth_enc to \a cipherSuite, once the handshake set the key of auth_enc
+	/// \return false if \a cipherSuite is not supported, in which case CIPHER_SUITE_CALICO stays in use
+	bool SetCipherSuite(CipherSuite cipherSuite);
+	CipherSuite GetCipherSuite(void) const { return aead_enc.GetCipherSuite(); }
+
 protected:
 	cat::AuthenticatedEncryption auth_enc;
+	// Used instead of auth_enc unless the cipher suite is CIPHER_SUITE_CALICO
+	AeadEncryption aead_enc;
 	bool useSecurity;
 #endif // LIBCAT_SECURITY
 };
@@ -33,6 +33,8 @@
 #include "DS_OrderedList.h"
 #include "DS_Queue.h"
 #include "SimpleMutex.h"
+#include "SignaledEvent.h"
+#include "ThreadPool.h"
 
 /// \defgroup REPLICA_MANAGER_GROUP3 ReplicaManager3
 /// \brief Third implementation of object replication
@@ -43,6 +45,7 @@ namespace SLNet
 {
 class Connection_RM3;
 class Replica3;
+struct SerializeParameters;
 
 /// \ingroup REPLICA_MANAGER_GROUP3
 /// Used for multiple worlds. World 0 is created automatically by default
@@ -241,6 +244,19 @@ public:
 	/// \param[in] intervalMS How frequently to autoserialize all objects. This controls the maximum number of game object updates per second.
 	void SetAutoSerializeInterval(SLNet::Time intervalMS);
 
+	/// \brief Optionally start worker threads to serialize to connections in parallel
+	/// \details By default, Update() runs the construction and serialization passes for all connections on the calling thread.<BR>
+	/// With worker threads started, the serialization pass of each connection becomes one job of a ThreadPool. The calling thread processes jobs as well, and returns once all of them are done.<BR>
+	/// The construction pass still runs on the calling thread, before the serialization jobs.<BR>
+	/// Messages generated by the jobs are buffered per connection and sent from the calling thread afterwards, so the order of messages to each connection does not change.<BR>
+	/// \note QuerySerialization(), Serialize() and OnSerializeTransmission() are never called concurrently for the same replica, but may be for different replicas. Connection_RM3::QuerySerializationList() will be called concurrently for different connections. Only use this if your implementations are threadsafe in that respect.
+	/// \param[in] numThreads how many worker threads to start
+	void StartSerializationThreads(int numThreads);
+
+	/// \brief Stops the threads started with StartSerializationThreads()
+	/// \details Update() will run on the calling thread only afterwards.
+	void StopSerializationThreads(void);
+
 	/// \brief Return the connections that we think have an instance of the specified Replica3 instance
 	/// \details This can be wrong, for example if that system locally deleted the outside the scope of ReplicaManager3, if QueryRemoteConstruction() returned false, or if DeserializeConstruction() returned false.
 	/// \param[in] replica The replica to check against.
@@ -336,6 +352,19 @@ protected:
 	SLNet::Connection_RM3 * PopConnection(unsigned int index, WorldId worldId);
 	Replica3* GetReplicaByNetworkID(NetworkID networkId, WorldId worldId);
 	unsigned int ReferenceInternal(SLNet::Replica3 *replica3, WorldId worldId);
+	void SerializeConnection(Connection_RM3 *connection, SerializeParameters *sp, WorldId worldId, SLNet::Time time, bool isParallel);
+
+	/// \internal
+	struct SerializationJob
+	{
+		ReplicaManager3 *replicaManager3;
+		Connection_RM3 *connection;
+		WorldId worldId;
+		SLNet::Time time;
+	};
+	void AddSerializationJob(Connection_RM3 *connection, WorldId worldId, SLNet::Time time);
+	void RunSerializationJobs(void);
+	friend SerializationJob* SerializationJobCB(SerializationJob *job, bool *returnOutput, void* perThreadData);
 
 	PRO defaultSendParameters;
 	SLNet::Time autoSerializeInterval;
@@ -350,6 +379,16 @@ protected:
 	RM3World *worldsArray[255];
 	// For fast traversal
 	DataStructures::List<RM3World *> worldsList;
+
+	// Used if StartSerializationThreads() was called
+	ThreadPool<SerializationJob*,SerializationJob*> serializationThreadPool;
+	DataStructures::List<SerializationJob> serializationJobs;
+	// Scratch parameters for jobs run on the thread calling Update(). Worker threads allocate their own.
+	SerializeParameters *serializationScratch;
+	// Counted under the mutex, so that the event is no longer used once RunSerializationJobs() sees all jobs done
+	SimpleMutex serializationJobsDoneMutex;
+	unsigned int serializationJobsDone;
+	SignaledEvent serializationJobsDoneEvent;
 private:
 	// #med - reconsider visibility here --- should be properly encapsulated so to not allow access to worldsList by derived classes (which could bypass the mutex)
 	// mutex to ensure thread safe access to worldsList member
@@ -599,6 +638,14 @@ public:
 	/// \internal
 	void AutoConstructByQuery(ReplicaManager3 *replicaManager3, WorldId worldId);
 
+	/// \internal
+	/// \details Sends \a bs right away, or buffers it until SendDeferred() if Update() serializes to this connection on a worker thread
+	void SendOrDefer(SLNet::BitStream *bs, PacketPriority priority, PacketReliability reliability, char orderingChannel, uint32_t sendReceipt, SLNet::RakPeerInterface *rakPeer);
+
+	/// \internal
+	/// \details Sends all messages buffered by SendOrDefer(), in the order they were generated
+	void SendDeferred(SLNet::RakPeerInterface *rakPeer);
+
 
 	// Internal - does the other system have this connection too? Validated means we can now use it
 	bool isValidated;
@@ -702,6 +749,17 @@ protected:
 	// Stores if we got download complete for this connection
 	bool gotDownloadComplete;
 
+	// Set by ReplicaManager3::Update() while serializing in parallel. Messages are then buffered in deferredSendData until SendDeferred()
+	struct DeferredSend
+	{
+		unsigned int offset;
+		unsigned int length;
+		PRO pro;
+	};
+	bool deferSends;
+	SLNet::BitStream deferredSendData;
+	DataStructures::List<DeferredSend> deferredSends;
+
 	friend class ReplicaManager3;
 private:
 	Connection_RM3() {};
@@ -1099,6 +1157,9 @@ public:
 	bool forceSendUntilNextUpdate;
 	LastSerializationResult *lsr;
 	uint32_t referenceIndex;
+	// lastSentSerialization and forceSendUntilNextUpdate are shared among connections
+	// Guards them while ReplicaManager3 serializes to connections in parallel
+	SimpleMutex serializationMutex;
 };
 
 /// \brief Use Replica3 through composition instead of inheritance by containing an instance of this templated class
@@ -58,6 +58,9 @@ protected:
 
 
 #else
+	// Called with hMutex locked
+	bool IsSignaledLocked(void);
+
 	SimpleMutex isSignaledMutex;
 	bool isSignaled;
 #if !defined(ANDROID)
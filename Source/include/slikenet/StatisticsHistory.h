@@ -98,6 +98,7 @@ public:
 
 	struct TimeAndValue;
 	struct TimeAndValueQueue;
+	struct TimeBucket;
 
 	struct TrackedObjectData
 	{
@@ -112,6 +113,19 @@ public:
 	virtual ~StatisticsHistory();
 	void SetDefaultTimeToTrack(Time defaultTimeToTrack);
 	Time GetDefaultTimeToTrack(void) const;
+
+	/// Values of all objects are also summed up per key in buckets of this duration, covering the default time to track
+	/// Read them with GetBucketsForKey(). Changing the interval or the default time to track clears the buckets. 0 to disable.
+	/// Defaults to 1000
+	void SetBucketInterval(Time interval);
+	Time GetBucketInterval(void) const;
+
+	/// Returns the ID of a key, adding the key if it is not known yet
+	/// Passing the ID instead of the key to AddValueByIndex() and AddValueByObjectID() avoids hashing the key for every value
+	unsigned int GetKeyId(RakString key);
+	/// Returns the key with the ID returned by GetKeyId()
+	const RakString& GetKeyName(unsigned int keyId) const;
+
 	bool AddObject(TrackedObjectData tod);
 	bool RemoveObject(uint64_t objectId, void **userData);
 	void RemoveObjectAtIndex(unsigned int index);
@@ -120,10 +134,15 @@ public:
 	StatisticsHistory::TrackedObjectData * GetObjectAtIndex(unsigned int index) const;
 	unsigned int GetObjectIndex(uint64_t objectId) const;
 	bool AddValueByObjectID(uint64_t objectId, RakString key, SHValueType val, Time curTime, bool combineEqualTimes);
+	bool AddValueByObjectID(uint64_t objectId, unsigned int keyId, SHValueType val, Time curTime, bool combineEqualTimes);
 	void AddValueByIndex(unsigned int index, RakString key, SHValueType val, Time curTime, bool combineEqualTimes);
+	void AddValueByIndex(unsigned int index, unsigned int keyId, SHValueType val, Time curTime, bool combineEqualTimes);
 	SHErrorCode GetHistoryForKey(uint64_t objectId, RakString key, TimeAndValueQueue **values, Time curTime) const;
 	bool GetHistorySorted(uint64_t objectId, SHSortOperation sortType, DataStructures::List<TimeAndValueQueue *> &values) const;
 	void MergeAllObjectsOnKey(RakString key, TimeAndValueQueue *tavqOutput, SHDataCategory dataCategory) const;
+	/// Returns the buckets of a key summed up over all objects, oldest first, without merging the values of the objects
+	/// Buckets without values are skipped. See SetBucketInterval()
+	SHErrorCode GetBucketsForKey(RakString key, DataStructures::List<TimeBucket> &buckets, Time curTime) const;
 	void GetUniqueKeyList(DataStructures::List<RakString> &keys);
 
 	struct TimeAndValue
@@ -132,6 +151,22 @@ public:
 		SHValueType val;
 	};
 
+	struct TimeBucket
+	{
+		TimeBucket();
+		/// Start of the bucket
+		Time time;
+		SHValueType sum;
+		SHValueType sumOfSquares;
+		SHValueType count;
+		/// Values combined with combineEqualTimes count once. Their lowest and highest include the value before it was combined.
+		SHValueType lowest;
+		SHValueType highest;
+
+		SHValueType GetAverage(void) const;
+		SHValueType GetStandardDeviation(void) const;
+	};
+
 	struct TimeAndValueQueue
 	{
 		TimeAndValueQueue();
@@ -182,6 +217,34 @@ public:
 		static SHValueType Interpolate(TimeAndValue t1, TimeAndValue t2, Time time);
 		/// \internal
 		SHValueType sortValue;
+
+		/// \internal
+		struct SequencedValue
+		{
+			SHValueType val;
+			Time time;
+			uint64_t sequence;
+		};
+
+		/// \internal
+		void PushValue(TimeAndValue tav);
+		/// \internal
+		TimeAndValue PopTailValue(void);
+		/// \internal
+		void PushRecentExtremes(const SequencedValue &sv);
+		/// \internal
+		void RestoreRecentExtremes(DataStructures::Queue<SequencedValue> &extremes, bool lowest);
+		/// \internal
+		void RebuildRecentExtremes(void);
+
+		// Values that are not followed by a lower (higher) value, in the order they were added
+		// The head is the recent lowest (highest) value
+		DataStructures::Queue<SequencedValue> recentLowestValues;
+		DataStructures::Queue<SequencedValue> recentHighestValues;
+		// Sequence number of values.Peek()
+		uint64_t firstSequence;
+		// Values removed since recentSum and recentSumOfSquares were last summed up again, to stop rounding errors from adding up
+		unsigned int culledSinceSummed;
 	};
 
 protected:
@@ -195,12 +258,30 @@ protected:
 		TrackedObject();
 		~TrackedObject();
 		TrackedObjectData trackedObjectData;
-		DataStructures::Hash<SLNet::RakString, TimeAndValueQueue*, 32, SLNet::RakString::ToInteger> dataQueues;
+		// Indexed by key ID, 0 for keys without values
+		DataStructures::List<TimeAndValueQueue*> dataQueues;
+	};
+
+	// Fixed number of buckets for one key, reused round robin
+	struct KeyBuckets
+	{
+		DataStructures::List<TimeBucket> buckets;
 	};
 
+	unsigned int FindKeyId(const RakString &key) const;
+	void AddToBuckets(unsigned int keyId, Time curTime, SHValueType val, SHValueType replacedVal, bool replaced);
+	void ClearBuckets(void);
+
 	DataStructures::OrderedList<uint64_t, TrackedObject*,TrackedObjectComp> objects;
 
 	Time timeToTrack;
+	Time bucketInterval;
+
+	// Hash is not const correct
+	mutable DataStructures::Hash<SLNet::RakString, unsigned int, 32, SLNet::RakString::ToInteger> keyIds;
+	DataStructures::List<RakString> keyNames;
+	// Indexed by key ID, 0 until a value is added
+	DataStructures::List<KeyBuckets*> keyBuckets;
 };
 
 /// \brief Input numerical values over time. Get sum, average, highest, lowest, standard deviation on recent or all-time values
@@ -216,6 +297,9 @@ public:
 	StatisticsHistoryPlugin();
 	virtual ~StatisticsHistoryPlugin();
 	void SetTrackConnections(bool _addNewConnections, int newConnectionsObjectType, bool _removeLostConnections);
+
+	/// Connection statistics are added at most once per \a interval, instead of every update. 0 (the default) for every update.
+	void SetSampleInterval(Time interval);
 	
 protected:
 	virtual void Update(void);
@@ -231,6 +315,9 @@ protected:
 	bool addNewConnections;
 	bool removeLostConnections;
 	int newConnectionsObjectType;
+	Time sampleInterval;
+	Time lastSampleTime;
+	unsigned int connectionKeyIds[8];
 };
 
 } // namespace SLNet
@@ -197,6 +197,19 @@ protected:
 
 	friend RAK_THREAD_DECLARATION(UpdateTCPInterfaceLoop);
 	friend RAK_THREAD_DECLARATION(ConnectionAttemptLoop);
+#if TCP_INTERFACE_USE_EPOLL==1
+	friend RAK_THREAD_DECLARATION(UpdateTCPInterfaceEpollLoop);
+
+	// Make remoteClients[remoteClientIndex].socket non-blocking and register it with epollFd
+	void AddToEpoll(unsigned int remoteClientIndex);
+	void AcceptConnections(void);
+
+	int epollFd;
+#endif
+	// Called after data was queued to a remote client with an empty outgoing buffer
+	// With epoll, wakes the update thread to write it. The select loop checks all outgoing buffers on its own.
+	void RequestFlush(unsigned int remoteClientIndex);
+	void StartPendingSSL(void);
 
 //	void DeleteRemoteClient(RemoteClient *remoteClient, fd_set *exceptionFD);
 //	void InsertRemoteClient(RemoteClient* remoteClient);
@@ -257,7 +270,14 @@ struct RemoteClient
 		outgoingDataMutex.Unlock();
 	}
 	void SetActive(bool a);
-	void SendOrBuffer(const char **data, const unsigned int *lengths, const int numParameters);
+	/// \return true if the outgoing buffer was empty before, so the update thread needs to be told to write it
+	bool SendOrBuffer(const char **data, const unsigned int *lengths, const int numParameters);
+#if TCP_INTERFACE_USE_EPOLL==1
+	/// Write as much of outgoingData as the socket accepts without blocking
+	void Flush(void);
+	/// Did Send() or Recv() return \a result because the non-blocking socket has no data or buffer space?
+	bool WouldBlock(int result);
+#endif
 };
 
 } // namespace SLNet
@@ -49,6 +49,93 @@ public:
 	// Note that this allocates queries, cells, and query->cell->c!. Use DeallocateQueryList to free.
 	static bool DeserializeFilterQueryList(SLNet::BitStream *out, DataStructures::Table::FilterQuery **query, unsigned int *numQueries, unsigned int maxQueries, int allocateExtraQueries=0);
 	static void DeallocateQueryList(DataStructures::Table::FilterQuery *query, unsigned int numQueries);
+
+	/// \brief Writes a table column by column, to be read in place with ColumnarTableView
+	/// \details Numeric and pointer columns are written as packed arrays, string columns as a dictionary of their distinct strings and an index into it per row, and binary columns as one block with an offset per row.
+	/// Empty cells are marked in a bitmap per column, left out for columns without empty cells.<BR>
+	/// Unlike SerializeTable(), which writes each cell with its own header, the output is byte aligned and little endian.
+	/// \param[in] in The table to write
+	/// \param[out] out Where to write the table
+	static void SerializeColumnarTable(DataStructures::Table *in, SLNet::BitStream *out);
+
+	/// \brief Reads a table written with SerializeColumnarTable()
+	/// \return false if the data is not a complete table written with SerializeColumnarTable()
+	static bool DeserializeColumnarTable(unsigned char *serializedTable, unsigned int dataLength, DataStructures::Table *out);
+	static bool DeserializeColumnarTable(SLNet::BitStream *in, DataStructures::Table *out);
+};
+
+/// \brief Reads a table written with TableSerializer::SerializeColumnarTable() in place, without deserializing it
+/// \details Set() checks the whole table once, so reading cells allocates and checks nothing. Strings and binary cells point into the serialized data, which must stay valid while the view is used.<BR>
+/// Rows are in the order of their keys, as in DataStructures::Table. Row and column indices passed to the getters must be less than GetRowCount() and GetColumnCount().
+class RAK_DLL_EXPORT ColumnarTableView
+{
+public:
+	ColumnarTableView();
+	~ColumnarTableView();
+
+	/// \brief Reads the layout of a table written with TableSerializer::SerializeColumnarTable()
+	/// \details Reusing a view for other tables does not allocate, unless a table has more columns than the ones before.
+	/// \return false if the data is not a complete table written with SerializeColumnarTable()
+	bool Set(const unsigned char *serializedTable, unsigned int dataLength);
+
+	/// \brief Same as Set(), reading from the read offset of \a in
+	/// \details On success, the read offset is moved past the table.
+	bool Set(SLNet::BitStream *in);
+
+	/// Forgets the table passed to Set()
+	void Clear(void);
+
+	/// Returns the number of bytes of the table passed to Set()
+	unsigned int GetSerializedLength(void) const;
+
+	unsigned int GetColumnCount(void) const;
+	const char *GetColumnName(unsigned int columnIndex) const;
+	DataStructures::Table::ColumnType GetColumnType(unsigned int columnIndex) const;
+	/// Returns the index of the column named \a columnName, or (unsigned int) -1 if there is none
+	unsigned int GetColumnIndex(const char *columnName) const;
+
+	unsigned int GetRowCount(void) const;
+	/// Returns the row ID passed to DataStructures::Table::AddRow()
+	unsigned GetRowKey(unsigned int rowIndex) const;
+
+	bool IsEmpty(unsigned int rowIndex, unsigned int columnIndex) const;
+	/// Numeric cell, 0 if empty
+	double GetNumeric(unsigned int rowIndex, unsigned int columnIndex) const;
+	/// String cell, 0 if empty
+	const char *GetString(unsigned int rowIndex, unsigned int columnIndex) const;
+	/// \brief Index of a string cell in the dictionary of its column
+	/// \details Cells with the same string have the same index, so strings can be compared or grouped by their index.
+	unsigned int GetStringIndex(unsigned int rowIndex, unsigned int columnIndex) const;
+	/// Number of distinct strings in a string column
+	unsigned int GetDictionarySize(unsigned int columnIndex) const;
+	const char *GetDictionaryString(unsigned int columnIndex, unsigned int stringIndex) const;
+	/// Binary cell, 0 with \a length 0 if empty
+	const char *GetBinary(unsigned int rowIndex, unsigned int columnIndex, unsigned int *length) const;
+	/// Pointer cell, 0 if empty
+	void *GetPointer(unsigned int rowIndex, unsigned int columnIndex) const;
+
+protected:
+	struct Column
+	{
+		const char *columnName;
+		DataStructures::Table::ColumnType columnType;
+		// One bit per row, set for empty cells. 0 if the column has no empty cells.
+		const unsigned char *emptyCells;
+		// Numeric and pointer: 8 bytes per row. String: the dictionary index of each row. Binary: the offset of each row, followed by the end.
+		const unsigned char *values;
+		// Bytes per dictionary index
+		unsigned char indexSize;
+		unsigned int dictionarySize;
+		const unsigned char *dictionaryOffsets;
+		// String: the NUL terminated strings of the dictionary. Binary: the data of all cells.
+		const unsigned char *data;
+	};
+
+	const unsigned char *serializedTable;
+	unsigned int serializedLength;
+	unsigned int rowCount;
+	const unsigned char *rowKeys;
+	DataStructures::List<Column> columns;
 };
 
 } // namespace SLNet
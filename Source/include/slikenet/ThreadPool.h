@@ -22,6 +22,11 @@
 #include "Export.h"
 #include "thread.h"
 #include "SignaledEvent.h"
+#include "LocklessTypes.h"
+#include "GetTime.h"
+#include "defines.h"
+#include "slikeAssert.h"
+#include <atomic>
 
 class ThreadDataInterface
 {
@@ -32,6 +37,54 @@ public:
 	virtual void* PerThreadFactory(void *context)=0;
 	virtual void PerThreadDestructor(void* factoryResult, void *context)=0;
 };
+
+/// How ThreadPool hands input to its threads, see ThreadPool::SetScheduling()
+enum ThreadPoolScheduling
+{
+	/// All threads take input from one queue under one mutex. Each call to AddInput() wakes one thread.
+	TPS_SHARED_QUEUE,
+	/// Each thread takes input from a queue of its own. A thread without input takes the older half of the input of another thread.
+	/// AddInput() gives the input to an idle thread if there is one, and only wakes that thread.
+	TPS_WORK_STEALING
+};
+
+/// Receives the output of a single call to ThreadPool::AddInput(), instead of the output queue of the ThreadPool
+/// The future must stay valid until it is ready, or until its input is removed with ThreadPool::RemoveInputAtIndex() or ThreadPool::ClearInput().
+template <class OutputType>
+class RAK_DLL_EXPORT ThreadPoolFuture
+{
+public:
+	ThreadPoolFuture();
+	~ThreadPoolFuture();
+
+	/// \return true once the callback returned
+	bool IsReady(void);
+
+	/// Blocks until the callback returned
+	/// \param[in] timeoutMs How long to wait at most, in milliseconds
+	/// \return true if the callback returned, false on timeout
+	bool Wait(int timeoutMs);
+
+	/// \return false if the callback set returnOutput to false. Only valid once IsReady() returns true.
+	bool HasOutput(void);
+
+	/// \return The output of the callback. Only valid if HasOutput() returns true.
+	OutputType GetOutput(void);
+
+	/// Call before passing the future to ThreadPool::AddInput() again
+	void Reset(void);
+
+	/// \internal
+	void SetOutput(OutputType _output, bool _hasOutput);
+
+protected:
+	SLNet::SimpleMutex mutex;
+	SLNet::SignaledEvent readyEvent;
+	OutputType output;
+	bool isReady;
+	bool hasOutput;
+};
+
 /// A simple class to create worker threads that processes a queue of functions with data.
 /// This class does not allocate or deallocate memory.  It is up to the user to handle memory management.
 /// InputType and OutputType are stored directly in a queue.  For large structures, if you plan to delete from the middle of the queue,
@@ -54,6 +107,7 @@ struct RAK_DLL_EXPORT ThreadPool
 	void SetThreadDataInterface(ThreadDataInterface *tdi, void *context);
 
 	/// Stops all threads
+	/// \details With TPS_WORK_STEALING, do not call this while other threads call AddInput() or AddInputs(), since the queues they add to are freed.
 	void StopThreads(void);
 
 	/// Adds a function to a queue with data to pass to that function.  This function will be called from the thread
@@ -66,6 +120,27 @@ struct RAK_DLL_EXPORT ThreadPool
 	/// \param[in] inputData The parameter to pass to \a userCallback
 	void AddInput(OutputType (*workerThreadCallback)(InputType, bool *returnOutput, void* perThreadData), InputType inputData);
 
+	/// Same as AddInput(), but passes the output to \a future instead of adding it to the output queue
+	/// \param[in] future Receives the output. Must stay valid until future->IsReady() returns true.
+	void AddInput(OutputType (*workerThreadCallback)(InputType, bool *returnOutput, void* perThreadData), InputType inputData, ThreadPoolFuture<OutputType> *future);
+
+	/// Same as calling AddInput() for each element of \a inputData, but locks the input and wakes each thread only once
+	/// \param[in] inputData Array of input
+	/// \param[in] count Number of elements of \a inputData
+	void AddInputs(OutputType (*workerThreadCallback)(InputType, bool *returnOutput, void* perThreadData), const InputType *inputData, unsigned count);
+
+	/// Sets how input is handed to the threads. Call before StartThreads().
+	/// Defaults to TPS_WORK_STEALING if THREADPOOL_USE_WORK_STEALING is defined to 1 in defines.h, otherwise to TPS_SHARED_QUEUE.
+	void SetScheduling(ThreadPoolScheduling _scheduling);
+
+	/// \return What was passed to SetScheduling()
+	ThreadPoolScheduling GetScheduling(void) const;
+
+	/// Binds each thread to one processor: the first thread to \a _firstProcessor, the next thread to the next processor, and so on, wrapping around after the last processor.
+	/// Call before StartThreads(). Not supported on all platforms, see SLNet::RakThread::SetAffinity().
+	/// \param[in] _firstProcessor Processor of the first thread, or -1 to let the operating system choose (default)
+	void SetThreadAffinity(int _firstProcessor);
+
 	/// Adds to the output queue
 	/// Use it if you want to inject output into the same queue that the system uses. Normally you would not use this. Consider it a convenience function.
 	/// \param[in] outputData The output to inject
@@ -168,6 +243,8 @@ protected:
 	
 	template <class ThreadInputType, class ThreadOutputType>
 	friend RAK_THREAD_DECLARATION(WorkerThread);
+	template <class ThreadInputType, class ThreadOutputType>
+	friend RAK_THREAD_DECLARATION(WorkStealingWorkerThread);
 
 	/*
 #ifdef _WIN32
@@ -178,7 +255,8 @@ protected:
 	*/
 
 	/// \internal
-	bool runThreads;
+	/// Written under runThreadsMutex, atomic so the worker threads can also check it while processing input
+	std::atomic<bool> runThreads;
 	/// \internal
 	int numThreadsRunning;
 	/// \internal
@@ -188,6 +266,45 @@ protected:
 
 	SLNet::SignaledEvent quitAndIncomingDataEvents;
 
+	// Paired with inputQueue, 0 for input whose output goes to the output queue
+	DataStructures::Queue<ThreadPoolFuture<OutputType>*> inputFutureQueue;
+
+	/// \internal
+	struct WorkStealingInput
+	{
+		OutputType (*workerThreadCallback)(InputType, bool *, void*);
+		InputType inputData;
+		ThreadPoolFuture<OutputType> *future;
+	};
+	/// \internal
+	/// Input of one thread with TPS_WORK_STEALING
+	struct WorkStealingQueue
+	{
+		ThreadPool<InputType, OutputType> *threadPool;
+		int threadIndex;
+		SLNet::SimpleMutex mutex;
+		DataStructures::Queue<WorkStealingInput> inputQueue;
+		// inputQueue.Size(), updated under mutex, so other threads can check for input without locking it
+		std::atomic<unsigned> inputCount;
+		SLNet::SignaledEvent incomingDataEvent;
+		// Set while the thread has no input and waits on incomingDataEvent
+		std::atomic<bool> isIdle;
+	};
+
+	void SetAffinityOfThread(int threadIndex);
+	void PushWorkStealingInput(const WorkStealingInput &input);
+	bool PopWorkStealingInput(int threadIndex, WorkStealingInput &input);
+	void StopWorkStealing(void);
+
+	ThreadPoolScheduling scheduling;
+	int firstProcessor;
+	// One per thread while the threads run with TPS_WORK_STEALING, otherwise 0
+	WorkStealingQueue *workStealingQueues;
+	int numWorkStealingQueues;
+	SLNet::LocklessUint32_t nextWorkStealingQueue;
+	// Calls to AddInput() and AddInputs() in progress, to assert that none overlaps StopThreads() while work stealing
+	SLNet::LocklessUint32_t addingInput;
+
 // #if defined(SN_TARGET_PSP2)
 // 	SLNet::RakThread::UltUlThreadRuntime *runtime;
 // #endif
@@ -228,6 +345,7 @@ void* WorkerThread( void* arguments )
 	ThreadOutputType (*userCallback)(ThreadInputType, bool *, void*);
 	ThreadInputType inputData;
 	ThreadOutputType callbackOutput;
+	ThreadPoolFuture<ThreadOutputType> *future;
 
 	userCallback=0;
 
@@ -241,9 +359,12 @@ void* WorkerThread( void* arguments )
 
 	// Increase numThreadsRunning
 	threadPool->numThreadsRunningMutex.Lock();
+	int threadIndex=threadPool->numThreadsRunning;
 	++threadPool->numThreadsRunning;
 	threadPool->numThreadsRunningMutex.Unlock();
 
+	threadPool->SetAffinityOfThread(threadIndex);
+
 	for(;;)
 	{
 //#ifdef _WIN32
@@ -275,13 +396,16 @@ void* WorkerThread( void* arguments )
 		{
 			userCallback=threadPool->inputFunctionQueue.Pop();
 			inputData=threadPool->inputQueue.Pop();
+			future=threadPool->inputFutureQueue.Pop();
 		}
 		threadPool->inputQueueMutex.Unlock();
 
 		if (userCallback)
 		{
 			callbackOutput=userCallback(inputData, &returnOutput,perThreadData);
-			if (returnOutput)
+			if (future)
+				future->SetOutput(callbackOutput, returnOutput);
+			else if (returnOutput)
 			{
 				threadPool->outputQueueMutex.Lock();
 				threadPool->outputQueue.Push(callbackOutput, _FILE_AND_LINE_ );
@@ -294,26 +418,189 @@ void* WorkerThread( void* arguments )
 		threadPool->workingThreadCountMutex.Unlock();
 	}
 
+	if (threadPool->perThreadDataDestructor)
+		threadPool->perThreadDataDestructor(perThreadData);
+	else if (threadPool->threadDataInterface)
+		threadPool->threadDataInterface->PerThreadDestructor(perThreadData, threadPool->tdiContext);
+
 	// Decrease numThreadsRunning
+	// This must be the last access to threadPool, which may be destroyed once StopThreads() sees no threads running
 	threadPool->numThreadsRunningMutex.Lock();
 	--threadPool->numThreadsRunning;
 	threadPool->numThreadsRunningMutex.Unlock();
-	
+
+
+
+
+	return 0;
+
+}
+template <class ThreadInputType, class ThreadOutputType>
+RAK_THREAD_DECLARATION(WorkStealingWorkerThread)
+{
+	typename ThreadPool<ThreadInputType, ThreadOutputType>::WorkStealingQueue *queue = (typename ThreadPool<ThreadInputType, ThreadOutputType>::WorkStealingQueue*) arguments;
+	ThreadPool<ThreadInputType, ThreadOutputType> *threadPool = queue->threadPool;
+
+	bool returnOutput;
+	typename ThreadPool<ThreadInputType, ThreadOutputType>::WorkStealingInput input;
+	ThreadOutputType callbackOutput;
+
+	threadPool->SetAffinityOfThread(queue->threadIndex);
+
+	void *perThreadData;
+	if (threadPool->perThreadDataFactory)
+		perThreadData=threadPool->perThreadDataFactory();
+	else if (threadPool->threadDataInterface)
+		perThreadData=threadPool->threadDataInterface->PerThreadFactory(threadPool->tdiContext);
+	else
+		perThreadData=0;
+
+	// Increase numThreadsRunning
+	threadPool->numThreadsRunningMutex.Lock();
+	++threadPool->numThreadsRunning;
+	threadPool->numThreadsRunningMutex.Unlock();
+
+	for(;;)
+	{
+		threadPool->runThreadsMutex.Lock();
+		if (threadPool->runThreads==false)
+		{
+			threadPool->runThreadsMutex.Unlock();
+			break;
+		}
+		threadPool->runThreadsMutex.Unlock();
+
+		// Counted as working before taking input, so IsWorking() does not miss input between the queue and the callback
+		threadPool->workingThreadCountMutex.Lock();
+		++threadPool->numThreadsWorking;
+		threadPool->workingThreadCountMutex.Unlock();
+
+		bool foundInput=false;
+		while (threadPool->runThreads)
+		{
+			if (threadPool->PopWorkStealingInput(queue->threadIndex, input)==false)
+			{
+				// AddInput() only wakes idle threads, so mark this thread as idle and check once more before waiting
+				if (foundInput || queue->isIdle)
+					break;
+				queue->isIdle=true;
+				continue;
+			}
+			queue->isIdle=false;
+			foundInput=true;
+
+			callbackOutput=input.workerThreadCallback(input.inputData, &returnOutput, perThreadData);
+			if (input.future)
+				input.future->SetOutput(callbackOutput, returnOutput);
+			else if (returnOutput)
+			{
+				threadPool->outputQueueMutex.Lock();
+				threadPool->outputQueue.Push(callbackOutput, _FILE_AND_LINE_ );
+				threadPool->outputQueueMutex.Unlock();
+			}
+		}
+
+		threadPool->workingThreadCountMutex.Lock();
+		--threadPool->numThreadsWorking;
+		threadPool->workingThreadCountMutex.Unlock();
+
+		if (foundInput==false && queue->isIdle)
+		{
+			queue->incomingDataEvent.WaitOnEvent(1000);
+			queue->isIdle=false;
+		}
+	}
+
 	if (threadPool->perThreadDataDestructor)
 		threadPool->perThreadDataDestructor(perThreadData);
 	else if (threadPool->threadDataInterface)
 		threadPool->threadDataInterface->PerThreadDestructor(perThreadData, threadPool->tdiContext);
 
-
-
+	// Decrease numThreadsRunning
+	// This must be the last access to threadPool, which may be destroyed once StopThreads() sees no threads running
+	threadPool->numThreadsRunningMutex.Lock();
+	--threadPool->numThreadsRunning;
+	threadPool->numThreadsRunningMutex.Unlock();
 
 	return 0;
-
 }
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
 
+template <class OutputType>
+ThreadPoolFuture<OutputType>::ThreadPoolFuture()
+{
+	isReady=false;
+	hasOutput=false;
+	readyEvent.InitEvent();
+}
+template <class OutputType>
+ThreadPoolFuture<OutputType>::~ThreadPoolFuture()
+{
+	readyEvent.CloseEvent();
+}
+template <class OutputType>
+bool ThreadPoolFuture<OutputType>::IsReady(void)
+{
+	bool b;
+	mutex.Lock();
+	b=isReady;
+	mutex.Unlock();
+	return b;
+}
+template <class OutputType>
+bool ThreadPoolFuture<OutputType>::Wait(int timeoutMs)
+{
+	SLNet::TimeMS endTime=SLNet::GetTimeMS()+(SLNet::TimeMS) timeoutMs;
+	while (IsReady()==false)
+	{
+		// The event may still be signaled from before Reset(), so check the time as well
+		SLNet::TimeMS time=SLNet::GetTimeMS();
+		if ((int) (endTime-time) <= 0)
+			return false;
+		readyEvent.WaitOnEvent((int) (endTime-time));
+	}
+	return true;
+}
+template <class OutputType>
+bool ThreadPoolFuture<OutputType>::HasOutput(void)
+{
+	bool b;
+	mutex.Lock();
+	b=hasOutput;
+	mutex.Unlock();
+	return b;
+}
+template <class OutputType>
+OutputType ThreadPoolFuture<OutputType>::GetOutput(void)
+{
+	OutputType o;
+	mutex.Lock();
+	o=output;
+	mutex.Unlock();
+	return o;
+}
+template <class OutputType>
+void ThreadPoolFuture<OutputType>::Reset(void)
+{
+	mutex.Lock();
+	isReady=false;
+	hasOutput=false;
+	mutex.Unlock();
+}
+template <class OutputType>
+void ThreadPoolFuture<OutputType>::SetOutput(OutputType _output, bool _hasOutput)
+{
+	mutex.Lock();
+	if (_hasOutput)
+		output=_output;
+	hasOutput=_hasOutput;
+	isReady=true;
+	mutex.Unlock();
+	readyEvent.SetEvent();
+}
+
 template <class InputType, class OutputType>
 ThreadPool<InputType, OutputType>::ThreadPool()
 {
@@ -322,13 +609,23 @@ ThreadPool<InputType, OutputType>::ThreadPool()
 	threadDataInterface=0;
 	tdiContext=0;
 	numThreadsWorking=0;
-
+#if THREADPOOL_USE_WORK_STEALING==1
+	scheduling=TPS_WORK_STEALING;
+#else
+	scheduling=TPS_SHARED_QUEUE;
+#endif
+	firstProcessor=-1;
+	workStealingQueues=0;
+	numWorkStealingQueues=0;
+	// AddInput() sets the event also while the threads are stopped
+	quitAndIncomingDataEvents.InitEvent();
 }
 template <class InputType, class OutputType>
 ThreadPool<InputType, OutputType>::~ThreadPool()
 {
 	StopThreads();
 	Clear();
+	quitAndIncomingDataEvents.CloseEvent();
 }
 template <class InputType, class OutputType>
 bool ThreadPool<InputType, OutputType>::StartThreads(int numThreads, int stackSize, void* (*_perThreadDataFactory)(), void (*_perThreadDataDestructor)(void *))
@@ -348,8 +645,6 @@ bool ThreadPool<InputType, OutputType>::StartThreads(int numThreads, int stackSi
 	}
 	runThreadsMutex.Unlock();
 
-	quitAndIncomingDataEvents.InitEvent();
-
 	perThreadDataFactory=_perThreadDataFactory;
 	perThreadDataDestructor=_perThreadDataDestructor;
 
@@ -361,6 +656,36 @@ bool ThreadPool<InputType, OutputType>::StartThreads(int numThreads, int stackSi
 	unsigned threadId = 0;
 	(void) threadId;
 	int i;
+
+	if (scheduling==TPS_WORK_STEALING && numThreads > 0)
+	{
+		workStealingQueues=SLNet::OP_NEW_ARRAY<WorkStealingQueue>(numThreads, _FILE_AND_LINE_);
+		numWorkStealingQueues=numThreads;
+		for (i=0; i < numThreads; i++)
+		{
+			workStealingQueues[i].threadPool=this;
+			workStealingQueues[i].threadIndex=i;
+			workStealingQueues[i].isIdle=false;
+			workStealingQueues[i].inputCount=0;
+			workStealingQueues[i].incomingDataEvent.InitEvent();
+		}
+
+		// Hand out input added before the threads were started
+		inputQueueMutex.Lock();
+		i=0;
+		while (inputQueue.Size())
+		{
+			WorkStealingInput input;
+			input.workerThreadCallback=inputFunctionQueue.Pop();
+			input.inputData=inputQueue.Pop();
+			input.future=inputFutureQueue.Pop();
+			workStealingQueues[i].inputQueue.Push(input, _FILE_AND_LINE_ );
+			workStealingQueues[i].inputCount=workStealingQueues[i].inputQueue.Size();
+			i=(i+1)%numThreads;
+		}
+		inputQueueMutex.Unlock();
+	}
+
 	for (i=0; i < numThreads; i++)
 	{
 		int errorCode;
@@ -368,7 +693,10 @@ bool ThreadPool<InputType, OutputType>::StartThreads(int numThreads, int stackSi
 
 
 
-		errorCode = SLNet::RakThread::Create(WorkerThread<InputType, OutputType>, this);
+		if (workStealingQueues)
+			errorCode = SLNet::RakThread::Create(WorkStealingWorkerThread<InputType, OutputType>, &workStealingQueues[i]);
+		else
+			errorCode = SLNet::RakThread::Create(WorkerThread<InputType, OutputType>, this);
 
 		if (errorCode!=0)
 		{
@@ -413,6 +741,8 @@ void ThreadPool<InputType, OutputType>::StopThreads(void)
 	while (done==false)
 	{
 		quitAndIncomingDataEvents.SetEvent();
+		for (int i=0; i < numWorkStealingQueues; i++)
+			workStealingQueues[i].incomingDataEvent.SetEvent();
 
 		RakSleep(50);
 		numThreadsRunningMutex.Lock();
@@ -421,7 +751,7 @@ void ThreadPool<InputType, OutputType>::StopThreads(void)
 		numThreadsRunningMutex.Unlock();
 	}
 
-	quitAndIncomingDataEvents.CloseEvent();
+	StopWorkStealing();
 
 // #if defined(SN_TARGET_PSP2)
 // 	SLNet::RakThread::DeallocRuntime(runtime);
@@ -432,14 +762,220 @@ void ThreadPool<InputType, OutputType>::StopThreads(void)
 template <class InputType, class OutputType>
 void ThreadPool<InputType, OutputType>::AddInput(OutputType (*workerThreadCallback)(InputType, bool *returnOutput, void* perThreadData), InputType inputData)
 {
+	AddInput(workerThreadCallback, inputData, 0);
+}
+template <class InputType, class OutputType>
+void ThreadPool<InputType, OutputType>::AddInput(OutputType (*workerThreadCallback)(InputType, bool *returnOutput, void* perThreadData), InputType inputData, ThreadPoolFuture<OutputType> *future)
+{
+	addingInput.Increment();
+	if (workStealingQueues)
+	{
+		WorkStealingInput input;
+		input.workerThreadCallback=workerThreadCallback;
+		input.inputData=inputData;
+		input.future=future;
+		PushWorkStealingInput(input);
+		addingInput.Decrement();
+		return;
+	}
+	addingInput.Decrement();
+
 	inputQueueMutex.Lock();
 	inputQueue.Push(inputData, _FILE_AND_LINE_ );
 	inputFunctionQueue.Push(workerThreadCallback, _FILE_AND_LINE_ );
+	inputFutureQueue.Push(future, _FILE_AND_LINE_ );
+	inputQueueMutex.Unlock();
+
+	quitAndIncomingDataEvents.SetEvent();
+}
+template <class InputType, class OutputType>
+void ThreadPool<InputType, OutputType>::AddInputs(OutputType (*workerThreadCallback)(InputType, bool *returnOutput, void* perThreadData), const InputType *inputData, unsigned count)
+{
+	unsigned i;
+	addingInput.Increment();
+	if (workStealingQueues)
+	{
+		// One block of consecutive input per thread, so every queue is locked once
+		unsigned blockSize=(count+numWorkStealingQueues-1)/numWorkStealingQueues;
+		int queueIndex=(int) (nextWorkStealingQueue.Increment() % (uint32_t) numWorkStealingQueues);
+		WorkStealingInput input;
+		input.workerThreadCallback=workerThreadCallback;
+		input.future=0;
+		for (i=0; i < count; i+=blockSize)
+		{
+			unsigned blockEnd = i+blockSize < count ? i+blockSize : count;
+			WorkStealingQueue &queue = workStealingQueues[queueIndex];
+			queue.mutex.Lock();
+			for (unsigned j=i; j < blockEnd; j++)
+			{
+				input.inputData=inputData[j];
+				queue.inputQueue.Push(input, _FILE_AND_LINE_ );
+			}
+			queue.inputCount=queue.inputQueue.Size();
+			queue.mutex.Unlock();
+			queue.incomingDataEvent.SetEvent();
+			queueIndex=(queueIndex+1)%numWorkStealingQueues;
+		}
+		addingInput.Decrement();
+		return;
+	}
+	addingInput.Decrement();
+
+	inputQueueMutex.Lock();
+	for (i=0; i < count; i++)
+	{
+		inputQueue.Push(inputData[i], _FILE_AND_LINE_ );
+		inputFunctionQueue.Push(workerThreadCallback, _FILE_AND_LINE_ );
+		inputFutureQueue.Push(0, _FILE_AND_LINE_ );
+	}
 	inputQueueMutex.Unlock();
 
 	quitAndIncomingDataEvents.SetEvent();
 }
 template <class InputType, class OutputType>
+void ThreadPool<InputType, OutputType>::SetScheduling(ThreadPoolScheduling _scheduling)
+{
+	RakAssert(WasStarted()==false);
+	scheduling=_scheduling;
+}
+template <class InputType, class OutputType>
+ThreadPoolScheduling ThreadPool<InputType, OutputType>::GetScheduling(void) const
+{
+	return scheduling;
+}
+template <class InputType, class OutputType>
+void ThreadPool<InputType, OutputType>::SetThreadAffinity(int _firstProcessor)
+{
+	RakAssert(WasStarted()==false);
+	firstProcessor=_firstProcessor;
+}
+template <class InputType, class OutputType>
+void ThreadPool<InputType, OutputType>::SetAffinityOfThread(int threadIndex)
+{
+	if (firstProcessor>=0)
+		SLNet::RakThread::SetAffinity((firstProcessor+threadIndex) % SLNet::RakThread::GetNumberOfProcessors());
+}
+template <class InputType, class OutputType>
+void ThreadPool<InputType, OutputType>::PushWorkStealingInput(const WorkStealingInput &input)
+{
+	// Prefer an idle thread, so the input does not wait for the current input of a busy thread
+	int start=(int) (nextWorkStealingQueue.Increment() % (uint32_t) numWorkStealingQueues);
+	int queueIndex=start;
+	int i;
+	for (i=0; i < numWorkStealingQueues; i++)
+	{
+		if (workStealingQueues[(start+i)%numWorkStealingQueues].isIdle)
+		{
+			queueIndex=(start+i)%numWorkStealingQueues;
+			break;
+		}
+	}
+
+	WorkStealingQueue &queue = workStealingQueues[queueIndex];
+	queue.mutex.Lock();
+	queue.inputQueue.Push(input, _FILE_AND_LINE_ );
+	queue.inputCount=queue.inputQueue.Size();
+	queue.mutex.Unlock();
+
+	// Check isIdle after adding the input. A thread setting isIdle later checks all queues before waiting.
+	if (queue.isIdle)
+	{
+		queue.incomingDataEvent.SetEvent();
+		return;
+	}
+	// The thread is busy, let an idle thread steal the input
+	for (i=1; i < numWorkStealingQueues; i++)
+	{
+		WorkStealingQueue &idleQueue = workStealingQueues[(queueIndex+i)%numWorkStealingQueues];
+		if (idleQueue.isIdle)
+		{
+			idleQueue.incomingDataEvent.SetEvent();
+			return;
+		}
+	}
+}
+template <class InputType, class OutputType>
+bool ThreadPool<InputType, OutputType>::PopWorkStealingInput(int threadIndex, WorkStealingInput &input)
+{
+	WorkStealingQueue &queue = workStealingQueues[threadIndex];
+	queue.mutex.Lock();
+	if (queue.inputQueue.Size())
+	{
+		input=queue.inputQueue.Pop();
+		queue.inputCount=queue.inputQueue.Size();
+		queue.mutex.Unlock();
+		return true;
+	}
+	queue.mutex.Unlock();
+
+	// Start with the next thread, so idle threads do not all steal from the same queue
+	for (int i=1; i < numWorkStealingQueues; i++)
+	{
+		int victimIndex=(threadIndex+i)%numWorkStealingQueues;
+		WorkStealingQueue &victim = workStealingQueues[victimIndex];
+		if (victim.inputCount==0)
+			continue;
+
+		// Lock in the order of the threads, as LockInput() does
+		if (victimIndex < threadIndex)
+		{
+			victim.mutex.Lock();
+			queue.mutex.Lock();
+		}
+		else
+		{
+			queue.mutex.Lock();
+			victim.mutex.Lock();
+		}
+
+		bool stole=false;
+		if (victim.inputQueue.Size())
+		{
+			// Run the oldest input, and take the older half of the rest along, so this thread does not steal again right away
+			input=victim.inputQueue.Pop();
+			unsigned count=victim.inputQueue.Size()/2;
+			while (count-- > 0)
+				queue.inputQueue.Push(victim.inputQueue.Pop(), _FILE_AND_LINE_ );
+			victim.inputCount=victim.inputQueue.Size();
+			queue.inputCount=queue.inputQueue.Size();
+			stole=true;
+		}
+
+		victim.mutex.Unlock();
+		queue.mutex.Unlock();
+		if (stole)
+			return true;
+	}
+	return false;
+}
+template <class InputType, class OutputType>
+void ThreadPool<InputType, OutputType>::StopWorkStealing(void)
+{
+	if (workStealingQueues==0)
+		return;
+	RakAssert(addingInput.GetValue()==0 && "AddInput() must not be called during StopThreads() with TPS_WORK_STEALING");
+
+	// Return input that was not processed to the shared queue, so it can be read and removed with GetInputAtIndex() and ClearInput()
+	inputQueueMutex.Lock();
+	for (int i=0; i < numWorkStealingQueues; i++)
+	{
+		while (workStealingQueues[i].inputQueue.Size())
+		{
+			WorkStealingInput input=workStealingQueues[i].inputQueue.Pop();
+			inputQueue.Push(input.inputData, _FILE_AND_LINE_ );
+			inputFunctionQueue.Push(input.workerThreadCallback, _FILE_AND_LINE_ );
+			inputFutureQueue.Push(input.future, _FILE_AND_LINE_ );
+		}
+		workStealingQueues[i].inputCount=0;
+		workStealingQueues[i].incomingDataEvent.CloseEvent();
+	}
+	inputQueueMutex.Unlock();
+
+	SLNet::OP_DELETE_ARRAY(workStealingQueues, _FILE_AND_LINE_);
+	workStealingQueues=0;
+	numWorkStealingQueues=0;
+}
+template <class InputType, class OutputType>
 void ThreadPool<InputType, OutputType>::AddOutput(OutputType outputData)
 {
 	outputQueueMutex.Lock();
@@ -463,15 +999,20 @@ bool ThreadPool<InputType, OutputType>::HasOutput(void)
 template <class InputType, class OutputType>
 bool ThreadPool<InputType, OutputType>::HasInputFast(void)
 {
+	for (int i=0; i < numWorkStealingQueues; i++)
+	{
+		if (workStealingQueues[i].inputCount!=0)
+			return true;
+	}
 	return inputQueue.IsEmpty()==false;
 }
 template <class InputType, class OutputType>
 bool ThreadPool<InputType, OutputType>::HasInput(void)
 {
 	bool res;
-	inputQueueMutex.Lock();
-	res=inputQueue.IsEmpty()==false;
-	inputQueueMutex.Unlock();
+	LockInput();
+	res=InputSize()>0;
+	UnlockInput();
 	return res;
 }
 template <class InputType, class OutputType>
@@ -491,10 +1032,9 @@ void ThreadPool<InputType, OutputType>::Clear(void)
 	if (runThreads)
 	{
 		runThreadsMutex.Unlock();
-		inputQueueMutex.Lock();
-		inputFunctionQueue.Clear(_FILE_AND_LINE_);
-		inputQueue.Clear(_FILE_AND_LINE_);
-		inputQueueMutex.Unlock();
+		LockInput();
+		ClearInput();
+		UnlockInput();
 
 		outputQueueMutex.Lock();
 		outputQueue.Clear(_FILE_AND_LINE_);
@@ -502,8 +1042,8 @@ void ThreadPool<InputType, OutputType>::Clear(void)
 	}
 	else
 	{
-		inputFunctionQueue.Clear(_FILE_AND_LINE_);
-		inputQueue.Clear(_FILE_AND_LINE_);
+		runThreadsMutex.Unlock();
+		ClearInput();
 		outputQueue.Clear(_FILE_AND_LINE_);
 	}
 }
@@ -511,27 +1051,52 @@ template <class InputType, class OutputType>
 void ThreadPool<InputType, OutputType>::LockInput(void)
 {
 	inputQueueMutex.Lock();
+	for (int i=0; i < numWorkStealingQueues; i++)
+		workStealingQueues[i].mutex.Lock();
 }
 template <class InputType, class OutputType>
 void ThreadPool<InputType, OutputType>::UnlockInput(void)
 {
+	for (int i=numWorkStealingQueues-1; i >= 0; i--)
+		workStealingQueues[i].mutex.Unlock();
 	inputQueueMutex.Unlock();
 }
 template <class InputType, class OutputType>
 unsigned ThreadPool<InputType, OutputType>::InputSize(void)
 {
-	return inputQueue.Size();
+	// With TPS_WORK_STEALING, the indices continue through the queues of all threads
+	unsigned size=inputQueue.Size();
+	for (int i=0; i < numWorkStealingQueues; i++)
+		size+=workStealingQueues[i].inputQueue.Size();
+	return size;
 }
 template <class InputType, class OutputType>
 InputType ThreadPool<InputType, OutputType>::GetInputAtIndex(unsigned index)
 {
-	return inputQueue[index];
+	if (index < inputQueue.Size())
+		return inputQueue[index];
+	index-=inputQueue.Size();
+	int i=0;
+	while (index >= workStealingQueues[i].inputQueue.Size())
+		index-=workStealingQueues[i++].inputQueue.Size();
+	return workStealingQueues[i].inputQueue[index].inputData;
 }
 template <class InputType, class OutputType>
 void ThreadPool<InputType, OutputType>::RemoveInputAtIndex(unsigned index)
 {
-	inputQueue.RemoveAtIndex(index);
-	inputFunctionQueue.RemoveAtIndex(index);
+	if (index < inputQueue.Size())
+	{
+		inputQueue.RemoveAtIndex(index);
+		inputFunctionQueue.RemoveAtIndex(index);
+		inputFutureQueue.RemoveAtIndex(index);
+		return;
+	}
+	index-=inputQueue.Size();
+	int i=0;
+	while (index >= workStealingQueues[i].inputQueue.Size())
+		index-=workStealingQueues[i++].inputQueue.Size();
+	workStealingQueues[i].inputQueue.RemoveAtIndex(index);
+	workStealingQueues[i].inputCount=workStealingQueues[i].inputQueue.Size();
 }
 template <class InputType, class OutputType>
 void ThreadPool<InputType, OutputType>::LockOutput(void)
@@ -563,6 +1128,12 @@ void ThreadPool<InputType, OutputType>::ClearInput(void)
 {
 	inputQueue.Clear(_FILE_AND_LINE_);
 	inputFunctionQueue.Clear(_FILE_AND_LINE_);
+	inputFutureQueue.Clear(_FILE_AND_LINE_);
+	for (int i=0; i < numWorkStealingQueues; i++)
+	{
+		workStealingQueues[i].inputQueue.Clear(_FILE_AND_LINE_);
+		workStealingQueues[i].inputCount=0;
+	}
 }
 
 template <class InputType, class OutputType>
@@ -27,6 +27,7 @@
 
 #include "Export.h"
 #include "types.h"
+#include "defines.h"
 #include "SocketIncludes.h"
 #include "UDPProxyCommon.h"
 #include "SimpleMutex.h"
@@ -34,6 +35,8 @@
 #include "thread.h"
 #include "DS_Queue.h"
 #include "DS_OrderedList.h"
+#include "DS_List.h"
+#include "DS_Hash.h"
 #include "LocklessTypes.h"
 #include "DS_ThreadsafeAllocatingQueue.h"
 
@@ -63,6 +66,11 @@ public:
 	/// Required to call before StartForwarding
 	void Startup(void);
 
+	/// Forwarding entries are distributed over this many threads, each waiting on the sockets of its own entries
+	/// Call before Startup(). Defaults to 1.
+	/// \param[in] _numThreads How many threads to forward datagrams on
+	void SetNumThreads(unsigned int _numThreads);
+
 	/// Stops the system, and frees all sockets
 	void Shutdown(void);
 
@@ -99,6 +107,32 @@ public:
 	/// \param[in] destination Where to forward to
 	void StopForwarding(SystemAddress source, SystemAddress destination);
 
+	/// Traffic relayed by one forwarding entry, see GetForwardingStatistics()
+	struct ForwardingStatistics
+	{
+		/// \a source passed to StartForwarding()
+		SystemAddress source;
+		/// \a destination passed to StartForwarding()
+		SystemAddress destination;
+		unsigned short forwardingPort;
+		/// Sum of the datagram sizes forwarded, in both directions
+		uint64_t bytesForwarded;
+		/// Number of datagrams forwarded, in both directions
+		uint64_t datagramsForwarded;
+		SLNet::TimeMS timeLastDatagramForwarded;
+	};
+
+	/// Get the statistics of every forwarding entry
+	/// \param[out] statistics One element per forwarding entry
+	void GetForwardingStatistics(DataStructures::List<ForwardingStatistics> &statistics);
+
+	/// Get the statistics of the forwarding entry between \a source and \a destination
+	/// \param[in] source The source IP and port
+	/// \param[in] destination Where to forward to
+	/// \param[out] statistics Written to if the forwarding entry exists
+	/// \return false if there is no such forwarding entry
+	bool GetForwardingStatistics(SystemAddress source, SystemAddress destination, ForwardingStatistics *statistics);
+
 
 	struct ForwardEntry
 	{
@@ -109,15 +143,18 @@ public:
 		__UDPSOCKET__ socket;
 		SLNet::TimeMS timeoutOnNoDataMS;
 		short socketFamily;
+		uint64_t bytesForwarded, datagramsForwarded;
+
+		// Internal to UDPForwarder: position in ForwarderThread::forwardList and the timeout wheel
+		unsigned int forwardListIndex;
+		ForwardEntry *timerPrev, *timerNext, **timerSlot;
+		uint32_t timerExpiryTick;
 	};
 
 
 protected:
 	friend RAK_THREAD_DECLARATION(UpdateUDPForwarderGlobal);
 
-	void UpdateUDPForwarder(void);
-	void RecvFrom(SLNet::TimeMS curTime, ForwardEntry *forwardEntry);
-
 	struct StartForwardingInputStruct
 	{
 		SystemAddress source;
@@ -128,8 +165,6 @@ protected:
 		unsigned int inputId;
 	};
 
-	DataStructures::ThreadsafeAllocatingQueue<StartForwardingInputStruct> startForwardingInput;
-
 	struct StartForwardingOutputStruct
 	{
 		unsigned short forwardingPort;
@@ -145,15 +180,71 @@ protected:
 		SystemAddress source;
 		SystemAddress destination;
 	};
-	DataStructures::ThreadsafeAllocatingQueue<StopForwardingStruct> stopForwardingCommands;
 	unsigned int nextInputId;
 
-	// New entries are added to forwardListNotUpdated
-	DataStructures::List<ForwardEntry*> forwardListNotUpdated;
-//	SimpleMutex forwardListNotUpdatedMutex;
+	/// Identifies a forwarding entry regardless of which address was the source
+	struct ForwardEntryKey
+	{
+		ForwardEntryKey() {}
+		ForwardEntryKey(const SystemAddress &address1, const SystemAddress &address2);
+		bool operator==(const ForwardEntryKey &right) const;
+		static unsigned long ToUint32(const ForwardEntryKey &key);
+		SystemAddress lowAddress, highAddress;
+	};
+
+	// Timeouts are kept in a two level timer wheel. Level 0 slots are one tick wide, level 1 slots TIMER_WHEEL_SLOTS ticks.
+	// Together they cover TIMER_WHEEL_TICK_MS*TIMER_WHEEL_SLOTS*TIMER_WHEEL_SLOTS, over 17 minutes, more than UDP_FORWARDER_MAXIMUM_TIMEOUT
+	static const unsigned int TIMER_WHEEL_TICK_MS=16;
+	static const unsigned int TIMER_WHEEL_SLOTS=256;
+
+	/// One thread and the forwarding entries it owns. Entries are assigned by their address pair.
+	struct ForwarderThread
+	{
+		ForwarderThread();
+		UDPForwarder *udpForwarder;
+		DataStructures::ThreadsafeAllocatingQueue<StartForwardingInputStruct> startForwardingInput;
+		DataStructures::ThreadsafeAllocatingQueue<StopForwardingStruct> stopForwardingCommands;
+		// Only changed by the thread, with forwardListMutex locked so GetForwardingStatistics() can read them
+		DataStructures::List<ForwardEntry*> forwardList;
+		DataStructures::Hash<ForwardEntryKey, ForwardEntry*, 4096, ForwardEntryKey::ToUint32> forwardEntryIndex;
+		SimpleMutex forwardListMutex;
+		// Only used by the thread
+		ForwardEntry *timerWheel[2][TIMER_WHEEL_SLOTS];
+		uint32_t timerWheelTick;
+		SLNet::TimeMS timerWheelTime;
+		SLNet::LocklessUint32_t threadRunning;
+#if UDP_FORWARDER_USE_EPOLL==1
+		int epollFd;
+		// Written to by StartForwarding() and StopForwarding() to wake the thread
+		int wakeupFd;
+#endif
+	};
+
+	void UpdateUDPForwarder(ForwarderThread *forwarderThread);
+	void AddForwardEntry(ForwarderThread *forwarderThread, ForwardEntry *forwardEntry, SLNet::TimeMS curTime);
+	void RemoveForwardEntry(ForwarderThread *forwarderThread, ForwardEntry *forwardEntry);
+	/// Schedule the timeout check of \a forwardEntry \a delayMS from now
+	static void AddToTimerWheel(ForwarderThread *forwarderThread, ForwardEntry *forwardEntry, SLNet::TimeMS delayMS);
+	static void RemoveFromTimerWheel(ForwardEntry *forwardEntry);
+	/// Remove the entries that timed out since the last call
+	void UpdateTimerWheel(ForwarderThread *forwarderThread, SLNet::TimeMS curTime);
+	void RecvFrom(SLNet::TimeMS curTime, ForwardEntry *forwardEntry);
+#if UDP_FORWARDER_USE_EPOLL==1
+	/// Receive and forward the datagrams waiting on \a forwardEntry in batches with recvmmsg() and sendmmsg()
+	void RecvFromBatched(SLNet::TimeMS curTime, ForwardEntry *forwardEntry);
+#endif
+	/// Which address a datagram from \a receivedAddr is forwarded to. Confirms the sender's port on the first datagram.
+	/// \return false to drop the datagram
+	static bool GetForwardTarget(ForwardEntry *forwardEntry, const SystemAddress &receivedAddr, SystemAddress *forwardTarget);
+	ForwarderThread* GetForwarderThread(const SystemAddress &source, const SystemAddress &destination);
+	void WakeForwarderThread(ForwarderThread *forwarderThread);
+
+	ForwarderThread *forwarderThreads;
+	unsigned int forwarderThreadsLength;
+	unsigned int numThreads;
 
 	unsigned short maxForwardEntries;
-	SLNet::LocklessUint32_t isRunning, threadRunning;
+	SLNet::LocklessUint32_t isRunning, usedForwardEntries;
 
 };
 
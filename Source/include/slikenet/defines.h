@@ -202,6 +202,24 @@
 #define USE_ALLOCA 1
 #endif
 
+// If defined to 1, TCPInterface waits for socket events with epoll instead of select.
+// epoll uses non-blocking sockets and is not limited to FD_SETSIZE connections. Only available on Linux, where it can be enabled with -DTCP_INTERFACE_USE_EPOLL=1.
+#ifndef TCP_INTERFACE_USE_EPOLL
+#define TCP_INTERFACE_USE_EPOLL 0
+#endif
+
+// If defined to 1, UDPForwarder waits for datagrams with epoll and relays them in batches with recvmmsg and sendmmsg.
+// Otherwise each forwarding socket is polled with a non-blocking recvfrom. Only available on Linux, where it can be enabled with -DUDP_FORWARDER_USE_EPOLL=1.
+#ifndef UDP_FORWARDER_USE_EPOLL
+#define UDP_FORWARDER_USE_EPOLL 0
+#endif
+
+// If defined to 1, ThreadPool hands input to its threads with TPS_WORK_STEALING instead of TPS_SHARED_QUEUE,
+// unless ThreadPool::SetScheduling() is called. Lets existing users of ThreadPool use work stealing without code changes.
+#ifndef THREADPOOL_USE_WORK_STEALING
+#define THREADPOOL_USE_WORK_STEALING 0
+#endif
+
 //#define USE_THREADED_SEND
 
 // @since 0.1.1: added
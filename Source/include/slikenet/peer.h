@@ -41,6 +41,7 @@
 #include "SecureHandshake.h"
 #include "LocklessTypes.h"
 #include "DS_Queue.h"
+#include "ThreadPool.h"
 
 namespace SLNet {
 /// Forward declarations
@@ -97,6 +98,25 @@ public:
 	/// \note Must be called while offline
 	void DisableSecurity( void );
 
+	/// Sets the cipher suites secure connections may use, in order of preference
+	/// \details A connecting system offers its cipher suites, and the system accepting the connection uses the first of its own cipher suites that was offered.
+	/// CIPHER_SUITE_CALICO is used if there is no match, or if the remote system does not negotiate cipher suites. If it is left out, such connections fail instead. Suites the OpenSSL library in use does not implement are skipped.
+	/// The proof of the key sent by the connecting system covers the offered and the chosen suites, so connections fail rather than fall back to another suite if either was changed on the way.
+	/// Defaults to CIPHER_SUITE_AES_128_GCM, CIPHER_SUITE_CHACHA20_POLY1305, CIPHER_SUITE_CALICO.
+	/// \note Must be called while offline
+	/// \pre LIBCAT_SECURITY must be defined to 1 in NativeFeatureIncludes.h for this function to have any effect
+	/// \param[in] cipherSuites Cipher suites in order of preference
+	/// \param[in] numCipherSuites Number of elements in \a cipherSuites
+	void SetCipherSuites( const CipherSuite *cipherSuites, unsigned int numCipherSuites );
+
+	/// Sets how many threads run the key agreement of incoming secure connections
+	/// \details With 0 threads, the default, the key agreement runs on the network thread while it processes the connection request, delaying the updates of all other connections.
+	/// Otherwise it is handed to a pool of \a numThreads threads, and the connection continues once the result comes back.
+	/// \note Must be called while offline
+	/// \pre LIBCAT_SECURITY must be defined to 1 in NativeFeatureIncludes.h for this function to have any effect
+	/// \param[in] numThreads Number of threads, or 0 to run the key agreement on the network thread
+	void SetHandshakeThreads( unsigned int numThreads );
+
 	/// \brief This is useful if you have a fixed-address internal server behind a LAN.
 	///
 	///  Secure connections are determined by the recipient of an incoming connection. This has no effect if called on the system attempting to connect.	
@@ -631,6 +651,11 @@ public:
 	/// \Returns how many messages are waiting when you call Receive()
 	virtual unsigned int GetReceiveBufferSize(void);
 
+	/// \brief Returns how many packets were allocated since this instance was created, and how they were allocated
+	/// \details Messages received from connected systems are stored in one allocation with their packet. Other packets are taken from a pool and allocate their data separately.
+	/// \param[out] statistics Written to
+	virtual void GetPacketAllocationStatistics(PacketAllocationStatistics *statistics);
+
 	// --------------------------------------------------------------------------------------------EVERYTHING AFTER THIS COMMENT IS FOR INTERNAL USE ONLY--------------------------------------------------------------------------------------------
 
 
@@ -693,6 +718,11 @@ public:
 		// If the server has bRequireClientKey = true, then this is set to the validated public key of the connected client
 		// Valid after connectMode reaches HANDLING_CONNECTION_REQUEST
 		char client_public_key[cat::EasyHandshake::PUBLIC_KEY_BYTES];
+
+		// True while the key agreement runs on handshakeThreadPool. ID_OPEN_CONNECTION_REPLY_2 is sent once it completes.
+		bool handshakePending;
+		// Cipher suites offered in ID_OPEN_CONNECTION_REQUEST_2, 0 if the remote system does not negotiate cipher suites. The proof of its key must cover them.
+		unsigned char remoteCipherSuiteMask;
 #endif
 
 		enum ConnectMode {NO_ACTION, DISCONNECT_ASAP, DISCONNECT_ASAP_SILENTLY, DISCONNECT_ON_NO_ACK, REQUESTED_CONNECTION, HANDLING_CONNECTION_REQUEST, UNVERIFIED_SENDER, CONNECTED} connectMode;
@@ -997,11 +1027,15 @@ protected:
 
 	SimpleMutex packetAllocationPoolMutex;
 	DataStructures::MemoryPool<Packet> packetAllocationPool;
+	// Counters returned by GetPacketAllocationStatistics()
+	SLNet::LocklessUint32_t packetsBehindDataCount, pooledPacketCount;
 
 	SimpleMutex packetReturnMutex;
 	DataStructures::Queue<Packet*> packetReturnQueue;
 	Packet *AllocPacket(unsigned dataSize, const char *file, unsigned int line);
 	Packet *AllocPacket(unsigned dataSize, unsigned char *data, const char *file, unsigned int line);
+	// Constructs the packet in packetMemory, which is in the same allocation as data, if not 0
+	Packet *AllocPacket(unsigned dataSize, unsigned char *data, void *packetMemory, const char *file, unsigned int line);
 
 	/// This is used to return a number to the user when they call Send identifying the message
 	/// This number will be returned back with ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS and is only returned
@@ -1019,6 +1053,47 @@ protected:
 	cat::ServerEasyHandshake *_server_handshake;
 	cat::CookieJar *_cookie_jar;
 	bool InitializeClientSecurity(RequestedConnectionStruct *rcs, const char *public_key);
+	// Set with SetCipherSuites(), in order of preference
+	CipherSuite cipherSuites[CIPHER_SUITE_COUNT];
+	unsigned int numCipherSuites;
+	// Bit mask of cipherSuites, as offered in ID_OPEN_CONNECTION_REQUEST_2
+	unsigned char GetCipherSuiteMask(void) const;
+	// First of cipherSuites in remoteCipherSuiteMask, or CIPHER_SUITE_CALICO
+	CipherSuite ChooseCipherSuite(unsigned char remoteCipherSuiteMask) const;
+	// If cipherSuite is one of cipherSuites
+	bool IsCipherSuiteAllowed(unsigned char cipherSuite) const;
+
+	// Kept so that each thread of handshakeThreadPool can initialize its own cat::ServerEasyHandshake, which is not thread-safe
+	char my_private_key[cat::EasyHandshake::PRIVATE_KEY_BYTES];
+	// Set with SetHandshakeThreads()
+	unsigned int numHandshakeThreads;
+	// Key agreement of one incoming connection, run on handshakeThreadPool
+	struct HandshakeJob
+	{
+		RakPeer *rakPeer;
+		SystemAddress systemAddress;
+		RakNetGUID guid;
+		uint16_t mtu;
+		unsigned char remoteCipherSuiteMask;
+		char challenge[cat::EasyHandshake::CHALLENGE_BYTES];
+		char answer[cat::EasyHandshake::ANSWER_BYTES];
+		cat::AuthenticatedEncryption authenticatedEncryption;
+		bool success;
+	};
+	// Creates the cat::ServerEasyHandshake of each thread of handshakeThreadPool. The context is the RakPeer instance.
+	class HandshakeThreadData : public ThreadDataInterface
+	{
+	public:
+		virtual void* PerThreadFactory(void *context);
+		virtual void PerThreadDestructor(void* factoryResult, void *context);
+	};
+	HandshakeThreadData handshakeThreadData;
+	ThreadPool<HandshakeJob*,HandshakeJob*> handshakeThreadPool;
+	static HandshakeJob* ProcessHandshakeJob(HandshakeJob *job, bool *returnOutput, void* perThreadData);
+	// Sends ID_OPEN_CONNECTION_REPLY_2 for the completed jobs of handshakeThreadPool
+	void CompleteHandshakeJobs(void);
+	// Stops handshakeThreadPool and deletes the jobs that did not complete
+	void StopHandshakeThreads(void);
 #endif
 
 
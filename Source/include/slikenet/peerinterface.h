@@ -83,6 +83,25 @@ public:
 	/// \note Must be called while offline
 	virtual void DisableSecurity( void )=0;
 
+	/// Sets the cipher suites secure connections may use, in order of preference
+	/// \details A connecting system offers its cipher suites, and the system accepting the connection uses the first of its own cipher suites that was offered.
+	/// CIPHER_SUITE_CALICO is used if there is no match, or if the remote system does not negotiate cipher suites. If it is left out, such connections fail instead. Suites the OpenSSL library in use does not implement are skipped.
+	/// The proof of the key sent by the connecting system covers the offered and the chosen suites, so connections fail rather than fall back to another suite if either was changed on the way.
+	/// Defaults to CIPHER_SUITE_AES_128_GCM, CIPHER_SUITE_CHACHA20_POLY1305, CIPHER_SUITE_CALICO.
+	/// \note Must be called while offline
+	/// \pre LIBCAT_SECURITY must be defined to 1 in NativeFeatureIncludes.h for this function to have any effect
+	/// \param[in] cipherSuites Cipher suites in order of preference
+	/// \param[in] numCipherSuites Number of elements in \a cipherSuites
+	virtual void SetCipherSuites( const CipherSuite *cipherSuites, unsigned int numCipherSuites )=0;
+
+	/// Sets how many threads run the key agreement of incoming secure connections
+	/// \details With 0 threads, the default, the key agreement runs on the network thread while it processes the connection request, delaying the updates of all other connections.
+	/// Otherwise it is handed to a pool of \a numThreads threads, and the connection continues once the result comes back.
+	/// \note Must be called while offline
+	/// \pre LIBCAT_SECURITY must be defined to 1 in NativeFeatureIncludes.h for this function to have any effect
+	/// \param[in] numThreads Number of threads, or 0 to run the key agreement on the network thread
+	virtual void SetHandshakeThreads( unsigned int numThreads )=0;
+
 	/// If secure connections are on, do not use secure connections for a specific IP address.
 	/// This is useful if you have a fixed-address internal server behind a LAN.
 	/// \note Secure connections are determined by the recipient of an incoming connection. This has no effect if called on the system attempting to connect.
@@ -595,6 +614,11 @@ public:
 	/// \Returns how many messages are waiting when you call Receive()
 	virtual unsigned int GetReceiveBufferSize(void)=0;
 
+	/// \brief Returns how many packets were allocated since this instance was created, and how they were allocated
+	/// \details Messages received from connected systems are stored in one allocation with their packet. Other packets are taken from a pool and allocate their data separately.
+	/// \param[out] statistics Written to
+	virtual void GetPacketAllocationStatistics(PacketAllocationStatistics *statistics)=0;
+
 	// --------------------------------------------------------------------------------------------EVERYTHING AFTER THIS COMMENT IS FOR INTERNAL USE ONLY--------------------------------------------------------------------------------------------
 	
 	/// \internal
@@ -40,6 +40,14 @@ namespace SLNet
 #define RAK_THREAD_DECLARATION(functionName) void* functionName( void* arguments )
 #endif
 
+/// Storage class for a static variable with one instance per thread. Only for types without constructors, initialized with constants.
+/// thread_local is not available with all compilers the library supports.
+#if defined(_MSC_VER)
+#define RAK_THREAD_LOCAL __declspec(thread)
+#else
+#define RAK_THREAD_LOCAL __thread
+#endif
+
 class RAK_DLL_EXPORT RakThread
 {
 public:
@@ -64,6 +72,14 @@ public:
 #else
 	static int Create( void* start_address( void* ), void *arglist, int priority=0);
 #endif
+
+	/// Binds the calling thread to one processor
+	/// \param[in] processor Index of the processor, from 0 to GetNumberOfProcessors()-1
+	/// \return false if the platform does not support it, or on failure
+	static bool SetAffinity(int processor);
+
+	/// \return The number of processors currently online, at least 1
+	static int GetNumberOfProcessors(void);
 };
 
 }
@@ -119,6 +119,21 @@ enum PublicKeyMode
 	PKM_USE_TWO_WAY_AUTHENTICATION
 };
 
+/// Ciphers for the datagrams of secure connections. Passed to RakPeerInterface::SetCipherSuites()
+enum CipherSuite
+{
+	/// 12-round ChaCha with a truncated HMAC-MD5, from libcat. Used with systems that do not negotiate a cipher suite.
+	CIPHER_SUITE_CALICO,
+
+	/// AES-128 in GCM mode from OpenSSL, which uses the AES instructions of the CPU where available
+	CIPHER_SUITE_AES_128_GCM,
+
+	/// ChaCha20-Poly1305 from OpenSSL. Faster than AES-128-GCM on CPUs without AES instructions.
+	CIPHER_SUITE_CHACHA20_POLY1305,
+
+	CIPHER_SUITE_COUNT
+};
+
 /// Passed to RakPeerInterface::Connect()
 struct RAK_DLL_EXPORT PublicKey
 {
@@ -431,6 +446,20 @@ struct Packet
 	/// @internal
 	/// If true, this message is meant for the user, not for the plugins, so do not process it through plugins
 	bool wasGeneratedLocally;
+
+	/// @internal
+	/// If true, this packet is stored behind its data in the same allocation, and is freed with the data
+	bool isBehindData;
+};
+
+/// Counts of packets allocated by RakPeer, returned by RakPeerInterface::GetPacketAllocationStatistics()
+/// The counters wrap around at 2^32
+struct RAK_DLL_EXPORT PacketAllocationStatistics
+{
+	/// Packets stored behind their data, in the allocation made when the message was received. This takes one allocation per packet.
+	unsigned int packetsBehindData;
+	/// Packets taken from the packet pool, under a mutex. Their data is allocated separately, so this takes two allocations per packet.
+	unsigned int pooledPackets;
 };
 
 ///  Index of an unassigned player
@@ -0,0 +1,278 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "slikenet/NativeFeatureIncludes.h"
+#if LIBCAT_SECURITY==1
+
+#include "slikenet/AeadEncryption.h"
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#include "slikenet/slikeAssert.h"
+#include <string.h>
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L && !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+#define AEAD_ENCRYPTION_CHACHA20_POLY1305
+#endif
+
+#ifndef EVP_CTRL_AEAD_SET_TAG
+#define EVP_CTRL_AEAD_SET_TAG EVP_CTRL_GCM_SET_TAG
+#define EVP_CTRL_AEAD_GET_TAG EVP_CTRL_GCM_GET_TAG
+#endif
+
+using namespace SLNet;
+
+static const EVP_CIPHER* GetCipher(CipherSuite cipherSuite)
+{
+	switch (cipherSuite)
+	{
+	case CIPHER_SUITE_AES_128_GCM:
+		return EVP_aes_128_gcm();
+#ifdef AEAD_ENCRYPTION_CHACHA20_POLY1305
+	case CIPHER_SUITE_CHACHA20_POLY1305:
+		return EVP_chacha20_poly1305();
+#endif
+	default:
+		return 0;
+	}
+}
+
+// Derives the little endian 64-bit IV the same way on all platforms
+static bool GenerateIV(cat::AuthenticatedEncryption *authenticatedEncryption, bool local, const char *keyName, uint64_t &iv)
+{
+	cat::u8 bytes[8];
+	if (!authenticatedEncryption->GenerateKey(local, keyName, bytes, sizeof(bytes)))
+		return false;
+	iv=0;
+	for (int i=7; i >= 0; i--)
+		iv=(iv << 8) | bytes[i];
+	return true;
+}
+
+AeadEncryption::AeadEncryption()
+{
+	cipherSuite=CIPHER_SUITE_CALICO;
+	localContext=0;
+	remoteContext=0;
+	localIV=0;
+	remoteIV=0;
+	memset(ivBitmap, 0, sizeof(ivBitmap));
+}
+
+AeadEncryption::~AeadEncryption()
+{
+	Clear();
+}
+
+bool AeadEncryption::IsSupported(CipherSuite cipherSuite)
+{
+	return GetCipher(cipherSuite)!=0;
+}
+
+bool AeadEncryption::SetKey(CipherSuite _cipherSuite, cat::AuthenticatedEncryption *authenticatedEncryption)
+{
+	Clear();
+
+	const EVP_CIPHER *cipher = GetCipher(_cipherSuite);
+	if (cipher==0)
+		return false;
+
+	// Labels differ between the suites, so the keys do as well
+	const char *keyName, *saltName, *ivName;
+	if (_cipherSuite==CIPHER_SUITE_AES_128_GCM)
+	{
+		keyName="AES-128-GCM-key";
+		saltName="AES-128-GCM-salt";
+		ivName="AES-128-GCM-IV";
+	}
+	else
+	{
+		keyName="ChaCha20-Poly1305-key";
+		saltName="ChaCha20-Poly1305-salt";
+		ivName="ChaCha20-Poly1305-IV";
+	}
+
+	cat::u8 localKey[32], remoteKey[32];
+	const int keyBytes = EVP_CIPHER_key_length(cipher);
+	RakAssert(keyBytes <= (int) sizeof(localKey));
+	bool success =
+		authenticatedEncryption->GenerateKey(true, keyName, localKey, keyBytes) &&
+		authenticatedEncryption->GenerateKey(false, keyName, remoteKey, keyBytes) &&
+		authenticatedEncryption->GenerateKey(true, saltName, localSalt, SALT_BYTES) &&
+		authenticatedEncryption->GenerateKey(false, saltName, remoteSalt, SALT_BYTES) &&
+		GenerateIV(authenticatedEncryption, true, ivName, localIV) &&
+		GenerateIV(authenticatedEncryption, false, ivName, remoteIV);
+
+	if (success)
+	{
+		localContext=EVP_CIPHER_CTX_new();
+		remoteContext=EVP_CIPHER_CTX_new();
+
+		// The default nonce length of both ciphers is 12 bytes
+		success = localContext!=0 && remoteContext!=0 &&
+			EVP_EncryptInit_ex(localContext, cipher, 0, localKey, 0)==1 &&
+			EVP_DecryptInit_ex(remoteContext, cipher, 0, remoteKey, 0)==1;
+	}
+
+	memset(localKey, 0, sizeof(localKey));
+	memset(remoteKey, 0, sizeof(remoteKey));
+
+	if (success==false)
+	{
+		Clear();
+		return false;
+	}
+
+	memset(ivBitmap, 0, sizeof(ivBitmap));
+	cipherSuite=_cipherSuite;
+	return true;
+}
+
+void AeadEncryption::Clear(void)
+{
+	if (localContext)
+		EVP_CIPHER_CTX_free(localContext);
+	if (remoteContext)
+		EVP_CIPHER_CTX_free(remoteContext);
+	localContext=0;
+	remoteContext=0;
+	cipherSuite=CIPHER_SUITE_CALICO;
+}
+
+void AeadEncryption::GetNonce(const unsigned char salt[SALT_BYTES], uint64_t iv, unsigned char nonce[12])
+{
+	memcpy(nonce, salt, SALT_BYTES);
+	for (int i=0; i < 8; i++)
+		nonce[SALT_BYTES+i]=(unsigned char)(iv >> (8*i));
+}
+
+bool AeadEncryption::IsValidIV(uint64_t iv) const
+{
+	// Check how far in the past this IV is
+	int delta = (int)(remoteIV - iv);
+
+	// Unlike cat::AuthenticatedEncryption, out of order datagrams are always accepted
+	if (delta >= 0)
+	{
+		if (delta >= BITMAP_BITS)
+			return false;
+
+		// If it was seen, abort
+		if (ivBitmap[delta >> 6] & ((uint64_t)1 << (delta & 63)))
+			return false;
+	}
+
+	return true;
+}
+
+void AeadEncryption::AcceptIV(uint64_t iv)
+{
+	// Check how far in the past/future this IV is
+	int delta = (int)(iv - remoteIV);
+
+	if (delta > 0)
+	{
+		// If it would shift out everything we have seen,
+		if (delta >= BITMAP_BITS)
+		{
+			memset(ivBitmap, 0, sizeof(ivBitmap));
+			ivBitmap[0] = 1;
+		}
+		else
+		{
+			int wordShift = delta >> 6;
+			int bitShift = delta & 63;
+
+			// Shift replay window
+			uint64_t last = ivBitmap[BITMAP_WORDS - 1 - wordShift];
+			for (int i = BITMAP_WORDS - 1; i >= wordShift + 1; --i)
+			{
+				uint64_t x = ivBitmap[i - wordShift - 1];
+				// A shift by 64 is undefined, so handle bitShift 0 separately
+				ivBitmap[i] = bitShift==0 ? last : (last << bitShift) | (x >> (64-bitShift));
+				last = x;
+			}
+			ivBitmap[wordShift] = last << bitShift;
+
+			// Zero the words we skipped
+			for (int i = 0; i < wordShift; ++i)
+				ivBitmap[i] = 0;
+
+			// Set low bit for this IV
+			ivBitmap[0] |= 1;
+		}
+
+		remoteIV = iv;
+	}
+	else
+	{
+		// Set the bit in the bitmap for this out of order IV
+		delta = -delta;
+		ivBitmap[delta >> 6] |= (uint64_t)1 << (delta & 63);
+	}
+}
+
+bool AeadEncryption::Decrypt(unsigned char *buffer, unsigned int &bufferBytes)
+{
+	if (remoteContext==0 || bufferBytes < OVERHEAD_BYTES)
+		return false;
+
+	unsigned int messageBytes = bufferBytes - OVERHEAD_BYTES;
+	// overhead: tag(8 bytes) || truncated IV(3 bytes)
+	unsigned char *overhead = buffer + messageBytes;
+
+	// Reconstruct the full IV from its low bytes
+	cat::u32 truncatedIV = ((cat::u32)overhead[TAG_BYTES+2] << 16) | ((cat::u32)overhead[TAG_BYTES+1] << 8) | (cat::u32)overhead[TAG_BYTES];
+	uint64_t iv = cat::ReconstructCounter<IV_BYTES*8>(remoteIV, truncatedIV);
+
+	if (!IsValidIV(iv))
+		return false;
+
+	unsigned char nonce[12];
+	GetNonce(remoteSalt, iv, nonce);
+
+	int outBytes, finalBytes;
+	if (EVP_DecryptInit_ex(remoteContext, 0, 0, 0, nonce)!=1 ||
+		EVP_CIPHER_CTX_ctrl(remoteContext, EVP_CTRL_AEAD_SET_TAG, TAG_BYTES, overhead)!=1 ||
+		EVP_DecryptUpdate(remoteContext, buffer, &outBytes, buffer, (int) messageBytes)!=1 ||
+		EVP_DecryptFinal_ex(remoteContext, buffer + outBytes, &finalBytes)!=1)
+		return false;
+
+	AcceptIV(iv);
+
+	bufferBytes = messageBytes;
+	return true;
+}
+
+bool AeadEncryption::Encrypt(unsigned char *buffer, unsigned int bufferBytes, unsigned int &messageBytes)
+{
+	if (localContext==0 || messageBytes + OVERHEAD_BYTES > bufferBytes)
+		return false;
+
+	unsigned char *overhead = buffer + messageBytes;
+
+	// Outgoing IV increments by one each time
+	uint64_t iv = ++localIV;
+
+	unsigned char nonce[12];
+	GetNonce(localSalt, iv, nonce);
+
+	int outBytes, finalBytes;
+	if (EVP_EncryptInit_ex(localContext, 0, 0, 0, nonce)!=1 ||
+		EVP_EncryptUpdate(localContext, buffer, &outBytes, buffer, (int) messageBytes)!=1 ||
+		EVP_EncryptFinal_ex(localContext, buffer + outBytes, &finalBytes)!=1 ||
+		EVP_CIPHER_CTX_ctrl(localContext, EVP_CTRL_AEAD_GET_TAG, TAG_BYTES, overhead)!=1)
+		return false;
+
+	overhead[TAG_BYTES] = (unsigned char) iv;
+	overhead[TAG_BYTES+1] = (unsigned char) (iv >> 8);
+	overhead[TAG_BYTES+2] = (unsigned char) (iv >> 16);
+
+	messageBytes += OVERHEAD_BYTES;
+	return true;
+}
+
+#endif // LIBCAT_SECURITY
@@ -33,6 +33,10 @@ int SLNet::CloudKeyComp(const CloudKey &key, const CloudKey &data)
 		return 1;
 	return 0;
 }
+unsigned long CloudKey::ToUint32(const CloudKey &key)
+{
+	return RakString::ToInteger(key.primaryKey)*31+key.secondaryKey;
+}
 
 CloudQueryRow* CloudAllocator::AllocateCloudQueryRow(void)
 {
@@ -32,10 +32,23 @@ enum ServerToServerCommands
 	STSC_REMOVE_UPLOADED_KEY,
 	STSC_REMOVE_SUBSCRIBED_KEY,
 	STSC_DATA_CHANGED,
+	STSC_SHARD_POST,
+	STSC_SHARD_RELEASE,
 };
 
 using namespace SLNet;
 
+// Spreads similar hash values over the whole ring (MurmurHash3 finalizer)
+static uint32_t ShardHash(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
 int CloudServer::RemoteServerComp(const RakNetGUID &key, RemoteServer* const &data )
 {
 	if (key < data->serverAddress)
@@ -64,15 +77,15 @@ int CloudServer::KeyDataPtrComp( const RakNetGUID &key, CloudData* const &data )
 		return 1;
 	return 0;
 }
-int CloudServer::KeyDataListComp( const CloudKey &key, CloudDataList * const &data )
+unsigned long CloudServer::PendingNotificationKey::ToUint32(const PendingNotificationKey &pendingNotificationKey)
 {
-	if (key.primaryKey < data->key.primaryKey)
-		return -1;
-	if (key.primaryKey > data->key.primaryKey)
-		return 1;
-	if (key.secondaryKey < data->key.secondaryKey)
+	return CloudKey::ToUint32(pendingNotificationKey.key)*31+RakNetGUID::ToUint32(pendingNotificationKey.clientGUID);
+}
+int CloudServer::ShardRingNodeComp(const uint32_t &key, const ShardRingNode &data )
+{
+	if (key < data.position)
 		return -1;
-	if (key.secondaryKey > data->key.secondaryKey)
+	if (key > data.position)
 		return 1;
 	return 0;
 }
@@ -89,7 +102,7 @@ int CloudServer::GetRequestComp(const uint32_t &key, CloudServer::GetRequest* co
 	if (key < data->requestId)
 		return -1;
 	if (key > data->requestId)
-		return -1;
+		return 1;
 	return 0;
 }
 void CloudServer::CloudQueryWithAddresses::Serialize(bool writeToBitstream, BitStream *bitStream)
@@ -151,6 +164,8 @@ CloudServer::CloudServer()
 	maxBytesPerDowload=0;
 	nextGetRequestId=0;
 	nextGetRequestsCheck=0;
+	shardingEnabled=false;
+	shardVirtualNodes=64;
 }
 CloudServer::~CloudServer()
 {
@@ -166,6 +181,8 @@ void CloudServer::SetMaxBytesPerDownload(uint64_t bytes)
 }
 void CloudServer::Update(void)
 {
+	SendPendingNotifications();
+
 	// Timeout getRequests
 	SLNet::Time time = SLNet::Time();
 	if (time > nextGetRequestsCheck)
@@ -235,6 +252,12 @@ PluginReceiveResult CloudServer::OnReceive(Packet *packet)
 			case STSC_DATA_CHANGED:
 				OnServerDataChanged(packet);
 				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+			case STSC_SHARD_POST:
+				OnShardPost(packet);
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+			case STSC_SHARD_RELEASE:
+				OnShardRelease(packet);
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
 			}
 		}
 		return RR_STOP_PROCESSING_AND_DEALLOCATE;
@@ -279,36 +302,17 @@ void CloudServer::OnPostRequest(Packet *packet)
 	if (remoteSystemsHashIndex.IsInvalid())
 	{
 		remoteCloudClient = SLNet::OP_NEW<RemoteCloudClient>(_FILE_AND_LINE_);
-		remoteCloudClient->uploadedKeys.Insert(key,key,true,_FILE_AND_LINE_);
 		remoteCloudClient->uploadedBytes=0;
 		remoteSystems.Push(packet->guid, remoteCloudClient, _FILE_AND_LINE_);
 	}
 	else
 	{
 		remoteCloudClient = remoteSystems.ItemAtIndex(remoteSystemsHashIndex);
-		bool objectExists;
-		// Add to RemoteCloudClient::uploadedKeys if it isn't there already
-		unsigned int uploadedKeysIndex = remoteCloudClient->uploadedKeys.GetIndexFromKey(key,&objectExists);
-		if (objectExists==false)
-		{
-			remoteCloudClient->uploadedKeys.InsertAtIndex(key, uploadedKeysIndex, _FILE_AND_LINE_);
-		}
 	}
 
-	bool cloudDataAlreadyUploaded;
-	unsigned int dataRepositoryIndex;
 	bool dataRepositoryExists;
-	CloudDataList* cloudDataList = GetOrAllocateCloudDataList(key, &dataRepositoryExists, dataRepositoryIndex);
-	if (dataRepositoryExists==false)
-	{
-		cloudDataList->uploaderCount=1;
-		cloudDataAlreadyUploaded=false;
-	}
-	else
-	{
-		cloudDataAlreadyUploaded=cloudDataList->uploaderCount>0;
-		cloudDataList->uploaderCount++;
-	}
+	CloudDataList* cloudDataList = GetOrAllocateCloudDataList(key, &dataRepositoryExists);
+	bool cloudDataAlreadyUploaded=cloudDataList->uploaderCount>0;
 
 	CloudData *cloudData;
 	bool keyDataListExists;
@@ -318,11 +322,8 @@ void CloudServer::OnPostRequest(Packet *packet)
 		if (maxUploadBytesPerClient>0 && remoteCloudClient->uploadedBytes+dataLengthBytes>maxUploadBytesPerClient)
 		{
 			// Undo prior insertion of cloudDataList into cloudData if needed
-			if (keyDataListExists==false)
-			{
-				SLNet::OP_DELETE(cloudDataList,_FILE_AND_LINE_);
-				dataRepository.RemoveAtIndex(dataRepositoryIndex);
-			}
+			if (dataRepositoryExists==false)
+				DeleteCloudDataList(cloudDataList);
 
 			if (remoteCloudClient->IsUnused())
 			{
@@ -388,10 +389,17 @@ void CloudServer::OnPostRequest(Packet *packet)
 		{
 			// Undo prior insertion of cloudDataList into cloudData if needed
 			if (dataRepositoryExists==false)
+				DeleteCloudDataList(cloudDataList);
+
+			if (remoteCloudClient->IsUnused())
 			{
-				SLNet::OP_DELETE(cloudDataList,_FILE_AND_LINE_);
-				dataRepository.RemoveAtIndex(dataRepositoryIndex);
+				SLNet::OP_DELETE(remoteCloudClient, _FILE_AND_LINE_);
+				remoteSystems.Remove(packet->guid, _FILE_AND_LINE_);
 			}
+
+			if (dataLengthBytes>CLOUD_SERVER_DATA_STACK_SIZE)
+				rakFree_Ex(data, _FILE_AND_LINE_);
+
 			return;
 		}
 		else
@@ -420,8 +428,17 @@ void CloudServer::OnPostRequest(Packet *packet)
 	}
 	// Update how many bytes were written for this data
 	cloudData->dataLengthBytes=dataLengthBytes;
+	cloudData->isUploaded=true;
 	remoteCloudClient->uploadedBytes+=dataLengthBytes;
 
+	// Add to RemoteCloudClient::uploadedKeys if it isn't there already
+	if (cloudData->uploadedKeysIndex==(unsigned int) -1)
+	{
+		cloudData->uploadedKeysIndex=remoteCloudClient->uploadedKeys.Size();
+		remoteCloudClient->uploadedKeys.Push(key, _FILE_AND_LINE_);
+		cloudDataList->uploaderCount++;
+	}
+
 	if (cloudDataAlreadyUploaded==false)
 	{
 		// New data field
@@ -429,11 +446,11 @@ void CloudServer::OnPostRequest(Packet *packet)
 	}
 
 	// Existing data field changed
-	NotifyClientSubscribersOfDataChange(cloudData, cloudDataList->key, cloudData->specificSubscribers, true );
-	NotifyClientSubscribersOfDataChange(cloudData, cloudDataList->key, cloudDataList->nonSpecificSubscribers, true );
+	// Send update to all local clients and remote servers that subscribed to this key
+	QueueDataChangeNotification(cloudData, cloudDataList->key, true);
 
-	// Send update to all remote servers that subscribed to this key
-	NotifyServerSubscribersOfDataChange(cloudData, cloudDataList->key, true);
+	if (shardingEnabled && IsKeyOwner(key)==false)
+		SendShardPost(GetKeyOwner(key), cloudData, cloudDataList->key, false);
 
 	// I could have also subscribed to a key not yet updated locally
 	// This means I have to go through every RemoteClient that wants this key
@@ -479,28 +496,26 @@ void CloudServer::OnReleaseRequest(Packet *packet)
 		key=cloudKeys[keyCountIndex];
 
 		// Remove remote systems uploaded keys
-		bool objectExists;
-		unsigned int uploadedKeysIndex = remoteCloudClient->uploadedKeys.GetIndexFromKey(key,&objectExists);
-		if (objectExists)
-		{
-			bool dataRepositoryExists;
-			unsigned int dataRepositoryIndex = dataRepository.GetIndexFromKey(key, &dataRepositoryExists);
-			CloudDataList* cloudDataList = dataRepository[dataRepositoryIndex];
-			RakAssert(cloudDataList);
+		CloudDataList* cloudDataList = GetCloudDataList(key);
+		if (cloudDataList==0)
+			continue;
 
-			CloudData *cloudData;
-			bool keyDataListExists;
-			unsigned int keyDataListIndex = cloudDataList->keyData.GetIndexFromKey(packet->guid, &keyDataListExists);
-			cloudData = cloudDataList->keyData[keyDataListIndex];
+		CloudData *cloudData;
+		bool keyDataListExists;
+		unsigned int keyDataListIndex = cloudDataList->keyData.GetIndexFromKey(packet->guid, &keyDataListExists);
+		if (keyDataListExists==false)
+			continue;
+		cloudData = cloudDataList->keyData[keyDataListIndex];
 
-			remoteCloudClient->uploadedKeys.RemoveAtIndex(uploadedKeysIndex);
+		if (cloudData->uploadedKeysIndex!=(unsigned int) -1)
+		{
+			RemoveUploadedKey(remoteCloudClient, cloudData);
 			remoteCloudClient->uploadedBytes-=cloudData->dataLengthBytes;
 			cloudDataList->uploaderCount--;
 
 			// Broadcast destruction of this key to subscribers
-			NotifyClientSubscribersOfDataChange(cloudData, cloudDataList->key, cloudData->specificSubscribers, false );
-			NotifyClientSubscribersOfDataChange(cloudData, cloudDataList->key, cloudDataList->nonSpecificSubscribers, false );
-			NotifyServerSubscribersOfDataChange(cloudData, cloudDataList->key, false );
+			QueueDataChangeNotification(cloudData, cloudDataList->key, false);
+			SendShardRelease(cloudDataList->key, packet->guid);
 
 			cloudData->Clear();
 
@@ -515,10 +530,7 @@ void CloudServer::OnReleaseRequest(Packet *packet)
 				}
 
 				if (cloudDataList->IsUnused())
-				{
-					SLNet::OP_DELETE(cloudDataList, _FILE_AND_LINE_);
-					dataRepository.RemoveAtIndex(dataRepositoryIndex);
-				}
+					DeleteCloudDataList(cloudDataList);
 			}
 
 			if (remoteCloudClient->IsUnused())
@@ -639,9 +651,8 @@ void CloudServer::OnGetRequest(Packet *packet)
 			remoteCloudClient->subscribedKeys.InsertAtIndex(keySubscriberId, keySubscriberIndex, _FILE_AND_LINE_);
 
 			// Add CloudData in a similar way
-			unsigned int dataRepositoryIndex;
 			bool dataRepositoryExists;
-			CloudDataList* cloudDataList = GetOrAllocateCloudDataList(cloudKey, &dataRepositoryExists, dataRepositoryIndex);
+			CloudDataList* cloudDataList = GetOrAllocateCloudDataList(cloudKey, &dataRepositoryExists);
 
 			// If this is the first local client to subscribe to this key, call SendSubscribedKeyToServers
 			if (cloudDataList->subscriberCount==0)
@@ -756,19 +767,12 @@ void CloudServer::OnUnsubscribeRequest(Packet *packet)
 			return;
 	}
 
-//	CloudDataList *cloudDataList;
-	bool dataRepositoryExists;
-//	unsigned int dataRepositoryIndex;
-
 	for (index=0; index < keyCount; index++)
 	{
 		cloudKey = cloudKeys[index];
 
-	//	dataRepositoryIndex = 
-			dataRepository.GetIndexFromKey(cloudKey, &dataRepositoryExists);
-		if (dataRepositoryExists==false)
+		if (GetCloudDataList(cloudKey)==0)
 			continue;
-//		cloudDataList = dataRepository[dataRepositoryIndex];
 
 		unsigned int keySubscriberIndex;
 		bool hasKeySubscriber;
@@ -904,6 +908,8 @@ void CloudServer::OnClosedConnection(const SystemAddress &systemAddress, RakNetG
 
 		SLNet::OP_DELETE(remoteServers[remoteServerIndex],_FILE_AND_LINE_);
 		remoteServers.RemoveAtIndex(remoteServerIndex);
+
+		UpdateShardRing(rakNetGUID);
 	}
 
 	DataStructures::HashIndex remoteSystemIndex = remoteSystems.GetIndexOf(rakNetGUID);
@@ -914,21 +920,19 @@ void CloudServer::OnClosedConnection(const SystemAddress &systemAddress, RakNetG
 		for (uploadedKeysIndex=0; uploadedKeysIndex < remoteCloudClient->uploadedKeys.Size(); uploadedKeysIndex++)
 		{
 			// Delete keys this system has uploaded
-			bool keyDataRepositoryExists;
-			unsigned int dataRepositoryIndex = dataRepository.GetIndexFromKey(remoteCloudClient->uploadedKeys[uploadedKeysIndex], &keyDataRepositoryExists);
-			if (keyDataRepositoryExists)
+			CloudDataList* cloudDataList = GetCloudDataList(remoteCloudClient->uploadedKeys[uploadedKeysIndex]);
+			if (cloudDataList)
 			{
-				CloudDataList* cloudDataList = dataRepository[dataRepositoryIndex];
 				bool keyDataExists;
 				unsigned int keyDataIndex = cloudDataList->keyData.GetIndexFromKey(rakNetGUID, &keyDataExists);
 				if (keyDataExists)
 				{
 					CloudData *cloudData = cloudDataList->keyData[keyDataIndex];
+					cloudData->uploadedKeysIndex=(unsigned int) -1;
 					cloudDataList->uploaderCount--;
 
-					NotifyClientSubscribersOfDataChange(cloudData, cloudDataList->key, cloudData->specificSubscribers, false );
-					NotifyClientSubscribersOfDataChange(cloudData, cloudDataList->key, cloudDataList->nonSpecificSubscribers, false );
-					NotifyServerSubscribersOfDataChange(cloudData, cloudDataList->key, false );
+					QueueDataChangeNotification(cloudData, cloudDataList->key, false);
+					SendShardRelease(cloudDataList->key, rakNetGUID);
 
 					cloudData->Clear();
 
@@ -948,8 +952,7 @@ void CloudServer::OnClosedConnection(const SystemAddress &systemAddress, RakNetG
 							// Tell other servers that this key is no longer uploaded, so they do not request it from us
 							RemoveUploadedKeyFromServers(cloudDataList->key);
 
-							SLNet::OP_DELETE(cloudDataList, _FILE_AND_LINE_);
-							dataRepository.RemoveAtIndex(dataRepositoryIndex);
+							DeleteCloudDataList(cloudDataList);
 						}
 					}
 				}
@@ -962,11 +965,9 @@ void CloudServer::OnClosedConnection(const SystemAddress &systemAddress, RakNetG
 			KeySubscriberID* keySubscriberId;
 			keySubscriberId = remoteCloudClient->subscribedKeys[subscribedKeysIndex];
 
-			bool keyDataRepositoryExists;
-			unsigned int keyDataRepositoryIndex = dataRepository.GetIndexFromKey(remoteCloudClient->subscribedKeys[subscribedKeysIndex]->key, &keyDataRepositoryExists);
-			if (keyDataRepositoryExists)
+			CloudDataList* cloudDataList = GetCloudDataList(keySubscriberId->key);
+			if (cloudDataList)
 			{
-				CloudDataList* cloudDataList = dataRepository[keyDataRepositoryIndex];
 				if (keySubscriberId->specificSystemsSubscribedTo.Size()==0)
 				{
 					cloudDataList->nonSpecificSubscribers.Remove(rakNetGUID);
@@ -1015,6 +1016,9 @@ void CloudServer::Clear(void)
 		SLNet::OP_DELETE(cloudDataList, _FILE_AND_LINE_);
 	}
 	dataRepository.Clear(false, _FILE_AND_LINE_);
+	dataRepositoryIndex.Clear(_FILE_AND_LINE_);
+	ClearPendingNotifications();
+	shardRing.Clear(false, _FILE_AND_LINE_);
 
 	for (i=0; i < remoteServers.Size(); i++)
 	{
@@ -1121,12 +1125,117 @@ void CloudServer::NotifyServerSubscribersOfDataChange( CloudData *cloudData, Clo
 	unsigned int i;
 	for (i=0; i < remoteServers.Size(); i++)
 	{
-		if (remoteServers[i]->gotSubscribedAndUploadedKeys==false || remoteServers[i]->subscribedKeys.HasData(key))
+		if (shardingEnabled)
+		{
+			// Only the owner of a key notifies other servers. The server the data was uploaded through already notified its own clients.
+			if (remoteServers[i]->subscribedKeys.HasData(key) && remoteServers[i]->serverAddress!=cloudData->serverGUID)
+				SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, remoteServers[i]->serverAddress, false);
+		}
+		else if (remoteServers[i]->gotSubscribedAndUploadedKeys==false || remoteServers[i]->subscribedKeys.HasData(key))
 		{
 			SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, remoteServers[i]->serverAddress, false);
 		}
 	}
 }
+void CloudServer::QueueDataChangeNotification( CloudData *cloudData, CloudKey &key, bool wasUpdated )
+{
+	PendingNotificationKey pendingNotificationKey(key, cloudData->clientGUID);
+	PendingNotification *pendingNotification;
+	PendingNotification **existingNotification = pendingNotificationIndex.Peek(pendingNotificationKey);
+	if (existingNotification==0)
+	{
+		pendingNotification = SLNet::OP_NEW<PendingNotification>(_FILE_AND_LINE_);
+		pendingNotification->pendingNotificationKey=pendingNotificationKey;
+		pendingNotification->releasedData=0;
+		pendingNotifications.Push(pendingNotification, _FILE_AND_LINE_);
+		pendingNotificationIndex.Push(pendingNotificationKey, pendingNotification, _FILE_AND_LINE_);
+	}
+	else
+	{
+		// Only the last change is sent
+		pendingNotification=*existingNotification;
+		if (pendingNotification->releasedData)
+		{
+			SLNet::OP_DELETE(pendingNotification->releasedData, _FILE_AND_LINE_);
+			pendingNotification->releasedData=0;
+		}
+	}
+	pendingNotification->wasUpdated=wasUpdated;
+
+	if (wasUpdated==false)
+	{
+		// Keep the released row, as the caller clears cloudData right after this
+		CloudData *releasedData = SLNet::OP_NEW<CloudData>(_FILE_AND_LINE_);
+		releasedData->dataLengthBytes=cloudData->dataLengthBytes;
+		releasedData->isUploaded=false;
+		if (cloudData->allocatedData!=0 && cloudData->dataPtr==cloudData->allocatedData)
+		{
+			// Take over the allocation instead of copying it
+			releasedData->allocatedData=cloudData->allocatedData;
+			releasedData->dataPtr=cloudData->allocatedData;
+			cloudData->allocatedData=0;
+			cloudData->dataPtr=0;
+		}
+		else
+		{
+			releasedData->allocatedData=0;
+			releasedData->dataPtr=releasedData->stackData;
+			if (cloudData->dataLengthBytes>0)
+				memcpy(releasedData->stackData, cloudData->dataPtr, cloudData->dataLengthBytes);
+		}
+		releasedData->serverSystemAddress=cloudData->serverSystemAddress;
+		releasedData->clientSystemAddress=cloudData->clientSystemAddress;
+		releasedData->serverGUID=cloudData->serverGUID;
+		releasedData->clientGUID=cloudData->clientGUID;
+		pendingNotification->releasedData=releasedData;
+	}
+}
+void CloudServer::SendPendingNotifications(void)
+{
+	unsigned int i;
+	for (i=0; i < pendingNotifications.Size(); i++)
+	{
+		PendingNotification *pendingNotification = pendingNotifications[i];
+		CloudKey &key = pendingNotification->pendingNotificationKey.key;
+
+		// Subscribers are looked up now, so systems that subscribed or unsubscribed during the tick are accounted for
+		CloudData *cloudData=0;
+		CloudDataList *cloudDataList = GetCloudDataList(key);
+		if (cloudDataList)
+		{
+			bool keyDataExists;
+			unsigned int keyDataIndex = cloudDataList->keyData.GetIndexFromKey(pendingNotification->pendingNotificationKey.clientGUID, &keyDataExists);
+			if (keyDataExists)
+				cloudData = cloudDataList->keyData[keyDataIndex];
+		}
+
+		// If the data was updated but since deleted without a release, such as from an unsubscribe, there is nothing to send
+		CloudData *rowData = pendingNotification->wasUpdated ? cloudData : pendingNotification->releasedData;
+		if (rowData==0)
+			continue;
+
+		if (cloudData)
+			NotifyClientSubscribersOfDataChange(rowData, key, cloudData->specificSubscribers, pendingNotification->wasUpdated );
+		if (cloudDataList)
+			NotifyClientSubscribersOfDataChange(rowData, key, cloudDataList->nonSpecificSubscribers, pendingNotification->wasUpdated );
+		NotifyServerSubscribersOfDataChange(rowData, key, pendingNotification->wasUpdated );
+	}
+
+	ClearPendingNotifications();
+}
+void CloudServer::ClearPendingNotifications(void)
+{
+	unsigned int i;
+	for (i=0; i < pendingNotifications.Size(); i++)
+	{
+		PendingNotification *pendingNotification = pendingNotifications[i];
+		pendingNotificationIndex.Remove(pendingNotification->pendingNotificationKey, _FILE_AND_LINE_);
+		if (pendingNotification->releasedData)
+			SLNet::OP_DELETE(pendingNotification->releasedData, _FILE_AND_LINE_);
+		SLNet::OP_DELETE(pendingNotification, _FILE_AND_LINE_);
+	}
+	pendingNotifications.Clear(true, _FILE_AND_LINE_);
+}
 void CloudServer::AddServer(RakNetGUID systemIdentifier)
 {
 	ConnectionState cs = rakPeerInterface->GetConnectionState(systemIdentifier);
@@ -1141,7 +1250,10 @@ void CloudServer::AddServer(RakNetGUID systemIdentifier)
 		remoteServer->serverAddress=systemIdentifier;
 		remoteServers.InsertAtIndex(remoteServer, index, _FILE_AND_LINE_);
 
-		SendUploadedAndSubscribedKeysToServer(systemIdentifier);
+		if (shardingEnabled)
+			UpdateShardRing(UNASSIGNED_RAKNET_GUID);
+		else
+			SendUploadedAndSubscribedKeysToServer(systemIdentifier);
 	}
 }
 void CloudServer::RemoveServer(RakNetGUID systemAddress)
@@ -1152,6 +1264,8 @@ void CloudServer::RemoveServer(RakNetGUID systemAddress)
 	{
 		SLNet::OP_DELETE(remoteServers[index],_FILE_AND_LINE_);
 		remoteServers.RemoveAtIndex(index);
+
+		UpdateShardRing(systemAddress);
 	}
 }
 void CloudServer::GetRemoteServers(DataStructures::List<RakNetGUID> &remoteServersOut)
@@ -1253,7 +1367,6 @@ void CloudServer::ProcessCloudQueryWithAddresses( CloudServer::CloudQueryWithAdd
 	CloudQueryResult cloudQueryResult;
 	CloudQueryRow cloudQueryRow;
 	unsigned int queryIndex;
-	bool dataRepositoryExists;
 	CloudDataList* cloudDataList;
 	unsigned int keyDataIndex;
 
@@ -1263,11 +1376,13 @@ void CloudServer::ProcessCloudQueryWithAddresses( CloudServer::CloudQueryWithAdd
 	{
 		const CloudKey &key = cloudQueryWithAddresses.cloudQuery.keys[queryIndex];
 
-		unsigned int dataRepositoryIndex = dataRepository.GetIndexFromKey(key, &dataRepositoryExists);
-		if (dataRepositoryExists)
-		{
-			cloudDataList=dataRepository[dataRepositoryIndex];
+		// Rows of keys owned by other servers are returned by those servers
+		if (shardingEnabled && IsKeyOwner(key)==false)
+			continue;
 
+		cloudDataList=GetCloudDataList(key);
+		if (cloudDataList)
+		{
 			if (cloudDataList->uploaderCount>0)
 			{
 				// Return all keyData that was uploaded by specificSystems, or all if not specified
@@ -1330,6 +1445,10 @@ void CloudServer::SendUploadedAndSubscribedKeysToServer( RakNetGUID systemAddres
 }
 void CloudServer::SendUploadedKeyToServers( CloudKey &cloudKey )
 {
+	// With sharding, servers find the owner of a key from the ring instead
+	if (shardingEnabled)
+		return;
+
 	SLNet::BitStream bsOut;
 	bsOut.Write((MessageID)ID_CLOUD_SERVER_TO_SERVER_COMMAND);
 	bsOut.Write((MessageID)STSC_ADD_UPLOADED_KEY);
@@ -1343,11 +1462,22 @@ void CloudServer::SendSubscribedKeyToServers( CloudKey &cloudKey )
 	bsOut.Write((MessageID)ID_CLOUD_SERVER_TO_SERVER_COMMAND);
 	bsOut.Write((MessageID)STSC_ADD_SUBSCRIBED_KEY);
 	cloudKey.Serialize(true, &bsOut);
+	if (shardingEnabled)
+	{
+		// Only the owner of the key sends updates
+		if (IsKeyOwner(cloudKey)==false)
+			SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, GetKeyOwner(cloudKey), false);
+		return;
+	}
 	for (unsigned int i=0; i < remoteServers.Size(); i++)
 		SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, remoteServers[i]->serverAddress, false);
 }
 void CloudServer::RemoveUploadedKeyFromServers( CloudKey &cloudKey )
 {
+	// With sharding, servers find the owner of a key from the ring instead
+	if (shardingEnabled)
+		return;
+
 	SLNet::BitStream bsOut;
 	bsOut.Write((MessageID)ID_CLOUD_SERVER_TO_SERVER_COMMAND);
 	bsOut.Write((MessageID)STSC_REMOVE_UPLOADED_KEY);
@@ -1361,6 +1491,13 @@ void CloudServer::RemoveSubscribedKeyFromServers( CloudKey &cloudKey )
 	bsOut.Write((MessageID)ID_CLOUD_SERVER_TO_SERVER_COMMAND);
 	bsOut.Write((MessageID)STSC_REMOVE_SUBSCRIBED_KEY);
 	cloudKey.Serialize(true, &bsOut);
+	if (shardingEnabled)
+	{
+		// Only the owner of the key sends updates
+		if (IsKeyOwner(cloudKey)==false)
+			SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, GetKeyOwner(cloudKey), false);
+		return;
+	}
 	for (unsigned int i=0; i < remoteServers.Size(); i++)
 		SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, remoteServers[i]->serverAddress, false);
 }
@@ -1499,16 +1636,12 @@ void CloudServer::OnServerDataChanged( Packet *packet )
 	CloudQueryRow row;
 	row.Serialize(false, &bsIn, this);
 
-	CloudDataList *cloudDataList;
-	bool dataRepositoryExists;
-	unsigned int dataRepositoryIndex;
-	dataRepositoryIndex = dataRepository.GetIndexFromKey(row.key, &dataRepositoryExists);
-	if (dataRepositoryExists==false)
+	CloudDataList *cloudDataList = GetCloudDataList(row.key);
+	if (cloudDataList==0)
 	{
 		DeallocateRowData(row.data);
 		return;
 	}
-	cloudDataList = dataRepository[dataRepositoryIndex];
 	CloudData *cloudData;
 	bool keyDataListExists;
 	unsigned int keyDataListIndex = cloudDataList->keyData.GetIndexFromKey(row.clientGUID, &keyDataListExists);
@@ -1534,6 +1667,24 @@ void CloudServer::GetServersWithUploadedKeys(
 		remoteServers[i]->workingFlag=false;
 	}
 
+	if (shardingEnabled)
+	{
+		// Each key is only on its owner
+		for (j=0; j < keys.Size(); j++)
+		{
+			if (IsKeyOwner(keys[j]))
+				continue;
+			bool objectExists;
+			i = remoteServers.GetIndexFromKey(GetKeyOwner(keys[j]), &objectExists);
+			if (objectExists && remoteServers[i]->workingFlag==false)
+			{
+				remoteServers[i]->workingFlag=true;
+				remoteServersWithData.Push(remoteServers[i], _FILE_AND_LINE_);
+			}
+		}
+		return;
+	}
+
 	for (i=0; i < remoteServers.Size(); i++)
 	{
 		if (remoteServers[i]->workingFlag==false)
@@ -1560,26 +1711,307 @@ void CloudServer::GetServersWithUploadedKeys(
 	}
 }
 
-CloudServer::CloudDataList *CloudServer::GetOrAllocateCloudDataList(CloudKey key, bool *dataRepositoryExists, unsigned int &dataRepositoryIndex)
+void CloudServer::SetSharding(bool enabled, unsigned int virtualNodesPerServer)
+{
+	shardingEnabled=enabled;
+	shardVirtualNodes=virtualNodesPerServer>0 ? virtualNodesPerServer : 1;
+	shardRing.Clear(false, _FILE_AND_LINE_);
+	if (shardingEnabled && rakPeerInterface && remoteServers.Size()>0)
+		UpdateShardRing(UNASSIGNED_RAKNET_GUID);
+}
+RakNetGUID CloudServer::GetKeyOwner(const CloudKey &key) const
+{
+	if (rakPeerInterface==0)
+		return UNASSIGNED_RAKNET_GUID;
+	return GetKeyOwner(key, shardRing, rakPeerInterface->GetMyGUID());
+}
+RakNetGUID CloudServer::GetKeyOwner(const CloudKey &key, const ShardRing &ring, RakNetGUID myGUID)
+{
+	if (ring.Size()==0)
+		return myGUID;
+
+	// First node clockwise from the key
+	bool objectExists;
+	unsigned int index = ring.GetIndexFromKey(ShardHash((uint32_t) CloudKey::ToUint32(key)), &objectExists);
+	if (index==ring.Size())
+		index=0;
+	return ring[index].serverGUID;
+}
+bool CloudServer::IsKeyOwner(const CloudKey &key) const
+{
+	return shardRing.Size()==0 || GetKeyOwner(key)==rakPeerInterface->GetMyGUID();
+}
+void CloudServer::UpdateShardRing(RakNetGUID removedServer)
+{
+	if (shardingEnabled==false)
+		return;
+
+	ShardRing oldRing = shardRing;
+	RakNetGUID myGUID = rakPeerInterface->GetMyGUID();
+
+	shardRing.Clear(true, _FILE_AND_LINE_);
+	if (remoteServers.Size()>0)
+	{
+		// Servers are inserted in the same order on every server, so position collisions resolve the same way
+		DataStructures::OrderedList<RakNetGUID, RakNetGUID> servers;
+		servers.Insert(myGUID, myGUID, true, _FILE_AND_LINE_);
+		unsigned int i;
+		for (i=0; i < remoteServers.Size(); i++)
+			servers.Insert(remoteServers[i]->serverAddress, remoteServers[i]->serverAddress, true, _FILE_AND_LINE_);
+
+		for (i=0; i < servers.Size(); i++)
+		{
+			ShardRingNode shardRingNode;
+			shardRingNode.serverGUID=servers[i];
+			for (unsigned int virtualNode=0; virtualNode < shardVirtualNodes; virtualNode++)
+			{
+				shardRingNode.position=ShardHash((uint32_t) (servers[i].g >> 32) ^ ShardHash((uint32_t) servers[i].g ^ ShardHash(virtualNode+1)));
+				shardRing.Insert(shardRingNode.position, shardRingNode, false, _FILE_AND_LINE_);
+			}
+		}
+	}
+
+	// Backwards, as DeleteCloudDataList() moves the last element into the gap
+	unsigned int dataRepositoryIndex = dataRepository.Size();
+	while (dataRepositoryIndex-- > 0)
+	{
+		CloudDataList *cloudDataList = dataRepository[dataRepositoryIndex];
+		RakNetGUID oldOwner = GetKeyOwner(cloudDataList->key, oldRing, myGUID);
+		RakNetGUID newOwner = GetKeyOwner(cloudDataList->key, shardRing, myGUID);
+
+		unsigned int keyDataIndex = cloudDataList->keyData.Size();
+		while (keyDataIndex-- > 0)
+		{
+			CloudData *cloudData = cloudDataList->keyData[keyDataIndex];
+			if (cloudData->serverGUID==myGUID)
+			{
+				// Uploaded by a local client. Replicate to the new owner.
+				if (oldOwner!=newOwner && newOwner!=myGUID && cloudData->isUploaded)
+					SendShardPost(newOwner, cloudData, cloudDataList->key, true);
+			}
+			else if (cloudData->serverGUID==removedServer)
+			{
+				// The uploader was connected to the server that left
+				DeleteReplica(cloudDataList, keyDataIndex, true);
+			}
+			else if (newOwner!=myGUID)
+			{
+				// Replicas are resent to the new owner by the servers the uploaders are connected to
+				DeleteReplica(cloudDataList, keyDataIndex, false);
+			}
+		}
+
+		// Local clients still get updates to this key through the new owner
+		if (oldOwner!=newOwner && newOwner!=myGUID && cloudDataList->subscriberCount>0)
+			SendSubscribedKeyToServers(cloudDataList->key);
+
+		if (cloudDataList->IsUnused())
+			DeleteCloudDataList(cloudDataList);
+	}
+
+	// Other servers subscribe to keys at their owner only
+	for (unsigned int remoteServerIndex=0; remoteServerIndex < remoteServers.Size(); remoteServerIndex++)
+	{
+		RemoteServer *remoteServer = remoteServers[remoteServerIndex];
+		unsigned int subscribedKeysIndex = remoteServer->subscribedKeys.Size();
+		while (subscribedKeysIndex-- > 0)
+		{
+			if (GetKeyOwner(remoteServer->subscribedKeys[subscribedKeysIndex], shardRing, myGUID)!=myGUID)
+				remoteServer->subscribedKeys.RemoveAtIndex(subscribedKeysIndex);
+		}
+	}
+}
+void CloudServer::SendShardPost(RakNetGUID owner, CloudData *cloudData, CloudKey &key, bool ownerChanged)
+{
+	SLNet::BitStream bsOut;
+	bsOut.Write((MessageID)ID_CLOUD_SERVER_TO_SERVER_COMMAND);
+	bsOut.Write((MessageID)STSC_SHARD_POST);
+	bsOut.Write(ownerChanged);
+	CloudQueryRow row;
+	row.key=key;
+	row.data=cloudData->dataPtr;
+	row.length=cloudData->dataLengthBytes;
+	row.serverSystemAddress=cloudData->serverSystemAddress;
+	row.clientSystemAddress=cloudData->clientSystemAddress;
+	row.serverGUID=cloudData->serverGUID;
+	row.clientGUID=cloudData->clientGUID;
+	row.Serialize(true,&bsOut,0);
+	SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, owner, false);
+}
+void CloudServer::SendShardRelease(CloudKey &key, RakNetGUID clientGUID)
+{
+	if (shardingEnabled==false)
+		return;
+	RakNetGUID owner = GetKeyOwner(key);
+	if (owner==rakPeerInterface->GetMyGUID())
+		return;
+
+	SLNet::BitStream bsOut;
+	bsOut.Write((MessageID)ID_CLOUD_SERVER_TO_SERVER_COMMAND);
+	bsOut.Write((MessageID)STSC_SHARD_RELEASE);
+	key.Serialize(true, &bsOut);
+	bsOut.Write(clientGUID);
+	SendUnified(&bsOut, HIGH_PRIORITY, RELIABLE_ORDERED, 0, owner, false);
+}
+void CloudServer::OnShardPost( Packet *packet )
+{
+	SLNet::BitStream bsIn(packet->data, packet->length, false);
+	bsIn.IgnoreBytes(sizeof(MessageID)*2);
+
+	bool objectExists;
+	remoteServers.GetIndexFromKey(packet->guid,&objectExists);
+	if (objectExists==false)
+		return;
+
+	bool ownerChanged=false;
+	bsIn.Read(ownerChanged);
+	CloudQueryRow row;
+	row.Serialize(false, &bsIn, this);
+
+	// The sender's ring is out of date. It resends the replica to the right server once it is updated.
+	if (IsKeyOwner(row.key)==false)
+	{
+		DeallocateRowData(row.data);
+		return;
+	}
+
+	bool dataRepositoryExists;
+	CloudDataList *cloudDataList = GetOrAllocateCloudDataList(row.key, &dataRepositoryExists);
+	CloudData *cloudData;
+	bool keyDataListExists;
+	unsigned int keyDataListIndex = cloudDataList->keyData.GetIndexFromKey(row.clientGUID, &keyDataListExists);
+	if (keyDataListExists==false)
+	{
+		cloudData = SLNet::OP_NEW<CloudData>(_FILE_AND_LINE_);
+		cloudData->allocatedData=0;
+		cloudData->dataPtr=0;
+		cloudData->isUploaded=false;
+		cloudData->clientGUID=row.clientGUID;
+		cloudDataList->keyData.Insert(row.clientGUID,cloudData,true,_FILE_AND_LINE_);
+	}
+	else
+	{
+		cloudData = cloudDataList->keyData[keyDataListIndex];
+		// The same client also uploaded this key to this server directly, which takes precedence
+		if (cloudData->uploadedKeysIndex!=(unsigned int) -1)
+		{
+			DeallocateRowData(row.data);
+			return;
+		}
+		cloudData->Clear();
+	}
+
+	if (row.length>CLOUD_SERVER_DATA_STACK_SIZE)
+	{
+		cloudData->allocatedData = (unsigned char *) rakMalloc_Ex(row.length,_FILE_AND_LINE_);
+		if (cloudData->allocatedData==0)
+		{
+			notifyOutOfMemory(_FILE_AND_LINE_);
+			row.length=0;
+		}
+		cloudData->dataPtr=cloudData->allocatedData;
+	}
+	else
+	{
+		cloudData->dataPtr=cloudData->stackData;
+	}
+	if (row.length>0)
+		memcpy(cloudData->dataPtr, row.data, row.length);
+	DeallocateRowData(row.data);
+
+	if (cloudData->isUploaded==false)
+		cloudDataList->uploaderCount++;
+	cloudData->isUploaded=true;
+	cloudData->dataLengthBytes=row.length;
+	cloudData->serverSystemAddress=row.serverSystemAddress;
+	cloudData->clientSystemAddress=row.clientSystemAddress;
+	cloudData->serverGUID=row.serverGUID;
+
+	// Subscribers already have data that only moved to this server
+	if (ownerChanged==false)
+		QueueDataChangeNotification(cloudData, cloudDataList->key, true);
+}
+void CloudServer::OnShardRelease( Packet *packet )
+{
+	SLNet::BitStream bsIn(packet->data, packet->length, false);
+	bsIn.IgnoreBytes(sizeof(MessageID)*2);
+
+	bool objectExists;
+	remoteServers.GetIndexFromKey(packet->guid,&objectExists);
+	if (objectExists==false)
+		return;
+
+	CloudKey cloudKey;
+	RakNetGUID clientGUID;
+	cloudKey.Serialize(false, &bsIn);
+	bsIn.Read(clientGUID);
+
+	CloudDataList *cloudDataList = GetCloudDataList(cloudKey);
+	if (cloudDataList==0)
+		return;
+	bool keyDataListExists;
+	unsigned int keyDataListIndex = cloudDataList->keyData.GetIndexFromKey(clientGUID, &keyDataListExists);
+	if (keyDataListExists==false)
+		return;
+	CloudData *cloudData = cloudDataList->keyData[keyDataListIndex];
+	if (cloudData->uploadedKeysIndex!=(unsigned int) -1 || cloudData->isUploaded==false)
+		return;
+
+	DeleteReplica(cloudDataList, keyDataListIndex, true);
+	if (cloudDataList->IsUnused())
+		DeleteCloudDataList(cloudDataList);
+}
+void CloudServer::DeleteReplica(CloudDataList *cloudDataList, unsigned int keyDataIndex, bool notifySubscribers)
 {
-	CloudDataList *cloudDataList;
+	CloudData *cloudData = cloudDataList->keyData[keyDataIndex];
+	if (cloudData->isUploaded)
+	{
+		cloudDataList->uploaderCount--;
+		if (notifySubscribers)
+			QueueDataChangeNotification(cloudData, cloudDataList->key, false);
+	}
+	cloudData->Clear();
+	if (cloudData->IsUnused())
+	{
+		SLNet::OP_DELETE(cloudData, _FILE_AND_LINE_);
+		cloudDataList->keyData.RemoveAtIndex(keyDataIndex);
+	}
+}
 
-	dataRepositoryIndex = dataRepository.GetIndexFromKey(key, dataRepositoryExists);
-	if (*dataRepositoryExists==false)
+CloudServer::CloudDataList *CloudServer::GetOrAllocateCloudDataList(CloudKey key, bool *dataRepositoryExists)
+{
+	CloudDataList *cloudDataList = GetCloudDataList(key);
+	*dataRepositoryExists=cloudDataList!=0;
+	if (cloudDataList==0)
 	{
 		cloudDataList = SLNet::OP_NEW<CloudDataList>(_FILE_AND_LINE_);
 		cloudDataList->key=key;
 		cloudDataList->uploaderCount=0;
 		cloudDataList->subscriberCount=0;
-		dataRepository.InsertAtIndex(cloudDataList,dataRepositoryIndex,_FILE_AND_LINE_);
-	}
-	else
-	{
-		cloudDataList = dataRepository[dataRepositoryIndex];
+		cloudDataList->dataRepositoryIndex=dataRepository.Size();
+		dataRepository.Push(cloudDataList,_FILE_AND_LINE_);
+		dataRepositoryIndex.Push(key,cloudDataList,_FILE_AND_LINE_);
 	}
 
 	return cloudDataList;
 }
+CloudServer::CloudDataList *CloudServer::GetCloudDataList(const CloudKey &key)
+{
+	CloudDataList **cloudDataList = dataRepositoryIndex.Peek(key);
+	if (cloudDataList==0)
+		return 0;
+	return *cloudDataList;
+}
+void CloudServer::DeleteCloudDataList(CloudDataList *cloudDataList)
+{
+	// Move the last list into the gap
+	unsigned int index = cloudDataList->dataRepositoryIndex;
+	dataRepository.RemoveAtIndexFast(index);
+	if (index < dataRepository.Size())
+		dataRepository[index]->dataRepositoryIndex=index;
+	dataRepositoryIndex.Remove(cloudDataList->key,_FILE_AND_LINE_);
+	SLNet::OP_DELETE(cloudDataList, _FILE_AND_LINE_);
+}
 
 void CloudServer::UnsubscribeFromKey(RemoteCloudClient *remoteCloudClient, RakNetGUID remoteCloudClientGuid, unsigned int keySubscriberIndex, CloudKey &cloudKey, DataStructures::List<RakNetGUID> &specificSystems)
 {
@@ -1589,15 +2021,12 @@ void CloudServer::UnsubscribeFromKey(RemoteCloudClient *remoteCloudClient, RakNe
 	if (keySubscriberId->specificSystemsSubscribedTo.Size()==0 && specificSystems.Size()>0)
 		return;
 
-	bool dataRepositoryExists;
-	CloudDataList *cloudDataList;
-	unsigned int dataRepositoryIndex = dataRepository.GetIndexFromKey(cloudKey, &dataRepositoryExists);
-	if (dataRepositoryExists==false)
+	CloudDataList *cloudDataList = GetCloudDataList(cloudKey);
+	if (cloudDataList==0)
 		return;
 
 	unsigned int i,j;
 
-	cloudDataList = dataRepository[dataRepositoryIndex];
 	if (specificSystems.Size()==0)
 	{
 		// Remove global subscriber. If returns false, have to remove specific subscribers
@@ -1635,9 +2064,22 @@ void CloudServer::UnsubscribeFromKey(RemoteCloudClient *remoteCloudClient, RakNe
 		RemoveSubscribedKeyFromServers(cloudKey);
 
 	if (cloudDataList->IsUnused())
-	{
-		SLNet::OP_DELETE(cloudDataList, _FILE_AND_LINE_);
-		dataRepository.RemoveAtIndex(dataRepositoryIndex);
+		DeleteCloudDataList(cloudDataList);
+}
+void CloudServer::RemoveUploadedKey(RemoteCloudClient *remoteCloudClient, CloudData *cloudData)
+{
+	// Move the last key into the gap
+	unsigned int index = cloudData->uploadedKeysIndex;
+	cloudData->uploadedKeysIndex=(unsigned int) -1;
+	remoteCloudClient->uploadedKeys.RemoveAtIndexFast(index);
+	if (index < remoteCloudClient->uploadedKeys.Size())
+	{
+		CloudDataList *cloudDataList = GetCloudDataList(remoteCloudClient->uploadedKeys[index]);
+		RakAssert(cloudDataList);
+		bool keyDataExists;
+		unsigned int keyDataIndex = cloudDataList->keyData.GetIndexFromKey(cloudData->clientGUID, &keyDataExists);
+		RakAssert(keyDataExists);
+		cloudDataList->keyData[keyDataIndex]->uploadedKeysIndex=index;
 	}
 }
 void CloudServer::RemoveSpecificSubscriber(RakNetGUID specificSubscriber, CloudDataList *cloudDataList, RakNetGUID remoteCloudClientGuid)
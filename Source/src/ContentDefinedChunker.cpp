@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "slikenet/ContentDefinedChunker.h"
+#include <string.h>
+
+using namespace SLNet;
+
+// A boundary is found after about 64 kilobytes past MIN_CHUNK_SIZE. The high bits of the gear hash depend on the most bytes.
+static const unsigned int CHUNK_BOUNDARY_MASK=0xFFFF0000;
+
+ContentDefinedChunker::ContentDefinedChunker()
+{
+	// Both sides of a transfer have to find the same boundaries, so the table is fixed rather than random
+	unsigned int state=0x9E3779B9;
+	for (unsigned int i=0; i < 256; i++)
+	{
+		state^=state<<13;
+		state^=state>>17;
+		state^=state<<5;
+		gearTable[i]=state;
+	}
+	Reset();
+}
+void ContentDefinedChunker::Reset(void)
+{
+	rollingHash=0;
+	chunkOffset=0;
+	chunkLength=0;
+	sha1.Reset();
+}
+void ContentDefinedChunker::Update(const char *data, unsigned int length, DataStructures::List<ChunkSignature> &chunks)
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	unsigned int hashedUpTo=0;
+	for (unsigned int i=0; i < length; i++)
+	{
+		rollingHash=(rollingHash<<1)+gearTable[bytes[i]];
+		chunkLength++;
+		if ((chunkLength>=MIN_CHUNK_SIZE && (rollingHash & CHUNK_BOUNDARY_MASK)==0) || chunkLength==MAX_CHUNK_SIZE)
+		{
+			sha1.Update(bytes+hashedUpTo, i+1-hashedUpTo);
+			hashedUpTo=i+1;
+			EndChunk(chunks);
+		}
+	}
+	if (hashedUpTo<length)
+		sha1.Update(bytes+hashedUpTo, length-hashedUpTo);
+}
+void ContentDefinedChunker::Final(DataStructures::List<ChunkSignature> &chunks)
+{
+	if (chunkLength>0)
+		EndChunk(chunks);
+}
+void ContentDefinedChunker::HashChunk(const char *data, unsigned int length, unsigned char hash[SHA1_LENGTH])
+{
+	CSHA1 chunkSha1;
+	chunkSha1.Update((const unsigned char *) data, length);
+	chunkSha1.Final();
+	memcpy(hash, chunkSha1.GetHash(), SHA1_LENGTH);
+}
+void ContentDefinedChunker::EndChunk(DataStructures::List<ChunkSignature> &chunks)
+{
+	ChunkSignature chunkSignature;
+	chunkSignature.offset=chunkOffset;
+	chunkSignature.length=chunkLength;
+	sha1.Final();
+	memcpy(chunkSignature.hash, sha1.GetHash(), SHA1_LENGTH);
+	chunks.Push(chunkSignature, _FILE_AND_LINE_);
+
+	chunkOffset+=chunkLength;
+	chunkLength=0;
+	rollingHash=0;
+	sha1.Reset();
+}
@@ -108,6 +108,14 @@ char* ByteQueue::PeekContiguousBytes(unsigned int *outLength) const
 		*outLength=lengthAllocated-readOffset;
 	return data+readOffset;
 }
+char* ByteQueue::PeekWrappedBytes(unsigned int *outLength) const
+{
+	if (writeOffset>=readOffset)
+		*outLength=0;
+	else
+		*outLength=writeOffset;
+	return data;
+}
 void ByteQueue::Clear(const char *file, unsigned int line)
 {
 	if (lengthAllocated)
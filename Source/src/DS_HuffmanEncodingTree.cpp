@@ -23,6 +23,8 @@ using namespace SLNet;
 HuffmanEncodingTree::HuffmanEncodingTree()
 {
 	root = 0;
+	decodingTable = 0;
+	maxBitLength = 0;
 }
 
 HuffmanEncodingTree::~HuffmanEncodingTree()
@@ -59,6 +61,10 @@ void HuffmanEncodingTree::FreeMemory( void )
 	for ( int i = 0; i < 256; i++ )
 		rakFree_Ex(encodingTable[ i ].encoding, _FILE_AND_LINE_ );
 
+	rakFree_Ex(decodingTable, _FILE_AND_LINE_ );
+	decodingTable = 0;
+	maxBitLength = 0;
+
 	root = 0;
 }
 
@@ -148,13 +154,19 @@ void HuffmanEncodingTree::GenerateFromFrequencyTable( unsigned int frequencyTabl
 
 		while ( currentNode != root );
 
+		if ( tempPathLength > maxBitLength )
+			maxBitLength = tempPathLength;
+
 		// Write to the bitstream in the reverse order that we stored the path, which gives us the correct order from the root to the leaf
+		encodingTable[ counter ].code = 0;
 		while ( tempPathLength-- > 0 )
 		{
 			if ( tempPath[ tempPathLength ] )   // Write 1's and 0's because writing a bool will write the BitStream TYPE_CHECKING validation bits if that is defined along with the actual data bit, which is not what we want
 				bitStream.Write1();
 			else
 				bitStream.Write0();
+
+			encodingTable[ counter ].code = ( encodingTable[ counter ].code << 1 ) | ( tempPath[ tempPathLength ] ? 1 : 0 );
 		}
 
 		// Read data from the bitstream, which is written to the encoding table in bits and bitlength. Note this function allocates the encodingTable[counter].encoding pointer
@@ -163,6 +175,36 @@ void HuffmanEncodingTree::GenerateFromFrequencyTable( unsigned int frequencyTabl
 		// Reset the bitstream for the next iteration
 		bitStream.Reset();
 	}
+
+	// Generate the decoding table. For each combination of the next HUFFMAN_DECODING_TABLE_BITS bits, store the character whose code they start with,
+	// or the node they lead to if the code is longer
+	decodingTable = (DecodingTableEntry*) rakMalloc_Ex( sizeof( DecodingTableEntry ) << HUFFMAN_DECODING_TABLE_BITS, _FILE_AND_LINE_ );
+	for ( unsigned index = 0; index < ( 1u << HUFFMAN_DECODING_TABLE_BITS ); index++ )
+	{
+		DecodingTableEntry &entry = decodingTable[ index ];
+		entry.node = 0;
+		entry.value = 0;
+		entry.bitLength = 0;
+
+		currentNode = root;
+		for ( unsigned depth = 1; depth <= HUFFMAN_DECODING_TABLE_BITS; depth++ )
+		{
+			if ( index & ( 1u << ( HUFFMAN_DECODING_TABLE_BITS - depth ) ) )
+				currentNode = currentNode->right;
+			else
+				currentNode = currentNode->left;
+
+			if ( currentNode->left == 0 && currentNode->right == 0 )   // Leaf
+			{
+				entry.value = currentNode->value;
+				entry.bitLength = ( unsigned char ) depth;
+				break;
+			}
+		}
+
+		if ( entry.bitLength == 0 )
+			entry.node = currentNode;
+	}
 }
 
 // Pass an array of bytes to array and a preallocated BitStream to receive the output
@@ -170,10 +212,61 @@ void HuffmanEncodingTree::EncodeArray( unsigned char *input, size_t sizeInBytes,
 {		
 	unsigned counter;
 
-	// For each input byte, Write out the corresponding series of 1's and 0's that give the encoded representation
-	for ( counter = 0; counter < sizeInBytes; counter++ )
+	if ( maxBitLength <= 32 )
 	{
-		output->WriteBits( encodingTable[ input[ counter ] ].encoding, encodingTable[ input[ counter ] ].bitLength, false ); // Data is left aligned
+		// Collect the codes in a 64 bit word, store it 32 bits at a time, and write everything to the output with a single call
+		BitSize_t totalBits = 0;
+		for ( counter = 0; counter < sizeInBytes; counter++ )
+			totalBits += encodingTable[ input[ counter ] ].bitLength;
+
+		unsigned char stackBuffer[ 256 ];
+		unsigned char *buffer = stackBuffer;
+		size_t bufferSize = BITS_TO_BYTES( totalBits ) + 4;
+		if ( bufferSize > sizeof( stackBuffer ) )
+			buffer = (unsigned char*) rakMalloc_Ex( bufferSize, _FILE_AND_LINE_ );
+
+		uint64_t word = 0;
+		unsigned wordBits = 0;
+		size_t bufferIndex = 0;
+		for ( counter = 0; counter < sizeInBytes; counter++ )
+		{
+			const CharacterEncoding &characterEncoding = encodingTable[ input[ counter ] ];
+			word = ( word << characterEncoding.bitLength ) | characterEncoding.code;
+			wordBits += characterEncoding.bitLength;
+			if ( wordBits >= 32 )
+			{
+				wordBits -= 32;
+				uint32_t bits = ( uint32_t ) ( word >> wordBits );
+				buffer[ bufferIndex ] = ( unsigned char ) ( bits >> 24 );
+				buffer[ bufferIndex + 1 ] = ( unsigned char ) ( bits >> 16 );
+				buffer[ bufferIndex + 2 ] = ( unsigned char ) ( bits >> 8 );
+				buffer[ bufferIndex + 3 ] = ( unsigned char ) bits;
+				bufferIndex += 4;
+			}
+		}
+
+		// Remaining bits, left aligned
+		while ( wordBits >= 8 )
+		{
+			wordBits -= 8;
+			buffer[ bufferIndex++ ] = ( unsigned char ) ( word >> wordBits );
+		}
+		if ( wordBits > 0 )
+			buffer[ bufferIndex ] = ( unsigned char ) ( word << ( 8 - wordBits ) );
+
+		if ( totalBits > 0 )
+			output->WriteBits( buffer, totalBits, false ); // Data is left aligned
+
+		if ( buffer != stackBuffer )
+			rakFree_Ex( buffer, _FILE_AND_LINE_ );
+	}
+	else
+	{
+		// For each input byte, Write out the corresponding series of 1's and 0's that give the encoded representation
+		for ( counter = 0; counter < sizeInBytes; counter++ )
+		{
+			output->WriteBits( encodingTable[ input[ counter ] ].encoding, encodingTable[ input[ counter ] ].bitLength, false ); // Data is left aligned
+		}
 	}
 
 	// Byte align the output so the unassigned remaining bits don't equate to some actual value
@@ -197,63 +290,102 @@ void HuffmanEncodingTree::EncodeArray( unsigned char *input, size_t sizeInBytes,
 	}
 }
 
-unsigned HuffmanEncodingTree::DecodeArray(SLNet::BitStream * input, BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output )
+// Decodes characters from input, starting at *bitOffset, until endBit is reached or maxCharsToWrite characters were written. Returns the number of characters written.
+// A code cut off by endBit is skipped, as it is the padding EncodeArray() writes.
+unsigned HuffmanEncodingTree::DecodeBits( const unsigned char *input, BitSize_t *bitOffset, BitSize_t endBit, unsigned char *output, size_t maxCharsToWrite ) const
 {
-	HuffmanEncodingTreeNode * currentNode;
+	// The next bits are read from three bytes
+	RakAssert( HUFFMAN_DECODING_TABLE_BITS + 7 <= 24 );
 
-	unsigned outputWriteIndex;
-	outputWriteIndex = 0;
-	currentNode = root;
+	BitSize_t offset = *bitOffset;
+	const BitSize_t lastByte = ( endBit - 1 ) >> 3;
+	unsigned outputWriteIndex = 0;
 
-	// For each bit, go left if it is a 0 and right if it is a 1.  When we reach a leaf, that gives us the desired value and we restart from the root
-
-	for ( unsigned counter = 0; counter < sizeInBits; counter++ )
+	while ( outputWriteIndex < maxCharsToWrite && offset < endBit )
 	{
-		if ( input->ReadBit() == false )   // left!
-			currentNode = currentNode->left;
-		else
-			currentNode = currentNode->right;
-
-		if ( currentNode->left == 0 && currentNode->right == 0 )   // Leaf
+		// Look up the next HUFFMAN_DECODING_TABLE_BITS bits. Bytes past the end are read as zeroes.
+		const BitSize_t byteIndex = offset >> 3;
+		uint32_t window = ( uint32_t ) input[ byteIndex ] << 16;
+		if ( byteIndex + 1 <= lastByte )
+			window |= ( uint32_t ) input[ byteIndex + 1 ] << 8;
+		if ( byteIndex + 2 <= lastByte )
+			window |= ( uint32_t ) input[ byteIndex + 2 ];
+		const DecodingTableEntry &entry = decodingTable[ ( window >> ( 24 - HUFFMAN_DECODING_TABLE_BITS - ( offset & 7 ) ) ) & ( ( 1u << HUFFMAN_DECODING_TABLE_BITS ) - 1 ) ];
+
+		if ( entry.bitLength != 0 )
 		{
+			if ( offset + entry.bitLength > endBit )
+			{
+				offset = endBit;
+				break;
+			}
 
-			if ( outputWriteIndex < maxCharsToWrite )
-				output[ outputWriteIndex ] = currentNode->value;
+			output[ outputWriteIndex++ ] = entry.value;
+			offset += entry.bitLength;
+		}
+		else
+		{
+			// Longer code. For each further bit, go left if it is a 0 and right if it is a 1 until we reach a leaf.
+			HuffmanEncodingTreeNode *currentNode = entry.node;
+			offset += HUFFMAN_DECODING_TABLE_BITS;
+			while ( currentNode->left != 0 || currentNode->right != 0 )
+			{
+				if ( offset >= endBit )
+					break;
+
+				if ( ( input[ offset >> 3 ] & ( 0x80 >> ( offset & 7 ) ) ) == 0 )   // left!
+					currentNode = currentNode->left;
+				else
+					currentNode = currentNode->right;
+				offset++;
+			}
 
-			outputWriteIndex++;
+			if ( offset > endBit || currentNode->left != 0 || currentNode->right != 0 )
+			{
+				offset = endBit;
+				break;
+			}
 
-			currentNode = root;
+			output[ outputWriteIndex++ ] = currentNode->value;
 		}
 	}
 
+	*bitOffset = offset;
+	return outputWriteIndex;
+}
+
+unsigned HuffmanEncodingTree::DecodeArray(SLNet::BitStream * input, BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output )
+{
+	BitSize_t bitOffset = input->GetReadOffset();
+	BitSize_t endBit = bitOffset + sizeInBits;
+	if ( endBit > input->GetNumberOfBitsUsed() )
+		endBit = input->GetNumberOfBitsUsed();
+
+	unsigned outputWriteIndex = DecodeBits( input->GetData(), &bitOffset, endBit, output, maxCharsToWrite );
+
+	// Characters that do not fit into output are counted, but not written
+	unsigned char discarded[ 256 ];
+	while ( bitOffset < endBit )
+		outputWriteIndex += DecodeBits( input->GetData(), &bitOffset, endBit, discarded, sizeof( discarded ) );
+
+	if ( endBit > input->GetReadOffset() )
+		input->SetReadOffset( endBit );
 	return outputWriteIndex;
 }
 
 // Pass an array of encoded bytes to array and a preallocated BitStream to receive the output
 void HuffmanEncodingTree::DecodeArray( unsigned char *input, BitSize_t sizeInBits, SLNet::BitStream * output )
 {
-	HuffmanEncodingTreeNode * currentNode;
-
 	if ( sizeInBits <= 0 )
 		return ;
 
-	SLNet::BitStream bitStream( input, BITS_TO_BYTES(sizeInBits), false );
-
-	currentNode = root;
-
-	// For each bit, go left if it is a 0 and right if it is a 1.  When we reach a leaf, that gives us the desired value and we restart from the root
-	for ( unsigned counter = 0; counter < sizeInBits; counter++ )
+	unsigned char decoded[ 256 ];
+	BitSize_t bitOffset = 0;
+	while ( bitOffset < sizeInBits )
 	{
-		if ( bitStream.ReadBit() == false )   // left!
-			currentNode = currentNode->left;
-		else
-			currentNode = currentNode->right;
-
-		if ( currentNode->left == 0 && currentNode->right == 0 )   // Leaf
-		{
-			output->WriteBits( &( currentNode->value ), sizeof( char ) * 8, true ); // Use WriteBits instead of Write(char) because we want to avoid TYPE_CHECKING
-			currentNode = root;
-		}
+		unsigned decodedCount = DecodeBits( input, &bitOffset, sizeInBits, decoded, sizeof( decoded ) );
+		if ( decodedCount > 0 )
+			output->WriteBits( decoded, decodedCount * 8, true ); // Use WriteBits instead of Write(char) because we want to avoid TYPE_CHECKING
 	}
 }
 
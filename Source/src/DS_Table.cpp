@@ -16,6 +16,7 @@
 #include "slikenet/DS_Table.h"
 #include "slikenet/DS_OrderedList.h"
 #include <string.h>
+#include <algorithm> // used for std::sort, std::min, std::max
 #include "..\include\slikenet\slikeAssert.h"
 #include "..\include\slikenet\slikeAssert.h"
 #include "slikenet/Itoa.h"
@@ -295,6 +296,7 @@ unsigned Table::AddColumn(const char columnName[_TABLE_MAX_COLUMN_NAME_LENGTH],
 
 	// Add this column.
 	columns.Insert(Table::ColumnDescriptor(columnName, columnType), _FILE_AND_LINE_);
+	secondaryIndexes.Insert(0, _FILE_AND_LINE_);
 
 	// Extend the rows by one
 	rows.ForEachData(ExtendRows);
@@ -306,6 +308,8 @@ void Table::RemoveColumn(unsigned columnIndex)
 	if (columnIndex >= columns.Size())
 		return;
 
+	RemoveIndex(columnIndex);
+	secondaryIndexes.RemoveAtIndex(columnIndex);
 	columns.RemoveAtIndex(columnIndex);
 
 	// Remove this index from each row.
@@ -386,7 +390,8 @@ Table::Row* Table::AddRow(unsigned rowId, DataStructures::List<Cell> &initialCel
 		else
 			newRow->cells.Insert(SLNet::OP_NEW<Table::Cell>(_FILE_AND_LINE_), _FILE_AND_LINE_ );
 	}
-	rows.Insert(rowId, newRow);
+	if (rows.Insert(rowId, newRow))
+		AddRowToIndexes(rowId, newRow);
 	return newRow;
 }
 Table::Row* Table::AddRow(unsigned rowId, DataStructures::List<Cell*> &initialCellValues, bool copyCells)
@@ -409,10 +414,11 @@ Table::Row* Table::AddRow(unsigned rowId, DataStructures::List<Cell*> &initialCe
 		else
 			newRow->cells.Insert(SLNet::OP_NEW<Table::Cell>(_FILE_AND_LINE_), _FILE_AND_LINE_);
 	}
-	rows.Insert(rowId, newRow);
+	if (rows.Insert(rowId, newRow))
+		AddRowToIndexes(rowId, newRow);
 	return newRow;
 }
-Table::Row* Table::AddRowColumns(unsigned rowId, Row *row, DataStructures::List<unsigned> columnIndices)
+Table::Row* Table::AddRowColumns(unsigned rowId, Row *row, const DataStructures::List<unsigned> &columnIndices)
 {
 	Row *newRow = SLNet::OP_NEW<Row>( _FILE_AND_LINE_ );
 	unsigned columnIndex;
@@ -440,6 +446,7 @@ bool Table::RemoveRow(unsigned rowId)
 	Row *out;
 	if (rows.Delete(rowId, out))
 	{
+		RemoveRowFromIndexes(rowId);
 		DeleteRow(out);
 		return true;
 	}
@@ -453,7 +460,7 @@ void Table::RemoveRows(Table *tableContainingRowIDs)
 	{
 		for (i=0; i < (unsigned)cur->size; i++)
 		{
-			rows.Delete(cur->keys[i]);
+			RemoveRow(cur->keys[i]);
 		}
 		cur=cur->next;
 	}
@@ -467,6 +474,7 @@ bool Table::UpdateCell(unsigned rowId, unsigned columnIndex, int value)
 	if (row)
 	{
 		row->UpdateCell(columnIndex, value);
+		UpdateIndex(columnIndex, rowId, row);
 		return true;
 	}
 	return false;
@@ -479,6 +487,7 @@ bool Table::UpdateCell(unsigned rowId, unsigned columnIndex, char *str)
 	if (row)
 	{
 		row->UpdateCell(columnIndex, str);
+		UpdateIndex(columnIndex, rowId, row);
 		return true;
 	}
 	return false;
@@ -491,6 +500,7 @@ bool Table::UpdateCell(unsigned rowId, unsigned columnIndex, int byteLength, cha
 	if (row)
 	{
 		row->UpdateCell(columnIndex, byteLength, data);
+		UpdateIndex(columnIndex, rowId, row);
 		return true;
 	}
 	return false;
@@ -499,10 +509,12 @@ bool Table::UpdateCellByIndex(unsigned rowIndex, unsigned columnIndex, int value
 {
 	RakAssert(columns[columnIndex].columnType==NUMERIC);
 
-	Row *row = GetRowByIndex(rowIndex,0);
+	unsigned rowId;
+	Row *row = GetRowByIndex(rowIndex,&rowId);
 	if (row)
 	{
 		row->UpdateCell(columnIndex, value);
+		UpdateIndex(columnIndex, rowId, row);
 		return true;
 	}
 	return false;
@@ -511,10 +523,12 @@ bool Table::UpdateCellByIndex(unsigned rowIndex, unsigned columnIndex, char *str
 {
 	RakAssert(columns[columnIndex].columnType==STRING);
 
-	Row *row = GetRowByIndex(rowIndex,0);
+	unsigned rowId;
+	Row *row = GetRowByIndex(rowIndex,&rowId);
 	if (row)
 	{
 		row->UpdateCell(columnIndex, str);
+		UpdateIndex(columnIndex, rowId, row);
 		return true;
 	}
 	return false;
@@ -523,10 +537,12 @@ bool Table::UpdateCellByIndex(unsigned rowIndex, unsigned columnIndex, int byteL
 {
 	RakAssert(columns[columnIndex].columnType==BINARY);
 
-	Row *row = GetRowByIndex(rowIndex,0);
+	unsigned rowId;
+	Row *row = GetRowByIndex(rowIndex,&rowId);
 	if (row)
 	{
 		row->UpdateCell(columnIndex, byteLength, data);
+		UpdateIndex(columnIndex, rowId, row);
 		return true;
 	}
 	return false;
@@ -581,6 +597,7 @@ Table::FilterQuery::~FilterQuery()
 }
 Table::FilterQuery::FilterQuery(unsigned column, Cell *cell, FilterQueryType op)
 {
+	columnName[0]=0;
 	columnIndex=column;
 	cellValue=cell;
 	operation=op;
@@ -658,7 +675,20 @@ void Table::QueryTable(unsigned *columnIndicesSubset, unsigned numColumnSubset,
 		}
 	}
 
-	if (rowIds==0 || numRowIDs==0)
+	DataStructures::List<unsigned> candidateRowIds;
+	if ((rowIds==0 || numRowIDs==0) && QueryIndexes(inclusionFilterColumnIndices, inclusionFilters, candidateRowIds))
+	{
+		// Rows found by a secondary index. The other filters still need to be checked.
+		Row *row;
+		for (i=0; i < candidateRowIds.Size(); i++)
+		{
+			if (rows.Get(candidateRowIds[i], row))
+			{
+				QueryRow(inclusionFilterColumnIndices, columnIndicesToReturn, candidateRowIds[i], row, inclusionFilters, result);
+			}
+		}
+	}
+	else if (rowIds==0 || numRowIDs==0)
 	{
 		// All rows
 		DataStructures::Page<unsigned, Row*, _TABLE_BPLUS_TREE_ORDER> *cur = rows.GetListHead();
@@ -1072,6 +1102,7 @@ void Table::PrintRow(char *out, int outLength, char columnDelineator, bool print
 
 void Table::Clear(void)
 {
+	ClearIndexes();
 	rows.ForEachData(FreeRow);
 	rows.Clear();
 	columns.Clear(true, _FILE_AND_LINE_);
@@ -1144,5 +1175,513 @@ Table& Table::operator = ( const Table& input )
 		cur=cur->next;
 	}
 
+	for (i=0; i < input.GetColumnCount(); i++)
+	{
+		if (input.GetIndexType(i)!=INDEX_NONE)
+			AddIndex(i, input.GetIndexType(i));
+	}
+
 	return *this;
 }
+unsigned long Table::HashIndexKey(const uint64_t &key)
+{
+	uint64_t k=key;
+	k^=k>>33;
+	k*=0xff51afd7ed558ccdULL;
+	k^=k>>33;
+	return (unsigned long) k;
+}
+unsigned long Table::HashRowId(const unsigned &rowId)
+{
+	return rowId;
+}
+unsigned long Table::HashInternedString(const SLNet::RakString &str)
+{
+	return SLNet::RakString::ToInteger(str);
+}
+Table::SecondaryIndex::SecondaryIndex()
+{
+	indexType=INDEX_NONE;
+}
+Table::SecondaryIndex::~SecondaryIndex()
+{
+	DataStructures::List<RowIdList*> rowIdLists;
+	DataStructures::List<uint64_t> keys;
+	rowsByValue.GetAsList(rowIdLists, keys, _FILE_AND_LINE_);
+	for (unsigned i=0; i < rowIdLists.Size(); i++)
+		SLNet::OP_DELETE(rowIdLists[i], _FILE_AND_LINE_);
+}
+bool Table::AddIndex(unsigned columnIndex, IndexType indexType)
+{
+	if (columnIndex >= columns.Size())
+		return false;
+	if (indexType==INDEX_NONE)
+	{
+		RemoveIndex(columnIndex);
+		return true;
+	}
+	if (columns[columnIndex].columnType!=NUMERIC && columns[columnIndex].columnType!=STRING)
+		return false;
+
+	RemoveIndex(columnIndex);
+	SecondaryIndex *index = SLNet::OP_NEW<SecondaryIndex>(_FILE_AND_LINE_);
+	index->indexType=indexType;
+	secondaryIndexes[columnIndex]=index;
+
+	int i;
+	DataStructures::Page<unsigned, Row*, _TABLE_BPLUS_TREE_ORDER> *cur = rows.GetListHead();
+	if (indexType==INDEX_SORTED)
+	{
+		// Append all rows, then sort once
+		IndexKey key;
+		SortedIndexEntry entry;
+		while (cur)
+		{
+			for (i=0; i < cur->size; i++)
+			{
+				if (GetIndexKey(columnIndex, cur->data[i], &key)==false)
+					continue;
+				index->keyByRowId.Push(cur->keys[i], key, _FILE_AND_LINE_);
+				if (key.isUnordered)
+				{
+					index->unorderedRows.InsertAtEnd(cur->keys[i], _FILE_AND_LINE_);
+					continue;
+				}
+				entry.key=key;
+				entry.rowId=cur->keys[i];
+				index->sortedEntries.Insert(entry, _FILE_AND_LINE_);
+			}
+			cur=cur->next;
+		}
+
+		struct EntryComp
+		{
+			const Table *table;
+			ColumnType columnType;
+			bool operator()(const SortedIndexEntry &a, const SortedIndexEntry &b) const
+			{
+				return table->CompareIndexKey(columnType, a.key, a.rowId, b) < 0;
+			}
+		};
+		EntryComp entryComp;
+		entryComp.table=this;
+		entryComp.columnType=columns[columnIndex].columnType;
+		if (index->sortedEntries.Size() > 1)
+			std::sort(&index->sortedEntries[0], &index->sortedEntries[0]+index->sortedEntries.Size(), entryComp);
+	}
+	else
+	{
+		while (cur)
+		{
+			for (i=0; i < cur->size; i++)
+				AddRowToIndex(columnIndex, cur->keys[i], cur->data[i]);
+			cur=cur->next;
+		}
+	}
+	return true;
+}
+void Table::RemoveIndex(unsigned columnIndex)
+{
+	if (columnIndex >= secondaryIndexes.Size() || secondaryIndexes[columnIndex]==0)
+		return;
+
+	SecondaryIndex *index = secondaryIndexes[columnIndex];
+	DataStructures::List<IndexKey> keys;
+	DataStructures::List<unsigned> rowIds;
+	index->keyByRowId.GetAsList(keys, rowIds, _FILE_AND_LINE_);
+	for (unsigned i=0; i < keys.Size(); i++)
+	{
+		if (keys[i].stringId!=(unsigned) -1)
+			ReleaseInternedString(keys[i].stringId);
+	}
+	SLNet::OP_DELETE(index, _FILE_AND_LINE_);
+	secondaryIndexes[columnIndex]=0;
+}
+Table::IndexType Table::GetIndexType(unsigned columnIndex) const
+{
+	if (columnIndex >= secondaryIndexes.Size() || secondaryIndexes[columnIndex]==0)
+		return INDEX_NONE;
+	return secondaryIndexes[columnIndex]->indexType;
+}
+void Table::UpdateIndexes(unsigned rowId)
+{
+	Row *row = GetRowByID(rowId);
+	for (unsigned columnIndex=0; columnIndex < secondaryIndexes.Size(); columnIndex++)
+	{
+		if (secondaryIndexes[columnIndex]==0)
+			continue;
+		RemoveRowFromIndex(columnIndex, rowId);
+		if (row)
+			AddRowToIndex(columnIndex, rowId, row);
+	}
+}
+bool Table::GetIndexKey(unsigned columnIndex, Row *row, IndexKey *key)
+{
+	Cell *cell = row->cells[columnIndex];
+	if (cell->isEmpty)
+		return false;
+
+	key->numericValue=0.0;
+	key->stringId=(unsigned) -1;
+	if (columns[columnIndex].columnType==NUMERIC)
+	{
+		key->isUnordered=cell->i!=cell->i;
+		// 0.0 and -0.0 are equal but have different bits
+		if (cell->i!=0.0)
+			key->numericValue=cell->i;
+	}
+	else
+	{
+		key->isUnordered=cell->c==0;
+		if (cell->c)
+			key->stringId=InternString(cell->c);
+	}
+	return true;
+}
+uint64_t Table::GetHashIndexKey(ColumnType columnType, const IndexKey &key)
+{
+	if (columnType==STRING)
+		return key.stringId;
+	uint64_t bits;
+	memcpy(&bits, &key.numericValue, sizeof(bits));
+	return bits;
+}
+int Table::CompareIndexKey(ColumnType columnType, const IndexKey &key, unsigned rowId, const SortedIndexEntry &entry) const
+{
+	int result;
+	if (columnType==NUMERIC)
+	{
+		if (key.numericValue < entry.key.numericValue)
+			result=-1;
+		else if (key.numericValue > entry.key.numericValue)
+			result=1;
+		else
+			result=0;
+	}
+	else if (key.stringId==entry.key.stringId)
+		result=0;
+	else
+		result=strcmp(internedStrings[key.stringId].str.C_String(), internedStrings[entry.key.stringId].str.C_String());
+
+	if (result!=0)
+		return result;
+	if (rowId < entry.rowId)
+		return -1;
+	if (rowId > entry.rowId)
+		return 1;
+	return 0;
+}
+int Table::CompareIndexKey(ColumnType columnType, const Cell *value, const SortedIndexEntry &entry) const
+{
+	if (columnType==NUMERIC)
+	{
+		if (value->i < entry.key.numericValue)
+			return -1;
+		if (value->i > entry.key.numericValue)
+			return 1;
+		return 0;
+	}
+	return strcmp(value->c, internedStrings[entry.key.stringId].str.C_String());
+}
+unsigned Table::SortedIndexLowerBound(unsigned columnIndex, const Cell *value, bool afterEqual) const
+{
+	const DataStructures::List<SortedIndexEntry> &sortedEntries = secondaryIndexes[columnIndex]->sortedEntries;
+	ColumnType columnType = columns[columnIndex].columnType;
+	unsigned lower=0, upper=sortedEntries.Size();
+	while (lower < upper)
+	{
+		unsigned middle=(lower+upper)/2;
+		int result = CompareIndexKey(columnType, value, sortedEntries[middle]);
+		if (result > 0 || (afterEqual && result==0))
+			lower=middle+1;
+		else
+			upper=middle;
+	}
+	return lower;
+}
+void Table::AddRowToIndex(unsigned columnIndex, unsigned rowId, Row *row)
+{
+	SecondaryIndex *index = secondaryIndexes[columnIndex];
+	IndexKey key;
+	if (GetIndexKey(columnIndex, row, &key)==false)
+		return;
+
+	index->keyByRowId.Push(rowId, key, _FILE_AND_LINE_);
+	if (key.isUnordered)
+	{
+		index->unorderedRows.Insert(rowId, rowId, false, _FILE_AND_LINE_);
+		return;
+	}
+
+	ColumnType columnType = columns[columnIndex].columnType;
+	if (index->indexType==INDEX_SORTED)
+	{
+		unsigned lower=0, upper=index->sortedEntries.Size();
+		while (lower < upper)
+		{
+			unsigned middle=(lower+upper)/2;
+			if (CompareIndexKey(columnType, key, rowId, index->sortedEntries[middle]) > 0)
+				lower=middle+1;
+			else
+				upper=middle;
+		}
+		SortedIndexEntry entry;
+		entry.key=key;
+		entry.rowId=rowId;
+		index->sortedEntries.Insert(entry, lower, _FILE_AND_LINE_);
+	}
+	else
+	{
+		uint64_t hashKey = GetHashIndexKey(columnType, key);
+		RowIdList **rowIdList = index->rowsByValue.Peek(hashKey);
+		RowIdList *rowIds;
+		if (rowIdList)
+			rowIds=*rowIdList;
+		else
+		{
+			rowIds = SLNet::OP_NEW<RowIdList>(_FILE_AND_LINE_);
+			index->rowsByValue.Push(hashKey, rowIds, _FILE_AND_LINE_);
+		}
+		rowIds->Insert(rowId, rowId, false, _FILE_AND_LINE_);
+	}
+}
+void Table::RemoveRowFromIndex(unsigned columnIndex, unsigned rowId)
+{
+	SecondaryIndex *index = secondaryIndexes[columnIndex];
+	IndexKey key;
+	if (index->keyByRowId.Pop(key, rowId, _FILE_AND_LINE_)==false)
+		return;
+
+	ColumnType columnType = columns[columnIndex].columnType;
+	if (key.isUnordered)
+	{
+		index->unorderedRows.RemoveIfExists(rowId);
+	}
+	else if (index->indexType==INDEX_SORTED)
+	{
+		unsigned lower=0, upper=index->sortedEntries.Size();
+		while (lower < upper)
+		{
+			unsigned middle=(lower+upper)/2;
+			if (CompareIndexKey(columnType, key, rowId, index->sortedEntries[middle]) > 0)
+				lower=middle+1;
+			else
+				upper=middle;
+		}
+		RakAssert(lower < index->sortedEntries.Size() && index->sortedEntries[lower].rowId==rowId);
+		index->sortedEntries.RemoveAtIndex(lower);
+	}
+	else
+	{
+		uint64_t hashKey = GetHashIndexKey(columnType, key);
+		RowIdList **rowIdList = index->rowsByValue.Peek(hashKey);
+		RakAssert(rowIdList);
+		(*rowIdList)->RemoveIfExists(rowId);
+		if ((*rowIdList)->Size()==0)
+		{
+			RowIdList *rowIds=*rowIdList;
+			index->rowsByValue.Remove(hashKey, _FILE_AND_LINE_);
+			SLNet::OP_DELETE(rowIds, _FILE_AND_LINE_);
+		}
+	}
+
+	// Released last, the sorted index compares by the string
+	if (key.stringId!=(unsigned) -1)
+		ReleaseInternedString(key.stringId);
+}
+void Table::AddRowToIndexes(unsigned rowId, Row *row)
+{
+	for (unsigned columnIndex=0; columnIndex < secondaryIndexes.Size(); columnIndex++)
+	{
+		if (secondaryIndexes[columnIndex])
+			AddRowToIndex(columnIndex, rowId, row);
+	}
+}
+void Table::RemoveRowFromIndexes(unsigned rowId)
+{
+	for (unsigned columnIndex=0; columnIndex < secondaryIndexes.Size(); columnIndex++)
+	{
+		if (secondaryIndexes[columnIndex])
+			RemoveRowFromIndex(columnIndex, rowId);
+	}
+}
+void Table::UpdateIndex(unsigned columnIndex, unsigned rowId, Row *row)
+{
+	if (secondaryIndexes[columnIndex]==0)
+		return;
+	RemoveRowFromIndex(columnIndex, rowId);
+	AddRowToIndex(columnIndex, rowId, row);
+}
+void Table::ClearIndexes(void)
+{
+	for (unsigned columnIndex=0; columnIndex < secondaryIndexes.Size(); columnIndex++)
+	{
+		if (secondaryIndexes[columnIndex])
+			SLNet::OP_DELETE(secondaryIndexes[columnIndex], _FILE_AND_LINE_);
+	}
+	secondaryIndexes.Clear(false, _FILE_AND_LINE_);
+	internedStrings.Clear(false, _FILE_AND_LINE_);
+	freeInternedStringIds.Clear(false, _FILE_AND_LINE_);
+	internedStringIds.Clear(_FILE_AND_LINE_);
+}
+bool Table::QueryIndexes(DataStructures::List<unsigned> &inclusionFilterColumnIndices, FilterQuery *inclusionFilters, DataStructures::List<unsigned> &candidateRowIds)
+{
+	SecondaryIndex *bestIndex=0;
+	unsigned bestCount=(unsigned) -1;
+	// INDEX_SORTED: Range of sortedEntries. INDEX_HASH: bestRowIds, 0 if no row has the value.
+	unsigned bestFirst=0, bestLast=0;
+	RowIdList *bestRowIds=0;
+
+	unsigned j, k;
+	for (j=0; j < inclusionFilterColumnIndices.Size(); j++)
+	{
+		unsigned columnIndex = inclusionFilterColumnIndices[j];
+		if (columnIndex==(unsigned) -1 || secondaryIndexes[columnIndex]==0)
+			continue;
+		SecondaryIndex *index = secondaryIndexes[columnIndex];
+		const Cell *value = inclusionFilters[j].cellValue;
+		FilterQueryType operation = inclusionFilters[j].operation;
+		// Rows fail comparisons with NaN. Filters with a null string are ignored by QueryRow().
+		if (columns[columnIndex].columnType==NUMERIC ? value->i!=value->i : value->c==0)
+			continue;
+
+		if (index->indexType==INDEX_HASH)
+		{
+			if (operation!=QF_EQUAL)
+				continue;
+
+			RowIdList *rowIds=0;
+			IndexKey key;
+			key.numericValue=value->i==0.0 ? 0.0 : value->i;
+			key.stringId=columns[columnIndex].columnType==STRING ? FindInternedString(value->c) : 0;
+			if (key.stringId!=(unsigned) -1)
+			{
+				RowIdList **rowIdList = index->rowsByValue.Peek(GetHashIndexKey(columns[columnIndex].columnType, key));
+				if (rowIdList)
+					rowIds=*rowIdList;
+			}
+			unsigned count = (rowIds ? rowIds->Size() : 0) + index->unorderedRows.Size();
+			if (count < bestCount)
+			{
+				bestIndex=index;
+				bestCount=count;
+				bestRowIds=rowIds;
+			}
+		}
+		else
+		{
+			// Intersect the ranges of all filters on this column
+			unsigned first=0, last=index->sortedEntries.Size();
+			bool anyRange=false;
+			for (k=j; k < inclusionFilterColumnIndices.Size(); k++)
+			{
+				if (inclusionFilterColumnIndices[k]!=columnIndex)
+					continue;
+				value = inclusionFilters[k].cellValue;
+				if (columns[columnIndex].columnType==NUMERIC ? value->i!=value->i : value->c==0)
+					continue;
+				switch (inclusionFilters[k].operation)
+				{
+				case QF_EQUAL:
+					first=std::max(first, SortedIndexLowerBound(columnIndex, value, false));
+					last=std::min(last, SortedIndexLowerBound(columnIndex, value, true));
+					break;
+				case QF_GREATER_THAN:
+					first=std::max(first, SortedIndexLowerBound(columnIndex, value, true));
+					break;
+				case QF_GREATER_THAN_EQ:
+					first=std::max(first, SortedIndexLowerBound(columnIndex, value, false));
+					break;
+				case QF_LESS_THAN:
+					last=std::min(last, SortedIndexLowerBound(columnIndex, value, false));
+					break;
+				case QF_LESS_THAN_EQ:
+					last=std::min(last, SortedIndexLowerBound(columnIndex, value, true));
+					break;
+				default:
+					continue;
+				}
+				anyRange=true;
+			}
+			if (anyRange==false)
+				continue;
+			if (last < first)
+				last=first;
+
+			unsigned count = last-first + index->unorderedRows.Size();
+			if (count < bestCount)
+			{
+				bestIndex=index;
+				bestCount=count;
+				bestFirst=first;
+				bestLast=last;
+			}
+		}
+	}
+
+	if (bestIndex==0)
+		return false;
+
+	unsigned i;
+	if (bestIndex->indexType==INDEX_SORTED)
+	{
+		for (i=bestFirst; i < bestLast; i++)
+			candidateRowIds.Insert(bestIndex->sortedEntries[i].rowId, _FILE_AND_LINE_);
+	}
+	else if (bestRowIds)
+	{
+		for (i=0; i < bestRowIds->Size(); i++)
+			candidateRowIds.Insert((*bestRowIds)[i], _FILE_AND_LINE_);
+	}
+	for (i=0; i < bestIndex->unorderedRows.Size(); i++)
+		candidateRowIds.Insert(bestIndex->unorderedRows[i], _FILE_AND_LINE_);
+
+	// Rows are added to the result in increasing order, as they are when scanning
+	if (candidateRowIds.Size() > 1 && (bestIndex->indexType==INDEX_SORTED || bestIndex->unorderedRows.Size() > 0))
+		std::sort(&candidateRowIds[0], &candidateRowIds[0]+candidateRowIds.Size());
+	return true;
+}
+unsigned Table::InternString(const char *str)
+{
+	SLNet::RakString rakString = SLNet::RakString::NonVariadic(str);
+	unsigned *existingId = internedStringIds.Peek(rakString);
+	if (existingId)
+	{
+		internedStrings[*existingId].refCount++;
+		return *existingId;
+	}
+
+	InternedString internedString;
+	internedString.str=rakString;
+	internedString.refCount=1;
+	unsigned stringId;
+	if (freeInternedStringIds.Size() > 0)
+	{
+		stringId=freeInternedStringIds.Pop();
+		internedStrings[stringId]=internedString;
+	}
+	else
+	{
+		stringId=internedStrings.Size();
+		internedStrings.Insert(internedString, _FILE_AND_LINE_);
+	}
+	internedStringIds.Push(rakString, stringId, _FILE_AND_LINE_);
+	return stringId;
+}
+unsigned Table::FindInternedString(const char *str)
+{
+	unsigned *existingId = internedStringIds.Peek(SLNet::RakString::NonVariadic(str));
+	if (existingId)
+		return *existingId;
+	return (unsigned) -1;
+}
+void Table::ReleaseInternedString(unsigned stringId)
+{
+	InternedString &internedString = internedStrings[stringId];
+	RakAssert(internedString.refCount > 0);
+	if (--internedString.refCount > 0)
+		return;
+	internedStringIds.Remove(internedString.str, _FILE_AND_LINE_);
+	internedString.str.Clear();
+	freeInternedStringIds.Insert(stringId, _FILE_AND_LINE_);
+}
@@ -45,6 +45,9 @@
 #include "slikenet/BitStream.h"
 #include "slikenet/FileOperations.h"
 #include "slikenet/SuperFastHash.h"
+#include "slikenet/thread.h"
+#include "slikenet/SimpleMutex.h"
+#include "slikenet/SignaledEvent.h"
 #include "..\include\slikenet\slikeAssert.h"
 #include "slikenet/LinuxStrings.h"
 #include "slikenet/linux_adapter.h"
@@ -109,6 +112,7 @@ void FLP_Printf::OnSendAborted( SystemAddress systemAddress )
 }
 FileList::FileList()
 {
+	numHashThreads=1;
 }
 FileList::~FileList()
 {
@@ -225,6 +229,128 @@ void FileList::AddFile(const char *filename, const char *fullPathToFile, const c
 		
 	fileList.Insert(n, _FILE_AND_LINE_);
 }
+// A file found by AddFilesFromDirectory(), read and hashed by one of the hash threads
+struct HashFileJob
+{
+	char *fullPath;
+	unsigned int fileLength;
+	char *fileData;
+	unsigned int hash;
+	bool readFailed;
+};
+struct HashFileContext
+{
+	DataStructures::List<HashFileJob> *jobs;
+	bool writeData;
+	SimpleMutex nextJobMutex;
+	unsigned int nextJob;
+	// Counted under the mutex, so that the event is no longer used once AddHashedFiles() sees all threads finished
+	SimpleMutex threadsFinishedMutex;
+	unsigned int threadsFinished;
+	SignaledEvent threadFinishedEvent;
+};
+static void HashFileJobs(HashFileContext *hashFileContext)
+{
+	for (;;)
+	{
+		hashFileContext->nextJobMutex.Lock();
+		unsigned int jobIndex=hashFileContext->nextJob;
+		if (jobIndex < hashFileContext->jobs->Size())
+			hashFileContext->nextJob++;
+		hashFileContext->nextJobMutex.Unlock();
+		if (jobIndex >= hashFileContext->jobs->Size())
+			return;
+
+		HashFileJob &job = (*hashFileContext->jobs)[jobIndex];
+		if (hashFileContext->writeData)
+		{
+			// Same as the single threaded path: the hash followed by the file data
+			FILE *fp;
+			if (fopen_s(&fp, job.fullPath, "rb") == 0)
+			{
+				job.fileData= (char*) rakMalloc_Ex( job.fileLength+HASH_LENGTH, _FILE_AND_LINE_ );
+				RakAssert(job.fileData);
+				fread(job.fileData+HASH_LENGTH, job.fileLength, 1, fp);
+				fclose(fp);
+				job.hash = SuperFastHash(job.fileData+HASH_LENGTH, job.fileLength);
+			}
+			else
+				job.readFailed=true;
+		}
+		else
+			job.hash = SuperFastHashFile(job.fullPath);
+
+		if (SLNet::BitStream::DoEndianSwap())
+			SLNet::BitStream::ReverseBytesInPlace((unsigned char*) &job.hash, sizeof(job.hash));
+		if (job.fileData)
+			memcpy(job.fileData, &job.hash, HASH_LENGTH);
+	}
+}
+RAK_THREAD_DECLARATION(HashFileThread)
+{
+	HashFileContext *hashFileContext = (HashFileContext*) arguments;
+	HashFileJobs(hashFileContext);
+	hashFileContext->threadsFinishedMutex.Lock();
+	hashFileContext->threadsFinished++;
+	hashFileContext->threadFinishedEvent.SetEvent();
+	hashFileContext->threadsFinishedMutex.Unlock();
+	return 0;
+}
+static void AddHashedFiles(FileList *fileList, DataStructures::List<HashFileJob> &jobs, unsigned int numHashThreads, bool writeData, int rootLen, FileListNodeContext context)
+{
+	if (jobs.Size()==0)
+		return;
+
+	HashFileContext hashFileContext;
+	hashFileContext.jobs=&jobs;
+	hashFileContext.writeData=writeData;
+	hashFileContext.nextJob=0;
+	hashFileContext.threadsFinished=0;
+	hashFileContext.threadFinishedEvent.InitEvent();
+
+	unsigned int numThreads=numHashThreads;
+	if (numThreads > jobs.Size())
+		numThreads=jobs.Size();
+	unsigned int threadsStarted=0;
+	for (unsigned int i=1; i < numThreads; i++)
+	{
+		if (SLNet::RakThread::Create(HashFileThread, &hashFileContext)==0)
+			threadsStarted++;
+	}
+	// The calling thread works too, and does all the work if no thread could be started
+	HashFileJobs(&hashFileContext);
+	for (;;)
+	{
+		hashFileContext.threadsFinishedMutex.Lock();
+		bool allFinished = hashFileContext.threadsFinished==threadsStarted;
+		hashFileContext.threadsFinishedMutex.Unlock();
+		if (allFinished)
+			break;
+		hashFileContext.threadFinishedEvent.WaitOnEvent(1000);
+	}
+	hashFileContext.threadFinishedEvent.CloseEvent();
+
+	// Add in the order the files were found
+	for (unsigned int i=0; i < jobs.Size(); i++)
+	{
+		HashFileJob &job = jobs[i];
+		if (writeData)
+		{
+			// File data and hash
+			if (job.readFailed==false)
+				fileList->AddFile((const char*)job.fullPath+rootLen, job.fullPath, job.fileData, job.fileLength+HASH_LENGTH, job.fileLength, context);
+		}
+		else
+		{
+			// Hash only
+			fileList->AddFile((const char*)job.fullPath+rootLen, job.fullPath, (const char*)&job.hash, HASH_LENGTH, job.fileLength, context);
+		}
+		if (job.fileData)
+			rakFree_Ex(job.fileData, _FILE_AND_LINE_ );
+		rakFree_Ex(job.fullPath, _FILE_AND_LINE_ );
+	}
+	jobs.Clear(false, _FILE_AND_LINE_);
+}
 void FileList::AddFilesFromDirectory(const char *applicationDirectory, const char *subDirectory, bool writeHash, bool writeData, bool recursive, FileListNodeContext context)
 {
 
@@ -237,6 +363,9 @@ void FileList::AddFilesFromDirectory(const char *applicationDirectory, const cha
 	intptr_t dir;
 	FILE *fp;
 	char *dirSoFar, *fileData;
+	// With more than one hash thread, files are only listed here and read by AddHashedFiles()
+	bool hashOnThreads = writeHash && numHashThreads > 1;
+	DataStructures::List<HashFileJob> hashJobs;
 	dirSoFar=(char*) rakMalloc_Ex( 520, _FILE_AND_LINE_ );
 	RakAssert(dirSoFar);
 
@@ -280,6 +409,7 @@ void FileList::AddFilesFromDirectory(const char *applicationDirectory, const cha
 			unsigned i;
 			for (i=0; i < dirList.Size(); i++)
 				rakFree_Ex(dirList[i], _FILE_AND_LINE_ );
+			AddHashedFiles(this, hashJobs, numHashThreads, writeData, rootLen, context);
 			return;
 		}
 
@@ -305,7 +435,20 @@ void FileList::AddFilesFromDirectory(const char *applicationDirectory, const cha
 				for (unsigned int flpcIndex=0; flpcIndex < fileListProgressCallbacks.Size(); flpcIndex++)
 					fileListProgressCallbacks[flpcIndex]->OnFile(this, dirSoFar, fileInfo.name, fileInfo.size);
 
-				if (writeData && writeHash)
+				if (hashOnThreads)
+				{
+					HashFileJob job;
+					size_t fullPathLength = strlen(fullPath)+1;
+					job.fullPath=(char*) rakMalloc_Ex( fullPathLength, _FILE_AND_LINE_ );
+					RakAssert(job.fullPath);
+					memcpy(job.fullPath, fullPath, fullPathLength);
+					job.fileLength=(unsigned int) fileInfo.size;
+					job.fileData=0;
+					job.hash=0;
+					job.readFailed=false;
+					hashJobs.Insert(job, _FILE_AND_LINE_);
+				}
+				else if (writeData && writeHash)
 				{
 					if (fopen_s(&fp, fullPath, "rb") == 0)
 					{
@@ -377,6 +520,13 @@ void FileList::AddFilesFromDirectory(const char *applicationDirectory, const cha
 		rakFree_Ex(dirSoFar, _FILE_AND_LINE_ );
 	}
 
+	AddHashedFiles(this, hashJobs, numHashThreads, writeData, rootLen, context);
+}
+void FileList::SetNumHashThreads(unsigned int numThreads)
+{
+	if (numThreads==0)
+		numThreads=1;
+	numHashThreads=numThreads;
 }
 void FileList::Clear(void)
 {
@@ -641,18 +791,14 @@ void FileList::PopulateDataFromDisk(const char *applicationDirectory, bool write
 					}
 					else
 					{
-						// Hash only
+						// Hash only. Hash the file in blocks so it is never held in memory as a whole
 						fileList[i].dataLengthBytes=HASH_LENGTH;
-						if (fileList[i].fileLengthBytes < HASH_LENGTH)
-							fileList[i].data=(char*) rakMalloc_Ex( HASH_LENGTH, _FILE_AND_LINE_ );
-						else
-							fileList[i].data=(char*) rakMalloc_Ex( fileList[i].fileLengthBytes, _FILE_AND_LINE_ );
+						fileList[i].data=(char*) rakMalloc_Ex( HASH_LENGTH, _FILE_AND_LINE_ );
 						RakAssert(fileList[i].data);
-						fread(fileList[i].data, fileList[i].fileLengthBytes, 1, fp);
 				//		sha1.Reset();
 				//		sha1.Update((unsigned char*)fileList[i].data, fileList[i].fileLength);
 				//		sha1.Final();
-						unsigned int hash = SuperFastHash(fileList[i].data, fileList[i].fileLengthBytes);
+						unsigned int hash = SuperFastHashFilePtr(fp);
 						if (SLNet::BitStream::DoEndianSwap())
 							SLNet::BitStream::ReverseBytesInPlace((unsigned char*) &hash, sizeof(hash));
 						// memcpy(fileList[i].data, sha1.GetHash(), HASH_LENGTH);
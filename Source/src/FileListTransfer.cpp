@@ -27,8 +27,12 @@
 #include "slikenet/peerinterface.h"
 #include "slikenet/statistics.h"
 #include "slikenet/IncrementalReadInterface.h"
+#include "slikenet/IncrementalWriteInterface.h"
+#include "slikenet/DS_OrderedList.h"
 #include "..\include\slikenet\slikeAssert.h"
 #include "..\include\slikenet\slikeAlloca.h"
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
 
 namespace SLNet
 {
@@ -36,6 +40,47 @@ namespace SLNet
 struct FLR_MemoryBlock
 {
 	char *flrMemoryBlock;
+	// Used instead of flrMemoryBlock when the receiver has an IncrementalWriteInterface
+	void *writeHandle;
+};
+
+struct FLR_MissingChunk
+{
+	const unsigned char *hash;
+	unsigned int chunkIndex;
+};
+
+static int FLR_MissingChunkComp(const unsigned char * const &key, const FLR_MissingChunk &data)
+{
+	return memcmp(key, data.hash, SHA1_LENGTH);
+}
+
+// A file sent with FileListTransfer::SendChunked()
+struct FLR_ChunkedFile
+{
+	char fileName[512];
+	FileListNodeContext context;
+	unsigned int fileLength;
+	DataStructures::List<ChunkSignature> chunks;
+	// One entry per chunk, true once the chunk is written
+	DataStructures::List<bool> chunkPresent;
+	unsigned int chunksMissing;
+	unsigned int bytesPresent;
+	unsigned int hashFailures;
+	// Written through the receiver's IncrementalWriteInterface, or assembled here
+	void *writeHandle;
+	char *fileData;
+
+	// While scanning, the partial and the old file are searched for chunks a block per Update(), and nothing is requested yet
+	bool scanning;
+	unsigned int scanIndex;
+	unsigned int scanOffset;
+	ContentDefinedChunker *scanChunker;
+	DataStructures::OrderedList<const unsigned char*, FLR_MissingChunk, FLR_MissingChunkComp> missingChunks;
+	char *chunkBuff;
+	char *scanBuff;
+	SystemAddress senderSystemAddress;
+	RakNetGUID senderGuid;
 };
 
 struct FileListReceiver
@@ -54,6 +99,8 @@ struct FileListReceiver
 	bool isCompressed;
 	int  filesReceived;
 	DataStructures::Map<unsigned int, FLR_MemoryBlock> pushedFiles;
+	IncrementalWriteInterface *incrementalWriteInterface;
+	DataStructures::Map<unsigned int, FLR_ChunkedFile*> chunkedFiles;
 
 	// Notifications
 	unsigned int partLength;
@@ -64,20 +111,157 @@ struct FileListReceiver
 
 using namespace SLNet;
 
-FileListReceiver::FileListReceiver() {filesReceived=0; setTotalDownloadedLength=0; partLength=1; DataStructures::Map<unsigned int, FLR_MemoryBlock>::IMPLEMENT_DEFAULT_COMPARISON();}
+// Second byte of ID_FILE_LIST_CHUNKED_TRANSFER
+enum ChunkedTransferMessage
+{
+	CTM_MANIFEST,
+	CTM_REQUEST,
+	CTM_CHUNK,
+	CTM_CHUNK_ACK,
+};
+
+// Give up on a file if this many chunks did not match the manifest
+static const unsigned int MAX_CHUNK_HASH_FAILURES=8;
+// Block size used to read whole files when computing or comparing chunks
+static const unsigned int CHUNK_SCAN_BLOCK_SIZE=1048576;
+// Same as NUMBER_OF_ORDERED_STREAMS
+static const int MAX_ORDERING_CHANNELS=32;
+
+static void FLR_DeleteChunkedFile(FLR_ChunkedFile *chunkedFile)
+{
+	SLNet::OP_DELETE(chunkedFile->scanChunker, _FILE_AND_LINE_);
+	rakFree_Ex(chunkedFile->chunkBuff, _FILE_AND_LINE_ );
+	rakFree_Ex(chunkedFile->scanBuff, _FILE_AND_LINE_ );
+	SLNet::OP_DELETE(chunkedFile, _FILE_AND_LINE_);
+}
+
+static void FLR_MarkChunkPresent(FLR_ChunkedFile *chunkedFile, unsigned int chunkIndex)
+{
+	chunkedFile->chunkPresent[chunkIndex]=true;
+	chunkedFile->chunksMissing--;
+	chunkedFile->bytesPresent+=chunkedFile->chunks[chunkIndex].length;
+}
+
+// Does one step of marking the chunks that are already in the partial file, and copying chunks that did not change from the old version of the file
+// Each step reads about CHUNK_SCAN_BLOCK_SIZE bytes. Returns true once the scan is done.
+static bool FLR_ScanStep(IncrementalWriteInterface *incrementalWriteInterface, FLR_ChunkedFile *chunkedFile)
+{
+	unsigned char hash[SHA1_LENGTH];
+	unsigned int i;
+
+	// Left by an interrupted earlier transfer
+	unsigned int bytesScanned=0;
+	while (chunkedFile->scanIndex < chunkedFile->chunks.Size() && bytesScanned < CHUNK_SCAN_BLOCK_SIZE)
+	{
+		i=chunkedFile->scanIndex++;
+		const ChunkSignature &chunkSignature = chunkedFile->chunks[i];
+		bytesScanned+=chunkSignature.length;
+		if (incrementalWriteInterface->ReadFilePart(chunkedFile->writeHandle, chunkSignature.offset, chunkSignature.length, chunkedFile->chunkBuff)==chunkSignature.length)
+		{
+			ContentDefinedChunker::HashChunk(chunkedFile->chunkBuff, chunkSignature.length, hash);
+			if (memcmp(hash, chunkSignature.hash, SHA1_LENGTH)==0)
+			{
+				FLR_MarkChunkPresent(chunkedFile, i);
+				continue;
+			}
+		}
+		FLR_MissingChunk missingChunk;
+		missingChunk.hash=chunkSignature.hash;
+		missingChunk.chunkIndex=i;
+		// Repeated chunks are only looked up once
+		chunkedFile->missingChunks.Insert(missingChunk.hash, missingChunk, false, _FILE_AND_LINE_);
+	}
+	if (chunkedFile->scanIndex < chunkedFile->chunks.Size())
+		return false;
+	if (chunkedFile->missingChunks.Size()==0)
+		return true;
+
+	// The chunker finds the same boundaries in the old version of the file, except around the parts that changed
+	if (chunkedFile->scanBuff==0)
+	{
+		chunkedFile->scanBuff = (char*) rakMalloc_Ex(CHUNK_SCAN_BLOCK_SIZE, _FILE_AND_LINE_);
+		if (chunkedFile->scanBuff==0)
+		{
+			notifyOutOfMemory(_FILE_AND_LINE_);
+			return true;
+		}
+		chunkedFile->scanChunker = SLNet::OP_NEW<ContentDefinedChunker>(_FILE_AND_LINE_);
+	}
+	DataStructures::List<ChunkSignature> oldChunks;
+	unsigned int bytesRead = incrementalWriteInterface->ReadExistingFilePart(chunkedFile->fileName, chunkedFile->scanOffset, CHUNK_SCAN_BLOCK_SIZE, chunkedFile->scanBuff, chunkedFile->context);
+	chunkedFile->scanChunker->Update(chunkedFile->scanBuff, bytesRead, oldChunks);
+	chunkedFile->scanOffset+=bytesRead;
+	bool endOfFile = bytesRead<CHUNK_SCAN_BLOCK_SIZE;
+	if (endOfFile)
+		chunkedFile->scanChunker->Final(oldChunks);
+
+	for (i=0; i < oldChunks.Size(); i++)
+	{
+		bool objectExists;
+		unsigned int index = chunkedFile->missingChunks.GetIndexFromKey(oldChunks[i].hash, &objectExists);
+		if (objectExists==false)
+			continue;
+		const ChunkSignature &chunkSignature = chunkedFile->chunks[chunkedFile->missingChunks[index].chunkIndex];
+		if (chunkSignature.length==oldChunks[i].length &&
+			incrementalWriteInterface->ReadExistingFilePart(chunkedFile->fileName, oldChunks[i].offset, oldChunks[i].length, chunkedFile->chunkBuff, chunkedFile->context)==oldChunks[i].length &&
+			incrementalWriteInterface->WriteFilePart(chunkedFile->writeHandle, chunkSignature.offset, chunkedFile->chunkBuff, chunkSignature.length))
+		{
+			FLR_MarkChunkPresent(chunkedFile, chunkedFile->missingChunks[index].chunkIndex);
+			chunkedFile->missingChunks.RemoveAtIndex(index);
+		}
+	}
+	return endOfFile || chunkedFile->missingChunks.Size()==0;
+}
+
+FileListReceiver::FileListReceiver() {filesReceived=0; setTotalDownloadedLength=0; partLength=1; incrementalWriteInterface=0; DataStructures::Map<unsigned int, FLR_MemoryBlock>::IMPLEMENT_DEFAULT_COMPARISON(); DataStructures::Map<unsigned int, FLR_ChunkedFile*>::IMPLEMENT_DEFAULT_COMPARISON();}
 FileListReceiver::~FileListReceiver() {
 	unsigned int i=0;
 	for (i=0; i < pushedFiles.Size(); i++)
+	{
 		rakFree_Ex(pushedFiles[i].flrMemoryBlock, _FILE_AND_LINE_ );
+		if (pushedFiles[i].writeHandle)
+			incrementalWriteInterface->CloseFile(pushedFiles[i].writeHandle, false);
+	}
+	for (i=0; i < chunkedFiles.Size(); i++)
+	{
+		if (chunkedFiles[i]->writeHandle)
+			incrementalWriteInterface->CloseFile(chunkedFiles[i]->writeHandle, false);
+		rakFree_Ex(chunkedFiles[i]->fileData, _FILE_AND_LINE_ );
+		FLR_DeleteChunkedFile(chunkedFiles[i]);
+	}
 }
 
 STATIC_FACTORY_DEFINITIONS(FileListTransfer,FileListTransfer)
 
+void FileListTransfer::FileToPush::DeleteThis(void)
+{
+	if (holdsFileReference)
+		incrementalReadInterface->ReleaseFileReference(fileListNode.fullPathToFile, fileListNode.context);
+	SLNet::OP_DELETE(this,_FILE_AND_LINE_);
+}
+const char *FileListTransfer::FileToPush::ReadChunk(unsigned int *bytesRead, void **buff)
+{
+	// Read straight from the interface's memory if it offers it, avoiding the copy into buff
+	if (holdsFileReference)
+	{
+		const char *filePart = incrementalReadInterface->GetFilePartPointer(fileListNode.fullPathToFile, currentOffset, chunkSize, bytesRead, fileListNode.context);
+		if (filePart)
+			return filePart;
+	}
+	if (*buff==0)
+	{
+		*buff = rakMalloc_Ex(chunkSize, _FILE_AND_LINE_);
+		if (*buff==0)
+			return 0;
+	}
+	*bytesRead=incrementalReadInterface->GetFilePart(fileListNode.fullPathToFile, currentOffset, chunkSize, *buff, fileListNode.context);
+	return (const char*) *buff;
+}
 void FileListTransfer::FileToPushRecipient::DeleteThis(void)
 {
 ////	filesToPushMutex.Lock();
 	for (unsigned int j=0; j < filesToPush.Size(); j++)
-		SLNet::OP_DELETE(filesToPush[j],_FILE_AND_LINE_);
+		filesToPush[j]->DeleteThis();
 ////	filesToPushMutex.Unlock();
 	SLNet::OP_DELETE(this,_FILE_AND_LINE_);
 }
@@ -115,7 +299,7 @@ void FileListTransfer::StartIncrementalReadThreads(int numThreads, int threadPri
 
 	threadPool.StartThreads(numThreads, 0);
 }
-unsigned short FileListTransfer::SetupReceive(FileListTransferCBInterface *handler, bool deleteHandler, SystemAddress allowedSender)
+unsigned short FileListTransfer::SetupReceive(FileListTransferCBInterface *handler, bool deleteHandler, SystemAddress allowedSender, IncrementalWriteInterface *_incrementalWriteInterface)
 {
 	if (rakPeerInterface && rakPeerInterface->GetConnectionState(allowedSender)!=IS_CONNECTED)
 		return (unsigned short)-1;
@@ -138,6 +322,7 @@ unsigned short FileListTransfer::SetupReceive(FileListTransferCBInterface *handl
 	receiver->allowedSender=allowedSender;
 	receiver->gotSetHeader=false;
 	receiver->deleteDownloadHandler=deleteHandler;
+	receiver->incrementalWriteInterface=_incrementalWriteInterface;
 	receiver->setID=setId;
 	fileListReceivers.Set(setId, receiver);
 	oldId=setId;
@@ -200,6 +385,7 @@ void FileListTransfer::Send(FileList *fileList, SLNet::RakPeerInterface *rakPeer
 				fileToPush->currentOffset=0;
 				fileToPush->incrementalReadInterface=_incrementalReadInterface;
 				fileToPush->chunkSize=_chunkSize;
+				fileToPush->holdsFileReference=_incrementalReadInterface->AddFileReference(fileToPush->fileListNode.fullPathToFile, fileToPush->fileListNode.context);
 				filesToPush.Push(fileToPush,_FILE_AND_LINE_);
 			}
 			else
@@ -278,6 +464,111 @@ void FileListTransfer::Send(FileList *fileList, SLNet::RakPeerInterface *rakPeer
 	}
 }
 
+void FileListTransfer::SendChunked(FileList *fileList, SystemAddress recipient, unsigned short setID, PacketPriority priority, char orderingChannel, int numOrderingChannels, IncrementalReadInterface *_incrementalReadInterface, unsigned int maxChunksInFlight)
+{
+	for (unsigned int flpcIndex=0; flpcIndex < fileListProgressCallbacks.Size(); flpcIndex++)
+		fileList->AddCallback(fileListProgressCallbacks[flpcIndex]);
+
+	if (numOrderingChannels<1)
+		numOrderingChannels=1;
+	if (orderingChannel+numOrderingChannels>MAX_ORDERING_CHANNELS)
+		numOrderingChannels=MAX_ORDERING_CHANNELS-orderingChannel;
+	if (maxChunksInFlight==0)
+		maxChunksInFlight=1;
+
+	unsigned int i, totalLength;
+	totalLength=0;
+	for (i=0; i < fileList->fileList.Size(); i++)
+		totalLength+=fileList->fileList[i].dataLengthBytes;
+
+	// The recipient handles the set header the same way as for Send()
+	SLNet::BitStream outBitstream;
+	bool anythingToWrite;
+	outBitstream.Write((MessageID)ID_FILE_LIST_TRANSFER_HEADER);
+	outBitstream.Write(setID);
+	anythingToWrite=fileList->fileList.Size()>0;
+	outBitstream.Write(anythingToWrite);
+	if (anythingToWrite==false)
+	{
+		for (unsigned int flpcIndex=0; flpcIndex < fileListProgressCallbacks.Size(); flpcIndex++)
+			fileListProgressCallbacks[flpcIndex]->OnFilePushesComplete(recipient, setID);
+		SendUnified(&outBitstream, priority, RELIABLE_ORDERED, orderingChannel, recipient, false);
+		return;
+	}
+	outBitstream.WriteCompressed(fileList->fileList.Size());
+	outBitstream.WriteCompressed(totalLength);
+	SendUnified(&outBitstream, priority, RELIABLE_ORDERED, orderingChannel, recipient, false);
+
+	// Sending the same set again, for example to resume after reconnecting, replaces the earlier send
+	unsigned int existingIndex = GetChunkedSendIndex(recipient, setID);
+	if (existingIndex!=(unsigned int)-1)
+	{
+		DeleteChunkedSend(chunkedSends[existingIndex]);
+		chunkedSends.RemoveAtIndex(existingIndex);
+	}
+
+	ChunkedSend *chunkedSend = SLNet::OP_NEW<ChunkedSend>(_FILE_AND_LINE_);
+	chunkedSend->systemAddress=recipient;
+	chunkedSend->setId=setID;
+	chunkedSend->packetPriority=priority;
+	chunkedSend->orderingChannel=orderingChannel;
+	chunkedSend->numOrderingChannels=numOrderingChannels;
+	chunkedSend->incrementalReadInterface=_incrementalReadInterface;
+	chunkedSend->maxChunksInFlight=maxChunksInFlight;
+	chunkedSend->chunksInFlight=0;
+	chunkedSend->nextFileIndex=0;
+
+	for (i=0; i < fileList->fileList.Size(); i++)
+	{
+		const FileListNode &fileListNode = fileList->fileList[i];
+		ChunkedSendFile *chunkedSendFile = SLNet::OP_NEW<ChunkedSendFile>(_FILE_AND_LINE_);
+		chunkedSendFile->filename=fileListNode.filename;
+		chunkedSendFile->fullPathToFile=fileListNode.fullPathToFile;
+		chunkedSendFile->context=fileListNode.context;
+		chunkedSendFile->setIndex=i;
+		chunkedSendFile->fileLengthBytes=fileListNode.dataLengthBytes;
+		chunkedSendFile->data=0;
+		chunkedSendFile->holdsFileReference=false;
+		chunkedSendFile->gotRequest=false;
+		if (fileListNode.isAReference && _incrementalReadInterface!=0)
+		{
+			chunkedSendFile->holdsFileReference=_incrementalReadInterface->AddFileReference(chunkedSendFile->fullPathToFile, chunkedSendFile->context);
+		}
+		else if (fileListNode.dataLengthBytes>0)
+		{
+			chunkedSendFile->data = (char*) rakMalloc_Ex(fileListNode.dataLengthBytes, _FILE_AND_LINE_);
+			if (chunkedSendFile->data==0)
+			{
+				notifyOutOfMemory(_FILE_AND_LINE_);
+				chunkedSendFile->fileLengthBytes=0;
+			}
+			else
+				memcpy(chunkedSendFile->data, fileListNode.data, fileListNode.dataLengthBytes);
+		}
+		ComputeChunks(chunkedSend, chunkedSendFile);
+		chunkedSend->files.Push(chunkedSendFile, _FILE_AND_LINE_);
+
+		outBitstream.Reset();
+		outBitstream.Write((MessageID)ID_FILE_LIST_CHUNKED_TRANSFER);
+		outBitstream.Write((MessageID)CTM_MANIFEST);
+		outBitstream.Write(setID);
+		outBitstream << chunkedSendFile->context;
+		StringCompressor::Instance()->EncodeString(chunkedSendFile->filename, 512, &outBitstream);
+		outBitstream.WriteCompressed(chunkedSendFile->setIndex);
+		outBitstream.WriteCompressed(chunkedSendFile->fileLengthBytes);
+		outBitstream.WriteCompressed(chunkedSendFile->chunks.Size());
+		for (unsigned int chunkIndex=0; chunkIndex < chunkedSendFile->chunks.Size(); chunkIndex++)
+		{
+			outBitstream.WriteCompressed(chunkedSendFile->chunks[chunkIndex].length);
+			outBitstream.WriteAlignedBytes(chunkedSendFile->chunks[chunkIndex].hash, SHA1_LENGTH);
+		}
+		SendUnified(&outBitstream, priority, RELIABLE_ORDERED, orderingChannel, recipient, false);
+	}
+
+	// Chunks are sent once the recipient requested them
+	chunkedSends.Push(chunkedSend, _FILE_AND_LINE_);
+}
+
 bool FileListTransfer::DecodeSetHeader(Packet *packet)
 {
 	bool anythingToWrite=false;
@@ -433,6 +724,25 @@ bool FileListTransfer::DecodeFile(Packet *packet, bool isTheFullFile)
 		fps.senderGuid=packet->guid;
 		fileListReceiver->downloadHandler->OnFileProgress(&fps);
 
+		if (fileListReceiver->incrementalWriteInterface)
+		{
+			// Small files sent along with reference pushes arrive whole, write them the same way
+			void *writeHandle=fileListReceiver->incrementalWriteInterface->OpenFile(onFileStruct.fileName, onFileStruct.byteLengthOfThisFile, onFileStruct.context);
+			bool written=false;
+			if (writeHandle)
+			{
+				written=fileListReceiver->incrementalWriteInterface->WriteFilePart(writeHandle, 0, onFileStruct.fileData, onFileStruct.byteLengthOfThisFile);
+				if (fileListReceiver->incrementalWriteInterface->CloseFile(writeHandle, written)==false)
+					written=false;
+			}
+			if (written==false)
+			{
+				rakFree_Ex(onFileStruct.fileData, _FILE_AND_LINE_ );
+				CancelReceive(onFileStruct.setID);
+				return false;
+			}
+		}
+
 		// Got a complete file
 		// Either we are using IncrementalReadInterface and it was a small file or
 		// We are not using IncrementalReadInterface
@@ -506,6 +816,28 @@ PluginReceiveResult FileListTransfer::OnReceive(Packet *packet)
 	case ID_FILE_LIST_REFERENCE_PUSH_ACK:
 		OnReferencePushAck(packet);
 		return RR_STOP_PROCESSING_AND_DEALLOCATE;
+	case ID_FILE_LIST_CHUNKED_TRANSFER:
+		if (packet->length>sizeof(MessageID))
+		{
+			SLNet::BitStream inBitStream(packet->data, packet->length, false);
+			inBitStream.IgnoreBytes(sizeof(MessageID)*2);
+			switch (packet->data[sizeof(MessageID)])
+			{
+			case CTM_MANIFEST:
+				OnChunkedManifest(packet, &inBitStream);
+				break;
+			case CTM_REQUEST:
+				OnChunkedRequest(packet, &inBitStream);
+				break;
+			case CTM_CHUNK:
+				OnChunkedChunk(packet, &inBitStream);
+				break;
+			case CTM_CHUNK_ACK:
+				OnChunkedChunkAck(packet, &inBitStream);
+				break;
+			}
+		}
+		return RR_STOP_PROCESSING_AND_DEALLOCATE;
 	case ID_DOWNLOAD_PROGRESS:
 		if (packet->length>sizeof(MessageID)+sizeof(unsigned int)*3)
 		{
@@ -519,6 +851,9 @@ PluginReceiveResult FileListTransfer::OnReceive(Packet *packet)
 				OnReferencePush(packet, false);
 				return RR_STOP_PROCESSING_AND_DEALLOCATE;
 			}
+			// Chunks are small, progress is reported per chunk instead
+			if (packet->data[sizeof(MessageID)+sizeof(unsigned int)*3]==ID_FILE_LIST_CHUNKED_TRANSFER)
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
 		}
 		break;
 	}
@@ -553,6 +888,10 @@ void FileListTransfer::Clear(void)
 	fileToPushRecipientList.Clear(false,_FILE_AND_LINE_);
 	fileToPushRecipientListMutex.Unlock();
 
+	for (i=0; i < chunkedSends.Size(); i++)
+		DeleteChunkedSend(chunkedSends[i]);
+	chunkedSends.Clear(false,_FILE_AND_LINE_);
+
 	//filesToPush.Clear(false, _FILE_AND_LINE_);
 }
 void FileListTransfer::OnClosedConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, PI2_LostConnectionReason lostConnectionReason )
@@ -631,6 +970,21 @@ void FileListTransfer::RemoveReceiver(SystemAddress systemAddress)
 		}
 	}
 	fileToPushRecipientListMutex.Unlock();
+
+	i=0;
+	while (i < chunkedSends.Size())
+	{
+		if (chunkedSends[i]->systemAddress==systemAddress)
+		{
+			for (unsigned int flpcIndex=0; flpcIndex < fileListProgressCallbacks.Size(); flpcIndex++)
+				fileListProgressCallbacks[flpcIndex]->OnSendAborted(chunkedSends[i]->systemAddress);
+
+			DeleteChunkedSend(chunkedSends[i]);
+			chunkedSends.RemoveAtIndex(i);
+		}
+		else
+			i++;
+	}
 }
 bool FileListTransfer::IsHandlerActive(unsigned short inSetId)
 {
@@ -662,6 +1016,32 @@ void FileListTransfer::GetCallbacks(DataStructures::List<FileListProgress*> &cal
 void FileListTransfer::Update(void)
 {
 	unsigned i;
+	i=0;
+	while (i < fileListReceivers.Size())
+	{
+		// Look for chunks already on disk, for files sent with SendChunked()
+		FileListReceiver *fileListReceiver = fileListReceivers[i];
+		bool receiverDeleted=false;
+		unsigned int j=0;
+		while (j < fileListReceiver->chunkedFiles.Size())
+		{
+			unsigned int setIndex = fileListReceiver->chunkedFiles.GetKeyAtIndex(j);
+			FLR_ChunkedFile *chunkedFile = fileListReceiver->chunkedFiles[j];
+			if (chunkedFile->scanning && FLR_ScanStep(fileListReceiver->incrementalWriteInterface, chunkedFile))
+			{
+				unsigned int numChunkedFiles = fileListReceiver->chunkedFiles.Size();
+				receiverDeleted=OnChunkedScanComplete(fileListReceiver, setIndex);
+				if (receiverDeleted)
+					break;
+				if (fileListReceiver->chunkedFiles.Size()<numChunkedFiles)
+					continue;
+			}
+			j++;
+		}
+		if (receiverDeleted==false)
+			i++;
+	}
+
 	i=0;
 	while (i < fileListReceivers.Size())
 	{
@@ -760,16 +1140,30 @@ void FileListTransfer::OnReferencePush(Packet *packet, bool isTheFullFile)
 	FLR_MemoryBlock mb;
 	if (fileListReceiver->pushedFiles.Has(onFileStruct.fileIndex)==false)
 	{
-		if (onFileStruct.byteLengthOfThisFile <= SLNET_MAX_RETRIEVABLE_FILESIZE)
+		// With an IncrementalWriteInterface chunks go straight to their final offset, so the file is never held in memory
+		if (fileListReceiver->incrementalWriteInterface==0 && onFileStruct.byteLengthOfThisFile <= SLNET_MAX_RETRIEVABLE_FILESIZE)
 			mb.flrMemoryBlock = (char*)rakMalloc_Ex(onFileStruct.byteLengthOfThisFile, _FILE_AND_LINE_);
 		else
 			mb.flrMemoryBlock = nullptr;
+		mb.writeHandle=0;
 		fileListReceiver->pushedFiles.SetNew(onFileStruct.fileIndex, mb);
 	}
 	else
 	{
 		mb=fileListReceiver->pushedFiles.Get(onFileStruct.fileIndex);
 	}
+
+	if (isTheFullFile && fileListReceiver->incrementalWriteInterface && mb.writeHandle==0)
+	{
+		// Progress notifications may have created the entry already, so open on the first complete chunk
+		mb.writeHandle=fileListReceiver->incrementalWriteInterface->OpenFile(onFileStruct.fileName, onFileStruct.byteLengthOfThisFile, onFileStruct.context);
+		if (mb.writeHandle==0)
+		{
+			CancelReceive(onFileStruct.setID);
+			return;
+		}
+		fileListReceiver->pushedFiles.Set(onFileStruct.fileIndex, mb);
+	}
 	
 	unsigned int unreadBits = inBitStream.GetNumberOfUnreadBits();
 	unsigned int unreadBytes = BITS_TO_BYTES(unreadBits);
@@ -785,7 +1179,17 @@ void FileListTransfer::OnReferencePush(Packet *packet, bool isTheFullFile)
 
 	if (isTheFullFile)
 	{
-		if (mb.flrMemoryBlock)
+		if (mb.writeHandle)
+		{
+			fps.iriDataChunk=(char*) inBitStream.GetData()+BITS_TO_BYTES(inBitStream.GetReadOffset());
+			// The file can no longer complete, so give up on the set rather than reporting it in OnFile()
+			if (fileListReceiver->incrementalWriteInterface->WriteFilePart(mb.writeHandle, offset, fps.iriDataChunk, amountToRead)==false)
+			{
+				CancelReceive(onFileStruct.setID);
+				return;
+			}
+		}
+		else if (mb.flrMemoryBlock)
 		{
 			// Either the very first block, or a subsequent block and allocateIrIDataChunkAutomatically was true for the first block
 			memcpy(mb.flrMemoryBlock+offset, inBitStream.GetData()+BITS_TO_BYTES(inBitStream.GetReadOffset()), amountToRead);
@@ -849,6 +1253,20 @@ void FileListTransfer::OnReferencePush(Packet *packet, bool isTheFullFile)
 			fps.onFileStruct->fileData=fps.iriDataChunk;
 		fileListReceiver->downloadHandler->OnFileProgress(&fps);
 
+		// The file is complete on disk before OnFile is called
+		if (mb.writeHandle)
+		{
+			bool closed=fileListReceiver->incrementalWriteInterface->CloseFile(mb.writeHandle, true);
+			// Closed already, so the receiver must not close it again
+			mb.writeHandle=0;
+			fileListReceiver->pushedFiles.Set(onFileStruct.fileIndex, mb);
+			if (closed==false)
+			{
+				CancelReceive(onFileStruct.setID);
+				return;
+			}
+		}
+
 		// Incremental read interface sent us a file chunk
 		// This is the last file chunk we were waiting for to consider the file done
 		if (fileListReceiver->downloadHandler->OnFile(&onFileStruct))
@@ -946,6 +1364,7 @@ int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutp
 
 	// Was previously using GetStatistics to get outgoing buffer size, but TCP with UnifiedSend doesn't have this
 	unsigned int bytesRead;	
+	const char *filePart;
 	const char *dataBlocks[2];
 	int lengths[2];
 	unsigned int smallFileTotalSize=0;
@@ -969,8 +1388,9 @@ int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutp
 			////ftpr->filesToPushMutex.Unlock();
 
 			// Read and send chunk. If done, delete at this index
-			void *buff = rakMalloc_Ex(ftp->chunkSize, _FILE_AND_LINE_);
-			if (buff==0)
+			void *buff = 0;
+			filePart = ftp->ReadChunk(&bytesRead, &buff);
+			if (filePart==0)
 			{
 				////ftpr->filesToPushMutex.Lock();
 				ftpr->filesToPush.PushAtHead(ftp,0,_FILE_AND_LINE_);
@@ -981,9 +1401,6 @@ int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutp
 				return 0;
 			}
 
-			// Read the next file chunk
-			bytesRead=ftp->incrementalReadInterface->GetFilePart(ftp->fileListNode.fullPathToFile, ftp->currentOffset, ftp->chunkSize, buff, ftp->fileListNode.context);
-
 			bool done = ftp->fileListNode.dataLengthBytes == ftp->currentOffset+bytesRead;
 			while (done && ftp->currentOffset==0 && smallFileTotalSize<ftp->chunkSize)
 			{
@@ -1008,21 +1425,26 @@ int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutp
 				outBitstream.AlignWriteToByteBoundary();
 				dataBlocks[0]=(char*) outBitstream.GetData();
 				lengths[0]=outBitstream.GetNumberOfBytesUsed();
-				dataBlocks[1]=(const char*) buff;
+				dataBlocks[1]=filePart;
 				lengths[1]=bytesRead;
 
 				fileListTransfer->SendListUnified(dataBlocks,lengths,2,ftp->packetPriority, RELIABLE_ORDERED, ftp->orderingChannel, systemAddress, false);
 
 				// LWS : fixed freed pointer reference
 //				unsigned int chunkSize = ftp->chunkSize;
-				SLNet::OP_DELETE(ftp,_FILE_AND_LINE_);
+				ftp->DeleteThis();
 				smallFileTotalSize+=bytesRead;
 				//done = bytesRead!=ftp->chunkSize;
 				////ftpr->filesToPushMutex.Lock();
 				ftp = ftpr->filesToPush.Pop();
 				////ftpr->filesToPushMutex.Unlock();
 
-				bytesRead=ftp->incrementalReadInterface->GetFilePart(ftp->fileListNode.fullPathToFile, ftp->currentOffset, ftp->chunkSize, buff, ftp->fileListNode.context);
+				filePart = ftp->ReadChunk(&bytesRead, &buff);
+				if (filePart==0)
+				{
+					notifyOutOfMemory(_FILE_AND_LINE_);
+					bytesRead=0;
+				}
 				done = ftp->fileListNode.dataLengthBytes == ftp->currentOffset+bytesRead;
 			}
 
@@ -1045,18 +1467,23 @@ int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutp
 
 			dataBlocks[0]=(char*) outBitstream.GetData();
 			lengths[0]=outBitstream.GetNumberOfBytesUsed();
-			dataBlocks[1]=(char*) buff;
+			dataBlocks[1]=filePart;
 			lengths[1]=bytesRead;
 			//rakPeerInterface->SendList(dataBlocks,lengths,2,ftp->packetPriority, RELIABLE_ORDERED, ftp->orderingChannel, ftp->systemAddress, false);
 			char orderingChannel = ftp->orderingChannel;
 			PacketPriority packetPriority = ftp->packetPriority;
 
 			// Mutex state: FileToPushRecipient (ftpr) has AddRef. fileToPushRecipientListMutex not locked.
+			// filePart may point into memory owned by the file reference of ftp, so do not delete ftp until sent
+			FileListTransfer::FileToPush *finishedFtp=0;
+			IncrementalReadInterface *referencedInterface=0;
+			SLNet::RakString referencedFile;
+			FileListNodeContext referencedContext;
 			if (done)
 			{
 				// Done
 				//unsigned short setId = ftp->setID;
-				SLNet::OP_DELETE(ftp,_FILE_AND_LINE_);
+				finishedFtp=ftp;
 
 				////ftpr->filesToPushMutex.Lock();
 				if (ftpr->filesToPush.Size()==0)
@@ -1076,6 +1503,13 @@ int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutp
 			}
 			else
 			{
+				// Once back in the queue ftp may be cancelled from another thread, so hold a reference of our own until sent
+				if (filePart!=buff && ftp->incrementalReadInterface->AddFileReference(ftp->fileListNode.fullPathToFile, ftp->fileListNode.context))
+				{
+					referencedInterface=ftp->incrementalReadInterface;
+					referencedFile=ftp->fileListNode.fullPathToFile;
+					referencedContext=ftp->fileListNode.context;
+				}
 				////ftpr->filesToPushMutex.Lock();
 				ftpr->filesToPush.PushAtHead(ftp,0,_FILE_AND_LINE_);
 				////ftpr->filesToPushMutex.Unlock();
@@ -1087,6 +1521,10 @@ int SendIRIToAddressCB(FileListTransfer::ThreadData threadData, bool *returnOutp
 			// See http://www.jenkinssoftware.com/forum/index.php?topic=4768.msg19738#msg19738
 			fileListTransfer->SendListUnified(dataBlocks,lengths,2, packetPriority, RELIABLE_ORDERED, orderingChannel, systemAddress, false);
 
+			if (finishedFtp)
+				finishedFtp->DeleteThis();
+			if (referencedInterface)
+				referencedInterface->ReleaseFileReference(referencedFile, referencedContext);
 			rakFree_Ex(buff, _FILE_AND_LINE_ );
 			return 0;
 		}
@@ -1156,8 +1594,550 @@ unsigned int FileListTransfer::GetPendingFilesToAddress(SystemAddress recipient)
 		}
 	}
 	fileToPushRecipientListMutex.Unlock();
+
+	unsigned int chunkedFilesPending=0;
+	for (unsigned int i=0; i < chunkedSends.Size(); i++)
+	{
+		if (chunkedSends[i]->systemAddress==recipient)
+		{
+			for (unsigned int fileIndex=0; fileIndex < chunkedSends[i]->files.Size(); fileIndex++)
+			{
+				if (chunkedSends[i]->files[fileIndex]->gotRequest==false || chunkedSends[i]->files[fileIndex]->chunksToSend.IsEmpty()==false)
+					chunkedFilesPending++;
+			}
+		}
+	}
 	
-	return 0;
+	return chunkedFilesPending;
+}
+
+/*
+SendChunked - executes on the sender
+1. Send ID_FILE_LIST_TRANSFER_HEADER, as Send() does
+2. For each file, compute content-defined chunks and send CTM_MANIFEST with the length and hash of every chunk
+
+Recipient, OnChunkedManifest():
+Open the file, find chunks already present in the partial file or the old version of the file, send CTM_REQUEST with the others
+
+File sender, OnChunkedRequest():
+Queue the requested chunks, send up to maxChunksInFlight CTM_CHUNK spread over the ordering channels
+
+Recipient, OnChunkedChunk():
+Verify the hash, write the chunk, send CTM_CHUNK_ACK. Request the chunk again if the hash did not match.
+
+File sender, OnChunkedChunkAck():
+Send the next chunk. When all files were requested and all chunks acknowledged, call OnFilePushesComplete()
+*/
+
+bool FileListTransfer::ComputeChunks(ChunkedSend *chunkedSend, ChunkedSendFile *chunkedSendFile)
+{
+	ContentDefinedChunker chunker;
+	unsigned int offset=0;
+	bool success=true;
+	if (chunkedSendFile->data)
+	{
+		chunker.Update(chunkedSendFile->data, chunkedSendFile->fileLengthBytes, chunkedSendFile->chunks);
+		offset=chunkedSendFile->fileLengthBytes;
+	}
+	else if (chunkedSend->incrementalReadInterface)
+	{
+		char *buff=0;
+		while (offset < chunkedSendFile->fileLengthBytes)
+		{
+			unsigned int numBytesToRead = chunkedSendFile->fileLengthBytes-offset;
+			if (numBytesToRead > CHUNK_SCAN_BLOCK_SIZE)
+				numBytesToRead=CHUNK_SCAN_BLOCK_SIZE;
+			unsigned int bytesRead=0;
+			const char *block=0;
+			if (chunkedSendFile->holdsFileReference)
+				block=chunkedSend->incrementalReadInterface->GetFilePartPointer(chunkedSendFile->fullPathToFile, offset, numBytesToRead, &bytesRead, chunkedSendFile->context);
+			if (block==0)
+			{
+				if (buff==0)
+				{
+					buff = (char*) rakMalloc_Ex(CHUNK_SCAN_BLOCK_SIZE, _FILE_AND_LINE_);
+					if (buff==0)
+					{
+						notifyOutOfMemory(_FILE_AND_LINE_);
+						success=false;
+						break;
+					}
+				}
+				bytesRead=chunkedSend->incrementalReadInterface->GetFilePart(chunkedSendFile->fullPathToFile, offset, numBytesToRead, buff, chunkedSendFile->context);
+				block=buff;
+			}
+			if (bytesRead==0)
+			{
+				success=false;
+				break;
+			}
+			chunker.Update(block, bytesRead, chunkedSendFile->chunks);
+			offset+=bytesRead;
+		}
+		rakFree_Ex(buff, _FILE_AND_LINE_ );
+	}
+	chunker.Final(chunkedSendFile->chunks);
+
+	// If the file could not be read completely, send what was read
+	chunkedSendFile->fileLengthBytes=offset;
+	return success;
+}
+void FileListTransfer::SendChunks(unsigned int chunkedSendIndex)
+{
+	ChunkedSend *chunkedSend = chunkedSends[chunkedSendIndex];
+	SLNet::BitStream outBitstream;
+	const char *dataBlocks[2];
+	int lengths[2];
+	unsigned int i;
+
+	while (chunkedSend->chunksInFlight < chunkedSend->maxChunksInFlight)
+	{
+		// Serve the files round robin, so all files make progress
+		ChunkedSendFile *chunkedSendFile=0;
+		for (i=0; i < chunkedSend->files.Size(); i++)
+		{
+			unsigned int fileIndex = (chunkedSend->nextFileIndex+i) % chunkedSend->files.Size();
+			if (chunkedSend->files[fileIndex]->chunksToSend.IsEmpty()==false)
+			{
+				chunkedSendFile=chunkedSend->files[fileIndex];
+				chunkedSend->nextFileIndex=fileIndex+1;
+				break;
+			}
+		}
+		if (chunkedSendFile==0)
+			break;
+
+		unsigned int chunkIndex = chunkedSendFile->chunksToSend.Pop();
+		const ChunkSignature &chunkSignature = chunkedSendFile->chunks[chunkIndex];
+
+		const char *chunkData=0;
+		char *buff=0;
+		unsigned int bytesRead=chunkSignature.length;
+		if (chunkedSendFile->data)
+			chunkData=chunkedSendFile->data+chunkSignature.offset;
+		else
+		{
+			if (chunkedSendFile->holdsFileReference)
+				chunkData=chunkedSend->incrementalReadInterface->GetFilePartPointer(chunkedSendFile->fullPathToFile, chunkSignature.offset, chunkSignature.length, &bytesRead, chunkedSendFile->context);
+			if (chunkData==0)
+			{
+				buff = (char*) rakMalloc_Ex(chunkSignature.length, _FILE_AND_LINE_);
+				if (buff==0)
+				{
+					chunkedSendFile->chunksToSend.PushAtHead(chunkIndex, 0, _FILE_AND_LINE_);
+					notifyOutOfMemory(_FILE_AND_LINE_);
+					break;
+				}
+				bytesRead=chunkedSend->incrementalReadInterface->GetFilePart(chunkedSendFile->fullPathToFile, chunkSignature.offset, chunkSignature.length, buff, chunkedSendFile->context);
+				chunkData=buff;
+			}
+		}
+
+		outBitstream.Reset();
+		outBitstream.Write((MessageID)ID_FILE_LIST_CHUNKED_TRANSFER);
+		outBitstream.Write((MessageID)CTM_CHUNK);
+		outBitstream.Write(chunkedSend->setId);
+		outBitstream.WriteCompressed(chunkedSendFile->setIndex);
+		outBitstream.WriteCompressed(chunkIndex);
+		outBitstream.AlignWriteToByteBoundary();
+		dataBlocks[0]=(char*) outBitstream.GetData();
+		lengths[0]=outBitstream.GetNumberOfBytesUsed();
+		dataBlocks[1]=chunkData;
+		lengths[1]=bytesRead;
+
+		for (unsigned int flpcIndex=0; flpcIndex < fileListProgressCallbacks.Size(); flpcIndex++)
+			fileListProgressCallbacks[flpcIndex]->OnFilePush(chunkedSendFile->filename, chunkedSendFile->fileLengthBytes, chunkSignature.offset, bytesRead, chunkedSendFile->chunksToSend.IsEmpty(), chunkedSend->systemAddress, chunkedSend->setId);
+
+		// Independent chunks go on different ordering channels, so a lost datagram only holds up the chunks on its own channel
+		char orderingChannel = (char) (chunkedSend->orderingChannel + chunkIndex % chunkedSend->numOrderingChannels);
+		SendListUnified(dataBlocks,lengths,2, chunkedSend->packetPriority, RELIABLE_ORDERED, orderingChannel, chunkedSend->systemAddress, false);
+		rakFree_Ex(buff, _FILE_AND_LINE_ );
+		chunkedSend->chunksInFlight++;
+	}
+
+	if (chunkedSend->chunksInFlight>0)
+		return;
+	for (i=0; i < chunkedSend->files.Size(); i++)
+	{
+		if (chunkedSend->files[i]->gotRequest==false || chunkedSend->files[i]->chunksToSend.IsEmpty()==false)
+			return;
+	}
+
+	for (unsigned int flpcIndex=0; flpcIndex < fileListProgressCallbacks.Size(); flpcIndex++)
+		fileListProgressCallbacks[flpcIndex]->OnFilePushesComplete(chunkedSend->systemAddress, chunkedSend->setId);
+	DeleteChunkedSend(chunkedSend);
+	chunkedSends.RemoveAtIndex(chunkedSendIndex);
+}
+void FileListTransfer::DeleteChunkedSend(ChunkedSend *chunkedSend)
+{
+	for (unsigned int i=0; i < chunkedSend->files.Size(); i++)
+	{
+		ChunkedSendFile *chunkedSendFile = chunkedSend->files[i];
+		if (chunkedSendFile->holdsFileReference)
+			chunkedSend->incrementalReadInterface->ReleaseFileReference(chunkedSendFile->fullPathToFile, chunkedSendFile->context);
+		rakFree_Ex(chunkedSendFile->data, _FILE_AND_LINE_ );
+		SLNet::OP_DELETE(chunkedSendFile, _FILE_AND_LINE_);
+	}
+	SLNet::OP_DELETE(chunkedSend, _FILE_AND_LINE_);
+}
+unsigned int FileListTransfer::GetChunkedSendIndex(SystemAddress systemAddress, unsigned short inSetId) const
+{
+	for (unsigned int i=0; i < chunkedSends.Size(); i++)
+	{
+		if (chunkedSends[i]->systemAddress==systemAddress && chunkedSends[i]->setId==inSetId)
+			return i;
+	}
+	return (unsigned int) -1;
+}
+void FileListTransfer::OnChunkedRequest(Packet *packet, SLNet::BitStream *inBitStream)
+{
+	unsigned short curSetId;
+	unsigned int setIndex, numChunks, chunkIndex;
+	inBitStream->Read(curSetId);
+	inBitStream->ReadCompressed(setIndex);
+	if (inBitStream->ReadCompressed(numChunks)==false)
+		return;
+
+	unsigned int chunkedSendIndex = GetChunkedSendIndex(packet->systemAddress, curSetId);
+	if (chunkedSendIndex==(unsigned int)-1)
+		return;
+	ChunkedSend *chunkedSend = chunkedSends[chunkedSendIndex];
+	if (setIndex >= chunkedSend->files.Size())
+		return;
+	ChunkedSendFile *chunkedSendFile = chunkedSend->files[setIndex];
+	for (unsigned int i=0; i < numChunks; i++)
+	{
+		if (inBitStream->ReadCompressed(chunkIndex)==false)
+			break;
+		if (chunkIndex < chunkedSendFile->chunks.Size())
+			chunkedSendFile->chunksToSend.Push(chunkIndex, _FILE_AND_LINE_);
+	}
+	chunkedSendFile->gotRequest=true;
+	SendChunks(chunkedSendIndex);
+}
+void FileListTransfer::OnChunkedChunkAck(Packet *packet, SLNet::BitStream *inBitStream)
+{
+	unsigned short curSetId;
+	if (inBitStream->Read(curSetId)==false)
+		return;
+	unsigned int chunkedSendIndex = GetChunkedSendIndex(packet->systemAddress, curSetId);
+	if (chunkedSendIndex==(unsigned int)-1)
+		return;
+	if (chunkedSends[chunkedSendIndex]->chunksInFlight>0)
+		chunkedSends[chunkedSendIndex]->chunksInFlight--;
+	SendChunks(chunkedSendIndex);
+}
+void FileListTransfer::SendChunkedRequest(SystemAddress systemAddress, unsigned short inSetId, unsigned int setIndex, const DataStructures::List<unsigned int> &chunkIndices)
+{
+	SLNet::BitStream outBitstream;
+	outBitstream.Write((MessageID)ID_FILE_LIST_CHUNKED_TRANSFER);
+	outBitstream.Write((MessageID)CTM_REQUEST);
+	outBitstream.Write(inSetId);
+	outBitstream.WriteCompressed(setIndex);
+	outBitstream.WriteCompressed(chunkIndices.Size());
+	for (unsigned int i=0; i < chunkIndices.Size(); i++)
+		outBitstream.WriteCompressed(chunkIndices[i]);
+	// Ordered with the chunk acks, so the sender sees a repeated request before it considers the set done
+	SendUnified(&outBitstream,HIGH_PRIORITY, RELIABLE_ORDERED, 0, systemAddress, false);
+}
+
+void FileListTransfer::OnChunkedManifest(Packet *packet, SLNet::BitStream *inBitStream)
+{
+	unsigned short curSetId;
+	FileListNodeContext context;
+	char fileName[512];
+	unsigned int setIndex, fileLength, numChunks;
+	inBitStream->Read(curSetId);
+	*inBitStream >> context;
+	if (StringCompressor::Instance()->DecodeString(fileName, 512, inBitStream)==false)
+		return;
+	inBitStream->ReadCompressed(setIndex);
+	inBitStream->ReadCompressed(fileLength);
+	if (inBitStream->ReadCompressed(numChunks)==false)
+		return;
+	// Only the last chunk may be shorter than MIN_CHUNK_SIZE
+	if (numChunks > fileLength/ContentDefinedChunker::MIN_CHUNK_SIZE+1)
+		return;
+
+	if (fileListReceivers.Has(curSetId)==false)
+		return;
+	FileListReceiver *fileListReceiver=fileListReceivers.Get(curSetId);
+	if (fileListReceiver->allowedSender!=packet->systemAddress)
+	{
+#ifdef _DEBUG
+		RakAssert(0);
+#endif
+		return;
+	}
+	if (fileListReceiver->chunkedFiles.Has(setIndex))
+		return;
+
+	FLR_ChunkedFile *chunkedFile = SLNet::OP_NEW<FLR_ChunkedFile>(_FILE_AND_LINE_);
+	strcpy_s(chunkedFile->fileName, fileName);
+	chunkedFile->context=context;
+	chunkedFile->fileLength=fileLength;
+	chunkedFile->chunksMissing=numChunks;
+	chunkedFile->bytesPresent=0;
+	chunkedFile->hashFailures=0;
+	chunkedFile->writeHandle=0;
+	chunkedFile->fileData=0;
+	chunkedFile->scanning=false;
+	chunkedFile->scanIndex=0;
+	chunkedFile->scanOffset=0;
+	chunkedFile->scanChunker=0;
+	chunkedFile->chunkBuff=0;
+	chunkedFile->scanBuff=0;
+	chunkedFile->senderSystemAddress=packet->systemAddress;
+	chunkedFile->senderGuid=packet->guid;
+	// The chunks are contiguous, so they cannot overlap, and must end exactly at fileLength
+	unsigned int offset=0;
+	for (unsigned int i=0; i < numChunks; i++)
+	{
+		ChunkSignature chunkSignature;
+		chunkSignature.offset=offset;
+		inBitStream->ReadCompressed(chunkSignature.length);
+		if (inBitStream->ReadAlignedBytes(chunkSignature.hash, SHA1_LENGTH)==false ||
+			chunkSignature.length==0 || chunkSignature.length > ContentDefinedChunker::MAX_CHUNK_SIZE ||
+			chunkSignature.length > fileLength-offset)
+		{
+			FLR_DeleteChunkedFile(chunkedFile);
+			return;
+		}
+		offset+=chunkSignature.length;
+		chunkedFile->chunks.Push(chunkSignature, _FILE_AND_LINE_);
+		chunkedFile->chunkPresent.Push(false, _FILE_AND_LINE_);
+	}
+	if (offset!=fileLength)
+	{
+		FLR_DeleteChunkedFile(chunkedFile);
+		return;
+	}
+
+	if (fileListReceiver->incrementalWriteInterface)
+		chunkedFile->writeHandle=fileListReceiver->incrementalWriteInterface->OpenFile(fileName, fileLength, context);
+	if (chunkedFile->writeHandle)
+	{
+		// Reading the partial and old file can take long, so it is done over the following calls to Update()
+		chunkedFile->chunkBuff = (char*) rakMalloc_Ex(ContentDefinedChunker::MAX_CHUNK_SIZE, _FILE_AND_LINE_);
+		if (chunkedFile->chunkBuff)
+			chunkedFile->scanning=true;
+		else
+			notifyOutOfMemory(_FILE_AND_LINE_);
+	}
+	else if (fileLength>0)
+	{
+		chunkedFile->fileData = (char*) rakMalloc_Ex(fileLength, _FILE_AND_LINE_);
+		if (chunkedFile->fileData==0)
+		{
+			notifyOutOfMemory(_FILE_AND_LINE_);
+			FLR_DeleteChunkedFile(chunkedFile);
+			return;
+		}
+	}
+	fileListReceiver->chunkedFiles.Set(setIndex, chunkedFile);
+
+	if (chunkedFile->scanning==false)
+		OnChunkedScanComplete(fileListReceiver, setIndex);
+}
+bool FileListTransfer::OnChunkedScanComplete(FileListReceiver *fileListReceiver, unsigned int setIndex)
+{
+	FLR_ChunkedFile *chunkedFile = fileListReceiver->chunkedFiles.Get(setIndex);
+	chunkedFile->scanning=false;
+	SLNet::OP_DELETE(chunkedFile->scanChunker, _FILE_AND_LINE_);
+	chunkedFile->scanChunker=0;
+	rakFree_Ex(chunkedFile->scanBuff, _FILE_AND_LINE_ );
+	chunkedFile->scanBuff=0;
+	chunkedFile->missingChunks.Clear(false, _FILE_AND_LINE_);
+	fileListReceiver->setTotalDownloadedLength+=chunkedFile->bytesPresent;
+
+	DataStructures::List<unsigned int> chunkIndices;
+	for (unsigned int i=0; i < chunkedFile->chunks.Size(); i++)
+	{
+		if (chunkedFile->chunkPresent[i]==false)
+			chunkIndices.Push(i, _FILE_AND_LINE_);
+	}
+	// Always sent, even if empty, so the sender knows the file is handled
+	SendChunkedRequest(chunkedFile->senderSystemAddress, fileListReceiver->setID, setIndex, chunkIndices);
+
+	if (chunkedFile->chunksMissing==0)
+		return OnChunkedFileComplete(fileListReceiver, setIndex);
+	return false;
+}
+void FileListTransfer::OnChunkedChunk(Packet *packet, SLNet::BitStream *inBitStream)
+{
+	unsigned short curSetId;
+	unsigned int setIndex, chunkIndex;
+	inBitStream->Read(curSetId);
+	inBitStream->ReadCompressed(setIndex);
+	if (inBitStream->ReadCompressed(chunkIndex)==false)
+		return;
+	inBitStream->AlignReadToByteBoundary();
+	const char *chunkData = (const char*) inBitStream->GetData()+BITS_TO_BYTES(inBitStream->GetReadOffset());
+	unsigned int chunkLength = BITS_TO_BYTES(inBitStream->GetNumberOfUnreadBits());
+
+	if (fileListReceivers.Has(curSetId)==false)
+		return;
+	FileListReceiver *fileListReceiver=fileListReceivers.Get(curSetId);
+	if (fileListReceiver->allowedSender!=packet->systemAddress)
+	{
+#ifdef _DEBUG
+		RakAssert(0);
+#endif
+		return;
+	}
+
+	SLNet::BitStream chunkAck;
+	chunkAck.Write((MessageID)ID_FILE_LIST_CHUNKED_TRANSFER);
+	chunkAck.Write((MessageID)CTM_CHUNK_ACK);
+	chunkAck.Write(curSetId);
+
+	if (fileListReceiver->chunkedFiles.Has(setIndex)==false)
+	{
+		SendUnified(&chunkAck,HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->systemAddress, false);
+		return;
+	}
+	FLR_ChunkedFile *chunkedFile = fileListReceiver->chunkedFiles.Get(setIndex);
+	// Chunks are only requested once the scan is done
+	if (chunkedFile->scanning || chunkIndex >= chunkedFile->chunks.Size() || chunkedFile->chunkPresent[chunkIndex])
+	{
+		SendUnified(&chunkAck,HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->systemAddress, false);
+		return;
+	}
+
+	const ChunkSignature &chunkSignature = chunkedFile->chunks[chunkIndex];
+	bool chunkVerified=false;
+	bool chunkWritten=false;
+	// The manifest checked that the signature lies within fileLength
+	if (chunkLength==chunkSignature.length && chunkSignature.offset+chunkLength<=chunkedFile->fileLength)
+	{
+		unsigned char hash[SHA1_LENGTH];
+		ContentDefinedChunker::HashChunk(chunkData, chunkLength, hash);
+		if (memcmp(hash, chunkSignature.hash, SHA1_LENGTH)==0)
+		{
+			chunkVerified=true;
+			if (chunkedFile->writeHandle)
+				chunkWritten=fileListReceiver->incrementalWriteInterface->WriteFilePart(chunkedFile->writeHandle, chunkSignature.offset, chunkData, chunkLength);
+			else
+			{
+				memcpy(chunkedFile->fileData+chunkSignature.offset, chunkData, chunkLength);
+				chunkWritten=true;
+			}
+		}
+	}
+	if (chunkWritten==false)
+	{
+		// Corrupt, or the file changed on the sender. Give up on the set after a few attempts, as it can then never complete.
+		// A failed write, such as a full disk, does not go away by sending the chunk again, so give up right away.
+		if (chunkVerified==false && ++chunkedFile->hashFailures < MAX_CHUNK_HASH_FAILURES)
+		{
+			DataStructures::List<unsigned int> chunkIndices;
+			chunkIndices.Push(chunkIndex, _FILE_AND_LINE_);
+			SendChunkedRequest(packet->systemAddress, curSetId, setIndex, chunkIndices);
+			SendUnified(&chunkAck,HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->systemAddress, false);
+			return;
+		}
+		SendUnified(&chunkAck,HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->systemAddress, false);
+		fileListReceiver->downloadHandler->OnDereference();
+		fileListReceivers.Delete(curSetId);
+		if (fileListReceiver->deleteDownloadHandler)
+			SLNet::OP_DELETE(fileListReceiver->downloadHandler, _FILE_AND_LINE_);
+		SLNet::OP_DELETE(fileListReceiver, _FILE_AND_LINE_);
+		return;
+	}
+	SendUnified(&chunkAck,HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->systemAddress, false);
+
+	FLR_MarkChunkPresent(chunkedFile, chunkIndex);
+	fileListReceiver->setTotalDownloadedLength+=chunkLength;
+
+	FileListTransferCBInterface::OnFileStruct onFileStruct;
+	onFileStruct.fileIndex=setIndex;
+	strcpy_s(onFileStruct.fileName, chunkedFile->fileName);
+	onFileStruct.fileData=chunkedFile->fileData;
+	onFileStruct.byteLengthOfThisFile=chunkedFile->fileLength;
+	onFileStruct.bytesDownloadedForThisFile=chunkedFile->bytesPresent;
+	onFileStruct.setID=curSetId;
+	onFileStruct.numberOfFilesInThisSet=fileListReceiver->setCount;
+	onFileStruct.byteLengthOfThisSet=fileListReceiver->setTotalFinalLength;
+	onFileStruct.bytesDownloadedForThisSet=fileListReceiver->setTotalDownloadedLength;
+	onFileStruct.context=chunkedFile->context;
+	onFileStruct.senderSystemAddress=packet->systemAddress;
+	onFileStruct.senderGuid=packet->guid;
+
+	FileListTransferCBInterface::FileProgressStruct fps;
+	fps.onFileStruct=&onFileStruct;
+	fps.partCount=chunkedFile->chunks.Size()-chunkedFile->chunksMissing;
+	fps.partTotal=chunkedFile->chunks.Size();
+	fps.dataChunkLength=chunkLength;
+	fps.firstDataChunk=chunkedFile->fileData;
+	fps.iriDataChunk=(char*) chunkData;
+	fps.allocateIrIDataChunkAutomatically=true;
+	fps.iriWriteOffset=chunkSignature.offset;
+	fps.senderSystemAddress=packet->systemAddress;
+	fps.senderGuid=packet->guid;
+	fileListReceiver->downloadHandler->OnFileProgress(&fps);
+
+	if (chunkedFile->chunksMissing==0)
+		OnChunkedFileComplete(fileListReceiver, setIndex);
+}
+bool FileListTransfer::OnChunkedFileComplete(FileListReceiver *fileListReceiver, unsigned int setIndex)
+{
+	FLR_ChunkedFile *chunkedFile = fileListReceiver->chunkedFiles.Get(setIndex);
+	fileListReceiver->chunkedFiles.Delete(setIndex);
+
+	// The file is complete on disk before OnFile is called
+	if (chunkedFile->writeHandle && fileListReceiver->incrementalWriteInterface->CloseFile(chunkedFile->writeHandle, true)==false)
+	{
+		// The file can not be moved to its final name, so the set can never complete
+		FLR_DeleteChunkedFile(chunkedFile);
+		fileListReceiver->downloadHandler->OnDereference();
+		fileListReceivers.Delete(fileListReceiver->setID);
+		if (fileListReceiver->deleteDownloadHandler)
+			SLNet::OP_DELETE(fileListReceiver->downloadHandler, _FILE_AND_LINE_);
+		SLNet::OP_DELETE(fileListReceiver, _FILE_AND_LINE_);
+		return true;
+	}
+
+	FileListTransferCBInterface::OnFileStruct onFileStruct;
+	onFileStruct.fileIndex=setIndex;
+	strcpy_s(onFileStruct.fileName, chunkedFile->fileName);
+	onFileStruct.fileData=chunkedFile->fileData;
+	onFileStruct.byteLengthOfThisFile=chunkedFile->fileLength;
+	onFileStruct.bytesDownloadedForThisFile=chunkedFile->fileLength;
+	onFileStruct.setID=fileListReceiver->setID;
+	onFileStruct.numberOfFilesInThisSet=fileListReceiver->setCount;
+	onFileStruct.byteLengthOfThisSet=fileListReceiver->setTotalFinalLength;
+	onFileStruct.bytesDownloadedForThisSet=fileListReceiver->setTotalDownloadedLength;
+	onFileStruct.context=chunkedFile->context;
+	onFileStruct.senderSystemAddress=chunkedFile->senderSystemAddress;
+	onFileStruct.senderGuid=chunkedFile->senderGuid;
+	FLR_DeleteChunkedFile(chunkedFile);
+
+	if (fileListReceiver->downloadHandler->OnFile(&onFileStruct))
+		rakFree_Ex(onFileStruct.fileData, _FILE_AND_LINE_ );
+
+	fileListReceiver->filesReceived++;
+
+	// If this set is done, free the memory for it.
+	if ((int) fileListReceiver->setCount==fileListReceiver->filesReceived)
+	{
+		FileListTransferCBInterface::DownloadCompleteStruct dcs;
+		dcs.setID=fileListReceiver->setID;
+		dcs.numberOfFilesInThisSet=fileListReceiver->setCount;
+		dcs.byteLengthOfThisSet=fileListReceiver->setTotalFinalLength;
+		dcs.senderSystemAddress=onFileStruct.senderSystemAddress;
+		dcs.senderGuid=onFileStruct.senderGuid;
+
+		if (fileListReceiver->downloadHandler->OnDownloadComplete(&dcs)==false)
+		{
+			fileListReceiver->downloadHandler->OnDereference();
+			fileListReceivers.Delete(dcs.setID);
+			if (fileListReceiver->deleteDownloadHandler)
+				SLNet::OP_DELETE(fileListReceiver->downloadHandler, _FILE_AND_LINE_);
+			SLNet::OP_DELETE(fileListReceiver, _FILE_AND_LINE_);
+			return true;
+		}
+	}
+	return false;
 }
 
 #endif // _RAKNET_SUPPORT_*
@@ -30,3 +30,23 @@ unsigned int IncrementalReadInterface::GetFilePart( const char *filename, unsign
 	fclose(fp);
 	return numRead;
 }
+bool IncrementalReadInterface::AddFileReference( const char *filename, FileListNodeContext context)
+{
+	(void) filename;
+	(void) context;
+	return false;
+}
+void IncrementalReadInterface::ReleaseFileReference( const char *filename, FileListNodeContext context)
+{
+	(void) filename;
+	(void) context;
+}
+const char* IncrementalReadInterface::GetFilePartPointer( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, unsigned int *numBytesRead, FileListNodeContext context)
+{
+	(void) filename;
+	(void) startReadBytes;
+	(void) numBytesToRead;
+	(void) context;
+	*numBytesRead=0;
+	return 0;
+}
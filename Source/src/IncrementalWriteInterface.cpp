@@ -0,0 +1,228 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "slikenet/IncrementalWriteInterface.h"
+#include "slikenet/memoryoverride.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include "slikenet/WindowsIncludes.h" // MoveFileExA
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+using namespace SLNet;
+
+namespace SLNet
+{
+struct IWI_FileHandle
+{
+#ifdef _WIN32
+	FILE *fp;
+#else
+	int fd;
+#endif
+	// Final path, the data is written to fullPath.partial
+	char fullPath[1024];
+};
+}
+
+static const char *PARTIAL_FILE_EXTENSION=".partial";
+
+IncrementalWriteInterface::IncrementalWriteInterface()
+{
+	applicationDirectory[0]=0;
+}
+IncrementalWriteInterface::IncrementalWriteInterface(const char *_applicationDirectory)
+{
+	SetApplicationDirectory(_applicationDirectory);
+}
+void IncrementalWriteInterface::SetApplicationDirectory(const char *_applicationDirectory)
+{
+	if (_applicationDirectory==0)
+	{
+		applicationDirectory[0]=0;
+		return;
+	}
+	strcpy_s(applicationDirectory, _applicationDirectory);
+	size_t len = strlen(applicationDirectory);
+	if (len>0 && len < sizeof(applicationDirectory)-1 && applicationDirectory[len-1]!='/' && applicationDirectory[len-1]!='\\')
+	{
+		applicationDirectory[len]='/';
+		applicationDirectory[len+1]=0;
+	}
+}
+bool IncrementalWriteInterface::GetFullPath(const char *filename, char *fullPath, size_t fullPathLength) const
+{
+	// Security - Don't allow .. in the filename anywhere so you can't write outside of the root directory
+	if (filename==0 || filename[0]==0 || strstr(filename, "..")!=0)
+		return false;
+	// Nor absolute paths, which would be used as is without an application directory
+	if (filename[0]=='/' || filename[0]=='\\' || filename[1]==':')
+		return false;
+	if (strlen(applicationDirectory)+strlen(filename)+strlen(PARTIAL_FILE_EXTENSION) >= fullPathLength)
+		return false;
+	strcpy_s(fullPath, fullPathLength, applicationDirectory);
+	strcat_s(fullPath, fullPathLength, filename);
+	return true;
+}
+void* IncrementalWriteInterface::OpenFile(const char *filename, unsigned int byteLengthOfFile, FileListNodeContext context)
+{
+	(void) context;
+
+	char fullPath[1024];
+	if (GetFullPath(filename, fullPath, sizeof(fullPath))==false)
+		return 0;
+
+	// Create the directories leading up to the file
+	for (int index=1; fullPath[index]; index++)
+	{
+		if (fullPath[index]=='/' || fullPath[index]=='\\')
+		{
+			char c = fullPath[index];
+			fullPath[index]=0;
+#ifdef _WIN32
+			int res = _mkdir(fullPath);
+#else
+			int res = mkdir(fullPath, 0744);
+#endif
+			fullPath[index]=c;
+			if (res<0 && errno!=EEXIST && errno!=EACCES)
+				return 0;
+		}
+	}
+
+	char partialPath[1024];
+	strcpy_s(partialPath, fullPath);
+	strcat_s(partialPath, PARTIAL_FILE_EXTENSION);
+
+	IWI_FileHandle *handle = SLNet::OP_NEW<IWI_FileHandle>(_FILE_AND_LINE_);
+	strcpy_s(handle->fullPath, fullPath);
+	// Do not truncate, data from an interrupted transfer may be reused
+#ifdef _WIN32
+	if (fopen_s(&handle->fp, partialPath, "r+b")!=0 && fopen_s(&handle->fp, partialPath, "w+b")!=0)
+	{
+		SLNet::OP_DELETE(handle, _FILE_AND_LINE_);
+		return 0;
+	}
+	if (_chsize_s(_fileno(handle->fp), (__int64) byteLengthOfFile)!=0)
+	{
+		fclose(handle->fp);
+		SLNet::OP_DELETE(handle, _FILE_AND_LINE_);
+		return 0;
+	}
+#else
+	handle->fd = open(partialPath, O_RDWR | O_CREAT, 0644);
+	if (handle->fd<0)
+	{
+		SLNet::OP_DELETE(handle, _FILE_AND_LINE_);
+		return 0;
+	}
+	// Size the file up front so out of order chunks do not repeatedly extend it
+	if (ftruncate(handle->fd, (off_t) byteLengthOfFile)!=0)
+	{
+		close(handle->fd);
+		SLNet::OP_DELETE(handle, _FILE_AND_LINE_);
+		return 0;
+	}
+#endif
+	return handle;
+}
+bool IncrementalWriteInterface::WriteFilePart(void *fileHandle, unsigned int startWriteBytes, const char *source, unsigned int numBytesToWrite)
+{
+	IWI_FileHandle *handle = (IWI_FileHandle *) fileHandle;
+#ifdef _WIN32
+	if (fseek(handle->fp, (long) startWriteBytes, SEEK_SET)!=0)
+		return false;
+	return fwrite(source, 1, numBytesToWrite, handle->fp)==numBytesToWrite;
+#else
+	while (numBytesToWrite>0)
+	{
+		ssize_t written = pwrite(handle->fd, source, numBytesToWrite, (off_t) startWriteBytes);
+		if (written<0)
+		{
+			if (errno==EINTR)
+				continue;
+			return false;
+		}
+		source+=written;
+		startWriteBytes+=(unsigned int) written;
+		numBytesToWrite-=(unsigned int) written;
+	}
+	return true;
+#endif
+}
+unsigned int IncrementalWriteInterface::ReadFilePart(void *fileHandle, unsigned int startReadBytes, unsigned int numBytesToRead, char *preallocatedDestination)
+{
+	IWI_FileHandle *handle = (IWI_FileHandle *) fileHandle;
+#ifdef _WIN32
+	if (fseek(handle->fp, (long) startReadBytes, SEEK_SET)!=0)
+		return 0;
+	return (unsigned int) fread(preallocatedDestination, 1, numBytesToRead, handle->fp);
+#else
+	unsigned int numRead=0;
+	while (numRead < numBytesToRead)
+	{
+		ssize_t result = pread(handle->fd, preallocatedDestination+numRead, numBytesToRead-numRead, (off_t) (startReadBytes+numRead));
+		if (result<0 && errno==EINTR)
+			continue;
+		if (result<=0)
+			break;
+		numRead+=(unsigned int) result;
+	}
+	return numRead;
+#endif
+}
+unsigned int IncrementalWriteInterface::ReadExistingFilePart(const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, char *preallocatedDestination, FileListNodeContext context)
+{
+	(void) context;
+
+	char fullPath[1024];
+	if (GetFullPath(filename, fullPath, sizeof(fullPath))==false)
+		return 0;
+	FILE *fp;
+	if (fopen_s(&fp, fullPath, "rb")!=0)
+		return 0;
+	fseek(fp, (long) startReadBytes, SEEK_SET);
+	unsigned int numRead = (unsigned int) fread(preallocatedDestination, 1, numBytesToRead, fp);
+	fclose(fp);
+	return numRead;
+}
+bool IncrementalWriteInterface::CloseFile(void *fileHandle, bool completed)
+{
+	IWI_FileHandle *handle = (IWI_FileHandle *) fileHandle;
+	bool success=true;
+#ifdef _WIN32
+	if (fclose(handle->fp)!=0)
+		success=false;
+#else
+	if (close(handle->fd)!=0)
+		success=false;
+#endif
+	if (completed && success)
+	{
+		char partialPath[1024];
+		strcpy_s(partialPath, handle->fullPath);
+		strcat_s(partialPath, PARTIAL_FILE_EXTENSION);
+#ifdef _WIN32
+		// rename() does not replace existing files on Windows. The old file stays in place if the move fails.
+		success = MoveFileExA(partialPath, handle->fullPath, MOVEFILE_REPLACE_EXISTING)!=0;
+#else
+		success = rename(partialPath, handle->fullPath)==0;
+#endif
+	}
+	SLNet::OP_DELETE(handle, _FILE_AND_LINE_);
+	return success;
+}
@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "slikenet/MemoryMappedReadInterface.h"
+#include "slikenet/memoryoverride.h"
+#include <string.h>
+#ifdef _WIN32
+#include "slikenet/WindowsIncludes.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace SLNet;
+
+MemoryMappedReadInterface::MemoryMappedReadInterface()
+{
+}
+MemoryMappedReadInterface::~MemoryMappedReadInterface()
+{
+	DataStructures::List<MappedFile*> itemList;
+	DataStructures::List<SLNet::RakString> keyList;
+	mappedFiles.GetAsList(itemList, keyList, _FILE_AND_LINE_);
+	for (unsigned int i=0; i < itemList.Size(); i++)
+		UnmapFile(itemList[i]);
+	mappedFiles.Clear(_FILE_AND_LINE_);
+}
+unsigned int MemoryMappedReadInterface::GetFilePart( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, void *preallocatedDestination, FileListNodeContext context)
+{
+	unsigned int numBytesRead;
+	const char *source = GetFilePartPointer(filename, startReadBytes, numBytesToRead, &numBytesRead, context);
+	if (source==0)
+		return IncrementalReadInterface::GetFilePart(filename, startReadBytes, numBytesToRead, preallocatedDestination, context);
+	memcpy(preallocatedDestination, source, numBytesRead);
+	return numBytesRead;
+}
+bool MemoryMappedReadInterface::AddFileReference( const char *filename, FileListNodeContext context)
+{
+	(void) context;
+
+	SLNet::RakString key(filename);
+	mappedFilesMutex.Lock();
+	MappedFile **existing = mappedFiles.Peek(key);
+	if (existing)
+	{
+		(*existing)->refCount++;
+		mappedFilesMutex.Unlock();
+		return true;
+	}
+	MappedFile *mappedFile = MapFile(filename);
+	if (mappedFile==0)
+	{
+		mappedFilesMutex.Unlock();
+		return false;
+	}
+	mappedFile->refCount=1;
+	mappedFiles.Push(key, mappedFile, _FILE_AND_LINE_);
+	mappedFilesMutex.Unlock();
+	return true;
+}
+void MemoryMappedReadInterface::ReleaseFileReference( const char *filename, FileListNodeContext context)
+{
+	(void) context;
+
+	SLNet::RakString key(filename);
+	mappedFilesMutex.Lock();
+	MappedFile **existing = mappedFiles.Peek(key);
+	RakAssert(existing);
+	if (existing && --(*existing)->refCount==0)
+	{
+		UnmapFile(*existing);
+		mappedFiles.Remove(key, _FILE_AND_LINE_);
+	}
+	mappedFilesMutex.Unlock();
+}
+const char* MemoryMappedReadInterface::GetFilePartPointer( const char *filename, unsigned int startReadBytes, unsigned int numBytesToRead, unsigned int *numBytesRead, FileListNodeContext context)
+{
+	(void) context;
+
+	*numBytesRead=0;
+	mappedFilesMutex.Lock();
+	MappedFile **existing = mappedFiles.Peek(SLNet::RakString(filename));
+	if (existing==0)
+	{
+		mappedFilesMutex.Unlock();
+		return 0;
+	}
+	// The caller holds a reference, so the mapping stays valid after unlocking
+	MappedFile *mappedFile = *existing;
+	mappedFilesMutex.Unlock();
+
+	if (startReadBytes >= mappedFile->length)
+		return mappedFile->data;
+	if (numBytesToRead > mappedFile->length-startReadBytes)
+		numBytesToRead = mappedFile->length-startReadBytes;
+	*numBytesRead=numBytesToRead;
+	return mappedFile->data+startReadBytes;
+}
+unsigned int MemoryMappedReadInterface::GetMappedFileCount(void)
+{
+	mappedFilesMutex.Lock();
+	unsigned int count = mappedFiles.Size();
+	mappedFilesMutex.Unlock();
+	return count;
+}
+MemoryMappedReadInterface::MappedFile* MemoryMappedReadInterface::MapFile(const char *filename)
+{
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (fileHandle==INVALID_HANDLE_VALUE)
+		return 0;
+	LARGE_INTEGER fileSize;
+	// Empty files cannot be mapped, and offsets are 32 bit
+	if (GetFileSizeEx(fileHandle, &fileSize)==0 || fileSize.QuadPart==0 || fileSize.QuadPart > 0xFFFFFFFF)
+	{
+		CloseHandle(fileHandle);
+		return 0;
+	}
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if (mappingHandle==0)
+	{
+		CloseHandle(fileHandle);
+		return 0;
+	}
+	void *data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data==0)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return 0;
+	}
+	MappedFile *mappedFile = SLNet::OP_NEW<MappedFile>(_FILE_AND_LINE_);
+	mappedFile->data=(char*) data;
+	mappedFile->length=(unsigned int) fileSize.QuadPart;
+	mappedFile->fileHandle=fileHandle;
+	mappedFile->mappingHandle=mappingHandle;
+	return mappedFile;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd<0)
+		return 0;
+	struct stat fileStat;
+	// Empty files cannot be mapped, and offsets are 32 bit
+	if (fstat(fd, &fileStat)!=0 || fileStat.st_size==0 || (unsigned long long) fileStat.st_size > 0xFFFFFFFFull)
+	{
+		close(fd);
+		return 0;
+	}
+	void *data = mmap(0, (size_t) fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping keeps the file open
+	close(fd);
+	if (data==MAP_FAILED)
+		return 0;
+	madvise(data, (size_t) fileStat.st_size, MADV_SEQUENTIAL);
+	MappedFile *mappedFile = SLNet::OP_NEW<MappedFile>(_FILE_AND_LINE_);
+	mappedFile->data=(char*) data;
+	mappedFile->length=(unsigned int) fileStat.st_size;
+	return mappedFile;
+#endif
+}
+void MemoryMappedReadInterface::UnmapFile(MappedFile *mappedFile)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(mappedFile->data);
+	CloseHandle(mappedFile->mappingHandle);
+	CloseHandle(mappedFile->fileHandle);
+#else
+	munmap(mappedFile->data, mappedFile->length);
+#endif
+	SLNet::OP_DELETE(mappedFile, _FILE_AND_LINE_);
+}
@@ -32,30 +32,46 @@ STATIC_FACTORY_DEFINITIONS(NetworkIDManager,NetworkIDManager)
 NetworkIDManager::NetworkIDManager()
 {
 	startingOffset = RakPeerInterface::Get64BitUniqueRandomNumber();
-	Clear();
+	networkIdIndex = 0;
+	networkIdIndexBits = 0;
+	objectCount = 0;
+	while ((1u << networkIdIndexBits) < NETWORK_ID_MANAGER_HASH_LENGTH)
+		networkIdIndexBits++;
+	AllocateIndex(networkIdIndexBits);
 }
 NetworkIDManager::~NetworkIDManager(void)
 {
-
+	rakFree_Ex(networkIdIndex, _FILE_AND_LINE_);
 }
 void NetworkIDManager::Clear(void)
 {
-	memset(networkIdHash,0,sizeof(networkIdHash));
+	memset(networkIdIndex,0,sizeof(IndexEntry) << networkIdIndexBits);
+	objectCount=0;
+}
+unsigned int NetworkIDManager::GetObjectCount(void) const
+{
+	return objectCount;
 }
 NetworkIDObject *NetworkIDManager::GET_BASE_OBJECT_FROM_ID(NetworkID x)
 {
-	unsigned int hashIndex=NetworkIDToHashIndex(x);
-	NetworkIDObject *nio=networkIdHash[hashIndex];
-	while (nio)
+	const unsigned int mask = (1u << networkIdIndexBits) - 1;
+	unsigned int slot=NetworkIDToHashIndex(x);
+	for (unsigned int distance=0;; distance++)
 	{
-		if (nio->GetNetworkID()==x)
-			return nio;
-		nio=nio->nextInstanceForNetworkIDManager;
+		const IndexEntry &entry = networkIdIndex[slot];
+		if (entry.object==0)
+			return 0;
+		if (entry.networkId==x)
+			return entry.object;
+		// x would have been inserted before this entry
+		if (((slot - NetworkIDToHashIndex(entry.networkId)) & mask) < distance)
+			return 0;
+		slot=(slot+1) & mask;
 	}
-	return 0;
 }
 NetworkID NetworkIDManager::GetNewNetworkID(void)
 {
+	// IDs are handed out in sequence from a random start, so this only loops when IDs assigned by another system are in the way
     while (GET_BASE_OBJECT_FROM_ID(++startingOffset))
         ;
 	if (startingOffset==UNASSIGNED_NETWORK_ID)
@@ -65,43 +81,73 @@ NetworkID NetworkIDManager::GetNewNetworkID(void)
 	}
     return startingOffset;
 }
-unsigned int NetworkIDManager::NetworkIDToHashIndex(NetworkID networkId)
+unsigned int NetworkIDManager::NetworkIDToHashIndex(NetworkID networkId) const
 {
-//	return SuperFastHash((const char*) &networkId.guid.g,sizeof(networkId.guid.g)) % NETWORK_ID_MANAGER_HASH_LENGTH;
-	return (unsigned int) (networkId % NETWORK_ID_MANAGER_HASH_LENGTH);
+	// Fibonacci hashing, so consecutive IDs are spread over the index
+	return (unsigned int) ((networkId * 0x9E3779B97F4A7C15ULL) >> (64 - networkIdIndexBits));
 }
-void NetworkIDManager::TrackNetworkIDObject(NetworkIDObject *networkIdObject)
+void NetworkIDManager::AllocateIndex(unsigned int numBits)
 {
-	RakAssert(networkIdObject->GetNetworkIDManager()==this);
-	NetworkID rawId = networkIdObject->GetNetworkID();
-	RakAssert(rawId!=UNASSIGNED_NETWORK_ID);
+	IndexEntry *oldIndex = networkIdIndex;
+	unsigned int oldSize = networkIdIndex ? 1u << networkIdIndexBits : 0;
 
-	networkIdObject->nextInstanceForNetworkIDManager=0;
+	networkIdIndexBits = numBits;
+	networkIdIndex = (IndexEntry*) rakMalloc_Ex(sizeof(IndexEntry) << networkIdIndexBits, _FILE_AND_LINE_);
+	memset(networkIdIndex,0,sizeof(IndexEntry) << networkIdIndexBits);
+	objectCount=0;
 
-	unsigned int hashIndex=NetworkIDToHashIndex(rawId);
-//	printf("TrackNetworkIDObject hashIndex=%i guid=%s\n",hashIndex, networkIdObject->GetNetworkID().guid.ToString()); // removeme
-	if (networkIdHash[hashIndex]==0)
+	for (unsigned int i=0; i < oldSize; i++)
 	{
-		networkIdHash[hashIndex]=networkIdObject;
-		return;
+		if (oldIndex[i].object)
+			InsertIntoIndex(oldIndex[i].networkId, oldIndex[i].object);
 	}
-	NetworkIDObject *nio=networkIdHash[hashIndex];
-	// Duplicate insertion?
-	RakAssert(nio!=networkIdObject);
-	// Random GUID conflict?
-	RakAssert(nio->GetNetworkID()!=rawId);
+	rakFree_Ex(oldIndex, _FILE_AND_LINE_);
+}
+void NetworkIDManager::InsertIntoIndex(NetworkID networkId, NetworkIDObject *networkIdObject)
+{
+	const unsigned int mask = (1u << networkIdIndexBits) - 1;
+	IndexEntry inserted;
+	inserted.networkId=networkId;
+	inserted.object=networkIdObject;
+	unsigned int slot=NetworkIDToHashIndex(networkId);
+	unsigned int distance=0;
+	for (;;)
+	{
+		IndexEntry &entry = networkIdIndex[slot];
+		if (entry.object==0)
+		{
+			entry=inserted;
+			objectCount++;
+			return;
+		}
 
-	while (nio->nextInstanceForNetworkIDManager!=0)
-	{		
-		nio=nio->nextInstanceForNetworkIDManager;
+		// Take the slot of entries closer to their own slot, and continue inserting the entry taken out
+		unsigned int entryDistance = (slot - NetworkIDToHashIndex(entry.networkId)) & mask;
+		if (entryDistance < distance)
+		{
+			IndexEntry displaced = entry;
+			entry=inserted;
+			inserted=displaced;
+			distance=entryDistance;
+		}
 
-		// Duplicate insertion?
-		RakAssert(nio!=networkIdObject);
-		// Random GUID conflict?
-		RakAssert(nio->GetNetworkID()!=rawId);
+		slot=(slot+1) & mask;
+		distance++;
 	}
+}
+void NetworkIDManager::TrackNetworkIDObject(NetworkIDObject *networkIdObject)
+{
+	RakAssert(networkIdObject->GetNetworkIDManager()==this);
+	NetworkID rawId = networkIdObject->GetNetworkID();
+	RakAssert(rawId!=UNASSIGNED_NETWORK_ID);
+	// Duplicate insertion or random ID conflict?
+	RakAssert(GET_BASE_OBJECT_FROM_ID(rawId)==0);
+
+	// Keep the index at most 7/8 full
+	if ((uint64_t) (objectCount+1)*8 > ((uint64_t) 7 << networkIdIndexBits))
+		AllocateIndex(networkIdIndexBits+1);
 
-	nio->nextInstanceForNetworkIDManager=networkIdObject;
+	InsertIntoIndex(rawId, networkIdObject);
 }
 void NetworkIDManager::StopTrackingNetworkIDObject(NetworkIDObject *networkIdObject)
 {
@@ -109,30 +155,29 @@ void NetworkIDManager::StopTrackingNetworkIDObject(NetworkIDObject *networkIdObj
 	NetworkID rawId = networkIdObject->GetNetworkID();
 	RakAssert(rawId!=UNASSIGNED_NETWORK_ID);
 
-	// RakAssert(networkIdObject->GetNetworkID()!=UNASSIGNED_NETWORK_ID);
-	unsigned int hashIndex=NetworkIDToHashIndex(rawId);
-//	printf("hashIndex=%i\n",hashIndex); // removeme
-	NetworkIDObject *nio=networkIdHash[hashIndex];
-	if (nio==0)
+	const unsigned int mask = (1u << networkIdIndexBits) - 1;
+	unsigned int slot=NetworkIDToHashIndex(rawId);
+	for (unsigned int distance=0;; distance++)
 	{
-		RakAssert("NetworkIDManager::StopTrackingNetworkIDObject didn't find object" && 0);
-		return;
-	}
-	if (nio==networkIdObject)
-	{
-		networkIdHash[hashIndex]=nio->nextInstanceForNetworkIDManager;
-		return;
-	}
-
-	while (nio)
-	{
-		if (nio->nextInstanceForNetworkIDManager==networkIdObject)
+		const IndexEntry &entry = networkIdIndex[slot];
+		if (entry.object==0 || ((slot - NetworkIDToHashIndex(entry.networkId)) & mask) < distance)
 		{
-			nio->nextInstanceForNetworkIDManager=networkIdObject->nextInstanceForNetworkIDManager;
+			RakAssert("NetworkIDManager::StopTrackingNetworkIDObject didn't find object" && 0);
 			return;
 		}
-		nio=nio->nextInstanceForNetworkIDManager;
+		if (entry.object==networkIdObject)
+			break;
+		slot=(slot+1) & mask;
 	}
 
-	RakAssert("NetworkIDManager::StopTrackingNetworkIDObject didn't find object" && 0);
+	// Shift the following entries back by one slot, until an empty slot or an entry already in its own slot
+	unsigned int next=(slot+1) & mask;
+	while (networkIdIndex[next].object!=0 && ((next - NetworkIDToHashIndex(networkIdIndex[next].networkId)) & mask)!=0)
+	{
+		networkIdIndex[slot]=networkIdIndex[next];
+		slot=next;
+		next=(next+1) & mask;
+	}
+	networkIdIndex[slot].object=0;
+	objectCount--;
 }
@@ -29,7 +29,6 @@ NetworkIDObject::NetworkIDObject()
 	networkID=UNASSIGNED_NETWORK_ID;
 	parent=0;
 	networkIDManager=0;
-	nextInstanceForNetworkIDManager=0;
 }
 NetworkIDObject::~NetworkIDObject()
 {
@@ -0,0 +1,570 @@
+/*
+ *  Copyright (c) 2026, SLikeSoft UG (haftungsbeschränkt)
+ *
+ *  This source code is licensed under the MIT-style license found in the
+ *  license.txt file in the root directory of this source tree.
+ */
+
+#include "slikenet/NativeFeatureIncludes.h"
+#if _RAKNET_SUPPORT_PacketLogger==1
+
+#include "slikenet/PacketCaptureLogger.h"
+#include "slikenet/InternalPacket.h"
+#include "slikenet/peerinterface.h"
+#include "slikenet/MessageIdentifiers.h"
+#include "slikenet/GetTime.h"
+#include "slikenet/sleep.h"
+#include "slikenet/gettimeofday.h"
+#include <string.h>
+#include <time.h>
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
+
+using namespace SLNet;
+
+STATIC_FACTORY_DEFINITIONS(PacketCaptureLogger,PacketCaptureLogger);
+
+namespace SLNet
+{
+RAK_THREAD_DECLARATION(PacketCaptureWriterLoop);
+}
+
+// Records are collected into this many bytes before each fwrite()
+static const unsigned int WRITE_BUFFER_SIZE=65536;
+static const char CAPTURE_FILE_MAGIC[8]="SLNCAP1";
+
+static SLNet::LocklessUint32_t nextLoggerId;
+
+// Per thread cache of GetThreadBuffer() for the logger with cachedLoggerId
+static RAK_THREAD_LOCAL unsigned int cachedLoggerId=0;
+static RAK_THREAD_LOCAL void *cachedThreadBuffer=0;
+// Its address identifies the thread
+static RAK_THREAD_LOCAL char threadToken;
+
+PacketCaptureLogger::ThreadBuffer::ThreadBuffer()
+{
+	owner=0;
+	droppedRecords=0;
+}
+PacketCaptureLogger::PacketCaptureLogger()
+{
+	// Increment() returns the old value on some platforms and the new one on others. Either way the id is unique and not 0.
+	loggerId=nextLoggerId.Increment()+1;
+	captureFile=0;
+	maxRecordsPerThread=65536;
+	flushIntervalMS=100;
+	localSystemAddress=UNASSIGNED_SYSTEM_ADDRESS;
+	writeBuffer=0;
+	writeBufferUsed=0;
+	decodeOutput=0;
+}
+PacketCaptureLogger::~PacketCaptureLogger()
+{
+	StopCapture();
+	for (unsigned int i=0; i < threadBuffers.Size(); i++)
+		SLNet::OP_DELETE(threadBuffers[i], _FILE_AND_LINE_);
+	if (writeBuffer)
+		rakFree_Ex(writeBuffer, _FILE_AND_LINE_);
+}
+bool PacketCaptureLogger::StartCapture(const char *filenamePrefix, unsigned int _maxRecordsPerThread, SLNet::TimeMS _flushIntervalMS)
+{
+	if (capturing.GetValue()!=0)
+		return false;
+
+	// Discard records added while the previous capture was stopping
+	WriteBufferedRecords();
+
+	char filename[256];
+	if (filenamePrefix)
+		sprintf_s(filename, "%s_%i.slncap", filenamePrefix, (int)SLNet::GetTimeMS());
+	else
+		sprintf_s(filename, "PacketCapture_%i.slncap", (int)SLNet::GetTimeMS());
+	if (fopen_s(&captureFile, filename, "wb")!=0)
+	{
+		captureFile=0;
+		return false;
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic));
+	header.byteOrderMark=0x01020304;
+	header.recordSize=sizeof(Record);
+	header.payloadBytes=PACKET_CAPTURE_PAYLOAD_BYTES;
+	fwrite(&header, sizeof(header), 1, captureFile);
+
+	maxRecordsPerThread=_maxRecordsPerThread;
+	flushIntervalMS=_flushIntervalMS;
+	if (writeBuffer==0)
+		writeBuffer=(char*) rakMalloc_Ex(WRITE_BUFFER_SIZE, _FILE_AND_LINE_);
+	if (rakPeerInterface)
+		localSystemAddress=rakPeerInterface->GetInternalID(UNASSIGNED_SYSTEM_ADDRESS);
+
+	capturing.Increment();
+	int errorCode = SLNet::RakThread::Create(PacketCaptureWriterLoop, this);
+	if (errorCode!=0)
+	{
+		capturing.Decrement();
+		fclose(captureFile);
+		captureFile=0;
+		return false;
+	}
+	while (writerThreadRunning.GetValue()==0)
+		RakSleep(0);
+	return true;
+}
+void PacketCaptureLogger::StopCapture(void)
+{
+	if (capturing.GetValue()==0)
+		return;
+	capturing.Decrement();
+	while (writerThreadRunning.GetValue()>0)
+		RakSleep(30);
+
+	WriteBufferedRecords();
+	fclose(captureFile);
+	captureFile=0;
+}
+unsigned int PacketCaptureLogger::GetDroppedRecordCount(void)
+{
+	unsigned int droppedRecords=0;
+	threadBuffersMutex.Lock();
+	for (unsigned int i=0; i < threadBuffers.Size(); i++)
+		droppedRecords+=threadBuffers[i]->droppedRecords;
+	threadBuffersMutex.Unlock();
+	return droppedRecords;
+}
+void PacketCaptureLogger::OnAttach(void)
+{
+	localSystemAddress=rakPeerInterface->GetInternalID(UNASSIGNED_SYSTEM_ADDRESS);
+}
+void PacketCaptureLogger::OnRakPeerStartup(void)
+{
+	localSystemAddress=rakPeerInterface->GetInternalID(UNASSIGNED_SYSTEM_ADDRESS);
+}
+PacketCaptureLogger::ThreadBuffer* PacketCaptureLogger::GetThreadBuffer(void)
+{
+	if (cachedLoggerId==loggerId)
+		return (ThreadBuffer*) cachedThreadBuffer;
+
+	// First record of this thread, or the thread last logged to another instance
+	ThreadBuffer *threadBuffer=0;
+	threadBuffersMutex.Lock();
+	for (unsigned int i=0; i < threadBuffers.Size(); i++)
+	{
+		if (threadBuffers[i]->owner==&threadToken)
+		{
+			threadBuffer=threadBuffers[i];
+			break;
+		}
+	}
+	if (threadBuffer==0)
+	{
+		threadBuffer=SLNet::OP_NEW<ThreadBuffer>(_FILE_AND_LINE_);
+		threadBuffer->owner=&threadToken;
+		threadBuffers.Push(threadBuffer, _FILE_AND_LINE_);
+	}
+	threadBuffersMutex.Unlock();
+
+	cachedLoggerId=loggerId;
+	cachedThreadBuffer=threadBuffer;
+	return threadBuffer;
+}
+PacketCaptureLogger::Record* PacketCaptureLogger::AllocateRecord(ThreadBuffer *&threadBuffer, unsigned char recordType, const SystemAddress &remoteSystemAddress)
+{
+	if (capturing.GetValue()==0)
+		return 0;
+	threadBuffer=GetThreadBuffer();
+	if ((unsigned int) threadBuffer->records.Size() >= maxRecordsPerThread)
+	{
+		threadBuffer->droppedRecords++;
+		return 0;
+	}
+
+	Record *record = threadBuffer->records.WriteLock();
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	record->clockUS=(uint64_t) tv.tv_sec * 1000000 + (uint64_t) tv.tv_usec;
+	record->recordType=recordType;
+	record->direction=0;
+	record->messageId=0;
+	record->payloadLength=0;
+	record->addressFlags=0;
+	record->bitLength=0;
+	record->reliableMessageNumber=(uint32_t)-1;
+	record->frameNumber=0;
+	record->splitPacketId=(uint32_t)-1;
+	record->splitPacketIndex=(uint32_t)-1;
+	record->splitPacketCount=(uint32_t)-1;
+	record->orderingIndex=(uint32_t)-1;
+	WriteAddress(localSystemAddress, record->localAddress, &record->localPort, &record->addressFlags, 1);
+	WriteAddress(remoteSystemAddress, record->remoteAddress, &record->remotePort, &record->addressFlags, 2);
+	return record;
+}
+void PacketCaptureLogger::CommitRecord(ThreadBuffer *threadBuffer)
+{
+	threadBuffer->records.WriteUnlock();
+}
+static void CopyPayload(PacketCaptureLogger::Record *record, const char *data, const BitSize_t bitsUsed)
+{
+	unsigned int length = BITS_TO_BYTES(bitsUsed);
+	if (length > PACKET_CAPTURE_PAYLOAD_BYTES)
+		length = PACKET_CAPTURE_PAYLOAD_BYTES;
+	memcpy(record->payload, data, length);
+	record->payloadLength=(unsigned char) length;
+}
+// Stores one or two null terminated strings, truncated to fit
+static void CopyText(PacketCaptureLogger::Record *record, const char *text1, const char *text2)
+{
+	unsigned int length=0;
+	const char *texts[2] = {text1, text2};
+	for (int i=0; i < 2 && texts[i]; i++)
+	{
+		const char *text=texts[i];
+		while (*text && length < PACKET_CAPTURE_PAYLOAD_BYTES-1)
+			record->payload[length++]=(unsigned char) *text++;
+		record->payload[length]=0;
+		if (length < PACKET_CAPTURE_PAYLOAD_BYTES-1)
+			length++;
+	}
+	record->payloadLength=(unsigned char) length;
+}
+void PacketCaptureLogger::OnDirectSocketSend(const char *data, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress)
+{
+	if (logDirectMessages==false)
+		return;
+
+	ThreadBuffer *threadBuffer;
+	Record *record = AllocateRecord(threadBuffer, PCR_SEND_RAW, remoteSystemAddress);
+	if (record==0)
+		return;
+	record->time=SLNet::GetTimeMS();
+	record->bitLength=bitsUsed;
+	record->messageId=(unsigned char) data[0];
+	record->reliableMessageNumber=0;
+	CopyPayload(record, data, bitsUsed);
+	CommitRecord(threadBuffer);
+}
+void PacketCaptureLogger::OnDirectSocketReceive(const char *data, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress)
+{
+	if (logDirectMessages==false)
+		return;
+
+	ThreadBuffer *threadBuffer;
+	Record *record = AllocateRecord(threadBuffer, PCR_RECEIVE_RAW, remoteSystemAddress);
+	if (record==0)
+		return;
+	record->time=SLNet::GetTime();
+	record->bitLength=bitsUsed;
+	record->messageId=(unsigned char) data[0];
+	record->reliableMessageNumber=0;
+	CopyPayload(record, data, bitsUsed);
+	CommitRecord(threadBuffer);
+}
+void PacketCaptureLogger::OnReliabilityLayerNotification(const char *errorMessage, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress, bool isError)
+{
+	ThreadBuffer *threadBuffer;
+	Record *record = AllocateRecord(threadBuffer, isError ? PCR_RELIABILITY_ERROR : PCR_RELIABILITY_WARNING, remoteSystemAddress);
+	if (record==0)
+		return;
+	record->time=SLNet::GetTime();
+	record->bitLength=bitsUsed;
+	record->reliableMessageNumber=0;
+	CopyText(record, errorMessage, 0);
+	CommitRecord(threadBuffer);
+	RakAssert(isError==false);
+}
+void PacketCaptureLogger::OnInternalPacket(InternalPacket *internalPacket, unsigned frameNumber, SystemAddress remoteSystemAddress, SLNet::TimeMS time, int isSend)
+{
+	ThreadBuffer *threadBuffer;
+	Record *record = AllocateRecord(threadBuffer, internalPacket->data[0]==ID_TIMESTAMP ? PCR_TIMESTAMPED_INTERNAL_PACKET : PCR_INTERNAL_PACKET, remoteSystemAddress);
+	if (record==0)
+		return;
+	record->time=time;
+	record->direction=(unsigned char) isSend;
+	record->frameNumber=frameNumber;
+	record->bitLength=internalPacket->dataBitLength;
+	if (internalPacket->reliability==UNRELIABLE || internalPacket->reliability==UNRELIABLE_SEQUENCED || internalPacket->reliability==UNRELIABLE_WITH_ACK_RECEIPT)
+		record->reliableMessageNumber=(uint32_t)-1;
+	else
+		record->reliableMessageNumber=internalPacket->reliableMessageNumber;
+	if (record->recordType==PCR_TIMESTAMPED_INTERNAL_PACKET)
+		record->messageId=internalPacket->data[1+sizeof(SLNet::Time)];
+	else
+		record->messageId=internalPacket->data[0];
+	record->splitPacketId=internalPacket->splitPacketId;
+	record->splitPacketIndex=internalPacket->splitPacketIndex;
+	record->splitPacketCount=internalPacket->splitPacketCount;
+	record->orderingIndex=internalPacket->orderingIndex;
+	CopyPayload(record, (const char*) internalPacket->data, internalPacket->dataBitLength);
+	CommitRecord(threadBuffer);
+}
+void PacketCaptureLogger::OnAck(unsigned int messageNumber, SystemAddress remoteSystemAddress, SLNet::TimeMS time)
+{
+	ThreadBuffer *threadBuffer;
+	Record *record = AllocateRecord(threadBuffer, PCR_ACK, remoteSystemAddress);
+	if (record==0)
+		return;
+	record->time=time;
+	record->reliableMessageNumber=messageNumber;
+	CommitRecord(threadBuffer);
+}
+void PacketCaptureLogger::OnPushBackPacket(const char *data, const BitSize_t bitsUsed, SystemAddress remoteSystemAddress)
+{
+	ThreadBuffer *threadBuffer;
+	Record *record = AllocateRecord(threadBuffer, PCR_PUSH_BACK_PACKET, remoteSystemAddress);
+	if (record==0)
+		return;
+	record->time=SLNet::GetTimeMS();
+	record->bitLength=bitsUsed;
+	record->messageId=(unsigned char) data[0];
+	CopyPayload(record, data, bitsUsed);
+	CommitRecord(threadBuffer);
+}
+void PacketCaptureLogger::WriteMiscellaneous(const char *type, const char *msg)
+{
+	ThreadBuffer *threadBuffer;
+	Record *record = AllocateRecord(threadBuffer, PCR_MISCELLANEOUS, UNASSIGNED_SYSTEM_ADDRESS);
+	if (record==0)
+		return;
+	record->time=SLNet::GetTimeMS();
+	CopyText(record, type, msg);
+	CommitRecord(threadBuffer);
+}
+void PacketCaptureLogger::WriteLog(const char *str)
+{
+	if (decodeOutput)
+		fprintf(decodeOutput, "%s\n", str);
+	else
+		PacketLogger::WriteLog(str);
+}
+void PacketCaptureLogger::WriteBufferedRecords(void)
+{
+	writeMutex.Lock();
+
+	// Buffers added after this are written by the next call
+	threadBuffersMutex.Lock();
+	unsigned int numThreadBuffers=threadBuffers.Size();
+	threadBuffersMutex.Unlock();
+
+	for (unsigned int i=0; i < numThreadBuffers; i++)
+	{
+		threadBuffersMutex.Lock();
+		ThreadBuffer *threadBuffer=threadBuffers[i];
+		threadBuffersMutex.Unlock();
+
+		Record *record;
+		while ((record = threadBuffer->records.ReadLock()) != 0)
+		{
+			if (captureFile)
+			{
+				if (writeBufferUsed + sizeof(Record) > WRITE_BUFFER_SIZE)
+				{
+					fwrite(writeBuffer, 1, writeBufferUsed, captureFile);
+					writeBufferUsed=0;
+				}
+				memcpy(writeBuffer+writeBufferUsed, record, sizeof(Record));
+				writeBufferUsed+=sizeof(Record);
+			}
+			threadBuffer->records.ReadUnlock();
+		}
+	}
+
+	if (captureFile && writeBufferUsed>0)
+	{
+		fwrite(writeBuffer, 1, writeBufferUsed, captureFile);
+		fflush(captureFile);
+	}
+	writeBufferUsed=0;
+
+	writeMutex.Unlock();
+}
+void PacketCaptureLogger::WriteAddress(const SystemAddress &systemAddress, unsigned char *address, uint16_t *port, unsigned char *addressFlags, unsigned char ipv6Flag)
+{
+	*port=systemAddress.GetPort();
+#if RAKNET_SUPPORT_IPV6==1
+	if (systemAddress.GetIPVersion()==6)
+	{
+		memcpy(address, &systemAddress.address.addr6.sin6_addr, 16);
+		*addressFlags|=ipv6Flag;
+		return;
+	}
+#else
+	(void) addressFlags;
+	(void) ipv6Flag;
+#endif
+	memcpy(address, &systemAddress.address.addr4.sin_addr, 4);
+}
+SystemAddress PacketCaptureLogger::ReadAddress(const unsigned char *address, uint16_t port, bool ipv6)
+{
+	SystemAddress systemAddress;
+#if RAKNET_SUPPORT_IPV6==1
+	if (ipv6)
+	{
+		memset(&systemAddress.address.addr6, 0, sizeof(systemAddress.address.addr6));
+		systemAddress.address.addr6.sin6_family=AF_INET6;
+		memcpy(&systemAddress.address.addr6.sin6_addr, address, 16);
+		systemAddress.SetPortHostOrder(port);
+		return systemAddress;
+	}
+#else
+	(void) ipv6;
+#endif
+	systemAddress.address.addr4.sin_family=AF_INET;
+	memcpy(&systemAddress.address.addr4.sin_addr, address, 4);
+	systemAddress.SetPortHostOrder(port);
+	return systemAddress;
+}
+void PacketCaptureLogger::FormatClock(uint64_t clockUS, char buffer[128])
+{
+	// Same format as PacketLogger::GetLocalTime()
+	time_t rawtime=(time_t) (clockUS / 1000000);
+	struct tm timeinfo;
+#if defined(_WIN32)
+	localtime_s(&timeinfo, &rawtime);
+#else
+	localtime_r(&rawtime, &timeinfo);
+#endif
+	strftime(buffer, 128, "%x %X", &timeinfo);
+	char buff[32];
+	sprintf_s(buff, ".%i", (int) (clockUS % 1000000));
+	strcat_s(buffer, 128, buff);
+}
+bool PacketCaptureLogger::DecodeFile(const char *captureFilename, FILE *csvOutput, bool includePayload)
+{
+	FILE *fp;
+	if (fopen_s(&fp, captureFilename, "rb")!=0)
+		return false;
+
+	FileHeader header;
+	if (fread(&header, sizeof(header), 1, fp)!=1 ||
+		memcmp(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic))!=0 ||
+		header.byteOrderMark!=0x01020304 ||
+		header.recordSize < sizeof(Record) - PACKET_CAPTURE_PAYLOAD_BYTES ||
+		header.recordSize != sizeof(Record) - PACKET_CAPTURE_PAYLOAD_BYTES + header.payloadBytes)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	// Files may have been captured with a different PACKET_CAPTURE_PAYLOAD_BYTES
+	unsigned char *recordData = (unsigned char*) rakMalloc_Ex(header.recordSize, _FILE_AND_LINE_);
+	unsigned char *payload = (unsigned char*) rakMalloc_Ex(header.payloadBytes+1, _FILE_AND_LINE_);
+	decodeOutput=csvOutput;
+	LogHeader();
+	while (fread(recordData, header.recordSize, 1, fp)==1)
+	{
+		Record record;
+		memcpy(&record, recordData, sizeof(Record) - PACKET_CAPTURE_PAYLOAD_BYTES);
+		memcpy(payload, recordData + sizeof(Record) - PACKET_CAPTURE_PAYLOAD_BYTES, header.payloadBytes);
+		if (record.payloadLength > header.payloadBytes)
+			record.payloadLength=(unsigned char) header.payloadBytes;
+		payload[record.payloadLength]=0;
+
+		char str[1024], line[1200];
+		char clock[128];
+		FormatClock(record.clockUS, clock);
+		char localStr[64], remoteStr[62];
+		SystemAddress local=ReadAddress(record.localAddress, record.localPort, (record.addressFlags & 1)!=0);
+		SystemAddress remote=ReadAddress(record.remoteAddress, record.remotePort, (record.addressFlags & 2)!=0);
+		local.ToString(true, localStr, static_cast<size_t>(64));
+		remote.ToString(true, remoteStr, static_cast<size_t>(62));
+		bool hasBinaryPayload=true;
+
+		switch (record.recordType)
+		{
+		case PCR_SEND_RAW:
+		case PCR_RECEIVE_RAW:
+			FormatLine(str, 1024, record.recordType==PCR_SEND_RAW ? "Snd" : "Rcv", "Raw", 0, 0, record.messageId, record.bitLength, record.time, local, remote, (unsigned int)-1, (unsigned int)-1, (unsigned int)-1, (unsigned int)-1);
+			break;
+		case PCR_RELIABILITY_ERROR:
+		case PCR_RELIABILITY_WARNING:
+			FormatLine(str, 1024, record.recordType==PCR_RELIABILITY_ERROR ? "RcvErr" : "RcvWrn", (const char*) payload, 0, 0, "", record.bitLength, record.time, local, remote, (unsigned int)-1, (unsigned int)-1, (unsigned int)-1, (unsigned int)-1);
+			hasBinaryPayload=false;
+			break;
+		case PCR_INTERNAL_PACKET:
+		case PCR_TIMESTAMPED_INTERNAL_PACKET:
+		{
+			static const char *sendTypes[] =
+			{
+				"Rcv",
+				"Snd",
+				"Err1",
+				"Err2",
+				"Err3",
+				"Err4",
+				"Err5",
+				"Err6",
+			};
+			const char *sendType = record.direction < 8 ? sendTypes[record.direction] : "Err";
+			FormatLine(str, 1024, sendType, record.recordType==PCR_TIMESTAMPED_INTERNAL_PACKET ? "Tms" : "Nrm", record.reliableMessageNumber, record.frameNumber, record.messageId, record.bitLength, record.time, local, remote, record.splitPacketId, record.splitPacketIndex, record.splitPacketCount, record.orderingIndex);
+			break;
+		}
+		case PCR_ACK:
+			sprintf_s(str, "%s,Rcv,Ack,%i,,,,%" PRINTF_64_BIT_MODIFIER "u,%s,%s,,,,,,", clock, record.reliableMessageNumber, (unsigned long long) record.time, localStr, remoteStr);
+			hasBinaryPayload=false;
+			break;
+		case PCR_PUSH_BACK_PACKET:
+			sprintf_s(str, "%s,Lcl,PBP,,,%s,%i,%" PRINTF_64_BIT_MODIFIER "u,%s,%s,,,,,,", clock, IDTOString(record.messageId), record.bitLength, (unsigned long long) record.time, localStr, remoteStr);
+			break;
+		case PCR_MISCELLANEOUS:
+		{
+			// Type and message are stored one after the other
+			const char *type = (const char*) payload;
+			size_t typeLength = strlen(type);
+			const char *msg = typeLength < record.payloadLength ? type + typeLength + 1 : "";
+			sprintf_s(str, "%s,Lcl,%s,,,,,%" PRINTF_64_BIT_MODIFIER "u,%s,,,,,,,%s", clock, type, (unsigned long long) record.time, localStr, msg);
+			hasBinaryPayload=false;
+			break;
+		}
+		default:
+			continue;
+		}
+
+		// FormatLine() puts the current time first, replace it with the captured time
+		const char *afterClock = str;
+		if (record.recordType!=PCR_ACK && record.recordType!=PCR_PUSH_BACK_PACKET && record.recordType!=PCR_MISCELLANEOUS)
+		{
+			afterClock = strchr(str, ',');
+			if (afterClock==0)
+				afterClock = str;
+			sprintf_s(line, "%s%s", clock, afterClock);
+		}
+		else
+		{
+			strcpy_s(line, str);
+		}
+
+		if (includePayload && hasBinaryPayload)
+		{
+			size_t lineLength = strlen(line);
+			for (unsigned int i=0; i < record.payloadLength && lineLength+3 < sizeof(line); i++)
+			{
+				sprintf_s(line+lineLength, sizeof(line)-lineLength, "%02x", payload[i]);
+				lineLength+=2;
+			}
+		}
+		AddToLog(line);
+	}
+	decodeOutput=0;
+
+	rakFree_Ex(payload, _FILE_AND_LINE_);
+	rakFree_Ex(recordData, _FILE_AND_LINE_);
+	fclose(fp);
+	return true;
+}
+
+RAK_THREAD_DECLARATION(SLNet::PacketCaptureWriterLoop)
+{
+	PacketCaptureLogger *packetCaptureLogger = (PacketCaptureLogger*) arguments;
+	packetCaptureLogger->writerThreadRunning.Increment();
+	while (packetCaptureLogger->capturing.GetValue()!=0)
+	{
+		packetCaptureLogger->WriteBufferedRecords();
+		RakSleep(packetCaptureLogger->flushIntervalMS);
+	}
+	packetCaptureLogger->writerThreadRunning.Decrement();
+	return 0;
+}
+
+#endif // _RAKNET_SUPPORT_*
@@ -23,6 +23,7 @@
 #include "slikenet/sleep.h"
 #include "slikenet/defines.h"
 #include "slikenet/DS_Queue.h"
+#include "slikenet/SuperFastHash.h"
 //#include "slikenet/GetTime.h"
 #include "slikenet/linux_adapter.h"
 #include "slikenet/osx_adapter.h"
@@ -104,7 +105,13 @@ enum RPC4Identifiers
 	ID_RPC4_CALL,
 	ID_RPC4_RETURN,
 	ID_RPC4_SIGNAL,
+	ID_RPC4_CALL_BY_ID,
+	ID_RPC4_SIGNAL_BY_ID,
+	// Name of a function or slot, and the id the sender assigned to it
+	ID_RPC4_IDENTIFIER_ID,
 };
+// Sent as ID_RPC4_SIGNAL with this name to announce that the sender understands ids. Earlier versions ignore signals to slots they do not have.
+static const char *USES_IDENTIFIER_IDS_SIGNAL="";
 int RPC4::LocalSlotObjectComp( const LocalSlotObject &key, const LocalSlotObject &data )
 {
 	if (key.callPriority>data.callPriority)
@@ -134,6 +141,9 @@ RPC4::RPC4()
 	gotBlockingReturnValue=false;
 	nextSlotRegistrationCount=0;
 	interruptSignal=false;
+	identifierTable=0;
+	identifierTableSize=0;
+	useIdentifierIds=true;
 }
 RPC4::~RPC4()
 {
@@ -152,6 +162,11 @@ RPC4::~RPC4()
 		SLNet::OP_DELETE(outputList[j],_FILE_AND_LINE_);
 	}
 	localSlots.Clear(_FILE_AND_LINE_);
+
+	for (j=0; j < identifiers.Size(); j++)
+		SLNet::OP_DELETE(identifiers[j],_FILE_AND_LINE_);
+	rakFree_Ex(identifierTable,_FILE_AND_LINE_);
+	ClearRemoteSystemIdentifiers();
 }
 bool RPC4::RegisterFunction(const char* uniqueID, void ( *functionPointer ) (SLNet::BitStream *userData, Packet *packet ))
 {
@@ -160,6 +175,7 @@ bool RPC4::RegisterFunction(const char* uniqueID, void ( *functionPointer ) (SLN
 		return false;
 
 	registeredNonblockingFunctions.Push(uniqueID,functionPointer,_FILE_AND_LINE_);
+	identifiers[AddIdentifier(uniqueID)]->nonblockingFunction=functionPointer;
 	return true;
 }
 void RPC4::RegisterSlot(const char *sharedIdentifier, void ( *functionPointer ) (SLNet::BitStream *userData, Packet *packet ), int callPriority)
@@ -171,6 +187,7 @@ void RPC4::RegisterSlot(const char *sharedIdentifier, void ( *functionPointer )
 	{
 		localSlot = SLNet::OP_NEW<LocalSlot>(_FILE_AND_LINE_);
 		localSlots.Push(sharedIdentifier, localSlot,_FILE_AND_LINE_);
+		identifiers[AddIdentifier(sharedIdentifier)]->localSlot=localSlot;
 	}
 	else
 	{
@@ -185,6 +202,7 @@ bool RPC4::RegisterBlockingFunction(const char* uniqueID, void ( *functionPointe
 		return false;
 
 	registeredBlockingFunctions.Push(uniqueID,functionPointer,_FILE_AND_LINE_);
+	identifiers[AddIdentifier(uniqueID)]->blockingFunction=functionPointer;
 	return true;
 }
 void RPC4::RegisterLocalCallback(const char* uniqueID, MessageID messageId)
@@ -213,12 +231,18 @@ void RPC4::RegisterLocalCallback(const char* uniqueID, MessageID messageId)
 bool RPC4::UnregisterFunction(const char* uniqueID)
 {
 	void ( *f ) (SLNet::BitStream *, Packet * );
-	return registeredNonblockingFunctions.Pop(f,uniqueID,_FILE_AND_LINE_);
+	if (registeredNonblockingFunctions.Pop(f,uniqueID,_FILE_AND_LINE_)==false)
+		return false;
+	identifiers[FindIdentifier(uniqueID)]->nonblockingFunction=0;
+	return true;
 }
 bool RPC4::UnregisterBlockingFunction(const char* uniqueID)
 {
 	void ( *f ) (SLNet::BitStream *, SLNet::BitStream *,Packet * );
-	return registeredBlockingFunctions.Pop(f,uniqueID,_FILE_AND_LINE_);
+	if (registeredBlockingFunctions.Pop(f,uniqueID,_FILE_AND_LINE_)==false)
+		return false;
+	identifiers[FindIdentifier(uniqueID)]->blockingFunction=0;
+	return true;
 }
 bool RPC4::UnregisterLocalCallback(const char* uniqueID, MessageID messageId)
 {
@@ -253,6 +277,7 @@ bool RPC4::UnregisterSlot(const char* sharedIdentifier)
 		LocalSlot *ls = localSlots.ItemAtIndex(hi);
 		SLNet::OP_DELETE(ls, _FILE_AND_LINE_);
 		localSlots.RemoveAtIndex(hi, _FILE_AND_LINE_);
+		identifiers[FindIdentifier(sharedIdentifier)]->localSlot=0;
 		return true;
 	}
 	
@@ -325,8 +350,17 @@ void RPC4::Call( const char* uniqueID, SLNet::BitStream * bitStream, PacketPrior
 {
 	SLNet::BitStream out;
 	out.Write((MessageID) ID_RPC_PLUGIN);
-	out.Write((MessageID) ID_RPC4_CALL);
-	out.WriteCompressed(uniqueID);
+	unsigned int remoteId;
+	if (GetRemoteIdentifierId(uniqueID, systemIdentifier, broadcast, &remoteId))
+	{
+		out.Write((MessageID) ID_RPC4_CALL_BY_ID);
+		out.WriteCompressed(remoteId);
+	}
+	else
+	{
+		out.Write((MessageID) ID_RPC4_CALL);
+		out.WriteCompressed(uniqueID);
+	}
 	out.Write(false); // Nonblocking
 	if (bitStream)
 	{
@@ -340,8 +374,17 @@ bool RPC4::CallBlocking( const char* uniqueID, SLNet::BitStream * bitStream, Pac
 {
 	SLNet::BitStream out;
 	out.Write((MessageID) ID_RPC_PLUGIN);
-	out.Write((MessageID) ID_RPC4_CALL);
-	out.WriteCompressed(uniqueID);
+	unsigned int remoteId;
+	if (GetRemoteIdentifierId(uniqueID, systemIdentifier, false, &remoteId))
+	{
+		out.Write((MessageID) ID_RPC4_CALL_BY_ID);
+		out.WriteCompressed(remoteId);
+	}
+	else
+	{
+		out.Write((MessageID) ID_RPC4_CALL);
+		out.WriteCompressed(uniqueID);
+	}
 	out.Write(true); // Blocking
 	if (bitStream)
 	{
@@ -418,8 +461,17 @@ void RPC4::Signal(const char *sharedIdentifier, SLNet::BitStream *bitStream, Pac
 {
 	SLNet::BitStream out;
 	out.Write((MessageID) ID_RPC_PLUGIN);
-	out.Write((MessageID) ID_RPC4_SIGNAL);
-	out.WriteCompressed(sharedIdentifier);
+	unsigned int remoteId;
+	if (GetRemoteIdentifierId(sharedIdentifier, systemIdentifier, broadcast, &remoteId))
+	{
+		out.Write((MessageID) ID_RPC4_SIGNAL_BY_ID);
+		out.WriteCompressed(remoteId);
+	}
+	else
+	{
+		out.Write((MessageID) ID_RPC4_SIGNAL);
+		out.WriteCompressed(sharedIdentifier);
+	}
 	if (bitStream)
 	{
 		bitStream->ResetReadPointer();
@@ -474,8 +526,14 @@ void RPC4::InvokeSignal(DataStructures::HashIndex functionIndex, SLNet::BitStrea
 	//TimeUS t2=0;
 	//TimeUS t3=0;
 
+	InvokeSignal(localSlots.ItemAtIndex(functionIndex), serializedParameters, packet);
+}
+void RPC4::InvokeSignal(LocalSlot *localSlot, SLNet::BitStream *serializedParameters, Packet *packet)
+{
+	if (localSlot==0)
+		return;
+
 	interruptSignal=false;
-	LocalSlot *localSlot = localSlots.ItemAtIndex(functionIndex);
 	unsigned int i;
 	i=0;
 	while (i < localSlot->slotObjects.Size())
@@ -551,6 +609,7 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 
 				void ( *fp ) (SLNet::BitStream *, Packet * );
 				fp = registeredNonblockingFunctions.ItemAtIndex(skhi);
+				SendIdentifierId(functionName.C_String(), packet);
 				bsIn.AlignReadToByteBoundary();
 				fp(&bsIn,packet);
 			}
@@ -569,6 +628,7 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 
 				void ( *fp ) (SLNet::BitStream *, SLNet::BitStream *, Packet * );
 				fp = registeredBlockingFunctions.ItemAtIndex(skhi);
+				SendIdentifierId(functionName.C_String(), packet);
 				SLNet::BitStream returnData;
 				bsIn.AlignReadToByteBoundary();
 				fp(&bsIn, &returnData, packet);
@@ -586,16 +646,90 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 		{
 			SLNet::RakString sharedIdentifier;
 			bsIn.ReadCompressed(sharedIdentifier);
+			if (sharedIdentifier==USES_IDENTIFIER_IDS_SIGNAL)
+			{
+				if (packet->guid!=UNASSIGNED_RAKNET_GUID)
+					GetRemoteSystemIdentifiers(packet->guid, true)->usesIds=true;
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+			}
 			DataStructures::HashIndex functionIndex;
 			functionIndex = localSlots.GetIndexOf(sharedIdentifier);
+			if (functionIndex.IsInvalid()==false)
+				SendIdentifierId(sharedIdentifier.C_String(), packet);
 			SLNet::BitStream serializedParameters;
             bsIn.AlignReadToByteBoundary();
 			bsIn.Read(&serializedParameters);
 			InvokeSignal(functionIndex, &serializedParameters, packet);
 		}
-		else
+		else if (packet->data[1]==ID_RPC4_CALL_BY_ID)
+		{
+			unsigned int id=(unsigned int)-1;
+			bsIn.ReadCompressed(id);
+			bool isBlocking=false;
+			bsIn.Read(isBlocking);
+			// Ids are only sent after we assigned them, so an unknown id means a corrupt or malicious message
+			if (id >= identifiers.Size())
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+			Identifier *identifier = identifiers[id];
+			if ((isBlocking==false && identifier->nonblockingFunction==0) || (isBlocking==true && identifier->blockingFunction==0))
+			{
+				SLNet::BitStream bsOut;
+				bsOut.Write((unsigned char) ID_RPC_REMOTE_ERROR);
+				bsOut.Write((unsigned char) RPC_ERROR_FUNCTION_NOT_REGISTERED);
+				bsOut.Write(identifier->name.C_String(),(unsigned int) identifier->name.GetLength()+1);
+				SendUnified(&bsOut,HIGH_PRIORITY,RELIABLE_ORDERED,0,packet->systemAddress,false);
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+			}
+
+			bsIn.AlignReadToByteBoundary();
+			if (isBlocking==false)
+			{
+				identifier->nonblockingFunction(&bsIn,packet);
+			}
+			else
+			{
+				SLNet::BitStream returnData;
+				identifier->blockingFunction(&bsIn, &returnData, packet);
+
+				SLNet::BitStream out;
+				out.Write((MessageID) ID_RPC_PLUGIN);
+				out.Write((MessageID) ID_RPC4_RETURN);
+				returnData.ResetReadPointer();
+				out.AlignWriteToByteBoundary();
+				out.Write(returnData);
+				SendUnified(&out,IMMEDIATE_PRIORITY,RELIABLE_ORDERED,0,packet->systemAddress,false);
+			}
+		}
+		else if (packet->data[1]==ID_RPC4_SIGNAL_BY_ID)
+		{
+			unsigned int id=(unsigned int)-1;
+			bsIn.ReadCompressed(id);
+			if (id >= identifiers.Size())
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+			SLNet::BitStream serializedParameters;
+			bsIn.AlignReadToByteBoundary();
+			bsIn.Read(&serializedParameters);
+			InvokeSignal(identifiers[id]->localSlot, &serializedParameters, packet);
+		}
+		else if (packet->data[1]==ID_RPC4_IDENTIFIER_ID)
+		{
+			SLNet::RakString name;
+			unsigned int remoteId;
+			bsIn.ReadCompressed(name);
+			if (useIdentifierIds==false || bsIn.ReadCompressed(remoteId)==false || remoteId==(unsigned int) -1)
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+
+			// Only accept ids for names this system sent to the remote system, so the tables stay bounded by the local names
+			RemoteSystemIdentifiers *rsi = GetRemoteSystemIdentifiers(packet->guid, false);
+			unsigned int localId = FindIdentifier(name.C_String());
+			if (rsi==0 || localId >= rsi->sentNames.Size() || rsi->sentNames[localId]==false)
+				return RR_STOP_PROCESSING_AND_DEALLOCATE;
+			while (rsi->remoteIds.Size() <= localId)
+				rsi->remoteIds.Push(0, _FILE_AND_LINE_);
+			rsi->remoteIds[localId]=remoteId+1;
+		}
+		else if (packet->data[1]==ID_RPC4_RETURN)
 		{
-			RakAssert(packet->data[1]==ID_RPC4_RETURN);
 			blockingReturnValue.Reset();
 			blockingReturnValue.Write(bsIn);
 			gotBlockingReturnValue=true;
@@ -628,9 +762,174 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 
 	return RR_CONTINUE_PROCESSING;
 }
+void RPC4::OnClosedConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, PI2_LostConnectionReason lostConnectionReason )
+{
+	(void) systemAddress;
+	(void) lostConnectionReason;
+
+	DataStructures::HashIndex hi = remoteSystemIdentifiers.GetIndexOf(rakNetGUID);
+	if (hi.IsInvalid()==false)
+	{
+		SLNet::OP_DELETE(remoteSystemIdentifiers.ItemAtIndex(hi), _FILE_AND_LINE_);
+		remoteSystemIdentifiers.RemoveAtIndex(hi, _FILE_AND_LINE_);
+	}
+}
+void RPC4::OnNewConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, bool isIncoming)
+{
+	(void) systemAddress;
+	(void) isIncoming;
+
+	if (useIdentifierIds)
+		SendUsesIdentifierIds(rakNetGUID, false);
+}
+void RPC4::OnRakPeerShutdown(void)
+{
+	ClearRemoteSystemIdentifiers();
+}
 DataStructures::HashIndex RPC4::GetLocalSlotIndex(const char *sharedIdentifier)
 {
 	return localSlots.GetIndexOf(sharedIdentifier);
 }
+void RPC4::SetUseIdentifierIds(bool use)
+{
+	if (use && useIdentifierIds==false)
+		SendUsesIdentifierIds(UNASSIGNED_SYSTEM_ADDRESS, true);
+	useIdentifierIds=use;
+}
+unsigned int RPC4::FindIdentifier(const char *name) const
+{
+	if (identifierTableSize==0)
+		return (unsigned int) -1;
+
+	unsigned int slot = SuperFastHash(name, (int) strlen(name)) & (identifierTableSize-1);
+	while (identifierTable[slot]!=0)
+	{
+		if (strcmp(identifiers[identifierTable[slot]-1]->name.C_String(), name)==0)
+			return identifierTable[slot]-1;
+		slot=(slot+1) & (identifierTableSize-1);
+	}
+	return (unsigned int) -1;
+}
+unsigned int RPC4::AddIdentifier(const char *name)
+{
+	unsigned int id = FindIdentifier(name);
+	if (id!=(unsigned int) -1)
+		return id;
+
+	// Keep the table at most half full, so probe sequences stay short
+	if ((identifiers.Size()+1)*2 > identifierTableSize)
+	{
+		unsigned int newSize = identifierTableSize==0 ? 64 : identifierTableSize*2;
+		rakFree_Ex(identifierTable,_FILE_AND_LINE_);
+		identifierTable = (unsigned int*) rakMalloc_Ex(newSize*sizeof(unsigned int),_FILE_AND_LINE_);
+		memset(identifierTable, 0, newSize*sizeof(unsigned int));
+		identifierTableSize=newSize;
+		for (unsigned int i=0; i < identifiers.Size(); i++)
+		{
+			const SLNet::RakString &existing = identifiers[i]->name;
+			unsigned int slot = SuperFastHash(existing.C_String(), (int) existing.GetLength()) & (identifierTableSize-1);
+			while (identifierTable[slot]!=0)
+				slot=(slot+1) & (identifierTableSize-1);
+			identifierTable[slot]=i+1;
+		}
+	}
+
+	Identifier *identifier = SLNet::OP_NEW<Identifier>(_FILE_AND_LINE_);
+	identifier->name=name;
+	identifier->hash=SuperFastHash(name, (int) strlen(name));
+	identifier->localSlot=0;
+	identifier->nonblockingFunction=0;
+	identifier->blockingFunction=0;
+	id = identifiers.Size();
+	identifiers.Push(identifier,_FILE_AND_LINE_);
+
+	unsigned int slot = identifier->hash & (identifierTableSize-1);
+	while (identifierTable[slot]!=0)
+		slot=(slot+1) & (identifierTableSize-1);
+	identifierTable[slot]=id+1;
+	return id;
+}
+bool RPC4::GetRemoteIdentifierId(const char *name, const AddressOrGUID &systemIdentifier, bool broadcast, unsigned int *remoteId)
+{
+	// Broadcasts go to systems which may have assigned different ids, and TCP has no RakPeer GUIDs
+	if (useIdentifierIds==false || broadcast || rakPeerInterface==0 || remoteSystemIdentifiers.Size()==0)
+		return false;
+
+	RakNetGUID guid = systemIdentifier.rakNetGuid;
+	if (guid==UNASSIGNED_RAKNET_GUID)
+		guid = rakPeerInterface->GetGuidFromSystemAddress(systemIdentifier.systemAddress);
+	RemoteSystemIdentifiers *rsi = GetRemoteSystemIdentifiers(guid, false);
+	if (rsi==0 || rsi->usesIds==false)
+		return false;
+
+	unsigned int localId = AddIdentifier(name);
+	if (localId < rsi->remoteIds.Size() && rsi->remoteIds[localId]!=0)
+	{
+		*remoteId=rsi->remoteIds[localId]-1;
+		return true;
+	}
+	while (rsi->sentNames.Size() <= localId)
+		rsi->sentNames.Push(false, _FILE_AND_LINE_);
+	rsi->sentNames[localId]=true;
+	return false;
+}
+void RPC4::SendIdentifierId(const char *name, Packet *packet)
+{
+	if (useIdentifierIds==false || packet->guid==UNASSIGNED_RAKNET_GUID)
+		return;
+
+	unsigned int id = FindIdentifier(name);
+	if (id==(unsigned int) -1)
+		return;
+	// Earlier versions would take the reply for a return value
+	RemoteSystemIdentifiers *rsi = GetRemoteSystemIdentifiers(packet->guid, false);
+	if (rsi==0 || rsi->usesIds==false)
+		return;
+	while (rsi->sentIds.Size() <= id)
+		rsi->sentIds.Push(false, _FILE_AND_LINE_);
+	if (rsi->sentIds[id])
+		return;
+	rsi->sentIds[id]=true;
+
+	SLNet::BitStream bsOut;
+	bsOut.Write((MessageID) ID_RPC_PLUGIN);
+	bsOut.Write((MessageID) ID_RPC4_IDENTIFIER_ID);
+	bsOut.WriteCompressed(identifiers[id]->name);
+	bsOut.WriteCompressed(id);
+	SendUnified(&bsOut,HIGH_PRIORITY,RELIABLE_ORDERED,0,packet->systemAddress,false);
+}
+void RPC4::SendUsesIdentifierIds(const AddressOrGUID &systemIdentifier, bool broadcast)
+{
+	// TCP has no RakPeer GUIDs to keep ids by
+	if (rakPeerInterface==0)
+		return;
+
+	SLNet::BitStream bsOut;
+	bsOut.Write((MessageID) ID_RPC_PLUGIN);
+	bsOut.Write((MessageID) ID_RPC4_SIGNAL);
+	bsOut.WriteCompressed(USES_IDENTIFIER_IDS_SIGNAL);
+	SendUnified(&bsOut,HIGH_PRIORITY,RELIABLE_ORDERED,0,systemIdentifier,broadcast);
+}
+RPC4::RemoteSystemIdentifiers* RPC4::GetRemoteSystemIdentifiers(RakNetGUID guid, bool create)
+{
+	DataStructures::HashIndex hi = remoteSystemIdentifiers.GetIndexOf(guid);
+	if (hi.IsInvalid()==false)
+		return remoteSystemIdentifiers.ItemAtIndex(hi);
+	if (create==false)
+		return 0;
+
+	RemoteSystemIdentifiers *rsi = SLNet::OP_NEW<RemoteSystemIdentifiers>(_FILE_AND_LINE_);
+	remoteSystemIdentifiers.Push(guid, rsi, _FILE_AND_LINE_);
+	return rsi;
+}
+void RPC4::ClearRemoteSystemIdentifiers(void)
+{
+	DataStructures::List<RemoteSystemIdentifiers*> itemList;
+	DataStructures::List<RakNetGUID> keyList;
+	remoteSystemIdentifiers.GetAsList(itemList, keyList, _FILE_AND_LINE_);
+	for (unsigned int i=0; i < itemList.Size(); i++)
+		SLNet::OP_DELETE(itemList[i], _FILE_AND_LINE_);
+	remoteSystemIdentifiers.Clear(_FILE_AND_LINE_);
+}
 
 #endif // _RAKNET_SUPPORT_*
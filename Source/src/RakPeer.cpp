@@ -163,6 +163,8 @@ Packet *RakPeer::AllocPacket(unsigned dataSize, const char *file, unsigned int l
 	p->deleteData=true;
 	p->guid=UNASSIGNED_RAKNET_GUID;
 	p->wasGeneratedLocally=false;
+	p->isBehindData=false;
+	pooledPacketCount.Increment();
 	return p;
 }
 
@@ -181,6 +183,26 @@ Packet *RakPeer::AllocPacket(unsigned dataSize, unsigned char *data, const char
 	p->deleteData=true;
 	p->guid=UNASSIGNED_RAKNET_GUID;
 	p->wasGeneratedLocally=false;
+	p->isBehindData=false;
+	pooledPacketCount.Increment();
+	return p;
+}
+
+Packet *RakPeer::AllocPacket(unsigned dataSize, unsigned char *data, void *packetMemory, const char *file, unsigned int line)
+{
+	if (packetMemory==0)
+		return AllocPacket(dataSize, data, file, line);
+
+	// No lock or second allocation, as the memory was allocated with the data
+	SLNet::Packet *p = new (packetMemory) Packet;
+	p->data=data;
+	p->length=dataSize;
+	p->bitSize=BYTES_TO_BITS(dataSize);
+	p->deleteData=true;
+	p->guid=UNASSIGNED_RAKNET_GUID;
+	p->wasGeneratedLocally=false;
+	p->isBehindData=true;
+	packetsBehindDataCount.Increment();
 	return p;
 }
 
@@ -197,6 +219,7 @@ RakPeer::RakPeer()
 	_using_security = false;
 	_server_handshake = 0;
 	_cookie_jar = 0;
+	numHandshakeThreads = 0;
 #endif
 
 	StringCompressor::AddReference();
@@ -214,6 +237,14 @@ RakPeer::RakPeer()
 	remoteSystemLookup=0;
 	bytesSentPerSecond = bytesReceivedPerSecond = 0;
 	endThreads = true;
+
+#if LIBCAT_SECURITY==1
+	// Prefer the ciphers of OpenSSL, which use the AES and vector instructions of the CPU
+	const CipherSuite defaultCipherSuites[] = {CIPHER_SUITE_AES_128_GCM, CIPHER_SUITE_CHACHA20_POLY1305, CIPHER_SUITE_CALICO};
+	numCipherSuites = 0;
+	SetCipherSuites(defaultCipherSuites, sizeof(defaultCipherSuites) / sizeof(defaultCipherSuites[0]));
+#endif
+
 	isMainLoopThreadActive = false;
 	incomingDatagramEventHandler=0;
 
@@ -657,6 +688,15 @@ StartupResult RakPeer::Startup( unsigned int maxConnections, SocketDescriptor *s
 		ClearBufferedPackets();
 		ClearSocketQueryOutput();
 
+#if LIBCAT_SECURITY==1
+		// Key agreement of incoming secure connections, see SetHandshakeThreads(). Runs on the network thread if the threads cannot be started.
+		if (_using_security && numHandshakeThreads > 0)
+		{
+			handshakeThreadPool.SetThreadDataInterface(&handshakeThreadData, this);
+			handshakeThreadPool.StartThreads((int) numHandshakeThreads, 0);
+		}
+#endif
+
 		if ( isMainLoopThreadActive == false )
 		{
 #if RAKPEER_USER_THREADED!=1
@@ -792,6 +832,7 @@ bool RakPeer::InitializeSecurity(const char *public_key, const char *private_key
 		_server_handshake->FillCookieJar(_cookie_jar);
 
 		memcpy(my_public_key, public_key, sizeof(my_public_key));
+		memcpy(my_private_key, private_key, sizeof(my_private_key));
 
 		_using_security = true;
 		return true;
@@ -827,11 +868,195 @@ void RakPeer::DisableSecurity( void )
 	_server_handshake=0;
 	SLNet::OP_DELETE(_cookie_jar,_FILE_AND_LINE_);
 	_cookie_jar=0;
+	memset(my_private_key, 0, sizeof(my_private_key));
 
 	_using_security = false;
 #endif
 }
 
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SetCipherSuites( const CipherSuite *_cipherSuites, unsigned int _numCipherSuites )
+{
+#if LIBCAT_SECURITY==1
+	if ( endThreads == false )
+		return;
+
+	numCipherSuites = 0;
+	for (unsigned int i=0; i < _numCipherSuites; i++)
+	{
+		// Skip duplicates and suites OpenSSL does not implement
+		if (_cipherSuites[i] >= CIPHER_SUITE_COUNT || (GetCipherSuiteMask() & (1 << _cipherSuites[i])) != 0)
+			continue;
+		if (_cipherSuites[i] != CIPHER_SUITE_CALICO && AeadEncryption::IsSupported(_cipherSuites[i]) == false)
+			continue;
+		cipherSuites[numCipherSuites++] = _cipherSuites[i];
+	}
+#else
+	(void) _cipherSuites;
+	(void) _numCipherSuites;
+#endif
+}
+
+#if LIBCAT_SECURITY==1
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+unsigned char RakPeer::GetCipherSuiteMask(void) const
+{
+	unsigned char mask = 0;
+	for (unsigned int i=0; i < numCipherSuites; i++)
+		mask |= (unsigned char) (1 << cipherSuites[i]);
+	return mask;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+CipherSuite RakPeer::ChooseCipherSuite(unsigned char remoteCipherSuiteMask) const
+{
+	for (unsigned int i=0; i < numCipherSuites; i++)
+	{
+		if (remoteCipherSuiteMask & (1 << cipherSuites[i]))
+			return cipherSuites[i];
+	}
+	return CIPHER_SUITE_CALICO;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool RakPeer::IsCipherSuiteAllowed(unsigned char cipherSuite) const
+{
+	return cipherSuite < CIPHER_SUITE_COUNT && (GetCipherSuiteMask() & (1 << cipherSuite))!=0;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Sent by the connecting system instead of the proof of the key if the cipher suite was negotiated.
+// Covers the offered and the chosen cipher suites, which are sent before the key is known, so that changing either fails the connection.
+static bool GenerateCipherSuiteProof(cat::AuthenticatedEncryption *authenticatedEncryption, bool weInitiatedTheConnection, unsigned char offeredCipherSuiteMask, unsigned char cipherSuite, unsigned char proof[cat::EasyHandshake::PROOF_BYTES])
+{
+	char keyName[64];
+	sprintf_s(keyName, "cipher-suites-%02x-%02x", offeredCipherSuiteMask, cipherSuite);
+	return authenticatedEncryption->GenerateKey(weInitiatedTheConnection, keyName, proof, cat::EasyHandshake::PROOF_BYTES);
+}
+#endif // LIBCAT_SECURITY
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SetHandshakeThreads( unsigned int numThreads )
+{
+#if LIBCAT_SECURITY==1
+	if ( endThreads == false )
+		return;
+
+	numHandshakeThreads = numThreads;
+#else
+	(void) numThreads;
+#endif
+}
+
+#if LIBCAT_SECURITY==1
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void* RakPeer::HandshakeThreadData::PerThreadFactory(void *context)
+{
+	RakPeer *rakPeer = (RakPeer*) context;
+	cat::ServerEasyHandshake *serverHandshake = SLNet::OP_NEW<cat::ServerEasyHandshake>(_FILE_AND_LINE_);
+	if (serverHandshake->Initialize(rakPeer->my_public_key, rakPeer->my_private_key)==false)
+	{
+		SLNet::OP_DELETE(serverHandshake,_FILE_AND_LINE_);
+		return 0;
+	}
+	return serverHandshake;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::HandshakeThreadData::PerThreadDestructor(void* factoryResult, void *context)
+{
+	(void) context;
+	if (factoryResult)
+		SLNet::OP_DELETE((cat::ServerEasyHandshake*) factoryResult,_FILE_AND_LINE_);
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+RakPeer::HandshakeJob* RakPeer::ProcessHandshakeJob(HandshakeJob *job, bool *returnOutput, void* perThreadData)
+{
+	cat::ServerEasyHandshake *serverHandshake = (cat::ServerEasyHandshake*) perThreadData;
+	job->success = serverHandshake!=0 && serverHandshake->ProcessChallenge(job->challenge, job->answer, &job->authenticatedEncryption);
+
+	// Wake up the network thread to send the answer
+	*returnOutput=true;
+	job->rakPeer->quitAndDataEvents.SetEvent();
+	return job;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::CompleteHandshakeJobs(void)
+{
+	while (handshakeThreadPool.HasOutputFast() && handshakeThreadPool.HasOutput())
+	{
+		HandshakeJob *job = handshakeThreadPool.GetOutput();
+
+		// The remote system may have been dropped, or its slot reused, while the key agreement ran
+		RemoteSystemStruct *remoteSystem = GetRemoteSystemFromSystemAddress(job->systemAddress, true, true);
+		if (remoteSystem==0 || remoteSystem->guid!=job->guid || remoteSystem->handshakePending==false ||
+			remoteSystem->connectMode!=RemoteSystemStruct::UNVERIFIED_SENDER)
+		{
+			SLNet::OP_DELETE(job,_FILE_AND_LINE_);
+			continue;
+		}
+		remoteSystem->handshakePending=false;
+
+		if (job->success==false)
+		{
+			CAT_AUDIT_PRINTF("AUDIT: Challenge BAD!\n");
+
+			// Unassign this remote system
+			DereferenceRemoteSystem(job->systemAddress);
+			SLNet::OP_DELETE(job,_FILE_AND_LINE_);
+			continue;
+		}
+		CAT_AUDIT_PRINTF("AUDIT: Challenge good!\n");
+
+		*remoteSystem->reliabilityLayer.GetAuthenticatedEncryption() = job->authenticatedEncryption;
+		memcpy(remoteSystem->answer, job->answer, sizeof(remoteSystem->answer));
+
+		// Same as the reply ProcessOfflineNetworkPacket() sends when it runs the key agreement itself
+		SLNet::BitStream bsAnswer;
+		bsAnswer.Write((MessageID)ID_OPEN_CONNECTION_REPLY_2);
+		bsAnswer.WriteAlignedBytes((const unsigned char*) OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
+		bsAnswer.Write(GetGuidFromSystemAddress(UNASSIGNED_SYSTEM_ADDRESS));
+		bsAnswer.Write(job->systemAddress);
+		bsAnswer.Write(job->mtu);
+		bsAnswer.Write(true);
+		bsAnswer.WriteAlignedBytes((const unsigned char *) remoteSystem->answer,sizeof(remoteSystem->answer));
+		if (job->remoteCipherSuiteMask)
+		{
+			remoteSystem->remoteCipherSuiteMask=job->remoteCipherSuiteMask;
+			remoteSystem->reliabilityLayer.SetCipherSuite(ChooseCipherSuite(job->remoteCipherSuiteMask));
+			bsAnswer.Write((unsigned char) remoteSystem->reliabilityLayer.GetCipherSuite());
+		}
+
+		for (unsigned int i=0; i < pluginListNTS.Size(); i++)
+			pluginListNTS[i]->OnDirectSocketSend((const char*) bsAnswer.GetData(), bsAnswer.GetNumberOfBitsUsed(), job->systemAddress);
+		RNS2_SendParameters bsp;
+		bsp.data = (char*) bsAnswer.GetData();
+		bsp.length = bsAnswer.GetNumberOfBytesUsed();
+		bsp.systemAddress = job->systemAddress;
+		remoteSystem->rakNetSocket->Send(&bsp, _FILE_AND_LINE_);
+
+		SLNet::OP_DELETE(job,_FILE_AND_LINE_);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::StopHandshakeThreads(void)
+{
+	if (handshakeThreadPool.WasStarted()==false)
+		return;
+
+	handshakeThreadPool.StopThreads();
+	for (unsigned int i=0; i < handshakeThreadPool.InputSize(); i++)
+		SLNet::OP_DELETE(handshakeThreadPool.GetInputAtIndex(i),_FILE_AND_LINE_);
+	handshakeThreadPool.ClearInput();
+	for (unsigned int i=0; i < handshakeThreadPool.OutputSize(); i++)
+		SLNet::OP_DELETE(handshakeThreadPool.GetOutputAtIndex(i),_FILE_AND_LINE_);
+	handshakeThreadPool.ClearOutput();
+}
+#endif // LIBCAT_SECURITY
+
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::AddToSecurityExceptionList(const char *ip)
 {
@@ -1151,6 +1376,11 @@ void RakPeer::Shutdown( unsigned int blockDuration, unsigned char orderingChanne
 
 #endif // RAKPEER_USER_THREADED!=1
 
+#if LIBCAT_SECURITY==1
+	// The remote systems waiting for a key agreement are reset below
+	StopHandshakeThreads();
+#endif
+
 //	char c=0;
 //	unsigned int socketIndex;
 	// remoteSystemList in Single thread
@@ -1610,7 +1840,13 @@ void RakPeer::DeallocatePacket( Packet *packet )
 	if ( packet == 0 )
 		return;
 
-	if (packet->deleteData)
+	if (packet->isBehindData)
+	{
+		unsigned char *data = packet->data;
+		packet->~Packet();
+		rakFree_Ex(data, _FILE_AND_LINE_ );
+	}
+	else if (packet->deleteData)
 	{
 		rakFree_Ex(packet->data, _FILE_AND_LINE_ );
 		packet->~Packet();
@@ -3092,6 +3328,12 @@ RakNetStatistics * RakPeer::GetStatistics( const SystemAddress systemAddress, Ra
 	return 0;
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::GetPacketAllocationStatistics(PacketAllocationStatistics *statistics)
+{
+	statistics->packetsBehindData=packetsBehindDataCount.GetValue();
+	statistics->pooledPackets=pooledPacketCount.GetValue();
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::GetStatisticsList(DataStructures::List<SystemAddress> &addresses, DataStructures::List<RakNetGUID> &guids, DataStructures::List<RakNetStatistics> &statistics)
 {
 	addresses.Clear(false, _FILE_AND_LINE_);
@@ -3465,7 +3707,16 @@ void RakPeer::ParseConnectionRequestPacket( RakPeer::RemoteSystemStruct *remoteS
 		// Validate client proof of key
 		unsigned char proof[cat::EasyHandshake::PROOF_BYTES];
 		bs.ReadAlignedBytes(proof, sizeof(proof));
-		if (!remoteSystem->reliabilityLayer.GetAuthenticatedEncryption()->ValidateProof(proof, sizeof(proof)))
+		bool validProof;
+		if (remoteSystem->remoteCipherSuiteMask)
+		{
+			unsigned char expectedProof[cat::EasyHandshake::PROOF_BYTES];
+			validProof = GenerateCipherSuiteProof(remoteSystem->reliabilityLayer.GetAuthenticatedEncryption(), false, remoteSystem->remoteCipherSuiteMask, (unsigned char) remoteSystem->reliabilityLayer.GetCipherSuite(), expectedProof) &&
+				cat::SecureEqual(expectedProof, proof, sizeof(proof));
+		}
+		else
+			validProof = remoteSystem->reliabilityLayer.GetAuthenticatedEncryption()->ValidateProof(proof, sizeof(proof));
+		if (!validProof)
 		{
 			remoteSystem->connectMode = RemoteSystemStruct::DISCONNECT_ASAP_SILENTLY;
 			return;
@@ -3750,6 +4001,10 @@ RakPeer::RemoteSystemStruct * RakPeer::AssignSystemAddressToRemoteSystemList( co
 			remoteSystem->connectionTime = time;
 			remoteSystem->myExternalSystemAddress = UNASSIGNED_SYSTEM_ADDRESS;
 			remoteSystem->lastReliableSend=time;
+#if LIBCAT_SECURITY==1
+			remoteSystem->handshakePending=false;
+			remoteSystem->remoteCipherSuiteMask=0;
+#endif
 
 #ifdef _DEBUG
 			int indexLoopupCheck=GetIndexFromSystemAddress( systemAddress, true );
@@ -4860,11 +5115,19 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 
 					// Binding address
 					bsOut.Write(rcs->systemAddress);
+#if LIBCAT_SECURITY==1
+					bool offerCipherSuites = serverHasSecurity && rcs->client_handshake!=0;
+#endif // LIBCAT_SECURITY
 					rakPeer->requestedConnectionQueueMutex.Unlock();
 					// MTU
 					bsOut.Write(mtu);
 					// Our guid
 					bsOut.Write(rakPeer->GetGuidFromSystemAddress(UNASSIGNED_SYSTEM_ADDRESS));
+#if LIBCAT_SECURITY==1
+					// Cipher suites we accept, along with the challenge. Systems that do not negotiate cipher suites ignore this.
+					if (offerCipherSuites)
+						bsOut.Write(rakPeer->GetCipherSuiteMask());
+#endif // LIBCAT_SECURITY
 
 					for (i=0; i < rakPeer->pluginListNTS.Size(); i++)
 						rakPeer->pluginListNTS[i]->OnDirectSocketSend((const char*) bsOut.GetData(), bsOut.GetNumberOfBitsUsed(), rcs->systemAddress);
@@ -4910,6 +5173,11 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 				CAT_AUDIT_PRINTF("AUDIT: Reading cookie and public key\n");
 				bs.ReadAlignedBytes((unsigned char*) answer, sizeof(answer));
 			}
+			// Cipher suite the server chose from the ones we offered. Systems that do not negotiate cipher suites do not send it.
+			unsigned char cipherSuite=CIPHER_SUITE_CALICO;
+			bool serverChoseCipherSuite = doSecurity && bs.Read(cipherSuite);
+			if (serverChoseCipherSuite==false)
+				cipherSuite=CIPHER_SUITE_CALICO;
 			cat::ClientEasyHandshake *client_handshake=0;
 #endif // LIBCAT_SECURITY
 
@@ -5001,6 +5269,14 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 								}
 								CAT_AUDIT_PRINTF("AUDIT: Success!\n");
 
+								// Without a choice from the server, the libcat cipher is used, which must be one of ours as well
+								if (rakPeer->IsCipherSuiteAllowed(cipherSuite)==false ||
+									(cipherSuite!=CIPHER_SUITE_CALICO && remoteSystem->reliabilityLayer.SetCipherSuite((CipherSuite) cipherSuite)==false))
+								{
+									CAT_AUDIT_PRINTF("AUDIT: Server chose a cipher suite we did not offer\n");
+									return true;
+								}
+
 								SLNet::OP_DELETE(rcs->client_handshake,_FILE_AND_LINE_);
 								rcs->client_handshake=0;
 							}
@@ -5021,8 +5297,11 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 
 							if (doSecurity)
 							{
-								unsigned char proof[32];
-								remoteSystem->reliabilityLayer.GetAuthenticatedEncryption()->GenerateProof(proof, sizeof(proof));
+								unsigned char proof[cat::EasyHandshake::PROOF_BYTES];
+								if (serverChoseCipherSuite)
+									GenerateCipherSuiteProof(remoteSystem->reliabilityLayer.GetAuthenticatedEncryption(), true, rakPeer->GetCipherSuiteMask(), cipherSuite, proof);
+								else
+									remoteSystem->reliabilityLayer.GetAuthenticatedEncryption()->GenerateProof(proof, sizeof(proof));
 								temp.WriteAlignedBytes(proof, sizeof(proof));
 
 								temp.Write((unsigned char)(doIdentity ? 1 : 0));
@@ -5214,6 +5493,7 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 			bool requiresSecurityOfThisClient=false;
 #if LIBCAT_SECURITY==1
 			char remoteHandshakeChallenge[cat::EasyHandshake::CHALLENGE_BYTES];
+			unsigned char clientWroteChallenge=0;
 
 			if (rakPeer->_using_security)
 			{
@@ -5229,7 +5509,6 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 				}
 				CAT_AUDIT_PRINTF("AUDIT: Cookie good!\n");
 
-				unsigned char clientWroteChallenge;
 				bs.Read(clientWroteChallenge);
 
 				if (requiresSecurityOfThisClient==true && clientWroteChallenge==0)
@@ -5258,6 +5537,13 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 			bs.Read(mtu);
 			bs.Read(guid);
 
+#if LIBCAT_SECURITY==1
+			// Cipher suites the client accepts, sent along with the challenge by systems that negotiate cipher suites
+			unsigned char remoteCipherSuiteMask=0;
+			if (clientWroteChallenge)
+				bs.Read(remoteCipherSuiteMask);
+#endif // LIBCAT_SECURITY
+
 			RakPeer::RemoteSystemStruct *rssFromSA = rakPeer->GetRemoteSystemFromSystemAddress( systemAddress, true, true );
 			bool IPAddrInUse = rssFromSA != 0 && rssFromSA->isActive;
 			RakPeer::RemoteSystemStruct *rssFromGuid = rakPeer->GetRemoteSystemFromGUID(guid, true);
@@ -5317,8 +5603,14 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 #if LIBCAT_SECURITY==1
 				if (requiresSecurityOfThisClient)
 				{
+					// The answer is sent once the key agreement on handshakeThreadPool completes
+					if (rssFromSA->handshakePending)
+						return true;
+
 					CAT_AUDIT_PRINTF("AUDIT: Resending public key and answer from packetloss.  Sending ID_OPEN_CONNECTION_REPLY_2\n");
 					bsAnswer.WriteAlignedBytes((const unsigned char *) rssFromSA->answer,sizeof(rssFromSA->answer));
+					if (rssFromSA->remoteCipherSuiteMask)
+						bsAnswer.Write((unsigned char) rssFromSA->reliabilityLayer.GetCipherSuite());
 				}
 #endif // LIBCAT_SECURITY
 
@@ -5390,6 +5682,30 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 			}
 
 #if LIBCAT_SECURITY==1
+			// Systems that do not negotiate cipher suites, or offered none of ours, get the libcat cipher, unless we left it out
+			if (requiresSecurityOfThisClient && rakPeer->IsCipherSuiteAllowed(rakPeer->ChooseCipherSuite(remoteCipherSuiteMask))==false)
+			{
+				CAT_AUDIT_PRINTF("AUDIT: No cipher suite in common\n");
+				rakPeer->DereferenceRemoteSystem(systemAddress);
+				return true;
+			}
+
+			if (requiresSecurityOfThisClient && rakPeer->handshakeThreadPool.WasStarted())
+			{
+				// Run the key agreement on handshakeThreadPool instead of delaying the updates of all other connections.
+				// CompleteHandshakeJobs() sends the answer.
+				RakPeer::HandshakeJob *job = SLNet::OP_NEW<RakPeer::HandshakeJob>(_FILE_AND_LINE_);
+				job->rakPeer=rakPeer;
+				job->systemAddress=systemAddress;
+				job->guid=guid;
+				job->mtu=mtu;
+				job->remoteCipherSuiteMask=remoteCipherSuiteMask;
+				memcpy(job->challenge, remoteHandshakeChallenge, sizeof(job->challenge));
+				rssFromSA->handshakePending=true;
+				rakPeer->handshakeThreadPool.AddInput(RakPeer::ProcessHandshakeJob, job);
+				return true;
+			}
+
 			if (requiresSecurityOfThisClient)
 			{
 				CAT_AUDIT_PRINTF("AUDIT: Writing public key.  Sending ID_OPEN_CONNECTION_REPLY_2\n");
@@ -5408,6 +5724,14 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 				}
 
 				bsAnswer.WriteAlignedBytes((const unsigned char *) rssFromSA->answer,sizeof(rssFromSA->answer));
+
+				// Switch to the first of our cipher suites the client offered, and tell the client which one
+				if (remoteCipherSuiteMask)
+				{
+					rssFromSA->remoteCipherSuiteMask=remoteCipherSuiteMask;
+					rssFromSA->reliabilityLayer.SetCipherSuite(rakPeer->ChooseCipherSuite(remoteCipherSuiteMask));
+					bsAnswer.Write((unsigned char) rssFromSA->reliabilityLayer.GetCipherSuite());
+				}
 			}
 #endif // LIBCAT_SECURITY
 
@@ -5581,6 +5905,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 	BitSize_t bitSize;
 	unsigned int byteSize;
 	unsigned char *data;
+	void *packetMemory;
 	SystemAddress systemAddress;
 	BufferedCommandStruct *bcs;
 	bool callerDataAllocationUsed;
@@ -5622,6 +5947,10 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 			DeallocRNS2RecvStruct(recvFromStruct, _FILE_AND_LINE_);
 	}
 
+#if LIBCAT_SECURITY==1
+	CompleteHandshakeJobs();
+#endif
+
 	while ((bcs=bufferedCommands.PopInaccurate())!=0)
 	{
 		if (bcs->command==BufferedCommandStruct::BCS_SEND)
@@ -5956,7 +6285,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 
 			// Does the reliability layer have any packets waiting for us?
 			// To be thread safe, this has to be called in the same thread as HandleSocketReceiveFromConnectedPlayer
-			bitSize = remoteSystem->reliabilityLayer.Receive( &data );
+			bitSize = remoteSystem->reliabilityLayer.Receive( &data, &packetMemory );
 
 			while ( bitSize > 0 )
 			{
@@ -6062,7 +6391,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 							}
 
 							// Send this info down to the game
-							packet=AllocPacket(byteSize, data, _FILE_AND_LINE_);
+							packet=AllocPacket(byteSize, data, packetMemory, _FILE_AND_LINE_);
 							packet->bitSize = bitSize;
 							packet->systemAddress = systemAddress;
 							packet->systemAddress.systemIndex = remoteSystem->remoteSystemIndex;
@@ -6129,7 +6458,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 					{
 						if (remoteSystem->connectMode==RemoteSystemStruct::REQUESTED_CONNECTION)
 						{
-							packet=AllocPacket(byteSize, data, _FILE_AND_LINE_);
+							packet=AllocPacket(byteSize, data, packetMemory, _FILE_AND_LINE_);
 							packet->bitSize = bitSize;
 							packet->systemAddress = systemAddress;
 							packet->systemAddress.systemIndex = remoteSystem->remoteSystemIndex;
@@ -6202,7 +6531,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 								}
 
 								// Send the connection request complete to the game
-								packet=AllocPacket(byteSize, data, _FILE_AND_LINE_);
+								packet=AllocPacket(byteSize, data, packetMemory, _FILE_AND_LINE_);
 								packet->bitSize = byteSize * 8;
 								packet->systemAddress = systemAddress;
 								packet->systemAddress.systemIndex = ( SystemIndex ) GetIndexFromSystemAddress( systemAddress, true );
@@ -6247,7 +6576,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 							remoteSystem->isActive
 							)
 						{
-							packet=AllocPacket(byteSize, data, _FILE_AND_LINE_);
+							packet=AllocPacket(byteSize, data, packetMemory, _FILE_AND_LINE_);
 							packet->bitSize = bitSize;
 							packet->systemAddress = systemAddress;
 							packet->systemAddress.systemIndex = remoteSystem->remoteSystemIndex;
@@ -6264,7 +6593,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 
 				// Does the reliability layer have any more packets waiting for us?
 				// To be thread safe, this has to be called in the same thread as HandleSocketReceiveFromConnectedPlayer
-				bitSize = remoteSystem->reliabilityLayer.Receive( &data );
+				bitSize = remoteSystem->reliabilityLayer.Receive( &data, &packetMemory );
 			}
 		
 	}
@@ -36,6 +36,7 @@ using namespace SLNet;
 
 #else
 #include <pthread.h>
+#include <unistd.h>
 #endif
 
 #if defined(_WIN32_WCE) || defined(WINDOWS_PHONE_8) || defined(WINDOWS_STORE_RT)
@@ -137,6 +138,34 @@ int RakThread::Create( void* start_address( void* ), void *arglist, int priority
 	return res;
 #endif
 }
+bool RakThread::SetAffinity(int processor)
+{
+#if defined(_WIN32_WCE) || defined(WINDOWS_PHONE_8) || defined(WINDOWS_STORE_RT)
+	(void) processor;
+	return false;
+#elif defined(_WIN32)
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << (processor % (int) (sizeof(DWORD_PTR)*8)))!=0;
+#elif defined(__linux__) && !defined(ANDROID)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(processor % CPU_SETSIZE, &cpuSet);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet)==0;
+#else
+	(void) processor;
+	return false;
+#endif
+}
+int RakThread::GetNumberOfProcessors(void)
+{
+#if defined(_WIN32)
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwNumberOfProcessors > 0 ? (int) systemInfo.dwNumberOfProcessors : 1;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int) count : 1;
+#endif
+}
 
 
 
@@ -414,6 +414,7 @@ void ReliabilityLayer::Reset(bool resetVariables, int mtuSize, bool _useSecurity
 
 #if LIBCAT_SECURITY == 1
 		useSecurity = _useSecurity;
+		aead_enc.Clear();
 
 		if (_useSecurity) {
 			mtuSize -= cat::AuthenticatedEncryption::OVERHEAD_BYTES;
@@ -425,6 +426,22 @@ void ReliabilityLayer::Reset(bool resetVariables, int mtuSize, bool _useSecurity
 	}
 }
 
+#if LIBCAT_SECURITY==1
+//-------------------------------------------------------------------------------------------------------
+// Switches to another cipher once the handshake set the session key
+//-------------------------------------------------------------------------------------------------------
+bool ReliabilityLayer::SetCipherSuite(CipherSuite cipherSuite)
+{
+	if (cipherSuite == CIPHER_SUITE_CALICO) {
+		aead_enc.Clear();
+		return true;
+	}
+
+	// The overhead is the same, so the MTU does not change
+	return aead_enc.SetKey(cipherSuite, &auth_enc);
+}
+#endif // LIBCAT_SECURITY
+
 //-------------------------------------------------------------------------------------------------------
 // Set the time, in MS, to use before considering ourselves disconnected after not being able to deliver a reliable packet
 //-------------------------------------------------------------------------------------------------------
@@ -728,7 +745,12 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 	if (useSecurity) {
 		unsigned int received = length;
 
-		if (!auth_enc.Decrypt((cat::u8*)buffer, received)) {
+		if (aead_enc.GetCipherSuite() != CIPHER_SUITE_CALICO) {
+			if (!aead_enc.Decrypt((unsigned char*)buffer, received)) {
+				return false;
+			}
+		}
+		else if (!auth_enc.Decrypt((cat::u8*)buffer, received)) {
 			return false;
 		}
 
@@ -1555,7 +1577,7 @@ CONTINUE_SOCKET_DATA_PARSE_LOOP:
 //-------------------------------------------------------------------------------------------------------
 // This gets an end-user packet already parsed out. Returns number of BITS put into the buffer
 //-------------------------------------------------------------------------------------------------------
-BitSize_t ReliabilityLayer::Receive( unsigned char **data )
+BitSize_t ReliabilityLayer::Receive( unsigned char **data, void **packetMemory )
 {
 	InternalPacket * internalPacket;
 
@@ -1569,6 +1591,13 @@ BitSize_t ReliabilityLayer::Receive( unsigned char **data )
 		BitSize_t bitLength;
 		*data = internalPacket->data;
 		bitLength = internalPacket->dataBitLength;
+		if (packetMemory)
+		{
+			if (internalPacket->allocationScheme==InternalPacket::NORMAL_WITH_PACKET)
+				*packetMemory = internalPacket->data + GetPacketOffsetBehindData(BITS_TO_BYTES(bitLength));
+			else
+				*packetMemory = 0;
+		}
 		ReleaseToInternalPacketPool( internalPacket );
 		return bitLength;
 	}
@@ -2375,7 +2404,10 @@ void ReliabilityLayer::SendBitStream( RakNetSocket2 *s, SystemAddress &systemAdd
 
 		// Verify there is enough room for encrypted output and encrypt
 		// Encrypt() will increase length
-		SLNET_VERIFY(auth_enc.Encrypt(buffer, buffer_size, length));
+		if (aead_enc.GetCipherSuite() != CIPHER_SUITE_CALICO)
+			SLNET_VERIFY(aead_enc.Encrypt(buffer, buffer_size, length));
+		else
+			SLNET_VERIFY(auth_enc.Encrypt(buffer, buffer_size, length));
 	}
 #endif
 
@@ -2844,8 +2876,14 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream(SLNet::BitSt
 		return 0;
 	}
 
-	// Allocate memory to hold our data
-	AllocInternalPacketData(internalPacket, BITS_TO_BYTES( internalPacket->dataBitLength ), false, _FILE_AND_LINE_ );
+	// Allocate memory to hold our data. Messages which are not split are returned as they are, so leave room for the Packet RakPeer returns them in
+	if (internalPacket->splitPacketCount==0)
+	{
+		internalPacket->allocationScheme=InternalPacket::NORMAL_WITH_PACKET;
+		internalPacket->data=(unsigned char*) rakMalloc_Ex(GetPacketOffsetBehindData(BITS_TO_BYTES( internalPacket->dataBitLength ))+sizeof(Packet), _FILE_AND_LINE_ );
+	}
+	else
+		AllocInternalPacketData(internalPacket, BITS_TO_BYTES( internalPacket->dataBitLength ), false, _FILE_AND_LINE_ );
 	RakAssert(BITS_TO_BYTES( internalPacket->dataBitLength )<MAXIMUM_MTU_SIZE);
 
 	if (internalPacket->data == 0)
@@ -3280,8 +3318,8 @@ InternalPacket * ReliabilityLayer::BuildPacketFromSplitPacketList( SplitPacketCh
 		internalPacket->dataBitLength+=splitPacketChannel->splitPacketList[j]->dataBitLength;
 	// splitPacketPartLength=BITS_TO_BYTES(splitPacketChannel->firstPacket->dataBitLength);
 
-	internalPacket->data = (unsigned char*) rakMalloc_Ex( (size_t) BITS_TO_BYTES( internalPacket->dataBitLength ), _FILE_AND_LINE_ );
-	internalPacket->allocationScheme=InternalPacket::NORMAL;
+	internalPacket->data = (unsigned char*) rakMalloc_Ex( GetPacketOffsetBehindData((size_t) BITS_TO_BYTES( internalPacket->dataBitLength ))+sizeof(Packet), _FILE_AND_LINE_ );
+	internalPacket->allocationScheme=InternalPacket::NORMAL_WITH_PACKET;
 
     BitSize_t offset = 0;
 	for (j=0; j < splitPacketChannel->splitPacketList.GetAllocSize(); j++)
@@ -3971,7 +4009,7 @@ void ReliabilityLayer::FreeInternalPacketData(InternalPacket *internalPacket, co
 			internalPacket->refCountedData=0;
 		}
 	}
-	else if (internalPacket->allocationScheme==InternalPacket::NORMAL)
+	else if (internalPacket->allocationScheme==InternalPacket::NORMAL || internalPacket->allocationScheme==InternalPacket::NORMAL_WITH_PACKET)
 	{
 		if (internalPacket->data==0)
 			return;
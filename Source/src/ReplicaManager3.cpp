@@ -91,6 +91,8 @@ ReplicaManager3::ReplicaManager3()
 	autoCreateConnections=true;
 	autoDestroyConnections=true;
 	currentlyDeallocatingReplica=0;
+	serializationScratch=0;
+	serializationJobsDone=0;
 
 	for (unsigned int i=0; i < 255; i++)
 		worldsArray[i]=0;
@@ -102,6 +104,7 @@ ReplicaManager3::ReplicaManager3()
 
 ReplicaManager3::~ReplicaManager3()
 {
+	StopSerializationThreads();
 	if (autoDestroyConnections)
 	{
 		m_WorldListMutex.Lock();
@@ -885,11 +888,12 @@ void Connection_RM3::AutoConstructByQuery(ReplicaManager3 *replicaManager3, Worl
 }
 void ReplicaManager3::Update(void)
 {
-	unsigned int index,index2,index3;
+	unsigned int index,index3;
 
 	WorldId worldId;
 	RM3World *world;
 	SLNet::Time time = SLNet::GetTime();
+	bool isParallel = serializationThreadPool.WasStarted();
 
 	m_WorldListMutex.Lock();
 	for (index3=0; index3 < worldsList.Size(); index3++)
@@ -897,6 +901,7 @@ void ReplicaManager3::Update(void)
 		world = worldsList[index3];
 		worldId = world->worldId;
 
+		// Always on the calling thread. The construction callbacks and SendConstruction() modify replicas shared by all connections
 		for (index=0; index < world->connectionList.Size(); index++)
 		{
 			if (world->connectionList[index]->isValidated==false)
@@ -918,82 +923,258 @@ void ReplicaManager3::Update(void)
 				world->userReplicaList[index]->OnUserReplicaPreSerializeTick();
 			}
 
+			if (isParallel)
+			{
+				for (index=0; index < world->connectionList.Size(); index++)
+					AddSerializationJob(world->connectionList[index], worldId, time);
+				continue;
+			}
+
 			SerializeParameters sp;
 			sp.curTime=time;
-			Connection_RM3 *connection;
-			SendSerializeIfChangedResult ssicr;
-			LastSerializationResult *lsr;
-
 			sp.messageTimestamp=0;
 			for (int i=0; i < RM3_NUM_OUTPUT_BITSTREAM_CHANNELS; i++)
 				sp.pro[i]=defaultSendParameters;
-			index2=0;
 			for (index=0; index < world->connectionList.Size(); index++)
-			{
-				connection = world->connectionList[index];
-				sp.bitsWrittenSoFar=0;
-				index2=0;
-				sp.destinationConnection=connection;
+				SerializeConnection(world->connectionList[index], &sp, worldId, time, false);
+		}
+		if (isParallel)
+			RunSerializationJobs();
 
-				DataStructures::List<Replica3*> replicasToSerialize;
-				replicasToSerialize.Clear(true, _FILE_AND_LINE_);
-				if (connection->QuerySerializationList(replicasToSerialize))
-				{
-					// Update replica->lsr so we can lookup in the next block
-					// lsr is per connection / per replica
-					while (index2 < connection->queryToSerializeReplicaList.Size())
-					{
-						connection->queryToSerializeReplicaList[index2]->replica->lsr=connection->queryToSerializeReplicaList[index2];
-						index2++;
-					}
+		lastAutoSerializeOccurance=time;
+	}
 
+	if (isParallel)
+	{
+		for (index3=0; index3 < worldsList.Size(); index3++)
+		{
+			world = worldsList[index3];
+			for (index=0; index < world->connectionList.Size(); index++)
+				world->connectionList[index]->SendDeferred(rakPeerInterface);
+		}
+	}
+	m_WorldListMutex.Unlock();
+}
 
-					// User is manually specifying list of replicas to serialize
-					index2=0;
-					while (index2 < replicasToSerialize.Size())
-					{
-						lsr=replicasToSerialize[index2]->lsr;
-						RakAssert(lsr->replica==replicasToSerialize[index2]);
-
-						sp.whenLastSerialized=lsr->whenLastSerialized;
-						ssicr=connection->SendSerializeIfChanged(lsr, &sp, GetRakPeerInterface(), worldId, this, time);
-						if (ssicr==SSICR_SENT_DATA)
-							lsr->whenLastSerialized=time;
-						index2++;
-					}
-				}
-				else
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void ReplicaManager3::SerializeConnection(Connection_RM3 *connection, SerializeParameters *sp, WorldId worldId, SLNet::Time time, bool isParallel)
+{
+	unsigned int index2;
+	SendSerializeIfChangedResult ssicr;
+	LastSerializationResult *lsr;
+	SimpleMutex *replicaMutex;
+
+	sp->bitsWrittenSoFar=0;
+	index2=0;
+	sp->destinationConnection=connection;
+
+	DataStructures::List<Replica3*> replicasToSerialize;
+	replicasToSerialize.Clear(true, _FILE_AND_LINE_);
+	if (connection->QuerySerializationList(replicasToSerialize))
+	{
+		// Update replica->lsr so we can lookup in the next block
+		// lsr is per connection / per replica
+		// Replica3::lsr is shared among connections, so when running in parallel look up in constructedReplicaList instead
+		if (isParallel==false)
+		{
+			while (index2 < connection->queryToSerializeReplicaList.Size())
+			{
+				connection->queryToSerializeReplicaList[index2]->replica->lsr=connection->queryToSerializeReplicaList[index2];
+				index2++;
+			}
+		}
+
+		// User is manually specifying list of replicas to serialize
+		index2=0;
+		while (index2 < replicasToSerialize.Size())
+		{
+			if (isParallel)
+			{
+				bool objectExists;
+				unsigned int constructedIndex = connection->constructedReplicaList.GetIndexFromKey(replicasToSerialize[index2], &objectExists);
+				if (objectExists==false)
 				{
-					while (index2 < connection->queryToSerializeReplicaList.Size())
-					{
-						lsr=connection->queryToSerializeReplicaList[index2];
-
-						sp.destinationConnection=connection;
-						sp.whenLastSerialized=lsr->whenLastSerialized;
-						ssicr=connection->SendSerializeIfChanged(lsr, &sp, GetRakPeerInterface(), worldId, this, time);
-						if (ssicr==SSICR_SENT_DATA)
-						{
-							lsr->whenLastSerialized=time;
-							index2++;
-						}
-						else if (ssicr==SSICR_NEVER_SERIALIZE)
-						{
-							// Removed from the middle of the list
-						}
-						else
-							index2++;
-					}
+					index2++;
+					continue;
 				}
+				lsr=connection->constructedReplicaList[constructedIndex];
+				replicaMutex=&lsr->replica->serializationMutex;
+				replicaMutex->Lock();
+			}
+			else
+			{
+				lsr=replicasToSerialize[index2]->lsr;
+				replicaMutex=0;
 			}
+			RakAssert(lsr->replica==replicasToSerialize[index2]);
+
+			sp->whenLastSerialized=lsr->whenLastSerialized;
+			ssicr=connection->SendSerializeIfChanged(lsr, sp, GetRakPeerInterface(), worldId, this, time);
+			if (replicaMutex)
+				replicaMutex->Unlock();
+			if (ssicr==SSICR_SENT_DATA)
+				lsr->whenLastSerialized=time;
+			index2++;
 		}
+	}
+	else
+	{
+		while (index2 < connection->queryToSerializeReplicaList.Size())
+		{
+			lsr=connection->queryToSerializeReplicaList[index2];
 
-		lastAutoSerializeOccurance=time;
+			if (isParallel)
+			{
+				replicaMutex=&lsr->replica->serializationMutex;
+				replicaMutex->Lock();
+			}
+			else
+				replicaMutex=0;
+
+			sp->destinationConnection=connection;
+			sp->whenLastSerialized=lsr->whenLastSerialized;
+			ssicr=connection->SendSerializeIfChanged(lsr, sp, GetRakPeerInterface(), worldId, this, time);
+			if (replicaMutex)
+				replicaMutex->Unlock();
+			if (ssicr==SSICR_SENT_DATA)
+			{
+				lsr->whenLastSerialized=time;
+				index2++;
+			}
+			else if (ssicr==SSICR_NEVER_SERIALIZE)
+			{
+				// Removed from the middle of the list
+			}
+			else
+				index2++;
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+static void* AllocSerializationScratch(void)
+{
+	return SLNet::OP_NEW<SerializeParameters>(_FILE_AND_LINE_);
+}
+static void FreeSerializationScratch(void *scratch)
+{
+	SLNet::OP_DELETE((SerializeParameters*) scratch, _FILE_AND_LINE_);
+}
+namespace SLNet
+{
+ReplicaManager3::SerializationJob* SerializationJobCB(ReplicaManager3::SerializationJob *job, bool *returnOutput, void* perThreadData)
+{
+	// Per-thread scratch, so the output bitstreams keep their allocations from one job to the next
+	SerializeParameters *sp = (SerializeParameters *) perThreadData;
+	sp->curTime=job->time;
+	sp->messageTimestamp=0;
+	for (int i=0; i < RM3_NUM_OUTPUT_BITSTREAM_CHANNELS; i++)
+		sp->pro[i]=job->replicaManager3->defaultSendParameters;
+	job->replicaManager3->SerializeConnection(job->connection, sp, job->worldId, job->time, true);
+
+	ReplicaManager3 *replicaManager3 = job->replicaManager3;
+	replicaManager3->serializationJobsDoneMutex.Lock();
+	replicaManager3->serializationJobsDone++;
+	replicaManager3->serializationJobsDoneEvent.SetEvent();
+	replicaManager3->serializationJobsDoneMutex.Unlock();
+
+	*returnOutput=false;
+	return job;
+}
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void ReplicaManager3::StartSerializationThreads(int numThreads)
+{
+	if (serializationThreadPool.WasStarted())
+		return;
+
+	serializationScratch=SLNet::OP_NEW<SerializeParameters>(_FILE_AND_LINE_);
+	serializationJobsDoneEvent.InitEvent();
+	serializationThreadPool.StartThreads(numThreads, 0, AllocSerializationScratch, FreeSerializationScratch);
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void ReplicaManager3::StopSerializationThreads(void)
+{
+	// Update() holds m_WorldListMutex while jobs are outstanding
+	m_WorldListMutex.Lock();
+	serializationThreadPool.StopThreads();
+	serializationThreadPool.ClearInput();
+	serializationThreadPool.ClearOutput();
+	if (serializationScratch)
+	{
+		SLNet::OP_DELETE(serializationScratch, _FILE_AND_LINE_);
+		serializationScratch=0;
+		serializationJobsDoneEvent.CloseEvent();
 	}
 	m_WorldListMutex.Unlock();
 }
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
+void ReplicaManager3::AddSerializationJob(Connection_RM3 *connection, WorldId worldId, SLNet::Time time)
+{
+	SerializationJob job;
+	job.replicaManager3=this;
+	job.connection=connection;
+	job.worldId=worldId;
+	job.time=time;
+	serializationJobs.Push(job, _FILE_AND_LINE_);
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void ReplicaManager3::RunSerializationJobs(void)
+{
+	unsigned int index;
+
+	// Pointers into serializationJobs are handed out, so it must not be modified until all jobs are done
+	serializationJobsDone=0;
+	for (index=0; index < serializationJobs.Size(); index++)
+	{
+		serializationJobs[index].connection->deferSends=true;
+		serializationThreadPool.AddInput(SerializationJobCB, &serializationJobs[index]);
+	}
+
+	// Work on the calling thread as well, rather than idling until the workers are done
+	SerializationJob *job;
+	bool returnOutput;
+	for (;;)
+	{
+		job=0;
+		serializationThreadPool.LockInput();
+		if (serializationThreadPool.InputSize()>0)
+		{
+			job=serializationThreadPool.GetInputAtIndex(0);
+			serializationThreadPool.RemoveInputAtIndex(0);
+		}
+		serializationThreadPool.UnlockInput();
+
+		if (job)
+		{
+			SerializationJobCB(job, &returnOutput, serializationScratch);
+			continue;
+		}
+
+		// Only jobs already taken by worker threads are left
+		serializationJobsDoneMutex.Lock();
+		bool allDone = serializationJobsDone==serializationJobs.Size();
+		serializationJobsDoneMutex.Unlock();
+		if (allDone)
+			break;
+		serializationJobsDoneEvent.WaitOnEvent(1000);
+	}
+
+	serializationJobs.Clear(true, _FILE_AND_LINE_);
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
 void ReplicaManager3::OnClosedConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID, PI2_LostConnectionReason lostConnectionReason )
 {
 	(void) lostConnectionReason;
@@ -1475,6 +1656,7 @@ Connection_RM3::Connection_RM3(const SystemAddress &_systemAddress, RakNetGUID _
 	isFirstConstruction=true;
 	groupConstructionAndSerialize=false;
 	gotDownloadComplete=false;
+	deferSends=false;
 }
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1575,7 +1757,7 @@ SendSerializeIfChangedResult Connection_RM3::SendSerialize(SLNet::Replica3 *repl
 
 			// Send remainder
 			replica->OnSerializeTransmission(&out, this, bitsPerChannel, curTime);
-			rakPeer->Send(&out,lastPro.priority,lastPro.reliability,lastPro.orderingChannel,systemAddress,false,lastPro.sendReceipt);
+			SendOrDefer(&out,lastPro.priority,lastPro.reliability,lastPro.orderingChannel,lastPro.sendReceipt,rakPeer);
 
 			// If no data left to send, quit out
 			bool anyData=false;
@@ -1619,7 +1801,7 @@ SendSerializeIfChangedResult Connection_RM3::SendSerialize(SLNet::Replica3 *repl
 		}
 	}
 	replica->OnSerializeTransmission(&out, this, bitsPerChannel, curTime);
-	rakPeer->Send(&out,lastPro.priority,lastPro.reliability,lastPro.orderingChannel,systemAddress,false,lastPro.sendReceipt);
+	SendOrDefer(&out,lastPro.priority,lastPro.reliability,lastPro.orderingChannel,lastPro.sendReceipt,rakPeer);
 	return SSICR_SENT_DATA;
 }
 
@@ -2217,7 +2399,7 @@ void Connection_RM3::SendConstruction(DataStructures::List<Replica3*> &newObject
 		bsOut.Write((MessageID)ID_REPLICA_MANAGER_DOWNLOAD_STARTED);
 		bsOut.Write(worldId);
 		SerializeOnDownloadStarted(&bsOut);
-		rakPeer->Send(&bsOut,sendParameters.priority,RELIABLE_ORDERED,sendParameters.orderingChannel,systemAddress,false,sendParameters.sendReceipt);
+		SendOrDefer(&bsOut,sendParameters.priority,RELIABLE_ORDERED,sendParameters.orderingChannel,sendParameters.sendReceipt,rakPeer);
 	}
 
 	//	LastSerializationResult* lsr;
@@ -2320,7 +2502,7 @@ void Connection_RM3::SendConstruction(DataStructures::List<Replica3*> &newObject
 		bsOut.Write(offsetEnd);
 		bsOut.SetWriteOffset(offsetEnd);
 	}
-	rakPeer->Send(&bsOut,sendParameters.priority,RELIABLE_ORDERED,sendParameters.orderingChannel,systemAddress,false,sendParameters.sendReceipt);
+	SendOrDefer(&bsOut,sendParameters.priority,RELIABLE_ORDERED,sendParameters.orderingChannel,sendParameters.sendReceipt,rakPeer);
 
 	// TODO - shouldn't this be part of construction?
 
@@ -2374,7 +2556,7 @@ void Connection_RM3::SendConstruction(DataStructures::List<Replica3*> &newObject
 		bsOut.Write((MessageID)ID_REPLICA_MANAGER_DOWNLOAD_COMPLETE);
 		bsOut.Write(worldId);
 		SerializeOnDownloadComplete(&bsOut);
-		rakPeer->Send(&bsOut,sendParameters.priority,RELIABLE_ORDERED,sendParameters.orderingChannel,systemAddress,false,sendParameters.sendReceipt);
+		SendOrDefer(&bsOut,sendParameters.priority,RELIABLE_ORDERED,sendParameters.orderingChannel,sendParameters.sendReceipt,rakPeer);
 	}
 
 	isFirstConstruction=false;
@@ -2383,6 +2565,41 @@ void Connection_RM3::SendConstruction(DataStructures::List<Replica3*> &newObject
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
+void Connection_RM3::SendOrDefer(SLNet::BitStream *bs, PacketPriority priority, PacketReliability reliability, char orderingChannel, uint32_t sendReceipt, SLNet::RakPeerInterface *rakPeer)
+{
+	if (deferSends==false)
+	{
+		rakPeer->Send(bs,priority,reliability,orderingChannel,systemAddress,false,sendReceipt);
+		return;
+	}
+
+	DeferredSend deferredSend;
+	deferredSend.offset=deferredSendData.GetNumberOfBytesUsed();
+	deferredSend.length=bs->GetNumberOfBytesUsed();
+	deferredSend.pro.priority=priority;
+	deferredSend.pro.reliability=reliability;
+	deferredSend.pro.orderingChannel=orderingChannel;
+	deferredSend.pro.sendReceipt=sendReceipt;
+	deferredSendData.WriteAlignedBytes(bs->GetData(), deferredSend.length);
+	deferredSends.Push(deferredSend,_FILE_AND_LINE_);
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void Connection_RM3::SendDeferred(SLNet::RakPeerInterface *rakPeer)
+{
+	deferSends=false;
+	for (unsigned int i=0; i < deferredSends.Size(); i++)
+	{
+		const DeferredSend &deferredSend = deferredSends[i];
+		rakPeer->Send((const char*) deferredSendData.GetData()+deferredSend.offset,deferredSend.length,deferredSend.pro.priority,deferredSend.pro.reliability,deferredSend.pro.orderingChannel,systemAddress,false,deferredSend.pro.sendReceipt);
+	}
+	deferredSends.Clear(true,_FILE_AND_LINE_);
+	deferredSendData.Reset();
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
 void Connection_RM3::SendValidation(SLNet::RakPeerInterface *rakPeer, WorldId worldId)
 {
 	// Hijack to mean sendValidation
@@ -115,15 +115,29 @@ void SignaledEvent::SetEvent(void)
 #else
 	// Different from SetEvent which stays signaled.
 	// We have to record manually that the event was signaled
+	// Hold hMutex, so the signal cannot fall between the check of isSignaled in WaitOnEvent and pthread_cond_timedwait
+	pthread_mutex_lock(&hMutex);
 	isSignaledMutex.Lock();
 	isSignaled=true;
 	isSignaledMutex.Unlock();
 
 	// Unblock waiting threads
 	pthread_cond_broadcast(&eventList);
+	pthread_mutex_unlock(&hMutex);
 #endif
 }
 
+#ifndef _WIN32
+bool SignaledEvent::IsSignaledLocked(void)
+{
+	bool signaled;
+	isSignaledMutex.Lock();
+	signaled=isSignaled;
+	isSignaledMutex.Unlock();
+	return signaled;
+}
+#endif
+
 void SignaledEvent::WaitOnEvent(int timeoutMs)
 {
 #ifdef _WIN32
@@ -234,7 +248,8 @@ void SignaledEvent::WaitOnEvent(int timeoutMs)
             // the docs you are suppost to hold the lock before you wait
             // on the cond.
             pthread_mutex_lock(&hMutex);
-			pthread_cond_timedwait(&eventList, &hMutex, &ts);
+			if (IsSignaledLocked()==false)
+				pthread_cond_timedwait(&eventList, &hMutex, &ts);
             pthread_mutex_unlock(&hMutex);
 
 			timeoutMs-=30;
@@ -258,7 +273,8 @@ void SignaledEvent::WaitOnEvent(int timeoutMs)
 		}
 
 		pthread_mutex_lock(&hMutex);
-		pthread_cond_timedwait(&eventList, &hMutex, &ts);
+		if (IsSignaledLocked()==false)
+			pthread_cond_timedwait(&eventList, &hMutex, &ts);
         pthread_mutex_unlock(&hMutex);
 
 		isSignaledMutex.Lock();
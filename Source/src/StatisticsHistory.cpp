@@ -20,6 +20,7 @@
 #include "slikenet/GetTime.h"
 #include "slikenet/statistics.h"
 #include "slikenet/peerinterface.h"
+#include <math.h>
 
 using namespace SLNet;
 
@@ -67,13 +68,68 @@ StatisticsHistory::TrackedObjectData::TrackedObjectData(uint64_t _objectId, int
 	objectType=_objectType;
 	userData=_userData;
 }
-StatisticsHistory::StatisticsHistory() {timeToTrack = 30000;}
+StatisticsHistory::TimeBucket::TimeBucket()
+{
+	time=0;
+	sum=0;
+	sumOfSquares=0;
+	count=0;
+	lowest=SH_TYPE_MAX;
+	highest=-SH_TYPE_MAX;
+}
+SHValueType StatisticsHistory::TimeBucket::GetAverage(void) const
+{
+	if (count == 0)
+		return 0;
+	return sum / count;
+}
+SHValueType StatisticsHistory::TimeBucket::GetStandardDeviation(void) const
+{
+	if (count == 0)
+		return 0;
+	SHValueType mean = sum / count;
+	SHValueType variance = sumOfSquares / count - mean * mean;
+	if (variance <= 0)
+		return 0;
+	return sqrt(variance);
+}
+StatisticsHistory::StatisticsHistory() {timeToTrack = 30000; bucketInterval = 1000;}
 StatisticsHistory::~StatisticsHistory()
 {
 	Clear();
 }
-void StatisticsHistory::SetDefaultTimeToTrack(Time defaultTimeToTrack) {timeToTrack = defaultTimeToTrack;}
+void StatisticsHistory::SetDefaultTimeToTrack(Time defaultTimeToTrack)
+{
+	timeToTrack = defaultTimeToTrack;
+	// The number of buckets depends on the time to track
+	ClearBuckets();
+}
 Time StatisticsHistory::GetDefaultTimeToTrack(void) const {return timeToTrack;}
+void StatisticsHistory::SetBucketInterval(Time interval)
+{
+	bucketInterval = interval;
+	ClearBuckets();
+}
+Time StatisticsHistory::GetBucketInterval(void) const {return bucketInterval;}
+unsigned int StatisticsHistory::GetKeyId(RakString key)
+{
+	unsigned int keyId = FindKeyId(key);
+	if (keyId != (unsigned int) -1)
+		return keyId;
+	keyId = keyNames.Size();
+	keyIds.Push(key, keyId, _FILE_AND_LINE_);
+	keyNames.Push(key, _FILE_AND_LINE_);
+	keyBuckets.Push(0, _FILE_AND_LINE_);
+	return keyId;
+}
+const RakString& StatisticsHistory::GetKeyName(unsigned int keyId) const {return keyNames[keyId];}
+unsigned int StatisticsHistory::FindKeyId(const RakString &key) const
+{
+	DataStructures::HashIndex hi = keyIds.GetIndexOf(key);
+	if (hi.IsInvalid())
+		return (unsigned int) -1;
+	return keyIds.ItemAtIndex(hi);
+}
 bool StatisticsHistory::AddObject(TrackedObjectData tod)
 {
 	bool objectExists;
@@ -108,6 +164,16 @@ void StatisticsHistory::Clear(void)
 		SLNet::OP_DELETE(objects[idx], _FILE_AND_LINE_);
 	}
 	objects.Clear(false, _FILE_AND_LINE_);
+	ClearBuckets();
+}
+void StatisticsHistory::ClearBuckets(void)
+{
+	// Keys stay known, so IDs returned by GetKeyId() remain valid
+	for (unsigned int keyId=0; keyId < keyBuckets.Size(); keyId++)
+	{
+		SLNet::OP_DELETE(keyBuckets[keyId], _FILE_AND_LINE_);
+		keyBuckets[keyId]=0;
+	}
 }
 unsigned int StatisticsHistory::GetObjectCount(void) const {return objects.Size();}
 StatisticsHistory::TrackedObjectData * StatisticsHistory::GetObjectAtIndex(unsigned int index) const {return &objects[index]->trackedObjectData;}
@@ -119,32 +185,40 @@ bool StatisticsHistory::AddValueByObjectID(uint64_t objectId, RakString key, SHV
 	AddValueByIndex(idx, key, val, curTime, combineEqualTimes);
 	return true;
 }
+bool StatisticsHistory::AddValueByObjectID(uint64_t objectId, unsigned int keyId, SHValueType val, Time curTime, bool combineEqualTimes)
+{
+	unsigned int idx = GetObjectIndex(objectId);
+	if (idx == (unsigned int) -1)
+		return false;
+	AddValueByIndex(idx, keyId, val, curTime, combineEqualTimes);
+	return true;
+}
 void StatisticsHistory::AddValueByIndex(unsigned int index, RakString key, SHValueType val, Time curTime, bool combineEqualTimes)
 {
-	TimeAndValueQueue *queue;
+	AddValueByIndex(index, GetKeyId(key), val, curTime, combineEqualTimes);
+}
+void StatisticsHistory::AddValueByIndex(unsigned int index, unsigned int keyId, SHValueType val, Time curTime, bool combineEqualTimes)
+{
 	TrackedObject *to = objects[index];
-	DataStructures::HashIndex hi = to->dataQueues.GetIndexOf(key);
-	if (hi.IsInvalid())
+	while (to->dataQueues.Size() <= keyId)
+		to->dataQueues.Push(0, _FILE_AND_LINE_);
+	TimeAndValueQueue *queue = to->dataQueues[keyId];
+	if (queue == 0)
 	{
 		queue = SLNet::OP_NEW<TimeAndValueQueue>(_FILE_AND_LINE_);
-		queue->key=key;
+		queue->key=keyNames[keyId];
 		queue->timeToTrackValues = timeToTrack;
-		to->dataQueues.Push(key, queue, _FILE_AND_LINE_);
-	}
-	else
-	{
-		queue = to->dataQueues.ItemAtIndex(hi);
+		to->dataQueues[keyId]=queue;
 	}
 
 	TimeAndValue tav;
+	SHValueType replacedVal=0;
+	bool replaced=false;
 	if (combineEqualTimes==true && queue->values.Size()>0 && queue->values.PeekTail().time==curTime)
 	{
-		tav = queue->values.PopTail();
-
-		queue->recentSum -= tav.val;
-		queue->recentSumOfSquares -= tav.val * tav.val;
-		queue->longTermSum -= tav.val;
-		queue->longTermCount = queue->longTermCount - 1;
+		tav = queue->PopTailValue();
+		replacedVal=tav.val;
+		replaced=true;
 	}
 	else
 	{
@@ -153,16 +227,50 @@ void StatisticsHistory::AddValueByIndex(unsigned int index, RakString key, SHVal
 	}
 
 	tav.val+=val;
-	queue->values.Push(tav, _FILE_AND_LINE_);
+	queue->PushValue(tav);
+	// Otherwise values are only removed when read
+	queue->CullExpiredValues(curTime);
+
+	if (bucketInterval!=0)
+		AddToBuckets(keyId, curTime, tav.val, replacedVal, replaced);
+}
+void StatisticsHistory::AddToBuckets(unsigned int keyId, Time curTime, SHValueType val, SHValueType replacedVal, bool replaced)
+{
+	KeyBuckets *kb = keyBuckets[keyId];
+	if (kb == 0)
+	{
+		kb = SLNet::OP_NEW<KeyBuckets>(_FILE_AND_LINE_);
+		unsigned int numBuckets = (unsigned int) (timeToTrack / bucketInterval) + 1;
+		for (unsigned int i=0; i < numBuckets; i++)
+			kb->buckets.Push(TimeBucket(), _FILE_AND_LINE_);
+		keyBuckets[keyId]=kb;
+	}
 
-	queue->recentSum += tav.val;
-	queue->recentSumOfSquares += tav.val * tav.val;
-	queue->longTermSum += tav.val;
-	queue->longTermCount = queue->longTermCount + 1;
-	if (queue->longTermLowest > tav.val)
-		queue->longTermLowest = tav.val;
-	if (queue->longTermHighest < tav.val)
-		queue->longTermHighest = tav.val;
+	Time bucketTime = curTime - curTime % bucketInterval;
+	TimeBucket &bucket = kb->buckets[(unsigned int) ((curTime / bucketInterval) % kb->buckets.Size())];
+	if (bucket.count == 0 || bucket.time != bucketTime)
+	{
+		// Reuse the bucket that went out of the time to track
+		bucket = TimeBucket();
+		bucket.time = bucketTime;
+		replaced = false;
+	}
+
+	if (replaced)
+	{
+		bucket.sum -= replacedVal;
+		bucket.sumOfSquares -= replacedVal * replacedVal;
+	}
+	else
+	{
+		bucket.count = bucket.count + 1;
+	}
+	bucket.sum += val;
+	bucket.sumOfSquares += val * val;
+	if (bucket.lowest > val)
+		bucket.lowest = val;
+	if (bucket.highest < val)
+		bucket.highest = val;
 }
 StatisticsHistory::SHErrorCode StatisticsHistory::GetHistoryForKey(uint64_t objectId, RakString key, StatisticsHistory::TimeAndValueQueue **values, Time curTime) const
 {
@@ -173,10 +281,10 @@ StatisticsHistory::SHErrorCode StatisticsHistory::GetHistoryForKey(uint64_t obje
 	if (idx == (unsigned int) -1)
 		return SH_UKNOWN_OBJECT;
 	TrackedObject *to = objects[idx];
-	DataStructures::HashIndex hi = to->dataQueues.GetIndexOf(key);
-	if (hi.IsInvalid())
+	unsigned int keyId = FindKeyId(key);
+	if (keyId >= to->dataQueues.Size() || to->dataQueues[keyId] == 0)
 		return SH_UKNOWN_KEY;
-	*values = to->dataQueues.ItemAtIndex(hi);
+	*values = to->dataQueues[keyId];
 	(*values)->CullExpiredValues(curTime);
 	return SH_OK;
 }
@@ -186,15 +294,14 @@ bool StatisticsHistory::GetHistorySorted(uint64_t objectId, SHSortOperation sort
 	if (idx == (unsigned int) -1)
 		return false;
 	TrackedObject *to = objects[idx];
-	DataStructures::List<TimeAndValueQueue*> itemList;
-	DataStructures::List<RakString> keyList;
-	to->dataQueues.GetAsList(itemList,keyList,_FILE_AND_LINE_);
 	Time curTime = GetTime();
 
 	DataStructures::OrderedList<TimeAndValueQueue*, TimeAndValueQueue*,TimeAndValueQueueCompAsc> sortedQueues;
-	for (unsigned int i=0; i < itemList.Size(); i++)
+	for (unsigned int i=0; i < to->dataQueues.Size(); i++)
 	{
-		TimeAndValueQueue *tavq = itemList[i];
+		TimeAndValueQueue *tavq = to->dataQueues[i];
+		if (tavq == 0)
+			continue;
 		tavq->CullExpiredValues(curTime);
 
 		if (sortType == SH_SORT_BY_RECENT_SUM_ASCENDING || sortType == SH_SORT_BY_RECENT_SUM_DESCENDING)
@@ -240,44 +347,61 @@ void StatisticsHistory::MergeAllObjectsOnKey(RakString key, TimeAndValueQueue *t
 	tavqOutput->Clear();
 
 	Time curTime = GetTime();
+	unsigned int keyId = FindKeyId(key);
+	if (keyId == (unsigned int) -1)
+		return;
 
 	// Find every object with this key
 	for (unsigned int idx=0; idx < objects.Size(); idx++)
 	{
 		TrackedObject *to = objects[idx];
-		DataStructures::HashIndex hi = to->dataQueues.GetIndexOf(key);
-		if (hi.IsInvalid()==false)
+		if (keyId < to->dataQueues.Size() && to->dataQueues[keyId] != 0)
 		{
-			TimeAndValueQueue *tavqInput = to->dataQueues.ItemAtIndex(hi);
+			TimeAndValueQueue *tavqInput = to->dataQueues[keyId];
 			tavqInput->CullExpiredValues(curTime);
 			TimeAndValueQueue::MergeSets(tavqOutput, dataCategory, tavqInput, dataCategory, tavqOutput);
 		}
 	}
 }
+StatisticsHistory::SHErrorCode StatisticsHistory::GetBucketsForKey(RakString key, DataStructures::List<TimeBucket> &buckets, Time curTime) const
+{
+	buckets.Clear(true, _FILE_AND_LINE_);
+	unsigned int keyId = FindKeyId(key);
+	if (keyId == (unsigned int) -1)
+		return SH_UKNOWN_KEY;
+	KeyBuckets *kb = keyBuckets[keyId];
+	if (kb == 0)
+		return SH_OK;
+
+	Time oldestTime = 0;
+	if (curTime > timeToTrack)
+		oldestTime = curTime - timeToTrack;
+
+	// Start after the current bucket, which is the oldest one
+	unsigned int numBuckets = kb->buckets.Size();
+	unsigned int currentBucket = (unsigned int) ((curTime / bucketInterval) % numBuckets);
+	for (unsigned int i=1; i <= numBuckets; i++)
+	{
+		const TimeBucket &bucket = kb->buckets[(currentBucket + i) % numBuckets];
+		if (bucket.count > 0 && bucket.time + bucketInterval > oldestTime && bucket.time <= curTime)
+			buckets.Push(bucket, _FILE_AND_LINE_);
+	}
+	return SH_OK;
+}
 void StatisticsHistory::GetUniqueKeyList(DataStructures::List<RakString> &keys)
 {
 	keys.Clear(true, _FILE_AND_LINE_);
 
-	for (unsigned int idx=0; idx < objects.Size(); idx++)
+	for (unsigned int keyId=0; keyId < keyNames.Size(); keyId++)
 	{
-		TrackedObject *to = objects[idx];
-		DataStructures::List<TimeAndValueQueue*> itemList;
-		DataStructures::List<SLNet::RakString> keyList;
-		to->dataQueues.GetAsList(itemList, keyList, _FILE_AND_LINE_);
-		for (unsigned int k=0; k < keyList.Size(); k++)
+		for (unsigned int idx=0; idx < objects.Size(); idx++)
 		{
-			bool hasKey=false;
-			for (unsigned int j=0; j < keys.Size(); j++)
+			TrackedObject *to = objects[idx];
+			if (keyId < to->dataQueues.Size() && to->dataQueues[keyId] != 0)
 			{
-				if (keys[j]==keyList[k])
-				{
-					hasKey=true;
-					break;
-				}
+				keys.Push(keyNames[keyId], _FILE_AND_LINE_);
+				break;
 			}
-
-			if (hasKey==false)
-				keys.Push(keyList[k], _FILE_AND_LINE_);
 		}
 	}
 }
@@ -303,23 +427,15 @@ SHValueType StatisticsHistory::TimeAndValueQueue::GetRecentAverage(void) const
 }
 SHValueType StatisticsHistory::TimeAndValueQueue::GetRecentLowest(void) const
 {
-	SHValueType out = SH_TYPE_MAX;
-	for (unsigned int idx=0; idx < values.Size(); idx++)
-	{
-		if (values[idx].val < out)
-			out = values[idx].val;
-	}
-	return out;
+	if (recentLowestValues.Size()==0)
+		return SH_TYPE_MAX;
+	return recentLowestValues.Peek().val;
 }
 SHValueType StatisticsHistory::TimeAndValueQueue::GetRecentHighest(void) const
 {
-	SHValueType out = -SH_TYPE_MAX;
-	for (unsigned int idx=0; idx < values.Size(); idx++)
-	{
-		if (values[idx].val > out)
-			out = values[idx].val;
-	}
-	return out;
+	if (recentHighestValues.Size()==0)
+		return -SH_TYPE_MAX;
+	return recentHighestValues.Peek().val;
 }
 SHValueType StatisticsHistory::TimeAndValueQueue::GetRecentStandardDeviation(void) const
 {
@@ -329,7 +445,10 @@ SHValueType StatisticsHistory::TimeAndValueQueue::GetRecentStandardDeviation(voi
 	SHValueType recentMean= GetRecentAverage();
 	SHValueType squareOfMean = recentMean * recentMean;
 	SHValueType meanOfSquares = GetRecentSumOfSquares() / (SHValueType) values.Size();
-	return meanOfSquares - squareOfMean;
+	// Rounding can make the variance slightly negative
+	if (meanOfSquares <= squareOfMean)
+		return 0;
+	return sqrt(meanOfSquares - squareOfMean);
 }
 SHValueType StatisticsHistory::TimeAndValueQueue::GetLongTermAverage(void) const
 {
@@ -395,14 +514,14 @@ void StatisticsHistory::TimeAndValueQueue::MergeSets( const TimeAndValueQueue *l
 			}
 			else if (rhs->values[rhsIndex].time > lhs->values[lhsIndex].time)
 			{
-				valuesOutput.Push(lhs->values[rhsIndex], _FILE_AND_LINE_ );
+				valuesOutput.Push(lhs->values[lhsIndex], _FILE_AND_LINE_ );
 				lhsIndex++;
 			}
 			else
 			{
 				valuesOutput.Push(rhs->values[rhsIndex], _FILE_AND_LINE_ );
 				rhsIndex++;
-				valuesOutput.Push(lhs->values[rhsIndex], _FILE_AND_LINE_ );
+				valuesOutput.Push(lhs->values[lhsIndex], _FILE_AND_LINE_ );
 				lhsIndex++;
 			}
 		}
@@ -510,6 +629,9 @@ void StatisticsHistory::TimeAndValueQueue::MergeSets( const TimeAndValueQueue *l
 	}
 
 	output->values = valuesOutput;
+	output->firstSequence = 0;
+	output->culledSinceSummed = 0;
+	output->RebuildRecentExtremes();
 }
 void StatisticsHistory::TimeAndValueQueue::ResizeSampleSet( int maxSamples, DataStructures::Queue<StatisticsHistory::TimeAndValue> &histogram, SHDataCategory dataCategory, Time timeClipStart, Time timeClipEnd )
 {
@@ -651,12 +773,113 @@ void StatisticsHistory::TimeAndValueQueue::CullExpiredValues(Time curTime)
 			recentSum -= tav.val;
 			recentSumOfSquares -= tav.val * tav.val;
 			values.Pop();
+			firstSequence++;
+			culledSinceSummed++;
 		}
 		else
 		{
 			break;
 		}
 	}
+
+	while (recentLowestValues.Size() && recentLowestValues.Peek().sequence < firstSequence)
+		recentLowestValues.Pop();
+	while (recentHighestValues.Size() && recentHighestValues.Peek().sequence < firstSequence)
+		recentHighestValues.Pop();
+
+	// Sum up again once all values were replaced, so the cost per value stays constant
+	if (culledSinceSummed > values.Size())
+	{
+		recentSum = 0;
+		recentSumOfSquares = 0;
+		for (unsigned int idx=0; idx < values.Size(); idx++)
+		{
+			recentSum += values[idx].val;
+			recentSumOfSquares += values[idx].val * values[idx].val;
+		}
+		culledSinceSummed = 0;
+	}
+}
+void StatisticsHistory::TimeAndValueQueue::PushValue(TimeAndValue tav)
+{
+	SequencedValue sv;
+	sv.val = tav.val;
+	sv.time = tav.time;
+	sv.sequence = firstSequence + values.Size();
+	values.Push(tav, _FILE_AND_LINE_);
+	PushRecentExtremes(sv);
+
+	recentSum += tav.val;
+	recentSumOfSquares += tav.val * tav.val;
+	longTermSum += tav.val;
+	longTermCount = longTermCount + 1;
+	if (longTermLowest > tav.val)
+		longTermLowest = tav.val;
+	if (longTermHighest < tav.val)
+		longTermHighest = tav.val;
+}
+StatisticsHistory::TimeAndValue StatisticsHistory::TimeAndValueQueue::PopTailValue(void)
+{
+	TimeAndValue tav = values.PopTail();
+
+	// The tail is always the last entry of both lists
+	recentLowestValues.PopTail();
+	recentHighestValues.PopTail();
+	RestoreRecentExtremes(recentLowestValues, true);
+	RestoreRecentExtremes(recentHighestValues, false);
+
+	recentSum -= tav.val;
+	recentSumOfSquares -= tav.val * tav.val;
+	longTermSum -= tav.val;
+	longTermCount = longTermCount - 1;
+	return tav;
+}
+void StatisticsHistory::TimeAndValueQueue::PushRecentExtremes(const SequencedValue &sv)
+{
+	while (recentLowestValues.Size() && recentLowestValues.PeekTail().val >= sv.val)
+		recentLowestValues.PopTail();
+	recentLowestValues.Push(sv, _FILE_AND_LINE_);
+	while (recentHighestValues.Size() && recentHighestValues.PeekTail().val <= sv.val)
+		recentHighestValues.PopTail();
+	recentHighestValues.Push(sv, _FILE_AND_LINE_);
+}
+void StatisticsHistory::TimeAndValueQueue::RestoreRecentExtremes(DataStructures::Queue<SequencedValue> &extremes, bool lowest)
+{
+	// Values after the last remaining entry were only removed by the popped tail
+	uint64_t restoreFrom = firstSequence;
+	if (extremes.Size())
+		restoreFrom = extremes.PeekTail().sequence + 1;
+
+	DataStructures::List<SequencedValue> restored;
+	for (uint64_t sequence = firstSequence + values.Size(); sequence > restoreFrom; sequence--)
+	{
+		const TimeAndValue &tav = values[(unsigned int) (sequence - 1 - firstSequence)];
+		if (restored.Size() == 0 ||
+			(lowest && tav.val < restored[restored.Size()-1].val) ||
+			(lowest == false && tav.val > restored[restored.Size()-1].val))
+		{
+			SequencedValue sv;
+			sv.val = tav.val;
+			sv.time = tav.time;
+			sv.sequence = sequence - 1;
+			restored.Push(sv, _FILE_AND_LINE_);
+		}
+	}
+	for (unsigned int i=restored.Size(); i > 0; i--)
+		extremes.Push(restored[i-1], _FILE_AND_LINE_);
+}
+void StatisticsHistory::TimeAndValueQueue::RebuildRecentExtremes(void)
+{
+	recentLowestValues.Clear(_FILE_AND_LINE_);
+	recentHighestValues.Clear(_FILE_AND_LINE_);
+	for (unsigned int idx=0; idx < values.Size(); idx++)
+	{
+		SequencedValue sv;
+		sv.val = values[idx].val;
+		sv.time = values[idx].time;
+		sv.sequence = firstSequence + idx;
+		PushRecentExtremes(sv);
+	}
 }
 SHValueType StatisticsHistory::TimeAndValueQueue::Interpolate(StatisticsHistory::TimeAndValue t1, StatisticsHistory::TimeAndValue t2, Time time)
 {
@@ -682,6 +905,10 @@ void StatisticsHistory::TimeAndValueQueue::Clear(void)
 	longTermLowest = SH_TYPE_MAX;
 	longTermHighest = -SH_TYPE_MAX;
 	values.Clear(_FILE_AND_LINE_);
+	recentLowestValues.Clear(_FILE_AND_LINE_);
+	recentHighestValues.Clear(_FILE_AND_LINE_);
+	firstSequence = 0;
+	culledSinceSummed = 0;
 }
 StatisticsHistory::TimeAndValueQueue& StatisticsHistory::TimeAndValueQueue::operator = ( const TimeAndValueQueue& input )
 {
@@ -694,15 +921,17 @@ StatisticsHistory::TimeAndValueQueue& StatisticsHistory::TimeAndValueQueue::oper
 	longTermCount=input.longTermCount;
 	longTermLowest=input.longTermLowest;
 	longTermHighest=input.longTermHighest;
+	recentLowestValues=input.recentLowestValues;
+	recentHighestValues=input.recentHighestValues;
+	firstSequence=input.firstSequence;
+	culledSinceSummed=input.culledSinceSummed;
 	return *this;
 }
 StatisticsHistory::TrackedObject::TrackedObject() {}
 StatisticsHistory::TrackedObject::~TrackedObject()
 {
-	DataStructures::List<StatisticsHistory::TimeAndValueQueue*> itemList;
-	DataStructures::List<RakString> keyList;
-	for (unsigned int idx=0; idx < itemList.Size(); idx++)
-		SLNet::OP_DELETE(itemList[idx], _FILE_AND_LINE_);
+	for (unsigned int idx=0; idx < dataQueues.Size(); idx++)
+		SLNet::OP_DELETE(dataQueues[idx], _FILE_AND_LINE_);
 }
 unsigned int StatisticsHistory::GetObjectIndex(uint64_t objectId) const
 {
@@ -712,11 +941,27 @@ unsigned int StatisticsHistory::GetObjectIndex(uint64_t objectId) const
 		return idx;
 	return (unsigned int) -1;
 }
+// Keys of the connection statistics, in the order of connectionKeyIds
+static const char *connectionKeys[8] =
+{
+	"RN_ACTUAL_BYTES_SENT",
+	"RN_USER_MESSAGE_BYTES_RESENT",
+	"RN_ACTUAL_BYTES_RECEIVED",
+	"RN_USER_MESSAGE_BYTES_PUSHED",
+	"RN_USER_MESSAGE_BYTES_RECEIVED_PROCESSED",
+	"RN_lastPing",
+	"RN_bytesInResendBuffer",
+	"RN_packetlossLastSecond",
+};
 StatisticsHistoryPlugin::StatisticsHistoryPlugin()
 {
 	addNewConnections = true;
 	removeLostConnections = true;
 	newConnectionsObjectType = 0;
+	sampleInterval = 0;
+	lastSampleTime = 0;
+	for (unsigned int i=0; i < 8; i++)
+		connectionKeyIds[i] = statistics.GetKeyId(connectionKeys[i]);
 }
 StatisticsHistoryPlugin::~StatisticsHistoryPlugin()
 {
@@ -727,56 +972,67 @@ void StatisticsHistoryPlugin::SetTrackConnections(bool _addNewConnections, int _
 	removeLostConnections = _removeLostConnections;
 	newConnectionsObjectType = _newConnectionsObjectType;
 }
+void StatisticsHistoryPlugin::SetSampleInterval(Time interval)
+{
+	sampleInterval = interval;
+}
 void StatisticsHistoryPlugin::Update(void)
 {
+	Time curTime = GetTime();
+	if (sampleInterval != 0)
+	{
+		if (curTime - lastSampleTime < sampleInterval)
+			return;
+		lastSampleTime = curTime;
+	}
+
 	DataStructures::List<SystemAddress> addresses;
 	DataStructures::List<RakNetGUID> guids;
 	DataStructures::List<RakNetStatistics> stats;
 	rakPeerInterface->GetStatisticsList(addresses, guids, stats);
 
-	Time curTime = GetTime();
 	for (unsigned int idx = 0; idx < guids.Size(); idx++)
 	{
 		unsigned int objectIndex = statistics.GetObjectIndex(guids[idx].g);
 		if (objectIndex!=(unsigned int)-1)
 		{
 			statistics.AddValueByIndex(objectIndex,
-				"RN_ACTUAL_BYTES_SENT",
+				connectionKeyIds[0],
 				(SHValueType) stats[idx].valueOverLastSecond[ACTUAL_BYTES_SENT],
 				curTime, false);
 
 			statistics.AddValueByIndex(objectIndex,
-				"RN_USER_MESSAGE_BYTES_RESENT",
+				connectionKeyIds[1],
 				(SHValueType) stats[idx].valueOverLastSecond[USER_MESSAGE_BYTES_RESENT],
 				curTime, false);
 
 			statistics.AddValueByIndex(objectIndex,
-				"RN_ACTUAL_BYTES_RECEIVED",
+				connectionKeyIds[2],
 				(SHValueType) stats[idx].valueOverLastSecond[ACTUAL_BYTES_RECEIVED],
 				curTime, false);
 
 			statistics.AddValueByIndex(objectIndex,
-				"RN_USER_MESSAGE_BYTES_PUSHED",
+				connectionKeyIds[3],
 				(SHValueType) stats[idx].valueOverLastSecond[USER_MESSAGE_BYTES_PUSHED],
 				curTime, false);
 
 			statistics.AddValueByIndex(objectIndex,
-				"RN_USER_MESSAGE_BYTES_RECEIVED_PROCESSED",
+				connectionKeyIds[4],
 				(SHValueType) stats[idx].valueOverLastSecond[USER_MESSAGE_BYTES_RECEIVED_PROCESSED],
 				curTime, false);
 
 			statistics.AddValueByIndex(objectIndex,
-				"RN_lastPing",
+				connectionKeyIds[5],
 				(SHValueType) rakPeerInterface->GetLastPing(guids[idx]),
 				curTime, false);
 
 			statistics.AddValueByIndex(objectIndex,
-				"RN_bytesInResendBuffer",
+				connectionKeyIds[6],
 				(SHValueType) stats[idx].bytesInResendBuffer,
 				curTime, false);
 			
 			statistics.AddValueByIndex(objectIndex,
-				"RN_packetlossLastSecond",
+				connectionKeyIds[7],
 				(SHValueType) stats[idx].packetlossLastSecond,
 				curTime, false);
 		}
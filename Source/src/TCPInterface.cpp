@@ -58,6 +58,9 @@ namespace SLNet
 {
 RAK_THREAD_DECLARATION(UpdateTCPInterfaceLoop);
 RAK_THREAD_DECLARATION(ConnectionAttemptLoop);
+#if TCP_INTERFACE_USE_EPOLL==1
+RAK_THREAD_DECLARATION(UpdateTCPInterfaceEpollLoop);
+#endif
 }
 #ifdef _MSC_VER
 #pragma warning( push )
@@ -65,6 +68,31 @@ RAK_THREAD_DECLARATION(ConnectionAttemptLoop);
 #include "slikenet/linux_adapter.h"
 #include "slikenet/osx_adapter.h"
 
+#if TCP_INTERFACE_USE_EPOLL==1
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+
+// epoll_event::data of the listen socket. Remote clients store their index into remoteClients in the low and their socket in the high 32 bits.
+static const uint64_t EPOLL_LISTEN_SOCKET_DATA=(uint64_t) -1;
+static const uint32_t EPOLL_REMOTE_CLIENT_EVENTS=EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+static const int EPOLL_MAX_EVENTS=256;
+
+static uint64_t EpollRemoteClientData(unsigned int remoteClientIndex, __TCPSOCKET__ s)
+{
+	return (uint64_t) remoteClientIndex | ((uint64_t) (uint32_t) s << 32);
+}
+static void SetSocketNonBlocking(__TCPSOCKET__ s, bool nonBlocking)
+{
+	int flags = fcntl(s, F_GETFL, 0);
+	if (flags<0)
+		return;
+	fcntl(s, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+#endif
+
 using namespace SLNet;
 
 STATIC_FACTORY_DEFINITIONS(TCPInterface,TCPInterface);
@@ -230,6 +258,32 @@ bool TCPInterface::Start(unsigned short port, unsigned short maxIncomingConnecti
 #endif
 	}
 
+#if TCP_INTERFACE_USE_EPOLL==1
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd<0)
+	{
+		// Undo the above, so that Start() can be called again
+		if (listenSocket!=0)
+		{
+			closesocket__(listenSocket);
+			listenSocket=0;
+		}
+		remoteClientsLength=0;
+		SLNet::OP_DELETE_ARRAY(remoteClients,_FILE_AND_LINE_);
+		remoteClients=0;
+		isStarted.Decrement();
+		return false;
+	}
+	if (listenSocket!=0)
+	{
+		SetSocketNonBlocking(listenSocket, true);
+		epoll_event ev;
+		ev.events=EPOLLIN | EPOLLET;
+		ev.data.u64=EPOLL_LISTEN_SOCKET_DATA;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, listenSocket, &ev);
+	}
+#endif
+
 
 	// Start the update thread
 	int errorCode;
@@ -238,7 +292,11 @@ bool TCPInterface::Start(unsigned short port, unsigned short maxIncomingConnecti
 
 
 
+#if TCP_INTERFACE_USE_EPOLL==1
+	errorCode = SLNet::RakThread::Create(UpdateTCPInterfaceEpollLoop, this, threadPriority);
+#else
 	errorCode = SLNet::RakThread::Create(UpdateTCPInterfaceLoop, this, threadPriority);
+#endif
 
 
 	if (errorCode!=0)
@@ -301,6 +359,10 @@ void TCPInterface::Stop(void)
 	#if !defined(WINDOWS_STORE_RT)
 		listenSocket=0;
 	#endif
+#if TCP_INTERFACE_USE_EPOLL==1
+	close(epollFd);
+	epollFd=-1;
+#endif
 
 	// Stuff from here on to the end of the function is not threadsafe
 	for (i=0; i < remoteClientsLength; i++)
@@ -397,6 +459,9 @@ SystemAddress TCPInterface::Connect(const char* host, unsigned short remotePort,
 
 		remoteClients[newRemoteClientIndex].socket=sockfd;
 		remoteClients[newRemoteClientIndex].systemAddress=systemAddress;
+#if TCP_INTERFACE_USE_EPOLL==1
+		AddToEpoll(newRemoteClientIndex);
+#endif
 
 		completedConnectionAttemptMutex.Lock();
 		completedConnectionAttempts.Push(remoteClients[newRemoteClientIndex].systemAddress, _FILE_AND_LINE_ );
@@ -487,7 +552,8 @@ bool TCPInterface::SendList( const char **data, const unsigned int *lengths, con
 		{
 			if (remoteClients[i].systemAddress!=systemAddress)
 			{
-				remoteClients[i].SendOrBuffer(data, lengths, numParameters);
+				if (remoteClients[i].SendOrBuffer(data, lengths, numParameters))
+					RequestFlush(i);
 			}
 		}
 	}
@@ -497,7 +563,8 @@ bool TCPInterface::SendList( const char **data, const unsigned int *lengths, con
 		if (systemAddress.systemIndex<remoteClientsLength &&
 			remoteClients[systemAddress.systemIndex].systemAddress==systemAddress)
 		{
-			remoteClients[systemAddress.systemIndex].SendOrBuffer(data, lengths, numParameters);
+			if (remoteClients[systemAddress.systemIndex].SendOrBuffer(data, lengths, numParameters))
+				RequestFlush(systemAddress.systemIndex);
 		}
 		else
 		{
@@ -505,7 +572,8 @@ bool TCPInterface::SendList( const char **data, const unsigned int *lengths, con
 			{
 				if (remoteClients[i].systemAddress==systemAddress )
 				{
-					remoteClients[i].SendOrBuffer(data, lengths, numParameters);
+					if (remoteClients[i].SendOrBuffer(data, lengths, numParameters))
+						RequestFlush(i);
 				}
 			}
 		}
@@ -946,6 +1014,9 @@ RAK_THREAD_DECLARATION(SLNet::ConnectionAttemptLoop)
 
 	tcpInterface->remoteClients[newRemoteClientIndex].socket=sockfd;
 	tcpInterface->remoteClients[newRemoteClientIndex].systemAddress=systemAddress;
+#if TCP_INTERFACE_USE_EPOLL==1
+	tcpInterface->AddToEpoll(newRemoteClientIndex);
+#endif
 
 	// Notify user that the connection attempt has completed.
 	if (tcpInterface->threadRunning.GetValue()>0)
@@ -998,33 +1069,7 @@ RAK_THREAD_DECLARATION(SLNet::UpdateTCPInterfaceLoop)
 
 	while (sts->isStarted.GetValue()>0)
 	{
-#if OPEN_SSL_CLIENT_SUPPORT==1
-		SystemAddress *sslSystemAddress;
-		sslSystemAddress = sts->startSSL.PopInaccurate();
-		if (sslSystemAddress)
-		{
-			if (sslSystemAddress->systemIndex>=0 &&
-				sslSystemAddress->systemIndex<sts->remoteClientsLength &&
-				sts->remoteClients[sslSystemAddress->systemIndex].systemAddress==*sslSystemAddress)
-			{
-				sts->remoteClients[sslSystemAddress->systemIndex].InitSSL(sts->ctx,sts->meth);
-			}
-			else
-			{
-				for (int i=0; i < sts->remoteClientsLength; i++)
-				{
-					sts->remoteClients[i].isActiveMutex.Lock();
-					if (sts->remoteClients[i].isActive && sts->remoteClients[i].systemAddress==*sslSystemAddress)
-					{
-						if (sts->remoteClients[i].ssl==0)
-							sts->remoteClients[i].InitSSL(sts->ctx,sts->meth);
-					}
-					sts->remoteClients[i].isActiveMutex.Unlock();
-				}
-			}
-			sts->startSSL.Deallocate(sslSystemAddress,_FILE_AND_LINE_);
-		}
-#endif
+		sts->StartPendingSSL();
 
 
 		__TCPSOCKET__ largestDescriptor=0; // see select__()'s first parameter's documentation under linux
@@ -1293,6 +1338,209 @@ RAK_THREAD_DECLARATION(SLNet::UpdateTCPInterfaceLoop)
 
 }
 
+void TCPInterface::StartPendingSSL(void)
+{
+#if OPEN_SSL_CLIENT_SUPPORT==1
+	SystemAddress *sslSystemAddress;
+	sslSystemAddress = startSSL.PopInaccurate();
+	if (sslSystemAddress)
+	{
+		if (sslSystemAddress->systemIndex>=0 &&
+			sslSystemAddress->systemIndex<remoteClientsLength &&
+			remoteClients[sslSystemAddress->systemIndex].systemAddress==*sslSystemAddress)
+		{
+			remoteClients[sslSystemAddress->systemIndex].InitSSL(ctx,meth);
+		}
+		else
+		{
+			for (int i=0; i < remoteClientsLength; i++)
+			{
+				remoteClients[i].isActiveMutex.Lock();
+				if (remoteClients[i].isActive && remoteClients[i].systemAddress==*sslSystemAddress)
+				{
+					if (remoteClients[i].ssl==0)
+						remoteClients[i].InitSSL(ctx,meth);
+				}
+				remoteClients[i].isActiveMutex.Unlock();
+			}
+		}
+		startSSL.Deallocate(sslSystemAddress,_FILE_AND_LINE_);
+	}
+#endif
+}
+
+#if TCP_INTERFACE_USE_EPOLL==1
+void TCPInterface::AddToEpoll(unsigned int remoteClientIndex)
+{
+	__TCPSOCKET__ s = remoteClients[remoteClientIndex].socket;
+	SetSocketNonBlocking(s, true);
+	epoll_event ev;
+	ev.events=EPOLL_REMOTE_CLIENT_EVENTS;
+	ev.data.u64=EpollRemoteClientData(remoteClientIndex, s);
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, s, &ev);
+}
+void TCPInterface::RequestFlush(unsigned int remoteClientIndex)
+{
+	RemoteClient *rc = &remoteClients[remoteClientIndex];
+	// Hold isActiveMutex so the socket cannot be closed, and its descriptor reused, before epoll_ctl
+	rc->isActiveMutex.Lock();
+	if (rc->isActive && rc->socket!=0)
+	{
+		// Modifying the registration makes epoll report the socket again if it is writable
+		epoll_event ev;
+		ev.events=EPOLL_REMOTE_CLIENT_EVENTS;
+		ev.data.u64=EpollRemoteClientData(remoteClientIndex, rc->socket);
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, rc->socket, &ev);
+	}
+	rc->isActiveMutex.Unlock();
+}
+void TCPInterface::AcceptConnections(void)
+{
+#if RAKNET_SUPPORT_IPV6!=1
+	sockaddr_in sockAddr;
+#else
+	struct sockaddr_storage sockAddr;
+#endif
+	socklen_t sockAddrSize;
+
+	// Edge triggered, so accept until the backlog is empty
+	for(;;)
+	{
+		sockAddrSize = sizeof(sockAddr);
+		__TCPSOCKET__ newSock = accept__(listenSocket, (sockaddr*)&sockAddr, &sockAddrSize);
+		if (newSock==(__TCPSOCKET__) -1)
+		{
+			if (errno==EINTR || errno==ECONNABORTED)
+				continue;
+			return;
+		}
+
+		int newRemoteClientIndex;
+		for (newRemoteClientIndex=0; newRemoteClientIndex < remoteClientsLength; newRemoteClientIndex++)
+		{
+			remoteClients[newRemoteClientIndex].isActiveMutex.Lock();
+			if (remoteClients[newRemoteClientIndex].isActive==false)
+			{
+				remoteClients[newRemoteClientIndex].socket=newSock;
+
+#if RAKNET_SUPPORT_IPV6!=1
+				remoteClients[newRemoteClientIndex].systemAddress.address.addr4.sin_addr.s_addr=sockAddr.sin_addr.s_addr;
+				remoteClients[newRemoteClientIndex].systemAddress.SetPortNetworkOrder( sockAddr.sin_port);
+#else
+				if (sockAddr.ss_family==AF_INET)
+					memcpy(&remoteClients[newRemoteClientIndex].systemAddress.address.addr4,(sockaddr_in *)&sockAddr,sizeof(sockaddr_in));
+				else
+					memcpy(&remoteClients[newRemoteClientIndex].systemAddress.address.addr6,(sockaddr_in6 *)&sockAddr,sizeof(sockaddr_in6));
+#endif // #if RAKNET_SUPPORT_IPV6!=1
+				remoteClients[newRemoteClientIndex].systemAddress.systemIndex=(SystemIndex) newRemoteClientIndex;
+				remoteClients[newRemoteClientIndex].SetActive(true);
+				AddToEpoll(newRemoteClientIndex);
+				remoteClients[newRemoteClientIndex].isActiveMutex.Unlock();
+
+				SystemAddress *newConnectionSystemAddress=newIncomingConnections.Allocate( _FILE_AND_LINE_ );
+				*newConnectionSystemAddress=remoteClients[newRemoteClientIndex].systemAddress;
+				newIncomingConnections.Push(newConnectionSystemAddress);
+				break;
+			}
+			remoteClients[newRemoteClientIndex].isActiveMutex.Unlock();
+		}
+
+		// No free slot
+		if (newRemoteClientIndex==remoteClientsLength)
+			closesocket__(newSock);
+	}
+}
+
+RAK_THREAD_DECLARATION(SLNet::UpdateTCPInterfaceEpollLoop)
+{
+	TCPInterface * sts = ( TCPInterface * ) arguments;
+
+	const unsigned int BUFF_SIZE=1048576;
+	char * data = (char*) rakMalloc_Ex(BUFF_SIZE,_FILE_AND_LINE_);
+	Packet *incomingMessage;
+	epoll_event events[EPOLL_MAX_EVENTS];
+	sts->threadRunning.Increment();
+
+	while (sts->isStarted.GetValue()>0)
+	{
+		sts->StartPendingSSL();
+
+		// The timeout only bounds how long Stop() and StartSSLClient() wait
+		int numEvents = epoll_wait(sts->epollFd, events, EPOLL_MAX_EVENTS, 30);
+		for (int eventIndex=0; eventIndex < numEvents; eventIndex++)
+		{
+			if (events[eventIndex].data.u64==EPOLL_LISTEN_SOCKET_DATA)
+			{
+				sts->AcceptConnections();
+				continue;
+			}
+
+			unsigned int i = (unsigned int) (events[eventIndex].data.u64 & 0xFFFFFFFF);
+			__TCPSOCKET__ socketCopy = (__TCPSOCKET__) (events[eventIndex].data.u64 >> 32);
+			if (i >= sts->remoteClientsLength)
+				continue;
+			RemoteClient *rc = &sts->remoteClients[i];
+			// The event may be for a connection that was closed since
+			if (rc->isActive==false || rc->socket!=socketCopy)
+				continue;
+
+			if (events[eventIndex].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+			{
+				// Edge triggered, so read until the socket has no more data
+				bool connectionLost=false;
+				for(;;)
+				{
+					// if recv returns 0 this was a graceful close
+					int len = rc->Recv(data,BUFF_SIZE);
+					if (len>0)
+					{
+						incomingMessage=sts->incomingMessages.Allocate( _FILE_AND_LINE_ );
+						incomingMessage->data = (unsigned char*) rakMalloc_Ex( len+1, _FILE_AND_LINE_ );
+						memcpy(incomingMessage->data, data, len);
+						incomingMessage->data[len]=0; // Null terminate this so we can print it out as regular strings.  This is different from RakNet which does not do this.
+						incomingMessage->length=len;
+						incomingMessage->deleteData=true; // actually means came from SPSC, rather than AllocatePacket
+						incomingMessage->systemAddress=rc->systemAddress;
+						sts->incomingMessages.Push(incomingMessage);
+					}
+					else if (len==0 || rc->WouldBlock(len)==false)
+					{
+						connectionLost=true;
+						break;
+					}
+					else
+						break;
+				}
+
+				if (connectionLost)
+				{
+					SystemAddress *lostConnectionSystemAddress=sts->lostConnections.Allocate( _FILE_AND_LINE_ );
+					*lostConnectionSystemAddress=rc->systemAddress;
+					sts->lostConnections.Push(lostConnectionSystemAddress);
+					rc->isActiveMutex.Lock();
+					rc->SetActive(false);
+					rc->isActiveMutex.Unlock();
+					continue;
+				}
+			}
+
+			if (events[eventIndex].events & EPOLLOUT)
+				rc->Flush();
+		}
+	}
+	sts->threadRunning.Decrement();
+
+	rakFree_Ex(data,_FILE_AND_LINE_);
+
+	return 0;
+}
+#else
+void TCPInterface::RequestFlush(unsigned int remoteClientIndex)
+{
+	(void) remoteClientIndex;
+}
+#endif // #if TCP_INTERFACE_USE_EPOLL==1
+
 void RemoteClient::SetActive(bool a)
 {
 	if (isActive != a)
@@ -1306,38 +1554,76 @@ void RemoteClient::SetActive(bool a)
 		}
 	}
 }
-void RemoteClient::SendOrBuffer(const char **data, const unsigned int *lengths, const int numParameters)
+bool RemoteClient::SendOrBuffer(const char **data, const unsigned int *lengths, const int numParameters)
 {
-	// True can save memory and buffer copies, but gives worse performance overall
-	// Do not use true for the XBOX, as it just locks up
-	const bool ALLOW_SEND_FROM_USER_THREAD=false;
-
-	int parameterIndex;
 	if (isActive==false)
-		return;
-	parameterIndex=0;
-	for (; parameterIndex < numParameters; parameterIndex++)
+		return false;
+	// Lock once for all parameters, so they are written out together
+	outgoingDataMutex.Lock();
+	bool wasEmpty = outgoingData.GetBytesWritten()==0;
+	for (int parameterIndex=0; parameterIndex < numParameters; parameterIndex++)
+		outgoingData.WriteBytes(data[parameterIndex],lengths[parameterIndex],_FILE_AND_LINE_);
+	outgoingDataMutex.Unlock();
+	return wasEmpty;
+}
+#if TCP_INTERFACE_USE_EPOLL==1
+void RemoteClient::Flush(void)
+{
+	outgoingDataMutex.Lock();
+	for(;;)
 	{
-		outgoingDataMutex.Lock();
-		if (ALLOW_SEND_FROM_USER_THREAD && outgoingData.GetBytesWritten()==0)
+		unsigned int contiguousLength, wrappedLength;
+		char* contiguousBytesPointer = outgoingData.PeekContiguousBytes(&contiguousLength);
+		if (contiguousLength==0)
+			break;
+		char* wrappedBytesPointer = outgoingData.PeekWrappedBytes(&wrappedLength);
+
+		int bytesSent;
+#if OPEN_SSL_CLIENT_SUPPORT==1
+		if (ssl)
 		{
-			outgoingDataMutex.Unlock();
-			int bytesSent = Send(data[parameterIndex],lengths[parameterIndex]);
-			if (bytesSent<(int) lengths[parameterIndex])
-			{
-				// Push remainder
-				outgoingDataMutex.Lock();
-				outgoingData.WriteBytes(data[parameterIndex]+bytesSent,lengths[parameterIndex]-bytesSent,_FILE_AND_LINE_);
-				outgoingDataMutex.Unlock();
-			}
+			bytesSent=SSL_write(ssl, contiguousBytesPointer, contiguousLength);
+			wrappedLength=0;
 		}
 		else
+#endif
 		{
-			outgoingData.WriteBytes(data[parameterIndex],lengths[parameterIndex],_FILE_AND_LINE_);
-			outgoingDataMutex.Unlock();
+			// Both parts of the ring buffer in one call. MSG_NOSIGNAL as the remote system may have closed the connection.
+			iovec iov[2];
+			iov[0].iov_base=contiguousBytesPointer;
+			iov[0].iov_len=contiguousLength;
+			iov[1].iov_base=wrappedBytesPointer;
+			iov[1].iov_len=wrappedLength;
+			msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov=iov;
+			msg.msg_iovlen=wrappedLength>0 ? 2 : 1;
+			bytesSent=(int) sendmsg(socket, &msg, MSG_NOSIGNAL);
 		}
+
+		// On errors the connection is closed when epoll reports EPOLLERR or EPOLLHUP
+		if (bytesSent<=0)
+			break;
+		outgoingData.IncrementReadOffset(bytesSent);
+		// Partial write, the socket buffer is full. Continue on the next EPOLLOUT.
+		if ((unsigned int) bytesSent < contiguousLength+wrappedLength)
+			break;
 	}
+	outgoingDataMutex.Unlock();
 }
+bool RemoteClient::WouldBlock(int result)
+{
+#if OPEN_SSL_CLIENT_SUPPORT==1
+	if (ssl)
+	{
+		int err = SSL_get_error(ssl, result);
+		return err==SSL_ERROR_WANT_READ || err==SSL_ERROR_WANT_WRITE;
+	}
+#endif
+	(void) result;
+	return errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR;
+}
+#endif
 #if OPEN_SSL_CLIENT_SUPPORT==1
 bool RemoteClient::InitSSL(SSL_CTX* ctx, SSL_METHOD *meth)
 {
@@ -1345,6 +1631,10 @@ bool RemoteClient::InitSSL(SSL_CTX* ctx, SSL_METHOD *meth)
 
 	ssl = SSL_new (ctx);                         
 	RakAssert(ssl);    
+#if TCP_INTERFACE_USE_EPOLL==1
+	// Flush() retries SSL_write() after ByteQueue may have reallocated
+	SSL_set_mode(ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#endif
 	int res;
 	res = SSL_set_fd (ssl, socket);
 	if (res!=1)
@@ -1355,7 +1645,14 @@ bool RemoteClient::InitSSL(SSL_CTX* ctx, SSL_METHOD *meth)
 		return false;
 	}
 	RakAssert(res==1);
+#if TCP_INTERFACE_USE_EPOLL==1
+	// The handshake blocks, as it does with select
+	SetSocketNonBlocking(socket, false);
+	res = SSL_connect (ssl);
+	SetSocketNonBlocking(socket, true);
+#else
 	res = SSL_connect (ssl);
+#endif
 	if (res<0)
 	{
 		unsigned long err = ERR_get_error();
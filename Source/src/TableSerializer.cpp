@@ -17,7 +17,10 @@
 #include "slikenet/DS_Table.h"
 #include "slikenet/BitStream.h"
 #include "slikenet/StringCompressor.h"
+#include "slikenet/SuperFastHash.h"
 #include "..\include\slikenet\slikeAssert.h"
+#include "slikenet/linux_adapter.h"
+#include "slikenet/osx_adapter.h"
 
 using namespace SLNet;
 
@@ -333,3 +336,558 @@ void TableSerializer::DeallocateQueryList(DataStructures::Table::FilterQuery *qu
 		SLNet::OP_DELETE(query[i].cellValue, _FILE_AND_LINE_);
 	SLNet::OP_DELETE_ARRAY(query, _FILE_AND_LINE_);
 }
+
+// Leading byte of SerializeColumnarTable(), changed with the format
+static const unsigned char COLUMNAR_TABLE_FORMAT_VERSION=1;
+// Flags of a column of SerializeColumnarTable()
+static const unsigned char COLUMNAR_HAS_EMPTY_CELLS=1;
+
+static inline unsigned char *WriteUInt32(unsigned char *out, uint32_t value)
+{
+	out[0]=(unsigned char) value;
+	out[1]=(unsigned char) (value>>8);
+	out[2]=(unsigned char) (value>>16);
+	out[3]=(unsigned char) (value>>24);
+	return out+4;
+}
+static inline unsigned char *WriteUInt64(unsigned char *out, uint64_t value)
+{
+	WriteUInt32(out, (uint32_t) value);
+	return WriteUInt32(out+4, (uint32_t) (value>>32));
+}
+static inline uint32_t ReadUInt32(const unsigned char *in)
+{
+	return (uint32_t) in[0] | ((uint32_t) in[1]<<8) | ((uint32_t) in[2]<<16) | ((uint32_t) in[3]<<24);
+}
+static inline uint64_t ReadUInt64(const unsigned char *in)
+{
+	return (uint64_t) ReadUInt32(in) | ((uint64_t) ReadUInt32(in+4)<<32);
+}
+// Appends numberOfBytes to out, on a byte boundary, and returns where to write them
+static unsigned char *ReserveBytes(SLNet::BitStream *out, unsigned int numberOfBytes)
+{
+	out->AlignWriteToByteBoundary();
+	out->AddBitsAndReallocate(BYTES_TO_BITS(numberOfBytes));
+	unsigned char *destination=out->GetData()+BITS_TO_BYTES(out->GetWriteOffset());
+	out->SetWriteOffset(out->GetWriteOffset()+BYTES_TO_BITS(numberOfBytes));
+	return destination;
+}
+// Visits the rows of a table in the order of their keys
+struct TableRowIterator
+{
+	TableRowIterator(DataStructures::Table *table) {page=table->GetRows().GetListHead(); index=0;}
+	DataStructures::Table::Row *Next(unsigned *key)
+	{
+		while (page && index >= page->size)
+		{
+			page=page->next;
+			index=0;
+		}
+		if (page==0)
+			return 0;
+		*key=page->keys[index];
+		return page->data[index++];
+	}
+	DataStructures::Page<unsigned, DataStructures::Table::Row*, _TABLE_BPLUS_TREE_ORDER> *page;
+	int index;
+};
+// The distinct strings of a column, in the order they were first found
+struct ColumnarStringDictionary
+{
+	ColumnarStringDictionary() {slots=0; slotCount=0; stringBytes=0;}
+	~ColumnarStringDictionary() {SLNet::OP_DELETE_ARRAY(slots, _FILE_AND_LINE_);}
+	unsigned int GetIndex(const char *str)
+	{
+		// Open addressing, kept at most half full
+		if ((strings.Size()+1)*2 > slotCount)
+			Grow();
+		unsigned int length=(unsigned int) strlen(str);
+		uint32_t hash=SuperFastHash(str, (int) length);
+		unsigned int slot=hash&(slotCount-1);
+		while (slots[slot]!=0)
+		{
+			unsigned int stringIndex=slots[slot]-1;
+			if (hashes[stringIndex]==hash && strcmp(strings[stringIndex], str)==0)
+				return stringIndex;
+			slot=(slot+1)&(slotCount-1);
+		}
+		slots[slot]=strings.Size()+1;
+		strings.Push(str, _FILE_AND_LINE_);
+		hashes.Push(hash, _FILE_AND_LINE_);
+		stringBytes+=length+1;
+		return strings.Size()-1;
+	}
+	void Grow(void)
+	{
+		SLNet::OP_DELETE_ARRAY(slots, _FILE_AND_LINE_);
+		slotCount = slotCount==0 ? 256 : slotCount*2;
+		slots=SLNet::OP_NEW_ARRAY<unsigned int>(slotCount, _FILE_AND_LINE_);
+		memset(slots, 0, sizeof(unsigned int)*slotCount);
+		for (unsigned int stringIndex=0; stringIndex < strings.Size(); stringIndex++)
+		{
+			unsigned int slot=hashes[stringIndex]&(slotCount-1);
+			while (slots[slot]!=0)
+				slot=(slot+1)&(slotCount-1);
+			slots[slot]=stringIndex+1;
+		}
+	}
+
+	DataStructures::List<const char*> strings;
+	DataStructures::List<uint32_t> hashes;
+	// Index of the string plus one, 0 for free slots
+	unsigned int *slots;
+	unsigned int slotCount;
+	unsigned int stringBytes;
+};
+static void SerializeColumnarStrings(DataStructures::Table *in, unsigned int columnIndex, unsigned int rowCount, SLNet::BitStream *out)
+{
+	ColumnarStringDictionary dictionary;
+	DataStructures::List<unsigned int> stringIndices;
+	stringIndices.Preallocate(rowCount, _FILE_AND_LINE_);
+	TableRowIterator rowIterator(in);
+	DataStructures::Table::Row *row;
+	unsigned key;
+	while ((row=rowIterator.Next(&key))!=0)
+	{
+		DataStructures::Table::Cell *cell=row->cells[columnIndex];
+		if (cell->isEmpty)
+			stringIndices.Push(0, _FILE_AND_LINE_);
+		else
+			stringIndices.Push(dictionary.GetIndex(cell->c ? cell->c : ""), _FILE_AND_LINE_);
+	}
+
+	unsigned char indexSize;
+	if (dictionary.strings.Size() <= 0x100)
+		indexSize=1;
+	else if (dictionary.strings.Size() <= 0x10000)
+		indexSize=2;
+	else
+		indexSize=4;
+
+	// Dictionary size, dictionary bytes, dictionary offsets, dictionary, index size, indices
+	unsigned char *dest=ReserveBytes(out, 4+4+4*dictionary.strings.Size()+dictionary.stringBytes+1+indexSize*rowCount);
+	dest=WriteUInt32(dest, dictionary.strings.Size());
+	dest=WriteUInt32(dest, dictionary.stringBytes);
+	unsigned int stringIndex, offset=0;
+	for (stringIndex=0; stringIndex < dictionary.strings.Size(); stringIndex++)
+	{
+		dest=WriteUInt32(dest, offset);
+		offset+=(unsigned int) strlen(dictionary.strings[stringIndex])+1;
+	}
+	for (stringIndex=0; stringIndex < dictionary.strings.Size(); stringIndex++)
+	{
+		unsigned int length=(unsigned int) strlen(dictionary.strings[stringIndex])+1;
+		memcpy(dest, dictionary.strings[stringIndex], length);
+		dest+=length;
+	}
+	*dest++=indexSize;
+	for (unsigned int rowIndex=0; rowIndex < rowCount; rowIndex++)
+	{
+		if (indexSize==1)
+			*dest++=(unsigned char) stringIndices[rowIndex];
+		else if (indexSize==2)
+		{
+			dest[0]=(unsigned char) stringIndices[rowIndex];
+			dest[1]=(unsigned char) (stringIndices[rowIndex]>>8);
+			dest+=2;
+		}
+		else
+			dest=WriteUInt32(dest, stringIndices[rowIndex]);
+	}
+}
+static void SerializeColumnarBinary(DataStructures::Table *in, unsigned int columnIndex, unsigned int rowCount, SLNet::BitStream *out)
+{
+	DataStructures::Table::Row *row;
+	unsigned key;
+	unsigned int dataLength=0;
+	TableRowIterator sizeIterator(in);
+	while ((row=sizeIterator.Next(&key))!=0)
+	{
+		if (row->cells[columnIndex]->isEmpty==false && row->cells[columnIndex]->c)
+			dataLength+=(unsigned int) row->cells[columnIndex]->i;
+	}
+
+	// Offsets of each row and the end, data
+	unsigned char *dest=ReserveBytes(out, 4*(rowCount+1)+dataLength);
+	unsigned char *data=dest+4*(rowCount+1);
+	unsigned int offset=0;
+	TableRowIterator rowIterator(in);
+	while ((row=rowIterator.Next(&key))!=0)
+	{
+		dest=WriteUInt32(dest, offset);
+		DataStructures::Table::Cell *cell=row->cells[columnIndex];
+		if (cell->isEmpty==false && cell->c)
+		{
+			memcpy(data+offset, cell->c, (size_t) cell->i);
+			offset+=(unsigned int) cell->i;
+		}
+	}
+	WriteUInt32(dest, offset);
+}
+void TableSerializer::SerializeColumnarTable(DataStructures::Table *in, SLNet::BitStream *out)
+{
+	const DataStructures::List<DataStructures::Table::ColumnDescriptor> &columns=in->GetColumns();
+	const unsigned int rowCount=in->GetRows().Size();
+	unsigned int columnIndex;
+	DataStructures::Table::Row *row;
+	unsigned key;
+
+	// Version, column count, type and NUL terminated name of each column, row count, row keys
+	unsigned int headerLength=1+4+4+4*rowCount;
+	for (columnIndex=0; columnIndex < columns.Size(); columnIndex++)
+		headerLength+=1+(unsigned int) strlen(columns[columnIndex].columnName)+1;
+	unsigned char *dest=ReserveBytes(out, headerLength);
+	*dest++=COLUMNAR_TABLE_FORMAT_VERSION;
+	dest=WriteUInt32(dest, columns.Size());
+	for (columnIndex=0; columnIndex < columns.Size(); columnIndex++)
+	{
+		*dest++=(unsigned char) columns[columnIndex].columnType;
+		unsigned int nameLength=(unsigned int) strlen(columns[columnIndex].columnName)+1;
+		memcpy(dest, columns[columnIndex].columnName, nameLength);
+		dest+=nameLength;
+	}
+	dest=WriteUInt32(dest, rowCount);
+	TableRowIterator keyIterator(in);
+	while (keyIterator.Next(&key))
+		dest=WriteUInt32(dest, key);
+
+	for (columnIndex=0; columnIndex < columns.Size(); columnIndex++)
+	{
+		// Flags, then the empty cells if there are any
+		bool hasEmptyCells=false;
+		TableRowIterator emptyIterator(in);
+		while ((row=emptyIterator.Next(&key))!=0 && hasEmptyCells==false)
+			hasEmptyCells=row->cells[columnIndex]->isEmpty;
+		dest=ReserveBytes(out, 1);
+		*dest = hasEmptyCells ? COLUMNAR_HAS_EMPTY_CELLS : 0;
+		if (hasEmptyCells)
+		{
+			dest=ReserveBytes(out, (rowCount+7)/8);
+			memset(dest, 0, (rowCount+7)/8);
+			unsigned int rowIndex=0;
+			TableRowIterator rowIterator(in);
+			while ((row=rowIterator.Next(&key))!=0)
+			{
+				if (row->cells[columnIndex]->isEmpty)
+					dest[rowIndex>>3]|=(unsigned char) (1<<(rowIndex&7));
+				rowIndex++;
+			}
+		}
+
+		DataStructures::Table::ColumnType columnType=columns[columnIndex].columnType;
+		if (columnType==DataStructures::Table::NUMERIC || columnType==DataStructures::Table::POINTER)
+		{
+			dest=ReserveBytes(out, 8*rowCount);
+			TableRowIterator rowIterator(in);
+			while ((row=rowIterator.Next(&key))!=0)
+			{
+				DataStructures::Table::Cell *cell=row->cells[columnIndex];
+				uint64_t value=0;
+				if (cell->isEmpty==false)
+				{
+					if (columnType==DataStructures::Table::NUMERIC)
+						memcpy(&value, &cell->i, sizeof(value));
+					else
+						value=(uint64_t) (size_t) cell->ptr;
+				}
+				dest=WriteUInt64(dest, value);
+			}
+		}
+		else if (columnType==DataStructures::Table::STRING)
+			SerializeColumnarStrings(in, columnIndex, rowCount, out);
+		else
+		{
+			RakAssert(columnType==DataStructures::Table::BINARY);
+			SerializeColumnarBinary(in, columnIndex, rowCount, out);
+		}
+	}
+}
+bool TableSerializer::DeserializeColumnarTable(unsigned char *serializedTable, unsigned int dataLength, DataStructures::Table *out)
+{
+	SLNet::BitStream in((unsigned char*) serializedTable, dataLength, false);
+	return DeserializeColumnarTable(&in, out);
+}
+bool TableSerializer::DeserializeColumnarTable(SLNet::BitStream *in, DataStructures::Table *out)
+{
+	ColumnarTableView view;
+	if (view.Set(in)==false)
+		return false;
+
+	out->Clear();
+	unsigned int columnIndex;
+	char columnName[_TABLE_MAX_COLUMN_NAME_LENGTH];
+	for (columnIndex=0; columnIndex < view.GetColumnCount(); columnIndex++)
+	{
+		strncpy_s(columnName, view.GetColumnName(columnIndex), _TABLE_MAX_COLUMN_NAME_LENGTH-1);
+		if (out->AddColumn(columnName, view.GetColumnType(columnIndex))==(unsigned) -1)
+			return false;
+	}
+
+	for (unsigned int rowIndex=0; rowIndex < view.GetRowCount(); rowIndex++)
+	{
+		DataStructures::Table::Row *row=out->AddRow(view.GetRowKey(rowIndex));
+		if (row==0)
+			return false;
+		for (columnIndex=0; columnIndex < view.GetColumnCount(); columnIndex++)
+		{
+			if (view.IsEmpty(rowIndex, columnIndex))
+				continue;
+			DataStructures::Table::Cell *cell=row->cells[columnIndex];
+			switch (view.GetColumnType(columnIndex))
+			{
+			case DataStructures::Table::NUMERIC:
+				cell->Set(view.GetNumeric(rowIndex, columnIndex));
+				break;
+			case DataStructures::Table::STRING:
+				cell->Set(view.GetString(rowIndex, columnIndex));
+				break;
+			case DataStructures::Table::BINARY:
+				{
+					unsigned int length;
+					const char *data=view.GetBinary(rowIndex, columnIndex, &length);
+					cell->Set(data, (int) length);
+				}
+				break;
+			case DataStructures::Table::POINTER:
+				cell->SetPtr(view.GetPointer(rowIndex, columnIndex));
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+ColumnarTableView::ColumnarTableView()
+{
+	Clear();
+}
+ColumnarTableView::~ColumnarTableView()
+{
+}
+bool ColumnarTableView::Set(const unsigned char *_serializedTable, unsigned int dataLength)
+{
+	Clear();
+	const unsigned char *cur=_serializedTable;
+	const unsigned char *end=_serializedTable+dataLength;
+	// Bytes left to read, compared as 64 bit so counts read from the data can not overflow
+	#define COLUMNAR_HAS_BYTES(n) ((uint64_t) (end-cur) >= (uint64_t) (n))
+
+	if (COLUMNAR_HAS_BYTES(1+4)==false || cur[0]!=COLUMNAR_TABLE_FORMAT_VERSION)
+		return false;
+	unsigned int columnCount=ReadUInt32(cur+1);
+	cur+=1+4;
+	if (columnCount > 10000)
+		return false; // Hacker crash prevention
+
+	unsigned int columnIndex;
+	for (columnIndex=0; columnIndex < columnCount; columnIndex++)
+	{
+		Column column;
+		memset(&column, 0, sizeof(column));
+		if (COLUMNAR_HAS_BYTES(2)==false || cur[0] > DataStructures::Table::POINTER)
+			return false;
+		column.columnType=(DataStructures::Table::ColumnType) cur[0];
+		column.columnName=(const char*) cur+1;
+		const unsigned char *nameEnd=(const unsigned char*) memchr(cur+1, 0, end-(cur+1));
+		if (nameEnd==0)
+			return false;
+		cur=nameEnd+1;
+		columns.Push(column, _FILE_AND_LINE_);
+	}
+
+	if (COLUMNAR_HAS_BYTES(4)==false)
+		return false;
+	rowCount=ReadUInt32(cur);
+	cur+=4;
+	if (COLUMNAR_HAS_BYTES(4*(uint64_t) rowCount)==false)
+		return false;
+	rowKeys=cur;
+	cur+=4*rowCount;
+
+	unsigned int rowIndex;
+	for (columnIndex=0; columnIndex < columnCount; columnIndex++)
+	{
+		Column &column=columns[columnIndex];
+		if (COLUMNAR_HAS_BYTES(1)==false)
+			return false;
+		unsigned char flags=*cur++;
+		if (flags & COLUMNAR_HAS_EMPTY_CELLS)
+		{
+			if (COLUMNAR_HAS_BYTES(((uint64_t) rowCount+7)/8)==false)
+				return false;
+			column.emptyCells=cur;
+			cur+=(rowCount+7)/8;
+		}
+
+		if (column.columnType==DataStructures::Table::NUMERIC || column.columnType==DataStructures::Table::POINTER)
+		{
+			if (COLUMNAR_HAS_BYTES(8*(uint64_t) rowCount)==false)
+				return false;
+			column.values=cur;
+			cur+=8*rowCount;
+		}
+		else if (column.columnType==DataStructures::Table::STRING)
+		{
+			if (COLUMNAR_HAS_BYTES(4+4)==false)
+				return false;
+			column.dictionarySize=ReadUInt32(cur);
+			unsigned int dictionaryBytes=ReadUInt32(cur+4);
+			cur+=4+4;
+			if (COLUMNAR_HAS_BYTES(4*(uint64_t) column.dictionarySize+dictionaryBytes+1)==false)
+				return false;
+			column.dictionaryOffsets=cur;
+			cur+=4*column.dictionarySize;
+			column.data=cur;
+			cur+=dictionaryBytes;
+			// Each string must end within the dictionary
+			if (column.dictionarySize > 0 && (dictionaryBytes==0 || column.data[dictionaryBytes-1]!=0))
+				return false;
+			for (unsigned int stringIndex=0; stringIndex < column.dictionarySize; stringIndex++)
+			{
+				if (ReadUInt32(column.dictionaryOffsets+4*stringIndex) >= dictionaryBytes)
+					return false;
+			}
+			column.indexSize=*cur++;
+			if ((column.indexSize!=1 && column.indexSize!=2 && column.indexSize!=4) || COLUMNAR_HAS_BYTES(column.indexSize*(uint64_t) rowCount)==false)
+				return false;
+			column.values=cur;
+			cur+=column.indexSize*rowCount;
+			for (rowIndex=0; rowIndex < rowCount; rowIndex++)
+			{
+				if (IsEmpty(rowIndex, columnIndex)==false && GetStringIndex(rowIndex, columnIndex) >= column.dictionarySize)
+					return false;
+			}
+		}
+		else
+		{
+			if (COLUMNAR_HAS_BYTES(4*((uint64_t) rowCount+1))==false)
+				return false;
+			column.values=cur;
+			cur+=4*(rowCount+1);
+			// Offsets may not decrease and the data must be complete
+			uint32_t previousOffset=0;
+			for (rowIndex=0; rowIndex <= rowCount; rowIndex++)
+			{
+				uint32_t offset=ReadUInt32(column.values+4*rowIndex);
+				if (offset < previousOffset)
+					return false;
+				previousOffset=offset;
+			}
+			if (COLUMNAR_HAS_BYTES(previousOffset)==false)
+				return false;
+			column.data=cur;
+			cur+=previousOffset;
+		}
+	}
+	#undef COLUMNAR_HAS_BYTES
+
+	serializedTable=_serializedTable;
+	serializedLength=(unsigned int) (cur-_serializedTable);
+	return true;
+}
+bool ColumnarTableView::Set(SLNet::BitStream *in)
+{
+	in->AlignReadToByteBoundary();
+	if (Set(in->GetData()+BITS_TO_BYTES(in->GetReadOffset()), BITS_TO_BYTES(in->GetNumberOfUnreadBits()))==false)
+		return false;
+	in->IgnoreBytes(serializedLength);
+	return true;
+}
+void ColumnarTableView::Clear(void)
+{
+	serializedTable=0;
+	serializedLength=0;
+	rowCount=0;
+	rowKeys=0;
+	columns.Clear(true, _FILE_AND_LINE_);
+}
+unsigned int ColumnarTableView::GetSerializedLength(void) const
+{
+	return serializedLength;
+}
+unsigned int ColumnarTableView::GetColumnCount(void) const
+{
+	return columns.Size();
+}
+const char *ColumnarTableView::GetColumnName(unsigned int columnIndex) const
+{
+	return columns[columnIndex].columnName;
+}
+DataStructures::Table::ColumnType ColumnarTableView::GetColumnType(unsigned int columnIndex) const
+{
+	return columns[columnIndex].columnType;
+}
+unsigned int ColumnarTableView::GetColumnIndex(const char *columnName) const
+{
+	for (unsigned int columnIndex=0; columnIndex < columns.Size(); columnIndex++)
+	{
+		if (strcmp(columns[columnIndex].columnName, columnName)==0)
+			return columnIndex;
+	}
+	return (unsigned int) -1;
+}
+unsigned int ColumnarTableView::GetRowCount(void) const
+{
+	return rowCount;
+}
+unsigned ColumnarTableView::GetRowKey(unsigned int rowIndex) const
+{
+	RakAssert(rowIndex < rowCount);
+	return ReadUInt32(rowKeys+4*rowIndex);
+}
+bool ColumnarTableView::IsEmpty(unsigned int rowIndex, unsigned int columnIndex) const
+{
+	RakAssert(rowIndex < rowCount);
+	const unsigned char *emptyCells=columns[columnIndex].emptyCells;
+	return emptyCells!=0 && (emptyCells[rowIndex>>3] & (1<<(rowIndex&7)))!=0;
+}
+double ColumnarTableView::GetNumeric(unsigned int rowIndex, unsigned int columnIndex) const
+{
+	RakAssert(columns[columnIndex].columnType==DataStructures::Table::NUMERIC);
+	uint64_t bits=ReadUInt64(columns[columnIndex].values+8*rowIndex);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+const char *ColumnarTableView::GetString(unsigned int rowIndex, unsigned int columnIndex) const
+{
+	if (IsEmpty(rowIndex, columnIndex))
+		return 0;
+	return GetDictionaryString(columnIndex, GetStringIndex(rowIndex, columnIndex));
+}
+unsigned int ColumnarTableView::GetStringIndex(unsigned int rowIndex, unsigned int columnIndex) const
+{
+	const Column &column=columns[columnIndex];
+	RakAssert(column.columnType==DataStructures::Table::STRING);
+	const unsigned char *index=column.values+column.indexSize*rowIndex;
+	if (column.indexSize==1)
+		return index[0];
+	if (column.indexSize==2)
+		return (unsigned int) index[0] | ((unsigned int) index[1]<<8);
+	return ReadUInt32(index);
+}
+unsigned int ColumnarTableView::GetDictionarySize(unsigned int columnIndex) const
+{
+	return columns[columnIndex].dictionarySize;
+}
+const char *ColumnarTableView::GetDictionaryString(unsigned int columnIndex, unsigned int stringIndex) const
+{
+	const Column &column=columns[columnIndex];
+	RakAssert(stringIndex < column.dictionarySize);
+	return (const char*) column.data+ReadUInt32(column.dictionaryOffsets+4*stringIndex);
+}
+const char *ColumnarTableView::GetBinary(unsigned int rowIndex, unsigned int columnIndex, unsigned int *length) const
+{
+	const Column &column=columns[columnIndex];
+	RakAssert(column.columnType==DataStructures::Table::BINARY);
+	uint32_t offset=ReadUInt32(column.values+4*rowIndex);
+	*length=ReadUInt32(column.values+4*(rowIndex+1))-offset;
+	if (*length==0)
+		return 0;
+	return (const char*) column.data+offset;
+}
+void *ColumnarTableView::GetPointer(unsigned int rowIndex, unsigned int columnIndex) const
+{
+	RakAssert(columns[columnIndex].columnType==DataStructures::Table::POINTER);
+	return (void*) (size_t) ReadUInt64(columns[columnIndex].values+8*rowIndex);
+}
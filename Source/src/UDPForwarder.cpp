@@ -39,12 +39,25 @@
 #include <netdb.h>      // used for getaddrinfo()
 #endif
 
+#if UDP_FORWARDER_USE_EPOLL==1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 #ifndef INVALID_SOCKET
 #define INVALID_SOCKET -1
 #endif
 
 using namespace SLNet;
 static const unsigned short DEFAULT_MAX_FORWARD_ENTRIES=64;
+#if UDP_FORWARDER_USE_EPOLL==1
+// Datagrams received and sent per recvmmsg() and sendmmsg() call
+static const int FORWARD_BATCH_SIZE=32;
+// Batches read from one socket before other sockets get their turn
+static const int MAX_BATCHES_PER_EVENT=4;
+static const int EPOLL_MAX_EVENTS=256;
+#endif
 
 namespace SLNet
 {
@@ -57,12 +70,33 @@ UDPForwarder::ForwardEntry::ForwardEntry()
 	timeLastDatagramForwarded= SLNet::GetTimeMS();
 	addr1Confirmed=UNASSIGNED_SYSTEM_ADDRESS;
 	addr2Confirmed=UNASSIGNED_SYSTEM_ADDRESS;
+	bytesForwarded=0;
+	datagramsForwarded=0;
+	forwardListIndex=0;
+	timerPrev=0;
+	timerNext=0;
+	timerSlot=0;
+	timerExpiryTick=0;
 }
 UDPForwarder::ForwardEntry::~ForwardEntry() {
 	if (socket!=INVALID_SOCKET)
 		closesocket__(socket);
 }
 
+UDPForwarder::ForwarderThread::ForwarderThread()
+{
+	udpForwarder=0;
+	startForwardingInput.SetPageSize(sizeof(StartForwardingInputStruct)*16);
+	stopForwardingCommands.SetPageSize(sizeof(StopForwardingStruct)*16);
+	memset(timerWheel, 0, sizeof(timerWheel));
+	timerWheelTick=0;
+	timerWheelTime=SLNet::GetTimeMS();
+#if UDP_FORWARDER_USE_EPOLL==1
+	epollFd=-1;
+	wakeupFd=-1;
+#endif
+}
+
 UDPForwarder::UDPForwarder()
 {
 #ifdef _WIN32
@@ -71,8 +105,9 @@ UDPForwarder::UDPForwarder()
 
 	maxForwardEntries=DEFAULT_MAX_FORWARD_ENTRIES;
 	nextInputId=0;
-	startForwardingInput.SetPageSize(sizeof(StartForwardingInputStruct)*16);
-	stopForwardingCommands.SetPageSize(sizeof(StopForwardingStruct)*16);
+	forwarderThreads=0;
+	forwarderThreadsLength=0;
+	numThreads=1;
 }
 UDPForwarder::~UDPForwarder()
 {
@@ -89,20 +124,38 @@ void UDPForwarder::Startup(void)
 
 	isRunning.Increment();
 
-	int errorCode;
+	forwarderThreadsLength=numThreads;
+	forwarderThreads=SLNet::OP_NEW_ARRAY<ForwarderThread>(forwarderThreadsLength,_FILE_AND_LINE_);
 
+	unsigned int i;
+	for (i=0; i < forwarderThreadsLength; i++)
+	{
+		forwarderThreads[i].udpForwarder=this;
+#if UDP_FORWARDER_USE_EPOLL==1
+		forwarderThreads[i].epollFd=epoll_create1(EPOLL_CLOEXEC);
+		forwarderThreads[i].wakeupFd=eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		RakAssert(forwarderThreads[i].epollFd>=0 && forwarderThreads[i].wakeupFd>=0);
+		epoll_event ev;
+		ev.events=EPOLLIN;
+		ev.data.ptr=0;
+		epoll_ctl(forwarderThreads[i].epollFd, EPOLL_CTL_ADD, forwarderThreads[i].wakeupFd, &ev);
+#endif
 
+		int errorCode;
 
-	errorCode = SLNet::RakThread::Create(UpdateUDPForwarderGlobal, this);
 
-	if ( errorCode != 0 )
-	{
-		RakAssert(0);
-		return;
-	}
 
-	while (threadRunning.GetValue()==0)
-		RakSleep(30);
+		errorCode = SLNet::RakThread::Create(UpdateUDPForwarderGlobal, &forwarderThreads[i]);
+
+		if ( errorCode != 0 )
+		{
+			RakAssert(0);
+			return;
+		}
+
+		while (forwarderThreads[i].threadRunning.GetValue()==0)
+			RakSleep(30);
+	}
 }
 void UDPForwarder::Shutdown(void)
 {
@@ -110,13 +163,40 @@ void UDPForwarder::Shutdown(void)
 		return;
 	isRunning.Decrement();
 
-	while (threadRunning.GetValue()>0)
-		RakSleep(30);
+	unsigned int i,j;
+	for (i=0; i < forwarderThreadsLength; i++)
+		WakeForwarderThread(&forwarderThreads[i]);
+	for (i=0; i < forwarderThreadsLength; i++)
+	{
+		while (forwarderThreads[i].threadRunning.GetValue()>0)
+			RakSleep(30);
+	}
 
-	unsigned int j;
-	for (j=0; j < forwardListNotUpdated.Size(); j++)
-		SLNet::OP_DELETE(forwardListNotUpdated[j],_FILE_AND_LINE_);
-	forwardListNotUpdated.Clear(false, _FILE_AND_LINE_);
+	for (i=0; i < forwarderThreadsLength; i++)
+	{
+		ForwarderThread *forwarderThread = &forwarderThreads[i];
+		for (j=0; j < forwarderThread->forwardList.Size(); j++)
+		{
+			SLNet::OP_DELETE(forwarderThread->forwardList[j],_FILE_AND_LINE_);
+			usedForwardEntries.Decrement();
+		}
+		forwarderThread->forwardList.Clear(false, _FILE_AND_LINE_);
+		forwarderThread->forwardEntryIndex.Clear(_FILE_AND_LINE_);
+#if UDP_FORWARDER_USE_EPOLL==1
+		close(forwarderThread->epollFd);
+		close(forwarderThread->wakeupFd);
+#endif
+	}
+	SLNet::OP_DELETE_ARRAY(forwarderThreads,_FILE_AND_LINE_);
+	forwarderThreads=0;
+	forwarderThreadsLength=0;
+}
+void UDPForwarder::SetNumThreads(unsigned int _numThreads)
+{
+	RakAssert(_numThreads>0);
+	if (_numThreads==0)
+		_numThreads=1;
+	numThreads=_numThreads;
 }
 void UDPForwarder::SetMaxForwardEntries(unsigned short maxEntries)
 {
@@ -129,7 +209,7 @@ int UDPForwarder::GetMaxForwardEntries(void) const
 }
 int UDPForwarder::GetUsedForwardEntries(void) const
 {
-	return (int) forwardListNotUpdated.Size();
+	return (int) usedForwardEntries.GetValue();
 }
 UDPForwarderResult UDPForwarder::StartForwarding(SystemAddress source, SystemAddress destination, SLNet::TimeMS timeoutOnNoDataMS, const char *forceHostAddress, unsigned short socketFamily,
 								  unsigned short *forwardingPort, __UDPSOCKET__ *forwardingSocket)
@@ -145,8 +225,9 @@ UDPForwarderResult UDPForwarder::StartForwarding(SystemAddress source, SystemAdd
 
 	unsigned int inputId = nextInputId++;
 
+	ForwarderThread *forwarderThread = GetForwarderThread(source, destination);
 	StartForwardingInputStruct *sfis;
-	sfis = startForwardingInput.Allocate(_FILE_AND_LINE_);
+	sfis = forwarderThread->startForwardingInput.Allocate(_FILE_AND_LINE_);
 	sfis->source=source;
 	sfis->destination=destination;
 	sfis->timeoutOnNoDataMS=timeoutOnNoDataMS;
@@ -155,7 +236,8 @@ UDPForwarderResult UDPForwarder::StartForwarding(SystemAddress source, SystemAdd
 		sfis->forceHostAddress=forceHostAddress;
 	sfis->socketFamily=socketFamily;
 	sfis->inputId=inputId;
-	startForwardingInput.Push(sfis);
+	forwarderThread->startForwardingInput.Push(sfis);
+	WakeForwarderThread(forwarderThread);
 
 	for(;;)
 	{
@@ -183,11 +265,239 @@ UDPForwarderResult UDPForwarder::StartForwarding(SystemAddress source, SystemAdd
 }
 void UDPForwarder::StopForwarding(SystemAddress source, SystemAddress destination)
 {
+	if (isRunning.GetValue()==0)
+		return;
+
+	ForwarderThread *forwarderThread = GetForwarderThread(source, destination);
 	StopForwardingStruct *sfs;
-	sfs = stopForwardingCommands.Allocate(_FILE_AND_LINE_);
+	sfs = forwarderThread->stopForwardingCommands.Allocate(_FILE_AND_LINE_);
 	sfs->destination=destination;
 	sfs->source=source;
-	stopForwardingCommands.Push(sfs);
+	forwarderThread->stopForwardingCommands.Push(sfs);
+	WakeForwarderThread(forwarderThread);
+}
+void UDPForwarder::GetForwardingStatistics(DataStructures::List<ForwardingStatistics> &statistics)
+{
+	statistics.Clear(true, _FILE_AND_LINE_);
+	for (unsigned int i=0; i < forwarderThreadsLength; i++)
+	{
+		ForwarderThread *forwarderThread = &forwarderThreads[i];
+		forwarderThread->forwardListMutex.Lock();
+		for (unsigned int j=0; j < forwarderThread->forwardList.Size(); j++)
+		{
+			ForwardEntry *fe = forwarderThread->forwardList[j];
+			ForwardingStatistics s;
+			s.source=fe->addr1Unconfirmed;
+			s.destination=fe->addr2Unconfirmed;
+			s.forwardingPort=SocketLayer::GetLocalPort(fe->socket);
+			s.bytesForwarded=fe->bytesForwarded;
+			s.datagramsForwarded=fe->datagramsForwarded;
+			s.timeLastDatagramForwarded=fe->timeLastDatagramForwarded;
+			statistics.Push(s, _FILE_AND_LINE_);
+		}
+		forwarderThread->forwardListMutex.Unlock();
+	}
+}
+bool UDPForwarder::GetForwardingStatistics(SystemAddress source, SystemAddress destination, ForwardingStatistics *statistics)
+{
+	if (isRunning.GetValue()==0)
+		return false;
+
+	ForwarderThread *forwarderThread = GetForwarderThread(source, destination);
+	forwarderThread->forwardListMutex.Lock();
+	ForwardEntry **forwardEntry = forwarderThread->forwardEntryIndex.Peek(ForwardEntryKey(source, destination));
+	if (forwardEntry)
+	{
+		ForwardEntry *fe = *forwardEntry;
+		statistics->source=fe->addr1Unconfirmed;
+		statistics->destination=fe->addr2Unconfirmed;
+		statistics->forwardingPort=SocketLayer::GetLocalPort(fe->socket);
+		statistics->bytesForwarded=fe->bytesForwarded;
+		statistics->datagramsForwarded=fe->datagramsForwarded;
+		statistics->timeLastDatagramForwarded=fe->timeLastDatagramForwarded;
+	}
+	forwarderThread->forwardListMutex.Unlock();
+	return forwardEntry!=0;
+}
+UDPForwarder::ForwarderThread* UDPForwarder::GetForwarderThread(const SystemAddress &source, const SystemAddress &destination)
+{
+	// Symmetric, so StopForwarding() finds the entry with source and destination swapped
+	unsigned long hash = SystemAddress::ToInteger(source) ^ SystemAddress::ToInteger(destination);
+	return &forwarderThreads[hash % forwarderThreadsLength];
+}
+void UDPForwarder::WakeForwarderThread(ForwarderThread *forwarderThread)
+{
+#if UDP_FORWARDER_USE_EPOLL==1
+	uint64_t one=1;
+	ssize_t ret = write(forwarderThread->wakeupFd, &one, sizeof(one));
+	(void) ret;
+#else
+	(void) forwarderThread;
+#endif
+}
+UDPForwarder::ForwardEntryKey::ForwardEntryKey(const SystemAddress &address1, const SystemAddress &address2)
+{
+	if (address1 < address2)
+	{
+		lowAddress=address1;
+		highAddress=address2;
+	}
+	else
+	{
+		lowAddress=address2;
+		highAddress=address1;
+	}
+}
+bool UDPForwarder::ForwardEntryKey::operator==(const ForwardEntryKey &right) const
+{
+	return lowAddress==right.lowAddress && highAddress==right.highAddress;
+}
+unsigned long UDPForwarder::ForwardEntryKey::ToUint32(const ForwardEntryKey &key)
+{
+	return SystemAddress::ToInteger(key.lowAddress)*31+SystemAddress::ToInteger(key.highAddress);
+}
+void UDPForwarder::AddForwardEntry(ForwarderThread *forwarderThread, ForwardEntry *forwardEntry, SLNet::TimeMS curTime)
+{
+	forwarderThread->forwardListMutex.Lock();
+	forwardEntry->forwardListIndex=forwarderThread->forwardList.Size();
+	forwarderThread->forwardList.Insert(forwardEntry,_FILE_AND_LINE_);
+	forwarderThread->forwardEntryIndex.Push(ForwardEntryKey(forwardEntry->addr1Unconfirmed, forwardEntry->addr2Unconfirmed), forwardEntry, _FILE_AND_LINE_);
+	forwarderThread->forwardListMutex.Unlock();
+
+	forwardEntry->timeLastDatagramForwarded=curTime;
+	AddToTimerWheel(forwarderThread, forwardEntry, forwardEntry->timeoutOnNoDataMS);
+}
+void UDPForwarder::RemoveForwardEntry(ForwarderThread *forwarderThread, ForwardEntry *forwardEntry)
+{
+	RemoveFromTimerWheel(forwardEntry);
+
+	forwarderThread->forwardListMutex.Lock();
+	// Move the last entry into the gap
+	unsigned int index = forwardEntry->forwardListIndex;
+	forwarderThread->forwardList.RemoveAtIndexFast(index);
+	if (index < forwarderThread->forwardList.Size())
+		forwarderThread->forwardList[index]->forwardListIndex=index;
+	forwarderThread->forwardEntryIndex.Remove(ForwardEntryKey(forwardEntry->addr1Unconfirmed, forwardEntry->addr2Unconfirmed), _FILE_AND_LINE_);
+	forwarderThread->forwardListMutex.Unlock();
+
+	SLNet::OP_DELETE(forwardEntry,_FILE_AND_LINE_);
+	usedForwardEntries.Decrement();
+}
+void UDPForwarder::AddToTimerWheel(ForwarderThread *forwarderThread, ForwardEntry *forwardEntry, SLNet::TimeMS delayMS)
+{
+	uint32_t delayTicks = (delayMS+TIMER_WHEEL_TICK_MS-1)/TIMER_WHEEL_TICK_MS;
+	if (delayTicks==0)
+		delayTicks=1;
+	if (delayTicks >= TIMER_WHEEL_SLOTS*TIMER_WHEEL_SLOTS)
+		delayTicks=TIMER_WHEEL_SLOTS*TIMER_WHEEL_SLOTS-1;
+	forwardEntry->timerExpiryTick=forwarderThread->timerWheelTick+delayTicks;
+
+	ForwardEntry **slot;
+	if (delayTicks < TIMER_WHEEL_SLOTS)
+		slot = &forwarderThread->timerWheel[0][forwardEntry->timerExpiryTick % TIMER_WHEEL_SLOTS];
+	else
+		slot = &forwarderThread->timerWheel[1][(forwardEntry->timerExpiryTick / TIMER_WHEEL_SLOTS) % TIMER_WHEEL_SLOTS];
+
+	forwardEntry->timerSlot=slot;
+	forwardEntry->timerPrev=0;
+	forwardEntry->timerNext=*slot;
+	if (*slot)
+		(*slot)->timerPrev=forwardEntry;
+	*slot=forwardEntry;
+}
+void UDPForwarder::RemoveFromTimerWheel(ForwardEntry *forwardEntry)
+{
+	if (forwardEntry->timerSlot==0)
+		return;
+	if (forwardEntry->timerPrev)
+		forwardEntry->timerPrev->timerNext=forwardEntry->timerNext;
+	else
+		*forwardEntry->timerSlot=forwardEntry->timerNext;
+	if (forwardEntry->timerNext)
+		forwardEntry->timerNext->timerPrev=forwardEntry->timerPrev;
+	forwardEntry->timerSlot=0;
+	forwardEntry->timerPrev=0;
+	forwardEntry->timerNext=0;
+}
+void UDPForwarder::UpdateTimerWheel(ForwarderThread *forwarderThread, SLNet::TimeMS curTime)
+{
+	// Unsigned subtraction accounts for timestamp wrap
+	while (curTime-forwarderThread->timerWheelTime >= TIMER_WHEEL_TICK_MS)
+	{
+		forwarderThread->timerWheelTime+=TIMER_WHEEL_TICK_MS;
+		forwarderThread->timerWheelTick++;
+
+		ForwardEntry *forwardEntry, *next;
+		// Move the entries of the next level 1 slot down to level 0
+		if (forwarderThread->timerWheelTick % TIMER_WHEEL_SLOTS==0)
+		{
+			ForwardEntry **slot = &forwarderThread->timerWheel[1][(forwarderThread->timerWheelTick / TIMER_WHEEL_SLOTS) % TIMER_WHEEL_SLOTS];
+			forwardEntry=*slot;
+			*slot=0;
+			for (; forwardEntry; forwardEntry=next)
+			{
+				next=forwardEntry->timerNext;
+				forwardEntry->timerSlot=0;
+				AddToTimerWheel(forwarderThread, forwardEntry, (forwardEntry->timerExpiryTick-forwarderThread->timerWheelTick)*TIMER_WHEEL_TICK_MS);
+			}
+		}
+
+		ForwardEntry **slot = &forwarderThread->timerWheel[0][forwarderThread->timerWheelTick % TIMER_WHEEL_SLOTS];
+		forwardEntry=*slot;
+		*slot=0;
+		for (; forwardEntry; forwardEntry=next)
+		{
+			next=forwardEntry->timerNext;
+			forwardEntry->timerSlot=0;
+			// Entries are not rescheduled for every datagram. Check if data was forwarded since the entry was scheduled.
+			SLNet::TimeMS timeSinceLastDatagram = curTime-forwardEntry->timeLastDatagramForwarded;
+			if (timeSinceLastDatagram >= forwardEntry->timeoutOnNoDataMS)
+				RemoveForwardEntry(forwarderThread, forwardEntry);
+			else
+				AddToTimerWheel(forwarderThread, forwardEntry, forwardEntry->timeoutOnNoDataMS-timeSinceLastDatagram);
+		}
+	}
+}
+bool UDPForwarder::GetForwardTarget(ForwardEntry *forwardEntry, const SystemAddress &receivedAddr, SystemAddress *forwardTarget)
+{
+	bool confirmed1 = forwardEntry->addr1Confirmed!=UNASSIGNED_SYSTEM_ADDRESS;
+	bool confirmed2 = forwardEntry->addr2Confirmed!=UNASSIGNED_SYSTEM_ADDRESS;
+	bool matchConfirmed1 =
+		confirmed1 &&
+		forwardEntry->addr1Confirmed==receivedAddr;
+	bool matchConfirmed2 =
+		confirmed2 &&
+		forwardEntry->addr2Confirmed==receivedAddr;
+	bool matchUnconfirmed1 = forwardEntry->addr1Unconfirmed.EqualsExcludingPort(receivedAddr);
+	bool matchUnconfirmed2 = forwardEntry->addr2Unconfirmed.EqualsExcludingPort(receivedAddr);
+
+	if (matchConfirmed1==true || (matchConfirmed2==false && confirmed1==false && matchUnconfirmed1==true))
+	{
+		// Forward to addr2
+		if (forwardEntry->addr1Confirmed==UNASSIGNED_SYSTEM_ADDRESS)
+		{
+			forwardEntry->addr1Confirmed=receivedAddr;
+		}
+		if (forwardEntry->addr2Confirmed!=UNASSIGNED_SYSTEM_ADDRESS)
+			*forwardTarget=forwardEntry->addr2Confirmed;
+		else
+			*forwardTarget=forwardEntry->addr2Unconfirmed;
+		return true;
+	}
+	else if (matchConfirmed2==true || (confirmed2==false && matchUnconfirmed2==true))
+	{
+		// Forward to addr1
+		if (forwardEntry->addr2Confirmed==UNASSIGNED_SYSTEM_ADDRESS)
+		{
+			forwardEntry->addr2Confirmed=receivedAddr;
+		}
+		if (forwardEntry->addr1Confirmed!=UNASSIGNED_SYSTEM_ADDRESS)
+			*forwardTarget=forwardEntry->addr1Confirmed;
+		else
+			*forwardTarget=forwardEntry->addr1Unconfirmed;
+		return true;
+	}
+	return false;
 }
 void UDPForwarder::RecvFrom(SLNet::TimeMS curTime, ForwardEntry *forwardEntry)
 {
@@ -260,7 +570,7 @@ void UDPForwarder::RecvFrom(SLNet::TimeMS curTime, ForwardEntry *forwardEntry)
 		}
 #endif
 
-		
+
 	}
 
 	if (receivedDataLen<=0)
@@ -286,46 +596,8 @@ void UDPForwarder::RecvFrom(SLNet::TimeMS curTime, ForwardEntry *forwardEntry)
 	//portnum=receivedAddr.GetPort();
 
 	SystemAddress forwardTarget;
-
-	bool confirmed1 = forwardEntry->addr1Confirmed!=UNASSIGNED_SYSTEM_ADDRESS;
-	bool confirmed2 = forwardEntry->addr2Confirmed!=UNASSIGNED_SYSTEM_ADDRESS;
-	bool matchConfirmed1 =
-		confirmed1 &&
-		forwardEntry->addr1Confirmed==receivedAddr;
-	bool matchConfirmed2 =
-		confirmed2 &&
-		forwardEntry->addr2Confirmed==receivedAddr;
-	bool matchUnconfirmed1 = forwardEntry->addr1Unconfirmed.EqualsExcludingPort(receivedAddr);
-	bool matchUnconfirmed2 = forwardEntry->addr2Unconfirmed.EqualsExcludingPort(receivedAddr);
-
-	if (matchConfirmed1==true || (matchConfirmed2==false && confirmed1==false && matchUnconfirmed1==true))
-	{
-		// Forward to addr2
-		if (forwardEntry->addr1Confirmed==UNASSIGNED_SYSTEM_ADDRESS)
-		{
-			forwardEntry->addr1Confirmed=receivedAddr;
-		}
-		if (forwardEntry->addr2Confirmed!=UNASSIGNED_SYSTEM_ADDRESS)
-			forwardTarget=forwardEntry->addr2Confirmed;
-		else
-			forwardTarget=forwardEntry->addr2Unconfirmed;
-	}
-	else if (matchConfirmed2==true || (confirmed2==false && matchUnconfirmed2==true))
-	{
-		// Forward to addr1
-		if (forwardEntry->addr2Confirmed==UNASSIGNED_SYSTEM_ADDRESS)
-		{
-			forwardEntry->addr2Confirmed=receivedAddr;
-		}
-		if (forwardEntry->addr1Confirmed!=UNASSIGNED_SYSTEM_ADDRESS)
-			forwardTarget=forwardEntry->addr1Confirmed;
-		else
-			forwardTarget=forwardEntry->addr1Unconfirmed;
-	}
-	else
-	{
+	if (GetForwardTarget(forwardEntry, receivedAddr, &forwardTarget)==false)
 		return;
-	}
 
 	// Forward to dest
 	len=0;
@@ -396,9 +668,101 @@ void UDPForwarder::RecvFrom(SLNet::TimeMS curTime, ForwardEntry *forwardEntry)
 	while ( len == 0 );
 
 	forwardEntry->timeLastDatagramForwarded=curTime;
+	if (len>0)
+	{
+		forwardEntry->bytesForwarded+=(uint64_t) len;
+		forwardEntry->datagramsForwarded++;
+	}
 #endif  // __native_client__
 }
-void UDPForwarder::UpdateUDPForwarder(void)
+#if UDP_FORWARDER_USE_EPOLL==1
+void UDPForwarder::RecvFromBatched(SLNet::TimeMS curTime, ForwardEntry *forwardEntry)
+{
+	char data[FORWARD_BATCH_SIZE][MAXIMUM_MTU_SIZE];
+	iovec recvIov[FORWARD_BATCH_SIZE], sendIov[FORWARD_BATCH_SIZE];
+	mmsghdr recvMsgs[FORWARD_BATCH_SIZE], sendMsgs[FORWARD_BATCH_SIZE];
+	sockaddr_storage recvAddrs[FORWARD_BATCH_SIZE];
+	SystemAddress forwardTargets[FORWARD_BATCH_SIZE];
+	int i;
+
+	for (int batchIndex=0; batchIndex < MAX_BATCHES_PER_EVENT; batchIndex++)
+	{
+		memset(recvMsgs, 0, sizeof(recvMsgs));
+		for (i=0; i < FORWARD_BATCH_SIZE; i++)
+		{
+			recvIov[i].iov_base=data[i];
+			recvIov[i].iov_len=MAXIMUM_MTU_SIZE;
+			recvMsgs[i].msg_hdr.msg_iov=&recvIov[i];
+			recvMsgs[i].msg_hdr.msg_iovlen=1;
+			recvMsgs[i].msg_hdr.msg_name=&recvAddrs[i];
+			recvMsgs[i].msg_hdr.msg_namelen=sizeof(recvAddrs[i]);
+		}
+
+		int numReceived = recvmmsg(forwardEntry->socket, recvMsgs, FORWARD_BATCH_SIZE, MSG_DONTWAIT, 0);
+		if (numReceived<=0)
+			return;
+
+		int numToSend=0;
+		memset(sendMsgs, 0, sizeof(mmsghdr)*numReceived);
+		for (i=0; i < numReceived; i++)
+		{
+			SystemAddress receivedAddr;
+			if (recvAddrs[i].ss_family==AF_INET)
+				memcpy(&receivedAddr.address.addr4,&recvAddrs[i],sizeof(sockaddr_in));
+#if RAKNET_SUPPORT_IPV6==1
+			else if (recvAddrs[i].ss_family==AF_INET6)
+				memcpy(&receivedAddr.address.addr6,&recvAddrs[i],sizeof(sockaddr_in6));
+#endif
+			else
+				continue;
+
+			SystemAddress *forwardTarget = &forwardTargets[numToSend];
+			if (GetForwardTarget(forwardEntry, receivedAddr, forwardTarget)==false)
+				continue;
+
+			sendIov[numToSend].iov_base=data[i];
+			sendIov[numToSend].iov_len=recvMsgs[i].msg_len;
+			sendMsgs[numToSend].msg_hdr.msg_iov=&sendIov[numToSend];
+			sendMsgs[numToSend].msg_hdr.msg_iovlen=1;
+#if RAKNET_SUPPORT_IPV6==1
+			if (forwardTarget->address.addr4.sin_family==AF_INET6)
+			{
+				sendMsgs[numToSend].msg_hdr.msg_name=&forwardTarget->address.addr6;
+				sendMsgs[numToSend].msg_hdr.msg_namelen=sizeof(sockaddr_in6);
+			}
+			else
+#endif
+			{
+				sendMsgs[numToSend].msg_hdr.msg_name=&forwardTarget->address.addr4;
+				sendMsgs[numToSend].msg_hdr.msg_namelen=sizeof(sockaddr_in);
+			}
+			numToSend++;
+		}
+
+		int numSent=0;
+		while (numSent < numToSend)
+		{
+			int ret = sendmmsg(forwardEntry->socket, sendMsgs+numSent, numToSend-numSent, 0);
+			if (ret<0 && errno==EINTR)
+				continue;
+			// The remaining datagrams are dropped, as sendto() would
+			if (ret<=0)
+				break;
+			for (i=numSent; i < numSent+ret; i++)
+				forwardEntry->bytesForwarded+=sendIov[i].iov_len;
+			forwardEntry->datagramsForwarded+=(uint64_t) ret;
+			numSent+=ret;
+		}
+		if (numToSend>0)
+			forwardEntry->timeLastDatagramForwarded=curTime;
+
+		// The socket is empty
+		if (numReceived < FORWARD_BATCH_SIZE)
+			return;
+	}
+}
+#endif
+void UDPForwarder::UpdateUDPForwarder(ForwarderThread *forwarderThread)
 {
 	/*
 #if !defined(SN_TARGET_PSP2)
@@ -419,135 +783,132 @@ void UDPForwarder::UpdateUDPForwarder(void)
 
 	for(;;)
 	{
-		sfis = startForwardingInput.Pop();
+		sfis = forwarderThread->startForwardingInput.Pop();
 		if (sfis==0)
 			break;
 
-		if (GetUsedForwardEntries()>maxForwardEntries)
+		sfos.result=UDPFORWARDER_RESULT_COUNT;
+
+		ForwardEntry **existingEntry = forwarderThread->forwardEntryIndex.Peek(ForwardEntryKey(sfis->source, sfis->destination));
+		if (existingEntry)
 		{
-			sfos.result=UDPFORWARDER_NO_SOCKETS;
+			sfos.forwardingPort = SocketLayer::GetLocalPort ( (*existingEntry)->socket );
+			sfos.forwardingSocket=(*existingEntry)->socket;
+			sfos.result=UDPFORWARDER_FORWARDING_ALREADY_EXISTS;
 		}
-		else
-		{
-			sfos.result=UDPFORWARDER_RESULT_COUNT;
 
-			for (unsigned int i=0; i < forwardListNotUpdated.Size(); i++)
-			{
-				if (
-					(forwardListNotUpdated[i]->addr1Unconfirmed==sfis->source &&
-					forwardListNotUpdated[i]->addr2Unconfirmed==sfis->destination)
-					||
-					(forwardListNotUpdated[i]->addr1Unconfirmed==sfis->destination &&
-					forwardListNotUpdated[i]->addr2Unconfirmed==sfis->source)
-					)
-				{
-					ForwardEntry *fe = forwardListNotUpdated[i];
-					sfos.forwardingPort = SocketLayer::GetLocalPort ( fe->socket );
-					sfos.forwardingSocket=fe->socket;
-					sfos.result=UDPFORWARDER_FORWARDING_ALREADY_EXISTS;
-					break;
-				}
-			}
+		// Reserve the entry, other threads may add entries at the same time
+		if (sfos.result==UDPFORWARDER_RESULT_COUNT && (int) usedForwardEntries.Increment()>maxForwardEntries+1)
+		{
+			usedForwardEntries.Decrement();
+			sfos.result=UDPFORWARDER_NO_SOCKETS;
+		}
 
-			if (sfos.result==UDPFORWARDER_RESULT_COUNT)
-			{
-				int sock_opt;
-				sockaddr_in listenerSocketAddress;
-				listenerSocketAddress.sin_port = 0;
-				ForwardEntry *fe = SLNet::OP_NEW<UDPForwarder::ForwardEntry>(_FILE_AND_LINE_);
-				fe->addr1Unconfirmed=sfis->source;
-				fe->addr2Unconfirmed=sfis->destination;
-				fe->timeoutOnNoDataMS=sfis->timeoutOnNoDataMS;
+		if (sfos.result==UDPFORWARDER_RESULT_COUNT)
+		{
+			int sock_opt;
+			sockaddr_in listenerSocketAddress;
+			listenerSocketAddress.sin_port = 0;
+			ForwardEntry *fe = SLNet::OP_NEW<UDPForwarder::ForwardEntry>(_FILE_AND_LINE_);
+			fe->addr1Unconfirmed=sfis->source;
+			fe->addr2Unconfirmed=sfis->destination;
+			fe->timeoutOnNoDataMS=sfis->timeoutOnNoDataMS;
 
 #if RAKNET_SUPPORT_IPV6!=1
-				fe->socket = socket__( AF_INET, SOCK_DGRAM, 0 );
-				listenerSocketAddress.sin_family = AF_INET;
-				if (sfis->forceHostAddress.IsEmpty()==false)
-				{
+			fe->socket = socket__( AF_INET, SOCK_DGRAM, 0 );
+			listenerSocketAddress.sin_family = AF_INET;
+			if (sfis->forceHostAddress.IsEmpty()==false)
+			{
 
 
 
 
-					inet_pton(AF_INET, sfis->forceHostAddress.C_String(), &listenerSocketAddress.sin_addr.s_addr);
+				inet_pton(AF_INET, sfis->forceHostAddress.C_String(), &listenerSocketAddress.sin_addr.s_addr);
 
-				}
-				else
-				{
-					listenerSocketAddress.sin_addr.s_addr = INADDR_ANY;
-				}
-				int ret = bind__( fe->socket, ( struct sockaddr * ) & listenerSocketAddress, sizeof( listenerSocketAddress ) );
-				if (ret==-1)
-				{
-					SLNet::OP_DELETE(fe,_FILE_AND_LINE_);
-					sfos.result=UDPFORWARDER_BIND_FAILED;
-				}
-				else
-				{
-					sfos.result=UDPFORWARDER_SUCCESS;
-				}
+			}
+			else
+			{
+				listenerSocketAddress.sin_addr.s_addr = INADDR_ANY;
+			}
+			int ret = bind__( fe->socket, ( struct sockaddr * ) & listenerSocketAddress, sizeof( listenerSocketAddress ) );
+			if (ret==-1)
+				sfos.result=UDPFORWARDER_BIND_FAILED;
+			else
+				sfos.result=UDPFORWARDER_SUCCESS;
 
 #else // RAKNET_SUPPORT_IPV6==1
-				struct addrinfo hints;
-				memset(&hints, 0, sizeof (addrinfo)); // make sure the struct is empty
-				hints.ai_family = sfis->socketFamily;
-				hints.ai_socktype = SOCK_DGRAM; // UDP sockets
-				hints.ai_flags = AI_PASSIVE;     // fill in my IP for me
-				struct addrinfo *servinfo=0, *aip;  // will point to the results
-
-				if (sfis->forceHostAddress.IsEmpty() || sfis->forceHostAddress=="UNASSIGNED_SYSTEM_ADDRESS")
-					getaddrinfo(0, "0", &hints, &servinfo);
-				else
-					getaddrinfo(sfis->forceHostAddress.C_String(), "0", &hints, &servinfo);
-
-				for (aip = servinfo; aip != nullptr; aip = aip->ai_next)
+			struct addrinfo hints;
+			memset(&hints, 0, sizeof (addrinfo)); // make sure the struct is empty
+			hints.ai_family = sfis->socketFamily;
+			hints.ai_socktype = SOCK_DGRAM; // UDP sockets
+			hints.ai_flags = AI_PASSIVE;     // fill in my IP for me
+			struct addrinfo *servinfo=0, *aip;  // will point to the results
+
+			if (sfis->forceHostAddress.IsEmpty() || sfis->forceHostAddress=="UNASSIGNED_SYSTEM_ADDRESS")
+				getaddrinfo(0, "0", &hints, &servinfo);
+			else
+				getaddrinfo(sfis->forceHostAddress.C_String(), "0", &hints, &servinfo);
+
+			for (aip = servinfo; aip != nullptr; aip = aip->ai_next)
+			{
+				// Open socket. The address type depends on what
+				// getaddrinfo() gave us.
+				fe->socket = socket__(aip->ai_family, aip->ai_socktype, aip->ai_protocol);
+				if (fe->socket != INVALID_SOCKET)
 				{
-					// Open socket. The address type depends on what
-					// getaddrinfo() gave us.
-					fe->socket = socket__(aip->ai_family, aip->ai_socktype, aip->ai_protocol);
-					if (fe->socket != INVALID_SOCKET)
+					int ret = bind__( fe->socket, aip->ai_addr, (int) aip->ai_addrlen );
+					if (ret>=0)
+					{
+						break;
+					}
+					else
 					{
-						int ret = bind__( fe->socket, aip->ai_addr, (int) aip->ai_addrlen );
-						if (ret>=0)
-						{
-							break;
-						}
-						else
-						{
-							closesocket__(fe->socket);
-							fe->socket=INVALID_SOCKET;
-						}
+						closesocket__(fe->socket);
+						fe->socket=INVALID_SOCKET;
 					}
 				}
+			}
 
-				freeaddrinfo(servinfo);
+			freeaddrinfo(servinfo);
 
-				if (fe->socket==INVALID_SOCKET)
-					sfos.result=UDPFORWARDER_BIND_FAILED;
-				else
-					sfos.result=UDPFORWARDER_SUCCESS;
+			if (fe->socket==INVALID_SOCKET)
+				sfos.result=UDPFORWARDER_BIND_FAILED;
+			else
+				sfos.result=UDPFORWARDER_SUCCESS;
 #endif  // RAKNET_SUPPORT_IPV6==1
 
-				if (sfos.result==UDPFORWARDER_SUCCESS)
-				{
-					sfos.forwardingPort = SocketLayer::GetLocalPort ( fe->socket );
-					sfos.forwardingSocket=fe->socket;
+			if (sfos.result==UDPFORWARDER_SUCCESS)
+			{
+				sfos.forwardingPort = SocketLayer::GetLocalPort ( fe->socket );
+				sfos.forwardingSocket=fe->socket;
 
-					sock_opt=1024*256;
-					setsockopt__(fe->socket, SOL_SOCKET, SO_RCVBUF, ( char * ) & sock_opt, sizeof ( sock_opt ) );
-					sock_opt=0;
-					setsockopt__(fe->socket, SOL_SOCKET, SO_LINGER, ( char * ) & sock_opt, sizeof ( sock_opt ) );
+				sock_opt=1024*256;
+				setsockopt__(fe->socket, SOL_SOCKET, SO_RCVBUF, ( char * ) & sock_opt, sizeof ( sock_opt ) );
+				sock_opt=0;
+				setsockopt__(fe->socket, SOL_SOCKET, SO_LINGER, ( char * ) & sock_opt, sizeof ( sock_opt ) );
 #ifdef _WIN32
-					unsigned long nonblocking = 1;
-					ioctlsocket__( fe->socket, FIONBIO, &nonblocking );
+				unsigned long nonblocking = 1;
+				ioctlsocket__( fe->socket, FIONBIO, &nonblocking );
 
 
 
 #else
-					fcntl( fe->socket, F_SETFL, O_NONBLOCK );
+				fcntl( fe->socket, F_SETFL, O_NONBLOCK );
 #endif
 
-					forwardListNotUpdated.Insert(fe,_FILE_AND_LINE_);
-				}
+#if UDP_FORWARDER_USE_EPOLL==1
+				epoll_event ev;
+				ev.events=EPOLLIN;
+				ev.data.ptr=fe;
+				epoll_ctl(forwarderThread->epollFd, EPOLL_CTL_ADD, fe->socket, &ev);
+#endif
+
+				AddForwardEntry(forwarderThread, fe, curTime);
+			}
+			else
+			{
+				SLNet::OP_DELETE(fe,_FILE_AND_LINE_);
+				usedForwardEntries.Decrement();
 			}
 		}
 
@@ -557,59 +918,25 @@ void UDPForwarder::UpdateUDPForwarder(void)
 		startForwardingOutput.Push(sfos,_FILE_AND_LINE_);
 		startForwardingOutputMutex.Unlock();
 
-		startForwardingInput.Deallocate(sfis, _FILE_AND_LINE_);
+		forwarderThread->startForwardingInput.Deallocate(sfis, _FILE_AND_LINE_);
 	}
 
 	StopForwardingStruct *sfs;
 
 	for(;;)
 	{
-		sfs = stopForwardingCommands.Pop();
+		sfs = forwarderThread->stopForwardingCommands.Pop();
 		if (sfs==0)
 			break;
 
-		ForwardEntry *fe;
-		for (unsigned int i=0; i < forwardListNotUpdated.Size(); i++)
-		{
-			if (
-				(forwardListNotUpdated[i]->addr1Unconfirmed==sfs->source &&
-				forwardListNotUpdated[i]->addr2Unconfirmed==sfs->destination)
-				||
-				(forwardListNotUpdated[i]->addr1Unconfirmed==sfs->destination &&
-				forwardListNotUpdated[i]->addr2Unconfirmed==sfs->source)
-				)
-			{
-				fe = forwardListNotUpdated[i];
-				forwardListNotUpdated.RemoveAtIndexFast(i);
-				SLNet::OP_DELETE(fe, _FILE_AND_LINE_);
-				break;
-			}
-		}
+		ForwardEntry **fe = forwarderThread->forwardEntryIndex.Peek(ForwardEntryKey(sfs->source, sfs->destination));
+		if (fe)
+			RemoveForwardEntry(forwarderThread, *fe);
 
-		stopForwardingCommands.Deallocate(sfs, _FILE_AND_LINE_);
+		forwarderThread->stopForwardingCommands.Deallocate(sfs, _FILE_AND_LINE_);
 	}
 
-	unsigned int i;
-
-	i=0;
-	while (i < forwardListNotUpdated.Size())
-	{
-		if (curTime > forwardListNotUpdated[i]->timeLastDatagramForwarded && // Account for timestamp wrap
-			curTime > forwardListNotUpdated[i]->timeLastDatagramForwarded+forwardListNotUpdated[i]->timeoutOnNoDataMS)
-		{
-			SLNet::OP_DELETE(forwardListNotUpdated[i],_FILE_AND_LINE_);
-			forwardListNotUpdated.RemoveAtIndex(i);
-		}
-		else
-			i++;
-	}
-
-	ForwardEntry *forwardEntry;
-	for (i=0; i < forwardListNotUpdated.Size(); i++)
-	{
-		forwardEntry = forwardListNotUpdated[i];
-		RecvFrom(curTime, forwardEntry);
-	}
+	UpdateTimerWheel(forwarderThread, curTime);
 }
 
 namespace SLNet {
@@ -618,24 +945,52 @@ RAK_THREAD_DECLARATION(UpdateUDPForwarderGlobal)
 
 
 
-	UDPForwarder * udpForwarder = ( UDPForwarder * ) arguments;
+	UDPForwarder::ForwarderThread * forwarderThread = ( UDPForwarder::ForwarderThread * ) arguments;
+	UDPForwarder * udpForwarder = forwarderThread->udpForwarder;
 
 
-	udpForwarder->threadRunning.Increment();
+	forwarderThread->threadRunning.Increment();
+#if UDP_FORWARDER_USE_EPOLL==1
+	epoll_event events[EPOLL_MAX_EVENTS];
+#endif
 	while (udpForwarder->isRunning.GetValue()>0)
 	{
-		udpForwarder->UpdateUDPForwarder();
+		udpForwarder->UpdateUDPForwarder(forwarderThread);
+
+#if UDP_FORWARDER_USE_EPOLL==1
+		// Wakes up for datagrams and commands. The timeout is for removing entries with no data.
+		int numEvents = epoll_wait(forwarderThread->epollFd, events, EPOLL_MAX_EVENTS, 30);
+		SLNet::TimeMS curTime = SLNet::GetTimeMS();
+		for (int i=0; i < numEvents; i++)
+		{
+			if (events[i].data.ptr==0)
+			{
+				uint64_t count;
+				ssize_t ret = read(forwarderThread->wakeupFd, &count, sizeof(count));
+				(void) ret;
+			}
+			else
+			{
+				// Entries are only deleted in UpdateUDPForwarder(), so the pointer is valid
+				udpForwarder->RecvFromBatched(curTime, (UDPForwarder::ForwardEntry*) events[i].data.ptr);
+			}
+		}
+#else
+		SLNet::TimeMS curTime = SLNet::GetTimeMS();
+		for (unsigned int i=0; i < forwarderThread->forwardList.Size(); i++)
+			udpForwarder->RecvFrom(curTime, forwarderThread->forwardList[i]);
 
 		// 12/1/2010 Do not change from 0
 		// See http://www.jenkinssoftware.com/forum/index.php?topic=4033.0;topicseen
 		// Avoid 100% reported CPU usage
-		if (udpForwarder->forwardListNotUpdated.Size()==0)
+		if (forwarderThread->forwardList.Size()==0)
 			RakSleep(30);
 		else
 			RakSleep(0);
+#endif
 	}
-	udpForwarder->threadRunning.Decrement();
-	
+	forwarderThread->threadRunning.Decrement();
+
 
 
 